@@ -23,6 +23,8 @@ uniform float uTime;
 
 uniform vec2 uResolution;
 
+#include "../Include/Amortize.glsl"
+
 
 
 vec3 palette(float t)
@@ -37,7 +39,7 @@ vec3 palette(float t)
 
 void main()
 {
-    vec2 uv = (gl_FragCoord.xy - 0.5 * uResolution.xy) / uResolution.y;
+    vec2 uv = (PixelCoord() - 0.5 * uResolution.xy) / uResolution.y;
     vec2 uv0 = uv;
     vec3 finalColour = vec3(0.0);
 
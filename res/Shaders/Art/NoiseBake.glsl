@@ -0,0 +1,100 @@
+#version 430 core
+
+// NoiseTextures' bake (see NoiseTextures.h): one texel per invocation of
+// a tileable noise texture. R holds value noise, G gradient noise, both
+// in 0..1. A texel at (k + 0.5) covers u_Period / u_Size lattice cells,
+// and the lattice wraps every u_Period cells, so the texture repeats
+// without a seam and bilinear filtering between texels reproduces the
+// interpolated noise.
+//   u_Dimensions 2: u_Noise2D, one z slice
+//   u_Dimensions 3: u_Noise3D, u_Size slices
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform int u_Dimensions;
+uniform int u_Size;
+uniform int u_Period;           // lattice cells across the texture
+
+layout(binding = 0) writeonly uniform image2D u_Noise2D;
+layout(binding = 1) writeonly uniform image3D u_Noise3D;
+
+// The art shaders' hash, on lattice coordinates wrapped to the period
+float hash(vec2 p)
+{
+    p = mod(p, float(u_Period));
+    return fract(sin(dot(p, vec2(127.1, 311.7))) * 43758.5453123);
+}
+
+float hash(vec3 p)
+{
+    p = mod(p, float(u_Period));
+    return fract(sin(dot(p, vec3(127.1, 311.7, 74.7))) * 43758.5453123);
+}
+
+vec2 gradient(vec2 i)
+{
+    float angle = 6.2831853 * hash(i);
+    return vec2(cos(angle), sin(angle));
+}
+
+vec3 gradient(vec3 i)
+{
+    // A uniformly distributed direction from two hashes
+    float z = 2.0 * hash(i) - 1.0;
+    float angle = 6.2831853 * hash(i + vec3(17.0, 59.0, 113.0));
+    float r = sqrt(1.0 - z * z);
+    return vec3(r * cos(angle), r * sin(angle), z);
+}
+
+// Quintic fade, as fbmnoise.shader uses
+vec2 fade(vec2 f) { return f * f * f * (f * (f * 6.0 - 15.0) + 10.0); }
+vec3 fade(vec3 f) { return f * f * f * (f * (f * 6.0 - 15.0) + 10.0); }
+
+vec2 noise(vec2 p)
+{
+    vec2 i = floor(p);
+    vec2 f = fract(p);
+    vec2 u = fade(f);
+
+    float value = mix(mix(hash(i), hash(i + vec2(1, 0)), u.x),
+                      mix(hash(i + vec2(0, 1)), hash(i + vec2(1, 1)), u.x), u.y);
+
+    float g = mix(mix(dot(gradient(i), f), dot(gradient(i + vec2(1, 0)), f - vec2(1, 0)), u.x),
+                  mix(dot(gradient(i + vec2(0, 1)), f - vec2(0, 1)), dot(gradient(i + vec2(1, 1)), f - vec2(1, 1)), u.x), u.y);
+
+    // 2D gradient noise stays within +-sqrt(0.5)
+    return vec2(value, clamp(0.5 + g * 0.7071, 0.0, 1.0));
+}
+
+vec2 noise(vec3 p)
+{
+    vec3 i = floor(p);
+    vec3 f = fract(p);
+    vec3 u = fade(f);
+
+    float value = 0.0;
+    float g = 0.0;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        vec3 offset = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+        vec3 w = mix(1.0 - u, u, offset);
+        float weight = w.x * w.y * w.z;
+        value += hash(i + offset) * weight;
+        g += dot(gradient(i + offset), f - offset) * weight;
+    }
+
+    // 3D gradient noise stays within +-sqrt(0.75)
+    return vec2(value, clamp(0.5 + g * 0.5774, 0.0, 1.0));
+}
+
+void main()
+{
+    ivec3 texel = ivec3(gl_GlobalInvocationID);
+    if (any(greaterThanEqual(texel, ivec3(u_Size, u_Size, u_Dimensions == 3 ? u_Size : 1))))
+        return;
+
+    float cellsPerTexel = float(u_Period) / float(u_Size);
+    if (u_Dimensions == 3)
+        imageStore(u_Noise3D, texel, vec4(noise((vec3(texel) + 0.5) * cellsPerTexel), 0.0, 0.0));
+    else
+        imageStore(u_Noise2D, texel.xy, vec4(noise((vec2(texel.xy) + 0.5) * cellsPerTexel), 0.0, 0.0));
+}
@@ -0,0 +1,73 @@
+// testProceduralArt's amortized rendering: rebuilds the full-resolution
+// frame from this frame's subset of shaded pixels (u_Current, packed by
+// PixelCoord() in the art shaders) and the previous full frame
+// (u_History). A pixel shaded this frame is copied; any other keeps its
+// history value, clamped to the range of the fresh pixels around it so a
+// changing pattern does not leave trails behind.
+//   u_Mode 1: checkerboard, u_Current is half width
+//   u_Mode 2: one pixel in each 2x2 block, u_Current is half size
+
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 aPosition;
+
+void main()
+{
+    gl_Position = vec4(aPosition, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+out vec4 FragColor;
+
+uniform sampler2D u_Current;
+uniform sampler2D u_History;
+uniform int u_Mode;
+uniform int u_Phase;            // as the art shaders were given it
+uniform int u_HistoryValid;     // 0 on the first frame after a resize
+
+// The packed texel that shades full-resolution pixel p (or would, on the
+// frame whose phase covers it)
+ivec2 Packed(ivec2 p)
+{
+    return u_Mode == 1 ? ivec2(p.x >> 1, p.y) : p >> 1;
+}
+
+vec3 Fetch(ivec2 packed)
+{
+    ivec2 size = textureSize(u_Current, 0);
+    return texelFetch(u_Current, clamp(packed, ivec2(0), size - 1), 0).rgb;
+}
+
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 packed = Packed(p);
+
+    bool fresh;
+    if (u_Mode == 1)
+        fresh = (p.x & 1) == ((p.y + u_Phase) & 1);
+    else
+        fresh = (p & 1) == ivec2(u_Phase & 1, u_Phase >> 1);
+
+    vec3 centre = Fetch(packed);
+    if (fresh || u_HistoryValid == 0)
+    {
+        FragColor = vec4(centre, 1.0);
+        return;
+    }
+
+    // The fresh samples nearest p: for the checkerboard these include the
+    // pixels either side and above and below it
+    vec3 north = Fetch(packed + ivec2(0, 1));
+    vec3 south = Fetch(packed - ivec2(0, 1));
+    vec3 east = Fetch(packed + ivec2(1, 0));
+    vec3 west = Fetch(packed - ivec2(1, 0));
+    vec3 low = min(centre, min(min(north, south), min(east, west)));
+    vec3 high = max(centre, max(max(north, south), max(east, west)));
+
+    vec3 history = texelFetch(u_History, p, 0).rgb;
+    FragColor = vec4(clamp(history, low, high), 1.0);
+}
@@ -23,8 +23,10 @@ out vec4 FragColor;
 uniform float u_Time;
 uniform vec2 u_Resolution;
 
+#include "../Include/Amortize.glsl"
+
 void main() {
-    vec2 uv = gl_FragCoord.xy / u_Resolution;
+    vec2 uv = PixelCoord() / u_Resolution;
     vec2 grid = floor(uv * 10.0); // Increase the multiplier for smaller squares
     float check = mod(grid.x + grid.y, 2.0); // Alternate between 0 and 1
     vec3 color = mix(vec3(1.0), vec3(0.0), check); // Black and white
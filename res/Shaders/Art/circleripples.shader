@@ -21,9 +21,11 @@ out vec4 FragColor;
 uniform float u_Time;
 uniform vec2 u_Resolution;
 
+#include "../Include/Amortize.glsl"
+
 
 void main() {
-    vec2 uv = gl_FragCoord.xy / u_Resolution;
+    vec2 uv = PixelCoord() / u_Resolution;
     uv -= 0.5; // Centre the coordinates
     float dist = length(uv); // Distance from the centre
 
@@ -15,6 +15,11 @@
 //which determines the frequency gap between successive layers.
 //Standard implementations typically utilize a gain of $0.5$ and a lacunarity of $2.0$, 
 //resulting in a power spectrum that follows a $1/f$ distribution [2].
+//
+//The NOISE variant selects the basis: ALU hashes and interpolates four lattice values
+//per octave; TEXTURE_2D fetches NoiseTextures' baked, tileable noise instead, so the
+//five octaves below cost five filtered fetches; TEXTURE_3D adds time as a third axis.
+#variant NOISE=ALU,TEXTURE_2D,TEXTURE_3D
 
 #shader vertex
 #version 330 core
@@ -38,6 +43,9 @@ out vec4 FragColor;
 uniform float uTime;
 uniform vec2 uResolution;
 
+#include "../Include/Amortize.glsl"
+
+#if NOISE == NOISE_ALU
 /**
  * Stochastic Hash Function: Maps a 2D vector to a deterministic 
  * pseudo-random scalar using a high-frequency trigonometric function.
@@ -65,6 +73,28 @@ float noise(vec2 p) {
     
     return mix(a, b, u.x) + (c - a) * u.y * (1.0 - u.x) + (d - b) * u.x * u.y;
 };
+#else
+/**
+ * Texture Noise: the same quintic value noise, baked per texel over a lattice
+ * that repeats every u_NoisePeriod cells. u_NoiseBasis picks value (1,0) or
+ * gradient (0,1) noise. The mip chain filters the high octaves.
+ */
+uniform float u_NoisePeriod;
+uniform vec2 u_NoiseBasis;
+#if NOISE == NOISE_TEXTURE_2D
+uniform sampler2D u_Noise2D;
+
+float noise(vec2 p) {
+    return dot(texture(u_Noise2D, p / u_NoisePeriod).rg, u_NoiseBasis);
+}
+#else
+uniform sampler3D u_Noise3D;
+
+float noise(vec2 p) {
+    return dot(texture(u_Noise3D, vec3(p, uTime) / u_NoisePeriod).rg, u_NoiseBasis);
+}
+#endif
+#endif
 
 /**
  * fBm Spectral Synthesis: Iteratively accumulates weighted noise octaves.
@@ -87,7 +117,7 @@ float fbm(vec2 uv) {
 }
 
 void main() {
-    vec2 uv = gl_FragCoord.xy / uResolution;
+    vec2 uv = PixelCoord() / uResolution;
     uv *= 10.0; // Global spatial scaling
 
     // Sample the fBm signal with a temporal offset for dynamic animation
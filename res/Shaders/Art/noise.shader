@@ -56,8 +56,18 @@
  * - Use noise to distort other patterns
  * - Map noise to colours instead of greyscale
  * - Combine with plasma for psychedelic effects
+ *
+ * PRECOMPUTED NOISE:
+ * ------------------
+ * The NOISE variant picks where noise() comes from:
+ *   ALU        - the hash and interpolation below, per pixel per frame
+ *   TEXTURE_2D - one fetch from NoiseTextures' baked 2D texture
+ *   TEXTURE_3D - one fetch from the 3D texture, with time as the third
+ *                axis, so the pattern evolves instead of sliding
+ * The texture variants can also read the gradient noise channel.
  * ============================================================================
  */
+#variant NOISE=ALU,TEXTURE_2D,TEXTURE_3D
 
 #shader vertex
 #version 330 core
@@ -82,6 +92,9 @@ out vec4 FragColor;
 uniform float u_Time;
 uniform vec2 u_Resolution;
 
+#include "../Include/Amortize.glsl"
+
+#if NOISE == NOISE_ALU
 /*
  * HASH FUNCTION
  * -------------
@@ -145,10 +158,36 @@ float noise(vec2 p) {
            (c - a) * u.y * (1.0 - u.x) +
            (d - b) * u.x * u.y;
 }
+#else
+/*
+ * TEXTURE NOISE
+ * -------------
+ * The same kind of noise, computed once per texel by NoiseTextures. The
+ * texture covers u_NoisePeriod lattice cells and repeats, so dividing
+ * by the period maps lattice space to texture space; the hardware's
+ * bilinear filter does the interpolation. u_NoiseBasis selects the
+ * channel: (1,0) value noise, (0,1) gradient noise.
+ */
+uniform float u_NoisePeriod;
+uniform vec2 u_NoiseBasis;
+#if NOISE == NOISE_TEXTURE_2D
+uniform sampler2D u_Noise2D;
+
+float noise(vec2 p) {
+    return dot(texture(u_Noise2D, p / u_NoisePeriod).rg, u_NoiseBasis);
+}
+#else
+uniform sampler3D u_Noise3D;
+
+float noise(vec2 p) {
+    return dot(texture(u_Noise3D, vec3(p, u_Time) / u_NoisePeriod).rg, u_NoiseBasis);
+}
+#endif
+#endif
 
 void main() {
     // Calculate UV coordinates (0 to 1 across screen)
-    vec2 uv = gl_FragCoord.xy / u_Resolution;
+    vec2 uv = PixelCoord() / u_Resolution;
 
     // Scale up the UV coordinates to see more noise detail
     // Higher scale = more "zoomed out", showing more variation
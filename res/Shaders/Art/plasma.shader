@@ -71,13 +71,15 @@ out vec4 FragColor;
 uniform float u_Time;       // Elapsed time in seconds - drives animation
 uniform vec2 u_Resolution;  // Screen dimensions in pixels
 
+#include "../Include/Amortize.glsl"
+
 void main() {
     // ========================================================================
     // STEP 1: Calculate UV coordinates (normalized screen position)
     // ========================================================================
     // gl_FragCoord.xy gives us the pixel position (e.g., 0-1920, 0-1080)
     // Dividing by resolution normalizes to 0.0 - 1.0 range
-    vec2 uv = gl_FragCoord.xy / u_Resolution;
+    vec2 uv = PixelCoord() / u_Resolution;
 
     // Centre the coordinates so (0,0) is at screen center instead of corner
     // After this: uv ranges from -1.0 to +1.0
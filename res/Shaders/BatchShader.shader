@@ -1,28 +0,0 @@
-#shader vertex // Specifies the vertex shader section
-#version 330 core
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aColor;
-
-out vec3 v_Color;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    v_Color = aColor;
-}
-
-
-#shader fragment // Specifies the fragment shader section
-#version 330 core // Using GLSL version 3.30, compatible with OpenGL 3.3
-in vec3 v_Color;
-out vec4 FragColor;
-
-void main()
-{
-    FragColor = vec4(v_Color, 1.0);
-}
-
@@ -0,0 +1,130 @@
+#version 430 core
+
+// One thread per meshlet: test its bounding sphere against the frustum,
+// its normal cone against the camera and (optionally) its screen rectangle
+// against the Hi-Z pyramid, then switch its draw command on or off. See
+// ClusterCulling.h and MeshletBuilder.h. Everything is in object space.
+layout(local_size_x = 256) in;
+
+struct Cluster
+{
+    vec4 centreRadius;     // bounding sphere, w = radius
+    vec4 coneAxisCutoff;   // xyz = cone axis, w = cutoff (1 = never back-facing)
+};
+
+// DrawElementsIndirectCommand
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int  baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 11) readonly buffer ClusterBuffer
+{
+    Cluster u_Clusters[];
+};
+
+layout(std430, binding = 12) buffer CommandBuffer
+{
+    DrawCommand u_Commands[];
+};
+
+// Read back a frame later for the GUI
+layout(binding = 0, offset = 0)  uniform atomic_uint u_VisibleCount;
+layout(binding = 0, offset = 4)  uniform atomic_uint u_FrustumCount;
+layout(binding = 0, offset = 8)  uniform atomic_uint u_BackfaceCount;
+layout(binding = 0, offset = 12) uniform atomic_uint u_OccludedCount;
+
+uniform int  u_ClusterCount;
+uniform int  u_FrustumEnabled;
+uniform int  u_ConeEnabled;
+uniform vec4 u_Planes[6];      // object space, xyz = inward unit normal
+uniform vec3 u_CameraLocal;    // camera position in object space
+
+uniform int       u_OcclusionEnabled;
+uniform sampler2D u_HiZ;
+uniform vec2      u_HiZSize;
+uniform float     u_HiZMaxLevel;
+uniform mat4      u_HiZModelViewProjection;   // object space to the pyramid's clip space
+
+bool InFrustum(vec3 centre, float radius)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(u_Planes[i].xyz, centre) + u_Planes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
+
+// Every triangle faces away from the camera (MeshletBuilder.h)
+bool IsBackfacing(vec3 centre, float radius, vec4 cone)
+{
+    vec3 toCluster = centre - u_CameraLocal;
+    return dot(toCluster, cone.xyz) >= cone.w * length(toCluster) + radius;
+}
+
+// As FrustumCull.glsl, for the sphere's box
+bool IsOccluded(vec3 boxMin, vec3 boxMax)
+{
+    vec2 uvMin = vec2(1.0);
+    vec2 uvMax = vec2(0.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = mix(boxMin, boxMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = u_HiZModelViewProjection * vec4(corner, 1.0);
+
+        // Reaches behind the camera: keep it
+        if (clip.w <= 0.0)
+            return false;
+
+        vec3 ndc = clip.xyz / clip.w;
+        uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);
+        uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+
+    uvMin = clamp(uvMin, 0.0, 1.0);
+    uvMax = clamp(uvMax, 0.0, 1.0);
+
+    vec2 sizeTexels = (uvMax - uvMin) * u_HiZSize;
+    float level = ceil(log2(max(max(sizeTexels.x, sizeTexels.y), 1.0)));
+    level = min(level, u_HiZMaxLevel);
+
+    float farthest = max(max(textureLod(u_HiZ, uvMin, level).r,
+                             textureLod(u_HiZ, vec2(uvMax.x, uvMin.y), level).r),
+                         max(textureLod(u_HiZ, vec2(uvMin.x, uvMax.y), level).r,
+                             textureLod(u_HiZ, uvMax, level).r));
+
+    return nearest > farthest;
+}
+
+void main()
+{
+    uint idx = gl_GlobalInvocationID.x;
+    if (idx >= uint(u_ClusterCount))
+        return;
+
+    Cluster cluster = u_Clusters[idx];
+    vec3 centre = cluster.centreRadius.xyz;
+    float radius = cluster.centreRadius.w;
+
+    uint visible = 0u;
+    if (u_FrustumEnabled != 0 && !InFrustum(centre, radius))
+        atomicCounterIncrement(u_FrustumCount);
+    else if (u_ConeEnabled != 0 && IsBackfacing(centre, radius, cluster.coneAxisCutoff))
+        atomicCounterIncrement(u_BackfaceCount);
+    else if (u_OcclusionEnabled != 0 && IsOccluded(centre - vec3(radius), centre + vec3(radius)))
+        atomicCounterIncrement(u_OccludedCount);
+    else
+    {
+        visible = 1u;
+        atomicCounterIncrement(u_VisibleCount);
+    }
+
+    u_Commands[idx].instanceCount = visible;
+}
@@ -0,0 +1,40 @@
+#shader vertex
+#version 430 core
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+
+// Per-instance data (see InstanceBuffer.h); the mat4 occupies locations 8-11.
+// With GPU culling these are the survivors the cull shader wrote.
+layout(location = 8) in mat4 a_InstanceModel;
+layout(location = 12) in vec4 a_InstanceColour;
+
+#include "../Include/FrameData.glsl"
+
+out vec3 v_Normal;
+out vec3 v_Colour;
+
+void main()
+{
+    // Instances are only rotated and uniformly scaled, so the model matrix
+    // itself transforms the normal correctly
+    v_Normal = mat3(a_InstanceModel) * aNormal;
+    v_Colour = a_InstanceColour.rgb;
+    gl_Position = u_ViewProjection * a_InstanceModel * vec4(aPosition, 1.0);
+}
+
+#shader fragment
+#version 430 core
+
+in vec3 v_Normal;
+in vec3 v_Colour;
+
+uniform vec3 u_LightDirection;
+
+out vec4 FragColor;
+
+void main()
+{
+    float diffuse = max(dot(normalize(v_Normal), -u_LightDirection), 0.0);
+    FragColor = vec4(v_Colour * (0.2 + 0.8 * diffuse), 1.0);
+}
@@ -0,0 +1,165 @@
+#version 430 core
+
+// One thread per instance: test the instance's bounds against the view
+// frustum (and optionally the Hi-Z pyramid) and append survivors to their
+// mesh's indirect draw command. See GPUCulling.h and HiZBuffer.h.
+layout(local_size_x = 256) in;
+
+struct CullInstance
+{
+    mat4 model;
+    vec4 colour;
+    uint mesh;
+    uint _pad0;
+    uint _pad1;
+    uint _pad2;
+};
+
+struct CullMesh
+{
+    vec4 centreRadius;   // local bounds centre, w = sphere radius
+    vec4 extents;        // local half extents
+};
+
+// Same layout as InstanceData: what the draw reads at locations 8..12
+struct Survivor
+{
+    mat4 model;
+    vec4 colour;
+};
+
+// DrawElementsIndirectCommand
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int  baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 2) readonly buffer InstanceBuffer
+{
+    CullInstance u_Instances[];
+};
+
+layout(std430, binding = 3) readonly buffer MeshBuffer
+{
+    CullMesh u_Meshes[];
+};
+
+layout(std430, binding = 4) writeonly buffer SurvivorBuffer
+{
+    Survivor u_Survivors[];
+};
+
+layout(std430, binding = 5) buffer CommandBuffer
+{
+    DrawCommand u_Commands[];
+};
+
+// Totals read back a frame later for the GUI
+layout(binding = 0, offset = 0) uniform atomic_uint u_VisibleCount;
+layout(binding = 0, offset = 4) uniform atomic_uint u_OccludedCount;
+
+uniform int  u_InstanceCount;
+uniform int  u_CullEnabled;
+uniform vec4 u_Planes[6];   // xyz = inward normal, w = distance (Frustum::FromMatrix)
+
+// Occlusion: depth pyramid from an earlier frame and the matrix that
+// frame was drawn with
+uniform int       u_OcclusionEnabled;
+uniform sampler2D u_HiZ;
+uniform vec2      u_HiZSize;           // level 0 size in texels
+uniform float     u_HiZMaxLevel;
+uniform mat4      u_HiZViewProjection;
+
+bool IsVisible(vec3 centre, vec3 extents, float radius)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        vec4 plane = u_Planes[i];
+        float distance = dot(plane.xyz, centre) + plane.w;
+
+        // Box: distance from the centre to the plane along the normal that
+        // the box can still reach. Sphere: just its radius. Outside either
+        // means outside.
+        float boxReach = dot(extents, abs(plane.xyz));
+        if (distance < -min(boxReach, radius))
+            return false;
+    }
+    return true;
+}
+
+bool IsOccluded(vec3 boxMin, vec3 boxMax)
+{
+    // Screen rectangle and nearest depth of the box's eight corners
+    vec2 uvMin = vec2(1.0);
+    vec2 uvMax = vec2(0.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = mix(boxMin, boxMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = u_HiZViewProjection * vec4(corner, 1.0);
+
+        // A corner behind the camera has no sensible screen position, and
+        // the box reaches the camera anyway: keep it
+        if (clip.w <= 0.0)
+            return false;
+
+        vec3 ndc = clip.xyz / clip.w;
+        uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);
+        uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+
+    uvMin = clamp(uvMin, 0.0, 1.0);
+    uvMax = clamp(uvMax, 0.0, 1.0);
+
+    // The level where the rectangle spans at most 2x2 texels
+    vec2 sizeTexels = (uvMax - uvMin) * u_HiZSize;
+    float level = ceil(log2(max(max(sizeTexels.x, sizeTexels.y), 1.0)));
+    level = min(level, u_HiZMaxLevel);
+
+    float farthest = max(max(textureLod(u_HiZ, uvMin, level).r,
+                             textureLod(u_HiZ, vec2(uvMax.x, uvMin.y), level).r),
+                         max(textureLod(u_HiZ, vec2(uvMin.x, uvMax.y), level).r,
+                             textureLod(u_HiZ, uvMax, level).r));
+
+    // Everything under the rectangle is nearer than the nearest corner
+    return nearest > farthest;
+}
+
+void main()
+{
+    uint idx = gl_GlobalInvocationID.x;
+    if (idx >= uint(u_InstanceCount))
+        return;
+
+    CullInstance instance = u_Instances[idx];
+    CullMesh mesh = u_Meshes[instance.mesh];
+
+    // Local bounds to world space (Bounds::Transformed): the centre moves
+    // with the matrix, the box grows to enclose the rotated box, and the
+    // sphere scales by the largest axis scale.
+    mat3 linear = mat3(instance.model);
+    vec3 centre = vec3(instance.model * vec4(mesh.centreRadius.xyz, 1.0));
+    vec3 extents = abs(linear[0]) * mesh.extents.x
+                 + abs(linear[1]) * mesh.extents.y
+                 + abs(linear[2]) * mesh.extents.z;
+    float scale = max(length(linear[0]), max(length(linear[1]), length(linear[2])));
+    float radius = mesh.centreRadius.w * scale;
+
+    if (u_CullEnabled != 0 && !IsVisible(centre, extents, radius))
+        return;
+
+    if (u_OcclusionEnabled != 0 && IsOccluded(centre - extents, centre + extents))
+    {
+        atomicCounterIncrement(u_OccludedCount);
+        return;
+    }
+
+    uint slot = atomicAdd(u_Commands[instance.mesh].instanceCount, 1u);
+    u_Survivors[u_Commands[instance.mesh].baseInstance + slot] = Survivor(instance.model, instance.colour);
+    atomicCounterIncrement(u_VisibleCount);
+}
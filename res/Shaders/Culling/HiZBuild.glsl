@@ -0,0 +1,45 @@
+#version 430 core
+
+// One level of the Hi-Z pyramid (see HiZBuffer.h). Level 0 is a power of
+// two at least the depth texture's size, and each of its texels is the max
+// of the depth texels it overlaps; every other level writes the max of the
+// 2x2 block of the level above, which halves exactly.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform int u_Level;
+uniform sampler2D u_Depth;                          // level 0 source
+
+layout(binding = 0, r32f) readonly uniform image2D u_Src;    // level - 1
+layout(binding = 1, r32f) writeonly uniform image2D u_Dst;   // level
+
+void main()
+{
+    ivec2 dst = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 dstSize = imageSize(u_Dst);
+    if (dst.x >= dstSize.x || dst.y >= dstSize.y)
+        return;
+
+    float depth = 0.0;
+    if (u_Level == 0)
+    {
+        // The depth texels under [dst, dst + 1) scaled to the depth size:
+        // at most two each way, as level 0 is no smaller
+        ivec2 depthSize = textureSize(u_Depth, 0);
+        ivec2 first = dst * depthSize / dstSize;
+        ivec2 last = ((dst + 1) * depthSize - 1) / dstSize;
+        for (int y = first.y; y <= last.y; y++)
+            for (int x = first.x; x <= last.x; x++)
+                depth = max(depth, texelFetch(u_Depth, ivec2(x, y), 0).r);
+        imageStore(u_Dst, dst, vec4(depth));
+        return;
+    }
+
+    // A side already down to 1 stays 1, and reads its one texel twice
+    ivec2 srcSize = imageSize(u_Src);
+    ivec2 src = dst * 2;
+    for (int y = 0; y <= 1; y++)
+        for (int x = 0; x <= 1; x++)
+            depth = max(depth, imageLoad(u_Src, min(src + ivec2(x, y), srcSize - 1)).r);
+
+    imageStore(u_Dst, dst, vec4(depth));
+}
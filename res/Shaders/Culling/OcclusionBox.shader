@@ -0,0 +1,37 @@
+// OcclusionQueries' box tests: a world-space AABB from gl_VertexID, no
+// attributes. Drawn with colour and depth writes off inside an occlusion
+// query, so only whether a sample passes the depth test matters and the
+// fragment stage writes nothing.
+
+#shader vertex
+#version 330 core
+
+uniform mat4 u_ViewProjection;
+uniform vec3 u_BoxMin;
+uniform vec3 u_BoxMax;
+
+// 12 triangles over the corners (bit 0 = x, bit 1 = y, bit 2 = z); the
+// winding does not matter, face culling is off
+const int INDICES[36] = int[36](
+    0, 2, 1,  1, 2, 3,    // -z
+    4, 5, 6,  5, 7, 6,    // +z
+    0, 1, 4,  1, 5, 4,    // -y
+    2, 6, 3,  3, 6, 7,    // +y
+    0, 4, 2,  2, 4, 6,    // -x
+    1, 3, 5,  3, 7, 5     // +x
+);
+
+void main()
+{
+    int corner = INDICES[gl_VertexID];
+    vec3 select = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+    gl_Position = u_ViewProjection * vec4(mix(u_BoxMin, u_BoxMax, select), 1.0);
+}
+
+
+#shader fragment
+#version 330 core
+
+void main()
+{
+}
@@ -7,8 +7,7 @@ layout(location = 2) in vec3 aColour;
 layout(location = 3) in vec2 aTexCoord;
 
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+#include "Include/FrameData.glsl"
 
 out vec3 v_WorldPos;
 out vec3 v_Normal;
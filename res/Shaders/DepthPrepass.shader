@@ -0,0 +1,72 @@
+// RenderQueue's depth pre-pass (see RenderQueue.h): depth only, so the
+// fragment stage writes nothing and the expensive shaders run afterwards,
+// with GL_EQUAL, once per visible pixel.
+//
+// The shading pass only keeps fragments whose depth matches exactly, so
+// gl_Position here is `invariant` and computed with the same expression
+// the lit shaders use:
+//     u_Projection * (u_View * vec4(vec3(model * vec4(aPosition, 1.0)), 1.0))
+// A shader drawn after the pre-pass must declare `invariant gl_Position`
+// and do the same, or its fragments fail the test here and there.
+//
+// INSTANCED takes the model matrix from the InstanceBuffer attributes
+// instead of u_Model. PULL=STANDARD or PACKED is for commands that pull
+// their vertices (see MeshArena.h): the position, and the instances, come
+// from storage buffers, decoded as the shading pass's PULL variant does.
+#variant INSTANCED=OFF,ON
+#variant PULL=OFF,STANDARD,PACKED
+
+#shader vertex
+#version 430 core
+
+#if PULL != PULL_OFF
+#include "Include/VertexPull.glsl"
+#else
+layout(location = 0) in vec3 aPosition;
+#endif
+
+#if INSTANCED == INSTANCED_ON && PULL != PULL_OFF
+// The InstanceBuffer as storage (InstanceBuffer::STORAGE_BINDING)
+struct InstanceData
+{
+    mat4 model;
+    vec4 colour;
+};
+layout(std430, binding = 10) readonly buffer Instances
+{
+    InstanceData instances[];
+};
+uniform int u_BaseInstance;
+#elif INSTANCED == INSTANCED_ON
+// Per-instance data (see InstanceBuffer.h); the mat4 occupies locations 8-11
+layout(location = 8) in mat4 a_InstanceModel;
+#else
+uniform mat4 u_Model;
+#endif
+
+#include "Include/FrameData.glsl"
+
+invariant gl_Position;
+
+void main()
+{
+#if PULL != PULL_OFF
+    PullVertex();
+#endif
+#if INSTANCED == INSTANCED_ON && PULL != PULL_OFF
+    vec3 worldPosition = vec3(instances[u_BaseInstance + gl_InstanceID].model * vec4(aPosition, 1.0));
+#elif INSTANCED == INSTANCED_ON
+    vec3 worldPosition = vec3(a_InstanceModel * vec4(aPosition, 1.0));
+#else
+    vec3 worldPosition = vec3(u_Model * vec4(aPosition, 1.0));
+#endif
+    gl_Position = u_Projection * (u_View * vec4(worldPosition, 1.0));
+}
+
+
+#shader fragment
+#version 330 core
+
+void main()
+{
+}
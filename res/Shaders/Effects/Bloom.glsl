@@ -0,0 +1,98 @@
+#version 430 core
+
+// PostProcessChain's bloom (see PostProcessChain.h), one step per
+// dispatch over a half-resolution mip pyramid:
+//   0: 13-tap downsample of the stage's input into level 0, keeping only
+//      what is above the threshold (with a soft knee)
+//   1: 13-tap downsample of level u_Level - 1 into u_Level
+//   2: tent-filtered upsample of u_Level + 1, added into u_Level
+//   3: the input plus a tent-filtered upsample of level 0
+// After the upsamples level 0 holds every level's blur summed, so a glow
+// as wide as the screen costs a few taps per texel of a small level
+// rather than a full-resolution wide kernel.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform int u_Mode;
+uniform int u_Level;                // the level written (modes 1, 2)
+uniform float u_Threshold;
+uniform float u_Knee;
+uniform float u_Intensity;
+uniform float u_Opacity;
+
+uniform sampler2D u_Input;          // the stage's input
+uniform sampler2D u_Pyramid;        // sampled by level with textureLod
+layout(binding = 0, rgba16f) uniform image2D u_PyramidLevel;
+layout(binding = 1) writeonly uniform image2D u_Output;     // mode 3
+
+// Call of Duty: Advanced Warfare's downsample: four overlapping 2x2 box
+// filters and a centre one, which keeps thin bright features from
+// flickering as they cross texels
+vec3 Downsample(sampler2D source, float lod, vec2 uv, vec2 texel)
+{
+    vec3 a = textureLod(source, uv + texel * vec2(-2.0,  2.0), lod).rgb;
+    vec3 b = textureLod(source, uv + texel * vec2( 0.0,  2.0), lod).rgb;
+    vec3 c = textureLod(source, uv + texel * vec2( 2.0,  2.0), lod).rgb;
+    vec3 d = textureLod(source, uv + texel * vec2(-2.0,  0.0), lod).rgb;
+    vec3 e = textureLod(source, uv, lod).rgb;
+    vec3 f = textureLod(source, uv + texel * vec2( 2.0,  0.0), lod).rgb;
+    vec3 g = textureLod(source, uv + texel * vec2(-2.0, -2.0), lod).rgb;
+    vec3 h = textureLod(source, uv + texel * vec2( 0.0, -2.0), lod).rgb;
+    vec3 i = textureLod(source, uv + texel * vec2( 2.0, -2.0), lod).rgb;
+    vec3 j = textureLod(source, uv + texel * vec2(-1.0,  1.0), lod).rgb;
+    vec3 k = textureLod(source, uv + texel * vec2( 1.0,  1.0), lod).rgb;
+    vec3 l = textureLod(source, uv + texel * vec2(-1.0, -1.0), lod).rgb;
+    vec3 m = textureLod(source, uv + texel * vec2( 1.0, -1.0), lod).rgb;
+    return e * 0.125 + (a + c + g + i) * 0.03125 + (b + d + f + h) * 0.0625 + (j + k + l + m) * 0.125;
+}
+
+// 3x3 tent, one source texel either side
+vec3 Upsample(float lod, vec2 uv, vec2 texel)
+{
+    vec3 sum = textureLod(u_Pyramid, uv, lod).rgb * 4.0;
+    sum += (textureLod(u_Pyramid, uv + vec2(texel.x, 0.0), lod).rgb + textureLod(u_Pyramid, uv - vec2(texel.x, 0.0), lod).rgb
+          + textureLod(u_Pyramid, uv + vec2(0.0, texel.y), lod).rgb + textureLod(u_Pyramid, uv - vec2(0.0, texel.y), lod).rgb) * 2.0;
+    sum += textureLod(u_Pyramid, uv + texel, lod).rgb + textureLod(u_Pyramid, uv - texel, lod).rgb
+         + textureLod(u_Pyramid, uv + vec2(texel.x, -texel.y), lod).rgb + textureLod(u_Pyramid, uv + vec2(-texel.x, texel.y), lod).rgb;
+    return sum / 16.0;
+}
+
+vec3 Threshold(vec3 colour)
+{
+    float brightness = max(colour.r, max(colour.g, colour.b));
+    float soft = clamp(brightness - u_Threshold + u_Knee, 0.0, 2.0 * u_Knee);
+    soft = soft * soft / (4.0 * u_Knee + 0.0001);
+    return colour * max(soft, brightness - u_Threshold) / max(brightness, 0.0001);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = u_Mode == 3 ? imageSize(u_Output) : imageSize(u_PyramidLevel);
+    if (texel.x >= size.x || texel.y >= size.y)
+        return;
+    vec2 uv = (vec2(texel) + 0.5) / vec2(size);
+
+    if (u_Mode == 0)
+    {
+        vec2 sourceTexel = 1.0 / vec2(textureSize(u_Input, 0));
+        imageStore(u_PyramidLevel, texel, vec4(Threshold(Downsample(u_Input, 0.0, uv, sourceTexel)), 1.0));
+    }
+    else if (u_Mode == 1)
+    {
+        vec2 sourceTexel = 1.0 / vec2(textureSize(u_Pyramid, u_Level - 1));
+        imageStore(u_PyramidLevel, texel, vec4(Downsample(u_Pyramid, float(u_Level - 1), uv, sourceTexel), 1.0));
+    }
+    else if (u_Mode == 2)
+    {
+        vec2 sourceTexel = 1.0 / vec2(textureSize(u_Pyramid, u_Level + 1));
+        vec3 sum = imageLoad(u_PyramidLevel, texel).rgb + Upsample(float(u_Level + 1), uv, sourceTexel);
+        imageStore(u_PyramidLevel, texel, vec4(sum, 1.0));
+    }
+    else
+    {
+        vec3 colour = texelFetch(u_Input, texel, 0).rgb;
+        vec2 sourceTexel = 1.0 / vec2(textureSize(u_Pyramid, 0));
+        vec3 bloomed = colour + Upsample(0.0, uv, sourceTexel) * u_Intensity;
+        imageStore(u_Output, texel, vec4(mix(colour, bloomed, u_Opacity), 1.0));
+    }
+}
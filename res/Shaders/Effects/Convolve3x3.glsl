@@ -0,0 +1,91 @@
+#version 430 core
+
+// PostProcessChain's 3x3 neighbourhood stages (see PostProcessChain.h).
+// The group first loads its 16x16 texels plus a one-texel apron into
+// shared memory, so each input texel is fetched about once rather than
+// nine times, then every invocation convolves from the tile.
+#define TILE 16
+#define APRON 1
+#define TILE_SPAN (TILE + 2 * APRON)
+
+layout(local_size_x = TILE, local_size_y = TILE) in;
+
+// As PostProcessChain::Effect
+const int EFFECT_EDGE = 1;
+const int EFFECT_SHARPEN = 4;
+const int EFFECT_MIDDLE_BOX = 9;
+
+uniform int u_Effect;
+uniform float u_Opacity;       // 0 passes the input through
+
+uniform sampler2D u_Input;
+layout(binding = 0) writeonly uniform image2D u_Output;
+
+shared vec3 s_Tile[TILE_SPAN][TILE_SPAN];
+
+vec3 Tap(ivec2 centre, int x, int y)
+{
+    return s_Tile[centre.y + y][centre.x + x];
+}
+
+void main()
+{
+    ivec2 size = textureSize(u_Input, 0);
+
+    // Edge texels repeat, as a clamped texture lookup would
+    ivec2 origin = ivec2(gl_WorkGroupID.xy) * TILE - APRON;
+    for (int i = int(gl_LocalInvocationIndex); i < TILE_SPAN * TILE_SPAN; i += TILE * TILE)
+    {
+        ivec2 local = ivec2(i % TILE_SPAN, i / TILE_SPAN);
+        s_Tile[local.y][local.x] = texelFetch(u_Input, clamp(origin + local, ivec2(0), size - 1), 0).rgb;
+    }
+    barrier();
+
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (texel.x >= size.x || texel.y >= size.y)
+        return;
+
+    ivec2 centre = ivec2(gl_LocalInvocationID.xy) + APRON;
+    vec3 colour = Tap(centre, 0, 0);
+    vec3 result = colour;
+
+    if (u_Effect == EFFECT_EDGE)
+    {
+        // Sobel: a high gradient in x or y is an edge
+        vec3 gx = Tap(centre, 1, -1) + 2.0 * Tap(centre, 1, 0) + Tap(centre, 1, 1)
+                - Tap(centre, -1, -1) - 2.0 * Tap(centre, -1, 0) - Tap(centre, -1, 1);
+        vec3 gy = Tap(centre, -1, 1) + 2.0 * Tap(centre, 0, 1) + Tap(centre, 1, 1)
+                - Tap(centre, -1, -1) - 2.0 * Tap(centre, 0, -1) - Tap(centre, 1, -1);
+        result = vec3(length(gx) + length(gy));
+    }
+    else if (u_Effect == EFFECT_SHARPEN)
+    {
+        vec3 sum = vec3(0.0);
+        for (int y = -1; y <= 1; y++)
+        {
+            for (int x = -1; x <= 1; x++)
+                sum += Tap(centre, x, y);
+        }
+        result = 10.0 * colour - sum;    // 9 * centre - the 8 around it
+    }
+    else if (u_Effect == EFFECT_MIDDLE_BOX)
+    {
+        // The central square inverted, a 1-2-1 Gaussian around it
+        vec2 uv = (vec2(texel) + 0.5) / vec2(size);
+        if (uv.x > 0.33 && uv.x < 0.66 && uv.y > 0.33 && uv.y < 0.66)
+        {
+            result = 1.0 - colour;
+        }
+        else
+        {
+            result = vec3(0.0);
+            for (int y = -1; y <= 1; y++)
+            {
+                for (int x = -1; x <= 1; x++)
+                    result += Tap(centre, x, y) * float((2 - abs(x)) * (2 - abs(y))) / 16.0;
+            }
+        }
+    }
+
+    imageStore(u_Output, texel, vec4(mix(colour, result, u_Opacity), 1.0));
+}
@@ -0,0 +1,63 @@
+#version 430 core
+
+// One direction of PostProcessChain's separable Gaussian blur (see
+// PostProcessChain.h). A group blurs LINE texels of one row (or column):
+// it loads them and the radius either side into shared memory once, so a
+// texel costs 1 + 2 * radius / LINE fetches whatever the radius, and the
+// two directions together cost 2 * (2r + 1) multiply-adds rather than
+// (2r + 1)^2.
+#define LINE 128
+#define MAX_RADIUS 32
+
+layout(local_size_x = LINE) in;
+
+uniform int u_Horizontal;      // 1: along rows, 0: along columns
+uniform int u_Radius;          // up to MAX_RADIUS
+uniform int u_Final;           // second direction: mix with u_Original
+uniform float u_Opacity;
+
+uniform sampler2D u_Input;
+uniform sampler2D u_Original;  // the stage's input, for the opacity mix
+layout(binding = 0) writeonly uniform image2D u_Output;
+
+shared vec3 s_Line[LINE + 2 * MAX_RADIUS];
+
+void main()
+{
+    ivec2 size = textureSize(u_Input, 0);
+    ivec2 along = u_Horizontal != 0 ? ivec2(1, 0) : ivec2(0, 1);
+    ivec2 across = ivec2(1) - along;
+    int extent = u_Horizontal != 0 ? size.x : size.y;
+    int line = int(gl_WorkGroupID.y);
+    int start = int(gl_WorkGroupID.x) * LINE;
+    int radius = clamp(u_Radius, 0, MAX_RADIUS);
+
+    for (int i = int(gl_LocalInvocationID.x); i < LINE + 2 * radius; i += LINE)
+    {
+        int position = clamp(start - radius + i, 0, extent - 1);
+        s_Line[i] = texelFetch(u_Input, along * position + across * line, 0).rgb;
+    }
+    barrier();
+
+    int position = start + int(gl_LocalInvocationID.x);
+    if (position >= extent)
+        return;
+
+    // Sigma a third of the radius: the last tap is ~1% of the centre
+    float sigma = max(float(radius) / 3.0, 0.5);
+    int centre = int(gl_LocalInvocationID.x) + radius;
+    vec3 sum = s_Line[centre];
+    float weights = 1.0;
+    for (int i = 1; i <= radius; i++)
+    {
+        float weight = exp(-float(i * i) / (2.0 * sigma * sigma));
+        sum += (s_Line[centre - i] + s_Line[centre + i]) * weight;
+        weights += 2.0 * weight;
+    }
+    sum /= weights;
+
+    ivec2 texel = along * position + across * line;
+    if (u_Final != 0)
+        sum = mix(texelFetch(u_Original, texel, 0).rgb, sum, u_Opacity);
+    imageStore(u_Output, texel, vec4(sum, 1.0));
+}
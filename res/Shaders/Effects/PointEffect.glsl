@@ -0,0 +1,49 @@
+#version 430 core
+
+// PostProcessChain's per-pixel stages (see PostProcessChain.h): each
+// output texel depends only on the same input texel, so there is nothing
+// to share between invocations.
+layout(local_size_x = 16, local_size_y = 16) in;
+
+// As PostProcessChain::Effect
+const int EFFECT_INVERT = 2;
+const int EFFECT_GREYSCALE = 6;
+const int EFFECT_VENEZUELA = 7;
+const int EFFECT_ROMANIA = 8;
+
+uniform int u_Effect;
+uniform float u_Opacity;       // 0 passes the input through
+
+uniform sampler2D u_Input;
+layout(binding = 0) writeonly uniform image2D u_Output;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = textureSize(u_Input, 0);
+    if (texel.x >= size.x || texel.y >= size.y)
+        return;
+
+    vec2 uv = (vec2(texel) + 0.5) / vec2(size);
+    vec3 colour = texelFetch(u_Input, texel, 0).rgb;
+    vec3 result = colour;
+
+    if (u_Effect == EFFECT_INVERT)
+    {
+        result = 1.0 - colour;
+    }
+    else if (u_Effect == EFFECT_GREYSCALE)
+    {
+        result = vec3(dot(colour, vec3(0.299, 0.587, 0.114)));
+    }
+    else if (u_Effect == EFFECT_VENEZUELA)
+    {
+        result = uv.y < 0.33 ? vec3(1.0, 0.0, 0.0) : uv.y < 0.66 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 1.0, 0.0);
+    }
+    else if (u_Effect == EFFECT_ROMANIA)
+    {
+        result = uv.x < 0.33 ? vec3(0.0, 0.0, 1.0) : uv.x < 0.66 ? vec3(1.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    }
+
+    imageStore(u_Output, texel, vec4(mix(colour, result, u_Opacity), 1.0));
+}
@@ -0,0 +1,29 @@
+// Copies a texture to the screen on a full-screen quad; the last step of
+// PostProcessChain's output in testEffects.
+
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 3) in vec2 aTextureCoords;
+
+out vec2 v_TexCoords;
+
+void main()
+{
+    v_TexCoords = aTextureCoords;
+    gl_Position = vec4(aPosition, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+in vec2 v_TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D u_Texture;
+
+void main()
+{
+    FragColor = vec4(texture(u_Texture, v_TexCoords).rgb, 1.0);
+}
@@ -0,0 +1,62 @@
+// DynamicResolution's upscale (see DynamicResolution.h): stretches the
+// low-resolution target over the window. BILINEAR is one filtered fetch;
+// SHARPEN adds a contrast-adaptive sharpen of the bilinear result, which
+// sharpens low-contrast edges most and leaves strong ones alone, so it
+// does not ring around them.
+#variant FILTER=BILINEAR,SHARPEN
+
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 3) in vec2 aTextureCoords;
+
+out vec2 v_TexCoords;
+
+void main()
+{
+    v_TexCoords = aTextureCoords;
+    gl_Position = vec4(aPosition, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+in vec2 v_TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D u_Source;
+uniform vec2 u_SourceSize;
+uniform float u_Sharpness;     // 0..1
+
+// The Framebuffer's colour texture repeats; clamp to the edge texel
+// centres so the border never blends with the opposite side
+vec3 Fetch(vec2 uv)
+{
+    vec2 halfTexel = 0.5 / u_SourceSize;
+    return texture(u_Source, clamp(uv, halfTexel, 1.0 - halfTexel)).rgb;
+}
+
+void main()
+{
+    vec3 centre = Fetch(v_TexCoords);
+
+#if FILTER == FILTER_SHARPEN
+    vec2 texel = 1.0 / u_SourceSize;
+    vec3 north = Fetch(v_TexCoords + vec2(0.0, texel.y));
+    vec3 south = Fetch(v_TexCoords - vec2(0.0, texel.y));
+    vec3 east = Fetch(v_TexCoords + vec2(texel.x, 0.0));
+    vec3 west = Fetch(v_TexCoords - vec2(texel.x, 0.0));
+
+    // How far the neighbourhood is from clipping at 0 or 1 limits how
+    // much it can be sharpened
+    vec3 low = min(centre, min(min(north, south), min(east, west)));
+    vec3 high = max(centre, max(max(north, south), max(east, west)));
+    vec3 amount = sqrt(clamp(min(low, 1.0 - high) / max(high, 0.0001), 0.0, 1.0));
+    vec3 weight = -amount * mix(0.125, 0.2, u_Sharpness);
+
+    centre = clamp((centre + (north + south + east + west) * weight) / (1.0 + 4.0 * weight), 0.0, 1.0);
+#endif
+
+    FragColor = vec4(centre, 1.0);
+}
@@ -1,37 +1,86 @@
 #version 430 core
 
+// TestGPUParticles' simulation, one stage per dispatch (u_Stage). Only
+// live particles are touched: their slots are kept in an alive list, the
+// free slots in a dead list, and both are stacks pushed and popped with
+// atomics on the counters below. Per frame:
+//   STAGE_PREPARE   1 thread: clamp the requested emission to the free
+//                   slots and write the emit and simulate dispatch sizes
+//   STAGE_EMIT      indirect, one thread per new particle, of every
+//                   emitter at once: find its emitter, pop a dead slot,
+//                   spawn into it, push it on the alive list
+//   STAGE_SIMULATE  indirect, one thread per alive particle: step it
+//                   under its emitter's gravity, then push it on the
+//                   next alive list or back on the dead list
+//   STAGE_FINISH    1 thread: the next list becomes current, and its
+//                   count the particle draw's vertex count
+// STAGE_RESET fills the dead list with every slot below u_MaxParticles.
+
 layout(local_size_x = 256) in;
 
-struct Particle
+const int STAGE_RESET = 0;
+const int STAGE_PREPARE = 1;
+const int STAGE_EMIT = 2;
+const int STAGE_SIMULATE = 3;
+const int STAGE_FINISH = 4;
+
+#include "Include/Particles.glsl"
+
+layout(std430, binding = 1) buffer DeadList
+{
+    uint dead[];
+};
+
+// Emitted into and simulated from this frame, drawn from next
+layout(std430, binding = 2) buffer AliveList
 {
-    vec2 pos;
-    vec2 vel;
-    vec4 color;
-    float life;
-    float maxLife;
-    float size;
-    float _pad; // padding to align to 16 bytes
+    uint alive[];
 };
 
-layout(std430, binding = 0) buffer ParticleBuffer
+layout(std430, binding = 3) writeonly buffer NextAliveList
 {
-    Particle particles[];
+    uint nextAlive[];
 };
 
+// Mirrors GPUParticleCounters in TestGPUParticles.cpp. The argument
+// blocks are read by glDispatchComputeIndirect and glDrawArraysIndirect.
+layout(std430, binding = 4) buffer Counters
+{
+    uint deadCount;
+    uint aliveCount;
+    uint nextAliveCount;
+    uint emitCount;
+    uint emitArgs[3];
+    uint simulateArgs[3];
+    uint drawArgs[4];       // count, instanceCount, first, baseInstance
+};
+
+// The emitter table, as GPUEmitter in TestGPUParticles.cpp. Slots that
+// aren't emitting have a count of 0. The frame's emission ranges are
+// packed in table order: emitter e spawns new particles
+// [first, first + count) of the frame's u_EmitCount.
+const uint MAX_EMITTERS = 64u;  // the 6 emitter bits of a seed
+
+struct Emitter
+{
+    vec4 position;          // xy, z gravity
+    vec4 colorStart;
+    vec4 colorEnd;
+    vec4 speedLife;         // speed min, max, life min, max
+    vec4 size;              // min, max
+    uvec4 emission;         // first, count
+};
+
+layout(std140, binding = 2) uniform EmitterTable
+{
+    Emitter emitters[MAX_EMITTERS];
+};
+
+uniform int   u_Stage;
 uniform float u_DeltaTime;
-uniform float u_Gravity;
-uniform vec2  u_EmitterPos;
 uniform int   u_MaxParticles;
-uniform float u_Time;
-uniform float u_EmissionRate;
-uniform vec4  u_ColorStart;
-uniform vec4  u_ColorEnd;
-uniform float u_SpeedMin;
-uniform float u_SpeedMax;
-uniform float u_LifeMin;
-uniform float u_LifeMax;
-uniform float u_SizeMin;
-uniform float u_SizeMax;
+uniform int   u_EmitCount;      // requested this frame, by every emitter
+uniform int   u_Frame;
 
 // Hash-based PRNG
 uint hash(uint x)
@@ -54,59 +103,117 @@ float randRange(float lo, float hi, uint seed)
     return lo + randFloat(seed) * (hi - lo);
 }
 
-void main()
+uint groups(uint count)
 {
-    uint idx = gl_GlobalInvocationID.x;
-    if (idx >= uint(u_MaxParticles))
-        return;
+    return (count + gl_WorkGroupSize.x - 1u) / gl_WorkGroupSize.x;
+}
 
-    Particle p = particles[idx];
+// The emitter of the frame's i'th new particle: the first whose range
+// ends past i
+uint FindEmitter(uint i)
+{
+    uint lo = 0u;
+    uint hi = MAX_EMITTERS - 1u;
+    while (lo < hi)
+    {
+        uint mid = (lo + hi) / 2u;
+        if (emitters[mid].emission.x + emitters[mid].emission.y > i)
+            hi = mid;
+        else
+            lo = mid + 1u;
+    }
+    return lo;
+}
+
+void Emit(uint i)
+{
+    // PREPARE made sure there are at least emitCount dead slots. When it
+    // clamped, the last emitters' particles are the ones dropped.
+    uint slot = dead[atomicAdd(deadCount, 0xFFFFFFFFu) - 1u];
+    uint e = FindEmitter(i);
+    Emitter emitter = emitters[e];
+
+    uint seed = hash(i * 1973u + hash(uint(u_Frame)));
+    uint s0 = hash(seed + 1u);
+    uint s1 = hash(seed + 2u);
+    uint s2 = hash(seed + 3u);
+    uint s3 = hash(seed + 4u);
+    uint s4 = hash(seed + 5u);
+
+    Particle p;
+    p.pos = emitter.position.xy;
+    p.life = randRange(emitter.speedLife.z, emitter.speedLife.w, s0);
+    p.maxLife = p.life;
+    p.size = randRange(emitter.size.x, emitter.size.y, s1);
+
+    float angle = randRange(0.0, 6.28318530718, s2);
+    float speed = randRange(emitter.speedLife.x, emitter.speedLife.y, s3);
+    p.vel = vec2(cos(angle), sin(angle)) * speed;
+
+    // The colour comes from 10 bits of seed, which the packed layout
+    // keeps instead of the colour
+    p.seed = (e << 10u) | (s4 >> 22u);
+    p.color = mix(emitter.colorStart, emitter.colorEnd, ColourFraction(p));
+    StoreParticle(slot, p);
+
+    alive[atomicAdd(aliveCount, 1u)] = slot;
+}
+
+void Simulate(uint i)
+{
+    uint slot = alive[i];
+    Particle p = LoadParticle(slot);
 
+    p.life -= u_DeltaTime;
     if (p.life > 0.0)
     {
-        // Update living particle
-        p.life -= u_DeltaTime;
-
-        if (p.life > 0.0)
-        {
-            p.vel.y += u_Gravity * u_DeltaTime;
-            p.pos += p.vel * u_DeltaTime;
-        }
+        p.vel.y += emitters[EmitterOf(p)].position.z * u_DeltaTime;
+        p.pos += p.vel * u_DeltaTime;
+        StoreParticle(slot, p);
+        nextAlive[atomicAdd(nextAliveCount, 1u)] = slot;
     }
     else
     {
-        // Dead particle: probabilistic respawn based on emission rate
-        // Expected spawns this frame = emissionRate * dt
-        // Probability per dead particle ≈ (emissionRate * dt) / maxParticles
-        float spawnChance = (u_EmissionRate * u_DeltaTime) / float(u_MaxParticles);
-
-        // Generate a random value for this particle
-        uint seed = hash(idx * 1973u + uint(u_Time * 6547.0));
-        float roll = randFloat(seed);
-
-        if (roll < spawnChance)
-        {
-            // Respawn particle
-            uint s0 = hash(seed + 1u);
-            uint s1 = hash(seed + 2u);
-            uint s2 = hash(seed + 3u);
-            uint s3 = hash(seed + 4u);
-            uint s4 = hash(seed + 5u);
-            uint s5 = hash(seed + 6u);
-
-            p.pos = u_EmitterPos;
-            p.life = randRange(u_LifeMin, u_LifeMax, s0);
-            p.maxLife = p.life;
-            p.size = randRange(u_SizeMin, u_SizeMax, s1);
-
-            float angle = randRange(0.0, 6.28318530718, s2);
-            float speed = randRange(u_SpeedMin, u_SpeedMax, s3);
-            p.vel = vec2(cos(angle), sin(angle)) * speed;
-
-            float t = randFloat(s4);
-            p.color = mix(u_ColorStart, u_ColorEnd, t);
-        }
+        p.life = 0.0;
+        StoreParticle(slot, p);
+        dead[atomicAdd(deadCount, 1u)] = slot;
     }
+}
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
 
-    particles[idx] = p;
+    if (u_Stage == STAGE_RESET)
+    {
+        if (i < uint(u_MaxParticles))
+            dead[i] = i;
+    }
+    else if (u_Stage == STAGE_PREPARE)
+    {
+        if (i != 0u)
+            return;
+        emitCount = min(uint(u_EmitCount), deadCount);
+        emitArgs[0] = groups(emitCount);
+        // The new particles are simulated this frame too
+        simulateArgs[0] = groups(aliveCount + emitCount);
+        nextAliveCount = 0u;
+    }
+    else if (u_Stage == STAGE_EMIT)
+    {
+        if (i < emitCount)
+            Emit(i);
+    }
+    else if (u_Stage == STAGE_SIMULATE)
+    {
+        if (i < aliveCount)
+            Simulate(i);
+    }
+    else if (u_Stage == STAGE_FINISH)
+    {
+        if (i != 0u)
+            return;
+        aliveCount = nextAliveCount;
+        drawArgs[0] = aliveCount;
+    }
 }
@@ -0,0 +1,260 @@
+#version 430 core
+
+// TestGPUParticles' optional interaction step, run on the alive list
+// after GPUParticleCompute.glsl's FINISH. A uniform grid of u_CellSize
+// cells over the view is rebuilt every frame by counting sort, then each
+// particle is pushed apart from the neighbours in its 3x3 cells and out
+// of the scene SDF. Nothing comes back to the CPU.
+//   GRID_CLEAR    one invocation per cell: zero the counts
+//   GRID_COUNT    one per alive particle: find its cell, take a place in
+//                 it with an atomic increment
+//   GRID_SCAN     one work group: exclusive prefix sum of the counts into
+//                 each cell's first entry, plus the occupancy statistics
+//   GRID_SCATTER  one per alive particle: write its position and slot to
+//                 its cell's range, so a cell's particles are contiguous
+//   GRID_INTERACT one per alive particle: separation from neighbours
+//                 closer than u_Radius, then collision with the SDF
+// Particles outside the view are binned into the nearest edge cell.
+
+layout(local_size_x = 256) in;
+
+const int GRID_CLEAR = 0;
+const int GRID_COUNT = 1;
+const int GRID_SCAN = 2;
+const int GRID_SCATTER = 3;
+const int GRID_INTERACT = 4;
+
+// Neighbours looked at per particle, at most: at the emitter thousands of
+// particles can share one cell
+const uint MAX_NEIGHBOURS = 32u;
+
+#include "Include/Particles.glsl"
+
+layout(std430, binding = 2) readonly buffer AliveList
+{
+    uint alive[];
+};
+
+layout(std430, binding = 4) readonly buffer Counters
+{
+    uint deadCount;
+    uint aliveCount;
+};
+
+// Mirrors GPUParticleGrid in TestGPUParticles.cpp: statistics, then per
+// cell its count and first entry
+layout(std430, binding = 5) buffer Cells
+{
+    uint occupiedCells;
+    uint maxPerCell;
+    uint _statsPad[2];
+    uvec2 cells[];          // count, start
+};
+
+// Per alive index: its cell and its place in the cell
+layout(std430, binding = 6) buffer ParticleCells
+{
+    uvec2 particleCells[];
+};
+
+// A particle's position at the last rebuild, so the neighbour loop reads
+// one 16-byte entry instead of decoding the packed particle
+struct GridEntry
+{
+    vec2 pos;
+    uint slot;
+    uint _pad;
+};
+
+layout(std430, binding = 7) buffer Grid
+{
+    GridEntry grid[];
+};
+
+uniform int   u_Stage;
+uniform float u_CellSize;
+uniform int   u_GridWidth;      // cells across
+uniform int   u_GridHeight;     // and up
+uniform float u_DeltaTime;
+uniform float u_Radius;         // separation distance, at most u_CellSize
+uniform float u_Repulsion;      // acceleration at zero distance
+uniform float u_Restitution;
+uniform float u_Floor;          // SDF scene: the ground...
+uniform vec2  u_ObstaclePos;    // ...and one circle
+uniform float u_ObstacleRadius;
+
+shared uint s_Partial[gl_WorkGroupSize.x];
+shared uint s_Occupied;
+shared uint s_Max;
+
+ivec2 GridSize()
+{
+    return ivec2(u_GridWidth, u_GridHeight);
+}
+
+ivec2 CellOf(vec2 pos)
+{
+    return clamp(ivec2(floor(pos / u_CellSize)), ivec2(0), GridSize() - 1);
+}
+
+uint CellIndex(ivec2 cell)
+{
+    return uint(cell.y * u_GridWidth + cell.x);
+}
+
+// Signed distance to the scene, and its gradient (the outward normal)
+float SceneSDF(vec2 p, out vec2 normal)
+{
+    float ground = p.y - u_Floor;
+    vec2 offset = p - u_ObstaclePos;
+    float circle = length(offset) - u_ObstacleRadius;
+    if (ground < circle)
+    {
+        normal = vec2(0.0, 1.0);
+        return ground;
+    }
+    normal = circle > -u_ObstacleRadius ? normalize(offset) : vec2(0.0, 1.0);
+    return circle;
+}
+
+void Scan()
+{
+    uint t = gl_LocalInvocationID.x;
+    uint total = uint(u_GridWidth * u_GridHeight);
+    uint chunk = (total + gl_WorkGroupSize.x - 1u) / gl_WorkGroupSize.x;
+    uint begin = min(t * chunk, total);
+    uint end = min(begin + chunk, total);
+
+    if (t == 0u)
+    {
+        s_Occupied = 0u;
+        s_Max = 0u;
+    }
+    barrier();
+
+    // Each invocation totals its run of cells...
+    uint sum = 0u;
+    uint occupied = 0u;
+    uint largest = 0u;
+    for (uint c = begin; c < end; c++)
+    {
+        uint count = cells[c].x;
+        sum += count;
+        occupied += count > 0u ? 1u : 0u;
+        largest = max(largest, count);
+    }
+    s_Partial[t] = sum;
+    atomicAdd(s_Occupied, occupied);
+    atomicMax(s_Max, largest);
+    memoryBarrierShared();
+    barrier();
+
+    // ...the runs are scanned (Hillis-Steele, inclusive)...
+    for (uint offset = 1u; offset < gl_WorkGroupSize.x; offset <<= 1u)
+    {
+        uint add = t >= offset ? s_Partial[t - offset] : 0u;
+        barrier();
+        s_Partial[t] += add;
+        memoryBarrierShared();
+        barrier();
+    }
+
+    // ...and each writes its cells' starts from where its run begins
+    uint start = s_Partial[t] - sum;
+    for (uint c = begin; c < end; c++)
+    {
+        cells[c].y = start;
+        start += cells[c].x;
+    }
+
+    if (t == 0u)
+    {
+        occupiedCells = s_Occupied;
+        maxPerCell = s_Max;
+    }
+}
+
+void Interact(uint i)
+{
+    uint slot = alive[i];
+    Particle p = LoadParticle(slot);
+
+    // Separation: a push away from each close neighbour, stronger the
+    // closer it is
+    vec2 push = vec2(0.0);
+    ivec2 home = CellOf(p.pos);
+    uint looked = 0u;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            ivec2 cell = home + ivec2(x, y);
+            if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, GridSize())))
+                continue;
+            uvec2 range = cells[CellIndex(cell)];
+            for (uint e = range.y; e < range.y + range.x && looked < MAX_NEIGHBOURS; e++)
+            {
+                GridEntry neighbour = grid[e];
+                if (neighbour.slot == slot)
+                    continue;
+                looked++;
+                vec2 away = p.pos - neighbour.pos;
+                float d = length(away);
+                if (d > 0.0001 && d < u_Radius)
+                    push += away / d * (1.0 - d / u_Radius);
+            }
+        }
+    }
+    p.vel += push * u_Repulsion * u_DeltaTime;
+
+    // Collision: out of the scene along its normal, and bounce what of
+    // the velocity points into it
+    vec2 normal;
+    float distance = SceneSDF(p.pos, normal);
+    if (distance < 0.0)
+    {
+        p.pos -= normal * distance;
+        float into = dot(p.vel, normal);
+        if (into < 0.0)
+            p.vel -= (1.0 + u_Restitution) * into * normal;
+    }
+
+    StoreParticle(slot, p);
+}
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+
+    if (u_Stage == GRID_CLEAR)
+    {
+        if (i < uint(u_GridWidth * u_GridHeight))
+            cells[i] = uvec2(0u);
+    }
+    else if (u_Stage == GRID_COUNT)
+    {
+        if (i < aliveCount)
+        {
+            uint cell = CellIndex(CellOf(LoadParticle(alive[i]).pos));
+            particleCells[i] = uvec2(cell, atomicAdd(cells[cell].x, 1u));
+        }
+    }
+    else if (u_Stage == GRID_SCAN)
+    {
+        Scan();
+    }
+    else if (u_Stage == GRID_SCATTER)
+    {
+        if (i < aliveCount)
+        {
+            uvec2 place = particleCells[i];
+            uint slot = alive[i];
+            grid[cells[place.x].y + place.y] = GridEntry(LoadParticle(slot).pos, slot, 0u);
+        }
+    }
+    else if (u_Stage == GRID_INTERACT)
+    {
+        if (i < aliveCount)
+            Interact(i);
+    }
+}
@@ -1,20 +1,32 @@
 #shader vertex
 #version 430 core
 
-struct Particle
+#define PARTICLES_READONLY
+#include "Include/Particles.glsl"
+
+// The slots of the live particles; the draw's vertex count is their count
+layout(std430, binding = 2) readonly buffer AliveList
+{
+    uint alive[];
+};
+
+// The emitter table, as in GPUParticleCompute.glsl: the packed layout's
+// colours come from it
+const uint MAX_EMITTERS = 64u;  // the 6 emitter bits of a seed
+
+struct Emitter
 {
-    vec2 pos;
-    vec2 vel;
-    vec4 color;
-    float life;
-    float maxLife;
-    float size;
-    float _pad;
+    vec4 position;          // xy, z gravity
+    vec4 colorStart;
+    vec4 colorEnd;
+    vec4 speedLife;         // speed min, max, life min, max
+    vec4 size;              // min, max
+    uvec4 emission;         // first, count
 };
 
-layout(std430, binding = 0) buffer ParticleBuffer
+layout(std140, binding = 2) uniform EmitterTable
 {
-    Particle particles[];
+    Emitter emitters[MAX_EMITTERS];
 };
 
 uniform mat4 u_MVP;
@@ -25,22 +37,19 @@ out float v_MaxLife;
 
 void main()
 {
-    Particle p = particles[gl_VertexID];
-
-    // Dead particles get placed offscreen
-    if (p.life <= 0.0)
-    {
-        gl_Position = vec4(-9999.0, -9999.0, 0.0, 1.0);
-        gl_PointSize = 0.0;
-        v_Color = vec4(0.0);
-        v_Life = 0.0;
-        v_MaxLife = 1.0;
-        return;
-    }
+    Particle p = LoadParticle(alive[gl_VertexID]);
 
     gl_Position = u_MVP * vec4(p.pos, 0.0, 1.0);
     gl_PointSize = p.size;
-    v_Color = p.color;
+    if (u_PackedLayout != 0)
+    {
+        Emitter emitter = emitters[EmitterOf(p)];
+        v_Color = mix(emitter.colorStart, emitter.colorEnd, ColourFraction(p));
+    }
+    else
+    {
+        v_Color = p.color;
+    }
     v_Life = p.life;
     v_MaxLife = p.maxLife;
 }
@@ -69,5 +78,8 @@ void main()
     // Fade based on remaining life
     float lifeRatio = v_Life / v_MaxLife;
 
-    fragColor = vec4(v_Color.rgb, v_Color.a * alpha * lifeRatio);
+    // Premultiplied, for both blend modes: GL_ONE, GL_ONE adds it and
+    // GL_ONE, GL_ONE_MINUS_SRC_ALPHA composites it over what's behind
+    float a = v_Color.a * alpha * lifeRatio;
+    fragColor = vec4(v_Color.rgb * a, a);
 }
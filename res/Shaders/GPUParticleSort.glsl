@@ -0,0 +1,163 @@
+#version 430 core
+
+// TestGPUParticles' back-to-front sort: a bitonic sort of the alive list
+// (GPUParticleCompute.glsl) by age, oldest first, so alpha-blended
+// particles composite in a stable, correct order. The sort covers a
+// power of two of entries, at least BLOCK; those past the alive count are
+// padding that sorts to the end. The values buffer ends up holding the alive slots in
+// draw order and stands in for the alive list in the render.
+//   SORT_LOCAL   each work group loads BLOCK elements and sorts them in
+//                shared memory: every (k, j) pass with k <= BLOCK
+//   SORT_GLOBAL  one (u_K, u_J) compare-and-swap pass through memory,
+//                for the pass distances j >= BLOCK
+//   SORT_MERGE   the remaining j < BLOCK passes of a u_K, in shared memory
+// Elements are compared by key, then by slot, so equal ages keep the same
+// order from frame to frame.
+
+layout(local_size_x = 256) in;
+
+const int SORT_LOCAL = 0;
+const int SORT_GLOBAL = 1;
+const int SORT_MERGE = 2;
+
+const uint BLOCK = 512u;        // two elements per invocation
+const uint PADDING = 0xFFFFFFFFu;
+
+#define PARTICLES_READONLY
+#include "Include/Particles.glsl"
+
+layout(std430, binding = 2) readonly buffer AliveList
+{
+    uint alive[];
+};
+
+layout(std430, binding = 4) readonly buffer Counters
+{
+    uint deadCount;
+    uint aliveCount;
+};
+
+layout(std430, binding = 5) buffer SortKeys
+{
+    uint keys[];
+};
+
+layout(std430, binding = 6) buffer SortValues
+{
+    uint values[];
+};
+
+uniform int u_Stage;
+uniform int u_K;
+uniform int u_J;
+
+shared uint s_Keys[BLOCK];
+shared uint s_Values[BLOCK];
+
+bool Greater(uint keyA, uint valueA, uint keyB, uint valueB)
+{
+    return keyA > keyB || (keyA == keyB && valueA > valueB);
+}
+
+// The lower element of invocation t's pair, for pass distance j
+uint PairIndex(uint t, uint j)
+{
+    return ((t & ~(j - 1u)) << 1u) | (t & (j - 1u));
+}
+
+// The key of alive entry i: age as float bits (which order like the
+// floats for positive values), inverted so the oldest sorts first
+void LoadAlive(uint i, out uint key, out uint value)
+{
+    if (i < aliveCount)
+    {
+        value = alive[i];
+        Particle p = LoadParticle(value);
+        key = ~floatBitsToUint(max(p.maxLife - p.life, 0.0));
+    }
+    else
+    {
+        key = PADDING;
+        value = PADDING;
+    }
+}
+
+// Every pass of k with j from `j` down to 1, on this group's block in
+// shared memory. Directions come from the global index, as in a global pass.
+void SortShared(uint base, uint k, uint j)
+{
+    uint t = gl_LocalInvocationID.x;
+    for (; j > 0u; j >>= 1u)
+    {
+        memoryBarrierShared();
+        barrier();
+
+        uint i = PairIndex(t, j);
+        uint l = i + j;
+        bool ascending = ((base + i) & k) == 0u;
+        if (Greater(s_Keys[i], s_Values[i], s_Keys[l], s_Values[l]) == ascending)
+        {
+            uint key = s_Keys[i];
+            uint value = s_Values[i];
+            s_Keys[i] = s_Keys[l];
+            s_Values[i] = s_Values[l];
+            s_Keys[l] = key;
+            s_Values[l] = value;
+        }
+    }
+    memoryBarrierShared();
+    barrier();
+}
+
+void main()
+{
+    uint t = gl_LocalInvocationID.x;
+    uint base = gl_WorkGroupID.x * BLOCK;
+
+    if (u_Stage == SORT_GLOBAL)
+    {
+        uint i = PairIndex(gl_GlobalInvocationID.x, uint(u_J));
+        uint l = i + uint(u_J);
+        bool ascending = (i & uint(u_K)) == 0u;
+        uint keyI = keys[i], keyL = keys[l];
+        uint valueI = values[i], valueL = values[l];
+        if (Greater(keyI, valueI, keyL, valueL) == ascending)
+        {
+            keys[i] = keyL;
+            values[i] = valueL;
+            keys[l] = keyI;
+            values[l] = valueI;
+        }
+        return;
+    }
+
+    // Both shared-memory stages work on this group's block
+    for (uint e = t; e < BLOCK; e += gl_WorkGroupSize.x)
+    {
+        if (u_Stage == SORT_LOCAL)
+        {
+            LoadAlive(base + e, s_Keys[e], s_Values[e]);
+        }
+        else
+        {
+            s_Keys[e] = keys[base + e];
+            s_Values[e] = values[base + e];
+        }
+    }
+
+    if (u_Stage == SORT_LOCAL)
+    {
+        for (uint k = 2u; k <= BLOCK; k <<= 1u)
+            SortShared(base, k, k >> 1u);
+    }
+    else
+    {
+        SortShared(base, uint(u_K), BLOCK >> 1u);
+    }
+
+    for (uint e = t; e < BLOCK; e += gl_WorkGroupSize.x)
+    {
+        keys[base + e] = s_Keys[e];
+        values[base + e] = s_Values[e];
+    }
+}
@@ -0,0 +1,15 @@
+// Amortized rendering for the art shaders (see testProceduralArt): the
+// modes shade a subset of the pixels each frame into a smaller target, and
+// PixelCoord is the full-resolution pixel a fragment of it stands for
+//   u_AmortizeMode 0: every pixel, 1: checkerboard, 2: one in each 2x2
+uniform int u_AmortizeMode;
+uniform int u_AmortizePhase;
+
+vec2 PixelCoord() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    if (u_AmortizeMode == 1)
+        p.x = 2 * p.x + ((p.y + u_AmortizePhase) & 1);
+    else if (u_AmortizeMode == 2)
+        p = 2 * p + ivec2(u_AmortizePhase & 1, u_AmortizePhase >> 1);
+    return vec2(p) + 0.5;
+}
@@ -0,0 +1,43 @@
+// ClusterOffset reads u_View
+#include "FrameData.glsl"
+
+// Per-cluster light lists built by ClusteredLights (see ClusteredLights.h):
+// cluster c's count at c * (u_ClusterCapacity + 1), then its light indices.
+// The count is of every light touching the cluster, so it can exceed the
+// u_ClusterCapacity indices stored: loop over ClusterStored(count).
+layout(std430, binding = 7) readonly buffer ClusterBuffer {
+    uint uClusterLights[];
+};
+uniform vec3 u_ClusterGrid;      // tiles x, tiles y, depth slices
+uniform vec2 u_ClusterDepth;     // view distances the slices span
+uniform vec2 u_ClusterViewport;  // pixels
+uniform int u_ClusterCapacity;
+
+// How many of `count` lights have their index in the list
+uint ClusterStored(uint count)
+{
+    return min(count, uint(u_ClusterCapacity));
+}
+
+// Where this fragment's cluster list starts
+uint ClusterOffset(vec3 worldPos)
+{
+    ivec3 grid = ivec3(u_ClusterGrid);
+    float depth = max(-(u_View * vec4(worldPos, 1.0)).z, u_ClusterDepth.x);
+    int slice = int(log(depth / u_ClusterDepth.x) / log(u_ClusterDepth.y / u_ClusterDepth.x) * u_ClusterGrid.z);
+    ivec2 tile = ivec2(gl_FragCoord.xy / u_ClusterViewport * u_ClusterGrid.xy);
+    ivec3 cell = clamp(ivec3(tile, slice), ivec3(0), grid - 1);
+    return uint((cell.x + grid.x * (cell.y + grid.y * cell.z)) * (u_ClusterCapacity + 1));
+}
+
+// Blue (few lights) through green to red (many), log scaled; magenta when
+// more lights touch the cluster than it holds and some were dropped. A
+// cluster exactly full dropped none, so it stays red.
+vec3 ClusterHeat(uint count)
+{
+    if (count > uint(u_ClusterCapacity))
+        return vec3(1.0, 0.0, 1.0);
+    float t = log2(1.0 + float(count)) / log2(1.0 + float(u_ClusterCapacity));
+    return t < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), t * 2.0)
+        : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), t * 2.0 - 1.0);
+}
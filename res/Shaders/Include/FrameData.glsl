@@ -0,0 +1,10 @@
+// Per-frame camera data shared by every shader, filled once per frame
+// by FrameUniforms (see FrameUniforms.h)
+layout(std140) uniform FrameData
+{
+    mat4 u_View;
+    mat4 u_Projection;
+    mat4 u_ViewProjection;
+    vec4 u_ViewPosition;    // xyz = camera position in world space
+    vec4 u_Time;            // x = seconds since start, y = frame delta
+};
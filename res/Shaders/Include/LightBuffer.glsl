@@ -0,0 +1,23 @@
+// The LightList's lights, matching GPULight in LightList.h. Scalars ride in
+// the w components so the std430 layout is four plain vec4s. The array has
+// no compile-time size; how many are in use is the including shader's
+// business (uLightCount, or a cluster's list). GLSL 4.30.
+struct BufferLight {
+    vec4 position;     // xyz, w = type (0 = point, 1 = directional, 2 = spotlight)
+    vec4 direction;    // xyz, w = spotlight cutoff (cosine)
+    vec4 colour;       // rgb, a = intensity
+    vec4 range;        // x = radius of influence, 0 = unbounded
+};
+layout(std430, binding = 1) readonly buffer LightBuffer {
+    BufferLight uLights[];
+};
+
+// 1 inside a bounded light's range, easing to 0 at it; 1 everywhere when unbounded
+float RangeFalloff(float distance, float range)
+{
+    if (range <= 0.0)
+        return 1.0;
+    float x = distance / range;
+    float window = clamp(1.0 - x * x * x * x, 0.0, 1.0);
+    return window * window;
+}
@@ -0,0 +1,97 @@
+// TestGPUParticles' particle storage, shared by its four shaders. Both
+// layouts go through one block; u_PackedLayout (TestGPUParticles' toggle)
+// picks how a slot is stored:
+//   full    48 bytes, three uvec4s: float pos and vel, colour, then
+//           life, maxLife, size and the seed
+//   packed  16 bytes, one uvec4: 16-bit fixed-point position over
+//           POS_MIN + POS_RANGE (a view's size beyond each edge), half
+//           velocity, life as a 16-bit fraction of a half maxLife, half
+//           size and the seed. The colour is not stored; the render
+//           derives it from the seed and the emitter, as EMIT does
+// A stage that only reads particles defines PARTICLES_READONLY before
+// including this: the buffer is then readonly, without StoreParticle.
+struct Particle
+{
+    vec2 pos;
+    vec2 vel;
+    vec4 color;             // full layout only
+    float life;
+    float maxLife;
+    float size;
+    uint seed;              // 16 bits: the emitter, then 10 of colour
+};
+
+#ifdef PARTICLES_READONLY
+layout(std430, binding = 0) readonly buffer ParticleBuffer
+#else
+layout(std430, binding = 0) buffer ParticleBuffer
+#endif
+{
+    uvec4 particleData[];
+};
+
+uniform int u_PackedLayout;
+
+const vec2 POS_MIN = vec2(-960.0, -540.0);
+const vec2 POS_RANGE = vec2(2880.0, 1620.0);
+
+uint EmitterOf(Particle p)
+{
+    return p.seed >> 10u;
+}
+
+float ColourFraction(Particle p)
+{
+    return float(p.seed & 1023u) / 1023.0;
+}
+
+Particle LoadParticle(uint slot)
+{
+    Particle p;
+    if (u_PackedLayout != 0)
+    {
+        uvec4 d = particleData[slot];
+        p.pos = POS_MIN + unpackUnorm2x16(d.x) * POS_RANGE;
+        p.vel = unpackHalf2x16(d.y);
+        p.maxLife = unpackHalf2x16(d.z).y;
+        p.life = unpackUnorm2x16(d.z).x * p.maxLife;
+        p.size = unpackHalf2x16(d.w).x;
+        p.seed = d.w >> 16u;
+        p.color = vec4(0.0);
+    }
+    else
+    {
+        uvec4 motion = particleData[slot * 3u];
+        uvec4 rest = particleData[slot * 3u + 2u];
+        p.pos = uintBitsToFloat(motion.xy);
+        p.vel = uintBitsToFloat(motion.zw);
+        p.color = uintBitsToFloat(particleData[slot * 3u + 1u]);
+        p.life = uintBitsToFloat(rest.x);
+        p.maxLife = uintBitsToFloat(rest.y);
+        p.size = uintBitsToFloat(rest.z);
+        p.seed = rest.w;
+    }
+    return p;
+}
+
+
+#ifndef PARTICLES_READONLY
+void StoreParticle(uint slot, Particle p)
+{
+    if (u_PackedLayout != 0)
+    {
+        // Dead particles are life 0: the fraction rounds down to exactly 0
+        vec2 pos = clamp((p.pos - POS_MIN) / POS_RANGE, 0.0, 1.0);
+        float life = clamp(p.life / p.maxLife, 0.0, 1.0);
+        particleData[slot] = uvec4(packUnorm2x16(pos), packHalf2x16(p.vel),
+            packUnorm2x16(vec2(life, 0.0)) | packHalf2x16(vec2(0.0, p.maxLife)),
+            (packHalf2x16(vec2(p.size, 0.0)) & 0xFFFFu) | (p.seed << 16u));
+    }
+    else
+    {
+        particleData[slot * 3u] = floatBitsToUint(vec4(p.pos, p.vel));
+        particleData[slot * 3u + 1u] = floatBitsToUint(p.color);
+        particleData[slot * 3u + 2u] = uvec4(floatBitsToUint(p.life), floatBitsToUint(p.maxLife), floatBitsToUint(p.size), p.seed);
+    }
+}
+#endif
@@ -0,0 +1,24 @@
+// The diffuse and specular factors of the Phong family, for one light.
+// norm is the unit surface normal; lightDir and viewDir are unit vectors
+// from the surface towards the light and the camera. Each factor scales
+// its intensity and the light's colour.
+
+// Lambert's cosine law: max(0, N . L)
+float LambertDiffuse(vec3 norm, vec3 lightDir)
+{
+    return max(dot(norm, lightDir), 0.0);
+}
+
+// Phong: max(0, R . V)^s, with R = reflect(-L, N) = 2(N . L)N - L
+float PhongSpecular(vec3 norm, vec3 lightDir, vec3 viewDir, float shininess)
+{
+    vec3 reflectDir = reflect(-lightDir, norm);
+    return pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+}
+
+// Blinn-Phong: max(0, N . H)^s, with the halfway vector H = normalize(L + V)
+float BlinnPhongSpecular(vec3 norm, vec3 lightDir, vec3 viewDir, float shininess)
+{
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    return pow(max(dot(norm, halfwayDir), 0.0), shininess);
+}
@@ -0,0 +1,41 @@
+// Vertex pulling (see MeshArena.h) for the PULL variants, included under
+// #if PULL != PULL_OFF with the attribute declarations in its #else. No
+// attributes: the arena's buffers are read as storage, and gl_VertexID is
+// the position in its index buffer. PullVertex, called first in main,
+// fills the attribute names, decoding Vertex for PULL_STANDARD and
+// PackedVertex for PULL_PACKED. GLSL 4.30.
+layout(std430, binding = 8) readonly buffer ArenaVertices
+{
+    uint vertexWords[];
+};
+layout(std430, binding = 9) readonly buffer ArenaIndices
+{
+    uint arenaIndices[];
+};
+uniform int u_BaseVertex;
+
+vec3 aPosition;
+vec3 aNormal;
+vec3 aColour;
+vec2 aTexCoords;
+
+void PullVertex()
+{
+    uint index = uint(u_BaseVertex) + arenaIndices[gl_VertexID];
+#if PULL == PULL_STANDARD
+    // Vertex: 11 floats
+    uint w = index * 11u;
+    aPosition  = uintBitsToFloat(uvec3(vertexWords[w], vertexWords[w + 1u], vertexWords[w + 2u]));
+    aNormal    = uintBitsToFloat(uvec3(vertexWords[w + 3u], vertexWords[w + 4u], vertexWords[w + 5u]));
+    aColour    = uintBitsToFloat(uvec3(vertexWords[w + 6u], vertexWords[w + 7u], vertexWords[w + 8u]));
+    aTexCoords = uintBitsToFloat(uvec2(vertexWords[w + 9u], vertexWords[w + 10u]));
+#else
+    // PackedVertex: 6 words, decoded as the attribute fetch would
+    uint w = index * 6u;
+    aPosition  = uintBitsToFloat(uvec3(vertexWords[w], vertexWords[w + 1u], vertexWords[w + 2u]));
+    int n = int(vertexWords[w + 3u]);
+    aNormal    = max(vec3(ivec3(n << 22, n << 12, n << 2) >> 22) / 511.0, -1.0);   // snorm 10:10:10
+    aColour    = unpackUnorm4x8(vertexWords[w + 4u]).rgb;
+    aTexCoords = unpackHalf2x16(vertexWords[w + 5u]);
+#endif
+}
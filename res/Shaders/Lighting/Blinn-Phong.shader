@@ -1,3 +1,8 @@
+// LIGHTS=SINGLE lights with u_Light alone. CLUSTERED instead loops over the
+// LightList lights in the fragment's cluster (see ClusteredLights.h), and
+// CLUSTER_HEATMAP tints that result by the cluster's light count.
+#variant LIGHTS=SINGLE,CLUSTERED,CLUSTER_HEATMAP
+
 #shader vertex // Specifies the vertex shader section
 #version 330 core // Using GLSL version 3.30, compatible with OpenGL 3.3
 
@@ -6,12 +11,15 @@ layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+#include "../Include/FrameData.glsl"
 
 out vec3 FragPos;
 out vec3 Normal;
 
+// Matches DepthPrepass.shader, so the depth written by RenderQueue's
+// depth pre-pass is the depth this draws at
+invariant gl_Position;
+
 void main()
 {
     // Transform vertex position to world space:
@@ -32,12 +40,12 @@ void main()
     // Transform to clip space:
     // The final vertex position is projected onto screen space using
     // the Model-View-Projection (MVP) transformation.
-    gl_Position = u_Projection * u_View * vec4(FragPos, 1.0);
+    gl_Position = u_Projection * (u_View * vec4(FragPos, 1.0));
 };
 
 
 #shader fragment // Specifies the fragment shader section
-#version 330 core // Using GLSL version 3.30, compatible with OpenGL 3.3
+#version 430 core // GLSL 4.30: the clustered variants read storage buffers
 
 
 struct Light
@@ -47,7 +55,7 @@ struct Light
 };
 
 uniform Light u_Light;
-uniform vec3 u_CameraPosition; //camera in world space
+#include "../Include/FrameData.glsl"
 
 
 //Phong Lighting paramaters
@@ -56,13 +64,64 @@ uniform float u_DiffuseIntensity;
 uniform float u_SpecularIntensity;
 uniform float u_Shininess;
 
+#if LIGHTS != LIGHTS_SINGLE
+// The LightList's lights, and the per-cluster lists of them, for the
+// clustered variants
+#include "../Include/LightBuffer.glsl"
+#include "../Include/Clusters.glsl"
+#endif
+
+#include "../Include/Phong.glsl"
+
 in vec3 FragPos;
 in vec3 Normal;
 
 out vec4 FragColor;
 
+#if LIGHTS != LIGHTS_SINGLE
+// The same Blinn-Phong terms for each light of the cluster, with its
+// intensity, range and spot cone
+vec3 ClusteredLighting(vec3 norm, vec3 viewDir, out uint lightCount)
+{
+    uint cluster = ClusterOffset(FragPos);
+    lightCount = uClusterLights[cluster];
+
+    vec3 result = vec3(0.0);
+    for (uint n = 0u; n < ClusterStored(lightCount); n++)
+    {
+        BufferLight light = uLights[uClusterLights[cluster + 1u + n]];
+        int type = int(light.position.w);
+        vec3 lightDir = type == 1 ? normalize(-light.direction.xyz) : normalize(light.position.xyz - FragPos);
+
+        vec3 ambient = u_AmbientIntensity * light.colour.rgb;
+        vec3 diffuse = u_DiffuseIntensity * LambertDiffuse(norm, lightDir) * light.colour.rgb;
+        vec3 specular = u_SpecularIntensity * BlinnPhongSpecular(norm, lightDir, viewDir, u_Shininess) * light.colour.rgb;
+
+        if (type == 2)
+        {
+            float theta = dot(lightDir, normalize(-light.direction.xyz));
+            float cone = theta > light.direction.w ? (theta - light.direction.w) / (1.0 - light.direction.w) : 0.0;
+            diffuse *= cone;
+            specular *= cone;
+        }
+
+        float reach = type == 1 ? 1.0 : RangeFalloff(length(light.position.xyz - FragPos), light.range.x);
+        result += (ambient + diffuse + specular) * light.colour.a * reach;
+    }
+    return result;
+}
+#endif
+
 void main()
 {
+#if LIGHTS != LIGHTS_SINGLE
+    uint lightCount;
+    vec3 lit = ClusteredLighting(normalize(Normal), normalize(u_ViewPosition.xyz - FragPos), lightCount);
+#if LIGHTS == LIGHTS_CLUSTER_HEATMAP
+    lit = mix(lit, ClusterHeat(lightCount), 0.6);
+#endif
+    FragColor = vec4(lit, 1.0);
+#else
     // ================================
     // Ambient Lighting Calculation
     // ================================
@@ -88,7 +147,7 @@ void main()
     // - max(0, N  L) ensures that the light does not contribute negatively
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(u_Light.Position - FragPos); //direction from the fragment to the light
-    float diff = max(dot(norm, lightDir),0.0); //Lambertian Reflectance aka Cosine of angle
+    float diff = LambertDiffuse(norm, lightDir); //Lambertian Reflectance aka Cosine of angle
     vec3 diffuse = u_DiffuseIntensity * diff * u_Light.Colour;  
     
 
@@ -97,9 +156,8 @@ void main()
     // ================================
     // Instead of using the reflection vector R, we calculate the halfway vector H:
     // H = normalize(L + V)
-    vec3 viewDir = normalize(u_CameraPosition - FragPos);
-    vec3 halfwayDir = normalize(lightDir + viewDir); //compute the halfway vecteor
-    float spec = pow(max(dot(norm, halfwayDir), 0.0), u_Shininess);
+    vec3 viewDir = normalize(u_ViewPosition.xyz - FragPos);
+    float spec = BlinnPhongSpecular(norm, lightDir, viewDir, u_Shininess);
     vec3 specular = u_SpecularIntensity * spec * u_Light.Colour;
 
     // ================================
@@ -109,4 +167,5 @@ void main()
     // I = I_a + I_d + I_s
     vec3 result = ambient + diffuse + specular;
     FragColor = vec4(result, 1.0f);
+#endif
 }
@@ -0,0 +1,110 @@
+// Lighting pass of DeferredShading: a full-screen quad that reads the
+// G-buffer and runs PhongMultiple.shader's light loop once per pixel, so
+// overdrawn fragments and empty background cost nothing however many lights
+// there are. World position comes back from the depth buffer through the
+// inverse view-projection, rather than taking a render target of its own.
+//
+// OUTPUT shows the lit result or one of the G-buffer's contents.
+#variant OUTPUT=LIT,ALBEDO,NORMAL,POSITION
+
+#shader vertex
+#version 430 core
+
+layout(location = 0) in vec3 aPosition;
+
+void main()
+{
+    gl_Position = vec4(aPosition, 1.0);
+}
+
+
+#shader fragment
+#version 430 core
+
+#include "../Include/LightBuffer.glsl"
+uniform int uLightCount;
+
+#include "../Include/FrameData.glsl"
+
+uniform sampler2D u_Albedo;
+uniform sampler2D u_Normal;
+uniform sampler2D u_Material;
+uniform sampler2D u_Depth;
+uniform mat4 u_InverseViewProjection;
+
+out vec4 FragColor;
+
+vec3 DecodeNormal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+// Window position and depth back to world space
+vec3 ReconstructPosition(vec2 uv, float depth)
+{
+    vec4 world = u_InverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
+void main()
+{
+    // The G-buffer is the size of the viewport: one texel per pixel
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(u_Depth, texel, 0).r;
+    if (depth >= 1.0)
+        discard;   // background: nothing was drawn here
+
+    vec3 albedo = texelFetch(u_Albedo, texel, 0).rgb;
+    vec3 norm = DecodeNormal(texelFetch(u_Normal, texel, 0).rg);
+    vec4 material = texelFetch(u_Material, texel, 0);
+    vec3 FragPos = ReconstructPosition(gl_FragCoord.xy / vec2(textureSize(u_Depth, 0)), depth);
+
+#if OUTPUT == OUTPUT_ALBEDO
+    FragColor = vec4(albedo, 1.0);
+#elif OUTPUT == OUTPUT_NORMAL
+    FragColor = vec4(norm * 0.5 + 0.5, 1.0);
+#elif OUTPUT == OUTPUT_POSITION
+    FragColor = vec4(fract(FragPos), 1.0);
+#else
+    float ambientIntensity = material.r;
+    float diffuseIntensity = material.g;
+    float specularIntensity = material.b;
+    float shininess = material.a * 256.0;
+    vec3 viewDir = normalize(u_ViewPosition.xyz - FragPos);
+
+    // As PhongMultiple.shader, term for term
+    vec3 result = vec3(0.0);
+    for (int i = 0; i < uLightCount; i++) {
+        vec3 lightPos = uLights[i].position.xyz;
+        vec3 lightDirection = uLights[i].direction.xyz;
+        vec3 lightColour = uLights[i].colour.rgb;
+        float intensity = uLights[i].colour.a;
+        int type = int(uLights[i].position.w);
+        float cutoff = uLights[i].direction.w;
+
+        vec3 lightDir = type == 1 ? normalize(-lightDirection) : normalize(lightPos - FragPos);
+
+        vec3 ambient = ambientIntensity * lightColour;
+        float diff = max(dot(norm, lightDir), 0.0);
+        vec3 diffuse = diffuseIntensity * diff * lightColour;
+        vec3 reflectDir = reflect(-lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+        vec3 specular = specularIntensity * spec * lightColour;
+
+        if (type == 2) {
+            float theta = dot(lightDir, normalize(-lightDirection));
+            float falloff = theta > cutoff ? (theta - cutoff) / (1.0 - cutoff) : 0.0;
+            diffuse *= falloff;
+            specular *= falloff;
+        }
+
+        float reach = type == 1 ? 1.0 : RangeFalloff(length(lightPos - FragPos), uLights[i].range.x);
+        result += ((ambient + diffuse) * albedo + specular) * intensity * reach;
+    }
+    FragColor = vec4(result, 1.0);
+#endif
+}
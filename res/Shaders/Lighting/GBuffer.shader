@@ -0,0 +1,56 @@
+// Geometry pass of DeferredShading: writes the surface, not its lighting, to
+// the G-buffer's render targets. DeferredLighting.shader lights it afterwards,
+// once per visible pixel. The material uniforms are PhongMultiple.shader's, so
+// a scene switches between the forward and deferred path by swapping shaders.
+
+#shader vertex
+#version 430 core
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+
+uniform mat4 u_Model;
+#include "../Include/FrameData.glsl"
+
+out vec3 Normal;     // world space
+
+void main()
+{
+    // No world position out: the lighting pass rebuilds it from depth
+    Normal = mat3(transpose(inverse(u_Model))) * aNormal;
+    gl_Position = u_ViewProjection * u_Model * vec4(aPosition, 1.0);
+}
+
+
+#shader fragment
+#version 430 core
+
+uniform vec3 uAlbedo;
+uniform float uAmbientIntensity;
+uniform float uDiffuseIntensity;
+uniform float uSpecularIntensity;
+uniform float uShininess;
+
+in vec3 Normal;
+
+// DeferredShading's attachments, in order
+layout(location = 0) out vec4 gAlbedo;     // RGBA8: rgb albedo
+layout(location = 1) out vec2 gNormal;     // RG16F: octahedral normal
+layout(location = 2) out vec4 gMaterial;   // RGBA8: ambient, diffuse, specular, shininess / 256
+
+// Octahedral encoding: the unit sphere folded onto the square [-1, 1]^2, so
+// a normal fits two channels with the error spread evenly over directions
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.xy;
+}
+
+void main()
+{
+    gAlbedo = vec4(uAlbedo, 1.0);
+    gNormal = EncodeNormal(normalize(Normal));
+    gMaterial = vec4(uAmbientIntensity, uDiffuseIntensity, uSpecularIntensity, uShininess / 256.0);
+}
@@ -6,8 +6,7 @@ layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+#include "../Include/FrameData.glsl"
 
 struct Light
 {
@@ -16,7 +15,6 @@ struct Light
 };
 
 uniform Light u_Light;
-uniform vec3 u_CameraPosition; //camera in world space
 
 
 //Phong Lighting paramaters
@@ -44,7 +42,7 @@ void main()
     vec3 diffuse = u_DiffuseIntensity * diff * u_Light.Colour;
 
     //Specular component
-    vec3 viewDir = normalize(u_CameraPosition - FragPos);
+    vec3 viewDir = normalize(u_ViewPosition.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir),0.0), u_Shininess);
     vec3 specular = u_SpecularIntensity * spec * u_Light.Colour;
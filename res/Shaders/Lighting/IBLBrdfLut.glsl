@@ -0,0 +1,72 @@
+#version 430 core
+
+// EnvironmentLighting's BRDF lookup table (see EnvironmentLighting.h): the
+// second factor of the split sum. For N.V along x and roughness along y,
+// it integrates the GGX specular BRDF (times N.L) over the hemisphere
+// with Schlick's Fresnel split out, leaving a scale and a bias to F0:
+//
+//     specular = prefiltered * (F0 * lut.r + lut.g)
+//
+// It depends on nothing but the BRDF, so any environment shares it.
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform int u_Size;
+uniform int u_SampleCount;
+
+layout(binding = 1, rg16f) writeonly uniform image2D u_Lut;
+
+const float PI = 3.14159265359;
+
+vec2 Hammersley(uint i, uint n)
+{
+    return vec2(float(i) / float(n), float(bitfieldReverse(i)) * 2.3283064365386963e-10);
+}
+
+// Around N = +Z
+vec3 ImportanceSampleGGX(vec2 xi, float roughness)
+{
+    float a = roughness * roughness;
+    float phi = 2.0 * PI * xi.x;
+    float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (a * a - 1.0) * xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    return vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+}
+
+// Schlick-GGX with the IBL remapping of k (a^2 / 2, not (r + 1)^2 / 8)
+float GeometrySchlickGGX(float NdotX, float roughness)
+{
+    float k = roughness * roughness * 0.5;
+    return NdotX / (NdotX * (1.0 - k) + k);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (texel.x >= u_Size || texel.y >= u_Size)
+        return;
+
+    float NdotV = max((float(texel.x) + 0.5) / float(u_Size), 1e-3);
+    float roughness = (float(texel.y) + 0.5) / float(u_Size);
+    vec3 V = vec3(sqrt(1.0 - NdotV * NdotV), 0.0, NdotV);
+
+    float scale = 0.0;
+    float bias = 0.0;
+    for (uint i = 0u; i < uint(u_SampleCount); i++)
+    {
+        vec3 H = ImportanceSampleGGX(Hammersley(i, uint(u_SampleCount)), roughness);
+        vec3 L = normalize(2.0 * dot(V, H) * H - V);
+        float NdotL = max(L.z, 0.0);
+        if (NdotL <= 0.0)
+            continue;
+
+        float NdotH = max(H.z, 0.0);
+        float VdotH = max(dot(V, H), 0.0);
+        float G = GeometrySchlickGGX(NdotV, roughness) * GeometrySchlickGGX(NdotL, roughness);
+        float visibility = G * VdotH / (NdotH * NdotV + 1e-5);
+        float fresnel = pow(1.0 - VdotH, 5.0);
+        scale += (1.0 - fresnel) * visibility;
+        bias += fresnel * visibility;
+    }
+
+    imageStore(u_Lut, texel, vec4(scale, bias, 0.0, 0.0) / float(u_SampleCount));
+}
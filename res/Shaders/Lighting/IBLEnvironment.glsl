@@ -0,0 +1,72 @@
+#version 430 core
+
+// EnvironmentLighting's first bake pass (see EnvironmentLighting.h): the
+// source environment onto the six faces of a cubemap, one texel per
+// invocation, z = face. The source is an equirectangular .hdr
+// (longitude across, latitude up) or, with u_Procedural, a sky made up
+// here: a blue gradient over a dim ground with a bright sun, so there is
+// something to light with when no .hdr is available.
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform int u_Procedural;
+uniform int u_Size;             // face resolution
+uniform sampler2D u_Equirect;
+
+layout(binding = 0, rgba16f) writeonly uniform imageCube u_Environment;
+
+const float PI = 3.14159265359;
+
+// World direction through texel `texel` of `face`, in GL's cubemap face
+// orientation (+X, -X, +Y, -Y, +Z, -Z)
+vec3 CubeDirection(ivec2 texel, int face, int size)
+{
+    vec2 st = (vec2(texel) + 0.5) / float(size) * 2.0 - 1.0;
+    vec3 direction;
+    if (face == 0)      direction = vec3( 1.0, -st.y, -st.x);
+    else if (face == 1) direction = vec3(-1.0, -st.y,  st.x);
+    else if (face == 2) direction = vec3( st.x,  1.0,  st.y);
+    else if (face == 3) direction = vec3( st.x, -1.0, -st.y);
+    else if (face == 4) direction = vec3( st.x, -st.y,  1.0);
+    else                direction = vec3(-st.x, -st.y, -1.0);
+    return normalize(direction);
+}
+
+vec3 Sky(vec3 direction)
+{
+    const vec3 sunDirection = normalize(vec3(0.5, 0.45, -0.6));
+    const vec3 zenith = vec3(0.18, 0.38, 0.85);
+    const vec3 horizon = vec3(0.85, 0.88, 0.95);
+    const vec3 ground = vec3(0.22, 0.2, 0.18);
+
+    float up = direction.y;
+    vec3 colour = up >= 0.0 ? mix(horizon, zenith, sqrt(up))
+        : mix(horizon * 0.5, ground, smoothstep(0.0, 0.15, -up));
+
+    // A sun disk (3 degrees in radius, so the bake resolves it) and its glow;
+    // far brighter than the sky, as in a real HDR capture
+    float sun = max(dot(direction, sunDirection), 0.0);
+    colour += vec3(1.0, 0.92, 0.8) * (smoothstep(0.9985, 0.9990, sun) * 60.0 + pow(sun, 64.0) * 1.5);
+    return colour;
+}
+
+void main()
+{
+    ivec3 texel = ivec3(gl_GlobalInvocationID);
+    if (texel.x >= u_Size || texel.y >= u_Size)
+        return;
+
+    vec3 direction = CubeDirection(texel.xy, texel.z, u_Size);
+    vec3 colour;
+    if (u_Procedural != 0)
+    {
+        colour = Sky(direction);
+    }
+    else
+    {
+        vec2 uv = vec2(atan(direction.z, direction.x) / (2.0 * PI) + 0.5, asin(clamp(direction.y, -1.0, 1.0)) / PI + 0.5);
+        colour = textureLod(u_Equirect, uv, 0.0).rgb;
+    }
+
+    // Half floats top out at 65504
+    imageStore(u_Environment, texel, vec4(min(colour, vec3(60000.0)), 1.0));
+}
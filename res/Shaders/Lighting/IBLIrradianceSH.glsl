@@ -0,0 +1,93 @@
+#version 430 core
+
+// EnvironmentLighting's irradiance bake (see EnvironmentLighting.h):
+// projects the environment onto the first 9 spherical harmonics (bands
+// 0-2), which is all the diffuse cosine lobe keeps of it. One work group
+// does the whole sum: each invocation accumulates a strided share of the
+// texels of a u_SampleSize mip, weighted by the solid angle each covers,
+// then the group adds the partial sums up in shared memory.
+//
+// The coefficients are written already convolved with the cosine lobe
+// and divided by pi, so the shader's SH sum at a normal N is the
+// Lambertian radiance for white albedo: SH(N) * albedo.
+layout(local_size_x = 64) in;
+
+uniform samplerCube u_Environment;
+uniform int u_SampleSize;       // face resolution at u_SampleLevel
+uniform float u_SampleLevel;
+
+layout(std430, binding = 0) writeonly buffer CoefficientBuffer {
+    vec4 uCoefficients[9];      // rgb
+};
+
+const int GROUP_SIZE = 64;
+shared vec3 s_Sums[GROUP_SIZE * 9];
+
+vec3 CubeDirection(vec2 st, int face)
+{
+    vec3 direction;
+    if (face == 0)      direction = vec3( 1.0, -st.y, -st.x);
+    else if (face == 1) direction = vec3(-1.0, -st.y,  st.x);
+    else if (face == 2) direction = vec3( st.x,  1.0,  st.y);
+    else if (face == 3) direction = vec3( st.x, -1.0, -st.y);
+    else if (face == 4) direction = vec3( st.x, -st.y,  1.0);
+    else                direction = vec3(-st.x, -st.y, -1.0);
+    return direction;
+}
+
+void main()
+{
+    uint invocation = gl_LocalInvocationIndex;
+    vec3 sums[9];
+    for (int i = 0; i < 9; i++)
+        sums[i] = vec3(0.0);
+
+    int faceTexels = u_SampleSize * u_SampleSize;
+    float texelArea = 4.0 / float(faceTexels);    // in face coordinates -1..1
+    for (int index = int(invocation); index < 6 * faceTexels; index += GROUP_SIZE)
+    {
+        int face = index / faceTexels;
+        int texel = index - face * faceTexels;
+        vec2 st = (vec2(texel % u_SampleSize, texel / u_SampleSize) + 0.5) / float(u_SampleSize) * 2.0 - 1.0;
+
+        // Solid angle of the texel: its area over distance cubed
+        vec3 unnormalised = CubeDirection(st, face);
+        float lengthSquared = dot(unnormalised, unnormalised);
+        float solidAngle = texelArea / (lengthSquared * sqrt(lengthSquared));
+        vec3 d = unnormalised * inversesqrt(lengthSquared);
+        vec3 radiance = textureLod(u_Environment, d, u_SampleLevel).rgb * solidAngle;
+
+        sums[0] += radiance * 0.282095;
+        sums[1] += radiance * 0.488603 * d.y;
+        sums[2] += radiance * 0.488603 * d.z;
+        sums[3] += radiance * 0.488603 * d.x;
+        sums[4] += radiance * 1.092548 * d.x * d.y;
+        sums[5] += radiance * 1.092548 * d.y * d.z;
+        sums[6] += radiance * 0.315392 * (3.0 * d.z * d.z - 1.0);
+        sums[7] += radiance * 1.092548 * d.x * d.z;
+        sums[8] += radiance * 0.546274 * (d.x * d.x - d.y * d.y);
+    }
+
+    for (int i = 0; i < 9; i++)
+        s_Sums[invocation * 9u + uint(i)] = sums[i];
+    barrier();
+
+    // Tree reduction: halve the active invocations each step
+    for (uint stride = uint(GROUP_SIZE) / 2u; stride > 0u; stride /= 2u)
+    {
+        if (invocation < stride)
+        {
+            for (uint i = 0u; i < 9u; i++)
+                s_Sums[invocation * 9u + i] += s_Sums[(invocation + stride) * 9u + i];
+        }
+        barrier();
+    }
+
+    if (invocation == 0u)
+    {
+        // Cosine-lobe convolution per band (pi, 2pi/3, pi/4), over pi
+        const float band[9] = float[9](1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25);
+        for (int i = 0; i < 9; i++)
+            uCoefficients[i] = vec4(s_Sums[i] * band[i], 0.0);
+    }
+}
@@ -0,0 +1,104 @@
+#version 430 core
+
+// EnvironmentLighting's specular bake (see EnvironmentLighting.h): one mip
+// of the prefiltered cubemap per dispatch, z = face. Each texel is the
+// environment around its direction R convolved with a GGX lobe of
+// u_Roughness, taking N = V = R (the split sum's assumption, which loses
+// the lobe's stretching at grazing angles).
+//
+// The lobe is importance sampled, and each sample reads a mip of the
+// source whose texels cover about the solid angle the sample stands for
+// ("filtered importance sampling"), so u_SampleCount samples are enough
+// without fireflies from the sun.
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform samplerCube u_Environment;
+uniform float u_SourceSize;     // source face resolution at level 0
+uniform int u_Size;             // this mip's face resolution
+uniform float u_Roughness;
+uniform int u_SampleCount;
+
+layout(binding = 0, rgba16f) writeonly uniform imageCube u_Prefiltered;
+
+const float PI = 3.14159265359;
+
+vec3 CubeDirection(ivec2 texel, int face, int size)
+{
+    vec2 st = (vec2(texel) + 0.5) / float(size) * 2.0 - 1.0;
+    vec3 direction;
+    if (face == 0)      direction = vec3( 1.0, -st.y, -st.x);
+    else if (face == 1) direction = vec3(-1.0, -st.y,  st.x);
+    else if (face == 2) direction = vec3( st.x,  1.0,  st.y);
+    else if (face == 3) direction = vec3( st.x, -1.0, -st.y);
+    else if (face == 4) direction = vec3( st.x, -st.y,  1.0);
+    else                direction = vec3(-st.x, -st.y, -1.0);
+    return normalize(direction);
+}
+
+// Low-discrepancy point i of n
+vec2 Hammersley(uint i, uint n)
+{
+    return vec2(float(i) / float(n), float(bitfieldReverse(i)) * 2.3283064365386963e-10);
+}
+
+// A GGX-distributed half vector around N
+vec3 ImportanceSampleGGX(vec2 xi, vec3 N, float roughness)
+{
+    float a = roughness * roughness;
+    float phi = 2.0 * PI * xi.x;
+    float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (a * a - 1.0) * xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    vec3 H = vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+
+    vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+    return normalize(tangent * H.x + bitangent * H.y + N * H.z);
+}
+
+float DistributionGGX(float NdotH, float roughness)
+{
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float denom = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * denom * denom);
+}
+
+void main()
+{
+    ivec3 texel = ivec3(gl_GlobalInvocationID);
+    if (texel.x >= u_Size || texel.y >= u_Size)
+        return;
+
+    vec3 N = CubeDirection(texel.xy, texel.z, u_Size);
+
+    // Roughness 0 is a mirror: the environment itself
+    if (u_Roughness == 0.0)
+    {
+        imageStore(u_Prefiltered, texel, vec4(textureLod(u_Environment, N, 0.0).rgb, 1.0));
+        return;
+    }
+
+    float texelSolidAngle = 4.0 * PI / (6.0 * u_SourceSize * u_SourceSize);
+    vec3 total = vec3(0.0);
+    float totalWeight = 0.0;
+    for (uint i = 0u; i < uint(u_SampleCount); i++)
+    {
+        vec3 H = ImportanceSampleGGX(Hammersley(i, uint(u_SampleCount)), N, u_Roughness);
+        vec3 L = normalize(2.0 * dot(N, H) * H - N);
+        float NdotL = dot(N, L);
+        if (NdotL <= 0.0)
+            continue;
+
+        // With N = V, the pdf of L is D(h) / 4
+        float NdotH = max(dot(N, H), 0.0);
+        float pdf = DistributionGGX(NdotH, u_Roughness) * 0.25 + 1e-4;
+        float sampleSolidAngle = 1.0 / (float(u_SampleCount) * pdf);
+        float level = max(0.5 * log2(sampleSolidAngle / texelSolidAngle) + 1.0, 0.0);
+
+        total += textureLod(u_Environment, L, level).rgb * NdotL;
+        totalWeight += NdotL;
+    }
+
+    imageStore(u_Prefiltered, texel, vec4(total / max(totalWeight, 1e-4), 1.0));
+}
@@ -0,0 +1,103 @@
+#version 430 core
+
+// Light binning for clustered forward shading (see ClusteredLights.h).
+//
+// The view frustum is cut into a grid of clusters: screen tiles across,
+// exponentially spaced depth slices into the scene. One invocation per
+// cluster builds the cluster's view-space bounding box and collects the
+// lights whose sphere of influence touches it. A shading pass then finds
+// its fragment's cluster and loops over that list instead of every light.
+//
+// Cluster c's list starts at c * (u_ClusterCapacity + 1): the count, then
+// up to u_ClusterCapacity light indices. The count is of every light that
+// touches the cluster: lights past the capacity are dropped, and a count
+// above it is how the heatmap tells those clusters apart.
+
+layout(local_size_x = 64) in;
+
+// Light definition, matching GPULight in LightList.h
+struct Light {
+    vec4 position;     // xyz, w = type (0 = point, 1 = directional, 2 = spotlight)
+    vec4 direction;    // xyz, w = spotlight cutoff (cosine)
+    vec4 colour;       // rgb, a = intensity
+    vec4 range;        // x = radius of influence, 0 = unbounded
+};
+
+layout(std430, binding = 1) readonly buffer LightBuffer {
+    Light uLights[];
+};
+layout(std430, binding = 7) writeonly buffer ClusterBuffer {
+    uint uClusterLights[];
+};
+
+uniform int uLightCount;
+uniform vec3 u_ClusterGrid;      // tiles x, tiles y, depth slices
+uniform vec2 u_ClusterDepth;     // view distances the slices span
+uniform int u_ClusterCapacity;   // light indices per cluster
+uniform mat4 u_ViewMatrix;
+uniform mat4 u_InverseProjection;
+
+// The view-space point at distance `depth` along the ray through ndc.xy
+vec3 PointAtDepth(vec2 ndc, float depth)
+{
+    vec4 onNear = u_InverseProjection * vec4(ndc, -1.0, 1.0);
+    vec3 ray = onNear.xyz / onNear.w;
+    return ray * (depth / -ray.z);
+}
+
+void main()
+{
+    ivec3 grid = ivec3(u_ClusterGrid);
+    int clusterCount = grid.x * grid.y * grid.z;
+    int cluster = int(gl_GlobalInvocationID.x);
+    if (cluster >= clusterCount)
+        return;
+
+    ivec3 cell = ivec3(cluster % grid.x, (cluster / grid.x) % grid.y, cluster / (grid.x * grid.y));
+
+    // Slice k spans near * (far / near)^(k / slices) to the next. The first
+    // slice reaches back to the camera and the last out to infinity (well,
+    // very far), since fragments outside [near, far] clamp into them.
+    float nearZ = u_ClusterDepth.x;
+    float ratio = u_ClusterDepth.y / u_ClusterDepth.x;
+    float depth0 = cell.z == 0 ? 0.0 : nearZ * pow(ratio, float(cell.z) / float(grid.z));
+    float depth1 = cell.z == grid.z - 1 ? 1e6 : nearZ * pow(ratio, float(cell.z + 1) / float(grid.z));
+
+    vec2 ndc0 = vec2(cell.xy) / vec2(grid.xy) * 2.0 - 1.0;
+    vec2 ndc1 = vec2(cell.xy + 1) / vec2(grid.xy) * 2.0 - 1.0;
+
+    // The box around the tile's four corner rays at both depths
+    vec3 lo = vec3(1e30);
+    vec3 hi = vec3(-1e30);
+    for (int corner = 0; corner < 8; corner++)
+    {
+        vec2 ndc = vec2((corner & 1) != 0 ? ndc1.x : ndc0.x, (corner & 2) != 0 ? ndc1.y : ndc0.y);
+        vec3 p = PointAtDepth(ndc, (corner & 4) != 0 ? depth1 : depth0);
+        lo = min(lo, p);
+        hi = max(hi, p);
+    }
+
+    uint base = uint(cluster * (u_ClusterCapacity + 1));
+    uint count = 0u;
+    for (int i = 0; i < uLightCount; i++)
+    {
+        // Directional and unbounded lights reach every cluster. Spot lights
+        // are tested as their whole sphere, which is conservative.
+        bool touches = true;
+        float range = uLights[i].range.x;
+        if (int(uLights[i].position.w) != 1 && range > 0.0)
+        {
+            vec3 centre = vec3(u_ViewMatrix * vec4(uLights[i].position.xyz, 1.0));
+            vec3 nearest = clamp(centre, lo, hi);
+            touches = dot(nearest - centre, nearest - centre) <= range * range;
+        }
+
+        if (touches)
+        {
+            if (count < uint(u_ClusterCapacity))
+                uClusterLights[base + 1u + count] = uint(i);
+            count++;
+        }
+    }
+    uClusterLights[base] = count;
+}
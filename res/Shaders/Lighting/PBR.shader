@@ -1,18 +1,41 @@
+// LIGHTS=SINGLE shades with the u_Light* point light alone. CLUSTERED
+// instead sums the LightList lights in the fragment's cluster (see
+// ClusteredLights.h), and CLUSTER_HEATMAP tints that by the cluster's count.
+#variant LIGHTS=SINGLE,CLUSTERED,CLUSTER_HEATMAP
+// IBL=ON replaces the flat ambient term with image-based lighting from the
+// maps EnvironmentLighting bakes (see EnvironmentLighting.h): SH irradiance
+// for the diffuse part, the prefiltered cubemap and BRDF LUT for specular.
+#variant IBL=OFF,ON
+
+// PULL=STANDARD or PACKED reads the vertices from the MeshArena's buffers
+// instead of attributes, decoding that VertexFormat (see MeshArena.h).
+#variant PULL=OFF,STANDARD,PACKED
+
 #shader vertex
-#version 330 core
+#version 430 core // 4.30 for the PULL variants' storage buffers
 
+#if PULL != PULL_OFF
+#include "../Include/VertexPull.glsl"
+#else
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
+#endif
 
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+#include "../Include/FrameData.glsl"
 
 out vec3 FragPos;
 out vec3 Normal;
 
+// Matches DepthPrepass.shader, so the depth written by RenderQueue's
+// depth pre-pass is the depth this draws at
+invariant gl_Position;
+
 void main()
 {
+#if PULL != PULL_OFF
+    PullVertex();
+#endif
     // Transform vertex position to world space
     FragPos = vec3(u_Model * vec4(aPosition, 1.0));
 
@@ -21,11 +44,11 @@ void main()
     Normal = mat3(transpose(inverse(u_Model))) * aNormal;
 
     // Transform to clip space
-    gl_Position = u_Projection * u_View * vec4(FragPos, 1.0);
+    gl_Position = u_Projection * (u_View * vec4(FragPos, 1.0));
 }
 
 #shader fragment
-#version 330 core
+#version 430 core // GLSL 4.30: the clustered variants read storage buffers
 
 // Material parameters
 uniform vec3 u_Albedo;
@@ -39,7 +62,38 @@ uniform vec3 u_LightColor;
 uniform float u_LightIntensity;
 
 // Camera position
-uniform vec3 u_CameraPosition;
+#include "../Include/FrameData.glsl"
+
+#if LIGHTS != LIGHTS_SINGLE
+// The LightList's lights, and the per-cluster lists of them, for the
+// clustered variants
+#include "../Include/LightBuffer.glsl"
+#include "../Include/Clusters.glsl"
+#endif
+
+#if IBL == IBL_ON
+// Set by EnvironmentLighting::Apply
+uniform samplerCube u_PrefilteredMap;
+uniform sampler2D u_BrdfLut;
+uniform vec3 u_IrradianceSH[9];  // cosine-convolved, over pi
+uniform float u_PrefilterLevels; // the prefiltered map's last mip (roughness 1)
+uniform float u_IBLIntensity;
+
+// Diffuse radiance for white albedo around normal n
+vec3 IrradianceSH(vec3 n)
+{
+    vec3 result = u_IrradianceSH[0] * 0.282095
+        + u_IrradianceSH[1] * 0.488603 * n.y
+        + u_IrradianceSH[2] * 0.488603 * n.z
+        + u_IrradianceSH[3] * 0.488603 * n.x
+        + u_IrradianceSH[4] * 1.092548 * n.x * n.y
+        + u_IrradianceSH[5] * 1.092548 * n.y * n.z
+        + u_IrradianceSH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + u_IrradianceSH[7] * 1.092548 * n.x * n.z
+        + u_IrradianceSH[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+#endif
 
 in vec3 FragPos;
 in vec3 Normal;
@@ -95,23 +149,17 @@ vec3 FresnelSchlick(float cosTheta, vec3 F0)
     return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
-void main()
+// Schlick with roughness, for light from every direction at once: rough
+// surfaces reflect less of the environment at grazing angles
+vec3 FresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
 {
-    vec3 N = normalize(Normal);
-    vec3 V = normalize(u_CameraPosition - FragPos);
-
-    // Calculate reflectance at normal incidence (F0)
-    // For dielectrics (non-metals), use 0.04 as a reasonable approximation
-    // For metals, use the albedo color as F0
-    vec3 F0 = vec3(0.04);
-    F0 = mix(F0, u_Albedo, u_Metallic);
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
 
-    // Calculate per-light radiance
-    vec3 L = normalize(u_LightPosition - FragPos);
+// Outgoing radiance towards V from one light arriving along L
+vec3 CookTorrance(vec3 N, vec3 V, vec3 L, vec3 F0, vec3 radiance)
+{
     vec3 H = normalize(V + L);
-    float distance = length(u_LightPosition - FragPos);
-    float attenuation = 1.0 / (distance * distance);
-    vec3 radiance = u_LightColor * u_LightIntensity * attenuation;
 
     // Cook-Torrance BRDF
     float NDF = DistributionGGX(N, H, u_Roughness);
@@ -130,10 +178,64 @@ void main()
 
     // Lambertian diffuse term
     float NdotL = max(dot(N, L), 0.0);
-    vec3 Lo = (kD * u_Albedo / PI + specular) * radiance * NdotL;
+    return (kD * u_Albedo / PI + specular) * radiance * NdotL;
+}
+
+void main()
+{
+    vec3 N = normalize(Normal);
+    vec3 V = normalize(u_ViewPosition.xyz - FragPos);
+
+    // Calculate reflectance at normal incidence (F0)
+    // For dielectrics (non-metals), use 0.04 as a reasonable approximation
+    // For metals, use the albedo color as F0
+    vec3 F0 = vec3(0.04);
+    F0 = mix(F0, u_Albedo, u_Metallic);
 
+#if LIGHTS == LIGHTS_SINGLE
+    // Calculate per-light radiance
+    vec3 L = normalize(u_LightPosition - FragPos);
+    float distance = length(u_LightPosition - FragPos);
+    float attenuation = 1.0 / (distance * distance);
+    vec3 radiance = u_LightColor * u_LightIntensity * attenuation;
+    vec3 Lo = CookTorrance(N, V, L, F0, radiance);
+#else
+    // Every light of the cluster: inverse-square falloff as above (none for
+    // directional lights), times the range window and the spot cone
+    uint cluster = ClusterOffset(FragPos);
+    uint lightCount = uClusterLights[cluster];
+    vec3 Lo = vec3(0.0);
+    for (uint n = 0u; n < ClusterStored(lightCount); n++)
+    {
+        BufferLight light = uLights[uClusterLights[cluster + 1u + n]];
+        int type = int(light.position.w);
+        vec3 toLight = light.position.xyz - FragPos;
+        vec3 L = type == 1 ? normalize(-light.direction.xyz) : normalize(toLight);
+        float distance = length(toLight);
+        float attenuation = type == 1 ? 1.0 : RangeFalloff(distance, light.range.x) / (distance * distance);
+        if (type == 2)
+        {
+            float theta = dot(L, normalize(-light.direction.xyz));
+            attenuation *= theta > light.direction.w ? (theta - light.direction.w) / (1.0 - light.direction.w) : 0.0;
+        }
+        Lo += CookTorrance(N, V, L, F0, light.colour.rgb * light.colour.a * attenuation);
+    }
+#endif
+
+#if IBL == IBL_ON
+    // Split-sum environment lighting: a few fetches of the baked maps
+    float NdotV = max(dot(N, V), 0.0);
+    vec3 F = FresnelSchlickRoughness(NdotV, F0, u_Roughness);
+    vec3 kD = (vec3(1.0) - F) * (1.0 - u_Metallic);
+    vec3 diffuse = IrradianceSH(N) * u_Albedo;
+    vec3 prefiltered = textureLod(u_PrefilteredMap, reflect(-V, N), u_Roughness * u_PrefilterLevels).rgb;
+    vec2 brdf = texture(u_BrdfLut, vec2(NdotV, u_Roughness)).rg;
+    vec3 specular = prefiltered * (F * brdf.x + brdf.y);
+    vec3 ambient = (kD * diffuse + specular) * u_AO * u_IBLIntensity;
+#else
     // Ambient lighting (simplified)
     vec3 ambient = vec3(0.03) * u_Albedo * u_AO;
+#endif
 
     vec3 color = ambient + Lo;
 
@@ -143,5 +245,9 @@ void main()
     // Gamma correction
     color = pow(color, vec3(1.0 / 2.2));
 
+#if LIGHTS == LIGHTS_CLUSTER_HEATMAP
+    color = mix(color, ClusterHeat(lightCount), 0.6);
+#endif
+
     FragColor = vec4(color, 1.0);
 }
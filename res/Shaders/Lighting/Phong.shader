@@ -1,19 +1,29 @@
+// PULL=STANDARD or PACKED reads the vertices from the MeshArena's buffers
+// instead of attributes, decoding that VertexFormat (see MeshArena.h).
+#variant PULL=OFF,STANDARD,PACKED
+
 #shader vertex // Specifies the vertex shader section
-#version 330 core // Using GLSL version 3.30, compatible with OpenGL 3.3
+#version 430 core // 4.30 for the PULL variants' storage buffers
 
 
+#if PULL != PULL_OFF
+#include "../Include/VertexPull.glsl"
+#else
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
+#endif
 
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+#include "../Include/FrameData.glsl"
 
 out vec3 FragPos;
 out vec3 Normal;
 
 void main()
 {
+#if PULL != PULL_OFF
+    PullVertex();
+#endif
     // Transform vertex position to world space:
     // Given the model matrix u_Model, we transform aPosition (local space)
     // to world space coordinates. This ensures that the fragment shader
@@ -47,7 +57,7 @@ struct Light
 };
 
 uniform Light u_Light;
-uniform vec3 u_CameraPosition; //camera in world space
+#include "../Include/FrameData.glsl"
 
 
 //Phong Lighting paramaters
@@ -56,6 +66,8 @@ uniform float u_DiffuseIntensity;
 uniform float u_SpecularIntensity;
 uniform float u_Shininess;
 
+#include "../Include/Phong.glsl"
+
 in vec3 FragPos;
 in vec3 Normal;
 
@@ -88,7 +100,7 @@ void main()
     // - max(0, N  L) ensures that the light does not contribute negatively
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(u_Light.Position - FragPos); //direction from the fragment to the light
-    float diff = max(dot(norm, lightDir),0.0); //Lambertian Reflectance aka Cosine of angle
+    float diff = LambertDiffuse(norm, lightDir); //Lambertian Reflectance aka Cosine of angle
     vec3 diffuse = u_DiffuseIntensity * diff * u_Light.Colour;    
     // ================================
     // Specular Lighting (Phong Reflection Model)
@@ -102,9 +114,8 @@ void main()
     //     R = 2(N  L)N - L
     // - V = view (camera) direction
     // - s = uShininess (shininess exponent, higher values = sharper highlights)
-    vec3 viewDir = normalize(u_CameraPosition - FragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), u_Shininess);
+    vec3 viewDir = normalize(u_ViewPosition.xyz - FragPos);
+    float spec = PhongSpecular(norm, lightDir, viewDir, u_Shininess);
     vec3 specular = u_SpecularIntensity * spec * u_Light.Colour;
     // ================================
     // Final Lighting Composition
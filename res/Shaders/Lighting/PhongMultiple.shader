@@ -1,16 +1,24 @@
-﻿#shader vertex // Specifies the vertex shader section
-#version 330 core // Using GLSL version 3.30, compatible with OpenGL 3.3
+﻿// LIGHTS=ALL loops over every light in the LightList; CLUSTERED only over
+// the lights of the fragment's cluster (see ClusteredLights.h), and
+// CLUSTER_HEATMAP tints that result by the cluster's light count.
+#variant LIGHTS=ALL,CLUSTERED,CLUSTER_HEATMAP
+
+#shader vertex // Specifies the vertex shader section
+#version 430 core // GLSL 4.30: the fragment stage reads lights from a storage buffer
 
 layout(location = 0) in vec3 aPosition; // Vertex position
 layout(location = 1) in vec3 aNormal;   // Vertex normal
 
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+#include "../Include/FrameData.glsl"
 
 out vec3 FragPos;    // Fragment position in world space
 out vec3 Normal;     // Normal in world space
 
+// Matches DepthPrepass.shader, so the depth written by RenderQueue's
+// depth pre-pass is the depth this draws at
+invariant gl_Position;
+
 void main() {
     // Transform vertex position to world space:
     // Given the model matrix u_Model, we transform aPosition (local space)
@@ -29,35 +37,32 @@ void main() {
     // Transform to clip space:
     // The final vertex position is projected onto screen space using
     // the Model-View-Projection (MVP) transformation.
-    gl_Position = u_Projection * u_View * vec4(FragPos, 1.0);
+    gl_Position = u_Projection * (u_View * vec4(FragPos, 1.0));
 }
 
 
 #shader fragment
-#version 330 core
-
-#define MAX_LIGHTS 16
-
-// Light definition
-struct Light {
-    vec3 position;
-    vec3 direction;
-    vec3 colour;
-    float intensity;
-    int type;    // 0 = point, 1 = directional, 2 = spotlight
-    float cutoff;
-};
-
-// Uniforms sent from CPU
-uniform Light uLights[MAX_LIGHTS];
+#version 430 core
+
+// Every light lives in a shader storage buffer (see LightList.h), so the
+// array has no compile-time size. uLightCount says how many are in use;
+// the buffer may be larger.
+#include "../Include/LightBuffer.glsl"
 uniform int uLightCount;
 
-uniform vec3 uCameraPosition;
+#include "../Include/FrameData.glsl"
+uniform vec3 uAlbedo;    // surface colour, tinting ambient and diffuse
 uniform float uAmbientIntensity;
 uniform float uDiffuseIntensity;
 uniform float uSpecularIntensity;
 uniform float uShininess;
 
+#if LIGHTS != LIGHTS_ALL
+#include "../Include/Clusters.glsl"
+#endif
+
+#include "../Include/Phong.glsl"
+
 // Inputs from vertex shader
 in vec3 FragPos;
 in vec3 Normal;
@@ -68,37 +73,58 @@ out vec4 FragColor;
 void main() {
     vec3 result = vec3(0.0);
 
-    for (int i = 0; i < uLightCount; i++) {
+#if LIGHTS == LIGHTS_ALL
+    int lightCount = uLightCount;
+    int stored = lightCount;
+#else
+    uint cluster = ClusterOffset(FragPos);
+    int lightCount = int(uClusterLights[cluster]);
+    int stored = int(ClusterStored(uint(lightCount)));
+#endif
+
+    for (int n = 0; n < stored; n++) {
+#if LIGHTS == LIGHTS_ALL
+        int i = n;
+#else
+        int i = int(uClusterLights[cluster + 1u + uint(n)]);
+#endif
         vec3 norm = normalize(Normal);
         vec3 lightDir;
 
+        // Unpack the light
+        vec3 lightPos = uLights[i].position.xyz;
+        vec3 lightDirection = uLights[i].direction.xyz;
+        vec3 lightColour = uLights[i].colour.rgb;
+        float intensity = uLights[i].colour.a;
+        int type = int(uLights[i].position.w);
+        float cutoff = uLights[i].direction.w;
+
         // Determine light direction depending on type
-        if (uLights[i].type == 1) {
+        if (type == 1) {
             // Directional light uses negative direction vector
-            lightDir = normalize(-uLights[i].direction);
+            lightDir = normalize(-lightDirection);
         } else {
             // Point and spot lights calculate direction from light to fragment
-            lightDir = normalize(uLights[i].position - FragPos);
+            lightDir = normalize(lightPos - FragPos);
         } 
 
         // Ambient light (constant contribution)
-        vec3 ambient = uAmbientIntensity * uLights[i].colour;
+        vec3 ambient = uAmbientIntensity * lightColour;
 
         // Diffuse shading (Lambert)
-        float diff = max(dot(norm, lightDir), 0.0);
-        vec3 diffuse = uDiffuseIntensity * diff * uLights[i].colour;
+        float diff = LambertDiffuse(norm, lightDir);
+        vec3 diffuse = uDiffuseIntensity * diff * lightColour;
 
         // Specular shading (Phong)
-        vec3 viewDir = normalize(uCameraPosition - FragPos);
-        vec3 reflectDir = reflect(-lightDir, norm);
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0), uShininess);
-        vec3 specular = uSpecularIntensity * spec * uLights[i].colour;
+        vec3 viewDir = normalize(u_ViewPosition.xyz - FragPos);
+        float spec = PhongSpecular(norm, lightDir, viewDir, uShininess);
+        vec3 specular = uSpecularIntensity * spec * lightColour;
 
         // Spotlight effect (cutoff angle check)
-        if (uLights[i].type == 2) {
-            float theta = dot(lightDir, normalize(-uLights[i].direction));
-            if (theta > uLights[i].cutoff) {
-                float falloff = (theta - uLights[i].cutoff) / (1.0 - uLights[i].cutoff);
+        if (type == 2) {
+            float theta = dot(lightDir, normalize(-lightDirection));
+            if (theta > cutoff) {
+                float falloff = (theta - cutoff) / (1.0 - cutoff);
                 diffuse *= falloff;
                 specular *= falloff;
             } else {
@@ -107,9 +133,14 @@ void main() {
             }
         }
 
-        // Combine the contributions, scaled by intensity
-        result += (ambient + diffuse + specular) * uLights[i].intensity;
+        // Combine the contributions, scaled by intensity and range
+        float reach = type == 1 ? 1.0 : RangeFalloff(length(lightPos - FragPos), uLights[i].range.x);
+        result += ((ambient + diffuse) * uAlbedo + specular) * intensity * reach;
     }
 
+#if LIGHTS == LIGHTS_CLUSTER_HEATMAP
+    result = mix(result, ClusterHeat(uint(lightCount)), 0.6);
+#endif
+
     FragColor = vec4(result, 1.0); // Output final colour
 }
@@ -0,0 +1,44 @@
+// The environment behind the scene: a full-screen quad whose pixels look up
+// the cubemap in the direction they see, reconstructed through the inverse
+// view-projection. Draw it first with depth testing off. u_Level picks a
+// mip of EnvironmentLighting's prefiltered map (0 sharp, higher blurrier);
+// the tone mapping matches PBR.shader so the two sit together.
+
+#shader vertex
+#version 430 core
+
+layout(location = 0) in vec3 aPosition;
+
+uniform mat4 u_InverseViewProjection;
+
+out vec3 vs_Direction;
+
+void main()
+{
+    // The far plane point behind this corner, relative to the camera
+    vec4 farPoint = u_InverseViewProjection * vec4(aPosition.xy, 1.0, 1.0);
+    vec4 nearPoint = u_InverseViewProjection * vec4(aPosition.xy, -1.0, 1.0);
+    vs_Direction = farPoint.xyz / farPoint.w - nearPoint.xyz / nearPoint.w;
+    gl_Position = vec4(aPosition.xy, 1.0, 1.0);
+}
+
+
+#shader fragment
+#version 430 core
+
+uniform samplerCube u_Environment;
+uniform float u_Level;
+uniform float u_Intensity;
+
+in vec3 vs_Direction;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec3 colour = textureLod(u_Environment, normalize(vs_Direction), u_Level).rgb * u_Intensity;
+
+    // Reinhard and gamma, as PBR.shader
+    colour = colour / (colour + vec3(1.0));
+    FragColor = vec4(pow(colour, vec3(1.0 / 2.2)), 1.0);
+}
@@ -0,0 +1,224 @@
+//Adaptive tessellation: the mesh is only a coarse cage, and the tessellation stages
+//split each triangle by how big its edges are on screen. An edge gets roughly one
+//segment per u_EdgePixels pixels, so a distant sphere costs a handful of triangles
+//while a close one stays smooth, without a dense base mesh either way.
+//
+//An edge's level depends only on its two end points (never on which triangle asks),
+//so the two triangles sharing an edge split it the same way and no cracks open.
+//
+//SURFACE picks what the evaluation stage does with the new vertices: SPHERE pushes
+//them back out onto the sphere through the cage's corners, PLANE optionally
+//displaces a flat grid with fBm noise (u_Displacement = 0 keeps it flat).
+#variant SURFACE=SPHERE,PLANE
+
+#shader vertex
+#version 430 core
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+
+// Object space: the evaluation stage places the new vertices before transforming
+out vec3 vs_Position;
+out vec3 vs_Normal;
+
+void main()
+{
+    vs_Position = aPosition;
+    vs_Normal = aNormal;
+}
+
+
+#shader tess_control
+#version 430 core
+
+// Shader::PATCH_VERTICES: every patch is one triangle of the index buffer
+layout(vertices = 3) out;
+
+uniform mat4 u_Model;
+#include "../Include/FrameData.glsl"
+
+uniform float u_ViewportHeight;  // pixels
+uniform float u_EdgePixels;      // target on-screen length of one segment
+uniform float u_MaxLevel;        // <= GL_MAX_TESS_GEN_LEVEL (64 at least)
+uniform int u_Cull;              // drop patches outside the view frustum
+
+in vec3 vs_Position[];
+in vec3 vs_Normal[];
+
+out vec3 tcs_Position[];
+out vec3 tcs_Normal[];
+
+// Segments for the edge a-b: the projected diameter of the sphere around the
+// edge, in pixels, over the target length. The sphere (rather than the edge
+// itself) keeps the level from dropping for edges seen end-on.
+float EdgeLevel(vec3 a, vec3 b)
+{
+    vec3 centre = vec3(u_View * vec4(0.5 * (a + b), 1.0));
+    float diameter = distance(a, b);
+    float pixels = diameter * u_Projection[1][1] * 0.5 * u_ViewportHeight / max(length(centre), 1e-4);
+    return clamp(pixels / u_EdgePixels, 1.0, u_MaxLevel);
+}
+
+// All three corners beyond the same clip plane. The margin leaves room for
+// what the evaluation stage adds (the sphere's bulge, displacement).
+bool OutsideFrustum(vec4 c0, vec4 c1, vec4 c2)
+{
+    const float margin = 1.2;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (c0[axis] >  margin * c0.w && c1[axis] >  margin * c1.w && c2[axis] >  margin * c2.w)
+            return true;
+        if (c0[axis] < -margin * c0.w && c1[axis] < -margin * c1.w && c2[axis] < -margin * c2.w)
+            return true;
+    }
+    return false;
+}
+
+void main()
+{
+    tcs_Position[gl_InvocationID] = vs_Position[gl_InvocationID];
+    tcs_Normal[gl_InvocationID] = vs_Normal[gl_InvocationID];
+
+    // The levels are per patch: one invocation writes them
+    if (gl_InvocationID != 0)
+        return;
+
+    vec3 p0 = vec3(u_Model * vec4(vs_Position[0], 1.0));
+    vec3 p1 = vec3(u_Model * vec4(vs_Position[1], 1.0));
+    vec3 p2 = vec3(u_Model * vec4(vs_Position[2], 1.0));
+
+    if (u_Cull != 0 && OutsideFrustum(u_ViewProjection * vec4(p0, 1.0), u_ViewProjection * vec4(p1, 1.0),
+        u_ViewProjection * vec4(p2, 1.0)))
+    {
+        // A zero outer level discards the patch
+        gl_TessLevelOuter[0] = 0.0;
+        gl_TessLevelOuter[1] = 0.0;
+        gl_TessLevelOuter[2] = 0.0;
+        gl_TessLevelInner[0] = 0.0;
+        return;
+    }
+
+    // Outer level i is the edge opposite corner i
+    gl_TessLevelOuter[0] = EdgeLevel(p1, p2);
+    gl_TessLevelOuter[1] = EdgeLevel(p2, p0);
+    gl_TessLevelOuter[2] = EdgeLevel(p0, p1);
+    gl_TessLevelInner[0] = max(gl_TessLevelOuter[0], max(gl_TessLevelOuter[1], gl_TessLevelOuter[2]));
+}
+
+
+#shader tess_evaluation
+#version 430 core
+
+// Fractional spacing grows the levels smoothly instead of popping a segment at a time
+layout(triangles, fractional_odd_spacing, ccw) in;
+
+uniform mat4 u_Model;
+#include "../Include/FrameData.glsl"
+
+uniform float u_Displacement;    // PLANE: height of the noise, 0 for flat
+uniform float u_Frequency;       // PLANE: noise features per unit
+
+in vec3 tcs_Position[];
+in vec3 tcs_Normal[];
+
+out vec3 FragPos;
+out vec3 Normal;
+
+#if SURFACE == SURFACE_PLANE
+float Hash(vec2 p)
+{
+    return fract(sin(dot(p, vec2(127.1, 311.7))) * 43758.5453);
+}
+
+float ValueNoise(vec2 p)
+{
+    vec2 cell = floor(p);
+    vec2 f = fract(p);
+    vec2 u = f * f * (3.0 - 2.0 * f);
+    return mix(mix(Hash(cell), Hash(cell + vec2(1.0, 0.0)), u.x),
+        mix(Hash(cell + vec2(0.0, 1.0)), Hash(cell + vec2(1.0, 1.0)), u.x), u.y);
+}
+
+float Height(vec2 xz)
+{
+    float total = 0.0;
+    float amplitude = 0.5;
+    vec2 p = xz * u_Frequency;
+    for (int octave = 0; octave < 5; octave++)
+    {
+        total += amplitude * ValueNoise(p);
+        p *= 2.0;
+        amplitude *= 0.5;
+    }
+    return total * u_Displacement;
+}
+#endif
+
+void main()
+{
+    vec3 b = gl_TessCoord;
+    vec3 position = b.x * tcs_Position[0] + b.y * tcs_Position[1] + b.z * tcs_Position[2];
+    vec3 normal;
+
+#if SURFACE == SURFACE_SPHERE
+    // The cage's corners lie on the sphere; so do the new vertices
+    normal = normalize(position);
+    position = normal * length(tcs_Position[0]);
+#else
+    normal = normalize(b.x * tcs_Normal[0] + b.y * tcs_Normal[1] + b.z * tcs_Normal[2]);
+    if (u_Displacement != 0.0)
+    {
+        // Height along y, normal from the gradient by central differences
+        const float delta = 0.05;
+        position.y += Height(position.xz);
+        float dx = Height(position.xz + vec2(delta, 0.0)) - Height(position.xz - vec2(delta, 0.0));
+        float dz = Height(position.xz + vec2(0.0, delta)) - Height(position.xz - vec2(0.0, delta));
+        normal = normalize(vec3(-dx, 2.0 * delta, -dz));
+    }
+#endif
+
+    FragPos = vec3(u_Model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(u_Model))) * normal;
+    gl_Position = u_ViewProjection * vec4(FragPos, 1.0);
+}
+
+
+#shader fragment
+#version 430 core
+
+struct Light
+{
+    vec3 Position; //this position is in world space
+    vec3 Colour;
+};
+
+uniform Light u_Light;
+#include "../Include/FrameData.glsl"
+
+//Blinn-Phong lighting paramaters, as Blinn-Phong.shader
+uniform float u_AmbientIntensity;
+uniform float u_DiffuseIntensity;
+uniform float u_SpecularIntensity;
+uniform float u_Shininess;
+
+in vec3 FragPos;
+in vec3 Normal;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec3 ambient = u_AmbientIntensity * u_Light.Colour;
+
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(u_Light.Position - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = u_DiffuseIntensity * diff * u_Light.Colour;
+
+    vec3 viewDir = normalize(u_ViewPosition.xyz - FragPos);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(norm, halfwayDir), 0.0), u_Shininess);
+    vec3 specular = u_SpecularIntensity * spec * u_Light.Colour;
+
+    FragColor = vec4(ambient + diffuse + specular, 1.0);
+}
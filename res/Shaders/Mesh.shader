@@ -1,14 +1,21 @@
+// PULL=STANDARD or PACKED reads the vertices from the MeshArena's buffers
+// instead of attributes, decoding that VertexFormat (see MeshArena.h).
+#variant PULL=OFF,STANDARD,PACKED
+
 #shader vertex
-#version 330 core
+#version 430 core // 4.30 for the PULL variants' storage buffers
 
+#if PULL != PULL_OFF
+#include "Include/VertexPull.glsl"
+#else
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec3 aColour;
 layout(location = 3) in vec2 aTexCoords;
+#endif
 
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+#include "Include/FrameData.glsl"
 
 out vec3 v_FragPos;
 out vec3 v_Normal;
@@ -17,6 +24,9 @@ out vec2 v_TexCoords;
 
 void main()
 {
+#if PULL != PULL_OFF
+    PullVertex();
+#endif
     vec4 worldPos = u_Model * vec4(aPosition, 1.0);
     v_FragPos   = vec3(worldPos);
 
@@ -49,7 +59,7 @@ uniform int u_UseSpecularTexture;
 // Lighting
 uniform vec3  u_LightPos;
 uniform vec3  u_LightColor;
-uniform vec3  u_CameraPos;
+#include "Include/FrameData.glsl"
 
 uniform float u_AmbientStrength;
 uniform float u_SpecularStrength;
@@ -70,7 +80,7 @@ void main()
 
     vec3 norm     = normalize(v_Normal);
     vec3 lightDir = normalize(u_LightPos - v_FragPos);
-    vec3 viewDir  = normalize(u_CameraPos - v_FragPos);
+    vec3 viewDir  = normalize(u_ViewPosition.xyz - v_FragPos);
     vec3 halfDir  = normalize(lightDir + viewDir);   // Blinn half-vector
 
     // Ambient
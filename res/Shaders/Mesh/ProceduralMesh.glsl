@@ -0,0 +1,174 @@
+#version 430 core
+
+// GeometryFactory's GPU generators (see GeometryFactory.h): one invocation
+// per vertex of a (u_Columns + 1) x (u_Rows + 1) grid over a parametric
+// surface, written straight into a MeshArena range. Every shape is the
+// same grid, so the invocation at (column, row) also writes the two
+// triangles of the cell to its upper right, counter-clockwise seen from
+// outside. Indices are local to the range: baseVertex is added at draw time.
+//   u_Shape 0: heightfield on XZ, y = u_Height * fbm (u_Height 0: a plane)
+//   u_Shape 1: sphere, u around Y, v from the north pole down
+//   u_Shape 2: torus around Y, u around the ring, v around the tube
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform int u_Shape;
+uniform int u_Columns;
+uniform int u_Rows;
+uniform int u_Packed;          // 1: PackedVertex (24 B), 0: Vertex (44 B)
+uniform int u_VertexOffset;    // in uints, where the range starts in the bound block
+uniform int u_IndexOffset;     // in indices
+
+uniform float u_Size;          // heightfield: side length; sphere: radius; torus: ring radius
+uniform float u_Height;        // heightfield: peak height; torus: tube radius
+uniform float u_Frequency;     // heightfield: noise lattice cells per unit
+uniform int u_Octaves;
+
+// Bound over the arena buffers with glBindBufferRange. Plain uints, since
+// a Vertex has no std430 equivalent; floats go through floatBitsToUint.
+layout(std430, binding = 0) writeonly buffer Vertices { uint vertexWords[]; };
+layout(std430, binding = 1) writeonly buffer Indices { uint indices[]; };
+
+const float PI = 3.14159265359;
+
+// The art shaders' hash and value noise
+float hash(vec2 p)
+{
+    return fract(sin(dot(p, vec2(127.1, 311.7))) * 43758.5453123);
+}
+
+float valueNoise(vec2 p)
+{
+    vec2 i = floor(p);
+    vec2 f = fract(p);
+    vec2 w = f * f * (3.0 - 2.0 * f);
+    return mix(mix(hash(i), hash(i + vec2(1.0, 0.0)), w.x),
+               mix(hash(i + vec2(0.0, 1.0)), hash(i + vec2(1.0, 1.0)), w.x), w.y);
+}
+
+// 0..1: the octaves' sum over the sum of their amplitudes
+float fbm(vec2 p)
+{
+    float sum = 0.0;
+    float amplitude = 1.0;
+    float total = 0.0;
+    for (int octave = 0; octave < u_Octaves; octave++)
+    {
+        sum += amplitude * valueNoise(p);
+        total += amplitude;
+        amplitude *= 0.5;
+        p = p * 2.0 + vec2(17.0, 9.0);
+    }
+    return total > 0.0 ? sum / total : 0.0;
+}
+
+float terrainHeight(vec2 xz)
+{
+    return u_Height > 0.0 ? u_Height * fbm(xz * u_Frequency) : 0.0;
+}
+
+void writeFloat(inout uint word, float value)
+{
+    vertexWords[word++] = floatBitsToUint(value);
+}
+
+// As PackedVertex::PackSnorm1010102: value * 511, two's complement, w = 0
+uint packSnorm1010102(vec3 v)
+{
+    ivec3 q = ivec3(round(clamp(v, -1.0, 1.0) * 511.0)) & 0x3FF;
+    return uint(q.x) | (uint(q.y) << 10) | (uint(q.z) << 20);
+}
+
+void main()
+{
+    ivec2 cell = ivec2(gl_GlobalInvocationID.xy);
+    if (cell.x > u_Columns || cell.y > u_Rows)
+        return;
+
+    vec2 uv = vec2(cell) / vec2(u_Columns, u_Rows);
+    vec3 position;
+    vec3 normal;
+    vec3 colour;
+
+    if (u_Shape == 1)
+    {
+        float theta = 2.0 * PI * uv.x;
+        float phi = PI * uv.y;
+        normal = vec3(sin(phi) * cos(theta), cos(phi), sin(phi) * sin(theta));
+        position = u_Size * normal;
+        // As the CPU sphere's colours
+        colour = normal * 0.5 + 0.5;
+    }
+    else if (u_Shape == 2)
+    {
+        float theta = 2.0 * PI * uv.x;
+        float phi = 2.0 * PI * uv.y;
+        vec3 ring = vec3(cos(theta), 0.0, sin(theta));
+        normal = cos(phi) * ring + vec3(0.0, -sin(phi), 0.0);
+        position = u_Size * ring + u_Height * normal;
+        colour = normal * 0.5 + 0.5;
+    }
+    else
+    {
+        // v runs towards -z so that u x v points up
+        vec2 xz = vec2(uv.x - 0.5, 0.5 - uv.y) * u_Size;
+        float height = terrainHeight(xz);
+        position = vec3(xz.x, height, xz.y);
+
+        // Central differences of the height function itself rather than
+        // of neighbouring vertices, which another invocation writes
+        float delta = u_Size / float(max(u_Columns, u_Rows));
+        float dx = terrainHeight(xz + vec2(delta, 0.0)) - terrainHeight(xz - vec2(delta, 0.0));
+        float dz = terrainHeight(xz + vec2(0.0, delta)) - terrainHeight(xz - vec2(0.0, delta));
+        normal = normalize(vec3(-dx, 2.0 * delta, -dz));
+
+        // Grass, rock, then snow towards the peaks; slopes are rockier
+        float t = u_Height > 0.0 ? height / u_Height : 0.0;
+        vec3 ground = mix(vec3(0.25, 0.45, 0.2), vec3(0.45, 0.4, 0.35), smoothstep(0.3, 0.6, t));
+        ground = mix(ground, vec3(0.45, 0.4, 0.35), 1.0 - smoothstep(0.6, 0.8, normal.y));
+        colour = mix(ground, vec3(0.95), smoothstep(0.7, 0.85, t));
+        if (u_Height <= 0.0)
+            colour = vec3(1.0);
+    }
+
+    uint vertex = uint(cell.y * (u_Columns + 1) + cell.x);
+    if (u_Packed != 0)
+    {
+        uint word = uint(u_VertexOffset) + vertex * 6u;
+        writeFloat(word, position.x);
+        writeFloat(word, position.y);
+        writeFloat(word, position.z);
+        vertexWords[word++] = packSnorm1010102(normal);
+        vertexWords[word++] = packUnorm4x8(vec4(colour, 1.0));
+        vertexWords[word++] = packHalf2x16(uv);
+    }
+    else
+    {
+        uint word = uint(u_VertexOffset) + vertex * 11u;
+        writeFloat(word, position.x);
+        writeFloat(word, position.y);
+        writeFloat(word, position.z);
+        writeFloat(word, normal.x);
+        writeFloat(word, normal.y);
+        writeFloat(word, normal.z);
+        writeFloat(word, colour.r);
+        writeFloat(word, colour.g);
+        writeFloat(word, colour.b);
+        writeFloat(word, uv.x);
+        writeFloat(word, uv.y);
+    }
+
+    if (cell.x == u_Columns || cell.y == u_Rows)
+        return;
+
+    // (column, row) -> (column + 1, row) is along u, -> (column, row + 1)
+    // along v, and u x v is outward for every shape
+    uint right = vertex + 1u;
+    uint below = vertex + uint(u_Columns + 1);
+    uint first = uint(u_IndexOffset) + uint(cell.y * u_Columns + cell.x) * 6u;
+    indices[first + 0u] = vertex;
+    indices[first + 1u] = right;
+    indices[first + 2u] = below;
+    indices[first + 3u] = right;
+    indices[first + 4u] = below + 1u;
+    indices[first + 5u] = below;
+}
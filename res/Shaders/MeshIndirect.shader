@@ -0,0 +1,197 @@
+// INDIRECT: one model drawn with Model::Draw / Submit, per-draw transforms
+// from the DrawIndirectBuffer. INSTANCED: many copies, each instance's
+// transform from the instance attributes (e.g. GPUCulling survivors).
+#variant DRAW=INDIRECT,INSTANCED
+// Where the textures come from (see MaterialTable.h). BOUND: texture_diffuse1
+// etc., bound per material group. BINDLESS / ARRAY: every material of the
+// model in the MaterialBuffer table, indexed by the draw's material index,
+// as bindless handles or as layers of one texture array. INDIRECT only.
+#variant MATERIAL=BOUND,BINDLESS,ARRAY
+
+#shader vertex
+#version 430 core
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec3 aColour;
+layout(location = 3) in vec2 aTexCoords;
+
+#if DRAW == DRAW_INSTANCED
+// Per-instance transform (see InstanceBuffer.h); locations 8-11
+layout(location = 8) in mat4 a_InstanceModel;
+#else
+// Index of this draw within the glMultiDrawElementsIndirect batch. Fed by a
+// divisor-1 attribute + baseInstance (see DrawIndirectBuffer.h), which works
+// on GL 4.3 where gl_DrawID is not available.
+layout(location = 13) in uint a_DrawID;
+
+struct DrawData
+{
+    mat4 model;
+    uint materialIndex;
+};
+
+layout(std430, binding = 0) buffer DrawDataBuffer
+{
+    DrawData u_Draws[];
+};
+
+// Whole-model transform; per-draw transforms come from u_Draws
+uniform mat4 u_Model;
+#endif
+
+#include "Include/FrameData.glsl"
+
+out vec3 v_FragPos;
+out vec3 v_Normal;
+out vec3 v_Colour;
+out vec2 v_TexCoords;
+flat out uint v_Material;
+
+void main()
+{
+#if DRAW == DRAW_INSTANCED
+    mat4 model  = a_InstanceModel;
+    v_Material  = 0u;
+#else
+    mat4 model  = u_Model * u_Draws[a_DrawID].model;
+    v_Material  = u_Draws[a_DrawID].materialIndex;
+#endif
+
+    vec4 worldPos = model * vec4(aPosition, 1.0);
+    v_FragPos   = vec3(worldPos);
+
+    // Transpose-inverse corrects normals under non-uniform scaling
+    v_Normal    = mat3(transpose(inverse(model))) * aNormal;
+
+    v_Colour    = aColour;
+    v_TexCoords = aTexCoords;
+
+    gl_Position = u_Projection * u_View * worldPos;
+}
+
+
+#shader fragment
+#version 430 core
+#if MATERIAL == MATERIAL_BINDLESS
+// "enable", not "require": the variant still compiles where the extension
+// is missing (CompileAllVariants builds it), MaterialTable never selects it
+#extension GL_ARB_bindless_texture : enable
+#endif
+
+in vec3 v_FragPos;
+in vec3 v_Normal;
+in vec3 v_Colour;
+in vec2 v_TexCoords;
+flat in uint v_Material;
+
+#if MATERIAL == MATERIAL_BOUND
+// Textures bound once per material group by Model::Draw / the RenderQueue
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+#else
+// Matches MaterialTable::GpuMaterial (32 bytes)
+struct MaterialData
+{
+    uvec2 diffuse;          // bindless handles
+    uvec2 specular;
+    int   diffuseLayer;     // texture array layers
+    int   specularLayer;
+    uint  flags;            // 1 = has diffuse, 2 = has specular
+    uint  padding;
+};
+
+layout(std430, binding = 6) readonly buffer MaterialBuffer
+{
+    MaterialData u_Materials[];
+};
+
+#if MATERIAL == MATERIAL_ARRAY
+uniform sampler2DArray u_MaterialTextures;
+#endif
+#endif
+
+vec3 SampleDiffuse()
+{
+#if MATERIAL == MATERIAL_BOUND
+    return texture(texture_diffuse1, v_TexCoords).rgb;
+#elif MATERIAL == MATERIAL_BINDLESS && defined(GL_ARB_bindless_texture)
+    return texture(sampler2D(u_Materials[v_Material].diffuse), v_TexCoords).rgb;
+#elif MATERIAL == MATERIAL_ARRAY
+    return texture(u_MaterialTextures, vec3(v_TexCoords, u_Materials[v_Material].diffuseLayer)).rgb;
+#else
+    return vec3(1.0);
+#endif
+}
+
+vec3 SampleSpecular()
+{
+#if MATERIAL == MATERIAL_BOUND
+    return texture(texture_specular1, v_TexCoords).rgb;
+#elif MATERIAL == MATERIAL_BINDLESS && defined(GL_ARB_bindless_texture)
+    return texture(sampler2D(u_Materials[v_Material].specular), v_TexCoords).rgb;
+#elif MATERIAL == MATERIAL_ARRAY
+    return texture(u_MaterialTextures, vec3(v_TexCoords, u_Materials[v_Material].specularLayer)).rgb;
+#else
+    return vec3(1.0);
+#endif
+}
+
+// Whether the mesh has the texture: a uniform when bound, per material in the table
+bool HasTexture(uint flag)
+{
+#if MATERIAL == MATERIAL_BOUND
+    return true;
+#else
+    return (u_Materials[v_Material].flags & flag) != 0u;
+#endif
+}
+
+// Set to 1 when the mesh has the corresponding texture, 0 to fall back to vertex colour / white
+uniform int u_UseDiffuseTexture;
+uniform int u_UseSpecularTexture;
+
+// Lighting
+uniform vec3  u_LightPos;
+uniform vec3  u_LightColor;
+#include "Include/FrameData.glsl"
+
+uniform float u_AmbientStrength;
+uniform float u_SpecularStrength;
+uniform float u_Shininess;
+
+out vec4 FragColor;
+
+void main()
+{
+    // -----------------------------------------------------------------------
+    // Base colour
+    // v_Colour defaults to (1,1,1) for Assimp-loaded meshes with no vertex
+    // colours, so multiplying by the texture sample passes it through cleanly.
+    // -----------------------------------------------------------------------
+    vec3 baseColor = (u_UseDiffuseTexture != 0 && HasTexture(1u))
+        ? SampleDiffuse() * v_Colour
+        : v_Colour;
+
+    vec3 norm     = normalize(v_Normal);
+    vec3 lightDir = normalize(u_LightPos - v_FragPos);
+    vec3 viewDir  = normalize(u_ViewPosition.xyz - v_FragPos);
+    vec3 halfDir  = normalize(lightDir + viewDir);   // Blinn half-vector
+
+    // Ambient
+    vec3 ambient = u_AmbientStrength * u_LightColor;
+
+    // Diffuse (Lambertian)
+    float diff   = max(dot(norm, lightDir), 0.0);
+    vec3  diffuse = diff * u_LightColor;
+
+    // Specular (Blinn-Phong)
+    vec3  specBase = (u_UseSpecularTexture != 0 && HasTexture(2u))
+        ? SampleSpecular()
+        : vec3(1.0);
+    float spec    = pow(max(dot(norm, halfDir), 0.0), u_Shininess);
+    vec3  specular = u_SpecularStrength * spec * specBase * u_LightColor;
+
+    vec3 result = (ambient + diffuse) * baseColor + specular;
+    FragColor   = vec4(result, 1.0);
+}
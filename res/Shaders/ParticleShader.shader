@@ -1,15 +1,20 @@
 #shader vertex
 #version 330 core
 
-layout(location = 0) in vec2 position;
-layout(location = 1) in vec4 color;
+// One instance per particle (see test::ParticleInstance);
+// the quad's corners come from the index, 0..3 = BL, BR, TR, TL
+layout(location = 0) in vec3 instance;   // position.xy, size
+layout(location = 1) in vec4 color;      // alpha already faded by life
 
 out vec4 v_Color;
 
 uniform mat4 u_MVP;
 
+const vec2 CORNERS[4] = vec2[4](vec2(-0.5, -0.5), vec2(0.5, -0.5), vec2(0.5, 0.5), vec2(-0.5, 0.5));
+
 void main()
 {
+    vec2 position = instance.xy + CORNERS[gl_VertexID] * instance.z;
     gl_Position = u_MVP * vec4(position, 0.0, 1.0);
     v_Color = color;
 }
@@ -0,0 +1,40 @@
+#shader vertex // Specifies the vertex shader section
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+
+// Per-instance data (see InstanceBuffer.h). A mat4 input takes four
+// locations, so the model matrix uses 8, 9, 10 and 11.
+layout(location = 8) in mat4 a_InstanceModel;
+layout(location = 12) in vec4 a_InstanceColour;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec4 fragColor;
+flat out uint objectId;
+
+void main() {
+    gl_Position = projection * view * a_InstanceModel * vec4(aPos, 1.0);
+    fragColor = a_InstanceColour; // Each instance carries its own colour
+
+    // Instance i is object i; 0 is kept for "no object" in the ID buffer
+    objectId = uint(gl_InstanceID) + 1u;
+}
+
+
+#shader fragment // Specifies the fragment shader section
+#version 330 core
+
+in vec4 fragColor;
+flat in uint objectId;
+
+layout(location = 0) out vec4 color;
+// Only stored when the framebuffer has an ID attachment (Framebuffer::
+// EnableObjectIds); on the default framebuffer it is discarded.
+layout(location = 1) out uint objectIdOut;
+
+void main() {
+    color = fragColor;
+    objectIdOut = objectId;
+}
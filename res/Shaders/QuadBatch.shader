@@ -0,0 +1,62 @@
+// QuadBatch: four vertices a quad, texture slot and layer per vertex.
+// Slots 0-3 are the batch's TextureArrays, 4-7 its plain textures, 0xFFFF
+// none: the colour alone. The colour tints whatever the slot samples.
+
+#shader vertex
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec2 aTexCoord;
+layout(location = 2) in vec4 aColor;     // rgba8, normalised
+layout(location = 3) in vec2 aTexture;   // slot, layer
+
+out vec4 v_Color;
+out vec2 v_TexCoord;
+flat out int v_Slot;
+flat out float v_Layer;
+
+uniform mat4 u_ViewProjection;
+
+void main()
+{
+    gl_Position = u_ViewProjection * vec4(aPos, 1.0);
+    v_Color = aColor;
+    v_TexCoord = aTexCoord;
+    v_Slot = int(aTexture.x);
+    v_Layer = aTexture.y;
+}
+
+
+#shader fragment
+#version 330 core
+in vec4 v_Color;
+in vec2 v_TexCoord;
+flat in int v_Slot;
+flat in float v_Layer;
+out vec4 FragColor;
+
+uniform sampler2DArray u_Arrays[4];
+uniform sampler2D u_Textures[4];
+
+void main()
+{
+    // GLSL 3.30 only indexes sampler arrays with constants, hence the
+    // switch. Neighbouring pixels may take different cases, so the
+    // gradients are taken out here, where every pixel runs.
+    vec2 dx = dFdx(v_TexCoord);
+    vec2 dy = dFdy(v_TexCoord);
+    vec3 uvw = vec3(v_TexCoord, v_Layer);
+
+    vec4 texel = vec4(1.0);
+    switch (v_Slot)
+    {
+    case 0: texel = textureGrad(u_Arrays[0], uvw, dx, dy); break;
+    case 1: texel = textureGrad(u_Arrays[1], uvw, dx, dy); break;
+    case 2: texel = textureGrad(u_Arrays[2], uvw, dx, dy); break;
+    case 3: texel = textureGrad(u_Arrays[3], uvw, dx, dy); break;
+    case 4: texel = textureGrad(u_Textures[0], v_TexCoord, dx, dy); break;
+    case 5: texel = textureGrad(u_Textures[1], v_TexCoord, dx, dy); break;
+    case 6: texel = textureGrad(u_Textures[2], v_TexCoord, dx, dy); break;
+    case 7: texel = textureGrad(u_Textures[3], v_TexCoord, dx, dy); break;
+    }
+    FragColor = texel * v_Color;
+}
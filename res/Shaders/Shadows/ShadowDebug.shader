@@ -0,0 +1,28 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 3) in vec2 aTextureCoords;
+
+out vec2 v_TexCoords;
+
+void main()
+{
+    v_TexCoords = aTextureCoords;
+    gl_Position = vec4(aPosition, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+in vec2 v_TexCoords;
+out vec4 FragColor;
+
+uniform sampler2DArray u_ShadowMap;
+uniform int u_Layer;
+
+void main()
+{
+    // Depth as grey: near the light is dark, unoccluded texels are white
+    FragColor = vec4(vec3(texture(u_ShadowMap, vec3(v_TexCoords, u_Layer)).r), 1.0);
+}
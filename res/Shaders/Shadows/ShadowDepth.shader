@@ -3,12 +3,43 @@
 
 layout(location = 0) in vec3 aPosition;
 
-uniform mat4 u_LightSpaceMatrix;
-uniform mat4 u_Model;
+// Per-instance model matrix (see InstanceBuffer.h); occupies locations 8-11
+layout(location = 8) in mat4 a_InstanceModel;
+
+// The instances are every cascade's casters one list after another;
+// x, y, z are the first instance of cascades 1, 2 and 3
+uniform vec4 u_CascadeStarts;
+
+flat out int v_Cascade;
+
+void main()
+{
+    float id = float(gl_InstanceID);
+    v_Cascade = int(id >= u_CascadeStarts.x) + int(id >= u_CascadeStarts.y) + int(id >= u_CascadeStarts.z);
+    gl_Position = a_InstanceModel * vec4(aPosition, 1.0);
+}
+
+#shader geometry
+#version 330 core
+
+// Sends each triangle to its cascade's layer of the shadow map array, so
+// every cascade is drawn by the same draw call
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+uniform mat4 u_CascadeViewProjection[4];
+
+flat in int v_Cascade[];
 
 void main()
 {
-    gl_Position = u_LightSpaceMatrix * u_Model * vec4(aPosition, 1.0);
+    for (int i = 0; i < 3; i++)
+    {
+        gl_Layer = v_Cascade[0];
+        gl_Position = u_CascadeViewProjection[v_Cascade[0]] * gl_in[i].gl_Position;
+        EmitVertex();
+    }
+    EndPrimitive();
 }
 
 #shader fragment
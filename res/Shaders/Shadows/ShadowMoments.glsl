@@ -0,0 +1,51 @@
+#version 430 core
+
+// Prefiltered shadow maps (see TestShadowMapping.h): one half of a
+// separable Gaussian blur over every layer of the cascade array. Pass 0
+// turns the depth map into moments and blurs them along x; pass 1 blurs
+// the result along y. Moments, unlike depths, can be filtered before the
+// compare, so the lit pass gets a soft shadow from one bilinear fetch.
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform int u_Pass;             // 0: depth -> moments along x, 1: along y
+uniform int u_Moments;          // 0: ESM, exp(c * depth); 1: VSM, (depth, depth^2)
+uniform float u_Exponent;       // ESM's c
+uniform int u_Radius;           // taps either side
+
+uniform sampler2DArray u_Source;    // depth (pass 0) or pass 0's moments
+
+// No format qualifier: write-only images may leave it out, so the same
+// shader fills ESM's R32F and VSM's RG32F
+layout(binding = 0) writeonly uniform image2DArray u_Dest;
+
+vec4 Moments(float depth)
+{
+    if (u_Moments == 0)
+        return vec4(exp(u_Exponent * depth), 0.0, 0.0, 0.0);
+    return vec4(depth, depth * depth, 0.0, 0.0);
+}
+
+void main()
+{
+    ivec3 texel = ivec3(gl_GlobalInvocationID);
+    ivec3 size = imageSize(u_Dest);
+    if (texel.x >= size.x || texel.y >= size.y)
+        return;
+
+    ivec2 axis = u_Pass == 0 ? ivec2(1, 0) : ivec2(0, 1);
+    float sigma = max(float(u_Radius) * 0.5, 0.5);
+
+    vec4 sum = vec4(0.0);
+    float weights = 0.0;
+    for (int i = -u_Radius; i <= u_Radius; i++)
+    {
+        ivec2 p = clamp(texel.xy + axis * i, ivec2(0), size.xy - 1);
+        vec4 value = texelFetch(u_Source, ivec3(p, texel.z), 0);
+        if (u_Pass == 0)
+            value = Moments(value.r);
+        float weight = exp(-float(i * i) / (2.0 * sigma * sigma));
+        sum += value * weight;
+        weights += weight;
+    }
+    imageStore(u_Dest, texel, sum / weights);
+}
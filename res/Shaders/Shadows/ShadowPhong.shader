@@ -1,24 +1,44 @@
+// How the shadow map is filtered (see TestShadowMapping.h):
+//   PCF       NxN manual depth compares
+//   HARDWARE  NxN fetches through a comparison sampler, each a bilinear
+//             2x2 compare done by the texture unit
+//   ESM, VSM  one filtered fetch of moments blurred ahead of time
+#variant FILTER=PCF,HARDWARE,ESM,VSM
+// PCF kernel width: 1 = a single sample, otherwise an NxN filter. A
+// compile-time variant (see Shader::Variant), so the loop below has
+// constant bounds and unrolls. ESM and VSM ignore it.
+#variant PCF_KERNEL=1,3,5
+// SHOW: tint each pixel by the cascade it samples (see ShadowCascades.h)
+#variant CASCADES=SHADED,SHOW
+
 #shader vertex
 #version 330 core
 
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 
-uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
-uniform mat4 u_LightSpaceMatrix;
+// Per-instance data (see InstanceBuffer.h); the mat4 occupies locations 8-11
+layout(location = 8) in mat4 a_InstanceModel;
+layout(location = 12) in vec4 a_InstanceColour;
 
+#include "../Include/FrameData.glsl"
 out vec3 FragPos;
 out vec3 Normal;
-out vec4 FragPosLightSpace;
+out float ViewDepth;
+out vec3 InstanceColour;
+
+// Matches DepthPrepass.shader, so the depth written by RenderQueue's
+// depth pre-pass is the depth this draws at
+invariant gl_Position;
 
 void main()
 {
-    FragPos = vec3(u_Model * vec4(aPosition, 1.0));
-    Normal = mat3(transpose(inverse(u_Model))) * aNormal;
-    FragPosLightSpace = u_LightSpaceMatrix * vec4(FragPos, 1.0);
-    gl_Position = u_Projection * u_View * vec4(FragPos, 1.0);
+    FragPos = vec3(a_InstanceModel * vec4(aPosition, 1.0));
+    Normal = mat3(transpose(inverse(a_InstanceModel))) * aNormal;
+    InstanceColour = a_InstanceColour.rgb;
+    vec4 viewPos = u_View * vec4(FragPos, 1.0);
+    ViewDepth = -viewPos.z;
+    gl_Position = u_Projection * viewPos;
 }
 
 #shader fragment
@@ -31,7 +51,7 @@ struct Light
 };
 
 uniform Light u_Light;
-uniform vec3 u_CameraPosition;
+#include "../Include/FrameData.glsl"
 
 uniform float u_AmbientIntensity;
 uniform float u_DiffuseIntensity;
@@ -40,23 +60,47 @@ uniform float u_Shininess;
 
 uniform vec3 u_ObjectColor;
 
-uniform sampler2D u_ShadowMap;
+// One layer per cascade; u_CascadeSplits holds the view distance where
+// each ends, u_CascadeCount how many are in use. Depth, compared by the
+// sampler for HARDWARE; moments for ESM and VSM.
+#if FILTER == FILTER_HARDWARE
+uniform sampler2DArrayShadow u_ShadowMap;
+#else
+uniform sampler2DArray u_ShadowMap;
+#endif
+uniform mat4 u_CascadeViewProjection[4];
+uniform vec4 u_CascadeSplits;
+uniform int u_CascadeCount;
 uniform float u_ShadowBias;
-uniform int u_EnablePCF;
-uniform int u_PCFKernelSize;
+uniform float u_ESMExponent;
+uniform float u_VSMMinVariance;
+uniform float u_LightBleedReduction;   // VSM: cuts off the tail of the bound
+
+#include "../Include/Phong.glsl"
 
 in vec3 FragPos;
 in vec3 Normal;
-in vec4 FragPosLightSpace;
+in float ViewDepth;
+in vec3 InstanceColour;
 
 out vec4 FragColor;
 
-float CalculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
+int SelectCascade()
+{
+    int cascade = 0;
+    for (int i = 0; i < 3; i++)
+        cascade += int(i + 1 < u_CascadeCount && ViewDepth > u_CascadeSplits[i]);
+    return cascade;
+}
+
+float CalculateShadow(int cascade, vec3 normal, vec3 lightDir)
 {
-    // Perspective divide
-    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    // Remap from [-1,1] to [0,1]
-    projCoords = projCoords * 0.5 + 0.5;
+    // Beyond the last split nothing is shadowed
+    if (ViewDepth > u_CascadeSplits[u_CascadeCount - 1])
+        return 0.0;
+
+    // Orthographic: no perspective divide. Remap from [-1,1] to [0,1]
+    vec3 projCoords = (u_CascadeViewProjection[cascade] * vec4(FragPos, 1.0)).xyz * 0.5 + 0.5;
 
     // If outside the light frustum, no shadow
     if (projCoords.z > 1.0)
@@ -69,29 +113,51 @@ float CalculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
 
     float shadow = 0.0;
 
-    if (u_EnablePCF == 1)
+#if FILTER == FILTER_ESM
+    // The blurred exp(c * occluder), times exp(-c * receiver): 1 when lit,
+    // falling off exponentially behind the occluder
+    float moment = texture(u_ShadowMap, vec3(projCoords.xy, cascade)).r;
+    shadow = 1.0 - clamp(moment * exp(-u_ESMExponent * (currentDepth - bias)), 0.0, 1.0);
+#elif FILTER == FILTER_VSM
+    // Chebyshev's upper bound on the fraction of occluders in front
+    vec2 moments = texture(u_ShadowMap, vec3(projCoords.xy, cascade)).rg;
+    float receiver = currentDepth - bias;
+    if (receiver > moments.x)
     {
-        // PCF: sample NxN texels around the fragment
-        vec2 texelSize = 1.0 / textureSize(u_ShadowMap, 0);
-        int halfKernel = u_PCFKernelSize / 2;
-        int samples = 0;
-        for (int x = -halfKernel; x <= halfKernel; ++x)
-        {
-            for (int y = -halfKernel; y <= halfKernel; ++y)
-            {
-                float pcfDepth = texture(u_ShadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-                shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
-                samples++;
-            }
-        }
-        shadow /= float(samples);
+        float variance = max(moments.y - moments.x * moments.x, u_VSMMinVariance);
+        float d = receiver - moments.x;
+        float lit = variance / (variance + d * d);
+        lit = clamp((lit - u_LightBleedReduction) / (1.0 - u_LightBleedReduction), 0.0, 1.0);
+        shadow = 1.0 - lit;
     }
-    else
+#elif FILTER == FILTER_HARDWARE
+    // Each fetch returns the lit fraction of a bilinear 2x2 compare
+    vec2 texelSize = 1.0 / vec2(textureSize(u_ShadowMap, 0).xy);
+    const int halfKernel = PCF_KERNEL / 2;
+    for (int x = -halfKernel; x <= halfKernel; ++x)
     {
-        // Hard shadows: single sample
-        float closestDepth = texture(u_ShadowMap, projCoords.xy).r;
-        shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
+        for (int y = -halfKernel; y <= halfKernel; ++y)
+            shadow += 1.0 - texture(u_ShadowMap, vec4(projCoords.xy + vec2(x, y) * texelSize, cascade, currentDepth - bias));
     }
+    shadow /= float(PCF_KERNEL * PCF_KERNEL);
+#elif PCF_KERNEL > 1
+    // PCF: sample NxN texels around the fragment
+    vec2 texelSize = 1.0 / vec2(textureSize(u_ShadowMap, 0).xy);
+    const int halfKernel = PCF_KERNEL / 2;
+    for (int x = -halfKernel; x <= halfKernel; ++x)
+    {
+        for (int y = -halfKernel; y <= halfKernel; ++y)
+        {
+            float pcfDepth = texture(u_ShadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r;
+            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+        }
+    }
+    shadow /= float(PCF_KERNEL * PCF_KERNEL);
+#else
+    // Hard shadows: single sample
+    float closestDepth = texture(u_ShadowMap, vec3(projCoords.xy, cascade)).r;
+    shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
+#endif
 
     return shadow;
 }
@@ -105,20 +171,25 @@ void main()
     vec3 ambient = u_AmbientIntensity * u_Light.Colour;
 
     // Diffuse
-    float diff = max(dot(norm, lightDir), 0.0);
+    float diff = LambertDiffuse(norm, lightDir);
     vec3 diffuse = u_DiffuseIntensity * diff * u_Light.Colour;
 
     // Specular (Phong)
-    vec3 viewDir = normalize(u_CameraPosition - FragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), u_Shininess);
+    vec3 viewDir = normalize(u_ViewPosition.xyz - FragPos);
+    float spec = PhongSpecular(norm, lightDir, viewDir, u_Shininess);
     vec3 specular = u_SpecularIntensity * spec * u_Light.Colour;
 
     // Shadow
-    float shadow = CalculateShadow(FragPosLightSpace, norm, lightDir);
+    int cascade = SelectCascade();
+    float shadow = CalculateShadow(cascade, norm, lightDir);
 
     // Ambient always applied; shadow only affects diffuse + specular
-    vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * u_ObjectColor;
+    vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * u_ObjectColor * InstanceColour;
+
+#if CASCADES == CASCADES_SHOW
+    const vec3 tints[4] = vec3[](vec3(1.0, 0.5, 0.5), vec3(0.5, 1.0, 0.5), vec3(0.5, 0.5, 1.0), vec3(1.0, 1.0, 0.5));
+    lighting *= tints[cascade];
+#endif
 
     FragColor = vec4(lighting, 1.0);
 }
@@ -0,0 +1,174 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// Constant-initialised, so counting works for allocations made before
+	// main, during static initialisation
+	std::atomic<std::size_t> s_Allocations{ 0 };
+	std::atomic<std::size_t> s_Bytes{ 0 };
+
+	AllocationCounter::Stats s_FrameStart;
+	AllocationCounter::Stats s_LastFrame;
+
+	void* Allocate(std::size_t bytes)
+	{
+		s_Allocations.fetch_add(1, std::memory_order_relaxed);
+		s_Bytes.fetch_add(bytes, std::memory_order_relaxed);
+		// malloc(0) may return null; new never does
+		return std::malloc(bytes ? bytes : 1);
+	}
+
+	void* AllocateAligned(std::size_t bytes, std::size_t alignment)
+	{
+		s_Allocations.fetch_add(1, std::memory_order_relaxed);
+		s_Bytes.fetch_add(bytes, std::memory_order_relaxed);
+#ifdef _MSC_VER
+		return _aligned_malloc(bytes ? bytes : 1, alignment);
+#else
+		// aligned_alloc wants a multiple of the alignment
+		return std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+#endif
+	}
+
+	void FreeAligned(void* p)
+	{
+#ifdef _MSC_VER
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+}
+
+AllocationCounter::Stats AllocationCounter::GetTotal()
+{
+	Stats total;
+	total.allocations = s_Allocations.load(std::memory_order_relaxed);
+	total.bytes = s_Bytes.load(std::memory_order_relaxed);
+	return total;
+}
+
+void AllocationCounter::EndFrame()
+{
+	const Stats total = GetTotal();
+	s_LastFrame.allocations = total.allocations - s_FrameStart.allocations;
+	s_LastFrame.bytes = total.bytes - s_FrameStart.bytes;
+	s_FrameStart = total;
+}
+
+const AllocationCounter::Stats& AllocationCounter::GetLastFrame()
+{
+	return s_LastFrame;
+}
+
+// The replacements. Only the throwing scalar and array forms need to be
+// given for the others to follow in principle, but MSVC's nothrow and
+// aligned forms don't forward to them, so every one is here.
+
+void* operator new(std::size_t bytes)
+{
+	if (void* p = Allocate(bytes))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t bytes)
+{
+	return operator new(bytes);
+}
+
+void* operator new(std::size_t bytes, const std::nothrow_t&) noexcept
+{
+	return Allocate(bytes);
+}
+
+void* operator new[](std::size_t bytes, const std::nothrow_t&) noexcept
+{
+	return Allocate(bytes);
+}
+
+void* operator new(std::size_t bytes, std::align_val_t alignment)
+{
+	if (void* p = AllocateAligned(bytes, static_cast<std::size_t>(alignment)))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t bytes, std::align_val_t alignment)
+{
+	return operator new(bytes, alignment);
+}
+
+void* operator new(std::size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return AllocateAligned(bytes, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return AllocateAligned(bytes, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(p);
+}
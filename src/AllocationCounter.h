@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * AllocationCounter — how often the program goes to the heap, per frame
+ *
+ * Replaces the global operator new and delete (every form: array,
+ * nothrow and over-aligned) with ones that count before calling malloc,
+ * so anything allocating in the frame loop shows up, however deep in a
+ * std::string or std::function it is:
+ *
+ *     AllocationCounter::EndFrame();                  // after the swap
+ *     AllocationCounter::GetLastFrame().allocations;  // 0 is the goal
+ *
+ * The frame's count covers every thread, worker jobs included; the
+ * driver's own mallocs don't go through operator new and aren't in it.
+ * Counting is two relaxed atomic adds per allocation, cheap enough to
+ * leave in a release build, which is where the benchmark runs.
+ * FrameArena is the usual answer to what it finds.
+ */
+class AllocationCounter
+{
+public:
+	struct Stats
+	{
+		std::size_t allocations = 0;
+		std::size_t bytes = 0;      // as asked for, not what malloc rounded up to
+	};
+
+	// Since the program started
+	static Stats GetTotal();
+
+	// Publishes the frame since the last call as GetLastFrame
+	static void EndFrame();
+	static const Stats& GetLastFrame();
+};
@@ -0,0 +1,366 @@
+#include "BVH.h"
+#include "Mesh/Model.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// ---------------------------------------------------------------------------
+// BVH
+// ---------------------------------------------------------------------------
+
+void BVH::Clear()
+{
+	m_Nodes.clear();
+	m_Order.clear();
+	m_Stats = Stats();
+}
+
+void BVH::Build(const std::vector<AABB>& primitiveBounds, unsigned int leafSize)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	Clear();
+	const unsigned int count = static_cast<unsigned int>(primitiveBounds.size());
+	if (count == 0)
+		return;
+
+	if (leafSize == 0)
+		leafSize = 1;
+	if (leafSize > MAX_LEAF_SIZE)
+		leafSize = MAX_LEAF_SIZE;
+
+	m_Order.resize(count);
+	std::vector<glm::vec3> centroids(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		m_Order[i] = i;
+		centroids[i] = primitiveBounds[i].GetCentre();
+	}
+
+	// A binary tree with N leaves has 2N - 1 nodes, so this never reallocates
+	m_Nodes.reserve(2 * count);
+	Node root;
+	root.leftOrFirst = 0;
+	root.count = count;
+	m_Nodes.push_back(root);
+
+	ThreadPool& pool = ThreadPool::Get();
+	std::vector<Deferred> deferred;
+	const bool parallel = count >= PARALLEL_BUILD_SIZE && pool.GetThreadCount() > 0;
+	const unsigned int perTask = count / (8 * (pool.GetThreadCount() + 1));
+	const unsigned int deferBelow = perTask > MIN_TASK_SIZE ? perTask : MIN_TASK_SIZE;
+	Subdivide(m_Nodes, m_Stats, 0, primitiveBounds, centroids, leafSize, 1, parallel ? &deferred : nullptr, deferBelow);
+	if (!deferred.empty())
+		BuildSubtrees(deferred, primitiveBounds, centroids, leafSize);
+
+	m_Stats.nodes = static_cast<unsigned int>(m_Nodes.size());
+	m_Stats.buildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BVH::Subdivide(std::vector<Node>& nodes, Stats& stats, unsigned int nodeIndex, const std::vector<AABB>& bounds,
+	const std::vector<glm::vec3>& centroids, unsigned int leafSize, unsigned int depth,
+	std::vector<Deferred>* deferred, unsigned int deferBelow)
+{
+	const unsigned int first = nodes[nodeIndex].leftOrFirst;
+	const unsigned int count = nodes[nodeIndex].count;
+	if (deferred && count <= deferBelow)
+	{
+		deferred->push_back({ nodeIndex, depth });
+		return;
+	}
+
+	stats.maxDepth = std::max(stats.maxDepth, depth);
+
+	// The node's box, and the box of its centroids to place the bins in
+	AABB box, centroidBox;
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		box.Grow(bounds[m_Order[i]]);
+		centroidBox.Grow(centroids[m_Order[i]]);
+	}
+	nodes[nodeIndex].boundsMin = box.min;
+	nodes[nodeIndex].boundsMax = box.max;
+
+	if (count <= leafSize)
+	{
+		stats.leaves++;
+		return;
+	}
+
+	// Binned SAH: drop every centroid into one of BINS slots per axis, then
+	// sweep the bin boundaries from both ends to cost each split in O(BINS).
+	static const int BINS = 16;
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	const glm::vec3 extent = centroidBox.max - centroidBox.min;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (extent[axis] <= 0.0f)
+			continue;
+
+		AABB binBox[BINS];
+		unsigned int binCount[BINS] = {};
+		const float scale = BINS / extent[axis];
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			const unsigned int primitive = m_Order[i];
+			int bin = static_cast<int>((centroids[primitive][axis] - centroidBox.min[axis]) * scale);
+			bin = std::min(bin, BINS - 1);
+			binCount[bin]++;
+			binBox[bin].Grow(bounds[primitive]);
+		}
+
+		// leftArea[i] / leftCount[i] describe bins [0, i], right ones [i+1, BINS)
+		float leftArea[BINS - 1], rightArea[BINS - 1];
+		unsigned int leftCount[BINS - 1], rightCount[BINS - 1];
+		AABB leftBox, rightBox;
+		unsigned int leftSum = 0, rightSum = 0;
+		for (int i = 0; i < BINS - 1; i++)
+		{
+			leftSum += binCount[i];
+			leftBox.Grow(binBox[i]);
+			leftCount[i] = leftSum;
+			leftArea[i] = leftBox.HalfArea();
+
+			rightSum += binCount[BINS - 1 - i];
+			rightBox.Grow(binBox[BINS - 1 - i]);
+			rightCount[BINS - 2 - i] = rightSum;
+			rightArea[BINS - 2 - i] = rightBox.HalfArea();
+		}
+
+		for (int i = 0; i < BINS - 1; i++)
+		{
+			if (leftCount[i] == 0 || rightCount[i] == 0)
+				continue;
+			const float cost = leftArea[i] * leftCount[i] + rightArea[i] * rightCount[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	// Compare against keeping the node as a leaf: one box test, then the
+	// split's expected primitive tests, versus testing all `count` now.
+	const float parentArea = box.HalfArea();
+	const float splitCost = bestAxis >= 0 && parentArea > 0.0f ? 1.0f + bestCost / parentArea : FLT_MAX;
+
+	unsigned int middle;
+	if (bestAxis >= 0 && (splitCost < count || count > MAX_LEAF_SIZE))
+	{
+		// Partition the slots so the left child's primitives come first
+		const float scale = BINS / extent[bestAxis];
+		unsigned int* begin = m_Order.data() + first;
+		unsigned int* split = std::partition(begin, begin + count, [&](unsigned int primitive)
+		{
+			int bin = static_cast<int>((centroids[primitive][bestAxis] - centroidBox.min[bestAxis]) * scale);
+			return std::min(bin, BINS - 1) <= bestSplit;
+		});
+		middle = static_cast<unsigned int>(split - m_Order.data());
+	}
+	else if (count > MAX_LEAF_SIZE)
+	{
+		// All centroids coincide (e.g. duplicated objects): no plane separates
+		// them, so halve the range to keep leaves bounded.
+		middle = first + count / 2;
+	}
+	else
+	{
+		stats.leaves++;
+		return;
+	}
+
+	// Children go in as an adjacent pair, so the parent stores only the left
+	const unsigned int left = static_cast<unsigned int>(nodes.size());
+	Node leftNode, rightNode;
+	leftNode.leftOrFirst = first;
+	leftNode.count = middle - first;
+	rightNode.leftOrFirst = middle;
+	rightNode.count = first + count - middle;
+	nodes.push_back(leftNode);
+	nodes.push_back(rightNode);
+
+	nodes[nodeIndex].leftOrFirst = left;
+	nodes[nodeIndex].count = 0;
+
+	Subdivide(nodes, stats, left, bounds, centroids, leafSize, depth + 1, deferred, deferBelow);
+	Subdivide(nodes, stats, left + 1, bounds, centroids, leafSize, depth + 1, deferred, deferBelow);
+}
+
+void BVH::BuildSubtrees(const std::vector<Deferred>& deferred, const std::vector<AABB>& bounds,
+	const std::vector<glm::vec3>& centroids, unsigned int leafSize)
+{
+	struct Subtree
+	{
+		std::vector<Node> nodes;    // [0] is the deferred node itself
+		Stats stats;
+	};
+	std::vector<Subtree> subtrees(deferred.size());
+
+	TaskGroup group;
+	for (std::size_t i = 0; i < deferred.size(); i++)
+	{
+		Subtree& subtree = subtrees[i];
+		const Node& root = m_Nodes[deferred[i].node];
+		subtree.nodes.reserve(2 * root.count);
+		subtree.nodes.push_back(root);
+		group.Run([this, &subtree, &bounds, &centroids, leafSize, depth = deferred[i].depth]()
+			{
+				Subdivide(subtree.nodes, subtree.stats, 0, bounds, centroids, leafSize, depth, nullptr, 0);
+			});
+	}
+	group.Wait();
+
+	// Append each subtree after everything built so far. Its children stay
+	// adjacent pairs stored after their parent, which Refit relies on;
+	// only inner nodes' child indices move.
+	for (std::size_t i = 0; i < deferred.size(); i++)
+	{
+		const std::vector<Node>& nodes = subtrees[i].nodes;
+		const unsigned int offset = static_cast<unsigned int>(m_Nodes.size()) - 1;
+		for (std::size_t n = 0; n < nodes.size(); n++)
+		{
+			Node node = nodes[n];
+			if (!node.IsLeaf())
+				node.leftOrFirst += offset;
+			if (n == 0)
+				m_Nodes[deferred[i].node] = node;
+			else
+				m_Nodes.push_back(node);
+		}
+		m_Stats.leaves += subtrees[i].stats.leaves;
+		m_Stats.maxDepth = std::max(m_Stats.maxDepth, subtrees[i].stats.maxDepth);
+	}
+}
+
+void BVH::Refit(const std::vector<AABB>& primitiveBounds)
+{
+	if (m_Nodes.empty() || primitiveBounds.size() != m_Order.size())
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Children are always stored after their parent, so walking the array
+	// backwards visits both children before the node that encloses them.
+	for (size_t i = m_Nodes.size(); i-- > 0;)
+	{
+		Node& node = m_Nodes[i];
+		AABB box;
+		if (node.IsLeaf())
+		{
+			for (unsigned int slot = node.leftOrFirst; slot < node.leftOrFirst + node.count; slot++)
+				box.Grow(primitiveBounds[m_Order[slot]]);
+		}
+		else
+		{
+			const Node& left = m_Nodes[node.leftOrFirst];
+			const Node& right = m_Nodes[node.leftOrFirst + 1];
+			box.min = glm::min(left.boundsMin, right.boundsMin);
+			box.max = glm::max(left.boundsMax, right.boundsMax);
+		}
+		node.boundsMin = box.min;
+		node.boundsMax = box.max;
+	}
+
+	m_Stats.refitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ---------------------------------------------------------------------------
+// TriangleBVH
+// ---------------------------------------------------------------------------
+
+void TriangleBVH::AddMesh(const Mesh& mesh, const glm::mat4& transform)
+{
+	// The full CPU copy, or only the positions once the mesh has released
+	// the rest (Mesh::CpuData::Positions)
+	const std::vector<Vertex>& vertices = mesh.getVertices();
+	const std::vector<glm::vec3>& positions = mesh.getPositions();
+	const std::vector<unsigned int>& indices = mesh.getIndices();
+	if (vertices.empty() && positions.empty())
+		return;
+
+	m_Corners.reserve(m_Corners.size() + indices.size());
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			const unsigned int index = indices[i + corner];
+			const glm::vec3 p = vertices.empty() ? positions[index]
+				: glm::vec3(vertices[index].position[0], vertices[index].position[1], vertices[index].position[2]);
+			m_Corners.push_back(glm::vec3(transform * glm::vec4(p, 1.0f)));
+		}
+	}
+}
+
+void TriangleBVH::Finish()
+{
+	const size_t count = m_Corners.size() / 3;
+	std::vector<AABB> bounds(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		bounds[i].Grow(m_Corners[3 * i + 0]);
+		bounds[i].Grow(m_Corners[3 * i + 1]);
+		bounds[i].Grow(m_Corners[3 * i + 2]);
+	}
+
+	m_BVH.Build(bounds, BVH::SIMD_LEAF_SIZE);
+
+	// Copy the triangles out in leaf order, so each leaf is a contiguous run
+	const std::vector<unsigned int>& order = m_BVH.GetPrimitiveOrder();
+	m_Triangles.Resize(count);
+	for (size_t slot = 0; slot < count; slot++)
+	{
+		const glm::vec3* corners = &m_Corners[3 * order[slot]];
+		m_Triangles.Set(slot, corners[0], corners[1], corners[2]);
+	}
+
+	std::vector<glm::vec3>().swap(m_Corners);
+}
+
+void TriangleBVH::Build(const Mesh& mesh, const glm::mat4& transform)
+{
+	m_Corners.clear();
+	AddMesh(mesh, transform);
+	Finish();
+}
+
+void TriangleBVH::Build(const Model& model, const glm::mat4& transform)
+{
+	m_Corners.clear();
+	for (const ModelMesh& mesh : model.getMeshes())
+		AddMesh(mesh, transform);
+	Finish();
+}
+
+bool TriangleBVH::IntersectNearest(const Ray& ray, RayHit& hit) const
+{
+	// Leaves are visited with ever smaller t, so the last leaf to report a
+	// hit holds the nearest triangle and its barycentrics.
+	float u = 0.0f, v = 0.0f;
+	bool found = m_BVH.IntersectNearestLeaves(ray, hit, [&](const Ray& r, unsigned int first, unsigned int count, float& t)
+	{
+		return RayKernels::IntersectTriangles(r, m_Triangles, first, count, t, u, v);
+	});
+
+	if (found)
+	{
+		hit.u = u;
+		hit.v = v;
+	}
+	return found;
+}
+
+bool TriangleBVH::IntersectAny(const Ray& ray, float tMax) const
+{
+	return m_BVH.IntersectAnyLeaves(ray, tMax, [&](const Ray& r, unsigned int first, unsigned int count, float& t)
+	{
+		float u, v;
+		return RayKernels::IntersectTriangles(r, m_Triangles, first, count, t, u, v);
+	});
+}
@@ -0,0 +1,456 @@
+#pragma once
+#include <cfloat>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "RayKernels.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+class Mesh;
+class Model;
+
+/**
+ * BVH — bounding volume hierarchy for ray queries
+ *
+ * Testing a ray against every object is O(N): fine for three spheres,
+ * hopeless for a hundred thousand or for the triangles of a dense model.
+ * A BVH is a binary tree of boxes: each node's box encloses everything
+ * below it, so a ray that misses a node's box skips that whole subtree.
+ * A query typically visits O(log N) nodes.
+ *
+ * BUILD (surface area heuristic)
+ *   The chance that a random ray hitting a parent box also hits a child
+ *   is roughly area(child) / area(parent). So the expected cost of
+ *   splitting a node is
+ *
+ *       cost = 1 + (area(L) * count(L) + area(R) * count(R)) / area(parent)
+ *
+ *   and a node is only split when that beats testing all its primitives
+ *   (cost = count). Candidate splits are the boundaries of 16 equal bins
+ *   along each axis, which is almost as good as trying every primitive
+ *   and much cheaper to evaluate.
+ *
+ *   A large tree is built in parallel: the first few levels are split on
+ *   the calling thread, then each subtree below is a TaskGroup task. Its
+ *   primitives are a contiguous range of the order array, so the tasks
+ *   never touch the same slots, and each builds its nodes into a vector
+ *   of its own that is appended to the tree once they are all done.
+ *   The result is the same tree, except for node order.
+ *
+ * LAYOUT
+ *   Nodes are 32 bytes, stored in one array: two fit in a cache line and
+ *   the two children of a node are always adjacent, so a node needs only
+ *   one index. Leaves index a contiguous range of GetPrimitiveOrder(), the
+ *   primitive indices reordered so each leaf's primitives sit together.
+ *
+ * REFIT
+ *   When primitives move a little, Refit recomputes every box bottom-up
+ *   from new primitive bounds without changing the tree: O(N) and much
+ *   cheaper than a rebuild, though the tree gets less efficient as objects
+ *   drift far from where it was built.
+ *
+ * QUERIES
+ *   The tree only knows primitive boxes; the caller supplies the exact
+ *   test as a function (ray, primitive, tMax in/out) -> hit, so the same
+ *   BVH works for spheres, boxes or triangles:
+ *
+ *     Nearest  — closest hit; children are visited nearest box first and
+ *                anything beyond the best hit so far is skipped.
+ *     Any      — stops at the first hit (shadow / line-of-sight rays).
+ *     Packet   — several rays traverse together; each node box is loaded
+ *                once and tested against every ray still active.
+ *
+ *   The *Leaves variants hand the callback a whole leaf instead, as a
+ *   range of slots in GetPrimitiveOrder(). Data stored in that order can
+ *   then be tested several primitives at a time (see RayKernels.h).
+ *
+ * Usage:
+ *     std::vector<AABB> bounds = ...;        // one per primitive
+ *     bvh.Build(bounds);
+ *     RayHit hit;
+ *     bvh.IntersectNearest(ray, hit, [&](const Ray& r, unsigned int prim, float& t)
+ *         { return RayIntersectSphere(r, centres[prim], radii[prim], t); });
+ */
+
+class BVH
+{
+public:
+	static const unsigned int DEFAULT_LEAF_SIZE = 4;   // a leaf is made at this size or below
+	static const unsigned int MAX_LEAF_SIZE = 16;      // ...and never above this, whatever the SAH says
+	// For leaves tested with RayKernels: at least one full register
+	static const unsigned int SIMD_LEAF_SIZE = RayKernels::WIDTH > DEFAULT_LEAF_SIZE ? RayKernels::WIDTH : DEFAULT_LEAF_SIZE;
+	static const unsigned int MAX_PACKET_SIZE = 64;
+	static const unsigned int STACK_SIZE = 128;      // traversal stack held inline; a deeper tree spills to the heap
+
+	struct Node
+	{
+		glm::vec3    boundsMin;
+		unsigned int leftOrFirst;   // inner: left child (right = left + 1); leaf: first primitive slot
+		glm::vec3    boundsMax;
+		unsigned int count;         // 0 for inner nodes, else primitives in the leaf
+
+		bool IsLeaf() const { return count > 0; }
+	};
+
+	struct Stats
+	{
+		unsigned int nodes = 0;
+		unsigned int leaves = 0;
+		unsigned int maxDepth = 0;
+		float        buildMs = 0.0f;
+		float        refitMs = 0.0f;
+	};
+
+	void Build(const std::vector<AABB>& primitiveBounds, unsigned int leafSize = DEFAULT_LEAF_SIZE);
+
+	// Same tree, new boxes. primitiveBounds is indexed like the Build input
+	// and must have the same size.
+	void Refit(const std::vector<AABB>& primitiveBounds);
+
+	void Clear();
+
+	// Closest primitive along the ray. `hit.t` on entry limits the search
+	// (FLT_MAX by default). Returns hit.IsHit().
+	// Intersect: bool(const Ray&, unsigned int primitive, float& t)
+	template<typename Intersect>
+	bool IntersectNearest(const Ray& ray, RayHit& hit, Intersect&& intersect) const;
+
+	// True as soon as any primitive closer than tMax is hit.
+	template<typename Intersect>
+	bool IntersectAny(const Ray& ray, float tMax, Intersect&& intersect) const;
+
+	// As above, one call per leaf:
+	// IntersectLeaf: unsigned int(const Ray&, unsigned int firstSlot, unsigned int count, float& t)
+	// returning the slot of the nearest hit closer than t (lowering t), or
+	// RayHit::NONE. hit.primitive is still the caller's primitive index.
+	template<typename IntersectLeaf>
+	bool IntersectNearestLeaves(const Ray& ray, RayHit& hit, IntersectLeaf&& intersectLeaf) const;
+	template<typename IntersectLeaf>
+	bool IntersectAnyLeaves(const Ray& ray, float tMax, IntersectLeaf&& intersectLeaf) const;
+
+	// Nearest hit for each of `count` rays (count <= MAX_PACKET_SIZE). Most
+	// efficient when the rays are coherent, e.g. neighbouring pixels.
+	template<typename Intersect>
+	void IntersectPacket(const Ray* rays, RayHit* hits, unsigned int count, Intersect&& intersect) const;
+
+	const std::vector<Node>& GetNodes() const { return m_Nodes; }
+	const std::vector<unsigned int>& GetPrimitiveOrder() const { return m_Order; }
+	unsigned int GetPrimitiveCount() const { return static_cast<unsigned int>(m_Order.size()); }
+	bool IsEmpty() const { return m_Nodes.empty(); }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	// From this many primitives, Build splits only the top of the tree
+	// itself and hands the subtrees below to the ThreadPool: as many as
+	// eight per thread, each of at least MIN_TASK_SIZE primitives
+	static const unsigned int PARALLEL_BUILD_SIZE = 16384;
+	static const unsigned int MIN_TASK_SIZE = 1024;
+
+	// A node left for a task to subdivide
+	struct Deferred
+	{
+		unsigned int node;
+		unsigned int depth;
+	};
+
+	// Splits nodes[node] and, recursively, its children. With `deferred`,
+	// a node of deferBelow primitives or fewer is added to it instead.
+	void Subdivide(std::vector<Node>& nodes, Stats& stats, unsigned int node, const std::vector<AABB>& bounds,
+		const std::vector<glm::vec3>& centroids, unsigned int leafSize, unsigned int depth,
+		std::vector<Deferred>* deferred, unsigned int deferBelow);
+	// Each deferred node's subtree on a worker, then appended to m_Nodes
+	void BuildSubtrees(const std::vector<Deferred>& deferred, const std::vector<AABB>& bounds,
+		const std::vector<glm::vec3>& centroids, unsigned int leafSize);
+
+	// Slab test against a node's box; returns the entry distance, or
+	// FLT_MAX on a miss or when the box starts beyond tMax.
+	static float IntersectNode(const Ray& ray, const Node& node, float tMax);
+
+	// The traversals' node stack: STACK_SIZE entries on the C++ stack,
+	// then a vector, so a degenerate tree costs an allocation rather than
+	// dropping the subtrees that don't fit
+	template<typename T>
+	class TraversalStack
+	{
+	public:
+		bool IsEmpty() const { return m_Size == 0; }
+
+		void Push(const T& entry)
+		{
+			if (m_Size < STACK_SIZE)
+				m_Inline[m_Size] = entry;
+			else
+				m_Overflow.push_back(entry);
+			m_Size++;
+		}
+
+		T Pop()
+		{
+			m_Size--;
+			if (m_Size < STACK_SIZE)
+				return m_Inline[m_Size];
+			T entry = m_Overflow.back();
+			m_Overflow.pop_back();
+			return entry;
+		}
+
+	private:
+		T m_Inline[STACK_SIZE];
+		std::vector<T> m_Overflow;
+		unsigned int m_Size = 0;
+	};
+
+	// Index of the lowest set bit (mask != 0), to walk a packet's ray mask
+	static unsigned int LowestBit(uint64_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return static_cast<unsigned int>(index);
+#else
+		return static_cast<unsigned int>(__builtin_ctzll(mask));
+#endif
+	}
+
+	std::vector<Node> m_Nodes;
+	std::vector<unsigned int> m_Order;   // leaf slot -> primitive index
+	Stats m_Stats;
+};
+
+/**
+ * TriangleBVH — a BVH over the triangles of a Mesh or Model, for picking
+ * against actual geometry rather than bounding spheres.
+ *
+ * The triangles are copied out with their vertices already transformed,
+ * in leaf order as a TriangleSoA, so a query never goes back to the mesh's
+ * vertex or index arrays and each leaf is tested with the SIMD kernel.
+ * It needs the meshes' CPU copies, at least Mesh::CpuData::Positions; a
+ * mesh that kept less adds no triangles.
+ */
+class TriangleBVH
+{
+public:
+	void Build(const Mesh& mesh, const glm::mat4& transform = glm::mat4(1.0f));
+	void Build(const Model& model, const glm::mat4& transform = glm::mat4(1.0f));
+
+	// hit.primitive is the triangle index in build order (mesh by mesh,
+	// three indices per triangle), hit.u/v its barycentrics.
+	bool IntersectNearest(const Ray& ray, RayHit& hit) const;
+	bool IntersectAny(const Ray& ray, float tMax) const;
+
+	unsigned int GetTriangleCount() const { return m_BVH.GetPrimitiveCount(); }
+	const BVH& GetBVH() const { return m_BVH; }
+
+private:
+	void AddMesh(const Mesh& mesh, const glm::mat4& transform);
+	void Finish();
+
+	std::vector<glm::vec3> m_Corners;   // three per triangle, build order; freed by Finish
+	TriangleSoA m_Triangles;            // leaf order
+	BVH m_BVH;
+};
+
+// ---------------------------------------------------------------------------
+// Traversal templates
+// ---------------------------------------------------------------------------
+
+inline float BVH::IntersectNode(const Ray& ray, const Node& node, float tMax)
+{
+	// Slab test: the distances at which the ray crosses each pair of
+	// planes; it is inside the box between the latest entry and the
+	// earliest exit.
+	const glm::vec3 t0 = (node.boundsMin - ray.origin) * ray.inverseDirection;
+	const glm::vec3 t1 = (node.boundsMax - ray.origin) * ray.inverseDirection;
+	const glm::vec3 tSmall = glm::min(t0, t1);
+	const glm::vec3 tLarge = glm::max(t0, t1);
+
+	const float tEnter = glm::max(glm::max(tSmall.x, tSmall.y), glm::max(tSmall.z, 0.0f));
+	const float tExit = glm::min(glm::min(tLarge.x, tLarge.y), glm::min(tLarge.z, tMax));
+	return tEnter <= tExit ? tEnter : FLT_MAX;
+}
+
+template<typename Intersect>
+bool BVH::IntersectNearest(const Ray& ray, RayHit& hit, Intersect&& intersect) const
+{
+	return IntersectNearestLeaves(ray, hit, [&](const Ray& r, unsigned int first, unsigned int count, float& t)
+	{
+		unsigned int nearest = RayHit::NONE;
+		for (unsigned int slot = first; slot < first + count; slot++)
+		{
+			if (intersect(r, m_Order[slot], t))
+				nearest = slot;
+		}
+		return nearest;
+	});
+}
+
+template<typename Intersect>
+bool BVH::IntersectAny(const Ray& ray, float tMax, Intersect&& intersect) const
+{
+	return IntersectAnyLeaves(ray, tMax, [&](const Ray& r, unsigned int first, unsigned int count, float& t)
+	{
+		for (unsigned int slot = first; slot < first + count; slot++)
+		{
+			if (intersect(r, m_Order[slot], t))
+				return slot;
+		}
+		return RayHit::NONE;
+	});
+}
+
+template<typename IntersectLeaf>
+bool BVH::IntersectNearestLeaves(const Ray& ray, RayHit& hit, IntersectLeaf&& intersectLeaf) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	TraversalStack<unsigned int> stack;
+	unsigned int current = 0;
+
+	if (IntersectNode(ray, m_Nodes[0], hit.t) == FLT_MAX)
+		return false;
+
+	while (true)
+	{
+		const Node& node = m_Nodes[current];
+		if (node.IsLeaf())
+		{
+			float t = hit.t;
+			const unsigned int slot = intersectLeaf(ray, node.leftOrFirst, node.count, t);
+			if (slot != RayHit::NONE)
+			{
+				hit.t = t;
+				hit.primitive = m_Order[slot];
+			}
+		}
+		else
+		{
+			// Visit the nearer child first; push the farther one for later
+			unsigned int near = node.leftOrFirst;
+			unsigned int far = node.leftOrFirst + 1;
+			float tNear = IntersectNode(ray, m_Nodes[near], hit.t);
+			float tFar = IntersectNode(ray, m_Nodes[far], hit.t);
+			if (tFar < tNear)
+			{
+				std::swap(near, far);
+				std::swap(tNear, tFar);
+			}
+
+			if (tNear != FLT_MAX)
+			{
+				if (tFar != FLT_MAX)
+					stack.Push(far);
+				current = near;
+				continue;
+			}
+		}
+
+		// Pop, skipping nodes the best hit so far has made irrelevant
+		bool found = false;
+		while (!stack.IsEmpty())
+		{
+			current = stack.Pop();
+			if (IntersectNode(ray, m_Nodes[current], hit.t) != FLT_MAX)
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			break;
+	}
+
+	return hit.IsHit();
+}
+
+template<typename IntersectLeaf>
+bool BVH::IntersectAnyLeaves(const Ray& ray, float tMax, IntersectLeaf&& intersectLeaf) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	TraversalStack<unsigned int> stack;
+	stack.Push(0);
+
+	while (!stack.IsEmpty())
+	{
+		const Node& node = m_Nodes[stack.Pop()];
+		if (IntersectNode(ray, node, tMax) == FLT_MAX)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			float t = tMax;
+			if (intersectLeaf(ray, node.leftOrFirst, node.count, t) != RayHit::NONE)
+				return true;
+		}
+		else
+		{
+			stack.Push(node.leftOrFirst + 1);
+			stack.Push(node.leftOrFirst);
+		}
+	}
+
+	return false;
+}
+
+template<typename Intersect>
+void BVH::IntersectPacket(const Ray* rays, RayHit* hits, unsigned int count, Intersect&& intersect) const
+{
+	if (m_Nodes.empty() || count == 0)
+		return;
+	if (count > MAX_PACKET_SIZE)
+		count = MAX_PACKET_SIZE;
+
+	// Each stack entry carries the rays that hit it, so a subtree only
+	// tests rays that reached its parent.
+	struct Entry { unsigned int node; uint64_t active; };
+	TraversalStack<Entry> stack;
+
+	const uint64_t all = count == 64 ? ~0ull : ((1ull << count) - 1);
+	stack.Push({ 0, all });
+
+	while (!stack.IsEmpty())
+	{
+		Entry entry = stack.Pop();
+		const Node& node = m_Nodes[entry.node];
+
+		uint64_t active = 0;
+		for (uint64_t mask = entry.active; mask; mask &= mask - 1)
+		{
+			const unsigned int r = LowestBit(mask);
+			if (IntersectNode(rays[r], node, hits[r].t) != FLT_MAX)
+				active |= 1ull << r;
+		}
+		if (!active)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (unsigned int i = 0; i < node.count; i++)
+			{
+				const unsigned int primitive = m_Order[node.leftOrFirst + i];
+				for (uint64_t mask = active; mask; mask &= mask - 1)
+				{
+					const unsigned int r = LowestBit(mask);
+					float t = hits[r].t;
+					if (intersect(rays[r], primitive, t))
+					{
+						hits[r].t = t;
+						hits[r].primitive = primitive;
+					}
+				}
+			}
+		}
+		else
+		{
+			stack.Push({ node.leftOrFirst + 1, active });
+			stack.Push({ node.leftOrFirst, active });
+		}
+	}
+}
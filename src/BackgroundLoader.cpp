@@ -0,0 +1,147 @@
+#include "BackgroundLoader.h"
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+static std::unique_ptr<BackgroundLoader> s_Loader;
+
+BackgroundLoader::BackgroundLoader(GLFWwindow* context)
+	: m_Context(context)
+{
+	m_Thread = std::thread([this]() { Run(); });
+}
+
+BackgroundLoader::~BackgroundLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+		m_Queue.clear();
+	}
+	m_Wake.notify_one();
+	m_Thread.join();
+
+	// Finished but never handed over; the objects are shared, so are the fences
+	for (Finished& finished : m_Finished)
+		glDeleteSync(finished.fence);
+	glfwDestroyWindow(m_Context);
+}
+
+void BackgroundLoader::Submit(const std::string& name, Job work, Job ready)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Queue.push_back({ name, std::move(work), std::move(ready) });
+		m_Stats.submitted++;
+	}
+	m_Wake.notify_one();
+}
+
+void BackgroundLoader::Run()
+{
+	glfwMakeContextCurrent(m_Context);
+
+	while (true)
+	{
+		Pending job;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wake.wait(lock, [this]() { return m_Stopping || !m_Queue.empty(); });
+			if (m_Stopping)
+				break;
+			job = std::move(m_Queue.front());
+			m_Queue.pop_front();
+			m_Stats.current = job.name;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		job.work();
+
+		// The job's commands are only queued; the main thread waits for
+		// this before using anything they made. Flush so it can signal.
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+		const float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Finished.push_back({ fence, std::move(job.ready) });
+		m_Stats.busyMs += ms;
+		m_Stats.current.clear();
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+void BackgroundLoader::Update()
+{
+	std::vector<Job> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (std::size_t i = 0; i < m_Finished.size();)
+		{
+			const GLenum status = glClientWaitSync(m_Finished[i].fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			{
+				i++;
+				continue;
+			}
+			glDeleteSync(m_Finished[i].fence);
+			ready.push_back(std::move(m_Finished[i].ready));
+			m_Finished.erase(m_Finished.begin() + i);
+			m_Stats.completed++;
+		}
+	}
+
+	// Outside the lock: a callback may Submit the next job
+	for (Job& job : ready)
+	{
+		if (job)
+			job();
+	}
+}
+
+BackgroundLoader::Stats BackgroundLoader::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	Stats stats = m_Stats;
+	stats.queued = static_cast<unsigned int>(m_Queue.size());
+	return stats;
+}
+
+bool BackgroundLoader::Init(GLFWwindow* mainWindow)
+{
+	if (s_Loader)
+		return true;
+
+	// Same version, profile and debug hints as the main window, still set;
+	// never shown, so its size does not matter
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* context = glfwCreateWindow(1, 1, "Background loader", nullptr, mainWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (!context)
+	{
+		std::cout << "WARNING:: No shared GL context for background loading\n";
+		return false;
+	}
+
+	s_Loader.reset(new BackgroundLoader(context));
+	return true;
+}
+
+bool BackgroundLoader::IsAlive()
+{
+	return s_Loader != nullptr;
+}
+
+BackgroundLoader& BackgroundLoader::Get()
+{
+	return *s_Loader;
+}
+
+void BackgroundLoader::Shutdown()
+{
+	s_Loader.reset();
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <GL/glew.h>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct GLFWwindow;
+
+/**
+ * BackgroundLoader — GL work on a second context, off the main thread
+ *
+ * ThreadPool workers may not call gl* (see ThreadPool.h), so everything
+ * that creates a GL object still runs in the frame: compiling a test's
+ * shaders, for one, is what makes opening it from the TestMenu hitch.
+ * The loader owns one thread with a context of its own, created hidden
+ * and SHARING objects with the main window's. GL work submitted to it
+ * runs there, while the main thread keeps drawing:
+ *
+ *     BackgroundLoader::Get().Submit("PBR shaders",
+ *         []() { Shader::Prebuild("res/Shaders/Lighting/PBR.shader"); },
+ *         []() { ... on the main thread, once the work is done ... });
+ *
+ * HAND-OVER
+ *   Commands a context issues are only queued, even after the job's code
+ *   returns. The loader puts a fence (glFenceSync) after every job and
+ *   flushes, and Update, on the main thread, runs the job's `ready`
+ *   callback only once glClientWaitSync says the fence has signalled.
+ *   From then on whatever the job made is complete, and usable on the
+ *   main context once bound there. Update never waits for a fence.
+ *
+ * WHAT A JOB MAY DO
+ *   Only objects shared between contexts cross over: buffers, textures,
+ *   shaders and programs (and the files they are cached in). Container
+ *   objects (vertex arrays, framebuffers, program pipelines) belong to the
+ *   context that made them. Jobs also must not touch the engine's GL-side
+ *   singletons (GLState, GpuResources, GpuMemory, MeshArena, TextureCache)
+ *   or GlCall, none of which are thread-safe: plain gl* calls only. In
+ *   practice a job fills a cache the main thread then reads cheaply, as
+ *   Shader::Prebuild does for ShaderCache.
+ *
+ * Init runs on the main thread after glewInit (GLFW creates windows there
+ * only); Shutdown finishes the job in progress, drops the queued ones and
+ * must run before the main window is destroyed.
+ */
+class BackgroundLoader
+{
+public:
+	struct Stats
+	{
+		unsigned int submitted = 0;
+		unsigned int completed = 0;        // `ready` has run
+		unsigned int queued = 0;           // not started yet
+		float busyMs = 0.0f;               // time the loader spent in jobs
+		std::string current;               // job running now, if any
+	};
+
+	typedef std::function<void()> Job;
+
+	// Run `work` on the loader's context, then `ready` (may be empty) on
+	// the main thread in the first Update after the GPU has finished it
+	void Submit(const std::string& name, Job work, Job ready = Job());
+
+	// Run the `ready` callbacks of finished jobs. Main thread, once a frame.
+	void Update();
+
+	Stats GetStats() const;
+
+	// False if the shared context could not be created; then nothing runs
+	static bool Init(GLFWwindow* mainWindow);
+	static bool IsAlive();
+	static BackgroundLoader& Get();
+	static void Shutdown();
+
+	~BackgroundLoader();
+	BackgroundLoader(const BackgroundLoader&) = delete;
+	BackgroundLoader& operator=(const BackgroundLoader&) = delete;
+
+private:
+	explicit BackgroundLoader(GLFWwindow* context);
+
+	struct Pending
+	{
+		std::string name;
+		Job work;
+		Job ready;
+	};
+
+	struct Finished
+	{
+		GLsync fence = nullptr;
+		Job ready;
+	};
+
+	void Run();
+
+	GLFWwindow* m_Context;             // hidden, current on m_Thread only
+	std::thread m_Thread;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Wake;
+	std::deque<Pending> m_Queue;
+	std::vector<Finished> m_Finished;   // fenced, waiting for Update
+	bool m_Stopping = false;
+	Stats m_Stats;
+};
@@ -9,6 +9,27 @@
 #include "VertexBufferLayout.h"     // Custom layout wrapper for vertex attributes
 #include "Renderer.h"               // Custom renderer wrapper
 #include "Shader.h"                 // Custom shader wrapper
+#include "GLState.h"                // Redundant state change filter
+#include "GLDebug.h"                // KHR_debug message callback
+#include "Mesh/MeshArena.h"         // Shared vertex/index buffers for every Mesh
+#include "Mesh/GeometryFactory.h"   // Shared primitive geometry
+#include "FrameUniforms.h"          // Per-frame camera/time uniform block
+#include "ShaderCache.h"            // On-disk program binaries
+#include "ShaderLibrary.h"          // Programs shared between tests, #include
+#include "TextureStreamer.h"        // Background texture loading
+#include "BackgroundLoader.h"       // GL work on a shared context, off the main thread
+#include "TextureCooker.h"          // PNG -> BC1/BC3 DDS conversion
+#include "TextureCache.h"           // One Texture per image file
+#include "GpuResources.h"           // Pooled buffers/textures, fence-deferred deletion
+#include "Profiler.h"               // Nested CPU/GPU timing scopes
+#include "FramePacer.h"             // Frames in flight, latency estimate
+#include "RenderOnDemand.h"         // Reuse the last frame while nothing changes
+#include "GpuMemory.h"              // GPU memory by resource type
+#include "FrameArena.h"             // Per-frame scratch allocations
+#include "AllocationCounter.h"      // Heap allocations per frame
+#include "Input.h"                  // Input snapshots, recording and replay
+#include "ThreadPool.h"             // Worker threads, task groups, main-thread queue
+#include "TransformHierarchy.h"     // Parent/child transforms, cached world matrices
 #include "tests/testEffects.h"
 #include "tests/TestLightingShader.h"
 #include "tests/TestMultipleLightSources.h"
@@ -21,19 +42,34 @@
 #include "tests/TestParticleSystem.h"
 #include "tests/TestGPUParticles.h"
 #include "tests/TestShadowMapping.h"
+#include "tests/TestJobSystem.h"
 #include "tests/Tests.h"
+#include "tests/BenchmarkRunner.h"
+#include "tests/BenchmarkCompare.h"
 
 #include "vendor/imgui/imgui.h"     // Dear ImGui library for GUI elements
 #include "vendor/imgui/imgui_impl_glfw.h" // ImGui GLFW backend
 #include "vendor/imgui/imgui_impl_opengl3.h" // ImGui OpenGL backend
 #include "tests/testCamera.h"
 #include "tests/TestHighDensityMesh.h"
+#include "tests/TestGPUCulling.h"
 
 
 
 #define IMGUI_IMPL_OPENGL_LOADER_GLEW // ImGui macro to specify GLEW as the OpenGL loader
 
-int main() {
+int main(int argc, char** argv) {
+    // --compare checks two benchmark runs for regressions and exits, with
+    // no window (see BenchmarkCompare.h)
+    if (test::BenchmarkCompare::IsRequested(argc, argv))
+        return test::BenchmarkCompare::Run(argc, argv);
+
+    // --benchmark runs every test unattended instead of showing the menu
+    // (see BenchmarkRunner.h)
+    test::BenchmarkRunner::Settings benchmarkSettings;
+    if (!test::BenchmarkRunner::ParseArguments(argc, argv, benchmarkSettings))
+        return -1;
+
     // Initialize GLFW to create a window and manage the OpenGL context
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW \n";
@@ -44,9 +80,22 @@ int main() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4); // Major version 4
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // Minor version 3 (OpenGL 4.3 for compute shaders)
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // Core profile
+#if defined(_DEBUG)
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE); // Ask the driver for full debug output
+#endif
 
-    // Create a windowed mode window and OpenGL context
-    GLFWwindow* window = glfwCreateWindow(1920, 1080, "GLFW Window", NULL, NULL);
+    // Create a windowed mode window and OpenGL context; a benchmark fixes
+    // its size, and can keep it off screen
+    int windowWidth = 1920, windowHeight = 1080;
+    if (benchmarkSettings.enabled)
+    {
+        windowWidth = benchmarkSettings.width;
+        windowHeight = benchmarkSettings.height;
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        if (benchmarkSettings.hidden)
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
+    GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, "GLFW Window", NULL, NULL);
     if (!window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -63,7 +112,29 @@ int main() {
     }
     std::cout << "GLEW VERSION:" << glGetString(GL_VERSION) << std::endl;
 
-    glfwSwapInterval(1); // Enable V-Sync for smoother rendering
+    // Route driver errors and warnings through the debug callback. Debug builds
+    // start synchronous so messages carry the GlCall file/line.
+#if defined(_DEBUG)
+    GLDebug::Init(true, GLDebug::Severity::Low);
+    GLDebug::SetBreakOnError(true);
+#else
+    GLDebug::Init(false, GLDebug::Severity::High);
+#endif
+
+    // Compile shaders on the driver's threads where supported, so opening a
+    // test doesn't freeze the window (see Shader.h)
+    if (Shader::EnableParallelCompile())
+        std::cout << "Parallel shader compilation enabled" << std::endl;
+
+    // A second context for preloading tests (see BackgroundLoader.h); not
+    // for benchmarks, whose load timings should not depend on it
+    if (!benchmarkSettings.enabled)
+        BackgroundLoader::Init(window);
+
+    // Enable V-Sync for smoother rendering; off to benchmark, so throughput
+    // above the refresh rate shows. Either way the FramePacer bounds how far
+    // the CPU runs ahead of the GPU.
+    FramePacer::SetVSync(!benchmarkSettings.enabled);
 
 
     // Scoped block for managing OpenGL resources
@@ -104,9 +175,24 @@ int main() {
         TestMenu->RegisterTest<test::TestGPUParticles>("GPU Particles", window);
         TestMenu->RegisterTest<test::TestShadowMapping>("Shadow Mapping", window);
 		TestMenu->RegisterTest<test::TestHighDensityMesh>("High Density Mesh", window);
+		TestMenu->RegisterTest<test::TestGPUCulling>("GPU Culling", window);
 		TestMenu->RegisterTest<test::TestCamera>("Camera", window);
+		TestMenu->RegisterTest<test::TestJobSystem>("Job System");
+        TestMenu->PreloadAll();   // tests with a static Preload(), in the background
+
+        test::BenchmarkRunner* benchmark = benchmarkSettings.enabled
+            ? new test::BenchmarkRunner(*TestMenu, benchmarkSettings) : nullptr;
+        int exitCode = 0;   // a benchmark whose results couldn't be written fails
         float lastTimeFrame = 0.0f;
         float deltaTime = 0.0f;
+        TextureCooker::Result lastCook;     // shown in the control panel
+        bool showProfiler = false;
+        char inputPath[256] = "input.rec";  // recording to make or replay
+        bool recordFixedStep = true;
+        char tracePath[256] = "profile_trace.json";
+        int traceFrames = 10;
+        if (!benchmarkSettings.replay.empty() && !Input::ArmReplay(benchmarkSettings.replay))
+            return -1;
 
 
 	// Main rendering loop
@@ -118,6 +204,26 @@ int main() {
 
             lastTimeFrame = currentFrameTime;
 
+            // The benchmark picks the test and steps time at a fixed rate
+            if (benchmark)
+            {
+                currentTest = benchmark->BeginFrame();
+                if (!currentTest)
+                    break;
+                deltaTime = benchmark->GetDeltaTime();
+            }
+
+            FramePacer::BeginFrame(); // Frame number/index for the rings; input was just polled
+            GLState::BeginFrame(); // Publish last frame's state change counters and resync the cache
+            Shader::BeginFrame();  // Same for the uniform set counters
+            Profiler::BeginFrame(); // Read back old queries, open the Frame scope
+            FrameUniforms::SetTime(currentFrameTime, deltaTime); // u_Time in every shader's FrameData block
+            if (TextureStreamer::IsAlive())
+                TextureStreamer::Get().Update(); // Swap in textures that finished loading
+            ThreadPool::Get().RunMainThreadTasks(); // GL work posted by workers
+            if (BackgroundLoader::IsAlive())
+                BackgroundLoader::Get().Update(); // Hand over what the loader context finished
+
             renderer.Clear(); // Clear the screen to prepare for a new frame
             //renderer.ClearColour_White();
 
@@ -125,37 +231,399 @@ int main() {
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplGlfw_NewFrame();
             ImGui::NewFrame();
+            // A test opened with parallel compilation on starts with pending
+            // shaders. Running it would wait on them, so until they are all
+            // linked show a loading message instead.
+            const unsigned int pendingShaders = Shader::PollPending();
             if (currentTest)
             {
-                currentTest->Update(deltaTime);
-                currentTest->Render();
+                const bool loading = pendingShaders > 0 && currentTest != TestMenu;
+                if (!loading)
+                {
+                    // Only frames the test runs step a replay, so it stays
+                    // in step with the test's Updates
+                    deltaTime = Input::BeginFrame(window, deltaTime);
+                    {
+                        PROFILE_SCOPE("Update");
+                        currentTest->Update(deltaTime);
+                    }
+                    {
+                        // Every transform the Update moved, once, before anything draws
+                        PROFILE_SCOPE("Transforms");
+                        TransformHierarchy::Get().Update();
+                    }
+
+                    // Anything that could make this frame differ from the
+                    // last (see RenderOnDemand.h). The request is taken
+                    // every frame, so an old one can't linger.
+                    const bool requested = currentTest->TakeRenderRequest();
+                    const ImGuiIO& io = ImGui::GetIO();
+                    const TextureStreamer::Stats streaming = TextureStreamer::IsAlive()
+                        ? TextureStreamer::Get().GetStats() : TextureStreamer::Stats();
+                    const bool changed = requested || currentTest->IsAnimating() || Input::IsActive()
+                        || io.MouseWheel != 0.0f || io.MouseWheelH != 0.0f || ImGui::IsAnyItemActive()
+                        || pendingShaders > 0 || streaming.completed + streaming.failed < streaming.requested
+                        || Profiler::IsCapturingTrace();
+                    int width = 0, height = 0;
+                    glfwGetFramebufferSize(window, &width, &height);
+                    if (RenderOnDemand::BeginFrame(width, height, changed))
+                    {
+                        PROFILE_SCOPE("Render");
+                        currentTest->Render();
+                    }
+                    RenderOnDemand::EndScene(); // Keep the scene, or put the kept one back
+                    if (benchmark)
+                        benchmark->OnRendered(); // Frame captures, without the GUI
+                }
+                test::Tests* const shownTest = currentTest;
                 ImGui::Begin("Test control panel");
-                if (currentTest != TestMenu && ImGui::Button("<-"))
+                if (benchmark)
+                    ImGui::Text("%s", benchmark->GetStatus().c_str());
+                if (!benchmark && currentTest != TestMenu && ImGui::Button("<-"))
                 {
-                    delete currentTest;
+                    TestMenu->Close(currentTest);   // deleted, or kept warm
                     currentTest = TestMenu;
                 }
+                else if (loading)
+                    ImGui::Text("Compiling shaders... %u remaining", pendingShaders);
+                else
                     currentTest->RenderGUI();
+
+                // The kept frame is the old test's
+                if (currentTest != shownTest)
+                    RenderOnDemand::Invalidate();
+
+                // A recording or replay runs for the life of one test (see
+                // Input.h); the benchmark runner starts and ends its own
+                if (!benchmark && currentTest != shownTest)
+                {
+                    if (currentTest == TestMenu)
+                        Input::OnTestEnded();
+                    else
+                        Input::OnTestStarted();
+                }
+
+                const GLState::Stats& glStats = GLState::GetLastFrameStats();
+                ImGui::Separator();
+                ImGui::Checkbox("Show profiler", &showProfiler);
+
+                // CPU/GPU pacing (see FramePacer.h)
+                const FramePacer::Stats& pacing = FramePacer::GetStats();
+                int framesInFlight = static_cast<int>(FramePacer::GetFramesInFlight());
+                if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, FramePacer::MAX_FRAMES_IN_FLIGHT))
+                    FramePacer::SetFramesInFlight(static_cast<unsigned int>(framesInFlight));
+                ImGui::SameLine();
+                bool vsync = FramePacer::GetVSync();
+                if (!benchmark && ImGui::Checkbox("V-Sync", &vsync))
+                    FramePacer::SetVSync(vsync);
+                ImGui::Text("Input to photon ~%.1f ms (avg %.1f), GPU %.1f ms behind, %u in flight, waited %.2f ms (%u stalls)",
+                    pacing.inputToPhotonMs, pacing.averageInputToPhotonMs, pacing.gpuLatencyMs, pacing.inFlight,
+                    pacing.waitMs, pacing.stalls);
+
+                // Skip the scene while nothing on screen can change, and
+                // sleep until the next event (see RenderOnDemand.h)
+                bool onDemand = RenderOnDemand::IsEnabled();
+                if (!benchmark && ImGui::Checkbox("Render on demand", &onDemand))
+                    RenderOnDemand::SetEnabled(onDemand);
+                if (onDemand)
+                {
+                    const RenderOnDemand::Stats& demand = RenderOnDemand::GetStats();
+                    float settle = RenderOnDemand::GetSettleTime();
+                    ImGui::SameLine();
+                    ImGui::SetNextItemWidth(120.0f);
+                    if (ImGui::SliderFloat("Settle (s)", &settle, 0.0f, 2.0f, "%.2f"))
+                        RenderOnDemand::SetSettleTime(settle);
+                    ImGui::Text("  %u frames drawn, %u reused, %u waits for input; idle %.1f s",
+                        demand.rendered, demand.reused, demand.waits, demand.idleSeconds);
+                }
+
+                // F11 or the button: a Chrome trace of the next frames (see
+                // Profiler.h)
+                ImGui::InputText("Trace file", tracePath, sizeof(tracePath));
+                ImGui::SliderInt("Trace frames", &traceFrames, 1, 120);
+                const bool traceKey = ImGui::IsKeyPressed(ImGuiKey_F11, false);
+                if (Profiler::IsCapturingTrace())
+                    ImGui::Text("Capturing trace...");
+                else if ((ImGui::Button("Capture trace (F11)") || traceKey) && Profiler::IsEnabled())
+                    Profiler::CaptureTrace(static_cast<unsigned int>(traceFrames), tracePath);
+                if (!Profiler::GetLastTracePath().empty())
+                    ImGui::Text("Last trace: %s", Profiler::GetLastTracePath().c_str());
+
+                const char* inputModes[] = { "live", "recording", "replaying" };
+                ImGui::Text("Input: %s, frame %u / %u", inputModes[static_cast<int>(Input::GetMode())],
+                    Input::GetFrame(), Input::GetFrameCount());
+                if (!benchmark)
+                {
+                    ImGui::InputText("Input file", inputPath, sizeof(inputPath));
+                    if (ImGui::Button("Record next test"))
+                        Input::ArmRecording(inputPath, recordFixedStep ? 1.0f / 60.0f : 0.0f);
+                    ImGui::SameLine();
+                    if (ImGui::Button("Replay next test"))
+                        Input::ArmReplay(inputPath);
+                    ImGui::SameLine();
+                    if (ImGui::Button("Live"))
+                        Input::Disarm();
+                    ImGui::SameLine();
+                    ImGui::Checkbox("Record at 60 Hz steps", &recordFixedStep);
+                    if (Input::IsArmed() && Input::GetMode() == Input::Mode::Live)
+                        ImGui::Text("  armed: starts when a test opens");
+                }
+                ImGui::Text("GL state changes: %u issued, %u elided", glStats.issued, glStats.elided);
+
+                const Shader::Stats& shaderStats = Shader::GetLastFrameStats();
+                ImGui::Text("Uniform sets: %u (%u by name)", shaderStats.handleSets, shaderStats.stringSets);
+
+                const ShaderCache::Stats& cacheStats = ShaderCache::GetStats();
+                ImGui::Text("Shader cache: %u warm (%.1f ms), %u cold (%.1f ms), %u rejected",
+                    cacheStats.hits, cacheStats.warmMs, cacheStats.misses, cacheStats.coldMs, cacheStats.rejected);
+                bool cacheEnabled = ShaderCache::IsEnabled();
+                if (ImGui::Checkbox("Use shader cache", &cacheEnabled))
+                    ShaderCache::SetEnabled(cacheEnabled);
+                ImGui::SameLine();
+                if (ImGui::Button("Clear shader cache"))
+                    ShaderCache::Clear();
+                const ShaderLibrary::Stats& libraryStats = ShaderLibrary::GetStats();
+                ImGui::Text("Shader library: %u programs, %u shared / %u built, %u includes",
+                    libraryStats.programs, libraryStats.hits, libraryStats.misses, libraryStats.includes);
+                if (ImGui::TreeNode("Shader load times"))
+                {
+                    for (const ShaderCache::Record& record : ShaderCache::GetRecords())
+                        ImGui::Text("%6.2f ms  %s  %s", record.milliseconds, record.cached ? "warm" : "cold", record.name.c_str());
+                    ImGui::TreePop();
+                }
+
+                const GLDebug::Stats& debugStats = GLDebug::GetStats();
+                ImGui::Text("GL debug messages: %u (%u repeats, %u dropped)",
+                    debugStats.received, debugStats.repeats, debugStats.dropped);
+                bool synchronous = GLDebug::IsSynchronous();
+                if (ImGui::Checkbox("Synchronous debug output", &synchronous))
+                    GLDebug::SetSynchronous(synchronous);
+                int minSeverity = static_cast<int>(GLDebug::GetMinSeverity());
+                if (ImGui::Combo("Min severity", &minSeverity, "Notification\0Low\0Medium\0High\0"))
+                    GLDebug::SetMinSeverity(static_cast<GLDebug::Severity>(minSeverity));
+
+                const TextureStreamer::Stats streamStats = TextureStreamer::IsAlive()
+                    ? TextureStreamer::Get().GetStats() : TextureStreamer::Stats();
+                ImGui::Separator();
+                ImGui::Text("Texture streaming: %u / %u done, %u decoding, %u queued, %u uploading, %u failed",
+                    streamStats.completed, streamStats.requested, streamStats.decoding, streamStats.queued,
+                    streamStats.uploading, streamStats.failed);
+                ImGui::Text("  uploaded %.2f MB last frame, %.1f MB total",
+                    streamStats.bytesLastFrame / (1024.0f * 1024.0f), streamStats.bytesTotal / (1024.0f * 1024.0f));
+                bool streaming = TextureStreamer::IsEnabled();
+                if (ImGui::Checkbox("Stream model textures", &streaming))
+                    TextureStreamer::SetEnabled(streaming);
+                if (TextureStreamer::IsAlive())
+                {
+                    int budgetMB = static_cast<int>(TextureStreamer::Get().GetFrameBudget() / (1024 * 1024));
+                    if (ImGui::SliderInt("Upload budget (MB/frame)", &budgetMB, 1, 64))
+                        TextureStreamer::Get().SetFrameBudget(static_cast<std::size_t>(budgetMB) * 1024 * 1024);
+                }
+
+                // Mips, anisotropy and BCn (see Texture.h); both settings
+                // apply to textures loaded from now on
+                ImGui::Text("Textures: %u, %.1f MB on the GPU", Texture::GetTextureCount(),
+                    Texture::GetTotalMemory() / (1024.0f * 1024.0f));
+                if (Texture::GetMaxAnisotropy() > 1.0f)
+                {
+                    float anisotropy = Texture::GetAnisotropy();
+                    if (ImGui::SliderFloat("Anisotropy", &anisotropy, 1.0f, Texture::GetMaxAnisotropy(), "%.0fx"))
+                        Texture::SetAnisotropy(anisotropy);
+                }
+                bool useCompressed = Texture::GetUseCompressed();
+                if (ImGui::Checkbox("Use cooked .dds textures", &useCompressed))
+                    Texture::SetUseCompressed(useCompressed);
+                ImGui::SameLine();
+                if (ImGui::Button("Cook res/Textures"))
+                    lastCook = TextureCooker::CookDirectory("res/Textures", true);
+                if (TextureCache::IsAlive())
+                {
+                    const TextureCache::Stats cacheStats = TextureCache::Get().GetStats();
+                    ImGui::Text("Texture cache: %u resident (%.1f MB), %u retained (%.1f MB), %u hits / %u misses",
+                        cacheStats.entries, cacheStats.residentBytes / (1024.0f * 1024.0f), cacheStats.retained,
+                        cacheStats.retainedBytes / (1024.0f * 1024.0f), cacheStats.hits, cacheStats.misses);
+                    int cacheBudgetMB = static_cast<int>(TextureCache::Get().GetBudget() / (1024 * 1024));
+                    if (ImGui::SliderInt("Cache budget (MB)", &cacheBudgetMB, 0, 1024))
+                        TextureCache::Get().SetBudget(static_cast<std::size_t>(cacheBudgetMB) * 1024 * 1024);
+                    ImGui::SameLine();
+                    if (ImGui::Button("Release unused"))
+                        TextureCache::Get().ReleaseUnused();
+                }
+                if (lastCook.files > 0)
+                    ImGui::Text("  cooked %u / %u in %.0f ms (%u failed): %.1f MB -> %.1f MB", lastCook.cooked, lastCook.files,
+                        lastCook.milliseconds, lastCook.failed, lastCook.bytesBefore / (1024.0f * 1024.0f), lastCook.bytesAfter / (1024.0f * 1024.0f));
+
+                // One arena per vertex format (see MeshArena.h)
+                const char* formatNames[VERTEX_FORMAT_COUNT] = { "standard", "packed" };
+                for (unsigned int f = 0; f < VERTEX_FORMAT_COUNT; f++)
+                {
+                    const VertexFormat format = static_cast<VertexFormat>(f);
+                    if (!MeshArena::IsAlive(format))
+                        continue;
+
+                    const MeshArena::Stats arenaStats = MeshArena::Get(format).GetStats();
+                    ImGui::PushID(static_cast<int>(f));
+                    ImGui::Separator();
+                    ImGui::Text("Mesh arena (%s, %u B/vertex): %u meshes, %u free blocks", formatNames[f],
+                        arenaStats.vertexStride, arenaStats.allocations, arenaStats.freeBlocks);
+                    ImGui::Text("  vertices %u / %u (%.1f MB), indices %u / %u",
+                        arenaStats.verticesUsed, arenaStats.vertexCapacity,
+                        arenaStats.verticesUsed * static_cast<float>(arenaStats.vertexStride) / (1024.0f * 1024.0f),
+                        arenaStats.indicesUsed, arenaStats.indexCapacity);
+                    if (ImGui::Button("Defragment arena"))
+                        MeshArena::Get(format).Defragment();
+                    ImGui::SameLine();
+                    ImGui::Text("%u so far", arenaStats.defragmentations);
+                    ImGui::PopID();
+                }
+
+                // Identical primitives generated and uploaded once (see GeometryFactory.h)
+                const GeometryFactory::RegistryStats geometry = GeometryFactory::GetRegistryStats();
+                ImGui::Text("Shared geometry: %u live, %u reused / %u generated", geometry.live, geometry.hits, geometry.misses);
+
+                // Released objects wait for their frame's fence (see GpuResources.h)
+                if (GpuResources::IsAlive())
+                {
+                    const GpuResources::Stats gpuStats = GpuResources::Get().GetStats();
+                    ImGui::Separator();
+                    ImGui::Text("GPU resources: %u buffers, %u textures; %u pending over %u frames",
+                        gpuStats.buffers, gpuStats.textures, gpuStats.pendingObjects, gpuStats.pendingFrames);
+                    ImGui::Text("  pool: %u buffers, %u textures (%.1f MB); %u created, %u reused, %u deleted, %u stale",
+                        gpuStats.pooledBuffers, gpuStats.pooledTextures, gpuStats.pooledBytes / (1024.0f * 1024.0f),
+                        gpuStats.created, gpuStats.reused, gpuStats.deleted, gpuStats.staleLookups);
+                    int poolBudgetMB = static_cast<int>(GpuResources::Get().GetPoolBudget() / (1024 * 1024));
+                    if (ImGui::SliderInt("Pool budget (MB)", &poolBudgetMB, 0, 512))
+                        GpuResources::Get().SetPoolBudget(static_cast<std::size_t>(poolBudgetMB) * 1024 * 1024);
+                    ImGui::SameLine();
+                    if (ImGui::Button("Empty pool"))
+                        GpuResources::Get().ReleaseUnused();
+                }
+
+                // What the wrappers asked for (see GpuMemory.h), against the
+                // driver's own figure where it gives one
+                const float mb = 1.0f / (1024.0f * 1024.0f);
+                ImGui::Separator();
+                ImGui::Text("GPU memory: %.1f MB allocated, %.1f MB peak",
+                    GpuMemory::GetTotalBytes() * mb, GpuMemory::GetPeakBytes() * mb);
+                const GpuMemory::DriverInfo driverMemory = GpuMemory::QueryDriver();
+                if (driverMemory.available && driverMemory.totalBytes > 0)
+                    ImGui::Text("  driver: %.0f / %.0f MB in use (%s)", (driverMemory.totalBytes - driverMemory.freeBytes) * mb,
+                        driverMemory.totalBytes * mb, driverMemory.source);
+                else if (driverMemory.available)
+                    ImGui::Text("  driver: %.0f MB free (%s)", driverMemory.freeBytes * mb, driverMemory.source);
+                if (ImGui::BeginTable("GPU memory", 4, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_RowBg))
+                {
+                    ImGui::TableSetupColumn("Category");
+                    ImGui::TableSetupColumn("Objects");
+                    ImGui::TableSetupColumn("MB");
+                    ImGui::TableSetupColumn("Peak MB");
+                    ImGui::TableHeadersRow();
+                    for (int i = 0; i < static_cast<int>(GpuMemory::Category::Count); i++)
+                    {
+                        const GpuMemory::Category category = static_cast<GpuMemory::Category>(i);
+                        const GpuMemory::Usage& usage = GpuMemory::GetUsage(category);
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%s", GpuMemory::GetCategoryName(category));
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%u", usage.objects);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.2f", usage.bytes * mb);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.2f", usage.peakBytes * mb);
+                    }
+                    ImGui::EndTable();
+                }
+                if (ImGui::Button("Reset peaks"))
+                    GpuMemory::ResetPeaks();
+
+                // Anything here is a hot-path allocation FrameArena could take
+                const AllocationCounter::Stats& heap = AllocationCounter::GetLastFrame();
+                const FrameArena::Stats& arena = FrameArena::GetStats();
+                ImGui::Separator();
+                ImGui::Text("Heap: %zu allocations (%.1f KB) last frame", heap.allocations, heap.bytes / 1024.0f);
+                ImGui::Text("Frame arena: %.1f / %.0f KB, peak %.1f KB, %u overflows", arena.usedBytes / 1024.0f,
+                    arena.capacity / 1024.0f, arena.peakBytes / 1024.0f, arena.overflows);
+                const TransformHierarchy::Stats& transforms = TransformHierarchy::Get().GetStats();
+                ImGui::Text("Transforms: %u nodes, %u local / %u world updated (%.3f ms, %s)", transforms.nodes,
+                    transforms.localUpdates, transforms.worldUpdates, transforms.milliseconds,
+                    TransformHierarchy::GetInstructionSet());
                 ImGui::End();
+
+                if (showProfiler)
+                    currentTest->RenderProfilerWindow(&showProfiler);
+            }
+            {
+                PROFILE_SCOPE("ImGui");
+                ImGui::Render(); // Render ImGui frame
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Draw ImGui to the screen
             }
-            ImGui::Render(); // Render ImGui frame
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Draw ImGui to the screen
         
+            // Fence this frame's releases; recycle the ones the GPU has finished with
+            GpuResources::Get().EndFrame();
+
+            // Print any driver messages collected during the frame
+            GLDebug::Flush();
+
+            Profiler::EndFrame();
+
             // Swap front and back buffers
             glfwSwapBuffers(window);
-            // Poll events (keyboard, mouse, etc.)
-            glfwPollEvents();
+            // Fence the frame and wait until few enough are in flight, so
+            // the input polled next is as fresh as the limit allows
+            FramePacer::EndFrame();
+            // Poll events (keyboard, mouse, etc.), or wait for one while
+            // render on demand has nothing to draw
+            RenderOnDemand::PollEvents();
+
+            // Nothing from the arena outlives the frame
+            FrameArena::EndFrame();
+            AllocationCounter::EndFrame();
+
+            if (benchmark)
+                benchmark->EndFrame();
+        }
+
+        // The runner owns the test it was running, if the window was
+        // closed part way through
+        if (benchmark)
+        {
+            if (!benchmark->WriteResults())
+                exitCode = -1;
+            delete benchmark;
+            currentTest = TestMenu;
         }
 
+        // Before the menu: its preload callbacks point at it
+        BackgroundLoader::Shutdown();
+
         delete currentTest;
         if(currentTest != TestMenu)
             delete TestMenu;
 
+    Input::Disarm();                    // saves a recording still running
+    ThreadPool::Get().RunMainThreadTasks(); // while there's still a context for them
+
+    // Meshes free their arena ranges on destruction, so the arena goes
+    // after the tests and before the context.
+    MeshArena::Shutdown();
+    GeometryFactory::Shutdown();        // the GPU generators' compute shader
+    TextureCache::Shutdown();           // the textures it still retains
+    ShaderLibrary::Shutdown();          // the programs no test holds any more
+    TextureStreamer::Shutdown();
+    FrameUniforms::Shutdown();
+    GpuResources::Shutdown();           // after everything that releases into it
+    Profiler::Shutdown();
+    FramePacer::Shutdown();
+    RenderOnDemand::Shutdown();
+    FrameArena::Shutdown();
+    GLDebug::Shutdown();
+
     // Shutdown ImGui and GLFW
     ImGui_ImplGlfw_Shutdown();
     // Cleanup resources and destroy window
     glfwDestroyWindow(window);
     glfwTerminate();
 
-    return 0;
+    return exitCode;
 }
@@ -0,0 +1,250 @@
+#include "ClusterCulling.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "MemoryBarriers.h"
+#include "HiZBuffer.h"
+#include "Culling.h"
+#include "Mesh/Mesh.h"
+#include "Mesh/MeshArena.h"
+
+ClusterCulling::ClusterCulling(VertexFormat format)
+	: m_Format(format), m_ClusterBuffer(0), m_CommandBuffer(0), m_CounterBuffer(0), m_Frame(0),
+	  m_ArenaGeneration(MeshArena::Get(m_Format).GetGeneration()), m_FrustumCulling(true), m_BackfaceCulling(true),
+	  m_Dirty(false)
+{
+	m_CullShader = std::make_unique<ComputeShader>("res/Shaders/Culling/ClusterCull.glsl");
+	for (unsigned int i = 0; i < 6; i++)
+		m_PlaneUniforms[i] = m_CullShader->Uniform("u_Planes[" + std::to_string(i) + "]");
+
+	GlCall(glGenBuffers(1, &m_ClusterBuffer));
+	GlCall(glGenBuffers(1, &m_CommandBuffer));
+	GlCall(glGenBuffers(1, &m_CounterBuffer));
+	GlCall(glGenBuffers(2, m_Readback));
+
+	const unsigned int zero[COUNTERS] = {};
+	GlCall(glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_CounterBuffer));
+	GlCall(glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(zero), zero, GL_DYNAMIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_CounterBuffer, sizeof(zero));
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Readback[i]));
+		GlCall(glBufferData(GL_COPY_WRITE_BUFFER, sizeof(zero), zero, GL_STREAM_READ));
+		GpuMemory::TrackBuffer(GpuMemory::Category::Staging, m_Readback[i], sizeof(zero));
+	}
+
+	m_Instance = std::make_unique<InstanceBuffer>(1);
+	m_VAO = MeshArena::Get(m_Format).CreateVertexArray();
+	m_VAO->AddInstanceBuffer(*m_Instance);
+	m_VAO->unBind();
+}
+
+ClusterCulling::~ClusterCulling()
+{
+	const unsigned int buffers[] = { m_ClusterBuffer, m_CommandBuffer, m_CounterBuffer, m_Readback[0], m_Readback[1] };
+
+	for (unsigned int buffer : buffers)
+	{
+		GlCall(glDeleteBuffers(1, &buffer));
+		GLState::OnBufferDeleted(buffer);
+	}
+}
+
+unsigned int ClusterCulling::AddMesh(const Mesh& mesh)
+{
+	// A mesh in another format's arena would be drawn from the wrong buffers
+	ASSERT(mesh.getVertexFormat() == m_Format);
+
+	MeshInfo info;
+	info.source = &mesh;
+	info.firstCluster = static_cast<unsigned int>(m_Clusters.size());
+	info.clusterCount = static_cast<unsigned int>(mesh.getMeshlets().size());
+	m_Meshes.push_back(info);
+
+	for (const Meshlet& meshlet : mesh.getMeshlets())
+	{
+		GPUCluster cluster;
+		cluster.centreRadius = glm::vec4(meshlet.centre, meshlet.radius);
+		cluster.coneAxisCutoff = glm::vec4(meshlet.coneAxis, meshlet.coneCutoff);
+		m_Clusters.push_back(cluster);
+		m_Stats.triangles += meshlet.triangleCount;
+	}
+
+	m_Dirty = true;
+	return static_cast<unsigned int>(m_Meshes.size() - 1);
+}
+
+// The commands point into the arena: rebuild them if it has moved ranges
+void ClusterCulling::RefreshRanges()
+{
+	const unsigned int generation = MeshArena::Get(m_Format).GetGeneration();
+	if (generation == m_ArenaGeneration)
+		return;
+
+	m_ArenaGeneration = generation;
+	m_Dirty = true;
+}
+
+void ClusterCulling::Upload()
+{
+	RefreshRanges();
+	if (!m_Dirty)
+		return;
+
+	// Each cluster a run of its mesh's range, drawn with the mesh's
+	// baseVertex; instanceCount is the shader's to set
+	m_Commands.resize(m_Clusters.size());
+	for (const MeshInfo& mesh : m_Meshes)
+	{
+		const MeshArena::Range& range = mesh.source->getArenaRange();
+		const std::vector<Meshlet>& meshlets = mesh.source->getMeshlets();
+		for (unsigned int i = 0; i < mesh.clusterCount; i++)
+		{
+			DrawElementsIndirectCommand& command = m_Commands[mesh.firstCluster + i];
+			command.count = meshlets[i].triangleCount * 3;
+			command.instanceCount = 1;
+			command.firstIndex = range.firstIndex + meshlets[i].firstIndex;
+			command.baseVertex = static_cast<int>(range.baseVertex);
+			command.baseInstance = 0;
+		}
+	}
+
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ClusterBuffer));
+	GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, m_Clusters.size() * sizeof(GPUCluster), m_Clusters.data(), GL_STATIC_DRAW));
+
+	const GLsizeiptr commandBytes = m_Commands.size() * sizeof(DrawElementsIndirectCommand);
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_CommandBuffer));
+	GlCall(glBufferData(GL_COPY_WRITE_BUFFER, commandBytes, m_Commands.data(), GL_DYNAMIC_COPY));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_ClusterBuffer, m_Clusters.size() * sizeof(GPUCluster));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_CommandBuffer, commandBytes);
+
+	m_Stats.meshes = static_cast<unsigned int>(m_Meshes.size());
+	m_Stats.clusters = static_cast<unsigned int>(m_Clusters.size());
+	m_Dirty = false;
+}
+
+void ClusterCulling::Cull(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition)
+{
+	Dispatch(viewProjection, model, cameraPosition, nullptr, glm::mat4(1.0f));
+}
+
+void ClusterCulling::Cull(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition,
+	const HiZBuffer& hiz, const glm::mat4& hizViewProjection)
+{
+	Dispatch(viewProjection, model, cameraPosition, hiz.IsValid() ? &hiz : nullptr, hizViewProjection);
+}
+
+void ClusterCulling::Dispatch(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition,
+	const HiZBuffer* hiz, const glm::mat4& hizViewProjection)
+{
+	Upload();
+
+	// The draw's one instance
+	InstanceData instance;
+	instance.model = model;
+	m_Instance->SetData(&instance, 1);
+
+	m_Stats.dispatches = 0;
+	if (m_Clusters.empty())
+		return;
+
+	MemoryBarriers::UseBuffer(m_CounterBuffer, MemoryBarriers::Access::BufferUpdate);
+	MemoryBarriers::Flush();
+	const unsigned int zero[COUNTERS] = {};
+	GlCall(glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_CounterBuffer));
+	GlCall(glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(zero), zero));
+
+	// Object space: the planes of clip = viewProjection * model * local
+	// are in local coordinates already, normalised by FromMatrix
+	const Frustum frustum = Frustum::FromMatrix(viewProjection * model);
+	const glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+	m_CullShader->Bind();
+	m_CullShader->setUniform1i("u_ClusterCount", static_cast<int>(m_Clusters.size()));
+	m_CullShader->setUniform1i("u_FrustumEnabled", m_FrustumCulling ? 1 : 0);
+	m_CullShader->setUniform1i("u_ConeEnabled", m_BackfaceCulling ? 1 : 0);
+	m_CullShader->setUniform3f("u_CameraLocal", camera.x, camera.y, camera.z);
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = frustum.planes[i];
+		m_CullShader->setUniform4f(m_PlaneUniforms[i], plane.x, plane.y, plane.z, plane.w);
+	}
+
+	m_CullShader->setUniform1i("u_OcclusionEnabled", hiz ? 1 : 0);
+	if (hiz)
+	{
+		GLState::BindTextureToUnit(HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, hiz->GetTexture());
+		MemoryBarriers::UseTexture(hiz->GetTexture(), MemoryBarriers::Access::Texture);
+		m_CullShader->setUniform1i("u_HiZ", static_cast<int>(HIZ_TEXTURE_UNIT));
+		m_CullShader->setUniform2f("u_HiZSize", static_cast<float>(hiz->GetWidth()), static_cast<float>(hiz->GetHeight()));
+		m_CullShader->setUniform1f("u_HiZMaxLevel", static_cast<float>(hiz->GetLevelCount() - 1));
+		// Where the cluster is now, as the pyramid's frame would have seen it
+		m_CullShader->setUniformMat4f("u_HiZModelViewProjection", hizViewProjection * model);
+	}
+
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, m_ClusterBuffer));
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, m_CommandBuffer));
+	GlCall(glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, COUNTER_BINDING, m_CounterBuffer));
+
+	// Draw and ReadCounters declare how they read these
+	MemoryBarriers::WriteBuffer(m_CommandBuffer);
+	MemoryBarriers::WriteBuffer(m_CounterBuffer);
+	m_Stats.dispatches = m_CullShader->DispatchForElements(static_cast<unsigned int>(m_Clusters.size()));
+
+	ReadCounters();
+}
+
+// As GPUCulling::ReadVisibleCount: this frame's counters into one buffer,
+// last frame's out of the other
+void ClusterCulling::ReadCounters()
+{
+	const unsigned int write = m_Frame % 2;
+	const unsigned int read = (m_Frame + 1) % 2;
+
+	MemoryBarriers::UseBuffer(m_CounterBuffer, MemoryBarriers::Access::BufferUpdate);
+	MemoryBarriers::Flush();
+
+	GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_CounterBuffer));
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Readback[write]));
+	GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, COUNTERS * sizeof(unsigned int)));
+
+	if (m_Frame > 0)
+	{
+		unsigned int counters[COUNTERS];
+		GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_Readback[read]));
+		GlCall(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(counters), counters));
+		m_Stats.visible = counters[0];
+		m_Stats.frustumCulled = counters[1];
+		m_Stats.backfaceCulled = counters[2];
+		m_Stats.occluded = counters[3];
+	}
+
+	m_Frame++;
+}
+
+void ClusterCulling::Draw() const
+{
+	Draw(0, static_cast<unsigned int>(m_Meshes.size()));
+}
+
+void ClusterCulling::Draw(unsigned int firstMesh, unsigned int meshCount) const
+{
+	if (m_Clusters.empty() || meshCount == 0 || firstMesh + meshCount > m_Meshes.size())
+		return;
+
+	const MeshInfo& first = m_Meshes[firstMesh];
+	const MeshInfo& last = m_Meshes[firstMesh + meshCount - 1];
+	const unsigned int clusterCount = last.firstCluster + last.clusterCount - first.firstCluster;
+	if (clusterCount == 0)
+		return;
+
+	MemoryBarriers::UseBuffer(m_CommandBuffer, MemoryBarriers::Access::Command);
+	MemoryBarriers::Flush();
+
+	m_VAO->Bind();
+	GlCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer));
+
+	const void* offset = (const void*)(first.firstCluster * sizeof(DrawElementsIndirectCommand));
+	const unsigned int indexType = MeshArena::Get(m_Format).GetIndexBuffer().GetType();
+	GlCall(glMultiDrawElementsIndirect(GLState::GetPrimitive(), indexType, offset, static_cast<GLsizei>(clusterCount), 0));
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "ComputeShader.h"
+#include "InstanceBuffer.h"
+#include "VertexArray.h"
+#include "DrawIndirectBuffer.h"
+#include "Mesh/PackedVertex.h"
+
+class Mesh;
+class HiZBuffer;
+
+/**
+ * ClusterCulling — per-meshlet culling and drawing for dense meshes
+ *
+ * GPUCulling decides per instance: a model that is partly on screen, or
+ * whose back half faces away, still draws every triangle. Here each mesh
+ * is split into meshlets (MeshletBuilder.h, built at import and kept in
+ * the MeshCache), and a compute shader decides per cluster of ~100
+ * triangles:
+ *
+ *     clusters (SSBO)              commands (indirect + SSBO)
+ *     +----+----+----+----+        { count, instanceCount, firstIndex, baseVertex, 0 }
+ *     | s,c| s,c| s,c| s,c|  cull           ^
+ *     +----+----+----+----+  ---->  instanceCount = 1 if the cluster survives, else 0
+ *
+ * One thread per cluster rejects it when
+ *
+ *     FRUSTUM    its bounding sphere is outside a plane
+ *     BACKFACE   the camera is inside its normal cone's back side, so every
+ *                triangle in it faces away (see MeshletBuilder.h)
+ *     OCCLUSION  the Hi-Z pyramid of an earlier frame has something nearer
+ *                over its whole screen rectangle (as in GPUCulling)
+ *
+ * and each cluster's command is rewritten in place, so the CPU never reads
+ * a result and one glMultiDrawElementsIndirect draws every survivor: each
+ * command is a run of the mesh's own index range. Everything is tested in
+ * the mesh's object space (the camera and the frustum planes are brought
+ * into it), which keeps the cone test exact under any model matrix.
+ *
+ * Culled clusters stay in the batch with no instances. Drawing only the
+ * survivors would mean compacting them and glMultiDrawElementsIndirectCount
+ * (GL 4.6), and the command processor skips an empty command quickly;
+ * GPUCulling makes the same choice. The commands keep the mesh order, so
+ * Draw(firstMesh, meshCount) can draw one material group's meshes.
+ *
+ * The meshes are drawn at level 0 (meshlets are cut from it), once, with
+ * the model matrix of the last Cull as instance 0 of a one-instance buffer:
+ * draw with a shader that reads the instance attributes (locations 8..12,
+ * InstanceBuffer.h). Every mesh must live in the MeshArena of `format`.
+ *
+ * BACKFACE culling assumes back faces are never meant to be seen: turn it
+ * off for open, double-sided geometry. GL_NV_mesh_shader would do the same
+ * per-cluster work in a task shader without the indirect commands; this
+ * path only needs GL 4.3.
+ *
+ * The survivor and rejection counts are read back a frame late, like
+ * GPUCulling's.
+ *
+ * Usage:
+ *     for (std::size_t draw = 0; draw < model.getDrawCount(); draw++)
+ *         clusters.AddMesh(model.getDrawMesh(draw));
+ *
+ *     clusters.Cull(projection * view, modelMatrix, cameraPosition, hiz, lastViewProjection);
+ *     shader.Bind();   // e.g. MeshIndirect's DRAW=INSTANCED
+ *     clusters.Draw();
+ *     hiz.Build(framebuffer.GetDepthTexture(), width, height);
+ */
+
+class ClusterCulling
+{
+public:
+	// SSBO bindings 0..10 are taken (see GPUCulling.h, MeshArena.h)
+	static const unsigned int CLUSTER_BINDING = 11;
+	static const unsigned int COMMAND_BINDING = 12;
+	static const unsigned int COUNTER_BINDING = 0;   // atomic counter buffer binding
+	static const unsigned int HIZ_TEXTURE_UNIT = 0;
+
+	struct Stats
+	{
+		unsigned int meshes = 0;
+		unsigned int clusters = 0;
+		unsigned int triangles = 0;
+		// One frame behind
+		unsigned int visible = 0;
+		unsigned int frustumCulled = 0;
+		unsigned int backfaceCulled = 0;
+		unsigned int occluded = 0;
+		unsigned int dispatches = 0;      // work groups in the last Cull
+
+		unsigned int GetCulled() const { return frustumCulled + backfaceCulled + occluded; }
+	};
+
+	explicit ClusterCulling(VertexFormat format = VertexFormat::Standard);
+	~ClusterCulling();
+	ClusterCulling(const ClusterCulling&) = delete;
+	ClusterCulling& operator=(const ClusterCulling&) = delete;
+
+	// Register a mesh's meshlets (Mesh::getMeshlets); returns its index for
+	// Draw. A mesh without any adds no clusters. The mesh must outlive the
+	// culler: its arena range is looked up again when the arena moves ranges.
+	unsigned int AddMesh(const Mesh& mesh);
+
+	// Send the clusters and their commands to the GPU. Only does work if
+	// something changed since the last upload.
+	void Upload();
+
+	// Cull every cluster for a mesh drawn with `model`, seen from
+	// cameraPosition (world space) through viewProjection.
+	void Cull(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition);
+
+	// And against `hiz`, built from a scene drawn with hizViewProjection;
+	// an invalid pyramid falls back to the other two tests.
+	void Cull(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition,
+		const HiZBuffer& hiz, const glm::mat4& hizViewProjection);
+
+	// One multi-draw over every cluster. Bind the shader first.
+	void Draw() const;
+	// Only the clusters of meshes [firstMesh, firstMesh + meshCount)
+	void Draw(unsigned int firstMesh, unsigned int meshCount) const;
+
+	unsigned int GetMeshCount() const { return static_cast<unsigned int>(m_Meshes.size()); }
+
+	// With both off every cluster is drawn (occlusion still applies when
+	// a pyramid is given), for comparing against the culled result.
+	void SetFrustumCulling(bool enabled) { m_FrustumCulling = enabled; }
+	void SetBackfaceCulling(bool enabled) { m_BackfaceCulling = enabled; }
+	bool IsFrustumCulling() const { return m_FrustumCulling; }
+	bool IsBackfaceCulling() const { return m_BackfaceCulling; }
+
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	struct MeshInfo
+	{
+		const Mesh*  source;
+		unsigned int firstCluster;
+		unsigned int clusterCount;
+	};
+
+	// std430 layout shared with ClusterCull.glsl
+	struct GPUCluster
+	{
+		glm::vec4 centreRadius;   // object space bounding sphere
+		glm::vec4 coneAxisCutoff;
+	};
+
+	static const unsigned int COUNTERS = 4;   // visible, frustum, backface, occluded
+
+	void Dispatch(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition,
+		const HiZBuffer* hiz, const glm::mat4& hizViewProjection);
+	void RefreshRanges();
+	void ReadCounters();
+
+	std::unique_ptr<ComputeShader> m_CullShader;
+	UniformHandle m_PlaneUniforms[6];   // u_Planes[0..5], looked up once
+
+	std::vector<MeshInfo> m_Meshes;
+	std::vector<GPUCluster> m_Clusters;
+	std::vector<DrawElementsIndirectCommand> m_Commands;
+
+	VertexFormat m_Format;
+	unsigned int m_ClusterBuffer;     // GPUCluster[]
+	unsigned int m_CommandBuffer;     // one DrawElementsIndirectCommand per cluster
+	unsigned int m_CounterBuffer;
+	unsigned int m_Readback[2];       // counter copies, read a frame late
+	unsigned int m_Frame;
+	unsigned int m_ArenaGeneration;
+
+	std::unique_ptr<InstanceBuffer> m_Instance;   // the model matrix
+	std::unique_ptr<VertexArray> m_VAO;
+
+	bool m_FrustumCulling;
+	bool m_BackfaceCulling;
+	bool m_Dirty;
+	Stats m_Stats;
+};
@@ -0,0 +1,58 @@
+#include "ClusteredLights.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "MemoryBarriers.h"
+
+#include <algorithm>
+
+ClusteredLights::ClusteredLights()
+{
+	m_BinShader = std::make_unique<ComputeShader>("res/Shaders/Lighting/LightCluster.glsl");
+
+	GlCall(glGenBuffers(1, &m_RendererID));
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_RendererID));
+	GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, GetBufferSize(), nullptr, GL_DYNAMIC_COPY));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_RendererID, GetBufferSize());
+}
+
+ClusteredLights::~ClusteredLights()
+{
+	GlCall(glDeleteBuffers(1, &m_RendererID));
+	GLState::OnBufferDeleted(m_RendererID);
+}
+
+void ClusteredLights::Build(const LightList& lights, const glm::mat4& view, const glm::mat4& projection,
+	float nearZ, float farZ, int width, int height)
+{
+	m_NearZ = std::max(nearZ, 0.001f);
+	m_FarZ = std::max(farZ, m_NearZ * 2.0f);
+	m_Width = std::max(width, 1);
+	m_Height = std::max(height, 1);
+
+	lights.Bind();
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, m_RendererID));
+
+	m_BinShader->Bind();
+	m_BinShader->setUniform1i("uLightCount", static_cast<int>(lights.GetCount()));
+	m_BinShader->setUniform3f("u_ClusterGrid", static_cast<float>(GRID_X), static_cast<float>(GRID_Y), static_cast<float>(GRID_Z));
+	m_BinShader->setUniform2f("u_ClusterDepth", m_NearZ, m_FarZ);
+	m_BinShader->setUniform1i("u_ClusterCapacity", static_cast<int>(CAPACITY));
+	m_BinShader->setUniformMat4f("u_ViewMatrix", view);
+	m_BinShader->setUniformMat4f("u_InverseProjection", glm::inverse(projection));
+	MemoryBarriers::WriteBuffer(m_RendererID);
+	m_BinShader->DispatchForElements(CLUSTER_COUNT);
+}
+
+void ClusteredLights::Apply(Shader& shader) const
+{
+	// The fragment shaders read the lists Build wrote
+	MemoryBarriers::UseBuffer(m_RendererID, MemoryBarriers::Access::Storage);
+	MemoryBarriers::Flush();
+
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, m_RendererID));
+	shader.setUniform3f("u_ClusterGrid", static_cast<float>(GRID_X), static_cast<float>(GRID_Y), static_cast<float>(GRID_Z));
+	shader.setUniform2f("u_ClusterDepth", m_NearZ, m_FarZ);
+	shader.setUniform2f("u_ClusterViewport", static_cast<float>(m_Width), static_cast<float>(m_Height));
+	shader.setUniform1i("u_ClusterCapacity", static_cast<int>(CAPACITY));
+}
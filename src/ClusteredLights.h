@@ -0,0 +1,87 @@
+#pragma once
+#include <memory>
+
+#include "ComputeShader.h"
+#include "LightList.h"
+
+#include "glm/glm.hpp"
+
+/**
+ * ClusteredLights — per-cluster light lists for forward shading
+ *
+ * PhongMultiple.shader loops over every light in the LightList for every
+ * fragment. Most lights with a range (GPULight::range) reach only a small
+ * part of the view, so most of those iterations add nothing. Here the view
+ * frustum is cut into GRID_X x GRID_Y screen tiles by GRID_Z depth slices
+ * ("froxels"), and a compute pass lists, for each cluster, the lights that
+ * can touch it:
+ *
+ *     clusters.Build(lights, view, projection, 0.1f, 100.0f, width, height);
+ *     lights.Bind();
+ *     shader.Bind();
+ *     clusters.Apply(shader);   // a LIGHTS=CLUSTERED variant
+ *     ... draw ...
+ *
+ * The shading pass finds its fragment's cluster from gl_FragCoord and view
+ * depth, and iterates only that cluster's list. PhongMultiple, Blinn-Phong
+ * and PBR.shader each have a LIGHTS=CLUSTERED variant doing so, and
+ * LIGHTS=CLUSTER_HEATMAP, which tints the result by how many lights the
+ * fragment's cluster holds.
+ *
+ * SLICES
+ *   Slice k covers view distances near * (far / near)^(k / GRID_Z) to the
+ *   next, so slices are thin close to the camera, where a cluster covers
+ *   many pixels, and long far away. Fragments nearer than `nearZ` or past
+ *   `farZ` fall into the first or last slice, which extend to the camera
+ *   and to infinity.
+ *
+ * STORAGE
+ *   One SSBO at CLUSTER_BINDING: cluster c (tile x, then y, then slice)
+ *   owns CAPACITY + 1 words from c * (CAPACITY + 1), its count followed by
+ *   its light indices. A cluster touched by more than CAPACITY lights
+ *   keeps the first CAPACITY, and its count stays the number touching it,
+ *   so the heatmap can show which clusters dropped lights. Fixed slots
+ *   need no atomics or prefix sum, at the cost of a buffer sized for the
+ *   worst case (1.8 MB).
+ *
+ * Lights with range 0 and directional lights are in every cluster, as
+ * they reach every fragment.
+ */
+class ClusteredLights
+{
+public:
+	static const unsigned int GRID_X = 16;
+	static const unsigned int GRID_Y = 9;
+	static const unsigned int GRID_Z = 24;
+	static const unsigned int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+	static const unsigned int CAPACITY = 128;          // lights per cluster
+	static const unsigned int CLUSTER_BINDING = 7;     // LightList is at 1
+
+	ClusteredLights();
+	~ClusteredLights();
+	ClusteredLights(const ClusteredLights&) = delete;
+	ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+	// Bin every light in `lights` (uploaded) for this camera, viewport
+	// width x height; nearZ..farZ is the view distance the slices span
+	void Build(const LightList& lights, const glm::mat4& view, const glm::mat4& projection,
+		float nearZ, float farZ, int width, int height);
+
+	// Bind the cluster buffer and set the lookup uniforms on a bound
+	// LIGHTS=CLUSTERED (or CLUSTER_HEATMAP) shader. The LightList must be
+	// bound too.
+	void Apply(Shader& shader) const;
+
+	unsigned int GetID() const { return m_RendererID; }
+	static unsigned int GetBufferSize() { return CLUSTER_COUNT * (CAPACITY + 1) * sizeof(unsigned int); }
+
+private:
+	unsigned int m_RendererID = 0;
+	std::unique_ptr<ComputeShader> m_BinShader;
+
+	// From the last Build, for Apply
+	float m_NearZ = 0.1f;
+	float m_FarZ = 100.0f;
+	int m_Width = 1;
+	int m_Height = 1;
+};
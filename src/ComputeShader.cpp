@@ -1,5 +1,12 @@
 #include "ComputeShader.h"
 #include "Renderer.h"
+#include "FrameUniforms.h"
+#include "ShaderCache.h"
+#include "ShaderLibrary.h"
+#include "MemoryBarriers.h"
+
+#include <algorithm>
+#include <chrono>
 
 #include <fstream>
 #include <sstream>
@@ -38,19 +45,36 @@
 ComputeShader::ComputeShader(const std::string& filepath)
 	// Calls the protected Shader() default constructor — sets m_RendererID = 0
 	// without compiling any vertex/fragment shaders
-	: Shader()
+	: Shader(), m_WorkGroupSize(1)
 {
 	m_Filepath = filepath;
+	auto start = std::chrono::steady_clock::now();
 	std::string source = ReadFile(filepath);
+
+	// Same binary cache as Shader::CreateShader, keyed on the one compute stage
+	const uint64_t cacheKey = ShaderCache::MakeKey({ &source });
+	m_RendererID = ShaderCache::Load(cacheKey);
+	if (m_RendererID)
+	{
+		FrameUniforms::BindProgram(m_RendererID);
+		Reflect();
+		QueryWorkGroupSize();
+		ShaderCache::Report(filepath, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(), true);
+		return;
+	}
+
 	unsigned int shader = Compile(source);
 
 	// A compute shader still needs a "program" object, just like vertex/fragment shaders.
 	// The program is what gets bound with glUseProgram() and holds uniform state.
 	// The difference is we only attach ONE shader instead of two.
 	m_RendererID = glCreateProgram();
+	glProgramParameteri(m_RendererID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glAttachShader(m_RendererID, shader);
 	glLinkProgram(m_RendererID);
+	FrameUniforms::BindProgram(m_RendererID);
 	glValidateProgram(m_RendererID);
+	Reflect();
 
 	int success;
 	glGetProgramiv(m_RendererID, GL_LINK_STATUS, &success);
@@ -60,17 +84,24 @@ ComputeShader::ComputeShader(const std::string& filepath)
 		glGetProgramInfoLog(m_RendererID, 512, nullptr, log);
 		std::cerr << "Compute shader program link failed: " << log << std::endl;
 	}
+	else
+	{
+		QueryWorkGroupSize();
+		ShaderCache::Store(cacheKey, m_RendererID);
+	}
 
 	// The shader object is baked into the program after linking — we don't need it anymore.
 	// This is the same as what Shader::CreateShader does, but it never called glDeleteShader
 	// (a minor leak in the original code). We clean up properly here.
 	glDeleteShader(shader);
+
+	ShaderCache::Report(filepath, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(), false);
 }
 
 // --- Everything below is inherited from Shader: ---
 // Bind()              — glUseProgram(m_RendererID)
 // Unbind()            — glUseProgram(0)
-// setUniform1i/1f/2f/3f/4f/Mat4f — glUniform* with cached locations
+// Uniform() / setUniform*() — reflected uniforms, glProgramUniform*
 // ~Shader()           — glDeleteProgram(m_RendererID)
 // No code needed — that's the point of inheritance.
 
@@ -92,16 +123,67 @@ ComputeShader::ComputeShader(const std::string& filepath)
  * All 100k particles are updated simultaneously on the GPU — this is why it's fast.
  *
  * IMPORTANT: After dispatching, the results aren't immediately visible to other
- * shader stages. You need glMemoryBarrier() before reading the SSBO in a draw call.
+ * shader stages. You need glMemoryBarrier() before reading the SSBO in a draw call:
+ * declare the writes and uses to MemoryBarriers and the right one is issued at the
+ * next Flush, which every dispatch here does first.
  */
 void ComputeShader::Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ) const
 {
+	MemoryBarriers::Flush();
 	GlCall(glDispatchCompute(groupsX, groupsY, groupsZ));
 }
 
+/**
+ * The group count is the element count divided by the shader's local size,
+ * rounded up: 100,000 particles at local_size_x = 256 is 391 groups. Done
+ * here against the size the program was linked with, a shader edited to
+ * local_size_x = 128 launches twice the groups instead of silently leaving
+ * half its elements untouched.
+ */
+unsigned int ComputeShader::DispatchForElements(unsigned int x, unsigned int y, unsigned int z) const
+{
+	const glm::uvec3 groups = (glm::uvec3(x, y, z) + m_WorkGroupSize - 1u) / m_WorkGroupSize;
+	if (groups.x == 0 || groups.y == 0 || groups.z == 0)
+		return 0;
+
+	Dispatch(groups.x, groups.y, groups.z);
+	return groups.x * groups.y * groups.z;
+}
+
+/**
+ * glDispatchComputeIndirect — the group counts come from a buffer instead of
+ * the CPU, so one compute pass can size the next (TestGPUParticles' emit and
+ * simulate stages are sized by how many particles are free and alive) with
+ * no readback. The shader that wrote them needs a GL_COMMAND_BARRIER_BIT
+ * before this reads them; the Command use asks for exactly that.
+ */
+void ComputeShader::DispatchIndirect(unsigned int buffer, unsigned int offset) const
+{
+	MemoryBarriers::UseBuffer(buffer, MemoryBarriers::Access::Command);
+	MemoryBarriers::Flush();
+	GlCall(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, buffer));
+	GlCall(glDispatchComputeIndirect(static_cast<GLintptr>(offset)));
+}
+
+// GL_COMPUTE_WORK_GROUP_SIZE is only there once the program is linked; a
+// failed link keeps 1x1x1
+void ComputeShader::QueryWorkGroupSize()
+{
+	int size[3] = { 1, 1, 1 };
+	GlCall(glGetProgramiv(m_RendererID, GL_COMPUTE_WORK_GROUP_SIZE, size));
+	m_WorkGroupSize = glm::uvec3(std::max(size[0], 1), std::max(size[1], 1), std::max(size[2], 1));
+}
+
+bool ComputeShader::Prebuild(const std::string& filepath)
+{
+	const std::string source = ReadFile(filepath);
+	return ShaderCache::Prebuild({ &source }, { GL_COMPUTE_SHADER });
+}
+
 // Simple file read — unlike Shader::parseShaders, we don't need to split
 // the file into vertex/fragment sections. A compute shader is just one
-// continuous block of GLSL code, so we read the whole file as-is.
+// continuous block of GLSL code, so we read the whole file as-is, with
+// only its #include lines resolved (see ShaderLibrary.h).
 std::string ComputeShader::ReadFile(const std::string& filepath)
 {
 	if (!std::filesystem::exists(filepath))
@@ -110,7 +192,7 @@ std::string ComputeShader::ReadFile(const std::string& filepath)
 	std::ifstream stream(filepath);
 	std::stringstream ss;
 	ss << stream.rdbuf();
-	return ss.str();
+	return ShaderLibrary::ResolveIncludes(ss.str(), filepath);
 }
 
 /**
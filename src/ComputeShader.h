@@ -16,6 +16,13 @@
  *   2. EXECUTION: Instead of being used with draw calls (glDrawArrays etc.),
  *      a compute shader is launched with glDispatchCompute().
  *
+ * The work group size is read back from the linked program (its
+ * layout(local_size_x = ...)), so a caller sizes a dispatch by how many
+ * elements it covers, DispatchForElements, instead of keeping a copy of
+ * the shader's 256 in a WORK_GROUP_SIZE of its own. Every dispatch first
+ * issues the glMemoryBarrier that the uses declared to MemoryBarriers
+ * need; see MemoryBarriers.h.
+ *
  * Everything else — Bind(), Unbind(), setUniform*(), the destructor, the
  * uniform location cache — is inherited directly from Shader with zero changes.
  *
@@ -29,7 +36,27 @@ public:
 
 	void Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ) const;
 
+	// Enough work groups for one invocation per element of an x * y * z
+	// grid; the shader still checks its bounds. Returns the groups launched.
+	unsigned int DispatchForElements(unsigned int x, unsigned int y = 1, unsigned int z = 1) const;
+
+	// glDispatchComputeIndirect with the group counts at `offset` in
+	// `buffer` (three uints), which a shader may just have written: it is
+	// declared as a Command use. Leaves the buffer bound to
+	// GL_DISPATCH_INDIRECT_BUFFER.
+	void DispatchIndirect(unsigned int buffer, unsigned int offset) const;
+
+	// local_size_x, _y, _z, as linked
+	const glm::uvec3& GetWorkGroupSize() const { return m_WorkGroupSize; }
+
+	// As Shader::Prebuild, for a .glsl compute file: true if it was compiled
+	// into ShaderCache, false if it was there already
+	static bool Prebuild(const std::string& filepath);
+
 private:
-	std::string ReadFile(const std::string& filepath);
+	static std::string ReadFile(const std::string& filepath);
 	unsigned int Compile(const std::string& source);
+	void QueryWorkGroupSize();
+
+	glm::uvec3 m_WorkGroupSize;
 };
@@ -0,0 +1,248 @@
+#include "Culling.h"
+#include "Mesh/Vertex.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+Bounds Bounds::FromMinMax(const glm::vec3& min, const glm::vec3& max)
+{
+	Bounds bounds;
+	bounds.centre = 0.5f * (min + max);
+	bounds.extents = 0.5f * (max - min);
+	bounds.radius = glm::length(bounds.extents);
+	return bounds;
+}
+
+Bounds Bounds::FromVertices(const std::vector<Vertex>& vertices)
+{
+	if (vertices.empty())
+		return Bounds();
+
+	glm::vec3 min(vertices[0].position[0], vertices[0].position[1], vertices[0].position[2]);
+	glm::vec3 max = min;
+	for (const Vertex& vertex : vertices)
+	{
+		glm::vec3 p(vertex.position[0], vertex.position[1], vertex.position[2]);
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	Bounds bounds = FromMinMax(min, max);
+
+	// The box's corner distance is an upper bound; the farthest actual
+	// vertex is usually closer (e.g. a sphere mesh), so use that instead.
+	float radiusSquared = 0.0f;
+	for (const Vertex& vertex : vertices)
+	{
+		glm::vec3 offset = glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]) - bounds.centre;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	bounds.radius = std::sqrt(radiusSquared);
+	return bounds;
+}
+
+Bounds Bounds::Merge(const Bounds& a, const Bounds& b)
+{
+	Bounds merged = FromMinMax(glm::min(a.GetMin(), b.GetMin()), glm::max(a.GetMax(), b.GetMax()));
+
+	// Both spheres must fit inside the new one around the merged centre
+	merged.radius = std::max(glm::length(a.centre - merged.centre) + a.radius,
+	                         glm::length(b.centre - merged.centre) + b.radius);
+	merged.radius = std::min(merged.radius, glm::length(merged.extents));
+	return merged;
+}
+
+Bounds Bounds::Transformed(const glm::mat4& transform) const
+{
+	Bounds result;
+	result.centre = glm::vec3(transform * glm::vec4(centre, 1.0f));
+
+	// A rotated box's world extents: each world axis gets |row| . extents
+	// (Arvo's method), using the absolute value of the upper 3x3.
+	const glm::mat3 linear(transform);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		result.extents[axis] = std::abs(linear[0][axis]) * extents.x
+		                     + std::abs(linear[1][axis]) * extents.y
+		                     + std::abs(linear[2][axis]) * extents.z;
+	}
+
+	// Non-uniform scale stretches the sphere; the largest axis scale covers it
+	const float scale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+	result.radius = radius * scale;
+	return result;
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4& m)
+{
+	// glm is column-major: row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	Frustum frustum;
+	frustum.planes[0] = row3 + row0;   // left:   -w <= x
+	frustum.planes[1] = row3 - row0;   // right:   x <= w
+	frustum.planes[2] = row3 + row1;   // bottom: -w <= y
+	frustum.planes[3] = row3 - row1;   // top:     y <= w
+	frustum.planes[4] = row3 + row2;   // near:   -w <= z
+	frustum.planes[5] = row3 - row2;   // far:     z <= w
+
+	for (glm::vec4& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+
+Frustum Frustum::WithoutNearPlane() const
+{
+	// A zero normal: the distance to it is 1e30 for every point. Finite,
+	// so adding a box's reach in the batched tests cannot make a NaN.
+	Frustum frustum = *this;
+	frustum.planes[4] = glm::vec4(0.0f, 0.0f, 0.0f, 1e30f);
+	return frustum;
+}
+
+bool Frustum::Intersects(const Bounds& bounds) const
+{
+	for (const glm::vec4& plane : planes)
+	{
+		const float distance = glm::dot(glm::vec3(plane), bounds.centre) + plane.w;
+		const float boxRadius = std::abs(plane.x) * bounds.extents.x
+		                      + std::abs(plane.y) * bounds.extents.y
+		                      + std::abs(plane.z) * bounds.extents.z;
+		if (distance + std::min(boxRadius, bounds.radius) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+void CullBatch::Clear()
+{
+	m_CentreX.clear(); m_CentreY.clear(); m_CentreZ.clear();
+	m_ExtentX.clear(); m_ExtentY.clear(); m_ExtentZ.clear();
+	m_Radius.clear();
+}
+
+void CullBatch::Reserve(unsigned int count)
+{
+	m_CentreX.reserve(count); m_CentreY.reserve(count); m_CentreZ.reserve(count);
+	m_ExtentX.reserve(count); m_ExtentY.reserve(count); m_ExtentZ.reserve(count);
+	m_Radius.reserve(count);
+}
+
+unsigned int CullBatch::Add(const Bounds& worldBounds)
+{
+	const unsigned int index = GetCount();
+	m_CentreX.push_back(0.0f); m_CentreY.push_back(0.0f); m_CentreZ.push_back(0.0f);
+	m_ExtentX.push_back(0.0f); m_ExtentY.push_back(0.0f); m_ExtentZ.push_back(0.0f);
+	m_Radius.push_back(0.0f);
+	Set(index, worldBounds);
+	return index;
+}
+
+void CullBatch::Set(unsigned int index, const Bounds& worldBounds)
+{
+	m_CentreX[index] = worldBounds.centre.x;
+	m_CentreY[index] = worldBounds.centre.y;
+	m_CentreZ[index] = worldBounds.centre.z;
+	m_ExtentX[index] = worldBounds.extents.x;
+	m_ExtentY[index] = worldBounds.extents.y;
+	m_ExtentZ[index] = worldBounds.extents.z;
+	m_Radius[index] = worldBounds.radius;
+}
+
+Bounds CullBatch::Get(unsigned int index) const
+{
+	Bounds bounds;
+	bounds.centre = glm::vec3(m_CentreX[index], m_CentreY[index], m_CentreZ[index]);
+	bounds.extents = glm::vec3(m_ExtentX[index], m_ExtentY[index], m_ExtentZ[index]);
+	bounds.radius = m_Radius[index];
+	return bounds;
+}
+
+void CullBatch::Remove(unsigned int index)
+{
+	std::vector<float>* arrays[] = { &m_CentreX, &m_CentreY, &m_CentreZ, &m_ExtentX, &m_ExtentY, &m_ExtentZ, &m_Radius };
+	for (std::vector<float>* array : arrays)
+	{
+		(*array)[index] = array->back();
+		array->pop_back();
+	}
+}
+
+void CullBatch::TestRange(const Frustum& frustum, unsigned int begin, unsigned int end, uint8_t* inside) const
+{
+	const float* cx = m_CentreX.data() + begin;
+	const float* cy = m_CentreY.data() + begin;
+	const float* cz = m_CentreZ.data() + begin;
+	const float* ex = m_ExtentX.data() + begin;
+	const float* ey = m_ExtentY.data() + begin;
+	const float* ez = m_ExtentZ.data() + begin;
+	const float* r = m_Radius.data() + begin;
+	const unsigned int count = end - begin;
+
+	// Plane-major: the inner loop is the same arithmetic over contiguous
+	// floats with no early-out, so it vectorises.
+	for (const glm::vec4& plane : frustum.planes)
+	{
+		const float nx = plane.x, ny = plane.y, nz = plane.z, d = plane.w;
+		const float ax = std::abs(nx), ay = std::abs(ny), az = std::abs(nz);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const float distance = nx * cx[i] + ny * cy[i] + nz * cz[i] + d;
+			const float boxRadius = ax * ex[i] + ay * ey[i] + az * ez[i];
+			const float reach = boxRadius < r[i] ? boxRadius : r[i];
+			inside[i] &= static_cast<uint8_t>(distance + reach >= 0.0f);
+		}
+	}
+}
+
+unsigned int CullBatch::Cull(const Frustum& frustum, std::vector<unsigned int>& visible) const
+{
+	const unsigned int count = GetCount();
+	m_Inside.assign(count, 1);
+
+	// Big batches are tested a chunk per task; the compaction below is a
+	// scan of bytes and stays serial
+	if (count >= PARALLEL_CULL_SIZE)
+	{
+		ThreadPool::Get().ParallelFor(count, PARALLEL_CULL_SIZE / 4, [this, &frustum](unsigned int begin, unsigned int end, unsigned int)
+			{
+				TestRange(frustum, begin, end, m_Inside.data() + begin);
+			});
+	}
+	else
+	{
+		TestRange(frustum, 0, count, m_Inside.data());
+	}
+
+	const uint8_t* inside = m_Inside.data();
+
+	visible.clear();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (inside[i])
+			visible.push_back(i);
+	}
+	return static_cast<unsigned int>(visible.size());
+}
+
+void CullBatch::CullRange(const Frustum& frustum, unsigned int begin, unsigned int end, std::vector<unsigned int>& visible) const
+{
+	// A block of flags on the stack at a time, in place of m_Inside
+	const unsigned int BLOCK = 256;
+	uint8_t inside[BLOCK];
+	for (unsigned int block = begin; block < end; block += BLOCK)
+	{
+		const unsigned int blockEnd = std::min(block + BLOCK, end);
+		std::fill(inside, inside + (blockEnd - block), static_cast<uint8_t>(1));
+		TestRange(frustum, block, blockEnd, inside);
+		for (unsigned int i = block; i < blockEnd; i++)
+		{
+			if (inside[i - block])
+				visible.push_back(i);
+		}
+	}
+}
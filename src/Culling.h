@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+struct Vertex;
+
+/**
+ * Frustum culling
+ *
+ * Every object drawn costs a draw call (or an instance) plus vertex work for
+ * all its triangles, even when the whole thing is behind the camera. Culling
+ * skips objects that cannot be on screen by testing a cheap bounding volume
+ * against the six planes of the view frustum.
+ *
+ * BOUNDS
+ *   Each mesh keeps, in its local space, an axis-aligned box (centre +
+ *   half extents) and a sphere around the same centre. Transformed to world
+ *   space, the box becomes a (looser) world-aligned box; the sphere stays a
+ *   sphere. Testing against both and taking the tighter of the two is still
+ *   just a dot product per plane.
+ *
+ * FRUSTUM
+ *   The planes come straight out of the view-projection matrix (Gribb &
+ *   Hartmann): a clip-space point is inside when -w <= x, y, z <= w, and
+ *   each of those six inequalities is a plane in world space. Works for any
+ *   projection, including the light's ortho matrix for shadow passes.
+ *
+ * BATCHES
+ *   CullBatch stores the world bounds of many objects as separate arrays
+ *   (structure of arrays): centreX[], centreY[], ... The test loops over one
+ *   plane at a time across every object with no branches, which compilers
+ *   turn into SIMD code, instead of chasing pointers to each object.
+ *   From PARALLEL_CULL_SIZE objects the tests are split across the
+ *   ThreadPool in contiguous ranges, so each thread streams its own part
+ *   of the arrays. One Cull at a time per batch: the flags are shared.
+ */
+
+struct Bounds
+{
+	glm::vec3 centre = glm::vec3(0.0f);
+	glm::vec3 extents = glm::vec3(0.0f);   // half size of the box along each axis
+	float     radius = 0.0f;               // sphere around centre
+
+	glm::vec3 GetMin() const { return centre - extents; }
+	glm::vec3 GetMax() const { return centre + extents; }
+
+	static Bounds FromVertices(const std::vector<Vertex>& vertices);
+	static Bounds FromMinMax(const glm::vec3& min, const glm::vec3& max);
+
+	// The smallest bounds containing both
+	static Bounds Merge(const Bounds& a, const Bounds& b);
+
+	// Bounds of this volume after transform (e.g. Mesh::getTransformMatrix).
+	Bounds Transformed(const glm::mat4& transform) const;
+};
+
+struct Frustum
+{
+	// Normalised planes (xyz = normal pointing inwards, w = distance):
+	// left, right, bottom, top, near, far
+	glm::vec4 planes[6];
+
+	static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+	// This frustum with the near plane replaced by one every bounds passes
+	Frustum WithoutNearPlane() const;
+
+	bool Intersects(const Bounds& bounds) const;
+};
+
+class CullBatch
+{
+public:
+	void Clear();
+	void Reserve(unsigned int count);
+
+	// Returns the object's index in the batch.
+	unsigned int Add(const Bounds& worldBounds);
+	void Set(unsigned int index, const Bounds& worldBounds);
+	Bounds Get(unsigned int index) const;
+	// Moves the last object into `index` and drops the last
+	void Remove(unsigned int index);
+	unsigned int GetCount() const { return static_cast<unsigned int>(m_Radius.size()); }
+
+	// Write the indices of the objects that intersect the frustum to
+	// `visible` (replacing its contents) and return how many there are.
+	unsigned int Cull(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+
+	// Appends the objects of [begin, end) that intersect the frustum to
+	// `visible`. Uses no shared scratch, so threads may each cull a range.
+	void CullRange(const Frustum& frustum, unsigned int begin, unsigned int end, std::vector<unsigned int>& visible) const;
+
+	static const unsigned int PARALLEL_CULL_SIZE = 32768;
+
+private:
+	// Clears inside[i - begin] for the objects of [begin, end) outside the frustum
+	void TestRange(const Frustum& frustum, unsigned int begin, unsigned int end, uint8_t* inside) const;
+
+	std::vector<float> m_CentreX, m_CentreY, m_CentreZ;
+	std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ;
+	std::vector<float> m_Radius;
+
+	mutable std::vector<uint8_t> m_Inside;   // scratch, one flag per object
+};
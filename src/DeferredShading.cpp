@@ -0,0 +1,63 @@
+#include "DeferredShading.h"
+#include "Renderer.h"
+#include "GLState.h"
+
+DeferredShading::DeferredShading()
+{
+	m_GeometryShader = std::make_unique<Shader>("res/Shaders/Lighting/GBuffer.shader");
+	m_LightingShader = std::make_unique<Shader>("res/Shaders/Lighting/DeferredLighting.shader");
+	m_LightingShader->CompileAllVariants();
+	m_Quad = GeometryFactory::CreateFullscreenQuad();
+}
+
+void DeferredShading::BeginGeometryPass(int width, int height)
+{
+	if (!m_GBuffer || m_GBuffer->GetWidth() != width || m_GBuffer->GetHeight() != height)
+	{
+		// Attachment 0 is the Framebuffer's own RGBA8 colour texture: albedo
+		m_GBuffer = std::make_unique<Framebuffer>(width, height);
+		m_NormalTexture = m_GBuffer->AddColorAttachment(GL_RG16F);
+		m_MaterialTexture = m_GBuffer->AddColorAttachment(GL_RGBA8);
+	}
+
+	m_GBuffer->Bind();
+	GLState::Enable(GL_DEPTH_TEST);
+	GLState::DepthMask(true);
+	GlCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+}
+
+void DeferredShading::EndGeometryPass()
+{
+	m_GBuffer->Unbind();
+}
+
+void DeferredShading::LightingPass(const LightList& lights, const glm::mat4& view, const glm::mat4& projection,
+	int width, int height, Output output)
+{
+	if (!m_GBuffer)
+		return;
+
+	static const char* const outputs[] = { "LIT", "ALBEDO", "NORMAL", "POSITION" };
+	Shader& shader = m_LightingShader->Variant("OUTPUT", outputs[static_cast<int>(output)]);
+
+	GLState::Viewport(0, 0, width, height);
+	GLState::Disable(GL_DEPTH_TEST);
+	shader.Bind();
+	GLState::BindTextureToUnit(ALBEDO_UNIT, GL_TEXTURE_2D, GetAlbedoTexture());
+	GLState::BindTextureToUnit(NORMAL_UNIT, GL_TEXTURE_2D, m_NormalTexture);
+	GLState::BindTextureToUnit(MATERIAL_UNIT, GL_TEXTURE_2D, m_MaterialTexture);
+	GLState::BindTextureToUnit(DEPTH_UNIT, GL_TEXTURE_2D, GetDepthTexture());
+	shader.setUniform1i("u_Albedo", ALBEDO_UNIT);
+	shader.setUniform1i("u_Normal", NORMAL_UNIT);
+	shader.setUniform1i("u_Material", MATERIAL_UNIT);
+	shader.setUniform1i("u_Depth", DEPTH_UNIT);
+	shader.setUniformMat4f("u_InverseViewProjection", glm::inverse(projection * view));
+
+	lights.Bind();
+	shader.setUniform1i("uLightCount", static_cast<int>(lights.GetCount()));
+
+	m_Quad->Draw();
+
+	for (unsigned int unit : { ALBEDO_UNIT, NORMAL_UNIT, MATERIAL_UNIT, DEPTH_UNIT })
+		GLState::BindTextureToUnit(unit, GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <memory>
+
+#include "Framebuffer.h"
+#include "Shader.h"
+#include "LightList.h"
+#include "Mesh/GeometryFactory.h"
+
+#include "glm/glm.hpp"
+
+/**
+ * DeferredShading — a G-buffer, and a lighting pass that reads it
+ *
+ * Forward shading (PhongMultiple.shader) runs the whole light loop for
+ * every fragment rasterised, including the ones a nearer surface later
+ * overwrites; with hundreds of lights and a few layers of overdraw most of
+ * that work is thrown away. Deferred shading splits the frame in two:
+ *
+ *     deferred.BeginGeometryPass(width, height);
+ *     ... draw the opaque scene with GetGeometryShader() ...
+ *     deferred.EndGeometryPass();
+ *     deferred.LightingPass(lights, view, projection, width, height);
+ *
+ * The geometry pass stores each pixel's surface in the G-buffer, one
+ * Framebuffer with multiple render targets (16 bytes a pixel):
+ *
+ *     attachment 0  RGBA8   albedo
+ *     attachment 1  RG16F   normal, octahedral-encoded in two channels
+ *     attachment 2  RGBA8   ambient, diffuse, specular, shininess / 256
+ *     depth         24-bit  position is rebuilt from it, not stored
+ *
+ * The lighting pass then draws one full-screen quad into the bound
+ * framebuffer and loops over the LightList once per visible pixel, so its
+ * cost is pixels x lights whatever the scene's depth complexity, and
+ * pixels where nothing was drawn are discarded before the loop.
+ *
+ * LIGHT VOLUMES
+ *   Drawing a sphere per light and shading only the pixels inside would
+ *   cut the work further, but only for lights with a range
+ *   (GPULight::range); unbounded ones reach every pixel anyway. The pass
+ *   loops over the whole list; ClusteredLights is the way to skip the
+ *   lights that cannot reach a pixel.
+ *
+ * The G-buffer follows the size passed to BeginGeometryPass, recreated
+ * from the GpuResources pool when it changes. Transparent surfaces cannot
+ * go through it (one surface per pixel) and still draw forward afterwards.
+ */
+class DeferredShading
+{
+public:
+	// What LightingPass writes: the lit image, or a G-buffer view
+	enum class Output { Lit, Albedo, Normal, Position };
+
+	// Texture units LightingPass samples the G-buffer from
+	static const unsigned int ALBEDO_UNIT = 0;
+	static const unsigned int NORMAL_UNIT = 1;
+	static const unsigned int MATERIAL_UNIT = 2;
+	static const unsigned int DEPTH_UNIT = 3;
+
+	static const unsigned int BYTES_PER_PIXEL = 16;
+
+	DeferredShading();
+	DeferredShading(const DeferredShading&) = delete;
+	DeferredShading& operator=(const DeferredShading&) = delete;
+
+	// Binds the G-buffer at width x height and clears it, with depth
+	// testing and writing on
+	void BeginGeometryPass(int width, int height);
+	// Binds the default framebuffer
+	void EndGeometryPass();
+
+	// GBuffer.shader: PhongMultiple's material uniforms (uAlbedo,
+	// uAmbientIntensity ...) and u_Model. Any shader writing the three
+	// outputs in the same encoding will do.
+	Shader& GetGeometryShader() { return *m_GeometryShader; }
+
+	// Lights the G-buffer into the bound framebuffer, viewport width x
+	// height (the G-buffer's size). Leaves depth testing off.
+	void LightingPass(const LightList& lights, const glm::mat4& view, const glm::mat4& projection,
+		int width, int height, Output output = Output::Lit);
+
+	unsigned int GetAlbedoTexture() const { return m_GBuffer ? m_GBuffer->GetColorTexture() : 0; }
+	unsigned int GetNormalTexture() const { return m_NormalTexture; }
+	unsigned int GetMaterialTexture() const { return m_MaterialTexture; }
+	unsigned int GetDepthTexture() const { return m_GBuffer ? m_GBuffer->GetDepthTexture() : 0; }
+	int GetWidth() const { return m_GBuffer ? m_GBuffer->GetWidth() : 0; }
+	int GetHeight() const { return m_GBuffer ? m_GBuffer->GetHeight() : 0; }
+
+private:
+	std::unique_ptr<Framebuffer> m_GBuffer;
+	unsigned int m_NormalTexture = 0;
+	unsigned int m_MaterialTexture = 0;
+
+	std::unique_ptr<Shader> m_GeometryShader;
+	std::unique_ptr<Shader> m_LightingShader;
+	std::unique_ptr<Mesh> m_Quad;
+};
@@ -0,0 +1,111 @@
+#include "DrawIndirectBuffer.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+DrawIndirectBuffer::DrawIndirectBuffer()
+	: m_CommandBuffer(0), m_DrawDataBuffer(0), m_DrawIDBuffer(0), m_DrawIDCapacity(0), m_Dirty(false)
+{
+	GlCall(glGenBuffers(1, &m_CommandBuffer));
+	GlCall(glGenBuffers(1, &m_DrawDataBuffer));
+	GlCall(glGenBuffers(1, &m_DrawIDBuffer));
+
+	// Give the draw ID buffer storage now so a VAO can reference it before
+	// the first Upload. Growing later re-specifies the same buffer name, so
+	// VAOs that already point at it stay valid.
+	std::vector<unsigned int> ids(64);
+	for (unsigned int i = 0; i < ids.size(); i++)
+		ids[i] = i;
+	m_DrawIDCapacity = static_cast<unsigned int>(ids.size());
+
+	GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_DrawIDBuffer));
+	GlCall(glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(unsigned int), ids.data(), GL_STATIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Vertex, m_DrawIDBuffer, ids.size() * sizeof(unsigned int));
+}
+
+DrawIndirectBuffer::~DrawIndirectBuffer()
+{
+	GlCall(glDeleteBuffers(1, &m_CommandBuffer));
+	GlCall(glDeleteBuffers(1, &m_DrawDataBuffer));
+	GlCall(glDeleteBuffers(1, &m_DrawIDBuffer));
+	GLState::OnBufferDeleted(m_CommandBuffer);
+	GLState::OnBufferDeleted(m_DrawDataBuffer);
+	GLState::OnBufferDeleted(m_DrawIDBuffer);
+}
+
+void DrawIndirectBuffer::Clear()
+{
+	m_Commands.clear();
+	m_DrawData.clear();
+	m_Dirty = true;
+}
+
+unsigned int DrawIndirectBuffer::Add(unsigned int indexCount, unsigned int firstIndex, int baseVertex,
+	const glm::mat4& model, unsigned int materialIndex)
+{
+	unsigned int draw = static_cast<unsigned int>(m_Commands.size());
+
+	DrawElementsIndirectCommand command;
+	command.count = indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = firstIndex;
+	command.baseVertex = baseVertex;
+	command.baseInstance = draw;      // a_DrawID reads ids[baseInstance] == draw
+	m_Commands.push_back(command);
+
+	IndirectDrawData data;
+	data.model = model;
+	data.materialIndex = materialIndex;
+	m_DrawData.push_back(data);
+
+	m_Dirty = true;
+	return draw;
+}
+
+void DrawIndirectBuffer::SetModel(unsigned int draw, const glm::mat4& model)
+{
+	if (draw >= m_DrawData.size())
+		return;
+	m_DrawData[draw].model = model;
+	m_Dirty = true;
+}
+
+void DrawIndirectBuffer::Upload()
+{
+	if (!m_Dirty)
+		return;
+
+	const unsigned int drawCount = GetDrawCount();
+
+	if (drawCount > m_DrawIDCapacity)
+	{
+		while (m_DrawIDCapacity < drawCount)
+			m_DrawIDCapacity *= 2;
+
+		std::vector<unsigned int> ids(m_DrawIDCapacity);
+		for (unsigned int i = 0; i < ids.size(); i++)
+			ids[i] = i;
+
+		GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_DrawIDBuffer));
+		GlCall(glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(unsigned int), ids.data(), GL_STATIC_DRAW));
+		GpuMemory::TrackBuffer(GpuMemory::Category::Vertex, m_DrawIDBuffer, ids.size() * sizeof(unsigned int));
+	}
+
+	GlCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer));
+	GlCall(glBufferData(GL_DRAW_INDIRECT_BUFFER, m_Commands.size() * sizeof(DrawElementsIndirectCommand),
+		m_Commands.data(), GL_DYNAMIC_DRAW));
+
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_DrawDataBuffer));
+	GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, m_DrawData.size() * sizeof(IndirectDrawData),
+		m_DrawData.data(), GL_DYNAMIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_CommandBuffer, m_Commands.size() * sizeof(DrawElementsIndirectCommand));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_DrawDataBuffer, m_DrawData.size() * sizeof(IndirectDrawData));
+
+	m_Dirty = false;
+}
+
+void DrawIndirectBuffer::Bind() const
+{
+	GlCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer));
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, m_DrawDataBuffer));
+}
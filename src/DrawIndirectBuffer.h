@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include "glm/glm.hpp"
+
+/**
+ * DrawIndirectBuffer — many draws in one API call
+ *
+ * glMultiDrawElementsIndirect reads an array of draw commands from a GPU
+ * buffer and executes them all in a single call. Each command is just the
+ * arguments we would otherwise pass to glDrawElements:
+ *
+ *     { indexCount, instanceCount, firstIndex, baseVertex, baseInstance }
+ *
+ * so any number of meshes that live in the SAME vertex/index buffers (one
+ * VAO) can be drawn together — e.g. all the sub-meshes of a Model once they
+ * have been packed into shared buffers.
+ *
+ * PER-DRAW DATA
+ *
+ * Every draw in the batch runs the same shader with the same uniforms, so
+ * per-draw values (transform, material index) live in an SSBO indexed by
+ * the draw's position in the batch:
+ *
+ *     layout(std430, binding = 0) buffer DrawDataBuffer { DrawData u_Draws[]; };
+ *
+ * The shader needs to know which draw it is in. GL 4.6 exposes that as
+ * gl_DrawID, but our context is 4.3, so we use the portable trick instead:
+ * each command's baseInstance is set to its draw index, and a vertex
+ * attribute with divisor 1 reads a buffer containing 0, 1, 2, ... — so
+ * attribute a_DrawID (location 13) equals the draw index. This relies on
+ * instanceCount being 1 for every command, which Add() guarantees.
+ *
+ * Usage:
+ *     indirect.Add(indexCount, firstIndex, baseVertex, model, material);
+ *     ...
+ *     indirect.Upload();                      // once, or when data changes
+ *     vao.AddDrawIndirectBuffer(indirect);    // once per VAO
+ *     renderer.DrawIndirect(vao, indirect, first, count);
+ */
+
+// Layout fixed by the GL spec for GL_DRAW_INDIRECT_BUFFER contents
+struct DrawElementsIndirectCommand
+{
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	int          baseVertex;
+	unsigned int baseInstance;
+};
+
+// Matches the std430 DrawData struct in the shader (80 bytes:
+// a mat4 then a uint padded out to a full vec4)
+struct IndirectDrawData
+{
+	glm::mat4    model = glm::mat4(1.0f);
+	unsigned int materialIndex = 0;
+	unsigned int padding[3] = { 0, 0, 0 };
+};
+
+class DrawIndirectBuffer
+{
+public:
+	static const unsigned int DRAW_ID_LOCATION = 13;
+	static const unsigned int DRAW_DATA_BINDING = 0;
+
+	DrawIndirectBuffer();
+	~DrawIndirectBuffer();
+	DrawIndirectBuffer(const DrawIndirectBuffer&) = delete;
+	DrawIndirectBuffer& operator=(const DrawIndirectBuffer&) = delete;
+
+	void Clear();
+
+	// Record one draw; returns its index within the buffer.
+	unsigned int Add(unsigned int indexCount, unsigned int firstIndex, int baseVertex,
+		const glm::mat4& model = glm::mat4(1.0f), unsigned int materialIndex = 0);
+
+	void SetModel(unsigned int draw, const glm::mat4& model);
+
+	// Copy the commands and per-draw data to the GPU. Only does work if
+	// something changed since the last upload.
+	void Upload();
+
+	// Binds the command buffer and the per-draw SSBO.
+	void Bind() const;
+
+	unsigned int GetDrawCount() const { return static_cast<unsigned int>(m_Commands.size()); }
+	unsigned int GetDrawIDBuffer() const { return m_DrawIDBuffer; }
+
+private:
+	std::vector<DrawElementsIndirectCommand> m_Commands;
+	std::vector<IndirectDrawData> m_DrawData;
+
+	unsigned int m_CommandBuffer;
+	unsigned int m_DrawDataBuffer;
+	unsigned int m_DrawIDBuffer;      // 0, 1, 2, ... read through a_DrawID
+	unsigned int m_DrawIDCapacity;
+	bool m_Dirty;
+};
@@ -0,0 +1,122 @@
+#include "DynamicResolution.h"
+#include "Renderer.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution()
+{
+	m_UpscaleShader = std::make_unique<Shader>("res/Shaders/Effects/Upscale.shader");
+	m_UpscaleShader->CompileAllVariants();
+	m_Quad = GeometryFactory::CreateFullscreenQuad();
+	GlCall(glGenQueries(QUERY_COUNT, m_Queries));
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	GlCall(glDeleteQueries(QUERY_COUNT, m_Queries));
+}
+
+void DynamicResolution::Begin(int width, int height)
+{
+	ReadQueries();
+	if (++m_Frames >= std::max(m_Settings.interval, 1))
+		Adjust();
+	if (!m_Settings.enabled)
+		m_Scale = std::min(std::max(m_Settings.fixedScale, 0.05f), 1.0f);
+
+	const int targetWidth = std::max(1, static_cast<int>(std::lround(width * m_Scale)));
+	const int targetHeight = std::max(1, static_cast<int>(std::lround(height * m_Scale)));
+	if (!m_Target || m_Target->GetWidth() != targetWidth || m_Target->GetHeight() != targetHeight)
+		m_Target = std::make_unique<Framebuffer>(targetWidth, targetHeight);
+	m_Target->Bind();
+
+	// A query still in flight a ring later means the GPU is far behind;
+	// skip timing this frame rather than wait for it
+	m_ActiveQuery = -1;
+	if (!m_QueryPending[m_NextQuery])
+	{
+		m_ActiveQuery = m_NextQuery;
+		m_NextQuery = (m_NextQuery + 1) % QUERY_COUNT;
+		GlCall(glBeginQuery(GL_TIME_ELAPSED, m_Queries[m_ActiveQuery]));
+	}
+}
+
+void DynamicResolution::BindTarget() const
+{
+	m_Target->Bind();
+}
+
+void DynamicResolution::End()
+{
+	if (m_ActiveQuery >= 0)
+	{
+		GlCall(glEndQuery(GL_TIME_ELAPSED));
+		m_QueryPending[m_ActiveQuery] = true;
+		m_ActiveQuery = -1;
+	}
+	m_Target->Unbind();
+}
+
+void DynamicResolution::Upscale(int width, int height)
+{
+	if (!m_Target)
+		return;
+
+	Shader& shader = m_UpscaleShader->Variant("FILTER", m_Settings.filter == Filter::Sharpen ? "SHARPEN" : "BILINEAR");
+	GLState::Viewport(0, 0, width, height);
+	GLState::Disable(GL_DEPTH_TEST);
+	shader.Bind();
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D, m_Target->GetColorTexture());
+	shader.setUniform1i("u_Source", 0);
+	shader.setUniform2f("u_SourceSize", static_cast<float>(m_Target->GetWidth()), static_cast<float>(m_Target->GetHeight()));
+	shader.setUniform1f("u_Sharpness", m_Settings.sharpness);
+	m_Quad->Draw();
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D, 0);
+}
+
+void DynamicResolution::ReadQueries()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		if (!m_QueryPending[i])
+			continue;
+		GLint available = 0;
+		GlCall(glGetQueryObjectiv(m_Queries[i], GL_QUERY_RESULT_AVAILABLE, &available));
+		if (!available)
+			continue;
+		GLuint64 ns = 0;
+		GlCall(glGetQueryObjectui64v(m_Queries[i], GL_QUERY_RESULT, &ns));
+		m_MeasuredMs += ns / 1000000.0;
+		m_Measured++;
+		m_QueryPending[i] = false;
+	}
+}
+
+void DynamicResolution::Adjust()
+{
+	m_Frames = 0;
+	if (m_Measured == 0)
+		return;
+
+	m_GpuMs = static_cast<float>(m_MeasuredMs / m_Measured);
+	m_MeasuredMs = 0.0;
+	m_Measured = 0;
+
+	if (m_Settings.enabled && m_GpuMs > 0.0f)
+	{
+		const float ratio = m_Settings.targetMs / m_GpuMs;
+		if (std::abs(ratio - 1.0f) > 0.05f)
+		{
+			const float step = std::min(std::max(std::sqrt(ratio), 0.85f), 1.15f);
+			const float lowest = std::min(std::max(m_Settings.minScale, 0.05f), 1.0f);
+			const float highest = std::min(std::max(m_Settings.maxScale, lowest), 1.0f);
+			m_Scale = std::min(std::max(m_Scale * step, lowest), highest);
+		}
+	}
+
+	m_ScaleHistory[m_HistoryIndex] = m_Scale;
+	m_TimeHistory[m_HistoryIndex] = m_GpuMs;
+	m_HistoryIndex = (m_HistoryIndex + 1) % HISTORY_SIZE;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <memory>
+
+#include "Framebuffer.h"
+#include "Shader.h"
+#include "Mesh/GeometryFactory.h"
+
+/**
+ * DynamicResolution — render below native size when the GPU can't keep up
+ *
+ * A full-screen procedural shader costs one heavy fragment invocation per
+ * pixel, so its frame time scales with the pixel count. Between Begin and
+ * End everything draws into an offscreen Framebuffer `scale` times the
+ * window in each axis; Upscale then stretches it over the window.
+ *
+ *     dynamicResolution.Begin(width, height);
+ *     ... draw at GetWidth() x GetHeight() ...
+ *     dynamicResolution.End();
+ *     dynamicResolution.Upscale(width, height);
+ *
+ * CONTROL
+ *   The Begin..End region is timed with GL_TIME_ELAPSED queries from a
+ *   small ring, read only once their results are available, so the CPU
+ *   never waits on them. Every `interval` frames the measured average is
+ *   compared to `targetMs`: pixel cost goes with scale^2, so the scale
+ *   moves by sqrt(target / measured), limited to 15% a step and ignored
+ *   within 5% of the target so it settles instead of hunting. Each new
+ *   size recreates the Framebuffer, whose textures come from the
+ *   GpuResources pool, so revisiting a size allocates nothing.
+ *
+ * UPSCALING
+ *   Bilinear, or bilinear followed by a contrast-adaptive sharpen that
+ *   restores edges the stretch softened while leaving flat areas and
+ *   already-sharp edges alone (see Upscale.shader).
+ */
+class DynamicResolution
+{
+public:
+	enum class Filter { Bilinear, Sharpen };
+
+	struct Settings
+	{
+		bool enabled = true;           // false holds fixedScale
+		float targetMs = 8.0f;         // GPU time of the Begin..End region
+		float minScale = 0.25f;
+		float maxScale = 1.0f;
+		float fixedScale = 1.0f;
+		int interval = 8;              // frames between adjustments
+		Filter filter = Filter::Sharpen;
+		float sharpness = 0.5f;        // 0..1, Sharpen only
+	};
+
+	static const int HISTORY_SIZE = 120;
+
+	DynamicResolution();
+	~DynamicResolution();
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+	// Binds the offscreen target for a width x height window and starts
+	// timing. The viewport is the target's.
+	void Begin(int width, int height);
+	// Binds the target again, after drawing elsewhere between Begin and End
+	void BindTarget() const;
+	// Stops timing and binds the default framebuffer
+	void End();
+	// Stretches the target over the bound framebuffer's width x height.
+	// Leaves depth testing off.
+	void Upscale(int width, int height);
+
+	Settings& GetSettings() { return m_Settings; }
+	float GetScale() const { return m_Scale; }
+	int GetWidth() const { return m_Target ? m_Target->GetWidth() : 0; }
+	int GetHeight() const { return m_Target ? m_Target->GetHeight() : 0; }
+	unsigned int GetColorTexture() const { return m_Target ? m_Target->GetColorTexture() : 0; }
+	float GetGpuMs() const { return m_GpuMs; }     // averaged over the last interval
+
+	// One entry per adjustment, oldest at GetHistoryOffset()
+	const float* GetScaleHistory() const { return m_ScaleHistory; }
+	const float* GetTimeHistory() const { return m_TimeHistory; }
+	int GetHistoryOffset() const { return m_HistoryIndex; }
+
+private:
+	static const int QUERY_COUNT = 4;
+
+	void ReadQueries();
+	void Adjust();
+
+	Settings m_Settings;
+	float m_Scale = 1.0f;
+	std::unique_ptr<Framebuffer> m_Target;
+
+	std::unique_ptr<Shader> m_UpscaleShader;
+	std::unique_ptr<Mesh> m_Quad;
+
+	unsigned int m_Queries[QUERY_COUNT] = {};
+	bool m_QueryPending[QUERY_COUNT] = {};
+	int m_NextQuery = 0;
+	int m_ActiveQuery = -1;           // begun by Begin, ended by End
+
+	// Results since the last adjustment
+	double m_MeasuredMs = 0.0;
+	int m_Measured = 0;
+	int m_Frames = 0;
+	float m_GpuMs = 0.0f;
+
+	float m_ScaleHistory[HISTORY_SIZE] = {};
+	float m_TimeHistory[HISTORY_SIZE] = {};
+	int m_HistoryIndex = 0;
+};
@@ -0,0 +1,397 @@
+#include "EnvironmentLighting.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "ComputeShader.h"
+#include "vendor/stb_image.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+const char* const EnvironmentLighting::CACHE_DIRECTORY = "res/IBLCache";
+
+namespace
+{
+	const char* const ENVIRONMENT_SHADER = "res/Shaders/Lighting/IBLEnvironment.glsl";
+	const char* const IRRADIANCE_SHADER = "res/Shaders/Lighting/IBLIrradianceSH.glsl";
+	const char* const PREFILTER_SHADER = "res/Shaders/Lighting/IBLPrefilter.glsl";
+	const char* const BRDF_LUT_SHADER = "res/Shaders/Lighting/IBLBrdfLut.glsl";
+
+	// Face resolution the irradiance pass reads: plenty for 9 coefficients
+	const int SH_SAMPLE_SIZE = 64;
+	const int PREFILTER_SAMPLES = 256;
+	const int BRDF_LUT_SAMPLES = 512;
+
+	// File header, followed by the SH coefficients (27 floats), the LUT
+	// (RG half floats) and the prefiltered map, level by level, face by
+	// face (RGBA half floats)
+	struct CacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;        // guards against a renamed or mixed-up file
+		uint32_t prefilterSize;
+		uint32_t prefilterLevels;
+		uint32_t lutSize;
+		uint32_t procedural;
+	};
+
+	const uint32_t CACHE_MAGIC = 0x434C4249;   // "IBLC"
+	const uint32_t CACHE_VERSION = 1;
+
+	void FnvAppend(uint64_t& hash, const char* data, std::size_t size)
+	{
+		for (std::size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ull;
+		}
+	}
+
+	std::string ReadBytes(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return std::string();
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		return contents.str();
+	}
+
+	std::filesystem::path CachePath(uint64_t key)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.ibl", static_cast<unsigned long long>(key));
+		return std::filesystem::path(EnvironmentLighting::CACHE_DIRECTORY) / name;
+	}
+
+	int LevelSize(int level)
+	{
+		return EnvironmentLighting::PREFILTER_SIZE >> level;
+	}
+
+	int LevelCount(int size)
+	{
+		int levels = 1;
+		for (; size > 1; size /= 2)
+			levels++;
+		return levels;
+	}
+
+	// Half floats in the prefiltered map and the LUT
+	std::size_t PrefilterTexels()
+	{
+		std::size_t texels = 0;
+		for (int level = 0; level < EnvironmentLighting::PREFILTER_LEVELS; level++)
+			texels += 6 * static_cast<std::size_t>(LevelSize(level)) * LevelSize(level);
+		return texels;
+	}
+
+	std::size_t LutTexels()
+	{
+		return static_cast<std::size_t>(EnvironmentLighting::LUT_SIZE) * EnvironmentLighting::LUT_SIZE;
+	}
+
+	void SetCubeSampling(int levels)
+	{
+		GlCall(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0));
+		GlCall(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1));
+		GlCall(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+		GlCall(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+		GlCall(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+		GlCall(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+		GlCall(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+	}
+}
+
+EnvironmentLighting::EnvironmentLighting(const std::string& hdrPath)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// Filter across cube face edges, or the blurred mips show seams
+	GLState::Enable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	const std::string hdrBytes = hdrPath.empty() ? std::string() : ReadBytes(hdrPath);
+	m_Procedural = hdrBytes.empty();
+	if (m_Procedural && !hdrPath.empty())
+		std::cout << "EnvironmentLighting: no " << hdrPath << ", using the procedural sky" << std::endl;
+
+	// Everything the results depend on
+	uint64_t key = 14695981039346656037ull;
+	const uint32_t settings[] = { CACHE_VERSION, ENVIRONMENT_SIZE, PREFILTER_SIZE, PREFILTER_LEVELS,
+		LUT_SIZE, SH_SAMPLE_SIZE, PREFILTER_SAMPLES, BRDF_LUT_SAMPLES };
+	FnvAppend(key, reinterpret_cast<const char*>(settings), sizeof(settings));
+	for (const char* path : { ENVIRONMENT_SHADER, IRRADIANCE_SHADER, PREFILTER_SHADER, BRDF_LUT_SHADER })
+	{
+		const std::string text = ReadBytes(path);
+		FnvAppend(key, text.data(), text.size());
+	}
+	FnvAppend(key, hdrBytes.data(), hdrBytes.size());
+
+	CreateTextures();
+	m_FromCache = LoadCache(key);
+	if (!m_FromCache)
+	{
+		Bake(hdrBytes);
+		StoreCache(key);
+	}
+
+	GlCall(glFinish());
+	m_LoadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "EnvironmentLighting: " << (m_FromCache ? "loaded from cache" : "baked") << " in "
+	          << m_LoadMs << " ms" << std::endl;
+}
+
+EnvironmentLighting::~EnvironmentLighting()
+{
+	GlCall(glDeleteTextures(1, &m_PrefilteredMap));
+	GLState::OnTextureDeleted(m_PrefilteredMap);
+	GlCall(glDeleteTextures(1, &m_BrdfLut));
+	GLState::OnTextureDeleted(m_BrdfLut);
+}
+
+void EnvironmentLighting::Apply(Shader& shader, float intensity) const
+{
+	GLState::BindTextureToUnit(PREFILTER_UNIT, GL_TEXTURE_CUBE_MAP, m_PrefilteredMap);
+	GLState::BindTextureToUnit(LUT_UNIT, GL_TEXTURE_2D, m_BrdfLut);
+	shader.setUniform1i("u_PrefilteredMap", PREFILTER_UNIT);
+	shader.setUniform1i("u_BrdfLut", LUT_UNIT);
+	shader.setUniform1f("u_PrefilterLevels", static_cast<float>(PREFILTER_LEVELS - 1));
+	shader.setUniform1f("u_IBLIntensity", intensity);
+	// Any shader may be passed in, so the element names are spelled out
+	// once rather than held as one shader's handles
+	static const char* names[SH_COEFFICIENTS] =
+	{
+		"u_IrradianceSH[0]", "u_IrradianceSH[1]", "u_IrradianceSH[2]", "u_IrradianceSH[3]", "u_IrradianceSH[4]",
+		"u_IrradianceSH[5]", "u_IrradianceSH[6]", "u_IrradianceSH[7]", "u_IrradianceSH[8]"
+	};
+	for (int i = 0; i < SH_COEFFICIENTS; i++)
+		shader.setUniform3f(names[i], m_IrradianceSH[i].r, m_IrradianceSH[i].g, m_IrradianceSH[i].b);
+}
+
+std::size_t EnvironmentLighting::GetBytes()
+{
+	// RGBA16F is 8 bytes a texel, RG16F 4
+	return PrefilterTexels() * 8 + LutTexels() * 4;
+}
+
+void EnvironmentLighting::ClearCache()
+{
+	std::error_code ignored;
+	std::filesystem::remove_all(CACHE_DIRECTORY, ignored);
+}
+
+void EnvironmentLighting::CreateTextures()
+{
+	GlCall(glGenTextures(1, &m_PrefilteredMap));
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, m_PrefilteredMap);
+	GlCall(glTexStorage2D(GL_TEXTURE_CUBE_MAP, PREFILTER_LEVELS, GL_RGBA16F, PREFILTER_SIZE, PREFILTER_SIZE));
+	SetCubeSampling(PREFILTER_LEVELS);
+	GpuMemory::TrackTexture(GpuMemory::Category::Texture, m_PrefilteredMap, PrefilterTexels() * 8);
+
+	GlCall(glGenTextures(1, &m_BrdfLut));
+	GLState::BindTexture(GL_TEXTURE_2D, m_BrdfLut);
+	GlCall(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG16F, LUT_SIZE, LUT_SIZE));
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	GpuMemory::TrackTexture(GpuMemory::Category::Texture, m_BrdfLut, LutTexels() * 4);
+}
+
+void EnvironmentLighting::Bake(const std::string& hdrBytes)
+{
+	// The .hdr as an equirectangular RGB16F texture; without one the
+	// environment pass draws the procedural sky instead
+	unsigned int equirect = 0;
+	if (!m_Procedural)
+	{
+		int width = 0, height = 0, channels = 0;
+		stbi_set_flip_vertically_on_load_thread(1);
+		float* pixels = stbi_loadf_from_memory(reinterpret_cast<const stbi_uc*>(hdrBytes.data()),
+			static_cast<int>(hdrBytes.size()), &width, &height, &channels, 3);
+		if (pixels)
+		{
+			GlCall(glGenTextures(1, &equirect));
+			GLState::BindTexture(GL_TEXTURE_2D, equirect);
+			GlCall(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB16F, width, height));
+			GlCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_FLOAT, pixels));
+			// Longitude wraps, latitude stops at the poles
+			GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+			GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+			GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
+			GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+			stbi_image_free(pixels);
+		}
+		else
+		{
+			std::cout << "EnvironmentLighting: could not decode the .hdr (" << stbi_failure_reason()
+			          << "), using the procedural sky" << std::endl;
+			m_Procedural = true;
+		}
+	}
+
+	// 1. The source cubemap, mipmapped for the prefilter's lookups
+	const int environmentLevels = LevelCount(ENVIRONMENT_SIZE);
+	unsigned int environment = 0;
+	GlCall(glGenTextures(1, &environment));
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, environment);
+	GlCall(glTexStorage2D(GL_TEXTURE_CUBE_MAP, environmentLevels, GL_RGBA16F, ENVIRONMENT_SIZE, ENVIRONMENT_SIZE));
+	SetCubeSampling(environmentLevels);
+
+	ComputeShader environmentPass(ENVIRONMENT_SHADER);
+	environmentPass.Bind();
+	environmentPass.setUniform1i("u_Procedural", m_Procedural ? 1 : 0);
+	environmentPass.setUniform1i("u_Size", ENVIRONMENT_SIZE);
+	environmentPass.setUniform1i("u_Equirect", 0);
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D, equirect);
+	GlCall(glBindImageTexture(0, environment, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F));
+	environmentPass.Dispatch(ENVIRONMENT_SIZE / 8, ENVIRONMENT_SIZE / 8, 6);
+
+	GlCall(glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT));
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, environment);
+	GlCall(glGenerateMipmap(GL_TEXTURE_CUBE_MAP));
+	GLState::BindTextureToUnit(0, GL_TEXTURE_CUBE_MAP, environment);
+
+	// 2. Irradiance: one work group sums the SH projection into a
+	// small storage buffer, read straight back
+	unsigned int coefficients = 0;
+	GlCall(glGenBuffers(1, &coefficients));
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, coefficients));
+	GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, SH_COEFFICIENTS * sizeof(glm::vec4), nullptr, GL_STREAM_READ));
+	// Binding 0 only for the bake: every user of it binds its own buffer first
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, coefficients));
+
+	ComputeShader irradiancePass(IRRADIANCE_SHADER);
+	irradiancePass.Bind();
+	irradiancePass.setUniform1i("u_Environment", 0);
+	irradiancePass.setUniform1i("u_SampleSize", SH_SAMPLE_SIZE);
+	irradiancePass.setUniform1f("u_SampleLevel", static_cast<float>(LevelCount(ENVIRONMENT_SIZE / SH_SAMPLE_SIZE) - 1));
+	irradiancePass.Dispatch(1, 1, 1);
+
+	GlCall(glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT));
+	glm::vec4 sums[SH_COEFFICIENTS];
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, coefficients));
+	GlCall(glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(sums), sums));
+	for (int i = 0; i < SH_COEFFICIENTS; i++)
+		m_IrradianceSH[i] = glm::vec3(sums[i]);
+	GlCall(glDeleteBuffers(1, &coefficients));
+	GLState::OnBufferDeleted(coefficients);
+
+	// 3. Prefiltered specular, one dispatch per mip (= roughness)
+	ComputeShader prefilterPass(PREFILTER_SHADER);
+	prefilterPass.Bind();
+	prefilterPass.setUniform1i("u_Environment", 0);
+	prefilterPass.setUniform1f("u_SourceSize", static_cast<float>(ENVIRONMENT_SIZE));
+	prefilterPass.setUniform1i("u_SampleCount", PREFILTER_SAMPLES);
+	for (int level = 0; level < PREFILTER_LEVELS; level++)
+	{
+		const int size = LevelSize(level);
+		prefilterPass.setUniform1i("u_Size", size);
+		prefilterPass.setUniform1f("u_Roughness", static_cast<float>(level) / (PREFILTER_LEVELS - 1));
+		GlCall(glBindImageTexture(0, m_PrefilteredMap, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F));
+		prefilterPass.Dispatch((size + 7) / 8, (size + 7) / 8, 6);
+	}
+
+	// 4. The BRDF LUT
+	ComputeShader lutPass(BRDF_LUT_SHADER);
+	lutPass.Bind();
+	lutPass.setUniform1i("u_Size", LUT_SIZE);
+	lutPass.setUniform1i("u_SampleCount", BRDF_LUT_SAMPLES);
+	GlCall(glBindImageTexture(1, m_BrdfLut, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F));
+	lutPass.Dispatch(LUT_SIZE / 8, LUT_SIZE / 8, 1);
+
+	GlCall(glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT));
+	GLState::BindTextureToUnit(0, GL_TEXTURE_CUBE_MAP, 0);
+
+	// The sources are only needed for the bake
+	GlCall(glDeleteTextures(1, &environment));
+	GLState::OnTextureDeleted(environment);
+	if (equirect != 0)
+	{
+		GlCall(glDeleteTextures(1, &equirect));
+		GLState::OnTextureDeleted(equirect);
+	}
+}
+
+bool EnvironmentLighting::LoadCache(uint64_t key)
+{
+	std::ifstream file(CachePath(key), std::ios::binary);
+	if (!file)
+		return false;
+
+	CacheHeader header = {};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key
+		|| header.prefilterSize != PREFILTER_SIZE || header.prefilterLevels != PREFILTER_LEVELS
+		|| header.lutSize != LUT_SIZE)
+		return false;
+
+	glm::vec3 sh[SH_COEFFICIENTS];
+	std::vector<uint16_t> lut(LutTexels() * 2);
+	std::vector<uint16_t> prefiltered(PrefilterTexels() * 4);
+	file.read(reinterpret_cast<char*>(sh), sizeof(sh));
+	file.read(reinterpret_cast<char*>(lut.data()), lut.size() * sizeof(uint16_t));
+	file.read(reinterpret_cast<char*>(prefiltered.data()), prefiltered.size() * sizeof(uint16_t));
+	if (!file)
+		return false;
+
+	for (int i = 0; i < SH_COEFFICIENTS; i++)
+		m_IrradianceSH[i] = sh[i];
+	m_Procedural = header.procedural != 0;
+
+	GLState::BindTexture(GL_TEXTURE_2D, m_BrdfLut);
+	GlCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, LUT_SIZE, LUT_SIZE, GL_RG, GL_HALF_FLOAT, lut.data()));
+
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, m_PrefilteredMap);
+	const uint16_t* texels = prefiltered.data();
+	for (int level = 0; level < PREFILTER_LEVELS; level++)
+	{
+		const int size = LevelSize(level);
+		for (int face = 0; face < 6; face++)
+		{
+			GlCall(glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, 0, 0, size, size,
+				GL_RGBA, GL_HALF_FLOAT, texels));
+			texels += static_cast<std::size_t>(size) * size * 4;
+		}
+	}
+	return true;
+}
+
+void EnvironmentLighting::StoreCache(uint64_t key) const
+{
+	std::vector<uint16_t> lut(LutTexels() * 2);
+	GLState::BindTexture(GL_TEXTURE_2D, m_BrdfLut);
+	GlCall(glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_HALF_FLOAT, lut.data()));
+
+	std::vector<uint16_t> prefiltered(PrefilterTexels() * 4);
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, m_PrefilteredMap);
+	uint16_t* texels = prefiltered.data();
+	for (int level = 0; level < PREFILTER_LEVELS; level++)
+	{
+		const int size = LevelSize(level);
+		for (int face = 0; face < 6; face++)
+		{
+			GlCall(glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGBA, GL_HALF_FLOAT, texels));
+			texels += static_cast<std::size_t>(size) * size * 4;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(CACHE_DIRECTORY, error);
+	if (error)
+		return;
+
+	CacheHeader header = { CACHE_MAGIC, CACHE_VERSION, key, PREFILTER_SIZE, PREFILTER_LEVELS, LUT_SIZE,
+		m_Procedural ? 1u : 0u };
+	std::ofstream file(CachePath(key), std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(m_IrradianceSH), sizeof(m_IrradianceSH));
+	file.write(reinterpret_cast<const char*>(lut.data()), lut.size() * sizeof(uint16_t));
+	file.write(reinterpret_cast<const char*>(prefiltered.data()), prefiltered.size() * sizeof(uint16_t));
+}
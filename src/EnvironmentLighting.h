@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Shader.h"
+
+#include "glm/glm.hpp"
+
+/**
+ * EnvironmentLighting — image-based lighting, baked once and cached
+ *
+ * PBR.shader's ambient term is a flat vec3(0.03): nothing reflects the
+ * surroundings. Integrating the environment against the BRDF per pixel
+ * would take hundreds of samples a fragment, every frame, for a result
+ * that only depends on the environment and the material. The "split sum"
+ * approximation separates it into pieces that can be computed ahead of
+ * time, so IBL costs the shader a handful of fetches:
+ *
+ *     EnvironmentLighting environment("res/Textures/environment.hdr");
+ *     Shader& shader = pbr.Variant("IBL", "ON");
+ *     shader.Bind();
+ *     environment.Apply(shader);
+ *     ... draw ...
+ *
+ * WHAT IS BAKED
+ *   Irradiance      9 spherical harmonic coefficients (RGB) of the
+ *                   cosine-convolved environment, divided by pi: the
+ *                   diffuse light from every direction, evaluated per
+ *                   pixel from the normal with a few multiply-adds.
+ *   Prefiltered     a PREFILTER_SIZE cubemap whose PREFILTER_LEVELS mips
+ *                   are the environment convolved with GGX lobes of
+ *                   roughness 0, 1/(levels-1) .. 1: textureLod(R,
+ *                   roughness * (levels-1)) is the specular radiance.
+ *   BRDF LUT        LUT_SIZE^2 RG16F, the scale and bias applied to F0
+ *                   for (N.V, roughness): the other half of the sum. It
+ *                   does not depend on the environment.
+ *
+ * All three are compute passes (IBLEnvironment, IBLIrradianceSH,
+ * IBLPrefilter and IBLBrdfLut.glsl in res/Shaders/Lighting). The source
+ * environment is an equirectangular .hdr, projected to an
+ * ENVIRONMENT_SIZE cubemap with a full mip chain so the prefilter can
+ * fetch pre-averaged texels instead of taking more samples ("filtered
+ * importance sampling"). Without a file, a procedural sky is used.
+ *
+ * CACHE
+ *   The results are written to CACHE_DIRECTORY, keyed by a hash of the
+ *   .hdr file, the bake shaders' text and the sizes, and read back the
+ *   next time instead of baking: no .hdr decode, no compute. Editing a
+ *   bake shader or replacing the .hdr bakes afresh; ClearCache() forces it.
+ *
+ * The source cubemap is not kept; the prefiltered map's level 0 (the
+ * mirror reflection) doubles as the background, see GetPrefilteredMap.
+ *
+ * GL thread only.
+ */
+class EnvironmentLighting
+{
+public:
+	static const int ENVIRONMENT_SIZE = 256;    // source cube faces, baking only
+	static const int PREFILTER_SIZE = 128;
+	static const int PREFILTER_LEVELS = 5;
+	static const int LUT_SIZE = 128;
+	static const int SH_COEFFICIENTS = 9;
+
+	// Texture units Apply binds, clear of the material textures
+	static const unsigned int PREFILTER_UNIT = 6;
+	static const unsigned int LUT_UNIT = 7;
+
+	static const char* const CACHE_DIRECTORY;
+
+	// `hdrPath`: an equirectangular Radiance .hdr; empty or unreadable
+	// falls back to the procedural sky
+	explicit EnvironmentLighting(const std::string& hdrPath = "");
+	~EnvironmentLighting();
+	EnvironmentLighting(const EnvironmentLighting&) = delete;
+	EnvironmentLighting& operator=(const EnvironmentLighting&) = delete;
+
+	// Bind the maps and set the IBL uniforms on a bound IBL=ON shader;
+	// `intensity` scales the whole environment
+	void Apply(Shader& shader, float intensity = 1.0f) const;
+
+	// Cubemap of PREFILTER_LEVELS mips: level 0 is the environment itself
+	// at PREFILTER_SIZE, the rest increasingly blurred
+	unsigned int GetPrefilteredMap() const { return m_PrefilteredMap; }
+	unsigned int GetBrdfLut() const { return m_BrdfLut; }
+	const glm::vec3* GetIrradianceSH() const { return m_IrradianceSH; }
+
+	// What the constructor did: baked (and stored) or read the cache
+	bool WasLoadedFromCache() const { return m_FromCache; }
+	float GetLoadMs() const { return m_LoadMs; }
+	bool IsProcedural() const { return m_Procedural; }
+
+	// For the GPU memory readout
+	static std::size_t GetBytes();
+
+	static void ClearCache();
+
+private:
+	void CreateTextures();
+	void Bake(const std::string& hdrBytes);
+	bool LoadCache(uint64_t key);
+	void StoreCache(uint64_t key) const;
+
+	unsigned int m_PrefilteredMap = 0;
+	unsigned int m_BrdfLut = 0;
+	glm::vec3 m_IrradianceSH[SH_COEFFICIENTS] = {};
+
+	bool m_FromCache = false;
+	bool m_Procedural = true;
+	float m_LoadMs = 0.0f;
+};
@@ -0,0 +1,114 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+namespace
+{
+	struct ArenaState
+	{
+		std::unique_ptr<unsigned char[]> block;
+		std::size_t capacity = 0;
+		std::size_t head = 0;
+
+		// This frame's, freed at EndFrame
+		std::vector<std::unique_ptr<unsigned char[]>> overflow;
+		std::size_t overflowBytes = 0;
+
+		FrameArena::Stats stats;
+	};
+
+	ArenaState s_Arena;
+
+	class FrameArenaResource : public std::pmr::memory_resource
+	{
+	private:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			return FrameArena::Allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* /*p*/, std::size_t /*bytes*/, std::size_t /*alignment*/) override
+		{
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+
+	FrameArenaResource s_Resource;
+
+	std::size_t AlignUp(std::size_t value, std::size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+void* FrameArena::Allocate(std::size_t bytes, std::size_t alignment)
+{
+	if (!s_Arena.block)
+	{
+		if (s_Arena.capacity < DEFAULT_CAPACITY)
+			s_Arena.capacity = DEFAULT_CAPACITY;
+		s_Arena.block.reset(new unsigned char[s_Arena.capacity]);
+		s_Arena.head = 0;
+	}
+
+	// Aligned by address, so alignments over the block's own still hold
+	const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(s_Arena.block.get());
+	const std::size_t offset = AlignUp(base + s_Arena.head, alignment) - base;
+	if (offset + bytes <= s_Arena.capacity)
+	{
+		s_Arena.head = offset + bytes;
+		return s_Arena.block.get() + offset;
+	}
+
+	// Room for the worst-case padding too
+	s_Arena.overflow.emplace_back(new unsigned char[bytes + alignment]);
+	s_Arena.overflowBytes += bytes + alignment;
+	const std::uintptr_t chunk = reinterpret_cast<std::uintptr_t>(s_Arena.overflow.back().get());
+	return reinterpret_cast<void*>(AlignUp(chunk, alignment));
+}
+
+std::pmr::memory_resource* FrameArena::GetResource()
+{
+	return &s_Resource;
+}
+
+void FrameArena::EndFrame()
+{
+	Stats& stats = s_Arena.stats;
+	stats.usedBytes = s_Arena.head + s_Arena.overflowBytes;
+	stats.peakBytes = std::max(stats.peakBytes, stats.usedBytes);
+	stats.overflows = static_cast<unsigned int>(s_Arena.overflow.size());
+
+	if (!s_Arena.overflow.empty())
+	{
+		// Big enough for this frame next time, in powers of two
+		std::size_t capacity = s_Arena.capacity;
+		while (capacity < stats.usedBytes)
+			capacity *= 2;
+		s_Arena.capacity = capacity;
+		s_Arena.block.reset(new unsigned char[capacity]);
+		s_Arena.overflow.clear();
+		s_Arena.overflowBytes = 0;
+	}
+	stats.capacity = s_Arena.capacity;
+	s_Arena.head = 0;
+}
+
+const FrameArena::Stats& FrameArena::GetStats()
+{
+	return s_Arena.stats;
+}
+
+void FrameArena::Shutdown()
+{
+	s_Arena.block.reset();
+	s_Arena.overflow.clear();
+	s_Arena.overflowBytes = 0;
+	s_Arena.head = 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * FrameArena — scratch memory that lasts until the end of the frame
+ *
+ * Per-frame temporaries (a list of passes to keep, the timestamps read
+ * back this frame) used to be std::vectors that went to the heap every
+ * frame and back again. Taken from the arena instead, an allocation is a
+ * pointer bump, and nothing is freed one by one: EndFrame takes the whole
+ * block back at once.
+ *
+ *     FrameArena::Vector<unsigned int> order(FrameArena::GetResource());
+ *     float* weights = FrameArena::AllocateArray<float>(count);
+ *
+ * GetResource is a std::pmr::memory_resource over the arena, so any pmr
+ * container can use it; deallocating through it does nothing.
+ *
+ * OVERFLOW
+ *   A frame that needs more than the block holds is given overflow chunks
+ *   from the heap, and at EndFrame the block grows to what the frame
+ *   used, so the heap is only touched until the arena has seen the
+ *   busiest frame. GetStats reports both.
+ *
+ * Nothing from the arena may be kept past EndFrame, which the main loop
+ * calls after the swap. Main thread only.
+ */
+class FrameArena
+{
+public:
+	static const std::size_t DEFAULT_CAPACITY = 256 * 1024;
+
+	template <typename T>
+	using Vector = std::pmr::vector<T>;
+
+	struct Stats
+	{
+		std::size_t capacity = 0;       // of the block
+		std::size_t usedBytes = 0;      // last frame, overflow included
+		std::size_t peakBytes = 0;
+		unsigned int overflows = 0;     // chunks the last frame needed from the heap
+	};
+
+	static void* Allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+
+	template <typename T>
+	static T* AllocateArray(std::size_t count)
+	{
+		return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	static std::pmr::memory_resource* GetResource();
+
+	// Takes back everything allocated this frame
+	static void EndFrame();
+	// The last finished frame
+	static const Stats& GetStats();
+
+	// Frees the block; the next Allocate starts a new one
+	static void Shutdown();
+};
@@ -0,0 +1,323 @@
+#include "FrameCapture.h"
+#include "Framebuffer.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	typedef std::vector<uint8_t> Pixels;
+
+	// PNG's CRC-32 (ISO 3309), table-driven
+	struct CrcTable
+	{
+		uint32_t entries[256];
+
+		CrcTable()
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				entries[n] = c;
+			}
+		}
+	};
+
+	uint32_t Crc(uint32_t crc, const uint8_t* data, std::size_t size)
+	{
+		static const CrcTable table;   // built once, thread-safely, by the first encoder
+		for (std::size_t i = 0; i < size; i++)
+			crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc;
+	}
+
+	void PutBigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		out.push_back(static_cast<uint8_t>(value >> 24));
+		out.push_back(static_cast<uint8_t>(value >> 16));
+		out.push_back(static_cast<uint8_t>(value >> 8));
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	void PutChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+	{
+		PutBigEndian(out, static_cast<uint32_t>(data.size()));
+		const std::size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		PutBigEndian(out, Crc(0xFFFFFFFFu, out.data() + start, out.size() - start) ^ 0xFFFFFFFFu);
+	}
+
+	// The rows top first (GL's are bottom first), each prefixed with filter
+	// type 0, as one zlib stream of stored deflate blocks (65535 bytes at most)
+	std::vector<uint8_t> PngFile(int width, int height, const Pixels& pixels)
+	{
+		const std::size_t rowBytes = static_cast<std::size_t>(width) * 4;
+		std::vector<uint8_t> filtered;
+		filtered.reserve((rowBytes + 1) * height);
+		for (int y = height - 1; y >= 0; y--)
+		{
+			filtered.push_back(0);
+			filtered.insert(filtered.end(), pixels.begin() + y * rowBytes, pixels.begin() + (y + 1) * rowBytes);
+		}
+
+		std::vector<uint8_t> zlib;
+		zlib.reserve(filtered.size() + filtered.size() / 65535 * 5 + 16);
+		zlib.push_back(0x78);      // deflate, 32K window
+		zlib.push_back(0x01);      // no preset dictionary, fastest; (0x7801 % 31 == 0)
+		uint32_t a = 1, b = 0;     // Adler-32
+		std::size_t offset = 0;
+		do
+		{
+			const std::size_t size = std::min<std::size_t>(filtered.size() - offset, 65535);
+			const bool last = offset + size == filtered.size();
+			zlib.push_back(last ? 1 : 0);
+			zlib.push_back(static_cast<uint8_t>(size));
+			zlib.push_back(static_cast<uint8_t>(size >> 8));
+			zlib.push_back(static_cast<uint8_t>(~size));
+			zlib.push_back(static_cast<uint8_t>(~size >> 8));
+			// 5552 bytes is the most that can be summed before b overflows
+			for (std::size_t run = offset; run < offset + size; run += 5552)
+			{
+				const std::size_t end = std::min(run + 5552, offset + size);
+				for (std::size_t i = run; i < end; i++)
+				{
+					a += filtered[i];
+					b += a;
+				}
+				a %= 65521;
+				b %= 65521;
+			}
+			zlib.insert(zlib.end(), filtered.begin() + offset, filtered.begin() + offset + size);
+			offset += size;
+		} while (offset < filtered.size());
+		PutBigEndian(zlib, (b << 16) | a);
+
+		std::vector<uint8_t> header;
+		PutBigEndian(header, static_cast<uint32_t>(width));
+		PutBigEndian(header, static_cast<uint32_t>(height));
+		header.push_back(8);       // bits per channel
+		header.push_back(6);       // RGBA
+		header.push_back(0);       // deflate
+		header.push_back(0);       // adaptive filtering (every row uses none)
+		header.push_back(0);       // not interlaced
+
+		static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		std::vector<uint8_t> file(signature, signature + sizeof(signature));
+		PutChunk(file, "IHDR", header);
+		PutChunk(file, "IDAT", zlib);
+		PutChunk(file, "IEND", std::vector<uint8_t>());
+		return file;
+	}
+
+	// On a worker
+	bool Encode(const std::string& path, FrameCapture::Format format, int width, int height, const Pixels& pixels,
+		std::size_t& written)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		if (format == FrameCapture::Format::Png)
+		{
+			const std::vector<uint8_t> png = PngFile(width, height, pixels);
+			file.write(reinterpret_cast<const char*>(png.data()), png.size());
+			written = png.size();
+		}
+		else
+		{
+			// Top row first, as PNG has it
+			const std::size_t rowBytes = static_cast<std::size_t>(width) * 4;
+			for (int y = height - 1; y >= 0; y--)
+				file.write(reinterpret_cast<const char*>(pixels.data() + y * rowBytes), rowBytes);
+			written = pixels.size();
+		}
+		return static_cast<bool>(file);
+	}
+}
+
+FrameCapture::FrameCapture()
+	: m_Oldest(0), m_Pending(0)
+{
+	// Sized on first use, to the capture
+	for (Slot& slot : m_Slots)
+	{
+		GlCall(glGenBuffers(1, &slot.buffer));
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	Flush();
+	for (Slot& slot : m_Slots)
+	{
+		GlCall(glDeleteBuffers(1, &slot.buffer));
+		GLState::OnBufferDeleted(slot.buffer);
+	}
+}
+
+bool FrameCapture::CaptureBackbuffer(int width, int height, const std::string& path, Format format)
+{
+	return Read(0, GL_BACK, width, height, path, format);
+}
+
+bool FrameCapture::Capture(const Framebuffer& framebuffer, unsigned int attachment, const std::string& path,
+	Format format)
+{
+	const bool objectIds = framebuffer.HasObjectIds() && GL_COLOR_ATTACHMENT0 + attachment == Framebuffer::OBJECT_ID_ATTACHMENT;
+	if (framebuffer.GetColorTexture() == 0 || attachment >= framebuffer.GetColorAttachmentCount() || objectIds)
+	{
+		std::cout << "WARNING:: FrameCapture: no colour attachment " << attachment << " to read\n";
+		m_Stats.requested++;
+		m_Stats.dropped++;
+		return false;
+	}
+	return Read(framebuffer.GetID(), GL_COLOR_ATTACHMENT0 + attachment, framebuffer.GetWidth(),
+		framebuffer.GetHeight(), path, format);
+}
+
+bool FrameCapture::Read(GLuint framebuffer, GLenum readBuffer, int width, int height, const std::string& path,
+	Format format)
+{
+	m_Stats.requested++;
+	if (width <= 0 || height <= 0 || m_Pending == RING_SIZE || m_Encoding.load() + m_Pending >= MAX_ENCODING)
+	{
+		m_Stats.dropped++;
+		return false;
+	}
+
+	Slot& slot = m_Slots[(m_Oldest + m_Pending) % RING_SIZE];
+	const std::size_t bytes = static_cast<std::size_t>(width) * height * 4;
+	GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+	if (bytes > slot.capacity)
+	{
+		// STREAM_READ: written by the GPU once, read by the CPU once
+		GlCall(glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ));
+		GpuMemory::TrackBuffer(GpuMemory::Category::Staging, slot.buffer, bytes);
+		slot.capacity = bytes;
+	}
+
+	// Bound directly and put back, as in GPUPicker, so GLState's cached
+	// GL_FRAMEBUFFER binding stays valid. Rows are packed (4-byte pixels
+	// need no padding at the default alignment).
+	GlCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer));
+	GlCall(glReadBuffer(readBuffer));
+	GlCall(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+	GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	GlCall(glReadBuffer(framebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK));
+	GlCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+
+	slot.width = width;
+	slot.height = height;
+	slot.path = path;
+	slot.format = format;
+	m_Pending++;
+	return true;
+}
+
+void FrameCapture::Poll()
+{
+	const auto start = std::chrono::steady_clock::now();
+	bool resolved = false;
+	while (m_Pending > 0)
+	{
+		// Zero timeout, no flush bit: the frame's SwapBuffers flushed the fence
+		Slot& slot = m_Slots[m_Oldest];
+		const GLenum state = glClientWaitSync(slot.fence, 0, 0);
+		if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+			break;   // reads finish in order
+		Resolve(slot);
+		resolved = true;
+	}
+	if (resolved)
+		m_Stats.readbackMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrameCapture::Flush()
+{
+	while (m_Pending > 0)
+	{
+		Slot& slot = m_Slots[m_Oldest];
+		while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED)   // 100 ms
+			;
+		Resolve(slot);
+	}
+	m_Encoders.Wait();
+}
+
+void FrameCapture::Resolve(Slot& slot)
+{
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+
+	const std::size_t bytes = static_cast<std::size_t>(slot.width) * slot.height * 4;
+	std::shared_ptr<Pixels> pixels = std::make_shared<Pixels>(bytes);
+	GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+	const void* data;
+	GlCall(data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT));
+	if (data)
+	{
+		memcpy(pixels->data(), data, bytes);
+		GlCall(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+	}
+	GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+	m_Oldest = (m_Oldest + 1) % RING_SIZE;
+	m_Pending--;
+	if (!data)
+	{
+		m_Failed++;
+		return;
+	}
+
+	m_Encoding++;
+	const std::string path = slot.path;
+	const Format format = slot.format;
+	const int width = slot.width, height = slot.height;
+	m_Encoders.Run([this, pixels, path, format, width, height]()
+		{
+			std::size_t written = 0;
+			if (Encode(path, format, width, height, *pixels, written))
+			{
+				m_Written++;
+				m_BytesWritten += written;
+			}
+			else
+			{
+				std::cout << "WARNING:: FrameCapture: can't write " << path << "\n";
+				m_Failed++;
+			}
+			m_Encoding--;
+		});
+}
+
+FrameCapture::Stats FrameCapture::GetStats() const
+{
+	Stats stats = m_Stats;
+	stats.written = m_Written.load();
+	stats.failed = m_Failed.load();
+	stats.bytesWritten = m_BytesWritten.load();
+	return stats;
+}
+
+std::string FrameCapture::SanitizeName(const std::string& name)
+{
+	std::string sanitized = name;
+	for (char& c : sanitized)
+	{
+		const bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+		if (!keep)
+			c = '_';
+	}
+	return sanitized;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <GL/glew.h>
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+class Framebuffer;
+
+/**
+ * FrameCapture — screenshots and frame dumps without stalling the frame
+ *
+ * glReadPixels into client memory waits for the GPU to finish everything
+ * queued before it, then copies: at 1080p that is the whole frame's GPU
+ * time plus 8 MB over the bus, on the frame being measured. Like
+ * GPUPicker, this reads into a pixel pack buffer instead, so the call
+ * only queues the copy, and a fence says when it has landed:
+ *
+ *     frame N     Capture: glReadPixels -> PBO[0], fence[0]
+ *     frame N+1   Poll: fence[0] not yet
+ *     frame N+2   Poll: fence[0] signalled -> map, copy out, unmap
+ *                 -> ThreadPool: flip, encode, write the file
+ *
+ * The main thread only maps the buffer and copies the pixels out (a
+ * memcpy, timed as Stats::readbackMs); flipping the rows to top-down and
+ * encoding happen on a ThreadPool worker, as does the file write.
+ * RING_SIZE reads can be in flight and MAX_ENCODING frames waiting for a
+ * worker; a Capture beyond either is dropped and counted, so a slow disk
+ * costs frames in the dump, never frame time.
+ *
+ * FORMATS
+ *   Png   8-bit RGBA, for golden images. The deflate stream is stored, not
+ *         compressed: the files are large, but writing one costs two
+ *         checksums and a copy, and any PNG reader (and image diff) opens it.
+ *   Raw   the RGBA8 rows, top first, nothing else: for video frames, e.g.
+ *         ffmpeg -f rawvideo -pix_fmt rgba -s 1920x1080 -i ...
+ *         (or concatenate them first, they have no header).
+ *
+ * Capture the back buffer after the scene has drawn and before ImGui
+ * does, or a Framebuffer's colour attachment (not the object IDs, which
+ * are integers). Float attachments are clamped to [0, 1] by the read.
+ * Poll once per frame; Flush waits for everything outstanding, and the
+ * destructor flushes. GL thread only.
+ */
+class FrameCapture
+{
+public:
+	static const unsigned int RING_SIZE = 3;
+	static const unsigned int MAX_ENCODING = 4;
+
+	enum class Format { Png, Raw };
+
+	struct Stats
+	{
+		unsigned int requested = 0;
+		unsigned int written = 0;
+		unsigned int dropped = 0;        // ring or encoder queue full
+		unsigned int failed = 0;         // file couldn't be written
+		std::size_t bytesWritten = 0;
+		float readbackMs = 0.0f;         // main thread, mapping and copying, last Poll
+	};
+
+	FrameCapture();
+	~FrameCapture();
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// The default framebuffer's back buffer, from (0, 0)
+	bool CaptureBackbuffer(int width, int height, const std::string& path, Format format = Format::Png);
+	// Colour attachment `attachment` (0 the main one, as AddColorAttachment counts)
+	bool Capture(const Framebuffer& framebuffer, unsigned int attachment, const std::string& path,
+		Format format = Format::Png);
+
+	// Hand every read whose fence has signalled to an encoder, oldest first.
+	// Never waits.
+	void Poll();
+	// Wait for every read and every file, e.g. before the process exits
+	void Flush();
+
+	Stats GetStats() const;
+	unsigned int GetPendingCount() const { return m_Pending; }
+
+	// A name usable in a file name: anything but letters, digits, '-' and '_' becomes '_'
+	static std::string SanitizeName(const std::string& name);
+
+private:
+	struct Slot
+	{
+		unsigned int buffer = 0;
+		std::size_t capacity = 0;
+		GLsync fence = nullptr;
+		int width = 0;
+		int height = 0;
+		std::string path;
+		Format format = Format::Png;
+	};
+
+	bool Read(GLuint framebuffer, GLenum readBuffer, int width, int height, const std::string& path, Format format);
+	void Resolve(Slot& slot);
+
+	Slot m_Slots[RING_SIZE];
+	unsigned int m_Oldest;     // next slot to resolve
+	unsigned int m_Pending;    // slots in flight, from m_Oldest on
+
+	// Counted by the encoders too
+	std::atomic<unsigned int> m_Encoding{ 0 };
+	std::atomic<unsigned int> m_Written{ 0 };
+	std::atomic<unsigned int> m_Failed{ 0 };
+	std::atomic<std::size_t> m_BytesWritten{ 0 };
+	Stats m_Stats;
+	TaskGroup m_Encoders;
+};
@@ -0,0 +1,204 @@
+#include "FramePacer.h"
+#include "Renderer.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	// One frame's fence and completion timestamp, by frame index
+	struct Slot
+	{
+		GLsync fence = nullptr;      // null once retired
+		unsigned int query = 0;
+		uint64_t frame = 0;
+		int64_t inputNs = 0;         // CPU clock: the input poll before the frame
+		int64_t submitNs = 0;        // CPU clock: EndFrame
+	};
+
+	struct PacerState
+	{
+		Slot slots[FramePacer::MAX_FRAMES_IN_FLIGHT];
+		bool created = false;
+		uint64_t frame = 0;
+		uint64_t completed = 0;
+		unsigned int framesInFlight = 2;
+		bool vsync = true;
+		float refreshMs = 1000.0f / 60.0f;
+		int64_t frameInputNs = 0;
+		int64_t clockOffsetNs = 0;   // CPU minus GPU timestamp, measured at BeginFrame
+		bool hasAverage = false;
+		FramePacer::Stats stats;
+	};
+
+	PacerState s_Pacer;
+
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// The unretired slot with the oldest frame, or null
+	Slot* Oldest()
+	{
+		Slot* oldest = nullptr;
+		for (Slot& slot : s_Pacer.slots)
+		{
+			if (slot.fence && (!oldest || slot.frame < oldest->frame))
+				oldest = &slot;
+		}
+		return oldest;
+	}
+
+	// The fence has signalled, so the timestamp is available without waiting
+	void Retire(Slot& slot)
+	{
+		GLint64 gpuDone = 0;
+		GlCall(glGetQueryObjecti64v(slot.query, GL_QUERY_RESULT, &gpuDone));
+		const int64_t doneNs = gpuDone + s_Pacer.clockOffsetNs;
+
+		FramePacer::Stats& stats = s_Pacer.stats;
+		stats.gpuLatencyMs = std::max(0.0f, (doneNs - slot.submitNs) / 1.0e6f);
+		const float scanOut = s_Pacer.vsync ? 0.5f * s_Pacer.refreshMs : 0.0f;
+		stats.inputToPhotonMs = std::max(0.0f, (doneNs - slot.inputNs) / 1.0e6f) + scanOut;
+		stats.averageInputToPhotonMs = s_Pacer.hasAverage
+			? stats.averageInputToPhotonMs + (stats.inputToPhotonMs - stats.averageInputToPhotonMs) * 0.05f
+			: stats.inputToPhotonMs;
+		s_Pacer.hasAverage = true;
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+		s_Pacer.completed = std::max(s_Pacer.completed, slot.frame);
+	}
+}
+
+void FramePacer::BeginFrame()
+{
+	s_Pacer.frame++;
+
+	// The input poll was just before this; tie the GPU clock to the CPU's
+	// here too (a query of the current time, not a wait)
+	s_Pacer.frameInputNs = NowNs();
+	GLint64 gpuNow = 0;
+	GlCall(glGetInteger64v(GL_TIMESTAMP, &gpuNow));
+	s_Pacer.clockOffsetNs = s_Pacer.frameInputNs - gpuNow;
+}
+
+void FramePacer::EndFrame()
+{
+	if (!s_Pacer.created)
+	{
+		for (Slot& slot : s_Pacer.slots)
+		{
+			GlCall(glGenQueries(1, &slot.query));
+		}
+		s_Pacer.created = true;
+	}
+
+	// Free: the previous EndFrame waited for the frame that used it
+	Slot& slot = s_Pacer.slots[GetFrameIndex()];
+	GlCall(glQueryCounter(slot.query, GL_TIMESTAMP));
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frame = s_Pacer.frame;
+	slot.inputNs = s_Pacer.frameInputNs;
+	slot.submitNs = NowNs();
+
+	// Collect what has finished already; fences signal in order
+	while (Slot* oldest = Oldest())
+	{
+		const GLenum status = glClientWaitSync(oldest->fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		Retire(*oldest);
+	}
+
+	// Then wait until the next frame would not exceed the limit. The flush
+	// bit makes sure the fence is submitted, or the wait could never end.
+	unsigned int inFlight = 0;
+	for (const Slot& pending : s_Pacer.slots)
+		inFlight += pending.fence ? 1 : 0;
+
+	const int64_t waitStart = NowNs();
+	bool waited = false;
+	while (inFlight >= s_Pacer.framesInFlight)
+	{
+		Slot* oldest = Oldest();
+		GLenum status;
+		do
+			status = glClientWaitSync(oldest->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);   // 100 ms
+		while (status == GL_TIMEOUT_EXPIRED);
+		Retire(*oldest);
+		inFlight--;
+		waited = true;
+	}
+
+	s_Pacer.stats.waitMs = waited ? (NowNs() - waitStart) / 1.0e6f : 0.0f;
+	s_Pacer.stats.stalls += waited ? 1 : 0;
+	s_Pacer.stats.inFlight = inFlight;
+}
+
+uint64_t FramePacer::GetFrameNumber()
+{
+	return s_Pacer.frame;
+}
+
+unsigned int FramePacer::GetFrameIndex()
+{
+	return static_cast<unsigned int>(s_Pacer.frame % MAX_FRAMES_IN_FLIGHT);
+}
+
+uint64_t FramePacer::GetCompletedFrame()
+{
+	return s_Pacer.completed;
+}
+
+void FramePacer::SetFramesInFlight(unsigned int frames)
+{
+	s_Pacer.framesInFlight = std::clamp(frames, 1u, static_cast<unsigned int>(MAX_FRAMES_IN_FLIGHT));
+}
+
+unsigned int FramePacer::GetFramesInFlight()
+{
+	return s_Pacer.framesInFlight;
+}
+
+void FramePacer::SetVSync(bool enabled)
+{
+	glfwSwapInterval(enabled ? 1 : 0);
+	s_Pacer.vsync = enabled;
+
+	// Of the primary monitor: the window normally sits there
+	if (GLFWmonitor* monitor = glfwGetPrimaryMonitor())
+	{
+		const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+		if (mode && mode->refreshRate > 0)
+			s_Pacer.refreshMs = 1000.0f / mode->refreshRate;
+	}
+}
+
+bool FramePacer::GetVSync()
+{
+	return s_Pacer.vsync;
+}
+
+const FramePacer::Stats& FramePacer::GetStats()
+{
+	return s_Pacer.stats;
+}
+
+void FramePacer::Shutdown()
+{
+	for (Slot& slot : s_Pacer.slots)
+	{
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		if (slot.query)
+		{
+			GlCall(glDeleteQueries(1, &slot.query));
+		}
+	}
+	s_Pacer = PacerState();
+}
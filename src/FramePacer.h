@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * FramePacer — a bounded number of frames in flight
+ *
+ * glfwSwapBuffers returns as soon as the driver has queued the frame. With
+ * V-Sync on, the driver's swap queue eventually blocks and paces the loop;
+ * with it off, nothing stops the CPU from recording frames well ahead of
+ * the GPU. That adds latency (input read for a frame is shown several
+ * frames later), and per-frame resources in rings (StreamingBuffer
+ * regions, the Profiler's query ring, GPUPicker's readbacks) can only
+ * assume their previous users are finished by waiting on fences of their own.
+ *
+ * EndFrame, right after the swap, puts a fence and a GL_TIMESTAMP query
+ * behind the frame, then waits until at most GetFramesInFlight() - 1
+ * earlier frames are unfinished on the GPU:
+ *
+ *     frames in flight 1   the CPU waits for each frame before the next:
+ *                          lowest latency, no CPU/GPU overlap
+ *                      2   the CPU records frame N+1 while the GPU draws N
+ *                      3   one more frame of slack (and latency)
+ *
+ * The wait comes before glfwPollEvents, so the input a frame reads is
+ * sampled after the wait, not before it.
+ *
+ * FRAME INDEX
+ *   GetFrameIndex() is the frame number modulo MAX_FRAMES_IN_FLIGHT. When
+ *   BeginFrame returns, the frame that last used the same index has
+ *   finished on the GPU, so anything kept per index (a buffer region, a
+ *   query) may be rewritten without a fence of its own. GetCompletedFrame
+ *   is the newest frame known to be finished, e.g. for a query issued in
+ *   frame n: its result is ready once GetCompletedFrame() >= n.
+ *
+ * LATENCY
+ *   The timestamp query says when the GPU finished the frame, and
+ *   glGetInteger64v(GL_TIMESTAMP) at BeginFrame ties the GPU clock to the
+ *   CPU's (as the Profiler's traces do). Input-to-photon is estimated from
+ *   the input poll before a frame to that completion time, plus half a
+ *   refresh interval with V-Sync (the average wait for scan-out). It does
+ *   not include the display's own processing.
+ *
+ * Main loop: BeginFrame at the top (after the input poll), EndFrame after
+ * glfwSwapBuffers. GL thread only. Shutdown before the context goes.
+ */
+class FramePacer
+{
+public:
+	static const unsigned int MAX_FRAMES_IN_FLIGHT = 3;
+
+	struct Stats
+	{
+		unsigned int inFlight = 0;          // frames submitted but not finished, as EndFrame left them
+		float waitMs = 0.0f;                // EndFrame's wait for the GPU, last frame
+		unsigned int stalls = 0;            // frames whose EndFrame had to wait, ever
+		float gpuLatencyMs = 0.0f;          // end of submission to GPU completion, newest finished frame
+		float inputToPhotonMs = 0.0f;       // estimate for the newest finished frame
+		float averageInputToPhotonMs = 0.0f;
+	};
+
+	static void BeginFrame();
+	static void EndFrame();
+
+	// Frames begun so far; the current one while a frame is open
+	static uint64_t GetFrameNumber();
+	// GetFrameNumber() % MAX_FRAMES_IN_FLIGHT, see FRAME INDEX
+	static unsigned int GetFrameIndex();
+	// Newest frame number the GPU has finished (0 before the first)
+	static uint64_t GetCompletedFrame();
+
+	// 1 .. MAX_FRAMES_IN_FLIGHT; applies from the next EndFrame
+	static void SetFramesInFlight(unsigned int frames);
+	static unsigned int GetFramesInFlight();
+
+	// Sets the swap interval (glfwSwapInterval on the current context) and
+	// tells the latency estimate whether frames wait for scan-out
+	static void SetVSync(bool enabled);
+	static bool GetVSync();
+
+	static const Stats& GetStats();
+
+	// Deletes the fences and queries
+	static void Shutdown();
+};
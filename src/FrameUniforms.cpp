@@ -0,0 +1,56 @@
+#include "FrameUniforms.h"
+#include "UniformBuffer.h"
+#include "Renderer.h"
+
+#include <memory>
+
+const char* const FrameUniforms::BLOCK_NAME = "FrameData";
+
+static FrameData s_FrameData;
+
+// Created on first upload, which is always after the GL context exists.
+static std::unique_ptr<UniformBuffer> s_Buffer;
+
+void FrameUniforms::SetCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position)
+{
+	s_FrameData.view = view;
+	s_FrameData.projection = projection;
+	s_FrameData.viewProjection = projection * view;
+	s_FrameData.viewPosition = glm::vec4(position, 1.0f);
+	Upload();
+}
+
+void FrameUniforms::SetTime(float seconds, float deltaTime)
+{
+	s_FrameData.time = glm::vec4(seconds, deltaTime, 0.0f, 0.0f);
+	Upload();
+}
+
+const FrameData& FrameUniforms::Get()
+{
+	return s_FrameData;
+}
+
+void FrameUniforms::Upload()
+{
+	if (!s_Buffer)
+		s_Buffer = std::make_unique<UniformBuffer>(static_cast<unsigned int>(sizeof(FrameData)), FRAME_DATA_BINDING);
+
+	// The whole block is 224 bytes: one small upload per change, and the
+	// binding point never changes, so nothing needs re-binding per draw.
+	s_Buffer->SetData(&s_FrameData, sizeof(FrameData));
+}
+
+void FrameUniforms::BindProgram(unsigned int program)
+{
+	GlCall(unsigned int index = glGetUniformBlockIndex(program, BLOCK_NAME));
+	if (index != GL_INVALID_INDEX)
+	{
+		GlCall(glUniformBlockBinding(program, index, FRAME_DATA_BINDING));
+	}
+}
+
+void FrameUniforms::Shutdown()
+{
+	s_Buffer.reset();
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "glm/glm.hpp"
+
+/**
+ * FrameUniforms — the per-frame camera block every shader reads
+ *
+ * Shaders in res/Shaders that need the camera declare:
+ *
+ *     layout(std140) uniform FrameData
+ *     {
+ *         mat4 u_View;
+ *         mat4 u_Projection;
+ *         mat4 u_ViewProjection;
+ *         vec4 u_ViewPosition;    // xyz = camera position in world space
+ *         vec4 u_Time;            // x = seconds since start, y = frame delta
+ *     };
+ *
+ * instead of separate u_View/u_Projection/camera position uniforms, by
+ * including res/Shaders/Include/FrameData.glsl (see ShaderLibrary.h). The
+ * Shader loader links any block named FrameData to FRAME_DATA_BINDING when
+ * the program is created, so the shader needs no binding qualifier (which
+ * GLSL 330 doesn't have) and C++ never has to look the block up.
+ *
+ * A test calls SetCamera once per frame (or once per pass, if a pass uses a
+ * different camera) and every shader sees the new values — no per-shader
+ * setUniformMat4f calls. SetTime is called by the main loop.
+ *
+ * Uniform block bindings are a separate namespace from SSBO bindings, so
+ * FRAME_DATA_BINDING = 0 does not clash with DrawIndirectBuffer's SSBO 0.
+ */
+
+// Mirrors the std140 block above. Only vec4/mat4 members, so the C++
+// layout already matches std140 without padding.
+struct FrameData
+{
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	glm::vec4 viewPosition = glm::vec4(0.0f);
+	glm::vec4 time = glm::vec4(0.0f);
+};
+
+class FrameUniforms
+{
+public:
+	static const unsigned int FRAME_DATA_BINDING = 0;
+	static const char* const BLOCK_NAME;
+
+	// Upload the camera; viewProjection is derived here.
+	static void SetCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position);
+	static void SetTime(float seconds, float deltaTime);
+
+	static const FrameData& Get();
+
+	// Link the program's FrameData block (if it has one) to the binding.
+	static void BindProgram(unsigned int program);
+
+	// Frees the uniform buffer. Call before the GL context is destroyed.
+	static void Shutdown();
+
+private:
+	static void Upload();
+};
@@ -1,23 +1,24 @@
 #include "Framebuffer.h"
+#include "GLState.h"
 #include <iostream>
 
 Framebuffer::Framebuffer(int width, int height, bool depthOnly)
 	: m_Width(width), m_Height(height), m_DepthOnly(depthOnly)
 {
 	glGenFramebuffers(1, &m_RendererID);
-	glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID);
+	GLState::BindFramebuffer(m_RendererID);
 
-	// Create depth texture
-	glGenTextures(1, &m_DepthTexture);
-	glBindTexture(GL_TEXTURE_2D, m_DepthTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, m_Width, m_Height, 0,
-		GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	// Create depth texture. Every parameter is set, even GL's defaults: a
+	// pooled texture keeps whatever its last user left.
+	m_DepthTexture = CreateAttachment(GL_DEPTH_COMPONENT24, m_DepthHandle);
+	GLState::BindTexture(GL_TEXTURE_2D, m_DepthTexture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 	float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
 	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
 
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_DepthTexture, 0);
 
@@ -29,12 +30,12 @@ Framebuffer::Framebuffer(int width, int height, bool depthOnly)
 	else
 	{
 		// Create color texture
-		glGenTextures(1, &m_ColorTexture);
-		glBindTexture(GL_TEXTURE_2D, m_ColorTexture);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0,
-			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		m_ColorTexture = CreateAttachment(GL_RGBA8, m_ColorHandle);
+		GLState::BindTexture(GL_TEXTURE_2D, m_ColorTexture);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ColorTexture, 0);
 	}
 
@@ -43,30 +44,139 @@ Framebuffer::Framebuffer(int width, int height, bool depthOnly)
 		std::cerr << "Framebuffer is not complete!" << std::endl;
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::BindFramebuffer(0);
 }
 
 Framebuffer::~Framebuffer()
 {
-	if (m_ColorTexture) glDeleteTextures(1, &m_ColorTexture);
-	if (m_DepthTexture) glDeleteTextures(1, &m_DepthTexture);
-	if (m_RendererID) glDeleteFramebuffers(1, &m_RendererID);
+	if (m_ColorTexture) ReleaseAttachment(m_ColorHandle, m_ColorTexture);
+	if (m_ObjectIdTexture) ReleaseAttachment(m_ObjectIdHandle, m_ObjectIdTexture);
+	for (const Attachment& attachment : m_Extra)
+		ReleaseAttachment(attachment.handle, attachment.texture);
+	if (m_DepthTexture) ReleaseAttachment(m_DepthHandle, m_DepthTexture);
+	if (m_RendererID) GpuResources::Delete(GL_FRAMEBUFFER, m_RendererID);
+}
+
+unsigned int Framebuffer::CreateAttachment(GLenum format, TextureHandle& handle)
+{
+	GpuResources::TextureDesc desc;
+	desc.width = m_Width;
+	desc.height = m_Height;
+	desc.format = format;
+	handle = GpuResources::Get().CreateTexture(desc, GpuMemory::Category::RenderTarget);
+	return GpuResources::Get().GetTexture(handle);
+}
+
+void Framebuffer::ReleaseAttachment(TextureHandle handle, unsigned int texture)
+{
+	if (GpuResources::IsAlive())
+		GpuResources::Get().Release(handle);
+	else
+		GpuResources::Delete(GL_TEXTURE, texture);
 }
 
 void Framebuffer::Bind() const
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID);
-	glViewport(0, 0, m_Width, m_Height);
+	GLState::BindFramebuffer(m_RendererID);
+	GLState::Viewport(0, 0, m_Width, m_Height);
 }
 
 void Framebuffer::Unbind() const
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::BindFramebuffer(0);
+}
+
+void Framebuffer::EnableObjectIds()
+{
+	if (m_DepthOnly || m_ObjectIdTexture)
+		return;
+	if (!m_Extra.empty())
+	{
+		std::cerr << "Framebuffer::EnableObjectIds must come before AddColorAttachment" << std::endl;
+		return;
+	}
+
+	GLState::BindFramebuffer(m_RendererID);
+
+	// Integer textures cannot be filtered; sampling one needs NEAREST
+	m_ObjectIdTexture = CreateAttachment(GL_R32UI, m_ObjectIdHandle);
+	GLState::BindTexture(GL_TEXTURE_2D, m_ObjectIdTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, OBJECT_ID_ATTACHMENT, GL_TEXTURE_2D, m_ObjectIdTexture, 0);
+
+	// Fragment outputs 0 and 1 go to the colour and ID textures
+	const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, OBJECT_ID_ATTACHMENT };
+	glDrawBuffers(2, drawBuffers);
+
+	if (!CheckStatus())
+	{
+		std::cerr << "Framebuffer with object IDs is not complete!" << std::endl;
+	}
+
+	GLState::BindFramebuffer(0);
+}
+
+unsigned int Framebuffer::AddColorAttachment(GLenum format)
+{
+	if (m_DepthOnly)
+		return 0;
+
+	GLState::BindFramebuffer(m_RendererID);
+
+	const GLenum attachmentPoint = GL_COLOR_ATTACHMENT0 + GetColorAttachmentCount();
+	Attachment attachment;
+	attachment.texture = CreateAttachment(format, attachment.handle);
+	GLState::BindTexture(GL_TEXTURE_2D, attachment.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, attachmentPoint, GL_TEXTURE_2D, attachment.texture, 0);
+	m_Extra.push_back(attachment);
+
+	SetDrawBuffers();
+	if (!CheckStatus())
+	{
+		std::cerr << "Framebuffer with " << GetColorAttachmentCount() << " colour attachments is not complete!" << std::endl;
+	}
+
+	GLState::BindFramebuffer(0);
+	return attachment.texture;
+}
+
+void Framebuffer::SetDrawBuffers() const
+{
+	std::vector<GLenum> drawBuffers;
+	for (unsigned int i = 0; i < GetColorAttachmentCount(); i++)
+		drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+	glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+}
+
+void Framebuffer::ClearObjectIds() const
+{
+	if (!m_ObjectIdTexture)
+		return;
+
+	// Draw buffer 1 is OBJECT_ID_ATTACHMENT (see EnableObjectIds)
+	const GLuint none[4] = { 0, 0, 0, 0 };
+	GLState::BindFramebuffer(m_RendererID);
+	glClearBufferuiv(GL_COLOR, 1, none);
+}
+
+void Framebuffer::BlitToScreen(int width, int height) const
+{
+	// GLState tracks GL_FRAMEBUFFER (both targets); bind the read target
+	// directly and put it back so the cached binding stays 0.
+	GLState::BindFramebuffer(0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_RendererID);
+	glBlitFramebuffer(0, 0, m_Width, m_Height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
 }
 
 bool Framebuffer::CheckStatus() const
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID);
+	GLState::BindFramebuffer(m_RendererID);
 	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 	if (status != GL_FRAMEBUFFER_COMPLETE)
 	{
@@ -1,6 +1,13 @@
 #pragma once
 #include <GL/glew.h>
+#include "GpuResources.h"
 
+#include <vector>
+
+// The attachments are immutable textures from the GpuResources pool, so
+// recreating a Framebuffer at the same size (a resize back and forth, a
+// shadow map toggled between resolutions, switching tests) reuses the old
+// textures once the GPU is done with them instead of allocating new ones.
 class Framebuffer {
 public:
 	Framebuffer(int width, int height, bool depthOnly = false);
@@ -10,16 +17,56 @@ public:
 
 	void Bind() const;
 	void Unbind() const;
+	// Copy the colour attachment to the default framebuffer, stretched to
+	// width x height. Leaves the default framebuffer bound.
+	void BlitToScreen(int width, int height) const;
 	unsigned int GetDepthTexture() const { return m_DepthTexture; }
 	unsigned int GetColorTexture() const { return m_ColorTexture; }
+
+	// Object IDs: adds a GL_R32UI texture at GL_COLOR_ATTACHMENT1 next to
+	// the colour one. A fragment shader writes its object's ID to
+	// `layout(location = 1) out uint`; 0 is left for "nothing", which
+	// ClearObjectIds writes (glClear would convert the float clear colour).
+	// See GPUPicker for reading it back.
+	static const GLenum OBJECT_ID_ATTACHMENT = GL_COLOR_ATTACHMENT1;
+	void EnableObjectIds();
+	void ClearObjectIds() const;
+	bool HasObjectIds() const { return m_ObjectIdTexture != 0; }
+	unsigned int GetObjectIdTexture() const { return m_ObjectIdTexture; }
+
+	// Multiple render targets: each call adds a `format` texture at the next
+	// colour attachment (after the object IDs, if enabled first) and routes
+	// the next fragment output to it, so a shader writes attachment n with
+	// layout(location = n) out. Returns the texture; NEAREST, clamped.
+	// See DeferredShading for a G-buffer built this way.
+	unsigned int AddColorAttachment(GLenum format);
+	unsigned int GetColorAttachmentCount() const { return 1 + (m_ObjectIdTexture ? 1u : 0u) + static_cast<unsigned int>(m_Extra.size()); }
+
+	unsigned int GetID() const { return m_RendererID; }
 	int GetWidth() const { return m_Width; }
 	int GetHeight() const { return m_Height; }
 	bool CheckStatus() const;
 
 private:
+	// A pooled attachment texture of this framebuffer's size
+	unsigned int CreateAttachment(GLenum format, TextureHandle& handle);
+	static void ReleaseAttachment(TextureHandle handle, unsigned int texture);
+
 	unsigned int m_RendererID = 0;
 	unsigned int m_DepthTexture = 0;
 	unsigned int m_ColorTexture = 0;
+	unsigned int m_ObjectIdTexture = 0;
+	TextureHandle m_DepthHandle, m_ColorHandle, m_ObjectIdHandle;
+
+	struct Attachment
+	{
+		unsigned int texture;
+		TextureHandle handle;
+	};
+	std::vector<Attachment> m_Extra;   // AddColorAttachment's, in order
+
+	// glDrawBuffers over every colour attachment, in attachment order
+	void SetDrawBuffers() const;
 	int m_Width, m_Height;
 	bool m_DepthOnly;
 };
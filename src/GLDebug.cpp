@@ -0,0 +1,337 @@
+#include "GLDebug.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+bool GLDebug::g_CallbackActive = false;
+
+// ----------------------------------------------------------------------------
+// Ring buffer
+// ----------------------------------------------------------------------------
+// A bounded multi-producer queue (after Dmitry Vyukov's design). Each slot
+// carries a sequence number:
+//
+//   sequence == position        slot is free for the producer claiming `position`
+//   sequence == position + 1    slot holds a message for the consumer
+//
+// Producers claim a position with a CAS on m_Head, fill the slot and then
+// publish it by bumping the sequence. The single consumer (Flush, main
+// thread) reads slots in order and hands them back by advancing the
+// sequence by CAPACITY. When the ring is full the message is dropped and
+// counted — the callback must never block the driver.
+// ----------------------------------------------------------------------------
+
+namespace
+{
+	const unsigned int RING_CAPACITY = 256;        // power of two
+	const unsigned int MAX_MESSAGE_LENGTH = 256;
+	const unsigned int MAX_SITE_LENGTH = 160;
+
+	struct DebugMessage
+	{
+		GLenum source;
+		GLenum type;
+		GLuint id;
+		GLenum severity;
+		int line;
+		char file[MAX_SITE_LENGTH];
+		char function[MAX_SITE_LENGTH];
+		char text[MAX_MESSAGE_LENGTH];
+	};
+
+	struct Slot
+	{
+		std::atomic<uint32_t> sequence;
+		DebugMessage message;
+	};
+
+	Slot s_Ring[RING_CAPACITY];
+	std::atomic<uint32_t> s_Head{ 0 };     // next position a producer claims
+	uint32_t s_Tail = 0;                   // next position the consumer reads
+	std::atomic<unsigned int> s_Dropped{ 0 };
+	std::atomic<unsigned int> s_Received{ 0 };
+
+	bool s_Synchronous = true;
+	bool s_BreakOnError = false;
+	GLDebug::Severity s_MinSeverity = GLDebug::Severity::Low;
+
+	// Dedup table: key -> times seen since it was first printed.
+	std::unordered_map<uint64_t, unsigned int> s_Seen;
+	GLDebug::Stats s_Stats;
+
+	void InitRing()
+	{
+		for (uint32_t i = 0; i < RING_CAPACITY; i++)
+			s_Ring[i].sequence.store(i, std::memory_order_relaxed);
+		s_Head.store(0, std::memory_order_relaxed);
+		s_Tail = 0;
+	}
+
+	void CopyString(char* dst, const char* src, std::size_t capacity)
+	{
+		if (!src)
+		{
+			dst[0] = '\0';
+			return;
+		}
+		std::size_t length = std::strlen(src);
+		if (length >= capacity)
+			length = capacity - 1;
+		std::memcpy(dst, src, length);
+		dst[length] = '\0';
+	}
+
+	bool Push(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* text)
+	{
+		uint32_t position = s_Head.load(std::memory_order_relaxed);
+		Slot* slot;
+
+		for (;;)
+		{
+			slot = &s_Ring[position & (RING_CAPACITY - 1)];
+			uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+			int32_t diff = static_cast<int32_t>(sequence - position);
+
+			if (diff == 0)
+			{
+				if (s_Head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;   // full
+			}
+			else
+			{
+				position = s_Head.load(std::memory_order_relaxed);
+			}
+		}
+
+		DebugMessage& m = slot->message;
+		m.source = source;
+		m.type = type;
+		m.id = id;
+		m.severity = severity;
+
+		// The call site is only meaningful when the callback runs on the
+		// thread that issued the call (synchronous mode).
+		const GLDebug::CallSite& site = GLDebug::t_CallSite;
+		m.line = site.line;
+		CopyString(m.file, site.file, MAX_SITE_LENGTH);
+		CopyString(m.function, site.function, MAX_SITE_LENGTH);
+
+		std::size_t count = length < 0 ? std::strlen(text) : static_cast<std::size_t>(length);
+		if (count >= MAX_MESSAGE_LENGTH)
+			count = MAX_MESSAGE_LENGTH - 1;
+		std::memcpy(m.text, text, count);
+		m.text[count] = '\0';
+
+		slot->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(DebugMessage& out)
+	{
+		Slot& slot = s_Ring[s_Tail & (RING_CAPACITY - 1)];
+		uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence != s_Tail + 1)
+			return false;   // empty (or the producer hasn't published yet)
+
+		out = slot.message;
+		slot.sequence.store(s_Tail + RING_CAPACITY, std::memory_order_release);
+		s_Tail++;
+		return true;
+	}
+
+	GLDebug::Severity ToSeverity(GLenum severity)
+	{
+		switch (severity)
+		{
+		case GL_DEBUG_SEVERITY_HIGH:   return GLDebug::Severity::High;
+		case GL_DEBUG_SEVERITY_MEDIUM: return GLDebug::Severity::Medium;
+		case GL_DEBUG_SEVERITY_LOW:    return GLDebug::Severity::Low;
+		default:                       return GLDebug::Severity::Notification;
+		}
+	}
+
+	const char* SeverityName(GLenum severity)
+	{
+		switch (severity)
+		{
+		case GL_DEBUG_SEVERITY_HIGH:   return "HIGH";
+		case GL_DEBUG_SEVERITY_MEDIUM: return "MEDIUM";
+		case GL_DEBUG_SEVERITY_LOW:    return "LOW";
+		default:                       return "NOTE";
+		}
+	}
+
+	const char* TypeName(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_DEBUG_TYPE_ERROR:               return "Error";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "Deprecated";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "Undefined behaviour";
+		case GL_DEBUG_TYPE_PORTABILITY:         return "Portability";
+		case GL_DEBUG_TYPE_PERFORMANCE:         return "Performance";
+		case GL_DEBUG_TYPE_MARKER:              return "Marker";
+		default:                                return "Other";
+		}
+	}
+
+	const char* SourceName(GLenum source)
+	{
+		switch (source)
+		{
+		case GL_DEBUG_SOURCE_API:             return "API";
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "Window system";
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return "Shader compiler";
+		case GL_DEBUG_SOURCE_THIRD_PARTY:     return "Third party";
+		case GL_DEBUG_SOURCE_APPLICATION:     return "Application";
+		default:                              return "Other";
+		}
+	}
+
+	void GLAPIENTRY DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+		GLsizei length, const GLchar* message, const void* /*userParam*/)
+	{
+		s_Received.fetch_add(1, std::memory_order_relaxed);
+
+		if (!Push(source, type, id, severity, length, message))
+			s_Dropped.fetch_add(1, std::memory_order_relaxed);
+
+#if defined(_DEBUG)
+		// Break here, inside the offending call, so the debugger's call
+		// stack shows exactly which GL call went wrong.
+		if (s_BreakOnError && s_Synchronous && severity == GL_DEBUG_SEVERITY_HIGH)
+			GL_DEBUG_BREAK();
+#endif
+	}
+
+	void ApplySeverityFilter()
+	{
+		// Let the driver discard everything first, then re-enable the
+		// severities we want, so filtered messages never hit the callback.
+		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+
+		const GLenum severities[] = {
+			GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW,
+			GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH
+		};
+		for (GLenum severity : severities)
+		{
+			if (ToSeverity(severity) >= s_MinSeverity)
+				glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severity, 0, nullptr, GL_TRUE);
+		}
+	}
+}
+
+bool GLDebug::Init(bool synchronous, Severity minSeverity)
+{
+	// Debug output is core in 4.3; older contexts may still expose KHR_debug.
+	if (!GLEW_VERSION_4_3 && !GLEW_KHR_debug)
+	{
+		std::cerr << "GLDebug: debug output unavailable, falling back to glGetError" << std::endl;
+		g_CallbackActive = false;
+		return false;
+	}
+
+	InitRing();
+	s_Seen.clear();
+	s_Stats = Stats();
+	s_MinSeverity = minSeverity;
+
+	glEnable(GL_DEBUG_OUTPUT);
+	SetSynchronous(synchronous);
+	glDebugMessageCallback(DebugCallback, nullptr);
+	ApplySeverityFilter();
+
+	g_CallbackActive = true;
+	return true;
+}
+
+void GLDebug::Shutdown()
+{
+	if (!g_CallbackActive)
+		return;
+
+	Flush();
+	glDebugMessageCallback(nullptr, nullptr);
+	glDisable(GL_DEBUG_OUTPUT);
+	g_CallbackActive = false;
+}
+
+void GLDebug::SetSynchronous(bool synchronous)
+{
+	s_Synchronous = synchronous;
+	if (synchronous)
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	else
+		glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+}
+
+bool GLDebug::IsSynchronous()
+{
+	return s_Synchronous;
+}
+
+void GLDebug::SetMinSeverity(Severity minSeverity)
+{
+	s_MinSeverity = minSeverity;
+	if (g_CallbackActive)
+		ApplySeverityFilter();
+}
+
+GLDebug::Severity GLDebug::GetMinSeverity()
+{
+	return s_MinSeverity;
+}
+
+void GLDebug::SetBreakOnError(bool enabled)
+{
+	s_BreakOnError = enabled;
+}
+
+void GLDebug::Flush()
+{
+	DebugMessage m;
+	while (Pop(m))
+	{
+		// Dedup key: the driver's message id is only unique per source/type,
+		// so fold all four fields together.
+		uint64_t key = (uint64_t(m.id) << 32)
+			^ (uint64_t(m.source & 0xFFFF) << 16)
+			^ uint64_t(m.type & 0xFFFF)
+			^ (uint64_t(m.severity & 0xFFFF) << 48);
+
+		unsigned int& seen = s_Seen[key];
+		if (seen++ > 0)
+		{
+			s_Stats.repeats++;
+			// Print on powers of two so a message spamming every frame still
+			// shows up occasionally with its running total.
+			if ((seen & (seen - 1)) != 0)
+				continue;
+			std::cout << "[OpenGL " << SeverityName(m.severity) << "] (id " << m.id
+				<< ") repeated " << seen << " times" << std::endl;
+			continue;
+		}
+
+		s_Stats.printed++;
+		std::cout << "[OpenGL " << SeverityName(m.severity) << "] " << TypeName(m.type)
+			<< " from " << SourceName(m.source) << " (id " << m.id << "): " << m.text << std::endl;
+		if (m.file[0])
+			std::cout << "    at " << m.function << " File: " << m.file << " Line:" << m.line << std::endl;
+	}
+
+	s_Stats.received = s_Received.load(std::memory_order_relaxed);
+	s_Stats.dropped = s_Dropped.load(std::memory_order_relaxed);
+}
+
+const GLDebug::Stats& GLDebug::GetStats()
+{
+	return s_Stats;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <GL/glew.h>
+
+/**
+ * GLDebug — driver-reported errors via KHR_debug instead of glGetError
+ *
+ * The old GlCall drained glGetError before and after every wrapped call.
+ * glGetError is a round trip into the driver, and on some implementations
+ * it forces the command stream to synchronise, so a debug build paid that
+ * on every bind and every uniform upload.
+ *
+ * OpenGL 4.3 (and KHR_debug) let the driver call *us* instead:
+ * glDebugMessageCallback registers a function that receives every error,
+ * performance warning and hint the driver produces, with a human readable
+ * message. Nothing is paid for calls that produce no message.
+ *
+ * PIPELINE
+ *
+ *   driver thread(s)  --callback-->  lock-free ring buffer  --Flush()-->  console
+ *
+ *   - The callback only copies the message into a fixed-size ring slot.
+ *     In asynchronous mode the driver may call it from its own threads,
+ *     so the ring is multi-producer and never takes a lock.
+ *   - Flush() runs once per frame on the main thread. It deduplicates by
+ *     (source, type, id, severity) so a message fired every frame prints
+ *     once followed by a repeat count, not thousands of lines.
+ *   - Messages below the minimum severity are filtered in the driver with
+ *     glDebugMessageControl so they never reach the callback at all.
+ *
+ * SYNCHRONOUS vs ASYNCHRONOUS
+ *
+ *   Synchronous (GL_DEBUG_OUTPUT_SYNCHRONOUS) makes the driver call the
+ *   callback inside the offending GL function, on our thread. That is what
+ *   makes file/line attribution possible: GlCall records its call site in
+ *   a thread_local before running the call, and the callback reads it. It
+ *   is slower because the driver cannot defer its validation.
+ *
+ *   Asynchronous lets the driver report whenever it likes; messages still
+ *   arrive, but without a call site.
+ *
+ * BUILD CONFIGURATIONS
+ *
+ *   Debug   (_DEBUG): GlCall records the call site; ASSERT breaks into the
+ *                     debugger. If debug output is unavailable GlCall falls
+ *                     back to the old glGetError polling.
+ *   Release:          GlCall(x) is just x and ASSERT compiles away.
+ */
+
+#if defined(_DEBUG)
+	#if defined(_MSC_VER)
+		#define GL_DEBUG_BREAK() __debugbreak()
+	#else
+		#define GL_DEBUG_BREAK() __builtin_trap()
+	#endif
+	#define ASSERT(x) if (!(x)) GL_DEBUG_BREAK(); //validate a condition that checks if bool false add a breakpoint
+#else
+	#define ASSERT(x)
+#endif
+
+void glClearError();
+bool glLogCall(const char* function, const char* file, int line);
+
+namespace GLDebug
+{
+	enum class Severity
+	{
+		Notification = 0,
+		Low = 1,
+		Medium = 2,
+		High = 3
+	};
+
+	struct Stats
+	{
+		unsigned int received = 0;   // messages pushed by the callback
+		unsigned int dropped = 0;    // ring buffer was full
+		unsigned int printed = 0;    // unique messages written to the console
+		unsigned int repeats = 0;    // duplicates folded into a repeat count
+	};
+
+	struct CallSite
+	{
+		const char* function = nullptr;
+		const char* file = nullptr;
+		int line = 0;
+	};
+
+	// Call site of the GlCall currently executing on this thread.
+	inline thread_local CallSite t_CallSite;
+
+	// True once Init() installed the callback; otherwise GlCall polls glGetError.
+	extern bool g_CallbackActive;
+
+	// Install the callback. Returns false if the context has no debug output
+	// (pre-4.3 without KHR_debug), in which case GlCall keeps polling.
+	bool Init(bool synchronous = true, Severity minSeverity = Severity::Low);
+	void Shutdown();
+
+	void SetSynchronous(bool synchronous);
+	bool IsSynchronous();
+
+	void SetMinSeverity(Severity minSeverity);
+	Severity GetMinSeverity();
+
+	// Break into the debugger on High severity messages. Only possible in
+	// synchronous mode, where the callback runs on the offending call.
+	void SetBreakOnError(bool enabled);
+
+	// Drain the ring buffer and print new messages. Call once per frame.
+	void Flush();
+
+	const Stats& GetStats();
+
+	inline void BeginCall(const char* function, const char* file, int line)
+	{
+		t_CallSite.function = function;
+		t_CallSite.file = file;
+		t_CallSite.line = line;
+		if (!g_CallbackActive)
+			glClearError();
+	}
+
+	inline bool EndCall()
+	{
+		bool ok = true;
+		if (!g_CallbackActive)
+			ok = glLogCall(t_CallSite.function, t_CallSite.file, t_CallSite.line);
+		t_CallSite = CallSite();
+		return ok;
+	}
+}
+
+// GlCall deliberately stays an unbraced multi-statement macro: some call
+// sites declare a variable inside it, e.g. GlCall(int loc = glGet...(...));
+#if defined(_DEBUG)
+	#define GlCall(x) GLDebug::BeginCall(#x, __FILE__, __LINE__);\
+		x;\
+		ASSERT(GLDebug::EndCall())
+#else
+	#define GlCall(x) x
+#endif
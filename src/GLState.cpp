@@ -0,0 +1,419 @@
+#include "GLState.h"
+#include "Renderer.h"
+#include "GpuMemory.h"
+#include "MemoryBarriers.h"
+#include "Shader.h"
+
+#include <unordered_map>
+
+// "Don't know" marker — never a valid GL name or enum we set, so the first
+// call after Invalidate() always mismatches and is issued.
+static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+
+static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+// Texture targets we cache. Anything else is passed straight through.
+static const GLenum TRACKED_TARGETS[] = { GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY };
+static const unsigned int TRACKED_TARGET_COUNT = sizeof(TRACKED_TARGETS) / sizeof(TRACKED_TARGETS[0]);
+
+struct CachedState
+{
+	unsigned int program = UNKNOWN;
+	GLenum primitive = GL_TRIANGLES;               // of the current program
+	unsigned int patchVertices = UNKNOWN;
+	unsigned int vao = UNKNOWN;
+	unsigned int elementBuffer = UNKNOWN;          // EBO of the current VAO
+	std::unordered_map<unsigned int, unsigned int> vaoElementBuffers;
+
+	unsigned int activeUnit = UNKNOWN;
+	unsigned int textures[MAX_TEXTURE_UNITS][TRACKED_TARGET_COUNT];
+
+	std::unordered_map<GLenum, bool> capabilities;  // absent = unknown
+
+	GLenum cullFace = UNKNOWN;
+	GLenum blendSrc = UNKNOWN;
+	GLenum blendDst = UNKNOWN;
+	GLenum depthFunc = UNKNOWN;
+	unsigned int depthMask = UNKNOWN;
+	float clearColour[4] = { 0.0f, 0.0f, 0.0f, 0.0f };   // GL's initial value
+
+	int viewport[4] = { -1, -1, -1, -1 };
+	int scissor[4] = { -1, -1, -1, -1 };
+	unsigned int framebuffer = UNKNOWN;
+
+	GLState::Stats frame;
+	GLState::Stats lastFrame;
+
+	CachedState() { ForgetTextures(); }
+
+	void ForgetTextures()
+	{
+		for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+			for (unsigned int t = 0; t < TRACKED_TARGET_COUNT; t++)
+				textures[unit][t] = UNKNOWN;
+	}
+};
+
+static CachedState s_State;
+
+static int TargetIndex(GLenum target)
+{
+	for (unsigned int t = 0; t < TRACKED_TARGET_COUNT; t++)
+		if (TRACKED_TARGETS[t] == target)
+			return static_cast<int>(t);
+	return -1;
+}
+
+// Returns true if the caller should issue the GL call, and counts it.
+static bool Changed(unsigned int& cached, unsigned int value)
+{
+	if (cached == value)
+	{
+		s_State.frame.elided++;
+		return false;
+	}
+	cached = value;
+	s_State.frame.issued++;
+	return true;
+}
+
+void GLState::UseProgram(unsigned int program, GLenum primitive)
+{
+	if (Changed(s_State.program, program))
+	{
+		GlCall(glUseProgram(program));
+	}
+	s_State.primitive = primitive;
+	// Every tessellated shader takes triangle patches (Shader::PATCH_VERTICES)
+	if (primitive == GL_PATCHES && Changed(s_State.patchVertices, Shader::PATCH_VERTICES))
+	{
+		GlCall(glPatchParameteri(GL_PATCH_VERTICES, Shader::PATCH_VERTICES));
+	}
+}
+
+GLenum GLState::GetPrimitive()
+{
+	return s_State.primitive;
+}
+
+void GLState::BindVertexArray(unsigned int vao)
+{
+	if (!Changed(s_State.vao, vao))
+		return;
+
+	GlCall(glBindVertexArray(vao));
+
+	// Binding a VAO also switches the element buffer to whatever that VAO
+	// recorded, so pick up our record of it (or "unknown").
+	auto it = s_State.vaoElementBuffers.find(vao);
+	s_State.elementBuffer = it != s_State.vaoElementBuffers.end() ? it->second : UNKNOWN;
+}
+
+void GLState::BindElementBuffer(unsigned int buffer)
+{
+	if (!Changed(s_State.elementBuffer, buffer))
+		return;
+
+	GlCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer));
+
+	if (s_State.vao != UNKNOWN)
+		s_State.vaoElementBuffers[s_State.vao] = buffer;
+}
+
+void GLState::ActiveTexture(unsigned int unit)
+{
+	if (Changed(s_State.activeUnit, unit))
+	{
+		GlCall(glActiveTexture(GL_TEXTURE0 + unit));
+	}
+}
+
+void GLState::BindTexture(GLenum target, unsigned int texture)
+{
+	int t = TargetIndex(target);
+	unsigned int unit = s_State.activeUnit;
+
+	if (t < 0 || unit >= MAX_TEXTURE_UNITS)
+	{
+		// Untracked target or unknown unit: always issue.
+		s_State.frame.issued++;
+		GlCall(glBindTexture(target, texture));
+		return;
+	}
+
+	if (Changed(s_State.textures[unit][t], texture))
+	{
+		GlCall(glBindTexture(target, texture));
+	}
+}
+
+void GLState::BindTextureToUnit(unsigned int unit, GLenum target, unsigned int texture)
+{
+	int t = TargetIndex(target);
+
+	// Check before touching the active unit so a fully redundant bind skips
+	// the glActiveTexture as well.
+	if (t >= 0 && unit < MAX_TEXTURE_UNITS && s_State.textures[unit][t] == texture)
+	{
+		s_State.frame.elided++;
+		return;
+	}
+
+	ActiveTexture(unit);
+	BindTexture(target, texture);
+}
+
+void GLState::Enable(GLenum capability)
+{
+	SetCapability(capability, true);
+}
+
+void GLState::Disable(GLenum capability)
+{
+	SetCapability(capability, false);
+}
+
+void GLState::SetCapability(GLenum capability, bool enabled)
+{
+	auto it = s_State.capabilities.find(capability);
+	if (it != s_State.capabilities.end() && it->second == enabled)
+	{
+		s_State.frame.elided++;
+		return;
+	}
+
+	s_State.capabilities[capability] = enabled;
+	s_State.frame.issued++;
+	if (enabled)
+	{
+		GlCall(glEnable(capability));
+	}
+	else
+	{
+		GlCall(glDisable(capability));
+	}
+}
+
+bool GLState::IsEnabled(GLenum capability)
+{
+	auto it = s_State.capabilities.find(capability);
+	if (it != s_State.capabilities.end())
+		return it->second;
+
+	GLboolean enabled = GL_FALSE;
+	GlCall(enabled = glIsEnabled(capability));
+	s_State.capabilities[capability] = enabled == GL_TRUE;
+	return enabled == GL_TRUE;
+}
+
+void GLState::CullFace(GLenum mode)
+{
+	if (Changed(s_State.cullFace, mode))
+	{
+		GlCall(glCullFace(mode));
+	}
+}
+
+void GLState::BlendFunc(GLenum src, GLenum dst)
+{
+	if (s_State.blendSrc == src && s_State.blendDst == dst)
+	{
+		s_State.frame.elided++;
+		return;
+	}
+
+	s_State.blendSrc = src;
+	s_State.blendDst = dst;
+	s_State.frame.issued++;
+	GlCall(glBlendFunc(src, dst));
+}
+
+void GLState::DepthFunc(GLenum func)
+{
+	if (Changed(s_State.depthFunc, func))
+	{
+		GlCall(glDepthFunc(func));
+	}
+}
+
+void GLState::DepthMask(bool write)
+{
+	if (Changed(s_State.depthMask, write ? 1u : 0u))
+	{
+		GlCall(glDepthMask(write ? GL_TRUE : GL_FALSE));
+	}
+}
+
+GLenum GLState::GetDepthFunc()
+{
+	if (s_State.depthFunc == UNKNOWN)
+	{
+		GLint func = GL_LESS;
+		GlCall(glGetIntegerv(GL_DEPTH_FUNC, &func));
+		s_State.depthFunc = static_cast<GLenum>(func);
+	}
+	return s_State.depthFunc;
+}
+
+bool GLState::GetDepthMask()
+{
+	if (s_State.depthMask == UNKNOWN)
+	{
+		GLboolean write = GL_TRUE;
+		GlCall(glGetBooleanv(GL_DEPTH_WRITEMASK, &write));
+		s_State.depthMask = write == GL_TRUE ? 1u : 0u;
+	}
+	return s_State.depthMask == 1u;
+}
+
+void GLState::ClearColor(float r, float g, float b, float a)
+{
+	float* colour = s_State.clearColour;
+	if (colour[0] == r && colour[1] == g && colour[2] == b && colour[3] == a)
+	{
+		s_State.frame.elided++;
+		return;
+	}
+
+	colour[0] = r; colour[1] = g; colour[2] = b; colour[3] = a;
+	s_State.frame.issued++;
+	GlCall(glClearColor(r, g, b, a));
+}
+
+const float* GLState::GetClearColor()
+{
+	return s_State.clearColour;
+}
+
+void GLState::Viewport(int x, int y, int width, int height)
+{
+	int* vp = s_State.viewport;
+	if (vp[0] == x && vp[1] == y && vp[2] == width && vp[3] == height)
+	{
+		s_State.frame.elided++;
+		return;
+	}
+
+	vp[0] = x; vp[1] = y; vp[2] = width; vp[3] = height;
+	s_State.frame.issued++;
+	GlCall(glViewport(x, y, width, height));
+}
+
+void GLState::Scissor(int x, int y, int width, int height)
+{
+	int* box = s_State.scissor;
+	if (box[0] == x && box[1] == y && box[2] == width && box[3] == height)
+	{
+		s_State.frame.elided++;
+		return;
+	}
+
+	box[0] = x; box[1] = y; box[2] = width; box[3] = height;
+	s_State.frame.issued++;
+	GlCall(glScissor(x, y, width, height));
+}
+
+void GLState::BindFramebuffer(unsigned int framebuffer)
+{
+	if (Changed(s_State.framebuffer, framebuffer))
+	{
+		GlCall(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+	}
+}
+
+void GLState::OnProgramDeleted(unsigned int program)
+{
+	if (s_State.program == program)
+		s_State.program = UNKNOWN;
+}
+
+void GLState::OnVertexArrayDeleted(unsigned int vao)
+{
+	// Deleting the bound VAO reverts the binding to 0.
+	if (s_State.vao == vao)
+	{
+		s_State.vao = 0;
+		auto it = s_State.vaoElementBuffers.find(0);
+		s_State.elementBuffer = it != s_State.vaoElementBuffers.end() ? it->second : UNKNOWN;
+	}
+	s_State.vaoElementBuffers.erase(vao);
+}
+
+void GLState::OnBufferDeleted(unsigned int buffer)
+{
+	if (s_State.elementBuffer == buffer)
+		s_State.elementBuffer = 0;
+
+	// A VAO that isn't bound keeps the buffer object alive, but the name is
+	// free to be handed out again — forget any record that uses it.
+	for (auto& entry : s_State.vaoElementBuffers)
+		if (entry.second == buffer)
+			entry.second = UNKNOWN;
+
+	GpuMemory::OnBufferDeleted(buffer);
+	MemoryBarriers::OnBufferDeleted(buffer);
+}
+
+void GLState::OnTextureDeleted(unsigned int texture)
+{
+	// Deleting a texture unbinds it from every unit it was bound to.
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+		for (unsigned int t = 0; t < TRACKED_TARGET_COUNT; t++)
+			if (s_State.textures[unit][t] == texture)
+				s_State.textures[unit][t] = 0;
+
+	GpuMemory::OnTextureDeleted(texture);
+	MemoryBarriers::OnTextureDeleted(texture);
+}
+
+void GLState::OnFramebufferDeleted(unsigned int framebuffer)
+{
+	if (s_State.framebuffer == framebuffer)
+		s_State.framebuffer = 0;
+}
+
+bool GLState::HasDirectStateAccess()
+{
+	static const bool supported = GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access;
+	return supported;
+}
+
+void GLState::Invalidate()
+{
+	s_State.program = UNKNOWN;
+	s_State.patchVertices = UNKNOWN;
+	s_State.vao = UNKNOWN;
+	s_State.elementBuffer = UNKNOWN;
+	s_State.vaoElementBuffers.clear();
+	s_State.activeUnit = UNKNOWN;
+	s_State.ForgetTextures();
+	s_State.capabilities.clear();
+	s_State.cullFace = UNKNOWN;
+	s_State.blendSrc = UNKNOWN;
+	s_State.blendDst = UNKNOWN;
+	s_State.depthFunc = UNKNOWN;
+	s_State.depthMask = UNKNOWN;
+	for (int i = 0; i < 4; i++)
+	{
+		s_State.viewport[i] = -1;
+		s_State.scissor[i] = -1;
+	}
+	s_State.framebuffer = UNKNOWN;
+}
+
+void GLState::BeginFrame()
+{
+	s_State.lastFrame = s_State.frame;
+	s_State.frame = Stats();
+	Invalidate();
+}
+
+const GLState::Stats& GLState::GetFrameStats()
+{
+	return s_State.frame;
+}
+
+const GLState::Stats& GLState::GetLastFrameStats()
+{
+	return s_State.lastFrame;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <GL/glew.h>
+
+/**
+ * GLState — a shadow copy of the GL context state the wrappers touch
+ *
+ * Every glBind* / glUseProgram / glEnable call is validated by the driver
+ * even when it sets exactly what is already bound, and most of our wrappers
+ * (Shader::Bind, VertexArray::Bind, Texture::Bind, Framebuffer::Bind ...)
+ * are called once per draw whether or not anything changed.
+ *
+ * GLState remembers the last value set for each piece of state below and
+ * turns an identical rebind into a cheap integer compare:
+ *
+ *   - current program, and the primitive its draws use (GL_PATCHES for a
+ *     tessellated program) with GL_PATCH_VERTICES
+ *   - current VAO, and the element buffer recorded inside each VAO
+ *   - active texture unit and the 2D / cube map / 2D array binding per unit
+ *   - enabled capabilities (blend, depth test, cull face ...)
+ *   - cull face, blend func, depth func, depth mask
+ *   - viewport and scissor box
+ *   - draw framebuffer
+ *
+ * The element buffer binding is VAO state in core GL, not context state, so
+ * it is tracked per VAO: rebinding a VAO restores whatever EBO we last saw
+ * attached to it.
+ *
+ * The cache is only correct if everything goes through it. Code that calls
+ * GL directly (ImGui's backend, third-party code) must be followed by
+ * Invalidate(), which forgets everything so the next call of each kind is
+ * issued for real. BeginFrame() does this once per frame as a safety net.
+ *
+ * Deleting a GL object frees its name for reuse, so the wrappers report
+ * deletions (OnTextureDeleted etc.) to stop a recycled name matching a
+ * stale cache entry. The buffer and texture hooks also stop GpuMemory
+ * counting the storage.
+ *
+ * Direct state access (GL 4.5, or ARB_direct_state_access on the 4.3
+ * context we ask for) skips binding altogether: glCreate* / glNamed* /
+ * glVertexArray* act on an object by name. HasDirectStateAccess tells the
+ * wrappers which path to take; nothing here tracks what it changes.
+ */
+class GLState
+{
+public:
+	struct Stats
+	{
+		unsigned int issued = 0;   // state changes that reached the driver
+		unsigned int elided = 0;   // redundant changes skipped by the cache
+	};
+
+	// `primitive` is what the program draws (Shader::GetPrimitive); the
+	// draw calls in Renderer / GPUCulling read it back with GetPrimitive.
+	static void UseProgram(unsigned int program, GLenum primitive = GL_TRIANGLES);
+	static GLenum GetPrimitive();
+	static void BindVertexArray(unsigned int vao);
+	static void BindElementBuffer(unsigned int buffer);
+
+	static void ActiveTexture(unsigned int unit);
+	// Binds to the currently active unit (used when creating textures).
+	static void BindTexture(GLenum target, unsigned int texture);
+	// Makes `unit` active and binds the texture to it.
+	static void BindTextureToUnit(unsigned int unit, GLenum target, unsigned int texture);
+
+	static void Enable(GLenum capability);
+	static void Disable(GLenum capability);
+	static void SetCapability(GLenum capability, bool enabled);
+	// What was last set, asked of GL if the cache doesn't know; for a pass
+	// to put back what it found
+	static bool IsEnabled(GLenum capability);
+
+	static void CullFace(GLenum mode);
+	static void BlendFunc(GLenum src, GLenum dst);
+	static void DepthFunc(GLenum func);
+	static void DepthMask(bool write);
+	static GLenum GetDepthFunc();   // as IsEnabled
+	static bool GetDepthMask();
+
+	// Every glClearColor goes through here, so the colour is always known
+	// and reading it back never asks GL (see Invalidate)
+	static void ClearColor(float r, float g, float b, float a);
+	static const float* GetClearColor();   // RGBA
+
+	static void Viewport(int x, int y, int width, int height);
+	// The box GL_SCISSOR_TEST clips to; enable the test with Enable
+	static void Scissor(int x, int y, int width, int height);
+	static void BindFramebuffer(unsigned int framebuffer);
+
+	// Object deletion hooks — call after the matching glDelete*.
+	static void OnProgramDeleted(unsigned int program);
+	static void OnVertexArrayDeleted(unsigned int vao);
+	static void OnBufferDeleted(unsigned int buffer);
+	static void OnTextureDeleted(unsigned int texture);
+	static void OnFramebufferDeleted(unsigned int framebuffer);
+
+	// GL 4.5 or ARB_direct_state_access; checked once, after glewInit
+	static bool HasDirectStateAccess();
+
+	// Forget all cached state; the next call of each kind goes to GL. The
+	// clear colour is kept: nothing but ClearColor sets it, ImGui included.
+	static void Invalidate();
+
+	// Start a new frame: publish the previous frame's counters, reset them
+	// and invalidate the cache. Call once at the top of the main loop.
+	static void BeginFrame();
+
+	static const Stats& GetFrameStats();       // counters so far this frame
+	static const Stats& GetLastFrameStats();   // complete counters for the previous frame
+};
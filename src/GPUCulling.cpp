@@ -0,0 +1,291 @@
+#include "GPUCulling.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "MemoryBarriers.h"
+#include "HiZBuffer.h"
+#include "Mesh/Mesh.h"
+#include "Mesh/MeshArena.h"
+
+GPUCulling::GPUCulling(VertexFormat format)
+	: m_Format(format), m_InstanceBuffer(0), m_MeshBuffer(0), m_CommandBuffer(0), m_CommandTemplate(0), m_CounterBuffer(0),
+	  m_Frame(0), m_ArenaGeneration(MeshArena::Get(m_Format).GetGeneration()), m_Enabled(true), m_Dirty(false)
+{
+	m_CullShader = std::make_unique<ComputeShader>("res/Shaders/Culling/FrustumCull.glsl");
+	for (unsigned int i = 0; i < 6; i++)
+		m_PlaneUniforms[i] = m_CullShader->Uniform("u_Planes[" + std::to_string(i) + "]");
+
+	GlCall(glGenBuffers(1, &m_InstanceBuffer));
+	GlCall(glGenBuffers(1, &m_MeshBuffer));
+	GlCall(glGenBuffers(1, &m_CommandBuffer));
+	GlCall(glGenBuffers(1, &m_CommandTemplate));
+	GlCall(glGenBuffers(1, &m_CounterBuffer));
+	GlCall(glGenBuffers(2, m_Readback));
+
+	const unsigned int zero[2] = { 0, 0 };
+	GlCall(glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_CounterBuffer));
+	GlCall(glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(zero), zero, GL_DYNAMIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_CounterBuffer, sizeof(zero));
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Readback[i]));
+		GlCall(glBufferData(GL_COPY_WRITE_BUFFER, sizeof(zero), zero, GL_STREAM_READ));
+		GpuMemory::TrackBuffer(GpuMemory::Category::Staging, m_Readback[i], sizeof(zero));
+	}
+
+	// The survivors buffer is grown by Upload; the VAO only needs its name
+	m_Survivors = std::make_unique<InstanceBuffer>(256);
+	m_VAO = MeshArena::Get(m_Format).CreateVertexArray();
+	m_VAO->AddInstanceBuffer(*m_Survivors);
+	m_VAO->unBind();
+}
+
+GPUCulling::~GPUCulling()
+{
+	const unsigned int buffers[] = { m_InstanceBuffer, m_MeshBuffer, m_CommandBuffer, m_CommandTemplate,
+		m_CounterBuffer, m_Readback[0], m_Readback[1] };
+
+	for (unsigned int buffer : buffers)
+	{
+		GlCall(glDeleteBuffers(1, &buffer));
+		GLState::OnBufferDeleted(buffer);
+	}
+}
+
+unsigned int GPUCulling::AddMesh(const Mesh& mesh)
+{
+	// A mesh in another format's arena would be drawn from the wrong buffers
+	ASSERT(mesh.getVertexFormat() == m_Format);
+	const MeshArena::Range& range = mesh.getArenaRange();
+	unsigned int index = AddMesh(range.indexCount, range.firstIndex, static_cast<int>(range.baseVertex), mesh.getLocalBounds());
+	m_Meshes[index].source = &mesh;
+	return index;
+}
+
+unsigned int GPUCulling::AddMesh(unsigned int indexCount, unsigned int firstIndex, int baseVertex, const Bounds& localBounds)
+{
+	MeshInfo info;
+	info.source = nullptr;
+	info.indexCount = indexCount;
+	info.firstIndex = firstIndex;
+	info.baseVertex = baseVertex;
+	info.bounds = localBounds;
+	info.instanceCount = 0;
+	m_Meshes.push_back(info);
+
+	m_Dirty = true;
+	return static_cast<unsigned int>(m_Meshes.size() - 1);
+}
+
+void GPUCulling::ClearInstances()
+{
+	m_Instances.clear();
+	for (MeshInfo& mesh : m_Meshes)
+		mesh.instanceCount = 0;
+	m_Dirty = true;
+}
+
+unsigned int GPUCulling::AddInstance(unsigned int mesh, const InstanceData& instance)
+{
+	GPUInstance gpu;
+	gpu.model = instance.model;
+	gpu.colour = instance.colour;
+	gpu.mesh = mesh;
+	gpu.padding[0] = gpu.padding[1] = gpu.padding[2] = 0;
+	m_Instances.push_back(gpu);
+
+	m_Meshes[mesh].instanceCount++;
+	m_Dirty = true;
+	return static_cast<unsigned int>(m_Instances.size() - 1);
+}
+
+// Meshes added from a Mesh follow it if the arena has moved ranges since
+void GPUCulling::RefreshRanges()
+{
+	const unsigned int generation = MeshArena::Get(m_Format).GetGeneration();
+	if (generation == m_ArenaGeneration)
+		return;
+
+	for (MeshInfo& mesh : m_Meshes)
+	{
+		if (!mesh.source)
+			continue;
+
+		const MeshArena::Range& range = mesh.source->getArenaRange();
+		mesh.indexCount = range.indexCount;
+		mesh.firstIndex = range.firstIndex;
+		mesh.baseVertex = static_cast<int>(range.baseVertex);
+	}
+
+	m_ArenaGeneration = generation;
+	m_Dirty = true;
+}
+
+void GPUCulling::Upload()
+{
+	RefreshRanges();
+	if (!m_Dirty)
+		return;
+
+	// Each mesh gets a region of the survivors buffer big enough for all of
+	// its instances; baseInstance points the command at that region.
+	std::vector<DrawElementsIndirectCommand> commands(m_Meshes.size());
+	std::vector<GPUMesh> meshes(m_Meshes.size());
+	unsigned int baseInstance = 0;
+	for (std::size_t i = 0; i < m_Meshes.size(); i++)
+	{
+		const MeshInfo& mesh = m_Meshes[i];
+
+		commands[i].count = mesh.indexCount;
+		commands[i].instanceCount = 0;   // the cull shader counts survivors up from here
+		commands[i].firstIndex = mesh.firstIndex;
+		commands[i].baseVertex = mesh.baseVertex;
+		commands[i].baseInstance = baseInstance;
+		baseInstance += mesh.instanceCount;
+
+		meshes[i].centreRadius = glm::vec4(mesh.bounds.centre, mesh.bounds.radius);
+		meshes[i].extents = glm::vec4(mesh.bounds.extents, 0.0f);
+	}
+
+	m_Survivors->Reserve(baseInstance);
+
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_InstanceBuffer));
+	GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, m_Instances.size() * sizeof(GPUInstance), m_Instances.data(), GL_STATIC_DRAW));
+
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_MeshBuffer));
+	GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, meshes.size() * sizeof(GPUMesh), meshes.data(), GL_STATIC_DRAW));
+
+	const GLsizeiptr commandBytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_CommandTemplate));
+	GlCall(glBufferData(GL_COPY_WRITE_BUFFER, commandBytes, commands.data(), GL_STATIC_DRAW));
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_CommandBuffer));
+	GlCall(glBufferData(GL_COPY_WRITE_BUFFER, commandBytes, commands.data(), GL_DYNAMIC_COPY));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_InstanceBuffer, m_Instances.size() * sizeof(GPUInstance));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_MeshBuffer, meshes.size() * sizeof(GPUMesh));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_CommandTemplate, commandBytes);
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_CommandBuffer, commandBytes);
+
+	m_Stats.instances = static_cast<unsigned int>(m_Instances.size());
+	m_Stats.meshes = static_cast<unsigned int>(m_Meshes.size());
+	m_Dirty = false;
+}
+
+void GPUCulling::Cull(const glm::mat4& viewProjection)
+{
+	Dispatch(viewProjection, nullptr, glm::mat4(1.0f));
+}
+
+void GPUCulling::Cull(const glm::mat4& viewProjection, const HiZBuffer& hiz, const glm::mat4& hizViewProjection)
+{
+	Dispatch(viewProjection, hiz.IsValid() ? &hiz : nullptr, hizViewProjection);
+}
+
+void GPUCulling::Dispatch(const glm::mat4& viewProjection, const HiZBuffer* hiz, const glm::mat4& hizViewProjection)
+{
+	Upload();
+
+	m_Stats.dispatches = 0;
+	if (m_Instances.empty() || m_Meshes.empty())
+		return;
+
+	// Reset every instanceCount to 0 and the counters, GPU side, over
+	// what the last cull stored
+	MemoryBarriers::UseBuffer(m_CommandBuffer, MemoryBarriers::Access::BufferUpdate);
+	MemoryBarriers::UseBuffer(m_CounterBuffer, MemoryBarriers::Access::BufferUpdate);
+	MemoryBarriers::Flush();
+	const unsigned int zero[2] = { 0, 0 };
+	GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_CommandTemplate));
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_CommandBuffer));
+	GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+		m_Meshes.size() * sizeof(DrawElementsIndirectCommand)));
+	GlCall(glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_CounterBuffer));
+	GlCall(glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(zero), zero));
+
+	const Frustum frustum = Frustum::FromMatrix(viewProjection);
+
+	m_CullShader->Bind();
+	m_CullShader->setUniform1i("u_InstanceCount", static_cast<int>(m_Instances.size()));
+	m_CullShader->setUniform1i("u_CullEnabled", m_Enabled ? 1 : 0);
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = frustum.planes[i];
+		m_CullShader->setUniform4f(m_PlaneUniforms[i], plane.x, plane.y, plane.z, plane.w);
+	}
+
+	// Occlusion only makes sense for instances the frustum test kept
+	const bool occlusion = m_Enabled && hiz;
+	m_CullShader->setUniform1i("u_OcclusionEnabled", occlusion ? 1 : 0);
+	if (occlusion)
+	{
+		GLState::BindTextureToUnit(HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, hiz->GetTexture());
+		MemoryBarriers::UseTexture(hiz->GetTexture(), MemoryBarriers::Access::Texture);
+		m_CullShader->setUniform1i("u_HiZ", static_cast<int>(HIZ_TEXTURE_UNIT));
+		m_CullShader->setUniform2f("u_HiZSize", static_cast<float>(hiz->GetWidth()), static_cast<float>(hiz->GetHeight()));
+		m_CullShader->setUniform1f("u_HiZMaxLevel", static_cast<float>(hiz->GetLevelCount() - 1));
+		m_CullShader->setUniformMat4f("u_HiZViewProjection", hizViewProjection);
+	}
+
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, m_InstanceBuffer));
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BINDING, m_MeshBuffer));
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SURVIVOR_BINDING, m_Survivors->GetID()));
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, m_CommandBuffer));
+	GlCall(glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, COUNTER_BINDING, m_CounterBuffer));
+
+	// The draw reads the commands as indirect arguments and the survivors
+	// as vertex attributes, the readback copy the counter: each says so
+	MemoryBarriers::WriteBuffer(m_CommandBuffer);
+	MemoryBarriers::WriteBuffer(m_Survivors->GetID());
+	MemoryBarriers::WriteBuffer(m_CounterBuffer);
+	m_Stats.dispatches = m_CullShader->DispatchForElements(static_cast<unsigned int>(m_Instances.size()));
+
+	ReadVisibleCount();
+}
+
+// Copy this frame's counters into one readback buffer and read the other,
+// which holds last frame's and has had a whole frame to finish.
+void GPUCulling::ReadVisibleCount()
+{
+	const unsigned int write = m_Frame % 2;
+	const unsigned int read = (m_Frame + 1) % 2;
+
+	MemoryBarriers::UseBuffer(m_CounterBuffer, MemoryBarriers::Access::BufferUpdate);
+	MemoryBarriers::Flush();
+
+	GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_CounterBuffer));
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Readback[write]));
+	GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, 2 * sizeof(unsigned int)));
+
+	if (m_Frame > 0)
+	{
+		unsigned int counters[2];
+		GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_Readback[read]));
+		GlCall(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(counters), counters));
+		m_Stats.visible = counters[0];
+		m_Stats.occluded = counters[1];
+	}
+
+	m_Frame++;
+}
+
+void GPUCulling::Draw() const
+{
+	Draw(0, static_cast<unsigned int>(m_Meshes.size()));
+}
+
+void GPUCulling::Draw(unsigned int firstMesh, unsigned int meshCount) const
+{
+	if (m_Instances.empty() || meshCount == 0 || firstMesh + meshCount > m_Meshes.size())
+		return;
+
+	MemoryBarriers::UseBuffer(m_CommandBuffer, MemoryBarriers::Access::Command);
+	MemoryBarriers::UseBuffer(m_Survivors->GetID(), MemoryBarriers::Access::VertexAttrib);
+	MemoryBarriers::Flush();
+
+	m_VAO->Bind();
+	GlCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer));
+
+	// The "indices" pointer is a byte offset into GL_DRAW_INDIRECT_BUFFER
+	const void* offset = (const void*)(firstMesh * sizeof(DrawElementsIndirectCommand));
+	const unsigned int indexType = MeshArena::Get(m_Format).GetIndexBuffer().GetType();
+	GlCall(glMultiDrawElementsIndirect(GLState::GetPrimitive(), indexType, offset, static_cast<GLsizei>(meshCount), 0));
+}
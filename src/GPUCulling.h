@@ -0,0 +1,201 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "ComputeShader.h"
+#include "InstanceBuffer.h"
+#include "VertexArray.h"
+#include "DrawIndirectBuffer.h"
+#include "Culling.h"
+#include "Mesh/PackedVertex.h"
+
+class Mesh;
+class HiZBuffer;
+
+/**
+ * GPUCulling — frustum culling and draw building in a compute shader
+ *
+ * CullBatch (Culling.h) tests every instance on the CPU, then the visible
+ * ones are copied into an InstanceBuffer and uploaded. Both steps are O(N)
+ * on the CPU every frame, so at a few hundred thousand instances the CPU
+ * is the bottleneck long before the GPU is.
+ *
+ * Here the instances are uploaded ONCE, and each frame a compute shader
+ * does the whole job on the GPU:
+ *
+ *     instances (SSBO)          survivors (instance buffer)
+ *     +---+---+---+---+         +---------+---------+
+ *     | c | s | c | c |  cull   | cube... | sphere..|   one region per mesh
+ *     +---+---+---+---+  ---->  +---------+---------+
+ *                                    ^          ^
+ *     commands (indirect + SSBO)     |          |
+ *     { count, instanceCount, firstIndex, baseVertex, baseInstance } x meshes
+ *
+ * One thread per instance transforms the mesh's local bounds by the
+ * instance's model matrix (the same maths as Bounds::Transformed), tests
+ * them against the six frustum planes and, if visible, does
+ *
+ *     slot = atomicAdd(commands[mesh].instanceCount, 1);
+ *     survivors[commands[mesh].baseInstance + slot] = instance;
+ *
+ * so each mesh's DrawElementsIndirectCommand ends up holding exactly the
+ * number of survivors, packed at the start of its region. One
+ * glMultiDrawElementsIndirect then draws every mesh; the CPU never learns
+ * how many instances survived. Its cost per frame is a buffer copy to
+ * reset the counts, one dispatch and one draw, whatever N is.
+ *
+ * OCCLUSION
+ *   Given a HiZBuffer built from an earlier frame's depth, instances that
+ *   pass the frustum test are also projected to the screen and rejected
+ *   if the pyramid shows something nearer over their whole rectangle (see
+ *   HiZBuffer.h). Only instances hidden behind what was DRAWN are culled,
+ *   so build the pyramid from the culled scene's own depth buffer.
+ *
+ * Uniform atomic counters also total the survivors for the GUI. Reading
+ * it back straight away would stall on the GPU, so it is copied into one
+ * of two readback buffers and read a frame later, when that copy is done.
+ *
+ * Every mesh must live in the MeshArena: the draw uses the arena's index
+ * buffer and a VAO over the arena buffers with the survivors attached as
+ * instance attributes (locations 8..12, see InstanceBuffer.h).
+ *
+ * GL 4.6 adds glMultiDrawElementsIndirectCount, which also reads the
+ * command count from a buffer. We have one command per mesh whatever
+ * survives (an instanceCount of 0 draws nothing), so 4.3's
+ * glMultiDrawElementsIndirect is enough.
+ *
+ * Usage:
+ *     unsigned int cube = culling.AddMesh(*cubeMesh);
+ *     culling.AddInstance(cube, instance);      // ...many times
+ *     culling.Upload();                         // when instances change
+ *
+ *     culling.Cull(projection * view);          // each frame
+ *     shader.Bind();
+ *     culling.Draw();
+ *
+ *     // with occlusion: last frame's pyramid and view-projection
+ *     culling.Cull(viewProjection, hiz, lastViewProjection);
+ *     culling.Draw();
+ *     hiz.Build(framebuffer.GetDepthTexture(), width, height);
+ */
+
+class GPUCulling
+{
+public:
+	// SSBO bindings 0 (DrawIndirectBuffer) and 1 (LightList) are taken
+	static const unsigned int INSTANCE_BINDING = 2;
+	static const unsigned int MESH_BINDING = 3;
+	static const unsigned int SURVIVOR_BINDING = 4;
+	static const unsigned int COMMAND_BINDING = 5;
+	static const unsigned int COUNTER_BINDING = 0;   // atomic counter buffer binding
+	static const unsigned int HIZ_TEXTURE_UNIT = 0;
+
+	struct Stats
+	{
+		unsigned int instances = 0;
+		unsigned int meshes = 0;
+		unsigned int visible = 0;     // survivors, one frame behind
+		unsigned int occluded = 0;    // inside the frustum but hidden, one frame behind
+		unsigned int dispatches = 0;  // work groups in the last Cull
+	};
+
+	// Meshes must all live in the MeshArena of `format`: the draws go
+	// through that arena's buffers.
+	explicit GPUCulling(VertexFormat format = VertexFormat::Standard);
+	~GPUCulling();
+	GPUCulling(const GPUCulling&) = delete;
+	GPUCulling& operator=(const GPUCulling&) = delete;
+
+	// Register a mesh type; returns its index for AddInstance. The mesh
+	// must outlive the culler: its arena range is looked up again whenever
+	// MeshArena moves ranges (defragment / growth).
+	unsigned int AddMesh(const Mesh& mesh);
+	unsigned int AddMesh(unsigned int indexCount, unsigned int firstIndex, int baseVertex, const Bounds& localBounds);
+
+	// Drop every instance (the meshes stay registered).
+	void ClearInstances();
+	unsigned int AddInstance(unsigned int mesh, const InstanceData& instance);
+
+	// Send the instances and the per-mesh command templates to the GPU.
+	// Only does work if something changed since the last upload.
+	void Upload();
+
+	// Reset the commands, run the cull shader and make its writes visible
+	// to the draw. With culling disabled every instance survives, which is
+	// useful for comparing against the culled result.
+	void Cull(const glm::mat4& viewProjection);
+
+	// Frustum and occlusion culling. hizViewProjection is the matrix the
+	// scene was drawn with when `hiz` was built; an invalid pyramid (e.g.
+	// on the first frame) falls back to frustum culling only.
+	void Cull(const glm::mat4& viewProjection, const HiZBuffer& hiz, const glm::mat4& hizViewProjection);
+
+	// One multi-draw over every mesh's command. Bind the shader first.
+	void Draw() const;
+	// Only meshes [firstMesh, firstMesh + meshCount), e.g. the ones that
+	// share a material.
+	void Draw(unsigned int firstMesh, unsigned int meshCount) const;
+
+	unsigned int GetMeshCount() const { return static_cast<unsigned int>(m_Meshes.size()); }
+
+	void SetEnabled(bool enabled) { m_Enabled = enabled; }
+	bool IsEnabled() const { return m_Enabled; }
+
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	struct MeshInfo
+	{
+		const Mesh*  source;          // nullptr when added by range
+		unsigned int indexCount;
+		unsigned int firstIndex;
+		int          baseVertex;
+		Bounds       bounds;
+		unsigned int instanceCount;   // instances of this mesh, i.e. its region size
+	};
+
+	// std430 layouts shared with FrustumCull.glsl
+	struct GPUInstance
+	{
+		glm::mat4    model;
+		glm::vec4    colour;
+		unsigned int mesh;
+		unsigned int padding[3];
+	};
+
+	struct GPUMesh
+	{
+		glm::vec4 centreRadius;   // xyz = local bounds centre, w = sphere radius
+		glm::vec4 extents;        // xyz = local half extents
+	};
+
+	void Dispatch(const glm::mat4& viewProjection, const HiZBuffer* hiz, const glm::mat4& hizViewProjection);
+	void RefreshRanges();
+	void ReadVisibleCount();
+
+	std::unique_ptr<ComputeShader> m_CullShader;
+	UniformHandle m_PlaneUniforms[6];   // u_Planes[0..5], looked up once
+
+	std::vector<MeshInfo> m_Meshes;
+	std::vector<GPUInstance> m_Instances;
+
+	VertexFormat m_Format;
+	unsigned int m_InstanceBuffer;    // GPUInstance[], read by the cull shader
+	unsigned int m_MeshBuffer;        // GPUMesh[]
+	unsigned int m_CommandBuffer;     // DrawElementsIndirectCommand[], written by the shader
+	unsigned int m_CommandTemplate;   // the same with instanceCount 0, copied in each frame
+	unsigned int m_CounterBuffer;     // atomic counters: survivors, occluded this frame
+	unsigned int m_Readback[2];       // counter copies, read a frame late
+	unsigned int m_Frame;
+	unsigned int m_ArenaGeneration;
+
+	// Survivors, written by the shader as an SSBO and read as instance
+	// attributes through m_VAO
+	std::unique_ptr<InstanceBuffer> m_Survivors;
+	std::unique_ptr<VertexArray> m_VAO;
+
+	bool m_Enabled;
+	bool m_Dirty;
+	Stats m_Stats;
+};
@@ -0,0 +1,116 @@
+#include "GPUPicker.h"
+#include "Framebuffer.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+GPUPicker::GPUPicker()
+	: m_Oldest(0), m_Pending(0), m_Frame(0)
+{
+	// One 4-byte pixel per slot. STREAM_READ: written by the GPU once,
+	// read by the CPU once.
+	for (Slot& slot : m_Slots)
+	{
+		GlCall(glGenBuffers(1, &slot.buffer));
+		GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+		GlCall(glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ));
+		GpuMemory::TrackBuffer(GpuMemory::Category::Staging, slot.buffer, sizeof(GLuint));
+	}
+	GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+}
+
+GPUPicker::~GPUPicker()
+{
+	for (Slot& slot : m_Slots)
+	{
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		GlCall(glDeleteBuffers(1, &slot.buffer));
+		GLState::OnBufferDeleted(slot.buffer);
+	}
+}
+
+void GPUPicker::Request(const Framebuffer& framebuffer, int x, int y)
+{
+	m_Stats.requests++;
+	if (m_Pending == RING_SIZE || !framebuffer.HasObjectIds())
+	{
+		m_Stats.dropped++;
+		return;
+	}
+
+	Slot& slot = m_Slots[(m_Oldest + m_Pending) % RING_SIZE];
+	slot.frame = m_Frame;
+	slot.time = std::chrono::steady_clock::now();
+	slot.outside = x < 0 || y < 0 || x >= framebuffer.GetWidth() || y >= framebuffer.GetHeight();
+	m_Pending++;
+
+	if (slot.outside)
+		return;
+
+	// Like Framebuffer::BlitToScreen, the read target is bound directly and
+	// put back so GLState's cached GL_FRAMEBUFFER binding stays valid.
+	GlCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.GetID()));
+	GlCall(glReadBuffer(Framebuffer::OBJECT_ID_ATTACHMENT));
+
+	// With a pack buffer bound the last argument is an offset into it, and
+	// the call returns as soon as the copy is queued.
+	GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+	GlCall(glReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+	GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	GlCall(glReadBuffer(GL_COLOR_ATTACHMENT0));
+	GlCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+}
+
+void GPUPicker::Poll()
+{
+	m_Frame++;
+
+	while (m_Pending > 0)
+	{
+		Slot& slot = m_Slots[m_Oldest];
+		if (slot.outside)
+		{
+			Resolve(slot, NO_OBJECT);
+			continue;
+		}
+
+		// Zero timeout: only asks whether the copy has finished. Without
+		// GL_SYNC_FLUSH_COMMANDS_BIT, so the fence must already have been
+		// flushed, which the frame's SwapBuffers does.
+		GLenum state = glClientWaitSync(slot.fence, 0, 0);
+		if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+			break;   // reads finish in order, so the newer ones are not done either
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+
+		GLuint id = NO_OBJECT;
+		GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+		const void* data;
+		GlCall(data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT));
+		if (data)
+		{
+			id = *static_cast<const GLuint*>(data);
+			GlCall(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+		}
+		GlCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+		Resolve(slot, id);
+	}
+}
+
+void GPUPicker::Resolve(Slot& slot, unsigned int id)
+{
+	m_Result.valid = true;
+	m_Result.id = id;
+	m_Result.framesLate = m_Frame - slot.frame;
+	m_Result.latencyMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - slot.time).count();
+	m_Stats.resolved++;
+
+	m_Oldest = (m_Oldest + 1) % RING_SIZE;
+	m_Pending--;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <GL/glew.h>
+#include <chrono>
+
+class Framebuffer;
+
+/**
+ * GPUPicker — which object is under the cursor, read from an ID buffer
+ *
+ * Instead of casting a ray on the CPU, every draw also writes its object's
+ * ID into an integer colour attachment (Framebuffer::EnableObjectIds). The
+ * object under the cursor is then simply the value of one pixel, correct
+ * for any shape, alpha-tested or animated on the GPU, at no extra CPU cost.
+ *
+ * The catch is getting that pixel back. glReadPixels into client memory
+ * waits until the GPU has finished the frame, a full pipeline stall. Here
+ * the read goes into a pixel buffer object (GL_PIXEL_PACK_BUFFER) instead,
+ * so glReadPixels only queues a copy and returns. A fence placed after it
+ * tells us when the copy is done:
+ *
+ *     frame N     Request: glReadPixels -> PBO[0], fence[0]
+ *     frame N+1   Poll: fence[0] signalled? not yet
+ *                 Request: glReadPixels -> PBO[1], fence[1]
+ *     frame N+2   Poll: fence[0] signalled -> map PBO[0], result ready
+ *
+ * Poll never waits (glClientWaitSync with a zero timeout), so the answer
+ * arrives one or two frames after the click, depending on how far ahead of
+ * the GPU the CPU runs. RING_SIZE reads can be in flight; a Request while
+ * all are pending is dropped and counted.
+ *
+ * Usage, once per frame:
+ *     picker.Poll();                                   // collect finished reads
+ *     ...draw into fbo, objects writing ID + 1...
+ *     picker.Request(fbo, x, y);                         // pixel coordinates, y up
+ *     if (picker.GetResult().valid) ...GetResult().id...
+ */
+
+class GPUPicker
+{
+public:
+	static const unsigned int RING_SIZE = 3;
+	static const unsigned int NO_OBJECT = 0;   // written where nothing was drawn
+
+	struct Result
+	{
+		bool         valid = false;      // false until the first read resolves
+		unsigned int id = NO_OBJECT;
+		unsigned int framesLate = 0;     // Polls between Request and resolve
+		float        latencyMs = 0.0f;   // wall time between Request and resolve
+	};
+
+	struct Stats
+	{
+		unsigned int requests = 0;
+		unsigned int resolved = 0;
+		unsigned int dropped = 0;        // ring full when requested
+	};
+
+	GPUPicker();
+	~GPUPicker();
+	GPUPicker(const GPUPicker&) = delete;
+	GPUPicker& operator=(const GPUPicker&) = delete;
+
+	// Queue a read of pixel (x, y) of the framebuffer's object ID attachment.
+	// Out-of-range pixels resolve to NO_OBJECT without touching the GPU.
+	void Request(const Framebuffer& framebuffer, int x, int y);
+
+	// Resolve every read whose fence has signalled, oldest first. Call once
+	// per frame; it also counts frames for Result::framesLate.
+	void Poll();
+
+	const Result& GetResult() const { return m_Result; }
+	const Stats& GetStats() const { return m_Stats; }
+	unsigned int GetPendingCount() const { return m_Pending; }
+
+private:
+	struct Slot
+	{
+		unsigned int buffer = 0;
+		GLsync fence = nullptr;
+		bool outside = false;            // nothing read; resolves to NO_OBJECT
+		unsigned int frame = 0;
+		std::chrono::steady_clock::time_point time;
+	};
+
+	void Resolve(Slot& slot, unsigned int id);
+
+	Slot m_Slots[RING_SIZE];
+	unsigned int m_Oldest;     // next slot to resolve
+	unsigned int m_Pending;    // slots in flight, from m_Oldest on
+	unsigned int m_Frame;
+	Result m_Result;
+	Stats m_Stats;
+};
@@ -0,0 +1,143 @@
+#include "GpuMemory.h"
+#include "Renderer.h"
+
+#include <unordered_map>
+
+namespace
+{
+	struct Allocation
+	{
+		GpuMemory::Category category;
+		std::size_t bytes;
+	};
+
+	struct GpuMemoryState
+	{
+		// Buffer and texture names are separate namespaces
+		std::unordered_map<unsigned int, Allocation> buffers;
+		std::unordered_map<unsigned int, Allocation> textures;
+		GpuMemory::Usage usage[static_cast<int>(GpuMemory::Category::Count)];
+		std::size_t totalBytes = 0;
+		std::size_t peakBytes = 0;
+	};
+
+	GpuMemoryState s_Memory;
+
+	GpuMemory::Usage& UsageOf(GpuMemory::Category category)
+	{
+		return s_Memory.usage[static_cast<int>(category)];
+	}
+
+	void Forget(std::unordered_map<unsigned int, Allocation>& allocations, unsigned int name)
+	{
+		auto it = allocations.find(name);
+		if (it == allocations.end())
+			return;
+		GpuMemory::Usage& usage = UsageOf(it->second.category);
+		usage.bytes -= it->second.bytes;
+		usage.objects--;
+		s_Memory.totalBytes -= it->second.bytes;
+		allocations.erase(it);
+	}
+
+	void Track(std::unordered_map<unsigned int, Allocation>& allocations, GpuMemory::Category category,
+		unsigned int name, std::size_t bytes)
+	{
+		if (!name)
+			return;
+		Forget(allocations, name);
+		allocations[name] = { category, bytes };
+
+		GpuMemory::Usage& usage = UsageOf(category);
+		usage.bytes += bytes;
+		usage.objects++;
+		usage.peakBytes = usage.bytes > usage.peakBytes ? usage.bytes : usage.peakBytes;
+		s_Memory.totalBytes += bytes;
+		s_Memory.peakBytes = s_Memory.totalBytes > s_Memory.peakBytes ? s_Memory.totalBytes : s_Memory.peakBytes;
+	}
+}
+
+void GpuMemory::TrackBuffer(Category category, unsigned int buffer, std::size_t bytes)
+{
+	Track(s_Memory.buffers, category, buffer, bytes);
+}
+
+void GpuMemory::TrackTexture(Category category, unsigned int texture, std::size_t bytes)
+{
+	Track(s_Memory.textures, category, texture, bytes);
+}
+
+void GpuMemory::OnBufferDeleted(unsigned int buffer)
+{
+	Forget(s_Memory.buffers, buffer);
+}
+
+void GpuMemory::OnTextureDeleted(unsigned int texture)
+{
+	Forget(s_Memory.textures, texture);
+}
+
+const GpuMemory::Usage& GpuMemory::GetUsage(Category category)
+{
+	return UsageOf(category);
+}
+
+std::size_t GpuMemory::GetTotalBytes()
+{
+	return s_Memory.totalBytes;
+}
+
+std::size_t GpuMemory::GetPeakBytes()
+{
+	return s_Memory.peakBytes;
+}
+
+const char* GpuMemory::GetCategoryName(Category category)
+{
+	switch (category)
+	{
+	case Category::Vertex:          return "Vertex buffers";
+	case Category::Index:           return "Index buffers";
+	case Category::Uniform:         return "Uniform buffers";
+	case Category::Storage:         return "Storage buffers";
+	case Category::Texture:         return "Textures";
+	case Category::RenderTarget:    return "Render targets";
+	case Category::Staging:         return "Staging";
+	case Category::Pooled:          return "Pooled (idle)";
+	default:                        return "?";
+	}
+}
+
+void GpuMemory::ResetPeaks()
+{
+	for (Usage& usage : s_Memory.usage)
+		usage.peakBytes = usage.bytes;
+	s_Memory.peakBytes = s_Memory.totalBytes;
+}
+
+GpuMemory::DriverInfo GpuMemory::QueryDriver()
+{
+	DriverInfo info;
+	// Both report KiB
+	if (GLEW_NVX_gpu_memory_info)
+	{
+		GLint dedicated = 0, available = 0;
+		GlCall(glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &dedicated));
+		GlCall(glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &available));
+		info.available = true;
+		info.source = "GL_NVX_gpu_memory_info";
+		info.totalBytes = static_cast<std::size_t>(dedicated) * 1024;
+		info.freeBytes = static_cast<std::size_t>(available) * 1024;
+	}
+	else if (GLEW_ATI_meminfo)
+	{
+		// Free in the pool, largest free block, and the same for auxiliary
+		// (system) memory
+		GLint free[4] = {};
+		GlCall(glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, free));
+		info.available = true;
+		info.source = "GL_ATI_meminfo";
+		info.freeBytes = static_cast<std::size_t>(free[0]) * 1024;
+	}
+	return info;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * GpuMemory — how much GPU memory the renderer has asked for, and for what
+ *
+ * Nothing used to add up the buffers and textures a test creates; only
+ * TestGPUParticles printed the size of its own SSBO. Every wrapper that
+ * allocates GL storage reports it here, by GL name:
+ *
+ *     GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW));
+ *     GpuMemory::TrackBuffer(GpuMemory::Category::Storage, buffer, bytes);
+ *
+ * Tracking a name again replaces its size and category, so re-specifying
+ * a buffer (glBufferData on a grown MeshArena, a resized LightList) needs
+ * nothing else. Deletion needs nothing at all: GLState's OnBufferDeleted
+ * and OnTextureDeleted hooks, which every glDelete* is already followed
+ * by, forget the name.
+ *
+ * CATEGORIES
+ *   Pooled is storage GpuResources holds on to for reuse: no longer any
+ *   test's, but still allocated. Staging is pixel pack/unpack and readback
+ *   buffers. The sizes are what was asked for; drivers round up, pad
+ *   textures and keep copies of their own, which is what the driver total
+ *   (GL_NVX_gpu_memory_info or GL_ATI_meminfo, where either is exposed)
+ *   is for.
+ *
+ * The high-water marks only go up, until ResetPeaks (the benchmark runner
+ * calls it as each test opens). GL thread only.
+ */
+class GpuMemory
+{
+public:
+	enum class Category
+	{
+		Vertex,
+		Index,
+		Uniform,
+		Storage,            // SSBOs, indirect commands, atomic counters
+		Texture,
+		RenderTarget,       // framebuffer attachments, render graph textures
+		Staging,
+		Pooled,
+		Count
+	};
+
+	struct Usage
+	{
+		std::size_t bytes = 0;
+		std::size_t peakBytes = 0;
+		unsigned int objects = 0;
+	};
+
+	struct DriverInfo
+	{
+		bool available = false;
+		const char* source = "";    // the extension it came from
+		std::size_t totalBytes = 0; // dedicated video memory, 0 if unknown
+		std::size_t freeBytes = 0;
+	};
+
+	static void TrackBuffer(Category category, unsigned int buffer, std::size_t bytes);
+	static void TrackTexture(Category category, unsigned int texture, std::size_t bytes);
+	// From GLState's deletion hooks; unknown names are ignored
+	static void OnBufferDeleted(unsigned int buffer);
+	static void OnTextureDeleted(unsigned int texture);
+
+	static const Usage& GetUsage(Category category);
+	static std::size_t GetTotalBytes();
+	static std::size_t GetPeakBytes();
+	static const char* GetCategoryName(Category category);
+	static void ResetPeaks();
+
+	// Asks the driver now; a few glGetIntegerv, not for every draw
+	static DriverInfo QueryDriver();
+};
@@ -0,0 +1,395 @@
+#include "GpuResources.h"
+#include "Renderer.h"
+#include "GLState.h"
+
+#include <algorithm>
+
+static std::unique_ptr<GpuResources> s_Resources;
+
+static std::size_t SizeClass(std::size_t size)
+{
+	std::size_t capacity = GpuResources::MIN_BUFFER_SIZE;
+	while (capacity < size)
+		capacity *= 2;
+	return capacity;
+}
+
+static std::size_t TexelBytes(unsigned int format)
+{
+	switch (format)
+	{
+	case GL_R8:                 return 1;
+	case GL_R16F:
+	case GL_RG8:                return 2;
+	case GL_RGBA16F:
+	case GL_RG32F:              return 8;
+	case GL_RGB16F:             return 6;
+	case GL_RGBA32F:            return 16;
+	case GL_DEPTH32F_STENCIL8:  return 8;
+	default:                    return 4;   // RGBA8, R32F, R32UI, RG16F, R11F_G11F_B10F, depth 24/32
+	}
+}
+
+GpuResources::~GpuResources()
+{
+	// The context is about to go; nothing left needs to wait for the GPU
+	for (PendingFrame& frame : m_Pending)
+	{
+		glDeleteSync(frame.fence);
+		m_Released.insert(m_Released.end(), frame.objects.begin(), frame.objects.end());
+	}
+	for (const Object& object : m_Released)
+		DeleteNow(object.type, object.id);
+	for (const Object& object : m_Pool)
+		DeleteNow(object.type, object.id);
+}
+
+uint32_t GpuResources::Issue(std::vector<Slot>& slots, std::vector<uint32_t>& freeSlots, const Object& object)
+{
+	uint32_t index;
+	if (!freeSlots.empty())
+	{
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(slots.size());
+		slots.emplace_back();
+	}
+	slots[index].object = object;
+	slots[index].live = true;
+	return index;
+}
+
+const GpuResources::Slot* GpuResources::Resolve(const std::vector<Slot>& slots, uint32_t index, uint32_t generation) const
+{
+	if (index >= slots.size() || !slots[index].live || slots[index].generation != generation)
+	{
+		m_StaleLookups++;
+		return nullptr;
+	}
+	return &slots[index];
+}
+
+bool GpuResources::Retire(std::vector<Slot>& slots, std::vector<uint32_t>& freeSlots, uint32_t index, uint32_t generation)
+{
+	if (!Resolve(slots, index, generation))
+		return false;
+
+	Slot& slot = slots[index];
+	m_Released.push_back(slot.object);
+	slot.live = false;
+	slot.generation = slot.generation == UINT32_MAX ? 1 : slot.generation + 1;
+	freeSlots.push_back(index);
+	return true;
+}
+
+BufferHandle GpuResources::CreateBuffer(std::size_t size, const void* data, unsigned int usage, GpuMemory::Category category)
+{
+	const std::size_t capacity = SizeClass(size);
+
+	// Most recently returned first: likeliest to still be warm in the driver
+	Object object;
+	auto it = std::find_if(m_Pool.rbegin(), m_Pool.rend(), [&](const Object& o)
+		{
+			return o.type == GL_BUFFER && o.bytes == capacity && o.usage == usage;
+		});
+	if (it != m_Pool.rend())
+	{
+		object = *it;
+		m_Pool.erase(std::next(it).base());
+		m_PooledBytes -= object.bytes;
+		m_Reused++;
+	}
+	else
+	{
+		object.type = GL_BUFFER;
+		object.bytes = capacity;
+		object.usage = usage;
+		object.pooled = true;
+		// Pooled buffers are only ever refilled with sub-data, never
+		// re-specified, so with DSA the storage can be immutable
+		if (GLState::HasDirectStateAccess())
+		{
+			GlCall(glCreateBuffers(1, &object.id));
+			GlCall(glNamedBufferStorage(object.id, capacity, nullptr, GL_DYNAMIC_STORAGE_BIT));
+		}
+		else
+		{
+			GlCall(glGenBuffers(1, &object.id));
+			GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, object.id));
+			GlCall(glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, usage));
+		}
+		m_Created++;
+	}
+	GpuMemory::TrackBuffer(category, object.id, object.bytes);
+
+	if (GLState::HasDirectStateAccess())
+	{
+		if (data && size > 0)
+		{
+			GlCall(glNamedBufferSubData(object.id, 0, size, data));
+		}
+	}
+	else
+	{
+		if (data && size > 0)
+		{
+			GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, object.id));
+			GlCall(glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data));
+		}
+		GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+	}
+
+	BufferHandle handle;
+	handle.index = Issue(m_Buffers, m_FreeBufferSlots, object);
+	handle.generation = m_Buffers[handle.index].generation;
+	return handle;
+}
+
+unsigned int GpuResources::GetBuffer(BufferHandle handle) const
+{
+	const Slot* slot = Resolve(m_Buffers, handle.index, handle.generation);
+	return slot ? slot->object.id : 0;
+}
+
+std::size_t GpuResources::GetBufferCapacity(BufferHandle handle) const
+{
+	const Slot* slot = Resolve(m_Buffers, handle.index, handle.generation);
+	return slot ? slot->object.bytes : 0;
+}
+
+void GpuResources::Release(BufferHandle handle)
+{
+	Retire(m_Buffers, m_FreeBufferSlots, handle.index, handle.generation);
+}
+
+TextureHandle GpuResources::CreateTexture(const TextureDesc& desc, GpuMemory::Category category)
+{
+	Object object;
+	auto it = std::find_if(m_Pool.rbegin(), m_Pool.rend(), [&](const Object& o)
+		{
+			return o.type == GL_TEXTURE && o.desc == desc;
+		});
+	if (it != m_Pool.rend())
+	{
+		object = *it;
+		m_Pool.erase(std::next(it).base());
+		m_PooledBytes -= object.bytes;
+		m_Reused++;
+	}
+	else
+	{
+		object.type = GL_TEXTURE;
+		object.desc = desc;
+		object.bytes = GetTextureBytes(desc);
+		object.pooled = true;
+		GlCall(glGenTextures(1, &object.id));
+		GLState::BindTexture(desc.target, object.id);
+		if (desc.target == GL_TEXTURE_2D_ARRAY)
+		{
+			GlCall(glTexStorage3D(GL_TEXTURE_2D_ARRAY, desc.levels, desc.format, desc.width, desc.height, desc.layers));
+		}
+		else
+		{
+			GlCall(glTexStorage2D(GL_TEXTURE_2D, desc.levels, desc.format, desc.width, desc.height));
+		}
+		GLState::BindTexture(desc.target, 0);
+		m_Created++;
+	}
+	GpuMemory::TrackTexture(category, object.id, object.bytes);
+
+	TextureHandle handle;
+	handle.index = Issue(m_Textures, m_FreeTextureSlots, object);
+	handle.generation = m_Textures[handle.index].generation;
+	return handle;
+}
+
+unsigned int GpuResources::GetTexture(TextureHandle handle) const
+{
+	const Slot* slot = Resolve(m_Textures, handle.index, handle.generation);
+	return slot ? slot->object.id : 0;
+}
+
+void GpuResources::Release(TextureHandle handle)
+{
+	Retire(m_Textures, m_FreeTextureSlots, handle.index, handle.generation);
+}
+
+std::size_t GpuResources::GetTextureBytes(const TextureDesc& desc)
+{
+	std::size_t bytes = 0;
+	for (int level = 0, w = desc.width, h = desc.height; level < desc.levels; level++, w = std::max(1, w / 2), h = std::max(1, h / 2))
+		bytes += static_cast<std::size_t>(w) * h * TexelBytes(desc.format);
+	return bytes * (desc.target == GL_TEXTURE_2D_ARRAY ? desc.layers : 1);
+}
+
+void GpuResources::DeferDelete(unsigned int type, unsigned int id)
+{
+	if (!id)
+		return;
+
+	Object object;
+	object.type = type;
+	object.id = id;
+	m_Released.push_back(object);
+}
+
+void GpuResources::Delete(unsigned int type, unsigned int id)
+{
+	if (s_Resources)
+		s_Resources->DeferDelete(type, id);
+	else
+		DeleteNow(type, id);
+}
+
+void GpuResources::EndFrame()
+{
+	if (!m_Released.empty())
+	{
+		PendingFrame frame;
+		frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frame.objects.swap(m_Released);
+		m_Pending.push_back(std::move(frame));
+	}
+
+	// Fences signal in submission order: stop at the first that has not
+	std::size_t done = 0;
+	for (; done < m_Pending.size(); done++)
+	{
+		const GLenum result = glClientWaitSync(m_Pending[done].fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+			break;
+
+		glDeleteSync(m_Pending[done].fence);
+		for (Object& object : m_Pending[done].objects)
+			Recycle(object);
+	}
+	m_Pending.erase(m_Pending.begin(), m_Pending.begin() + done);
+
+	m_Frame++;
+	Trim();
+}
+
+void GpuResources::Recycle(Object& object)
+{
+	if (!object.pooled)
+	{
+		Destroy(object);
+		return;
+	}
+	object.frame = m_Frame;
+	m_PooledBytes += object.bytes;
+	m_Pool.push_back(object);
+	if (object.type == GL_BUFFER)
+		GpuMemory::TrackBuffer(GpuMemory::Category::Pooled, object.id, object.bytes);
+	else
+		GpuMemory::TrackTexture(GpuMemory::Category::Pooled, object.id, object.bytes);
+}
+
+void GpuResources::Trim()
+{
+	// m_Pool is in return order, so the idle and the over-budget are in front
+	std::size_t drop = 0;
+	std::size_t bytes = m_PooledBytes;
+	while (drop < m_Pool.size() && (bytes > m_PoolBudget || m_Frame - m_Pool[drop].frame > MAX_IDLE_FRAMES))
+	{
+		bytes -= m_Pool[drop].bytes;
+		drop++;
+	}
+	for (std::size_t i = 0; i < drop; i++)
+		Destroy(m_Pool[i]);
+	m_Pool.erase(m_Pool.begin(), m_Pool.begin() + drop);
+	m_PooledBytes = bytes;
+}
+
+void GpuResources::SetPoolBudget(std::size_t bytes)
+{
+	m_PoolBudget = bytes;
+	Trim();
+}
+
+void GpuResources::ReleaseUnused()
+{
+	for (const Object& object : m_Pool)
+		Destroy(object);
+	m_Pool.clear();
+	m_PooledBytes = 0;
+}
+
+void GpuResources::Destroy(const Object& object)
+{
+	DeleteNow(object.type, object.id);
+	m_Deleted++;
+}
+
+void GpuResources::DeleteNow(unsigned int type, unsigned int id)
+{
+	switch (type)
+	{
+	case GL_BUFFER:
+		GlCall(glDeleteBuffers(1, &id));
+		GLState::OnBufferDeleted(id);
+		break;
+	case GL_TEXTURE:
+		GlCall(glDeleteTextures(1, &id));
+		GLState::OnTextureDeleted(id);
+		break;
+	case GL_VERTEX_ARRAY:
+		GlCall(glDeleteVertexArrays(1, &id));
+		GLState::OnVertexArrayDeleted(id);
+		break;
+	case GL_FRAMEBUFFER:
+		GlCall(glDeleteFramebuffers(1, &id));
+		GLState::OnFramebufferDeleted(id);
+		break;
+	case GL_PROGRAM:
+		GlCall(glDeleteProgram(id));
+		GLState::OnProgramDeleted(id);
+		break;
+	}
+}
+
+GpuResources::Stats GpuResources::GetStats() const
+{
+	Stats stats;
+	for (const Slot& slot : m_Buffers)
+		stats.buffers += slot.live ? 1 : 0;
+	for (const Slot& slot : m_Textures)
+		stats.textures += slot.live ? 1 : 0;
+	for (const Object& object : m_Pool)
+	{
+		if (object.type == GL_BUFFER)
+			stats.pooledBuffers++;
+		else
+			stats.pooledTextures++;
+	}
+	stats.pooledBytes = m_PooledBytes;
+	stats.pendingObjects = static_cast<unsigned int>(m_Released.size());
+	for (const PendingFrame& frame : m_Pending)
+		stats.pendingObjects += static_cast<unsigned int>(frame.objects.size());
+	stats.pendingFrames = static_cast<unsigned int>(m_Pending.size());
+	stats.created = m_Created;
+	stats.reused = m_Reused;
+	stats.deleted = m_Deleted;
+	stats.staleLookups = m_StaleLookups;
+	return stats;
+}
+
+GpuResources& GpuResources::Get()
+{
+	if (!s_Resources)
+		s_Resources = std::make_unique<GpuResources>();
+	return *s_Resources;
+}
+
+bool GpuResources::IsAlive()
+{
+	return s_Resources != nullptr;
+}
+
+void GpuResources::Shutdown()
+{
+	s_Resources.reset();
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+#include "GpuMemory.h"
+
+// A slot in GpuResources plus the generation it was issued in. Releasing
+// bumps the slot's generation, so a handle kept past its Release resolves
+// to 0 instead of to whatever object reuses the slot.
+template <typename Tag>
+struct GpuHandle
+{
+	uint32_t index = 0;
+	uint32_t generation = 0;     // never 0 for an issued handle
+
+	bool IsValid() const { return generation != 0; }
+	bool operator==(const GpuHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const GpuHandle& other) const { return !(*this == other); }
+};
+
+typedef GpuHandle<struct GpuBufferTag> BufferHandle;
+typedef GpuHandle<struct GpuTextureTag> TextureHandle;
+
+/**
+ * GpuResources — where GL buffers and textures come from and go to
+ *
+ * glDeleteBuffers on a buffer a queued draw still reads, or glBufferData
+ * on a fresh one every time a test regenerates its geometry, is legal but
+ * not free: the driver either keeps the storage alive behind our back or
+ * waits for the GPU, and every new allocation is driver bookkeeping (and
+ * often a page mapping) in the middle of a frame. The registry takes both
+ * out of the frame:
+ *
+ * DEFERRED DELETION
+ *   Release and DeferDelete do not delete anything. The object joins this
+ *   frame's list; EndFrame puts a fence behind the frame's commands, and
+ *   once a later EndFrame sees that fence signalled (polled, never waited
+ *   on) the GPU is done with everything released before it. Only then is
+ *   an object deleted or pooled. VertexBuffer, IndexBuffer, VertexArray,
+ *   Texture, Framebuffer and Shader destroy their GL objects through Delete.
+ *
+ * POOLS
+ *   A released buffer returns to a pool by size class (powers of two from
+ *   MIN_BUFFER_SIZE) and usage; a released texture by its exact TextureDesc
+ *   (immutable storage cannot be resized). CreateBuffer and CreateTexture
+ *   take from the pool first, so what comes back was idle on the GPU and
+ *   glBufferSubData into it cannot stall. Pooled objects beyond the budget
+ *   (least recently returned first), or idle for MAX_IDLE_FRAMES, are
+ *   deleted for real. A pooled texture keeps the sampling parameters its
+ *   last user set: set every one you rely on. GpuMemory counts an object
+ *   under the category it was created for while it's live and as Pooled
+ *   while it waits here.
+ *
+ * HANDLES
+ *   Pooled objects are held through generational handles (GpuHandle), so a
+ *   stale handle is caught (GetBuffer returns 0, counted in staleLookups)
+ *   rather than silently aliasing the next user's object.
+ *
+ * EndFrame once per frame, after the frame's commands. GL thread only.
+ * Shutdown deletes pending and pooled objects and must run before the GL
+ * context goes away; objects still live then are deleted by their owners
+ * directly (Delete falls back to deleting at once).
+ */
+class GpuResources
+{
+public:
+	static const std::size_t MIN_BUFFER_SIZE = 256;
+	static const std::size_t DEFAULT_POOL_BUDGET = 64 * 1024 * 1024;
+	static const unsigned int MAX_IDLE_FRAMES = 300;
+
+	struct TextureDesc
+	{
+		int width = 0, height = 0;
+		unsigned int format = GL_RGBA8;   // sized internal format
+		int levels = 1;
+		unsigned int target = GL_TEXTURE_2D;   // or GL_TEXTURE_2D_ARRAY
+		int layers = 1;                        // GL_TEXTURE_2D_ARRAY only
+
+		bool operator==(const TextureDesc& other) const
+		{
+			return width == other.width && height == other.height && format == other.format && levels == other.levels
+				&& target == other.target && layers == other.layers;
+		}
+	};
+
+	struct Stats
+	{
+		unsigned int buffers = 0;          // live handles
+		unsigned int textures = 0;
+		unsigned int pooledBuffers = 0;
+		unsigned int pooledTextures = 0;
+		std::size_t pooledBytes = 0;
+		unsigned int pendingObjects = 0;   // released, fence not yet passed
+		unsigned int pendingFrames = 0;
+		unsigned int created = 0;          // totals since startup
+		unsigned int reused = 0;
+		unsigned int deleted = 0;
+		unsigned int staleLookups = 0;
+	};
+
+	GpuResources() = default;
+	~GpuResources();
+	GpuResources(const GpuResources&) = delete;
+	GpuResources& operator=(const GpuResources&) = delete;
+
+	// A GL_ARRAY_BUFFER-compatible buffer of at least size bytes, the
+	// first size of them filled from data (when given). Nothing is left
+	// bound. The owner must not re-specify it (glBufferData): its storage
+	// goes back to the pool with the size it was created with.
+	BufferHandle CreateBuffer(std::size_t size, const void* data, unsigned int usage = GL_STATIC_DRAW,
+		GpuMemory::Category category = GpuMemory::Category::Vertex);
+	unsigned int GetBuffer(BufferHandle handle) const;
+	std::size_t GetBufferCapacity(BufferHandle handle) const;
+	void Release(BufferHandle handle);
+
+	// A GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY with immutable storage
+	// (glTexStorage2D / glTexStorage3D)
+	TextureHandle CreateTexture(const TextureDesc& desc, GpuMemory::Category category = GpuMemory::Category::Texture);
+	unsigned int GetTexture(TextureHandle handle) const;
+	void Release(TextureHandle handle);
+
+	// GPU memory of a texture with desc, every level
+	static std::size_t GetTextureBytes(const TextureDesc& desc);
+
+	// Deletes a GL object created elsewhere once the GPU is past this
+	// frame. type is the object's identifier namespace: GL_BUFFER,
+	// GL_TEXTURE, GL_VERTEX_ARRAY, GL_FRAMEBUFFER or GL_PROGRAM.
+	void DeferDelete(unsigned int type, unsigned int id);
+
+	// DeferDelete when the registry is alive, otherwise deletes now
+	static void Delete(unsigned int type, unsigned int id);
+
+	// Fences this frame's releases and recycles or deletes the ones whose
+	// fence has passed
+	void EndFrame();
+
+	std::size_t GetPoolBudget() const { return m_PoolBudget; }
+	void SetPoolBudget(std::size_t bytes);
+
+	// Deletes every pooled object (pending ones still wait for their fence)
+	void ReleaseUnused();
+
+	Stats GetStats() const;
+
+	static GpuResources& Get();
+	static bool IsAlive();
+	static void Shutdown();
+
+private:
+	struct Object
+	{
+		unsigned int type = 0;
+		unsigned int id = 0;
+		std::size_t bytes = 0;          // buffers: capacity
+		unsigned int usage = 0;         // buffers
+		TextureDesc desc;               // textures
+		bool pooled = false;            // goes back to a pool, not deleted
+		unsigned int frame = 0;         // when it entered the pool
+	};
+
+	struct Slot
+	{
+		Object object;
+		uint32_t generation = 1;
+		bool live = false;
+	};
+
+	struct PendingFrame
+	{
+		GLsync fence = nullptr;
+		std::vector<Object> objects;
+	};
+
+	uint32_t Issue(std::vector<Slot>& slots, std::vector<uint32_t>& freeSlots, const Object& object);
+	const Slot* Resolve(const std::vector<Slot>& slots, uint32_t index, uint32_t generation) const;
+	bool Retire(std::vector<Slot>& slots, std::vector<uint32_t>& freeSlots, uint32_t index, uint32_t generation);
+	void Recycle(Object& object);
+	void Trim();
+	void Destroy(const Object& object);
+	static void DeleteNow(unsigned int type, unsigned int id);
+
+	std::vector<Slot> m_Buffers, m_Textures;
+	std::vector<uint32_t> m_FreeBufferSlots, m_FreeTextureSlots;
+
+	std::vector<Object> m_Pool;                 // oldest first
+	std::vector<Object> m_Released;             // this frame, not yet fenced
+	std::vector<PendingFrame> m_Pending;        // oldest first
+
+	std::size_t m_PoolBudget = DEFAULT_POOL_BUDGET;
+	std::size_t m_PooledBytes = 0;
+	unsigned int m_Frame = 0;
+	unsigned int m_Created = 0, m_Reused = 0, m_Deleted = 0;
+	mutable unsigned int m_StaleLookups = 0;
+};
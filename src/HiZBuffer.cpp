@@ -0,0 +1,107 @@
+#include "HiZBuffer.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuResources.h"
+#include "MemoryBarriers.h"
+
+#include <algorithm>
+
+HiZBuffer::HiZBuffer()
+	: m_Texture(0), m_DepthWidth(0), m_DepthHeight(0), m_Width(0), m_Height(0), m_Levels(0), m_Valid(false)
+{
+	m_BuildShader = std::make_unique<ComputeShader>("res/Shaders/Culling/HiZBuild.glsl");
+}
+
+HiZBuffer::~HiZBuffer()
+{
+	if (m_Texture)
+	{
+		GlCall(glDeleteTextures(1, &m_Texture));
+		GLState::OnTextureDeleted(m_Texture);
+	}
+}
+
+void HiZBuffer::Allocate(int width, int height)
+{
+	if (m_Texture)
+	{
+		GlCall(glDeleteTextures(1, &m_Texture));
+		GLState::OnTextureDeleted(m_Texture);
+	}
+
+	m_DepthWidth = width;
+	m_DepthHeight = height;
+	m_Width = 1;
+	m_Height = 1;
+	while (m_Width < width)
+		m_Width *= 2;
+	while (m_Height < height)
+		m_Height *= 2;
+
+	// Down to 1x1: log2(largest side) + 1 levels
+	m_Levels = 1;
+	for (int size = std::max(m_Width, m_Height); size > 1; size /= 2)
+		m_Levels++;
+
+	// Immutable storage so every level can be bound as an image
+	GlCall(glGenTextures(1, &m_Texture));
+	GLState::BindTexture(GL_TEXTURE_2D, m_Texture);
+	GlCall(glTexStorage2D(GL_TEXTURE_2D, m_Levels, GL_R32F, m_Width, m_Height));
+	GpuResources::TextureDesc desc;
+	desc.width = m_Width;
+	desc.height = m_Height;
+	desc.format = GL_R32F;
+	desc.levels = m_Levels;
+	GpuMemory::TrackTexture(GpuMemory::Category::RenderTarget, m_Texture, GpuResources::GetTextureBytes(desc));
+	// The cull shader picks the level itself with textureLod; no filtering
+	// between texels or levels, which would mix in nearer depths.
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST));
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+	m_Valid = false;
+}
+
+void HiZBuffer::Build(unsigned int depthTexture, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return;
+
+	if (width != m_DepthWidth || height != m_DepthHeight || !m_Texture)
+		Allocate(width, height);
+
+	m_BuildShader->Bind();
+
+	// Level 0 is a straight copy of the depth texture, read with texelFetch
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D, depthTexture);
+	m_BuildShader->setUniform1i("u_Depth", 0);
+
+	int srcWidth = m_Width, srcHeight = m_Height;
+	for (unsigned int level = 0; level < m_Levels; level++)
+	{
+		const int dstWidth = level == 0 ? m_Width : std::max(1, srcWidth / 2);
+		const int dstHeight = level == 0 ? m_Height : std::max(1, srcHeight / 2);
+
+		// The shader gets both sizes from imageSize/textureSize
+		m_BuildShader->setUniform1i("u_Level", static_cast<int>(level));
+
+		if (level > 0)
+		{
+			GlCall(glBindImageTexture(0, m_Texture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F));
+		}
+		GlCall(glBindImageTexture(1, m_Texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F));
+
+		// Each level reads the one before through an image load
+		if (level > 0)
+			MemoryBarriers::UseTexture(m_Texture, MemoryBarriers::Access::Image);
+		MemoryBarriers::WriteTexture(m_Texture);
+		m_BuildShader->DispatchForElements(dstWidth, dstHeight);
+
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+
+	// The cull shaders sample the finished pyramid, and declare it
+	m_Valid = true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <memory>
+
+#include "ComputeShader.h"
+
+/**
+ * HiZBuffer — hierarchical depth pyramid for occlusion culling
+ *
+ * Frustum culling keeps everything in front of the camera, including the
+ * thousands of objects hidden behind the first row. To reject those we
+ * need to know how far away the visible surface is over the area an
+ * object would cover on screen.
+ *
+ * The pyramid is a mip chain of the depth buffer where each texel holds
+ * the FARTHEST depth of the 2x2 texels below it (max reduction):
+ *
+ *     level 0   2048 x 2048   the depth buffer, resampled
+ *     level 1   1024 x 1024   max of each 2x2 block of level 0
+ *     level 2    512 x 512    ...
+ *     ...          1 x 1      farthest depth on screen
+ *
+ * An object whose screen rectangle is W pixels wide is tested at level
+ * ceil(log2(W)), where the rectangle touches at most 2x2 texels. If the
+ * object's NEAREST depth is farther than the farthest depth of those four
+ * texels, every pixel it could cover already has something in front of
+ * it, so it is occluded. Four texture reads, whatever the object's size.
+ *
+ * Each level is one compute dispatch reading the level above through an
+ * image binding. Level 0 is rounded up to a power of two each way, each
+ * texel the max of the (at most 2x2) depth texels it overlaps, so every
+ * level after it halves exactly. With odd sizes a texel's screen area
+ * would drift from where the cull shaders' uv * size lookup expects it,
+ * and the edge of an object's rectangle could read a texel that never
+ * saw the depths under it.
+ *
+ * LAST FRAME'S DEPTH
+ *   Build runs after the scene is drawn and the culling pass uses the
+ *   result NEXT frame, projecting bounds with the view-projection the
+ *   pyramid was built with. An object that becomes visible this frame
+ *   (something moved out of the way, or the camera did) therefore appears
+ *   one frame late; in exchange there is no depth pre-pass.
+ */
+
+class HiZBuffer
+{
+public:
+	HiZBuffer();
+	~HiZBuffer();
+	HiZBuffer(const HiZBuffer&) = delete;
+	HiZBuffer& operator=(const HiZBuffer&) = delete;
+
+	// Rebuild the pyramid from a depth texture (e.g. Framebuffer::
+	// GetDepthTexture). Reallocates when the size changes.
+	void Build(unsigned int depthTexture, int width, int height);
+
+	// Forget the contents, e.g. after a camera cut, so it is not used
+	// until the next Build.
+	void Invalidate() { m_Valid = false; }
+
+	bool IsValid() const { return m_Valid; }
+	unsigned int GetTexture() const { return m_Texture; }
+	// Level 0, the depth size rounded up to powers of two
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+	unsigned int GetLevelCount() const { return m_Levels; }
+
+private:
+	void Allocate(int width, int height);
+
+	std::unique_ptr<ComputeShader> m_BuildShader;
+
+	unsigned int m_Texture;   // GL_R32F with m_Levels mip levels
+	int m_DepthWidth;         // what Build was last given
+	int m_DepthHeight;
+	int m_Width;
+	int m_Height;
+	unsigned int m_Levels;
+	bool m_Valid;
+};
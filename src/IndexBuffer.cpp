@@ -1,29 +1,86 @@
 #include "IndexBuffer.h"
 #include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
 
+#include <vector>
 
-
-IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count): m_Count(count)
+IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count): m_Count(count), m_Type(GL_UNSIGNED_INT)
 {
 
     ASSERT(sizeof(unsigned int) == sizeof(GLuint));//confirm theyre the same size on this platform
 
-    GlCall(glGenBuffers(1, &m_RendererID));
-    GlCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID));// Bind the buffer as an array buffer to upload vertex data
-    GlCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, GL_STATIC_DRAW));// Upload the vertex data to the GPU buffer
+    // 0xFFFF is left out so the buffer stays usable with primitive restart
+    std::vector<unsigned short> shortIndices;
+    if (data && count > 0)
+    {
+        unsigned int maxIndex = 0;
+        for (unsigned int i = 0; i < count; i++)
+            maxIndex = data[i] > maxIndex ? data[i] : maxIndex;
+
+        if (maxIndex < 0xFFFF)
+        {
+            m_Type = GL_UNSIGNED_SHORT;
+            shortIndices.assign(data, data + count);
+        }
+    }
+
+    if (!data)
+    {
+        if (GLState::HasDirectStateAccess())
+        {
+            GlCall(glCreateBuffers(1, &m_RendererID));
+            GlCall(glNamedBufferData(m_RendererID, count * sizeof(unsigned int), nullptr, GL_STATIC_DRAW));
+        }
+        else
+        {
+            GlCall(glGenBuffers(1, &m_RendererID));
+        }
+        // Bound either way, to attach it to the VAO bound right now
+        GLState::BindElementBuffer(m_RendererID);
+        if (!GLState::HasDirectStateAccess())
+        {
+            GlCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), nullptr, GL_STATIC_DRAW));
+        }
+        GpuMemory::TrackBuffer(GpuMemory::Category::Index, m_RendererID, count * sizeof(unsigned int));
+        return;
+    }
+
+    if (m_Type == GL_UNSIGNED_SHORT)
+        m_Handle = GpuResources::Get().CreateBuffer(count * sizeof(unsigned short), shortIndices.data(), GL_STATIC_DRAW,
+            GpuMemory::Category::Index);
+    else
+        m_Handle = GpuResources::Get().CreateBuffer(count * sizeof(unsigned int), data, GL_STATIC_DRAW, GpuMemory::Category::Index);
+    m_RendererID = GpuResources::Get().GetBuffer(m_Handle);
+
+    // Still bound like before, which attaches it to a VAO bound right now
+    GLState::BindElementBuffer(m_RendererID);
 }
 
 IndexBuffer::~IndexBuffer()
 {
-    GlCall(glDeleteBuffers(1, &m_RendererID));
+    if (m_Handle.IsValid() && GpuResources::IsAlive())
+        GpuResources::Get().Release(m_Handle);
+    else
+        GpuResources::Delete(GL_BUFFER, m_RendererID);
 }
 
 void IndexBuffer::Bind() const
 {
-    GlCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID));
+    GLState::BindElementBuffer(m_RendererID);
 }
 
 void IndexBuffer::Unbind() const
 {
-    GlCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    GLState::BindElementBuffer(0);
+}
+
+unsigned int IndexBuffer::GetTypeSize(unsigned int type)
+{
+    switch (type)
+    {
+        case GL_UNSIGNED_BYTE: return 1;
+        case GL_UNSIGNED_SHORT: return 2;
+        default: return 4;
+    }
 }
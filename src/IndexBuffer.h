@@ -1,15 +1,38 @@
 #pragma once
+#include "GpuResources.h"
+
 
 class IndexBuffer //In OpenGL, an index buffer (also known as an element buffer or EBO) is used to store indices that reference vertices in a vertex buffer. Instead of sending redundant vertex data multiple times for shapes that share vertices, like a cube or a mesh, the index buffer holds the order in which vertices should be drawn to form triangles or other primitives. Each index in the buffer corresponds to a vertex in the vertex buffer, allowing OpenGL to reuse vertex data efficiently. When rendering, the GPU looks at the index buffer to know which vertices to connect, reducing memory usage and improving performance by avoiding duplicated vertex data. This is especially useful for complex models with many shared vertices.
 {
 private:
 	unsigned int m_RendererID;
+	BufferHandle m_Handle;   // invalid for the unpooled nullptr buffer
 	unsigned int m_Count;
+	unsigned int m_Type;   // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
 public:
+	// The indices are always given as unsigned int, but stored as 16-bit
+	// GL_UNSIGNED_SHORT when every one of them fits: half the memory and
+	// half the index fetch bandwidth, which covers most small meshes.
+	// With data == nullptr (space to fill later, e.g. the MeshArena) the
+	// buffer is 32-bit, since nothing is known about what will go in it.
+	//
+	// Buffers with data are pooled like VertexBuffer's (VertexBuffer.h);
+	// the nullptr one is allocated exactly, for its owner to re-specify.
+	//
+	// GL_UNSIGNED_BYTE is deliberately never chosen: many GPUs have no
+	// native 8-bit index fetch and the driver converts the buffer.
 	IndexBuffer(const unsigned int* data, unsigned int count);
 	~IndexBuffer();
 
 	void Bind() const;
 	void Unbind() const;
 	inline unsigned int GetCount() const { return m_Count; }
-};
\ No newline at end of file
+	inline unsigned int GetID() const { return m_RendererID; }
+
+	// Pass to glDrawElements and friends; offsets into the buffer are
+	// firstIndex * GetIndexSize() bytes.
+	inline unsigned int GetType() const { return m_Type; }
+	inline unsigned int GetIndexSize() const { return GetTypeSize(m_Type); }
+
+	static unsigned int GetTypeSize(unsigned int type);
+};
@@ -0,0 +1,268 @@
+#include "Input.h"
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	// File layout: a header, then per frame the frame time, the cursor, a
+	// mouse button mask and the keys held down
+	const uint32_t RECORDING_MAGIC = 0x524E5049;   // "IPNR"
+	const uint32_t RECORDING_VERSION = 1;
+
+	struct RecordingHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t frames;
+	};
+
+	struct Snapshot
+	{
+		float deltaTime = 0.0f;
+		double cursorX = 0.0;
+		double cursorY = 0.0;
+		uint8_t buttons = 0;            // bit b: GLFW mouse button b held
+		std::vector<uint16_t> keys;     // held, ascending
+	};
+
+	// GLFW's key codes, which have gaps that glfwGetKey rejects
+	const int KEY_RANGES[][2] = {
+		{ 32, 32 }, { 39, 39 }, { 44, 57 }, { 59, 59 }, { 61, 61 }, { 65, 93 }, { 96, 96 },
+		{ 161, 162 }, { 256, 269 }, { 280, 284 }, { 290, 314 }, { 320, 336 }, { 340, GLFW_KEY_LAST },
+	};
+
+	struct InputState
+	{
+		Input::Mode mode = Input::Mode::Live;
+		Input::Mode armed = Input::Mode::Live;
+		std::string path;
+		float fixedTimestep = 0.0f;
+
+		Snapshot current;
+		std::vector<Snapshot> frames;   // being recorded, or loaded to replay
+		unsigned int frame = 0;
+		bool active = false;
+	};
+
+	InputState s_Input;
+
+	void TakeSnapshot(GLFWwindow* window, Snapshot& snapshot)
+	{
+		snapshot.keys.clear();
+		for (const auto& range : KEY_RANGES)
+		{
+			for (int key = range[0]; key <= range[1]; key++)
+			{
+				if (glfwGetKey(window, key) == GLFW_PRESS)
+					snapshot.keys.push_back(static_cast<uint16_t>(key));
+			}
+		}
+
+		snapshot.buttons = 0;
+		for (int button = 0; button <= GLFW_MOUSE_BUTTON_LAST; button++)
+		{
+			if (glfwGetMouseButton(window, button) == GLFW_PRESS)
+				snapshot.buttons |= static_cast<uint8_t>(1u << button);
+		}
+
+		glfwGetCursorPos(window, &snapshot.cursorX, &snapshot.cursorY);
+	}
+
+	bool Save(const std::string& path, const std::vector<Snapshot>& frames)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		const RecordingHeader header = { RECORDING_MAGIC, RECORDING_VERSION, static_cast<uint32_t>(frames.size()) };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const Snapshot& snapshot : frames)
+		{
+			const uint16_t keyCount = static_cast<uint16_t>(snapshot.keys.size());
+			file.write(reinterpret_cast<const char*>(&snapshot.deltaTime), sizeof(snapshot.deltaTime));
+			file.write(reinterpret_cast<const char*>(&snapshot.cursorX), sizeof(snapshot.cursorX));
+			file.write(reinterpret_cast<const char*>(&snapshot.cursorY), sizeof(snapshot.cursorY));
+			file.write(reinterpret_cast<const char*>(&snapshot.buttons), sizeof(snapshot.buttons));
+			file.write(reinterpret_cast<const char*>(&keyCount), sizeof(keyCount));
+			if (keyCount > 0)
+				file.write(reinterpret_cast<const char*>(snapshot.keys.data()), keyCount * sizeof(uint16_t));
+		}
+		return static_cast<bool>(file);
+	}
+
+	bool Load(const std::string& path, std::vector<Snapshot>& frames)
+	{
+		std::ifstream file(path, std::ios::binary);
+		RecordingHeader header = {};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file || header.magic != RECORDING_MAGIC || header.version != RECORDING_VERSION)
+			return false;
+
+		// Every frame takes at least its fixed fields, so a frame count the
+		// rest of the file can't hold is a damaged file, not an allocation
+		const std::streamoff start = file.tellg();
+		file.seekg(0, std::ios::end);
+		const std::streamoff remaining = file.tellg() - start;
+		file.seekg(start);
+		const std::streamoff MIN_FRAME_BYTES = sizeof(float) + 2 * sizeof(double) + sizeof(uint8_t) + sizeof(uint16_t);
+		if (!file || static_cast<std::streamoff>(header.frames) > remaining / MIN_FRAME_BYTES)
+			return false;
+
+		frames.assign(header.frames, Snapshot());
+		for (Snapshot& snapshot : frames)
+		{
+			uint16_t keyCount = 0;
+			file.read(reinterpret_cast<char*>(&snapshot.deltaTime), sizeof(snapshot.deltaTime));
+			file.read(reinterpret_cast<char*>(&snapshot.cursorX), sizeof(snapshot.cursorX));
+			file.read(reinterpret_cast<char*>(&snapshot.cursorY), sizeof(snapshot.cursorY));
+			file.read(reinterpret_cast<char*>(&snapshot.buttons), sizeof(snapshot.buttons));
+			file.read(reinterpret_cast<char*>(&keyCount), sizeof(keyCount));
+			if (!file)
+				return false;
+			snapshot.keys.resize(keyCount);
+			if (keyCount > 0)
+				file.read(reinterpret_cast<char*>(snapshot.keys.data()), keyCount * sizeof(uint16_t));
+		}
+		return static_cast<bool>(file);
+	}
+}
+
+int Input::GetKey(GLFWwindow* /*window*/, int key)
+{
+	const std::vector<uint16_t>& keys = s_Input.current.keys;
+	return std::binary_search(keys.begin(), keys.end(), static_cast<uint16_t>(key)) ? GLFW_PRESS : GLFW_RELEASE;
+}
+
+int Input::GetMouseButton(GLFWwindow* /*window*/, int button)
+{
+	if (button < 0 || button > GLFW_MOUSE_BUTTON_LAST)
+		return GLFW_RELEASE;
+	return (s_Input.current.buttons >> button) & 1u ? GLFW_PRESS : GLFW_RELEASE;
+}
+
+void Input::GetCursorPos(GLFWwindow* /*window*/, double* x, double* y)
+{
+	if (x)
+		*x = s_Input.current.cursorX;
+	if (y)
+		*y = s_Input.current.cursorY;
+}
+
+float Input::BeginFrame(GLFWwindow* window, float deltaTime)
+{
+	// Last frame's, for IsActive: a release is a change too
+	const bool wasHeld = !s_Input.current.keys.empty() || s_Input.current.buttons != 0;
+	const double lastX = s_Input.current.cursorX;
+	const double lastY = s_Input.current.cursorY;
+
+	if (s_Input.mode == Mode::Replaying && !s_Input.frames.empty())
+	{
+		s_Input.current = s_Input.frames[s_Input.frame % s_Input.frames.size()];
+		s_Input.frame++;
+	}
+	else
+	{
+		TakeSnapshot(window, s_Input.current);
+		s_Input.current.deltaTime = deltaTime;
+		if (s_Input.mode == Mode::Recording)
+		{
+			if (s_Input.fixedTimestep > 0.0f)
+				s_Input.current.deltaTime = s_Input.fixedTimestep;
+			s_Input.frames.push_back(s_Input.current);
+			s_Input.frame++;
+		}
+	}
+
+	const Snapshot& current = s_Input.current;
+	s_Input.active = wasHeld || !current.keys.empty() || current.buttons != 0
+		|| current.cursorX != lastX || current.cursorY != lastY;
+	return current.deltaTime;
+}
+
+void Input::ArmRecording(const std::string& path, float fixedTimestep)
+{
+	Disarm();
+	s_Input.armed = Mode::Recording;
+	s_Input.path = path;
+	s_Input.fixedTimestep = fixedTimestep;
+}
+
+bool Input::ArmReplay(const std::string& path)
+{
+	Disarm();
+	if (!Load(path, s_Input.frames) || s_Input.frames.empty())
+	{
+		std::cerr << "Input: can't replay " << path << std::endl;
+		s_Input.frames.clear();
+		return false;
+	}
+	s_Input.armed = Mode::Replaying;
+	s_Input.path = path;
+	return true;
+}
+
+void Input::Disarm()
+{
+	OnTestEnded();
+	s_Input.armed = Mode::Live;
+	s_Input.frames.clear();
+	s_Input.frame = 0;
+}
+
+void Input::OnTestStarted()
+{
+	OnTestEnded();
+	s_Input.mode = s_Input.armed;
+	s_Input.frame = 0;
+	if (s_Input.mode == Mode::Recording)
+		s_Input.frames.clear();
+}
+
+void Input::OnTestEnded()
+{
+	if (s_Input.mode == Mode::Recording)
+	{
+		// One recording per arming
+		if (Save(s_Input.path, s_Input.frames))
+			std::cout << "Input: recorded " << s_Input.frames.size() << " frames to " << s_Input.path << std::endl;
+		else
+			std::cerr << "Input: can't write " << s_Input.path << std::endl;
+		s_Input.armed = Mode::Live;
+	}
+	s_Input.mode = Mode::Live;
+}
+
+bool Input::IsActive()
+{
+	return s_Input.active;
+}
+
+Input::Mode Input::GetMode()
+{
+	return s_Input.mode;
+}
+
+bool Input::IsArmed()
+{
+	return s_Input.armed != Mode::Live;
+}
+
+const std::string& Input::GetPath()
+{
+	return s_Input.path;
+}
+
+unsigned int Input::GetFrame()
+{
+	return s_Input.frame;
+}
+
+unsigned int Input::GetFrameCount()
+{
+	return static_cast<unsigned int>(s_Input.frames.size());
+}
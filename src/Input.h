@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+
+struct GLFWwindow;
+
+/**
+ * Input — keyboard, mouse and frame time, live or from a recording
+ *
+ * Camera and the tests used to ask GLFW for key and cursor state directly
+ * and moved by whatever the wall clock said the frame took, so no two runs
+ * of a camera-driven test followed the same path. They ask Input instead,
+ * which answers from a per-frame snapshot:
+ *
+ *     deltaTime = Input::BeginFrame(window, deltaTime);   // top of the main loop
+ *     if (Input::GetKey(window, GLFW_KEY_W) == GLFW_PRESS) ...
+ *
+ * LIVE
+ *   BeginFrame polls every key, the mouse buttons and the cursor. Every
+ *   query that frame sees the same state, and the frame time is passed
+ *   through.
+ *
+ * RECORDING
+ *   As live, but each frame's snapshot and frame time are appended to a
+ *   file (binary, see Input.cpp). A fixed timestep, if set, replaces the
+ *   measured frame time, so the recording itself doesn't depend on how
+ *   fast it was made.
+ *
+ * REPLAYING
+ *   Frame n answers with recorded frame n, and BeginFrame returns the
+ *   frame time recorded with it rather than the wall clock's, so the
+ *   same recording moves a camera along the same path on any machine, at
+ *   any frame rate. A replay that runs out starts over.
+ *
+ * Both are armed first and run for the lifetime of one test: they start
+ * when the next test opens (OnTestStarted, from the main loop or the
+ * benchmark runner) and a recording is saved when that test closes. A
+ * camera is created with its test, so recordings always start from the
+ * same pose.
+ *
+ * Only what goes through Input is recorded; ImGui reads GLFW on its own,
+ * so a slider moved while recording is not replayed.
+ */
+class Input
+{
+public:
+	enum class Mode { Live, Recording, Replaying };
+
+	// GLFW_PRESS / GLFW_RELEASE, as glfwGetKey and glfwGetMouseButton
+	static int GetKey(GLFWwindow* window, int key);
+	static int GetMouseButton(GLFWwindow* window, int button);
+	static void GetCursorPos(GLFWwindow* window, double* x, double* y);
+
+	// Takes this frame's snapshot, and returns the frame time to use
+	static float BeginFrame(GLFWwindow* window, float deltaTime);
+
+	// Whether this frame's snapshot could move anything: a key or button
+	// held or just released, or the cursor moved (see RenderOnDemand.h)
+	static bool IsActive();
+
+	// Record to / replay from `path` from the next test opened. ArmReplay
+	// loads the file now and fails if it can't be read.
+	static void ArmRecording(const std::string& path, float fixedTimestep = 0.0f);
+	static bool ArmReplay(const std::string& path);
+	// Back to live; a recording in progress is saved first
+	static void Disarm();
+
+	static void OnTestStarted();
+	static void OnTestEnded();
+
+	static Mode GetMode();
+	static bool IsArmed();
+	static const std::string& GetPath();
+	// The frame being recorded or replayed, and the recording's length
+	static unsigned int GetFrame();
+	static unsigned int GetFrameCount();
+};
@@ -0,0 +1,107 @@
+#include "InstanceBuffer.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+InstanceBuffer::InstanceBuffer(unsigned int capacity)
+	: m_RendererID(0), m_Count(0), m_Capacity(capacity > 0 ? capacity : 1), m_Mapped(false)
+{
+	GlCall(glGenBuffers(1, &m_RendererID));
+	GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+	GlCall(glBufferData(GL_ARRAY_BUFFER, m_Capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Vertex, m_RendererID, m_Capacity * sizeof(InstanceData));
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+	GlCall(glDeleteBuffers(1, &m_RendererID));
+	GLState::OnBufferDeleted(m_RendererID);
+}
+
+void InstanceBuffer::SetData(const InstanceData* data, unsigned int count)
+{
+	GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+
+	if (count > m_Capacity)
+	{
+		// Grow to the next power of two so a slowly increasing count doesn't
+		// reallocate every frame.
+		while (m_Capacity < count)
+			m_Capacity *= 2;
+	}
+
+	// Re-specifying the store with nullptr "orphans" the old one: the GPU can
+	// keep reading last frame's data while we write into fresh memory.
+	GlCall(glBufferData(GL_ARRAY_BUFFER, m_Capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Vertex, m_RendererID, m_Capacity * sizeof(InstanceData));
+	if (count > 0)
+	{
+		GlCall(glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), data));
+	}
+
+	m_Count = count;
+}
+
+InstanceData* InstanceBuffer::Map(unsigned int count)
+{
+	GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+	if (count > m_Capacity)
+	{
+		while (m_Capacity < count)
+			m_Capacity *= 2;
+		GlCall(glBufferData(GL_ARRAY_BUFFER, m_Capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW));
+		GpuMemory::TrackBuffer(GpuMemory::Category::Vertex, m_RendererID, m_Capacity * sizeof(InstanceData));
+	}
+
+	m_Count = 0;
+	if (count == 0)
+		return nullptr;
+
+	// Invalidating the whole buffer is the mapped form of orphaning
+	void* data;
+	GlCall(data = glMapBufferRange(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	m_Mapped = data != nullptr;
+	if (m_Mapped)
+		m_Count = count;
+	return static_cast<InstanceData*>(data);
+}
+
+bool InstanceBuffer::Unmap()
+{
+	if (!m_Mapped)
+		return m_Count > 0;
+
+	GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+	GLboolean intact;
+	GlCall(intact = glUnmapBuffer(GL_ARRAY_BUFFER));
+	// The store was lost while mapped (a mode switch, say): nothing to draw
+	if (!intact)
+		m_Count = 0;
+	m_Mapped = false;
+	return intact == GL_TRUE;
+}
+
+void InstanceBuffer::Reserve(unsigned int capacity)
+{
+	if (capacity <= m_Capacity)
+		return;
+
+	while (m_Capacity < capacity)
+		m_Capacity *= 2;
+
+	GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+	GlCall(glBufferData(GL_ARRAY_BUFFER, m_Capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Vertex, m_RendererID, m_Capacity * sizeof(InstanceData));
+	m_Count = 0;
+}
+
+void InstanceBuffer::Bind() const
+{
+	GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+}
+
+void InstanceBuffer::Unbind() const
+{
+	GlCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include "glm/glm.hpp"
+
+/**
+ * InstanceBuffer — per-instance data for instanced drawing
+ *
+ * glDrawElementsInstanced draws the same mesh N times in one call. The only
+ * thing that differs between the copies is gl_InstanceID, so each copy needs
+ * somewhere to look up its own transform and colour.
+ *
+ * We use instanced vertex attributes: the buffer holds one InstanceData per
+ * instance, and glVertexAttribDivisor(location, 1) tells GL to advance that
+ * attribute once per instance instead of once per vertex. The shader just
+ * declares them as ordinary inputs:
+ *
+ *     layout(location = 8)  in mat4 a_InstanceModel;   // uses locations 8..11
+ *     layout(location = 12) in vec4 a_InstanceColour;
+ *
+ * The locations are fixed well above anything a mesh layout uses (Vertex
+ * uses 0..3) so any VAO can take an instance buffer without renumbering.
+ * A mat4 attribute occupies four consecutive locations, one per column.
+ *
+ * Attach once with VertexArray::AddInstanceBuffer, then call SetData each
+ * frame the instances change and Renderer::DrawInstanced to draw them all.
+ * Arena meshes can instead share Mesh::getInstancedVertexArray(), binding
+ * each buffer to it per draw (RenderQueue does this for instanced commands).
+ *
+ * A shader that pulls its vertices (MeshArena.h) reads the instances as
+ * storage instead, an InstanceData[] at STORAGE_BINDING (std430 lays the
+ * struct out as here, 80 bytes).
+ */
+
+struct InstanceData
+{
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::vec4 colour = glm::vec4(1.0f);
+};
+
+class InstanceBuffer
+{
+public:
+	static const unsigned int MODEL_LOCATION = 8;    // 8, 9, 10, 11
+	static const unsigned int COLOUR_LOCATION = 12;
+	static const unsigned int STORAGE_BINDING = 10;
+
+	explicit InstanceBuffer(unsigned int capacity = 16);
+	~InstanceBuffer();
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+	// Upload `count` instances. Grows the GPU buffer if needed; otherwise
+	// orphans it so the driver doesn't stall on last frame's draw.
+	void SetData(const InstanceData* data, unsigned int count);
+	void SetData(const std::vector<InstanceData>& data)
+	{
+		SetData(data.data(), static_cast<unsigned int>(data.size()));
+	}
+
+	// Room for `count` instances, mapped for writing: the old store is
+	// orphaned as in SetData. Any thread may write through the pointer
+	// (see RenderQueue's parallel recording); the GL thread calls Unmap
+	// before drawing. Null if the driver refused the mapping. Unmap is
+	// false if the contents were lost meanwhile, leaving nothing to draw.
+	InstanceData* Map(unsigned int count);
+	bool Unmap();
+
+	// Grow the GPU buffer to hold at least `capacity` instances without
+	// uploading any, for buffers a shader fills (see GPUCulling.h). The
+	// buffer name stays the same, so VAOs pointing at it remain valid.
+	void Reserve(unsigned int capacity);
+
+	void Bind() const;
+	void Unbind() const;
+
+	unsigned int GetCount() const { return m_Count; }
+	unsigned int GetCapacity() const { return m_Capacity; }
+	unsigned int GetID() const { return m_RendererID; }
+
+private:
+	unsigned int m_RendererID;
+	unsigned int m_Count;
+	unsigned int m_Capacity;
+	bool m_Mapped;
+};
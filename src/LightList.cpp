@@ -0,0 +1,108 @@
+#include "LightList.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+#include <algorithm>
+
+LightList::LightList(unsigned int capacity)
+	: m_RendererID(0), m_Capacity(capacity > 0 ? capacity : 1),
+	  m_DirtyFirst(0), m_DirtyLast(0), m_Realloc(false)
+{
+	GlCall(glGenBuffers(1, &m_RendererID));
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_RendererID));
+	GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, m_Capacity * sizeof(GPULight), nullptr, GL_DYNAMIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_RendererID, m_Capacity * sizeof(GPULight));
+}
+
+LightList::~LightList()
+{
+	GlCall(glDeleteBuffers(1, &m_RendererID));
+	GLState::OnBufferDeleted(m_RendererID);
+}
+
+void LightList::MarkDirty(unsigned int first, unsigned int last)
+{
+	if (m_DirtyFirst >= m_DirtyLast)
+	{
+		m_DirtyFirst = first;
+		m_DirtyLast = last;
+		return;
+	}
+	m_DirtyFirst = std::min(m_DirtyFirst, first);
+	m_DirtyLast = std::max(m_DirtyLast, last);
+}
+
+unsigned int LightList::Add(const GPULight& light)
+{
+	unsigned int index = GetCount();
+	m_Lights.push_back(light);
+
+	if (GetCount() > m_Capacity)
+	{
+		while (m_Capacity < GetCount())
+			m_Capacity *= 2;
+		m_Realloc = true;
+	}
+
+	MarkDirty(index, index + 1);
+	return index;
+}
+
+void LightList::Set(unsigned int index, const GPULight& light)
+{
+	if (index >= GetCount())
+		return;
+	m_Lights[index] = light;
+	MarkDirty(index, index + 1);
+}
+
+void LightList::Remove(unsigned int index)
+{
+	if (index >= GetCount())
+		return;
+	m_Lights.erase(m_Lights.begin() + index);
+	// A range reaching the old last light now reaches past the end
+	m_DirtyLast = std::min(m_DirtyLast, GetCount());
+	// Everything after the removed light moved; the stale last slot is
+	// beyond the count the shader is given, so it needn't be cleared.
+	if (index < GetCount())
+		MarkDirty(index, GetCount());
+}
+
+void LightList::Clear()
+{
+	m_Lights.clear();
+	m_DirtyFirst = m_DirtyLast = 0;
+}
+
+void LightList::Upload()
+{
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_RendererID));
+
+	if (m_Realloc)
+	{
+		// Outgrew the buffer: re-specify at the new capacity and send it all
+		GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, m_Capacity * sizeof(GPULight), nullptr, GL_DYNAMIC_DRAW));
+		GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_RendererID, m_Capacity * sizeof(GPULight));
+		m_DirtyFirst = 0;
+		m_DirtyLast = GetCount();
+		m_Realloc = false;
+	}
+
+	m_DirtyLast = std::min(m_DirtyLast, GetCount());
+	if (m_DirtyFirst >= m_DirtyLast)
+		return;
+
+	const unsigned int bytes = (m_DirtyLast - m_DirtyFirst) * sizeof(GPULight);
+	GlCall(glBufferSubData(GL_SHADER_STORAGE_BUFFER, m_DirtyFirst * sizeof(GPULight), bytes, &m_Lights[m_DirtyFirst]));
+
+	m_Stats.uploads++;
+	m_Stats.bytesLastUpload = bytes;
+	m_DirtyFirst = m_DirtyLast = 0;
+}
+
+void LightList::Bind() const
+{
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, m_RendererID));
+}
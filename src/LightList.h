@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include "glm/glm.hpp"
+
+/**
+ * LightList — any number of lights in a shader storage buffer
+ *
+ * An array of uniforms (uniform Light uLights[16]) has a fixed size chosen
+ * when the shader is written, is limited by GL_MAX_FRAGMENT_UNIFORM_
+ * COMPONENTS, and every element is set with its own glUniform call through
+ * a name like "uLights[3].colour" built at runtime.
+ *
+ * A shader storage buffer has none of those limits: the shader declares an
+ * unsized array and reads however many lights the buffer holds.
+ *
+ *     struct Light { vec4 position; vec4 direction; vec4 colour; vec4 range; };
+ *     layout(std430, binding = 1) readonly buffer LightBuffer { Light u_Lights[]; };
+ *
+ * The CPU side keeps a copy of the array and remembers the lowest and
+ * highest light changed since the last Upload, so editing one light sends
+ * 64 bytes, not the whole list.
+ *
+ * Binding 1 because DrawIndirectBuffer's per-draw data already uses SSBO
+ * binding 0.
+ */
+
+// std430 layout: four vec4s, 64 bytes, no implicit padding. The w
+// components carry the scalar fields so nothing needs hand-placed padding.
+//
+// range.x bounds a point or spot light: its contribution fades smoothly to
+// zero there, so ClusteredLights can leave it out of clusters beyond it.
+// 0 (the default) is unbounded, reaching every fragment as before.
+struct GPULight
+{
+	glm::vec4 position = glm::vec4(0.0f);                     // xyz, w = type (0 point, 1 directional, 2 spot)
+	glm::vec4 direction = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f); // xyz, w = spotlight cutoff (cosine)
+	glm::vec4 colour = glm::vec4(1.0f);                       // rgb, a = intensity
+	glm::vec4 range = glm::vec4(0.0f);                        // x = radius of influence, 0 = unbounded
+};
+
+class LightList
+{
+public:
+	static const unsigned int LIGHT_BINDING = 1;
+
+	struct Stats
+	{
+		unsigned int uploads = 0;            // Upload calls that sent data
+		unsigned int bytesLastUpload = 0;
+	};
+
+	explicit LightList(unsigned int capacity = 64);
+	~LightList();
+	LightList(const LightList&) = delete;
+	LightList& operator=(const LightList&) = delete;
+
+	// Returns the new light's index.
+	unsigned int Add(const GPULight& light);
+	void Set(unsigned int index, const GPULight& light);
+	// Later lights shift down one index.
+	void Remove(unsigned int index);
+	void Clear();
+
+	const GPULight& Get(unsigned int index) const { return m_Lights[index]; }
+	unsigned int GetCount() const { return static_cast<unsigned int>(m_Lights.size()); }
+
+	// Send the changed range to the GPU (the whole list if it outgrew the
+	// buffer). Cheap to call every frame: does nothing if nothing changed.
+	void Upload();
+
+	// Attach to LIGHT_BINDING.
+	void Bind() const;
+
+	unsigned int GetID() const { return m_RendererID; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	void MarkDirty(unsigned int first, unsigned int last);
+
+	std::vector<GPULight> m_Lights;
+	unsigned int m_RendererID;
+	unsigned int m_Capacity;
+
+	// Changed range [m_DirtyFirst, m_DirtyLast), empty when first >= last
+	unsigned int m_DirtyFirst;
+	unsigned int m_DirtyLast;
+	bool m_Realloc;
+
+	Stats m_Stats;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * MappedFile — a whole file mapped read-only into memory
+ *
+ * The operating system maps the file's pages into the address space and
+ * reads them from disk (or its file cache) the first time each is touched.
+ * Nothing is copied up front, so opening a large file costs roughly the
+ * same as opening a small one, and data that is already laid out the way
+ * it is needed (see MeshCache) can be used straight from GetData().
+ *
+ * Uses mmap on POSIX and CreateFileMapping/MapViewOfFile on Windows.
+ * The mapping lasts until Close() or the destructor; pointers into it are
+ * invalid after that.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// False if the file does not exist or cannot be mapped. An empty file
+	// opens successfully with GetSize() == 0 and no data.
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return m_Open; }
+	const unsigned char* GetData() const { return m_Data; }
+	std::size_t GetSize() const { return m_Size; }
+
+private:
+	const unsigned char* m_Data = nullptr;
+	std::size_t m_Size = 0;
+	bool m_Open = false;
+
+#ifdef _WIN32
+	void* m_File = nullptr;      // HANDLE
+	void* m_Mapping = nullptr;   // HANDLE
+#endif
+};
@@ -0,0 +1,129 @@
+#include "MemoryBarriers.h"
+#include "Renderer.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	struct BarrierState
+	{
+		// Per written resource: the bits issued since its last write.
+		// Buffer and texture names are separate namespaces.
+		std::unordered_map<unsigned int, GLbitfield> buffers;
+		std::unordered_map<unsigned int, GLbitfield> textures;
+
+		// Declared for the next command
+		GLbitfield needed = 0;
+		std::vector<unsigned int> bufferWrites;
+		std::vector<unsigned int> textureWrites;
+
+		MemoryBarriers::Stats stats;
+	};
+
+	BarrierState s_Barriers;
+
+	GLbitfield BitOf(MemoryBarriers::Access access)
+	{
+		switch (access)
+		{
+		case MemoryBarriers::Access::Storage:       return GL_SHADER_STORAGE_BARRIER_BIT;
+		case MemoryBarriers::Access::Image:         return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+		case MemoryBarriers::Access::Texture:       return GL_TEXTURE_FETCH_BARRIER_BIT;
+		case MemoryBarriers::Access::Atomic:        return GL_ATOMIC_COUNTER_BARRIER_BIT;
+		case MemoryBarriers::Access::Uniform:       return GL_UNIFORM_BARRIER_BIT;
+		case MemoryBarriers::Access::VertexAttrib:  return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+		case MemoryBarriers::Access::Index:         return GL_ELEMENT_ARRAY_BARRIER_BIT;
+		case MemoryBarriers::Access::Command:       return GL_COMMAND_BARRIER_BIT;
+		case MemoryBarriers::Access::BufferUpdate:  return GL_BUFFER_UPDATE_BARRIER_BIT;
+		case MemoryBarriers::Access::TextureUpdate: return GL_TEXTURE_UPDATE_BARRIER_BIT;
+		case MemoryBarriers::Access::PixelBuffer:   return GL_PIXEL_BUFFER_BARRIER_BIT;
+		case MemoryBarriers::Access::Framebuffer:   return GL_FRAMEBUFFER_BARRIER_BIT;
+		}
+		return GL_ALL_BARRIER_BITS;
+	}
+
+	void Use(const std::unordered_map<unsigned int, GLbitfield>& written, unsigned int name, MemoryBarriers::Access access)
+	{
+		s_Barriers.stats.uses++;
+
+		// Never written by a shader, or ordered for this access already
+		const GLbitfield bit = BitOf(access);
+		auto it = written.find(name);
+		if (it == written.end() || (it->second & bit))
+		{
+			s_Barriers.stats.satisfied++;
+			return;
+		}
+		s_Barriers.needed |= bit;
+	}
+
+	unsigned int CountBits(GLbitfield bits)
+	{
+		unsigned int count = 0;
+		for (; bits; bits &= bits - 1)
+			count++;
+		return count;
+	}
+}
+
+void MemoryBarriers::WriteBuffer(unsigned int buffer)
+{
+	s_Barriers.bufferWrites.push_back(buffer);
+}
+
+void MemoryBarriers::WriteTexture(unsigned int texture)
+{
+	s_Barriers.textureWrites.push_back(texture);
+}
+
+void MemoryBarriers::UseBuffer(unsigned int buffer, Access access)
+{
+	Use(s_Barriers.buffers, buffer, access);
+}
+
+void MemoryBarriers::UseTexture(unsigned int texture, Access access)
+{
+	Use(s_Barriers.textures, texture, access);
+}
+
+void MemoryBarriers::Flush()
+{
+	if (s_Barriers.needed)
+	{
+		// Orders every store issued so far, not just the ones that asked
+		const GLbitfield barrier = s_Barriers.needed;
+		GlCall(glMemoryBarrier(barrier));
+		for (auto& entry : s_Barriers.buffers)
+			entry.second |= barrier;
+		for (auto& entry : s_Barriers.textures)
+			entry.second |= barrier;
+
+		s_Barriers.stats.barriers++;
+		s_Barriers.stats.bits += CountBits(barrier);
+		s_Barriers.needed = 0;
+	}
+
+	// The command's own stores come after its barrier
+	for (unsigned int buffer : s_Barriers.bufferWrites)
+		s_Barriers.buffers[buffer] = 0;
+	for (unsigned int texture : s_Barriers.textureWrites)
+		s_Barriers.textures[texture] = 0;
+	s_Barriers.bufferWrites.clear();
+	s_Barriers.textureWrites.clear();
+}
+
+const MemoryBarriers::Stats& MemoryBarriers::GetStats()
+{
+	return s_Barriers.stats;
+}
+
+void MemoryBarriers::OnBufferDeleted(unsigned int buffer)
+{
+	s_Barriers.buffers.erase(buffer);
+}
+
+void MemoryBarriers::OnTextureDeleted(unsigned int texture)
+{
+	s_Barriers.textures.erase(texture);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+/**
+ * MemoryBarriers — the glMemoryBarrier bits a consumer needs, and no more
+ *
+ * Shader stores (SSBO writes, imageStore, atomic counters) are incoherent:
+ * a later command that reads what they wrote has to be separated from them
+ * by a glMemoryBarrier naming how it reads. Written by hand after every
+ * dispatch, that tends to be the union of everything anything might do
+ * next: TestGPUParticles put SHADER_STORAGE | COMMAND after every stage,
+ * including the ones no indirect dispatch followed, and a barrier names a
+ * kind of access, not a buffer, so each bit stalls every later command
+ * that reads that way. Here the producer says what it wrote and the
+ * consumer how it reads:
+ *
+ *     MemoryBarriers::WriteBuffer(counters);              // the next dispatch stores to it
+ *     cull.DispatchForElements(count);                    // Flush, then glDispatchCompute
+ *
+ *     MemoryBarriers::UseBuffer(counters, MemoryBarriers::Access::Command);
+ *     MemoryBarriers::Flush();                            // -> glMemoryBarrier(GL_COMMAND_BARRIER_BIT)
+ *     glDrawArraysIndirect(...);
+ *
+ * and Flush issues one barrier with the bits whose access has not been
+ * ordered since the resource's last write, or nothing at all.
+ *
+ * TRACKING
+ *   A barrier orders every store before it, so each written buffer or
+ *   texture (separate namespaces, as in GpuMemory) keeps the bits issued
+ *   since its last write: a second consumer of the same kind costs
+ *   nothing. Writes and uses are declared for the next command and take
+ *   effect at its Flush, after its barrier: a stage that reads and writes
+ *   one buffer declares both. Resources nobody declared writing never
+ *   need a barrier (CPU updates do not), and neither do render-target
+ *   writes read by sampling, which GL orders itself (see RenderGraph).
+ *
+ * ComputeShader's Dispatch calls flush for themselves, and DispatchIndirect
+ * declares its argument buffer as a Command use; any other consuming
+ * command (a draw, a copy, a readback) calls Flush before it. A stage that
+ * is not declared here still needs its own glMemoryBarrier. GLState's
+ * OnBufferDeleted and OnTextureDeleted hooks forget the name. GL thread
+ * only.
+ */
+class MemoryBarriers
+{
+public:
+	// How a command reads what a shader stored, one glMemoryBarrier bit each
+	enum class Access
+	{
+		Storage,         // SSBO loads (GL_SHADER_STORAGE_BARRIER_BIT)
+		Image,           // imageLoad / imageStore
+		Texture,         // sampled
+		Atomic,          // atomic counter operations
+		Uniform,         // as a uniform block
+		VertexAttrib,    // as vertex attributes
+		Index,           // as an index buffer
+		Command,         // indirect draw or dispatch arguments
+		BufferUpdate,    // glBufferSubData, glCopyBufferSubData, glGetBufferSubData, mapping
+		TextureUpdate,   // glTexSubImage, glGetTexImage, copies
+		PixelBuffer,     // pack/unpack buffer for pixel transfers
+		Framebuffer      // attached and rendered to
+	};
+
+	struct Stats
+	{
+		unsigned int uses = 0;         // declared
+		unsigned int satisfied = 0;    // uses a barrier before had covered already
+		unsigned int barriers = 0;     // glMemoryBarrier calls
+		unsigned int bits = 0;         // across them
+	};
+
+	// The next command stores to it
+	static void WriteBuffer(unsigned int buffer);
+	static void WriteTexture(unsigned int texture);
+
+	// The next command reads it this way
+	static void UseBuffer(unsigned int buffer, Access access);
+	static void UseTexture(unsigned int texture, Access access);
+
+	// Before the command declared for: issue the barrier its uses need,
+	// then record its writes
+	static void Flush();
+
+	static const Stats& GetStats();
+
+	static void OnBufferDeleted(unsigned int buffer);
+	static void OnTextureDeleted(unsigned int texture);
+};
@@ -15,7 +15,15 @@
  */
 
 #include "GeometryFactory.h"
+#include "../ComputeShader.h"
+#include "../Renderer.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
 
 // =============================================================================
 // MESH FACTORY METHODS
@@ -23,34 +31,280 @@
 // These are convenience wrappers that combine vertex and index generation
 // into complete Mesh objects ready for GPU upload.
 
-std::unique_ptr<Mesh> GeometryFactory::CreateTriangle() {
+std::unique_ptr<Mesh> GeometryFactory::CreateTriangle(VertexFormat format) {
     std::vector<Vertex> vertices = GenerateTriangleVertices();
     std::vector<unsigned int> indices = GenerateTriangleIndices();
-    return std::make_unique<Mesh>(vertices, indices);
+    return std::make_unique<Mesh>(vertices, indices, format);
 }
 
-std::unique_ptr<Mesh> GeometryFactory::CreateQuad() {
+std::unique_ptr<Mesh> GeometryFactory::CreateQuad(VertexFormat format) {
     std::vector<Vertex> vertices = GenerateQuadVertices();
     std::vector<unsigned int> indices = GenerateQuadIndices();
-    return std::make_unique<Mesh>(vertices, indices);
+    return std::make_unique<Mesh>(vertices, indices, format);
 }
 
-std::unique_ptr<Mesh> GeometryFactory::CreateCube() {
+std::unique_ptr<Mesh> GeometryFactory::CreateCube(VertexFormat format) {
     std::vector<Vertex> vertices = GenerateCubeVertices();
     std::vector<unsigned int> indices = GenerateCubeIndices();
-    return std::make_unique<Mesh>(vertices, indices);
+    return std::make_unique<Mesh>(vertices, indices, format);
 }
 
-std::unique_ptr<Mesh> GeometryFactory::CreateSphere(int sectors, int stacks) {
+std::unique_ptr<Mesh> GeometryFactory::CreateSphere(int sectors, int stacks, VertexFormat format) {
     std::vector<Vertex> vertices = GenerateSphereVertices(sectors, stacks);
     std::vector<unsigned int> indices = GenerateSphereIndices(sectors, stacks);
-    return std::make_unique<Mesh>(vertices, indices);
+    return std::make_unique<Mesh>(vertices, indices, format);
 }
 
-std::unique_ptr<Mesh> GeometryFactory::CreateFullscreenQuad() {
+std::unique_ptr<Mesh> GeometryFactory::CreateGeodesicSphere(SphereBase base, int subdivisions, VertexFormat format) {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    GenerateGeodesicSphere(base, subdivisions, vertices, indices);
+    return std::make_unique<Mesh>(vertices, indices, format);
+}
+
+std::unique_ptr<Mesh> GeometryFactory::CreateFullscreenQuad(VertexFormat format) {
     std::vector<Vertex> vertices = GenerateFullscreenQuadVertices();
     std::vector<unsigned int> indices = GenerateFullscreenQuadIndices();
-    return std::make_unique<Mesh>(vertices, indices);
+    return std::make_unique<Mesh>(vertices, indices, format);
+}
+
+// =============================================================================
+// SHARED GEOMETRY REGISTRY
+// =============================================================================
+// Keyed by everything that changes the generated data. `sectors` is the
+// subdivision count for geodesic spheres. Entries are weak:
+// the registry never keeps geometry alive on its own, so closing the last
+// test that used a sphere gives its arena space back.
+
+namespace
+{
+    struct RegistryKey
+    {
+        GeometryFactory::Primitive primitive;
+        int sectors;
+        int stacks;
+        VertexFormat format;
+
+        bool operator<(const RegistryKey& other) const
+        {
+            return std::tie(primitive, sectors, stacks, format)
+                < std::tie(other.primitive, other.sectors, other.stacks, other.format);
+        }
+    };
+
+    struct RegistryState
+    {
+        std::map<RegistryKey, std::weak_ptr<const Mesh>> entries;
+        unsigned int hits = 0;
+        unsigned int misses = 0;
+    };
+
+    RegistryState s_Registry;
+}
+
+std::shared_ptr<const Mesh> GeometryFactory::GetShared(Primitive primitive, int sectors, int stacks, VertexFormat format)
+{
+    // Only spheres are tessellated; every other key ignores the counts.
+    // Subdivisions are keyed as GenerateGeodesicSphere clamps them, so
+    // counts that build the same sphere share it.
+    if (primitive == Primitive::Icosphere || primitive == Primitive::Octasphere)
+    {
+        sectors = std::min(std::max(sectors, 0), static_cast<int>(MAX_GEODESIC_SUBDIVISIONS));
+        stacks = 0;
+    }
+    else if (primitive != Primitive::Sphere)
+        sectors = stacks = 0;
+
+    const RegistryKey key{ primitive, sectors, stacks, format };
+    std::weak_ptr<const Mesh>& entry = s_Registry.entries[key];
+    if (std::shared_ptr<const Mesh> mesh = entry.lock())
+    {
+        s_Registry.hits++;
+        return mesh;
+    }
+
+    std::unique_ptr<Mesh> created;
+    switch (primitive)
+    {
+        case Primitive::Triangle:       created = CreateTriangle(format); break;
+        case Primitive::Quad:           created = CreateQuad(format); break;
+        case Primitive::Cube:           created = CreateCube(format); break;
+        case Primitive::Sphere:         created = CreateSphere(sectors, stacks, format); break;
+        case Primitive::Icosphere:      created = CreateGeodesicSphere(SphereBase::Icosahedron, sectors, format); break;
+        case Primitive::Octasphere:     created = CreateGeodesicSphere(SphereBase::Octahedron, sectors, format); break;
+        case Primitive::FullscreenQuad: created = CreateFullscreenQuad(format); break;
+    }
+
+    std::shared_ptr<const Mesh> mesh(std::move(created));
+    entry = mesh;
+    s_Registry.misses++;
+    return mesh;
+}
+
+GeometryFactory::RegistryStats GeometryFactory::GetRegistryStats()
+{
+    RegistryStats stats;
+    for (auto it = s_Registry.entries.begin(); it != s_Registry.entries.end();)
+    {
+        // Drop the entries whose geometry has gone
+        if (it->second.expired())
+        {
+            it = s_Registry.entries.erase(it);
+            continue;
+        }
+        stats.live++;
+        ++it;
+    }
+    stats.hits = s_Registry.hits;
+    stats.misses = s_Registry.misses;
+    return stats;
+}
+
+// =============================================================================
+// GPU GENERATORS
+// =============================================================================
+// The arena range is allocated uninitialised and the compute shader fills
+// it in place. SSBO bindings must start at a multiple of
+// GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, so each range is bound from
+// the aligned offset below it and the shader is told how far in it starts.
+// A bound range is also capped at GL_MAX_SHADER_STORAGE_BLOCK_SIZE, which
+// GL only promises is 2^24 bytes: a grid that needs more is made coarser.
+
+namespace
+{
+    enum Shape { SHAPE_HEIGHTFIELD = 0, SHAPE_SPHERE = 1, SHAPE_TORUS = 2 };
+
+    const unsigned int VERTEX_BINDING = 0;
+    const unsigned int INDEX_BINDING = 1;
+    const unsigned int GROUP_SIZE = 8;
+
+    struct GeneratorState
+    {
+        std::unique_ptr<ComputeShader> shader;   // built by the first GPU generator
+        int alignment = 0;                       // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+        unsigned int maxBlockSize = 0;           // GL_MAX_SHADER_STORAGE_BLOCK_SIZE
+    };
+
+    GeneratorState s_Generator;
+
+    void QueryStorageLimits()
+    {
+        if (s_Generator.alignment != 0)
+            return;
+        GLint64 maxBlockSize = 0;
+        GlCall(glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &s_Generator.alignment));
+        GlCall(glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize));
+        s_Generator.alignment = std::max(s_Generator.alignment, 4);
+        s_Generator.maxBlockSize = static_cast<unsigned int>(std::min<GLint64>(maxBlockSize, UINT32_MAX));
+    }
+
+    // Whether a columns x rows grid's vertices and indices each fit one
+    // storage block, with the alignment slack BindStorageRange adds
+    bool GridFits(int columns, int rows, unsigned int stride)
+    {
+        const uint64_t slack = static_cast<uint64_t>(s_Generator.alignment);
+        const uint64_t vertexBytes = static_cast<uint64_t>(columns + 1) * (rows + 1) * stride;
+        const uint64_t indexBytes = static_cast<uint64_t>(columns) * rows * 6 * sizeof(unsigned int);
+        return std::max(vertexBytes, indexBytes) + slack <= s_Generator.maxBlockSize;
+    }
+
+    // Bind bytes [offset, offset + size) of `buffer` at `binding`; returns
+    // how many uints into the bound block `offset` is
+    int BindStorageRange(unsigned int binding, unsigned int buffer, unsigned int offset, unsigned int size)
+    {
+        const unsigned int start = offset - offset % static_cast<unsigned int>(s_Generator.alignment);
+        GlCall(glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, buffer, start, offset + size - start));
+        return static_cast<int>((offset - start) / sizeof(unsigned int));
+    }
+}
+
+std::unique_ptr<Mesh> GeometryFactory::CreateSphereGPU(int sectors, int stacks, float radius, VertexFormat format) {
+    SurfaceParams surface = { SHAPE_SPHERE, radius, 0.0f, 0.0f, 0 };
+    Bounds bounds = Bounds::FromMinMax(glm::vec3(-radius), glm::vec3(radius));
+    return GenerateGridGPU(surface, sectors, stacks, bounds, format);
+}
+
+std::unique_ptr<Mesh> GeometryFactory::CreateTorusGPU(int rings, int sides, float ringRadius, float tubeRadius,
+    VertexFormat format) {
+    SurfaceParams surface = { SHAPE_TORUS, ringRadius, tubeRadius, 0.0f, 0 };
+    const float outer = ringRadius + tubeRadius;
+    Bounds bounds = Bounds::FromMinMax(glm::vec3(-outer, -tubeRadius, -outer), glm::vec3(outer, tubeRadius, outer));
+    return GenerateGridGPU(surface, rings, sides, bounds, format);
+}
+
+std::unique_ptr<Mesh> GeometryFactory::CreatePlaneGPU(int divisions, float size, VertexFormat format) {
+    return CreateTerrainGPU(divisions, size, 0.0f, 0.0f, 0, format);
+}
+
+std::unique_ptr<Mesh> GeometryFactory::CreateTerrainGPU(int divisions, float size, float height, float frequency,
+    int octaves, VertexFormat format) {
+    SurfaceParams surface = { SHAPE_HEIGHTFIELD, size, height, frequency, octaves };
+    // The fbm is normalised to 0..1, so the heights stay within 0..height
+    const float half = size * 0.5f;
+    Bounds bounds = Bounds::FromMinMax(glm::vec3(-half, 0.0f, -half), glm::vec3(half, height, half));
+    return GenerateGridGPU(surface, divisions, divisions, bounds, format);
+}
+
+std::unique_ptr<Mesh> GeometryFactory::GenerateGridGPU(const SurfaceParams& surface, int columns, int rows,
+    const Bounds& bounds, VertexFormat format) {
+    columns = std::max(columns, 1);
+    rows = std::max(rows, 1);
+
+    // Halve the longer side until both ranges can be bound
+    MeshArena& arena = MeshArena::Get(format);
+    const unsigned int stride = arena.GetVertexStride();
+    QueryStorageLimits();
+    if (!GridFits(columns, rows, stride))
+    {
+        const int requestedColumns = columns;
+        const int requestedRows = rows;
+        while (!GridFits(columns, rows, stride) && (columns > 1 || rows > 1))
+        {
+            if (columns >= rows)
+                columns = std::max(columns / 2, 1);
+            else
+                rows = std::max(rows / 2, 1);
+        }
+        std::cout << "WARNING:: A " << requestedColumns << "x" << requestedRows << " GPU grid exceeds "
+                  << s_Generator.maxBlockSize << " bytes per storage block; generating " << columns << "x" << rows << "\n";
+    }
+
+    const unsigned int vertexCount = static_cast<unsigned int>((columns + 1) * (rows + 1));
+    const unsigned int indexCount = static_cast<unsigned int>(columns * rows * 6);
+
+    MeshArena::Handle handle = arena.AllocateUninitialised(vertexCount, indexCount);
+    if (handle == MeshArena::INVALID_HANDLE)
+        return nullptr;
+    const MeshArena::Range& range = arena.GetRange(handle);
+
+    if (!s_Generator.shader)
+        s_Generator.shader = std::make_unique<ComputeShader>("res/Shaders/Mesh/ProceduralMesh.glsl");
+    ComputeShader& generator = *s_Generator.shader;
+    generator.Bind();
+    generator.setUniform1i("u_Shape", surface.shape);
+    generator.setUniform1i("u_Columns", columns);
+    generator.setUniform1i("u_Rows", rows);
+    generator.setUniform1i("u_Packed", format == VertexFormat::Packed ? 1 : 0);
+    generator.setUniform1f("u_Size", surface.size);
+    generator.setUniform1f("u_Height", surface.height);
+    generator.setUniform1f("u_Frequency", surface.frequency);
+    generator.setUniform1i("u_Octaves", surface.octaves);
+    generator.setUniform1i("u_VertexOffset", BindStorageRange(VERTEX_BINDING, arena.GetVertexBuffer().GetID(),
+        range.baseVertex * stride, vertexCount * stride));
+    generator.setUniform1i("u_IndexOffset", BindStorageRange(INDEX_BINDING, arena.GetIndexBuffer().GetID(),
+        range.firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int)));
+
+    generator.Dispatch((columns + GROUP_SIZE) / GROUP_SIZE, (rows + GROUP_SIZE) / GROUP_SIZE, 1);
+
+    // Drawn from next, and moved by glCopyBufferSubData if the arena
+    // defragments or grows
+    GlCall(glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT));
+
+    return std::make_unique<Mesh>(handle, bounds, format);
+}
+
+void GeometryFactory::Shutdown() {
+    s_Generator = GeneratorState();
 }
 
 // =============================================================================
@@ -394,6 +648,247 @@ std::vector<unsigned int> GeometryFactory::GenerateSphereIndices(int sectors, in
     return indices;
 }
 
+// =============================================================================
+// GEODESIC SPHERES (ICOSPHERE / OCTASPHERE)
+// =============================================================================
+/**
+ * WHY NOT ALWAYS A UV SPHERE:
+ *
+ * Every stack of a UV sphere has the same number of sectors, so the quads
+ * shrink towards the poles: near them, triangles are thin slivers that add
+ * vertex work without making the silhouette any rounder. How round a sphere
+ * looks is set by its LONGEST edges (those on the equator), and every other
+ * edge is shorter than it needs to be.
+ *
+ * A geodesic sphere starts from a regular solid whose vertices lie on the
+ * sphere and repeatedly splits each triangle into four at its edge
+ * midpoints, pushing the new vertices out onto the surface:
+ *
+ *          a                     a
+ *         / \                   / \
+ *        /   \                ab---ca
+ *       /     \      ->       / \ / \
+ *      b-------c              b---bc--c
+ *
+ * The triangles stay close to equal in size everywhere, so for the same
+ * longest edge it needs far fewer of them. Two bases:
+ *   - icosahedron: 20 faces, the most even triangles
+ *   - octahedron: 8 faces, one vertex on each axis, so the octants (and
+ *     the UV seam) line up with the axes
+ *
+ * SHARED MIDPOINTS:
+ * Both triangles either side of an edge need its midpoint. The midpoints
+ * are kept in a map keyed by the edge's two vertex indices, so each is
+ * created once and shared, as the vertices of a closed mesh should be
+ * (no cracks, and smooth normals without any averaging).
+ *
+ * ERROR:
+ * The gap between a straight edge of angle α and the sphere is its
+ * sagitta, r × (1 - cos(α / 2)). GetGeodesicSphereError measures the
+ * longest edge of a generated level (subdivision shrinks edges unevenly, so
+ * halving the base edge angle each level is only an estimate) and keeps it
+ * per level; for a UV sphere the longest edges are the equator's 2π/sectors.
+ *
+ * Levels go up four times in triangles, so one base alone often lands far
+ * past a target: SelectGeodesicSphere tries both and keeps the cheaper. For
+ * a 20 x 20 UV sphere's error (0.0123) that is an octasphere of 3
+ * subdivisions (0.0114, 512 triangles); for 32 x 32 (0.0048) an icosphere
+ * of 3 (0.0034, 1280 triangles against 1984).
+ */
+
+namespace
+{
+    // Geodesic sphere errors per level, measured once (0: not yet)
+    float s_GeodesicErrors[2][GeometryFactory::MAX_GEODESIC_SUBDIVISIONS + 1] = {};
+
+    float EdgeError(const Vertex& a, const Vertex& b)
+    {
+        // Unit vectors: the dot product is cos α, and cos(α / 2) follows
+        const float cosine = a.normal[0] * b.normal[0] + a.normal[1] * b.normal[1] + a.normal[2] * b.normal[2];
+        return 1.0f - std::sqrt(std::max(0.0f, 0.5f * (1.0f + cosine)));
+    }
+}
+
+void GeometryFactory::GenerateGeodesicSphere(SphereBase base, int subdivisions,
+    std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    subdivisions = std::min(std::max(subdivisions, 0), static_cast<int>(MAX_GEODESIC_SUBDIVISIONS));
+
+    // Unit-length positions first; radius and the other attributes at the end
+    std::vector<glm::vec3> points;
+    if (base == SphereBase::Octahedron) {
+        points = { { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 }, { -1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } };
+        // Counter-clockwise from outside: the top four around +Y, then the bottom four
+        indices = { 0, 2, 1,  0, 3, 2,  0, 4, 3,  0, 1, 4,
+                    5, 1, 2,  5, 2, 3,  5, 3, 4,  5, 4, 1 };
+    }
+    else {
+        // A vertex on each pole and two rings of five between them, the
+        // lower ring turned by 36 degrees: y = ±1/√5 on a circle of 2/√5
+        const float PI = 3.14159265359f;
+        const float ringY = 1.0f / std::sqrt(5.0f);
+        const float ringRadius = 2.0f / std::sqrt(5.0f);
+        points.push_back({ 0.0f, 1.0f, 0.0f });
+        for (int i = 0; i < 5; ++i) {
+            const float angle = 2.0f * PI * i / 5.0f;
+            points.push_back({ ringRadius * std::cos(angle), ringY, ringRadius * std::sin(angle) });
+        }
+        for (int i = 0; i < 5; ++i) {
+            const float angle = 2.0f * PI * (i + 0.5f) / 5.0f;
+            points.push_back({ ringRadius * std::cos(angle), -ringY, ringRadius * std::sin(angle) });
+        }
+        points.push_back({ 0.0f, -1.0f, 0.0f });
+
+        indices.clear();
+        for (unsigned int i = 0; i < 5; ++i) {
+            const unsigned int upper = 1 + i, upperNext = 1 + (i + 1) % 5;
+            const unsigned int lower = 6 + i, lowerNext = 6 + (i + 1) % 5;
+            // Top cap, the band between the rings, bottom cap
+            indices.insert(indices.end(), { 0, upperNext, upper });
+            indices.insert(indices.end(), { upper, upperNext, lower });
+            indices.insert(indices.end(), { upperNext, lowerNext, lower });
+            indices.insert(indices.end(), { 11, lower, lowerNext });
+        }
+    }
+
+    for (int level = 0; level < subdivisions; ++level) {
+        std::unordered_map<uint64_t, unsigned int> midpoints;
+        auto midpoint = [&](unsigned int a, unsigned int b) {
+            const uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+            auto found = midpoints.find(key);
+            if (found != midpoints.end())
+                return found->second;
+            const unsigned int index = static_cast<unsigned int>(points.size());
+            points.push_back(glm::normalize(points[a] + points[b]));
+            midpoints.emplace(key, index);
+            return index;
+        };
+
+        std::vector<unsigned int> divided;
+        divided.reserve(indices.size() * 4);
+        for (std::size_t t = 0; t < indices.size(); t += 3) {
+            const unsigned int a = indices[t], b = indices[t + 1], c = indices[t + 2];
+            const unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            // Same winding as the parent
+            divided.insert(divided.end(), { a, ab, ca,  ab, b, bc,  ca, bc, c,  ab, bc, ca });
+        }
+        indices.swap(divided);
+    }
+
+    // Same radius, UVs and colours as the UV sphere
+    const float radius = 0.5f;
+    const float PI = 3.14159265359f;
+    vertices.clear();
+    vertices.reserve(points.size());
+    for (const glm::vec3& p : points) {
+        float u = std::atan2(p.z, p.x) / (2.0f * PI);
+        if (u < 0.0f)
+            u += 1.0f;
+        const float v = std::acos(std::min(std::max(p.y, -1.0f), 1.0f)) / PI;
+        vertices.emplace_back(radius * p.x, radius * p.y, radius * p.z, p.x, p.y, p.z,
+            (p.x + 1.0f) * 0.5f, (p.y + 1.0f) * 0.5f, (p.z + 1.0f) * 0.5f, u, v);
+    }
+
+    FixSphereSeam(vertices, indices);
+}
+
+/**
+ * UV SEAM:
+ * u = θ / 2π jumps from 1 back to 0 where θ wraps. A triangle across that
+ * line would interpolate u through the whole texture the wrong way, so its
+ * vertices on the u ≈ 0 side are swapped for copies at u + 1 (one copy per
+ * vertex, shared by every straddling triangle). A pole has no θ at all:
+ * each triangle touching one gets its own copy of the pole, with u half way
+ * between the triangle's other two vertices, just as the pole of a UV
+ * sphere is a row of vertices.
+ */
+void GeometryFactory::FixSphereSeam(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    std::unordered_map<unsigned int, unsigned int> wrapped;
+    const std::size_t originalCount = vertices.size();
+
+    for (std::size_t t = 0; t < indices.size(); t += 3) {
+        unsigned int* triangle = &indices[t];
+        auto isPole = [&](unsigned int index) { return std::abs(vertices[index].normal[1]) > 0.99999f; };
+
+        float minU = 1.0f, maxU = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            if (isPole(triangle[k]))
+                continue;
+            minU = std::min(minU, vertices[triangle[k]].texCoords[0]);
+            maxU = std::max(maxU, vertices[triangle[k]].texCoords[0]);
+        }
+
+        if (maxU - minU > 0.5f) {
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int index = triangle[k];
+                if (isPole(index) || vertices[index].texCoords[0] >= 0.5f)
+                    continue;
+                auto found = wrapped.find(index);
+                if (found == wrapped.end()) {
+                    Vertex copy = vertices[index];
+                    copy.texCoords[0] += 1.0f;
+                    vertices.push_back(copy);
+                    found = wrapped.emplace(index, static_cast<unsigned int>(vertices.size() - 1)).first;
+                }
+                triangle[k] = found->second;
+            }
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            if (!isPole(triangle[k]) || triangle[k] >= originalCount)
+                continue;
+            const float u0 = vertices[triangle[(k + 1) % 3]].texCoords[0];
+            const float u1 = vertices[triangle[(k + 2) % 3]].texCoords[0];
+            Vertex copy = vertices[triangle[k]];
+            copy.texCoords[0] = 0.5f * (u0 + u1);
+            vertices.push_back(copy);
+            triangle[k] = static_cast<unsigned int>(vertices.size() - 1);
+        }
+    }
+}
+
+float GeometryFactory::GetUVSphereError(int sectors, int stacks) {
+    // Equator edges span 2π / sectors, meridian edges π / stacks
+    const float PI = 3.14159265359f;
+    const float longest = std::max(2.0f * PI / std::max(sectors, 3), PI / std::max(stacks, 2));
+    return 1.0f - std::cos(0.5f * longest);
+}
+
+float GeometryFactory::GetGeodesicSphereError(SphereBase base, int subdivisions) {
+    subdivisions = std::min(std::max(subdivisions, 0), static_cast<int>(MAX_GEODESIC_SUBDIVISIONS));
+    float& error = s_GeodesicErrors[base == SphereBase::Octahedron ? 1 : 0][subdivisions];
+    if (error > 0.0f)
+        return error;
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    GenerateGeodesicSphere(base, subdivisions, vertices, indices);
+    for (std::size_t t = 0; t < indices.size(); t += 3) {
+        for (int k = 0; k < 3; ++k)
+            error = std::max(error, EdgeError(vertices[indices[t + k]], vertices[indices[t + (k + 1) % 3]]));
+    }
+    return error;
+}
+
+unsigned int GeometryFactory::GetGeodesicTriangleCount(SphereBase base, int subdivisions) {
+    subdivisions = std::min(std::max(subdivisions, 0), static_cast<int>(MAX_GEODESIC_SUBDIVISIONS));
+    return (base == SphereBase::Octahedron ? 8u : 20u) << (2 * subdivisions);
+}
+
+GeometryFactory::GeodesicLevel GeometryFactory::SelectGeodesicSphere(float maxError) {
+    GeodesicLevel best = { SphereBase::Icosahedron, MAX_GEODESIC_SUBDIVISIONS };
+    for (SphereBase base : { SphereBase::Icosahedron, SphereBase::Octahedron }) {
+        for (int subdivisions = 0; subdivisions <= MAX_GEODESIC_SUBDIVISIONS; ++subdivisions) {
+            if (GetGeodesicTriangleCount(base, subdivisions) >= GetGeodesicTriangleCount(best.base, best.subdivisions))
+                break;
+            if (GetGeodesicSphereError(base, subdivisions) <= maxError) {
+                best = { base, subdivisions };
+                break;
+            }
+        }
+    }
+    return best;
+}
+
 // =============================================================================
 // FULLSCREEN QUAD (Post-Processing)
 // =============================================================================
@@ -1,16 +1,108 @@
 #pragma once
 
 #include "Mesh.h"
+#include <memory>
 #include <vector>
 
 class GeometryFactory {
 public:
-    // Basic primitive generators
-    static std::unique_ptr<Mesh> CreateTriangle();
-    static std::unique_ptr<Mesh> CreateQuad();
-    static std::unique_ptr<Mesh> CreateCube();
-    static std::unique_ptr<Mesh> CreateSphere(int sectors = 20, int stacks = 20);
-    static std::unique_ptr<Mesh> CreateFullscreenQuad();
+    enum class Primitive { Triangle, Quad, Cube, Sphere, Icosphere, Octasphere, FullscreenQuad };
+
+    // What a geodesic sphere is subdivided from, see GenerateGeodesicSphere
+    enum class SphereBase { Icosahedron, Octahedron };
+    static const int MAX_GEODESIC_SUBDIVISIONS = 7;
+
+    struct GeodesicLevel
+    {
+        SphereBase base;
+        int subdivisions;
+    };
+
+    struct RegistryStats
+    {
+        unsigned int live = 0;     // distinct geometries currently shared
+        unsigned int hits = 0;     // GetShared calls answered from the registry
+        unsigned int misses = 0;   // GetShared calls that generated and uploaded
+    };
+
+    // Basic primitive generators. `format` picks the GPU vertex layout
+    // (see PackedVertex.h); the standard one is the default.
+    static std::unique_ptr<Mesh> CreateTriangle(VertexFormat format = VertexFormat::Standard);
+    static std::unique_ptr<Mesh> CreateQuad(VertexFormat format = VertexFormat::Standard);
+    static std::unique_ptr<Mesh> CreateCube(VertexFormat format = VertexFormat::Standard);
+    static std::unique_ptr<Mesh> CreateSphere(int sectors = 20, int stacks = 20, VertexFormat format = VertexFormat::Standard);
+    static std::unique_ptr<Mesh> CreateFullscreenQuad(VertexFormat format = VertexFormat::Standard);
+
+    // Geodesic spheres, radius 0.5 like CreateSphere: evenly sized
+    // triangles, so none are spent bunched up at the poles. Each
+    // subdivision quarters every triangle.
+    static std::unique_ptr<Mesh> CreateGeodesicSphere(SphereBase base, int subdivisions,
+        VertexFormat format = VertexFormat::Standard);
+    static std::unique_ptr<Mesh> CreateGeodesicSphere(const GeodesicLevel& level, VertexFormat format = VertexFormat::Standard)
+    {
+        return CreateGeodesicSphere(level.base, level.subdivisions, format);
+    }
+
+    // Silhouette error of a sphere: the largest gap between an edge and the
+    // surface, as a fraction of the radius. SelectGeodesicSphere picks the
+    // base and subdivisions with the fewest triangles within maxError, so
+    //     SelectGeodesicSphere(GetUVSphereError(20, 20))
+    // looks as round as CreateSphere(20, 20) (an octasphere of 512
+    // triangles against 760).
+    static float GetUVSphereError(int sectors, int stacks);
+    static float GetGeodesicSphereError(SphereBase base, int subdivisions);
+    static GeodesicLevel SelectGeodesicSphere(float maxError);
+    static unsigned int GetGeodesicTriangleCount(SphereBase base, int subdivisions);
+
+    // Shared geometry registry. Identical primitives (same type,
+    // tessellation and format) are generated and uploaded once and handed
+    // out as the same immutable Mesh for as long as anyone holds it; the
+    // registry only keeps a weak reference, so the arena range is freed
+    // with the last holder. Nothing may move or modify a shared mesh:
+    // transforms live with whoever draws it (Scene entities, InstanceData),
+    // which is what instancing wants anyway. `sectors`/`stacks` only
+    // matter for spheres. Main thread only.
+    static std::shared_ptr<const Mesh> GetShared(Primitive primitive, int sectors = 20, int stacks = 20,
+        VertexFormat format = VertexFormat::Standard);
+    static std::shared_ptr<const Mesh> GetSharedCube(VertexFormat format = VertexFormat::Standard)
+    {
+        return GetShared(Primitive::Cube, 0, 0, format);
+    }
+    static std::shared_ptr<const Mesh> GetSharedSphere(int sectors = 20, int stacks = 20, VertexFormat format = VertexFormat::Standard)
+    {
+        return GetShared(Primitive::Sphere, sectors, stacks, format);
+    }
+    static std::shared_ptr<const Mesh> GetSharedGeodesicSphere(const GeodesicLevel& level,
+        VertexFormat format = VertexFormat::Standard)
+    {
+        return GetShared(level.base == SphereBase::Octahedron ? Primitive::Octasphere : Primitive::Icosphere,
+            level.subdivisions, 0, format);
+    }
+    static RegistryStats GetRegistryStats();
+
+    // Releases the GPU generators' compute shader; before the GL context goes
+    static void Shutdown();
+
+    // GPU generators. A compute shader (res/Shaders/Mesh/ProceduralMesh.glsl)
+    // writes the vertices, normals included, and indices straight into a
+    // MeshArena range, so a million-vertex grid costs one dispatch: no CPU
+    // generation, no upload, and no CPU copy afterwards (getVertices() is
+    // empty, so no LODs or CPU picking either). Bounds are analytic.
+    // Every shape is one (columns + 1) x (rows + 1) vertex grid: the sphere
+    // keeps its degenerate pole triangles, unlike CreateSphere. A grid too
+    // big for one GL_MAX_SHADER_STORAGE_BLOCK_SIZE block is generated with
+    // its longer side halved until it fits, with a warning.
+    static std::unique_ptr<Mesh> CreateSphereGPU(int sectors, int stacks, float radius = 0.5f,
+        VertexFormat format = VertexFormat::Standard);
+    static std::unique_ptr<Mesh> CreateTorusGPU(int rings, int sides, float ringRadius = 0.5f, float tubeRadius = 0.2f,
+        VertexFormat format = VertexFormat::Standard);
+    // A subdivided plane on XZ, `size` across and facing +Y
+    static std::unique_ptr<Mesh> CreatePlaneGPU(int divisions, float size = 1.0f,
+        VertexFormat format = VertexFormat::Standard);
+    // The plane displaced by fbm value noise: heights 0..height, `frequency`
+    // noise cells per unit, normals from the height function's gradient
+    static std::unique_ptr<Mesh> CreateTerrainGPU(int divisions, float size, float height, float frequency = 0.05f,
+        int octaves = 5, VertexFormat format = VertexFormat::Standard);
 
     // Utility methods for vertex data management
     static std::vector<Vertex> GenerateTriangleVertices();
@@ -18,6 +110,10 @@ public:
     static std::vector<Vertex> GenerateCubeVertices();
     static std::vector<Vertex> GenerateSphereVertices(int sectors = 20, int stacks = 20);
     static std::vector<Vertex> GenerateFullscreenQuadVertices();
+    // Vertices and indices together: the midpoints are shared between the
+    // triangles either side of an edge
+    static void GenerateGeodesicSphere(SphereBase base, int subdivisions,
+        std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
 
     // Index buffer generation
     static std::vector<unsigned int> GenerateTriangleIndices();
@@ -31,4 +127,20 @@ private:
     static void AssignUVCoordinates(std::vector<Vertex>& vertices, int faceVertexCount);
     static void AssignColors(std::vector<Vertex>& vertices);
     static void CalculateNormals(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+
+    // Duplicate the vertices of triangles that straddle the u = 0/1 seam
+    // or touch a pole, so the UVs interpolate without wrapping backwards
+    static void FixSphereSeam(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    // The shader's surface parameters, see ProceduralMesh.glsl
+    struct SurfaceParams
+    {
+        int shape;
+        float size;
+        float height;
+        float frequency;
+        int octaves;
+    };
+    static std::unique_ptr<Mesh> GenerateGridGPU(const SurfaceParams& surface, int columns, int rows,
+        const Bounds& bounds, VertexFormat format);
 };
\ No newline at end of file
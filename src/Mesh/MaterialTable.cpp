@@ -0,0 +1,186 @@
+#include "MaterialTable.h"
+#include "../Renderer.h"
+#include "../GLState.h"
+#include "../GpuMemory.h"
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <iostream>
+
+static MaterialTable::Mode s_RequestedMode = MaterialTable::Mode::Bindless;
+
+MaterialTable::~MaterialTable()
+{
+	Release();
+}
+
+void MaterialTable::AddMaterial(const std::vector<MeshTexture>& textures)
+{
+	Material material;
+	for (const MeshTexture& texture : textures)
+	{
+		if (!material.diffuse && texture.type == "texture_diffuse")
+			material.diffuse = texture.texture;
+		else if (!material.specular && texture.type == "texture_specular")
+			material.specular = texture.texture;
+	}
+	m_Materials.push_back(material);
+}
+
+MaterialTable::Mode MaterialTable::Update()
+{
+	Mode target = s_RequestedMode;
+	if (target == Mode::Bindless && !IsBindlessSupported())
+		target = Mode::Array;
+	if (target == m_Attempted)
+		return m_Mode;
+
+	if (target == Mode::Bound)
+	{
+		Release();
+		m_Mode = m_Attempted = Mode::Bound;
+		return m_Mode;
+	}
+
+	// Not yet: a placeholder's handle or copy would outlive its replacement
+	if (!IsLoaded())
+		return m_Mode;
+
+	Release();
+	std::vector<GpuMaterial> table(m_Materials.size());
+	const bool built = target == Mode::Bindless ? BuildBindless(table) : BuildArray(table);
+	m_Attempted = target;
+	if (!built)
+	{
+		Release();
+		m_Mode = Mode::Bound;
+		return m_Mode;
+	}
+
+	GlCall(glGenBuffers(1, &m_Buffer));
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Buffer));
+	GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, table.size() * sizeof(GpuMaterial), table.data(), GL_STATIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_Buffer, table.size() * sizeof(GpuMaterial));
+	GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+
+	m_Material.id = m_Buffer;
+	m_Material.tableBuffer = m_Buffer;
+	if (m_Array.IsValid())
+	{
+		m_Material.arrayTextures = true;
+		m_Material.textureCount = 1;
+		m_Material.textures[0] = m_Array.GetID();
+		m_Material.samplerNames[0] = "u_MaterialTextures";
+	}
+
+	m_Mode = target;
+	std::cout << "MaterialTable::Update() - " << m_Materials.size() << " material(s), "
+		<< GetModeName(m_Mode) << "\n";
+	return m_Mode;
+}
+
+bool MaterialTable::IsLoaded() const
+{
+	for (const Material& material : m_Materials)
+	{
+		if ((material.diffuse && !material.diffuse->IsLoaded()) || (material.specular && !material.specular->IsLoaded()))
+			return false;
+	}
+	return true;
+}
+
+bool MaterialTable::BuildBindless(std::vector<GpuMaterial>& table)
+{
+	for (std::size_t m = 0; m < m_Materials.size(); ++m)
+	{
+		const Material& material = m_Materials[m];
+		if (material.diffuse)
+		{
+			table[m].diffuse = material.diffuse->GetBindlessHandle();
+			table[m].flags |= HAS_DIFFUSE;
+		}
+		if (material.specular)
+		{
+			table[m].specular = material.specular->GetBindlessHandle();
+			table[m].flags |= HAS_SPECULAR;
+		}
+		if ((material.diffuse && !table[m].diffuse) || (material.specular && !table[m].specular))
+			return false;
+	}
+	return true;
+}
+
+bool MaterialTable::BuildArray(std::vector<GpuMaterial>& table)
+{
+	// One layer per distinct texture; materials sharing one share the layer
+	std::vector<const Texture*> layers;
+	auto layerOf = [&layers](const Texture* texture)
+		{
+			auto it = std::find(layers.begin(), layers.end(), texture);
+			if (it != layers.end())
+				return static_cast<int32_t>(it - layers.begin());
+			layers.push_back(texture);
+			return static_cast<int32_t>(layers.size() - 1);
+		};
+
+	for (std::size_t m = 0; m < m_Materials.size(); ++m)
+	{
+		const Material& material = m_Materials[m];
+		if (material.diffuse)
+		{
+			table[m].diffuseLayer = layerOf(material.diffuse.get());
+			table[m].flags |= HAS_DIFFUSE;
+		}
+		if (material.specular)
+		{
+			table[m].specularLayer = layerOf(material.specular.get());
+			table[m].flags |= HAS_SPECULAR;
+		}
+	}
+	if (layers.empty())
+		return true;
+
+	if (!m_Array.Build(layers))
+	{
+		std::cout << "MaterialTable::BuildArray() - textures differ in size or format, staying bound\n";
+		return false;
+	}
+	return true;
+}
+
+void MaterialTable::Release()
+{
+	if (m_Buffer)
+	{
+		GlCall(glDeleteBuffers(1, &m_Buffer));
+		GLState::OnBufferDeleted(m_Buffer);
+		m_Buffer = 0;
+	}
+	m_Array.Release();
+	m_Material = RenderMaterial();
+}
+
+bool MaterialTable::IsBindlessSupported()
+{
+	return GLEW_ARB_bindless_texture;
+}
+
+MaterialTable::Mode MaterialTable::GetRequestedMode()
+{
+	return s_RequestedMode;
+}
+
+void MaterialTable::SetRequestedMode(Mode mode)
+{
+	s_RequestedMode = mode;
+}
+
+const char* MaterialTable::GetModeName(Mode mode)
+{
+	switch (mode)
+	{
+	case Mode::Bindless: return "BINDLESS";
+	case Mode::Array:    return "ARRAY";
+	default:             return "BOUND";
+	}
+}
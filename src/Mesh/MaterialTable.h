@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ModelMesh.h"
+#include "../RenderQueue.h"
+#include "../TextureArray.h"
+
+/**
+ * MaterialTable — every material of a Model in one GPU table
+ *
+ * Model::Draw issues one glMultiDrawElementsIndirect per material group and
+ * rebinds textures in between, because a sampler uniform can only point at
+ * one texture at a time. The table removes that limit: it holds each
+ * material's textures in an SSBO (binding RenderMaterial::TABLE_BINDING),
+ * and the shader picks the entry with the draw's material index, which the
+ * DrawIndirectBuffer already stores per draw. The whole model is then one
+ * call, whatever the number of materials.
+ *
+ * MODES (the MATERIAL variant of MeshIndirect.shader)
+ *   Bindless  GL_ARB_bindless_texture: each texture made resident once, its
+ *             64-bit handle in the table. The shader turns the handle back
+ *             into a sampler2D. Nothing is bound per model at all.
+ *   Array     Without bindless: every texture copied (glCopyImageSubData,
+ *             all mips) into a layer of one TextureArray, the layer
+ *             in the table. Needs every texture of the model to share one
+ *             size and format; the copy costs the same memory again.
+ *   Bound     The old path, per group. Used until the table is built, and
+ *             whenever Array is not possible.
+ *
+ * Update builds the table once every texture has finished loading (a
+ * streamed texture is replaced in place, which a bindless handle or an
+ * array copy would not follow), so Model::prepareMaterials returns Bound
+ * for the first frames and switches when the images are in.
+ */
+class MaterialTable
+{
+public:
+	enum class Mode { Bound, Bindless, Array };
+
+	enum Flags : uint32_t
+	{
+		HAS_DIFFUSE  = 1,
+		HAS_SPECULAR = 2
+	};
+
+	// Matches MaterialData in MeshIndirect.shader (std430, 32 bytes)
+	struct GpuMaterial
+	{
+		uint64_t diffuse = 0;          // bindless handles
+		uint64_t specular = 0;
+		int32_t  diffuseLayer = 0;     // texture array layers
+		int32_t  specularLayer = 0;
+		uint32_t flags = 0;
+		uint32_t padding = 0;
+	};
+
+	MaterialTable() = default;
+	~MaterialTable();
+	MaterialTable(const MaterialTable&) = delete;
+	MaterialTable& operator=(const MaterialTable&) = delete;
+
+	// Appends a material; its index is the number added before it. The
+	// first texture_diffuse and texture_specular are used.
+	void AddMaterial(const std::vector<MeshTexture>& textures);
+
+	// (Re)builds the table for GetRequestedMode when that changed and every
+	// texture is loaded. Returns the mode now in effect.
+	Mode Update();
+
+	Mode GetMode() const { return m_Mode; }
+	std::size_t GetMaterialCount() const { return m_Materials.size(); }
+
+	// Bind this (with the shader variant for GetMode) instead of the
+	// per-group materials. Only meaningful when GetMode() != Bound.
+	const RenderMaterial& GetMaterial() const { return m_Material; }
+
+	// GPU memory of the texture array copy, 0 in the other modes
+	std::size_t GetArrayBytes() const { return m_Array.GetMemoryBytes(); }
+
+	static bool IsBindlessSupported();
+
+	// The mode tables aim for; Bindless falls back to Array when the
+	// extension is missing. Defaults to Bindless.
+	static Mode GetRequestedMode();
+	static void SetRequestedMode(Mode mode);
+
+	// The MATERIAL variant value: "BOUND", "BINDLESS" or "ARRAY"
+	static const char* GetModeName(Mode mode);
+
+private:
+	struct Material
+	{
+		std::shared_ptr<Texture> diffuse;
+		std::shared_ptr<Texture> specular;
+	};
+
+	bool IsLoaded() const;
+	bool BuildBindless(std::vector<GpuMaterial>& table);
+	bool BuildArray(std::vector<GpuMaterial>& table);
+	void Release();
+
+	std::vector<Material> m_Materials;
+	Mode m_Mode = Mode::Bound;
+	Mode m_Attempted = Mode::Bound;     // last mode built (or found impossible)
+
+	unsigned int m_Buffer = 0;
+	TextureArray m_Array;
+	RenderMaterial m_Material;
+};
@@ -1,21 +1,88 @@
 #include "Mesh.h"
-#include "../VertexBufferLayout.h"
 #include "GeometryFactory.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "../Renderer.h"
+#include "../RenderQueue.h"
 
 
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
-	: m_Vertices(vertices), m_Indices(indices)
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, VertexFormat format)
+	: m_Vertices(vertices), m_Indices(indices), m_Format(format)
 {
 	SetupMesh();
 }
 
+Mesh::Mesh(std::vector<Vertex>&& vertices, std::vector<unsigned int>&& indices, VertexFormat format)
+	: m_Vertices(std::move(vertices)), m_Indices(std::move(indices)), m_Format(format)
+{
+	SetupMesh();
+}
+
+Mesh::Mesh(MeshArena::Handle handle, const Bounds& localBounds, VertexFormat format)
+	: m_ArenaHandle(handle), m_Format(format), m_Bounds(localBounds)
+{
+	m_Lods.assign(1, LodLevel{ 0, getArenaRange().indexCount, 0.0f });
+}
+
 
 Mesh::~Mesh()
 {
-	m_VAO->unBind();
-	m_VBO->Unbind();
-	m_EBO->Unbind();
+	// The arena may already be gone if a mesh outlives MeshArena::Shutdown()
+	// (e.g. a static); its buffers were freed with the arena.
+	if (m_ArenaHandle != MeshArena::INVALID_HANDLE && MeshArena::IsAlive(m_Format))
+		getArena().Free(m_ArenaHandle);
+	if (m_LodHandle != MeshArena::INVALID_HANDLE && MeshArena::IsAlive(m_Format))
+		getArena().Free(m_LodHandle);
+}
+
+Mesh::Mesh(Mesh&& other) noexcept
+	: m_Vertices(std::move(other.m_Vertices)),
+	  m_Indices(std::move(other.m_Indices)),
+	  m_ArenaHandle(other.m_ArenaHandle),
+	  m_Format(other.m_Format),
+	  m_VAO(std::move(other.m_VAO)),
+	  m_Bounds(other.m_Bounds),
+	  m_Lods(std::move(other.m_Lods)),
+	  m_LodIndices(std::move(other.m_LodIndices)),
+	  m_LodHandle(other.m_LodHandle),
+	  m_Meshlets(std::move(other.m_Meshlets)),
+	  m_Positions(std::move(other.m_Positions)),
+	  m_CpuData(other.m_CpuData),
+	  m_Transform(std::move(other.m_Transform))
+{
+	other.m_ArenaHandle = MeshArena::INVALID_HANDLE;
+	other.m_LodHandle = MeshArena::INVALID_HANDLE;
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+	if (this != &other)
+	{
+		// Release what we own before taking the other mesh's range
+		if (m_ArenaHandle != MeshArena::INVALID_HANDLE && MeshArena::IsAlive(m_Format))
+			getArena().Free(m_ArenaHandle);
+		if (m_LodHandle != MeshArena::INVALID_HANDLE && MeshArena::IsAlive(m_Format))
+			getArena().Free(m_LodHandle);
+
+		m_Vertices = std::move(other.m_Vertices);
+		m_Indices = std::move(other.m_Indices);
+		m_ArenaHandle = other.m_ArenaHandle;
+		m_Format = other.m_Format;
+		m_VAO = std::move(other.m_VAO);
+		m_Bounds = other.m_Bounds;
+		m_Lods = std::move(other.m_Lods);
+		m_LodIndices = std::move(other.m_LodIndices);
+		m_LodHandle = other.m_LodHandle;
+		m_Meshlets = std::move(other.m_Meshlets);
+		m_Positions = std::move(other.m_Positions);
+		m_CpuData = other.m_CpuData;
+		m_Transform = std::move(other.m_Transform);
+
+		other.m_ArenaHandle = MeshArena::INVALID_HANDLE;
+		other.m_LodHandle = MeshArena::INVALID_HANDLE;
+	}
+	return *this;
 }
 
 void Mesh::SetupMesh()
@@ -26,52 +93,247 @@ void Mesh::SetupMesh()
 		return;
 	}
 
-	//set up the buffers
+	// Instead of a VAO/VBO/EBO per mesh, copy the data into the shared arena
+	// buffers. The arena VAO already has the Vertex layout set up, so there
+	// is nothing else to create here.
+	MeshArena& arena = getArena();
+	if (m_ArenaHandle != MeshArena::INVALID_HANDLE)
+		arena.Free(m_ArenaHandle);
+
+	m_ArenaHandle = arena.Allocate(m_Vertices, m_Indices);
+
+	m_Bounds = Bounds::FromVertices(m_Vertices);
+
+	// New geometry: any old LODs no longer match it
+	if (m_LodHandle != MeshArena::INVALID_HANDLE)
+		arena.Free(m_LodHandle);
+	m_LodHandle = MeshArena::INVALID_HANDLE;
+	m_Lods.assign(1, LodLevel{ 0, static_cast<unsigned int>(m_Indices.size()), 0.0f });
+	m_LodIndices.clear();
+	m_Meshlets.clear();
+	m_Positions.clear();
+	m_CpuData = CpuData::Full;
+}
+
+// ----------------------------------------------------------------------------
+// CPU copies
+// ----------------------------------------------------------------------------
+// swap with an empty vector, not clear(): clear keeps the capacity, and the
+// capacity is the point.
+// ----------------------------------------------------------------------------
+
+template <typename T>
+static std::size_t HeapBytes(const std::vector<T>& v)
+{
+	return v.capacity() * sizeof(T);
+}
+
+template <typename T>
+static void FreeVector(std::vector<T>& v)
+{
+	std::vector<T>().swap(v);
+}
+
+std::size_t Mesh::ReleaseCpuData(CpuData keep)
+{
+	if (!hasGeometry() || keep <= m_CpuData)
+		return 0;
+
+	const std::size_t before = getCpuBytes();
+
+	// Positions out of the full copy, before it goes
+	if (keep == CpuData::Positions && m_CpuData == CpuData::Full)
+	{
+		m_Positions.resize(m_Vertices.size());
+		for (std::size_t i = 0; i < m_Vertices.size(); i++)
+		{
+			const float* p = m_Vertices[i].position;
+			m_Positions[i] = glm::vec3(p[0], p[1], p[2]);
+		}
+	}
+
+	FreeVector(m_Vertices);
+	FreeVector(m_LodIndices);
+	if (keep == CpuData::None)
+	{
+		FreeVector(m_Indices);
+		FreeVector(m_Positions);
+	}
+
+	m_CpuData = keep;
+	return before - getCpuBytes();
+}
+
+std::size_t Mesh::getCpuBytes() const
+{
+	return HeapBytes(m_Vertices) + HeapBytes(m_Indices) + HeapBytes(m_LodIndices)
+		+ HeapBytes(m_Positions) + HeapBytes(m_Meshlets) + HeapBytes(m_Lods);
+}
+
+// ----------------------------------------------------------------------------
+// Levels of detail
+// ----------------------------------------------------------------------------
+// Each level is simplified from the previous one rather than from level 0:
+// it is much cheaper on big meshes, and the levels nest. The simplifier's
+// error is against its input, so the errors are summed to stay an upper
+// bound on the distance from the original surface.
+// ----------------------------------------------------------------------------
 
-	m_VAO = std::make_unique<VertexArray>();
-	m_VBO = std::make_unique<VertexBuffer>(m_Vertices.data(), m_Vertices.size() * sizeof(Vertex));
-	m_EBO = std::make_unique<IndexBuffer>(m_Indices.data(), m_Indices.size());
+static const unsigned int MIN_LOD_TRIANGLES = 32;
 
+void Mesh::GenerateLods(unsigned int maxLevels, float ratio)
+{
+	// Nothing to simplify without the CPU copy (GPU-generated meshes, or
+	// released by ReleaseCpuData)
+	if (!hasGeometry() || m_Vertices.empty() || m_Indices.empty())
+		return;
+
+	std::vector<LodLevel> levels;
+	std::vector<unsigned int> lodIndices;
+	BuildLods(m_Vertices, m_Indices, levels, lodIndices, maxLevels, ratio);
+	SetLods(levels, lodIndices);
+}
+
+void Mesh::BuildLods(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	std::vector<LodLevel>& levels, std::vector<unsigned int>& lodIndices,
+	unsigned int maxLevels, float ratio)
+{
+	levels.assign(1, LodLevel{ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+	lodIndices.clear();   // levels 1.. back to back
+	std::vector<unsigned int> previous = indices;
+	float error = 0.0f;
+
+	for (unsigned int level = 1; level <= maxLevels; level++)
+	{
+		if (previous.size() / 3 < 2 * MIN_LOD_TRIANGLES)
+			break;
+
+		const std::size_t target = static_cast<std::size_t>(previous.size() / 3 * ratio) * 3;
+		float levelError = 0.0f;
+		std::vector<unsigned int> simplified = MeshSimplifier::Simplify(vertices, previous, target, 1e30f, &levelError);
+
+		// Less than 10% smaller: little is left that may collapse, and another
+		// level would cost memory without saving any work.
+		if (simplified.empty() || simplified.size() * 10 > previous.size() * 9)
+			break;
+
+		// Collapses leave the triangles in their old order with holes in it
+		MeshOptimizer::OptimizeVertexCache(simplified, vertices.size());
 
-	VertexBufferLayout layout;
-	layout.Push<float>(3); //position x,y,z
-	layout.Push<float>(3); //normals nx, ny, nz
-	layout.Push<float>(3); //colour r, g, b
-	layout.Push<float>(2); //texture coordinates u, v
+		error += levelError;
+		levels.push_back(LodLevel{ static_cast<unsigned int>(lodIndices.size()),
+			static_cast<unsigned int>(simplified.size()), error });
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+		previous.swap(simplified);
+	}
+}
 
-	m_VAO->AddBuffer(*m_VBO, layout);
+void Mesh::SetLods(const std::vector<LodLevel>& levels, const std::vector<unsigned int>& lodIndices)
+{
+	if (!hasGeometry() || levels.empty())
+		return;
 
-	m_VAO->unBind();
-	m_VBO->Unbind();
-	m_EBO->Unbind();
+	MeshArena& arena = getArena();
+	if (m_LodHandle != MeshArena::INVALID_HANDLE)
+		arena.Free(m_LodHandle);
+	m_LodHandle = MeshArena::INVALID_HANDLE;
 
+	m_Lods = levels;
+	m_LodIndices = lodIndices;
+	if (!m_LodIndices.empty())
+		m_LodHandle = arena.AllocateIndices(m_LodIndices);
+}
+
+MeshArena::Range Mesh::getLodRange(std::size_t level) const
+{
+	MeshArena::Range range = getArenaRange();
+	if (level == 0 || m_Lods.size() < 2 || m_LodHandle == MeshArena::INVALID_HANDLE)
+		return range;
+	if (level >= m_Lods.size())
+		level = m_Lods.size() - 1;
+
+	// baseVertex stays the mesh's own: the LOD range has no vertices
+	const MeshArena::Range& block = getArena().GetRange(m_LodHandle);
+	range.firstIndex = block.firstIndex + m_Lods[level].firstIndex;
+	range.indexCount = m_Lods[level].indexCount;
+	return range;
 }
 
 void Mesh::Draw() //but ultimately this is terrible and we will be making a better one in the future.
 {
-	if (!m_VAO || !m_EBO)
+	if (!hasGeometry())
 	{
 		std::cerr << "Mesh::Draw() called before SetupMesh()!" << std::endl;
 		return;
 	}
 
-	Renderer renderer;
+	getVertexArray()->Bind();
+	getIndexBuffer()->Bind();
 
-	renderer.Draw(*m_VAO, *m_EBO);
+	const MeshArena::Range& range = getArenaRange();
+	Renderer renderer;
+	renderer.DrawIndexed(range.indexCount, range.firstIndex, range.baseVertex, getIndexBuffer()->GetType());
 }
 
-glm::mat4 Mesh::getTransformMatrix() const
+void Mesh::DrawPulled(Shader& shader)
 {
-	glm::mat4 transform = glm::mat4(1.0f);
+	if (!hasGeometry())
+	{
+		std::cerr << "Mesh::DrawPulled() called before SetupMesh()!" << std::endl;
+		return;
+	}
 
+	// No attributes and no element buffer: the shader reads both itself
+	MeshArena::GetEmptyVertexArray().Bind();
+	getArena().BindStorage();
 
-	transform = glm::translate(transform, m_Position); //translate our position
+	const MeshArena::Range& range = getArenaRange();
+	shader.setUniform1i("u_BaseVertex", static_cast<int>(range.baseVertex));
+	Renderer renderer;
+	renderer.DrawArrays(range.firstIndex, range.indexCount);
+}
 
-	transform = glm::rotate(transform, glm::radians(m_Rotation.x), glm::vec3(1, 0, 0));// X axis rotation (PITCH)
-	transform = glm::rotate(transform, glm::radians(m_Rotation.y), glm::vec3(0, 1, 0));// Y axis rotation (YAW)
-	transform = glm::rotate(transform, glm::radians(m_Rotation.z), glm::vec3(0, 0, 1));// Z axis rotation (ROLL)
+const VertexArray* Mesh::getVertexArray() const
+{
+	if (m_VAO)
+		return m_VAO.get();
+	return &getArena().GetVertexArray();
+}
 
-	transform = glm::scale(transform, m_Scale); //translate our scale
+const IndexBuffer* Mesh::getIndexBuffer() const
+{
+	return &getArena().GetIndexBuffer();
+}
 
-	return transform;
+void Mesh::FillCommand(RenderCommand& command, bool pullVertices) const
+{
+	const MeshArena::Range& range = getArenaRange();
+	command.indexCount = range.indexCount;
+	command.firstIndex = range.firstIndex;
+	command.baseVertex = static_cast<int>(range.baseVertex);
+	if (pullVertices)
+	{
+		command.vao = &MeshArena::GetEmptyVertexArray();
+		command.ibo = nullptr;
+		command.pullFrom = &getArena();
+	}
+	else
+	{
+		command.vao = command.instances ? getInstancedVertexArray() : getVertexArray();
+		command.ibo = getIndexBuffer();
+		command.pullFrom = nullptr;
+	}
+}
+
+VertexArray* Mesh::getPrivateVertexArray()
+{
+	if (!m_VAO)
+		m_VAO = getArena().CreateVertexArray();
+	return m_VAO.get();
+}
+
+glm::mat4 Mesh::getTransformMatrix() const
+{
+	// translate * rotate X (pitch), Y (yaw), Z (roll) * scale, see TransformHierarchy.h
+	return m_Transform.GetWorldMatrix();
 }
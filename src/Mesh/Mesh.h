@@ -7,27 +7,86 @@
 #include "../IndexBuffer.h"
 #include "../VertexBuffer.h"
 #include "Vertex.h"
+#include "MeshletBuilder.h"
+#include "MeshArena.h"
+#include "../Culling.h"
+#include "../TransformHierarchy.h"
 
 #include "glm/glm.hpp"
 
+struct RenderCommand;
+class Shader;
+
 class Mesh
 {
+public:
+	// One level of detail; see m_Lods below.
+	struct LodLevel
+	{
+		unsigned int firstIndex;   // into the m_LodHandle range (0 for level 0)
+		unsigned int indexCount;
+		float        error;        // object-space distance from level 0's surface
+	};
+
+	// What stays on the CPU once the GPU has the geometry, see ReleaseCpuData
+	enum class CpuData
+	{
+		Full,        // m_Vertices, m_Indices and m_LodIndices, as uploaded
+		Positions,   // level 0's indices and bare positions: enough for picking
+		None         // bounds, counts and meshlets only
+	};
+
 protected:
 	std::vector<Vertex> m_Vertices;
 	std::vector<unsigned int> m_Indices;
 
-	//Buffers
+	// Vertex/index data lives in the shared MeshArena of m_Format; the
+	// handle finds this mesh's range there. See MeshArena.h.
+	MeshArena::Handle m_ArenaHandle = MeshArena::INVALID_HANDLE;
+	VertexFormat m_Format = VertexFormat::Standard;
+
+	// Optional VAO of this mesh's own over the arena buffers, created only
+	// when something needs per-mesh attribute state (getPrivateVertexArray).
 	std::unique_ptr<VertexArray>  m_VAO;
-	std::unique_ptr<IndexBuffer>  m_EBO;
-	std::unique_ptr<VertexBuffer> m_VBO;
 
-	glm::vec3 m_Position;
-	glm::vec3 m_Rotation;
-	glm::vec3 m_Scale;
+	// Local-space bounds of m_Vertices, computed by SetupMesh (see Culling.h)
+	Bounds m_Bounds;
+
+	// Levels of detail, see GenerateLods. m_Lods[0] is m_Indices itself;
+	// the coarser levels are stored back to back in one index-only arena
+	// range (m_LodHandle) and draw with this mesh's baseVertex.
+	// m_LodIndices is the CPU copy of that range.
+	std::vector<LodLevel> m_Lods;
+	std::vector<unsigned int> m_LodIndices;
+	MeshArena::Handle m_LodHandle = MeshArena::INVALID_HANDLE;
+
+	// Clusters of level 0's triangles for ClusterCulling, cut at import
+	// (MeshletBuilder) and installed with SetMeshlets
+	std::vector<Meshlet> m_Meshlets;
+
+	// m_Vertices' positions alone, once ReleaseCpuData(CpuData::Positions)
+	// has dropped the rest
+	std::vector<glm::vec3> m_Positions;
+	CpuData m_CpuData = CpuData::Full;
+
+	// Position/rotation/scale and the cached world matrix, in the shared
+	// TransformHierarchy. A Model's meshes are children of the model's node.
+	TransformNode m_Transform;
 
 public:
-	Mesh() : m_Position(0.0f), m_Rotation(0.0f), m_Scale(1.0f) {};
-	Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+	Mesh() {};
+	// `format` is how the GPU copy is stored (see PackedVertex.h); the CPU
+	// copy is always full-precision Vertex data.
+	Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+		VertexFormat format = VertexFormat::Standard);
+	// The same, taking the arrays over instead of copying them
+	Mesh(std::vector<Vertex>&& vertices, std::vector<unsigned int>&& indices,
+		VertexFormat format = VertexFormat::Standard);
+	// Adopt a range already filled on the GPU (e.g. by GeometryFactory's
+	// compute generators), with bounds worked out by whoever filled it.
+	// There is no CPU copy, so getVertices() is empty and GenerateLods does
+	// nothing.
+	Mesh(MeshArena::Handle handle, const Bounds& localBounds, VertexFormat format = VertexFormat::Standard);
 	virtual ~Mesh();
 
 	/*
@@ -56,16 +115,19 @@ public:
 	 * Because std::unique_ptr needs to MOVE ownership of the Mesh object,
 	 * and without a move assignment operator, the compiler doesn't know how.
 	 *
-	 * WHAT "= default" MEANS:
-	 * -----------------------
+	 * WHY THE MOVES ARE NOT "= default":
+	 * ----------------------------------
 	 * Writing "= default" tells the compiler: "Generate the default
 	 * implementation for this function." For move operations, this means
 	 * moving each member variable individually:
 	 *   - std::vector and std::unique_ptr have their own move operations
-	 *   - glm::vec3 is trivially copyable/movable
+	 *   - TransformNode hands its hierarchy node over and resets the source
 	 *
-	 * The compiler-generated move will efficiently transfer ownership of our
-	 * unique_ptr members (m_VAO, m_EBO, m_VBO) without copying the GPU resources.
+	 * That is right for m_VAO, but m_ArenaHandle is a plain integer: a
+	 * defaulted move COPIES it, leaving two meshes owning the same
+	 * MeshArena range, and the first destructor would free it under the
+	 * other. So the moves are written out in Mesh.cpp: they take the handle
+	 * and reset the source's to INVALID_HANDLE.
 	 *
 	 * WHY WE DELETE COPY OPERATIONS:
 	 * ------------------------------
@@ -92,10 +154,10 @@ public:
 	 */
 
 	// Move constructor: Mesh newMesh = std::move(oldMesh);
-	Mesh(Mesh&&) = default;
+	Mesh(Mesh&& other) noexcept;
 
 	// Move assignment: existingMesh = std::move(otherMesh);
-	Mesh& operator=(Mesh&&) = default;
+	Mesh& operator=(Mesh&& other) noexcept;
 
 	// Copy constructor: DELETED - can't copy unique_ptr members
 	Mesh(const Mesh&) = delete;
@@ -105,18 +167,115 @@ public:
 
 	virtual void SetupMesh();
 	virtual void Draw();
+	// Draw with vertex pulling (MeshArena.h) through the bound shader,
+	// which must be its PULL variant for getVertexFormat(); sets its
+	// u_BaseVertex
+	void DrawPulled(Shader& shader);
 
 
-	void setPosition(const glm::vec3& position) { m_Position = position; }
-	void setRotation(const glm::vec3& rotation) { m_Rotation = rotation; }
-	void setScale(const glm::vec3& scale) { m_Scale = scale; }
+	// The local transform, relative to the parent node if there is one
+	void setPosition(const glm::vec3& position) { m_Transform.SetPosition(position); }
+	void setRotation(const glm::vec3& rotation) { m_Transform.SetRotation(rotation); }
+	void setScale(const glm::vec3& scale) { m_Transform.SetScale(scale); }
 
-	glm::vec3 getPosition() const { return m_Position; }
-	glm::vec3 getRotation() const { return m_Rotation; }
-	glm::vec3 getScale()    const { return m_Scale;    }
+	glm::vec3 getPosition() const { return m_Transform.GetPosition(); }
+	glm::vec3 getRotation() const { return m_Transform.GetRotation(); }
+	glm::vec3 getScale()    const { return m_Transform.GetScale();    }
 
+	// Parent this mesh's transform under another node (NONE: a root)
+	void setParent(TransformHierarchy::Node parent) { m_Transform.SetParent(parent); }
+	TransformHierarchy::Node getTransformNode() const { return m_Transform.GetNode(); }
+
+	// World matrix: the parent's times this mesh's local transform, cached
+	// by the hierarchy until either changes
 	glm::mat4 getTransformMatrix() const;
 
+	// Bounds for frustum culling: in the mesh's own space, and after
+	// getTransformMatrix() (or any other transform, e.g. an instance's).
+	const Bounds& getLocalBounds() const { return m_Bounds; }
+	Bounds getWorldBounds() const { return m_Bounds.Transformed(getTransformMatrix()); }
+	Bounds getWorldBounds(const glm::mat4& transform) const { return m_Bounds.Transformed(transform); }
+
+	// Raw buffer access for RenderQueue submission. The VAO is the shared
+	// arena VAO unless getPrivateVertexArray() gave this mesh its own; the
+	// index buffer is always the arena's, drawn over getArenaRange().
+	const VertexArray* getVertexArray() const;
+	const IndexBuffer* getIndexBuffer() const;
+	bool hasGeometry() const { return m_ArenaHandle != MeshArena::INVALID_HANDLE; }
+	const MeshArena::Range& getArenaRange() const { return getArena().GetRange(m_ArenaHandle); }
+	MeshArena& getArena() const { return MeshArena::Get(m_Format); }
+	VertexFormat getVertexFormat() const { return m_Format; }
+
+	// The arena's VAO with the instance attributes, shared by every instanced
+	// mesh of this format; the InstanceBuffer is bound per draw.
+	const VertexArray* getInstancedVertexArray() const { return &getArena().GetInstancedVertexArray(); }
+
+	// Point a RenderCommand at this mesh's arena range: through the arena's
+	// VAO (the instanced one if command.instances is already set) and index
+	// buffer, or with pullVertices through MeshArena::GetEmptyVertexArray()
+	// and the arena's buffers as storage, for a shader's PULL variant (see
+	// MeshArena.h). The shader, model and the rest stay the caller's.
+	void FillCommand(RenderCommand& command, bool pullVertices = false) const;
+
+	// This mesh's own VAO over the arena buffers, created on first call.
+	// Use it to attach extra attributes (e.g. an InstanceBuffer) that must
+	// not leak into every other arena mesh.
+	VertexArray* getPrivateVertexArray();
+
+	// Build up to maxLevels coarser levels of detail with MeshSimplifier,
+	// each aiming for `ratio` of the previous level's triangles. All levels
+	// share this mesh's vertices; only the index lists differ. Stops early
+	// once simplification stalls (locked seams/borders) or the mesh is tiny.
+	void GenerateLods(unsigned int maxLevels = 4, float ratio = 0.5f);
+
+	// What GenerateLods computes, without a Mesh or any GL, so it can run
+	// on a worker thread: `levels` gets level 0 as well, `lodIndices` the
+	// coarser levels back to back. Pass both to SetLods.
+	static void BuildLods(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+		std::vector<LodLevel>& levels, std::vector<unsigned int>& lodIndices,
+		unsigned int maxLevels = 4, float ratio = 0.5f);
+
+	// Install levels built earlier (e.g. read back from a MeshCache file)
+	// instead of generating them. `levels` includes level 0; `lodIndices`
+	// holds levels 1.. back to back, as getLodIndices() returns them.
+	void SetLods(const std::vector<LodLevel>& levels, const std::vector<unsigned int>& lodIndices);
+
+	// Level 0 is the full mesh. getLodRange is the arena range to draw a
+	// level with (clamped to the coarsest); getLodError its object-space
+	// error, for choosing a level by projected screen size.
+	std::size_t getLodCount() const { return m_Lods.size(); }
+	unsigned int getLodIndexCount(std::size_t level) const { return m_Lods[level].indexCount; }
+	float getLodError(std::size_t level) const { return m_Lods[level].error; }
+	MeshArena::Range getLodRange(std::size_t level) const;
+	const std::vector<LodLevel>& getLods() const { return m_Lods; }
+	const std::vector<unsigned int>& getLodIndices() const { return m_LodIndices; }
+
+	// Install meshlets built earlier, e.g. by the import or from a MeshCache
+	void SetMeshlets(const std::vector<Meshlet>& meshlets) { m_Meshlets = meshlets; }
+	const std::vector<Meshlet>& getMeshlets() const { return m_Meshlets; }
+
+	// CPU copies of the geometry, e.g. for packing several meshes into
+	// shared buffers. Empty once released (see ReleaseCpuData).
+	const std::vector<Vertex>& getVertices() const { return m_Vertices; }
+	const std::vector<unsigned int>& getIndices() const { return m_Indices; }
+	// The positions kept by CpuData::Positions; empty otherwise, when
+	// getVertices() has them
+	const std::vector<glm::vec3>& getPositions() const { return m_Positions; }
+
+	// The arena has every level, so the CPU copies are only needed by what
+	// reads the geometry back: GenerateLods, SetupMesh again, a MeshCache
+	// write, picking (TriangleBVH). A big model doubles its
+	// resident memory by keeping them. ReleaseCpuData drops down to `keep`
+	// (never back up) and returns the bytes freed; with less than Full the
+	// calls above do nothing (picking still works with Positions).
+	std::size_t ReleaseCpuData(CpuData keep);
+	CpuData getCpuData() const { return m_CpuData; }
+	// Heap bytes of the CPU-side arrays, as held
+	std::size_t getCpuBytes() const;
+	// Vertices and indices of level 0, with or without the CPU copies
+	unsigned int getVertexCount() const { return hasGeometry() ? getArenaRange().vertexCount : 0; }
+	unsigned int getIndexCount() const { return hasGeometry() ? getArenaRange().indexCount : 0; }
+
 
 };
 
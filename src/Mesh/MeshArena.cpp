@@ -0,0 +1,464 @@
+#include "MeshArena.h"
+#include "../Renderer.h"
+#include "VertexLayouts.h"
+#include "../GpuMemory.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Initial sizes: enough for the GeometryFactory primitives a typical test
+// creates before the first grow.
+static const unsigned int INITIAL_VERTEX_CAPACITY = 64 * 1024;
+static const unsigned int INITIAL_INDEX_CAPACITY = 192 * 1024;
+
+static std::unique_ptr<MeshArena> s_Arenas[VERTEX_FORMAT_COUNT];
+static std::unique_ptr<VertexArray> s_EmptyVAO;
+
+// ----------------------------------------------------------------------------
+// Buffer helpers
+// ----------------------------------------------------------------------------
+// Everything goes through GL_COPY_READ_BUFFER / GL_COPY_WRITE_BUFFER so none
+// of this disturbs the VAO's element buffer or the GL_ARRAY_BUFFER binding.
+// ----------------------------------------------------------------------------
+
+// Re-specify `buffer` at `newBytes`, keeping its first `keepBytes`. The
+// buffer name is unchanged, so VAOs referencing it stay valid.
+static void ResizeBuffer(unsigned int buffer, unsigned int keepBytes, unsigned int newBytes, GpuMemory::Category category)
+{
+	unsigned int temp = 0;
+	if (keepBytes > 0)
+	{
+		GlCall(glGenBuffers(1, &temp));
+		GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, temp));
+		GlCall(glBufferData(GL_COPY_WRITE_BUFFER, keepBytes, nullptr, GL_STREAM_COPY));
+		GlCall(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+		GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keepBytes));
+	}
+
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+	GlCall(glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW));
+	GpuMemory::TrackBuffer(category, buffer, newBytes);
+
+	if (keepBytes > 0)
+	{
+		GlCall(glBindBuffer(GL_COPY_READ_BUFFER, temp));
+		GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keepBytes));
+		GlCall(glDeleteBuffers(1, &temp));
+	}
+}
+
+static void UploadRange(unsigned int buffer, unsigned int offsetBytes, unsigned int sizeBytes, const void* data)
+{
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+	GlCall(glBufferSubData(GL_COPY_WRITE_BUFFER, offsetBytes, sizeBytes, data));
+}
+
+// ----------------------------------------------------------------------------
+// FreeList
+// ----------------------------------------------------------------------------
+
+void MeshArena::FreeList::Reset(unsigned int used, unsigned int capacity)
+{
+	m_Blocks.clear();
+	if (used < capacity)
+		m_Blocks.push_back({ used, capacity - used });
+}
+
+bool MeshArena::FreeList::Allocate(unsigned int size, unsigned int& offset)
+{
+	// Index-only ranges take no vertex space; they must not fail (or force a
+	// defragment) when the vertex buffer happens to be full.
+	if (size == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	for (std::size_t i = 0; i < m_Blocks.size(); ++i)
+	{
+		Block& block = m_Blocks[i];
+		if (block.size < size)
+			continue;
+
+		offset = block.offset;
+		block.offset += size;
+		block.size -= size;
+		if (block.size == 0)
+			m_Blocks.erase(m_Blocks.begin() + i);
+		return true;
+	}
+	return false;
+}
+
+void MeshArena::FreeList::Free(unsigned int offset, unsigned int size)
+{
+	if (size == 0)
+		return;
+
+	// Insert in offset order, then merge with the neighbours it touches
+	auto it = std::lower_bound(m_Blocks.begin(), m_Blocks.end(), offset,
+		[](const Block& block, unsigned int value) { return block.offset < value; });
+	it = m_Blocks.insert(it, { offset, size });
+
+	auto next = it + 1;
+	if (next != m_Blocks.end() && it->offset + it->size == next->offset)
+	{
+		it->size += next->size;
+		m_Blocks.erase(next);
+	}
+
+	if (it != m_Blocks.begin())
+	{
+		auto prev = it - 1;
+		if (prev->offset + prev->size == it->offset)
+		{
+			prev->size += it->size;
+			m_Blocks.erase(it);
+		}
+	}
+}
+
+void MeshArena::FreeList::Grow(unsigned int oldCapacity, unsigned int newCapacity)
+{
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+unsigned int MeshArena::FreeList::GetTotalFree() const
+{
+	unsigned int total = 0;
+	for (const Block& block : m_Blocks)
+		total += block.size;
+	return total;
+}
+
+// ----------------------------------------------------------------------------
+// Lifetime
+// ----------------------------------------------------------------------------
+
+MeshArena& MeshArena::Get(VertexFormat format)
+{
+	std::unique_ptr<MeshArena>& arena = s_Arenas[static_cast<unsigned int>(format)];
+	if (!arena)
+		arena.reset(new MeshArena(format));
+	return *arena;
+}
+
+bool MeshArena::IsAlive(VertexFormat format)
+{
+	return s_Arenas[static_cast<unsigned int>(format)] != nullptr;
+}
+
+void MeshArena::Shutdown()
+{
+	for (std::unique_ptr<MeshArena>& arena : s_Arenas)
+		arena.reset();
+	s_EmptyVAO.reset();
+}
+
+const VertexArray& MeshArena::GetEmptyVertexArray()
+{
+	// A core profile draws nothing without some VAO bound, attributes or not
+	if (!s_EmptyVAO)
+	{
+		s_EmptyVAO = std::make_unique<VertexArray>();
+		s_EmptyVAO->unBind();
+	}
+	return *s_EmptyVAO;
+}
+
+const char* MeshArena::GetPullVariant(VertexFormat format)
+{
+	return format == VertexFormat::Packed ? "PACKED" : "STANDARD";
+}
+
+MeshArena::MeshArena(VertexFormat format)
+	: m_Format(format),
+	  m_Stride(::GetVertexStride(format)),
+	  m_VertexCapacity(INITIAL_VERTEX_CAPACITY),
+	  m_IndexCapacity(INITIAL_INDEX_CAPACITY),
+	  m_Generation(0),
+	  m_Defragmentations(0)
+{
+	// Same order as Mesh::SetupMesh used: the VAO must be bound when the
+	// IndexBuffer is created so the element buffer is recorded in it.
+	m_VAO = std::make_unique<VertexArray>();
+	m_VBO = std::make_unique<VertexBuffer>(nullptr, m_VertexCapacity * m_Stride);
+	m_EBO = std::make_unique<IndexBuffer>(nullptr, m_IndexCapacity);
+	SetupLayout(*m_VAO);
+
+	// Every instanced arena mesh draws through this one
+	m_InstancedVAO = CreateVertexArray();
+	m_InstancedVAO->SetInstanceLayout();
+	m_InstancedVAO->unBind();
+
+	m_PositionVAO = CreatePositionVertexArray();
+	m_InstancedPositionVAO = CreatePositionVertexArray();
+	m_InstancedPositionVAO->SetInstanceLayout();
+	m_InstancedPositionVAO->unBind();
+
+	m_VertexSpace.Reset(0, m_VertexCapacity);
+	m_IndexSpace.Reset(0, m_IndexCapacity);
+
+	// Slot 0 is INVALID_HANDLE
+	m_Ranges.push_back(Range());
+	m_Live.push_back(false);
+}
+
+MeshArena::~MeshArena()
+{
+}
+
+void MeshArena::SetupLayout(VertexArray& vao) const
+{
+	// The format's static table (VertexLayouts.h): nothing to build per VAO
+	vao.AddBuffer(*m_VBO, GetVertexLayout(m_Format));
+}
+
+std::unique_ptr<VertexArray> MeshArena::CreateVertexArray() const
+{
+	auto vao = std::make_unique<VertexArray>();
+	SetupLayout(*vao);
+	m_EBO->Bind();
+	vao->unBind();
+	return vao;
+}
+
+std::unique_ptr<VertexArray> MeshArena::CreatePositionVertexArray() const
+{
+	// Position is the first attribute of every format; the stride stays
+	// the whole vertex
+	VertexLayout positions = GetVertexLayout(m_Format);
+	positions.count = 1;
+
+	auto vao = std::make_unique<VertexArray>();
+	vao->AddBuffer(*m_VBO, positions);
+	m_EBO->Bind();
+	vao->unBind();
+	return vao;
+}
+
+void MeshArena::BindStorage() const
+{
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VERTEX_STORAGE_BINDING, m_VBO->GetID()));
+	GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_STORAGE_BINDING, m_EBO->GetID()));
+}
+
+// ----------------------------------------------------------------------------
+// Allocation
+// ----------------------------------------------------------------------------
+
+MeshArena::Handle MeshArena::Allocate(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	const unsigned int vertexCount = static_cast<unsigned int>(vertices.size());
+	const unsigned int indexCount = static_cast<unsigned int>(indices.size());
+
+	Handle handle = AllocateUninitialised(vertexCount, indexCount);
+	if (handle == INVALID_HANDLE)
+		return INVALID_HANDLE;
+	const Range& range = m_Ranges[handle];
+
+	if (vertexCount > 0 && m_Format == VertexFormat::Packed)
+	{
+		std::vector<PackedVertex> packed(vertices.begin(), vertices.end());
+		UploadRange(m_VBO->GetID(), range.baseVertex * m_Stride, vertexCount * m_Stride, packed.data());
+	}
+	else if (vertexCount > 0)
+	{
+		UploadRange(m_VBO->GetID(), range.baseVertex * m_Stride, vertexCount * m_Stride, vertices.data());
+	}
+	if (indexCount > 0)
+		UploadRange(m_EBO->GetID(), range.firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices.data());
+	return handle;
+}
+
+MeshArena::Handle MeshArena::AllocateUninitialised(unsigned int vertexCount, unsigned int indexCount)
+{
+	if (!Reserve(vertexCount, indexCount))
+		return INVALID_HANDLE;
+
+	Range range;
+	range.vertexCount = vertexCount;
+	range.indexCount = indexCount;
+	m_VertexSpace.Allocate(vertexCount, range.baseVertex);
+	m_IndexSpace.Allocate(indexCount, range.firstIndex);
+
+	Handle handle;
+	if (!m_FreeHandles.empty())
+	{
+		handle = m_FreeHandles.back();
+		m_FreeHandles.pop_back();
+		m_Ranges[handle] = range;
+		m_Live[handle] = true;
+	}
+	else
+	{
+		handle = static_cast<Handle>(m_Ranges.size());
+		m_Ranges.push_back(range);
+		m_Live.push_back(true);
+	}
+	return handle;
+}
+
+// Make sure both free lists can satisfy the request, compacting or growing
+// as needed. Allocation itself happens in the caller.
+bool MeshArena::Reserve(unsigned int vertexCount, unsigned int indexCount)
+{
+	unsigned int probe;
+
+	FreeList vertexTrial = m_VertexSpace;
+	FreeList indexTrial = m_IndexSpace;
+	bool vertexFits = vertexTrial.Allocate(vertexCount, probe);
+	bool indexFits = indexTrial.Allocate(indexCount, probe);
+	if (vertexFits && indexFits)
+		return true;
+
+	// Enough space in total, just fragmented: compacting is cheaper than
+	// growing and keeps the buffers small.
+	if ((vertexFits || m_VertexSpace.GetTotalFree() >= vertexCount)
+		&& (indexFits || m_IndexSpace.GetTotalFree() >= indexCount))
+	{
+		Defragment();
+		return true;
+	}
+
+	if (!vertexFits)
+		GrowVertices(m_VertexCapacity + vertexCount);
+	if (!indexFits)
+		GrowIndices(m_IndexCapacity + indexCount);
+	return true;
+}
+
+void MeshArena::GrowVertices(unsigned int minCapacity)
+{
+	unsigned int newCapacity = m_VertexCapacity;
+	while (newCapacity < minCapacity)
+		newCapacity *= 2;
+
+	ResizeBuffer(m_VBO->GetID(), m_VertexCapacity * m_Stride, newCapacity * m_Stride, GpuMemory::Category::Vertex);
+	m_VertexSpace.Grow(m_VertexCapacity, newCapacity);
+	m_VertexCapacity = newCapacity;
+}
+
+void MeshArena::GrowIndices(unsigned int minCapacity)
+{
+	unsigned int newCapacity = m_IndexCapacity;
+	while (newCapacity < minCapacity)
+		newCapacity *= 2;
+
+	ResizeBuffer(m_EBO->GetID(), m_IndexCapacity * sizeof(unsigned int), newCapacity * sizeof(unsigned int),
+		GpuMemory::Category::Index);
+	m_IndexSpace.Grow(m_IndexCapacity, newCapacity);
+	m_IndexCapacity = newCapacity;
+}
+
+void MeshArena::Free(Handle handle)
+{
+	if (handle == INVALID_HANDLE || handle >= m_Ranges.size() || !m_Live[handle])
+		return;
+
+	const Range& range = m_Ranges[handle];
+	m_VertexSpace.Free(range.baseVertex, range.vertexCount);
+	m_IndexSpace.Free(range.firstIndex, range.indexCount);
+
+	m_Ranges[handle] = Range();
+	m_Live[handle] = false;
+	m_FreeHandles.push_back(handle);
+}
+
+// ----------------------------------------------------------------------------
+// Defragment
+// ----------------------------------------------------------------------------
+// Packs live ranges into a temporary buffer in their current order, then
+// copies the packed data back to the start of the arena buffer. Indices are
+// relative to baseVertex, so moving vertices never requires rewriting them.
+// ----------------------------------------------------------------------------
+
+void MeshArena::Defragment()
+{
+	std::vector<Handle> live;
+	for (Handle h = 1; h < m_Ranges.size(); ++h)
+		if (m_Live[h])
+			live.push_back(h);
+
+	unsigned int vertexTemp = 0, indexTemp = 0;
+	GlCall(glGenBuffers(1, &vertexTemp));
+	GlCall(glGenBuffers(1, &indexTemp));
+
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, vertexTemp));
+	GlCall(glBufferData(GL_COPY_WRITE_BUFFER, m_VertexCapacity * m_Stride, nullptr, GL_STREAM_COPY));
+	GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_VBO->GetID()));
+
+	std::sort(live.begin(), live.end(), [this](Handle a, Handle b)
+		{ return m_Ranges[a].baseVertex < m_Ranges[b].baseVertex; });
+
+	unsigned int packedVertices = 0;
+	for (Handle h : live)
+	{
+		Range& range = m_Ranges[h];
+		if (range.vertexCount > 0)
+		{
+			GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				range.baseVertex * m_Stride, packedVertices * m_Stride, range.vertexCount * m_Stride));
+		}
+		range.baseVertex = packedVertices;
+		packedVertices += range.vertexCount;
+	}
+
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, indexTemp));
+	GlCall(glBufferData(GL_COPY_WRITE_BUFFER, m_IndexCapacity * sizeof(unsigned int), nullptr, GL_STREAM_COPY));
+	GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_EBO->GetID()));
+
+	std::sort(live.begin(), live.end(), [this](Handle a, Handle b)
+		{ return m_Ranges[a].firstIndex < m_Ranges[b].firstIndex; });
+
+	unsigned int packedIndices = 0;
+	for (Handle h : live)
+	{
+		Range& range = m_Ranges[h];
+		if (range.indexCount > 0)
+		{
+			GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				range.firstIndex * sizeof(unsigned int), packedIndices * sizeof(unsigned int), range.indexCount * sizeof(unsigned int)));
+		}
+		range.firstIndex = packedIndices;
+		packedIndices += range.indexCount;
+	}
+
+	// Copy the packed data back over the front of the real buffers
+	if (packedVertices > 0)
+	{
+		GlCall(glBindBuffer(GL_COPY_READ_BUFFER, vertexTemp));
+		GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_VBO->GetID()));
+		GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, packedVertices * m_Stride));
+	}
+	if (packedIndices > 0)
+	{
+		GlCall(glBindBuffer(GL_COPY_READ_BUFFER, indexTemp));
+		GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_EBO->GetID()));
+		GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, packedIndices * sizeof(unsigned int)));
+	}
+
+	GlCall(glDeleteBuffers(1, &vertexTemp));
+	GlCall(glDeleteBuffers(1, &indexTemp));
+
+	m_VertexSpace.Reset(packedVertices, m_VertexCapacity);
+	m_IndexSpace.Reset(packedIndices, m_IndexCapacity);
+
+	m_Generation++;
+	m_Defragmentations++;
+}
+
+MeshArena::Stats MeshArena::GetStats() const
+{
+	Stats stats;
+	stats.vertexCapacity = m_VertexCapacity;
+	stats.verticesUsed = m_VertexCapacity - m_VertexSpace.GetTotalFree();
+	stats.indexCapacity = m_IndexCapacity;
+	stats.indicesUsed = m_IndexCapacity - m_IndexSpace.GetTotalFree();
+	stats.allocations = static_cast<unsigned int>(m_Ranges.size() - 1 - m_FreeHandles.size());
+	stats.freeBlocks = m_VertexSpace.GetBlockCount() + m_IndexSpace.GetBlockCount();
+	stats.defragmentations = m_Defragmentations;
+	stats.generation = m_Generation;
+	stats.vertexStride = m_Stride;
+	return stats;
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include <vector>
+#include <memory>
+
+#include "../VertexArray.h"
+#include "../VertexBuffer.h"
+#include "../IndexBuffer.h"
+#include "Vertex.h"
+#include "PackedVertex.h"
+
+// ----------------------------------------------------------------------------
+// MeshArena
+// ----------------------------------------------------------------------------
+// One big vertex buffer, one big index buffer and one VAO shared by every
+// Mesh that uses the standard Vertex layout.
+//
+// Previously each Mesh created its own VertexArray/VertexBuffer/IndexBuffer,
+// so drawing N meshes meant N VAO binds and N sets of tiny GL buffers. With
+// the arena, a mesh is just a range inside the shared buffers:
+//
+//     Range { baseVertex, vertexCount, firstIndex, indexCount }
+//
+// and is drawn with glDrawElementsBaseVertex: firstIndex says where its
+// indices start, baseVertex is added to every index so the mesh's own
+// 0-based indices land on its vertices. Every arena mesh shares one VAO, so
+// sorting by VAO in the RenderQueue collapses to a single bind, and whole
+// scenes can go through one multi-draw indirect call.
+//
+// ALLOCATION
+//   Vertex space and index space each have a first-fit free list of
+//   {offset, size} blocks, coalesced on Free. When no block is big enough:
+//     1. if the total free space would fit, Defragment() compacts the live
+//        ranges to the front of the buffers;
+//     2. otherwise the buffer grows (doubling).
+//
+// STABLE BUFFER NAMES
+//   Growing and defragmenting go through a temporary buffer and then
+//   re-specify the ORIGINAL buffer with glBufferData, so the GL names never
+//   change. Every VAO that references the arena buffers (the shared one and
+//   any from CreateVertexArray) therefore stays valid without re-binding.
+//
+// INDEX TYPE
+//   The shared index buffer is always 32-bit. A multi-draw call has a
+//   single index type for every command in it, and model sub-meshes often
+//   exceed 65535 vertices, so one 16-bit mesh could not join the others.
+//   Standalone IndexBuffers pick 16 bits on their own (IndexBuffer.h).
+//
+// HANDLES
+//   Defragment moves ranges, so meshes hold a Handle, not the Range itself,
+//   and look the range up when drawing. GetGeneration() increments whenever
+//   ranges move, for callers that cache offsets (e.g. indirect commands).
+//
+// VERTEX FORMATS
+//   One vertex buffer can only hold one layout, so there is one arena per
+//   VertexFormat: Get() is the standard 44-byte Vertex arena that everything
+//   used so far, Get(VertexFormat::Packed) the 24-byte PackedVertex one.
+//   Allocate always takes Vertex data and the packed arena converts it on
+//   upload. Meshes of different formats cannot share a VAO or a multi-draw.
+//
+// SHARED VAOS
+//   The VAO's attributes use separate vertex formats (VertexArray.h), so
+//   each arena keeps two VAOs over its buffers however many meshes it holds:
+//   GetVertexArray() with the layout alone, and GetInstancedVertexArray()
+//   with the InstanceBuffer attributes as well, their buffer left to the
+//   draw: instanced meshes of one format share it and switching between
+//   them rebinds INSTANCE_BINDING only (RenderQueue does this per command).
+//   Two more enable the position attribute alone (GetPositionVertexArray),
+//   for depth-only passes: the shader reads 12 bytes of each vertex and
+//   the vertex fetch skips normals and texture coordinates.
+//
+// VERTEX PULLING
+//   The same buffers can be read as shader storage instead, like
+//   GPUParticleRender.shader reads its particles: BindStorage puts the
+//   vertex buffer at VERTEX_STORAGE_BINDING and the index buffer at
+//   INDEX_STORAGE_BINDING, and a draw through GetEmptyVertexArray() (no
+//   attributes at all) of glDrawArrays(first = firstIndex, indexCount)
+//   gives the vertex shader gl_VertexID = the position in the index buffer.
+//   The shader fetches the index, adds baseVertex (a uniform: drawing
+//   arrays has none) and decodes the vertex itself, so one VAO serves every
+//   mesh and format, and a new encoding needs shader code only, no
+//   VertexLayout. The PULL variant of Mesh, Phong, PBR and DepthPrepass
+//   does this; RenderQueue draws such commands (RenderCommand::pullFrom).
+//   What is lost is the fixed-function fetch and its cache: the post-
+//   transform cache still works (the index is in the vertex ID), but
+//   every attribute is now a storage load.
+//
+// LIFETIME
+//   Each arena is created on first use (which needs a GL context) and
+//   Shutdown() destroys all of them; it must run before the context goes
+//   away.
+// ----------------------------------------------------------------------------
+
+class MeshArena
+{
+public:
+	typedef unsigned int Handle;
+	static const Handle INVALID_HANDLE = 0;
+
+	struct Range
+	{
+		unsigned int baseVertex = 0;
+		unsigned int vertexCount = 0;
+		unsigned int firstIndex = 0;
+		unsigned int indexCount = 0;
+	};
+
+	struct Stats
+	{
+		unsigned int vertexCapacity = 0;
+		unsigned int verticesUsed = 0;
+		unsigned int indexCapacity = 0;
+		unsigned int indicesUsed = 0;
+		unsigned int allocations = 0;
+		unsigned int freeBlocks = 0;     // fragments across both free lists
+		unsigned int defragmentations = 0;
+		unsigned int generation = 0;
+		unsigned int vertexStride = 0;   // bytes per vertex
+	};
+
+	static const unsigned int VERTEX_STORAGE_BINDING = 8;
+	static const unsigned int INDEX_STORAGE_BINDING = 9;
+
+	static MeshArena& Get(VertexFormat format = VertexFormat::Standard);
+	static bool IsAlive(VertexFormat format = VertexFormat::Standard);
+	static void Shutdown();
+
+	MeshArena(const MeshArena&) = delete;
+	MeshArena& operator=(const MeshArena&) = delete;
+	~MeshArena();
+
+	Handle Allocate(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+
+	// A range with nothing uploaded, for data written on the GPU (e.g. by
+	// GeometryFactory's compute generators). Moving it on Defragment or grow
+	// copies buffer to buffer, so GPU-written contents survive like any other.
+	Handle AllocateUninitialised(unsigned int vertexCount, unsigned int indexCount);
+
+	// Indices only (vertexCount 0), for extra index lists over another
+	// range's vertices, e.g. a mesh's LODs. They draw with that range's
+	// baseVertex; this range's own baseVertex is meaningless.
+	Handle AllocateIndices(const std::vector<unsigned int>& indices) { return Allocate(std::vector<Vertex>(), indices); }
+	void Free(Handle handle);
+
+	const Range& GetRange(Handle handle) const { return m_Ranges[handle]; }
+
+	// Move every live range to the front of the buffers, leaving one free
+	// block at the end of each. Bumps the generation.
+	void Defragment();
+
+	unsigned int GetGeneration() const { return m_Generation; }
+	Stats GetStats() const;
+
+	VertexFormat GetVertexFormat() const { return m_Format; }
+	unsigned int GetVertexStride() const { return m_Stride; }
+
+	VertexArray& GetVertexArray() { return *m_VAO; }
+	const VertexArray& GetVertexArray() const { return *m_VAO; }
+	const VertexBuffer& GetVertexBuffer() const { return *m_VBO; }
+	const IndexBuffer& GetIndexBuffer() const { return *m_EBO; }
+
+	// The arena layout plus the instance attributes at
+	// VertexArray::INSTANCE_BINDING, with no InstanceBuffer attached: call
+	// BindInstanceBuffer before drawing (RenderQueue does it for commands).
+	const VertexArray& GetInstancedVertexArray() const { return *m_InstancedVAO; }
+
+	// As the two above with only attribute 0 (the position) enabled, for
+	// depth-only passes such as RenderQueue's depth pre-pass
+	const VertexArray& GetPositionVertexArray() const { return *m_PositionVAO; }
+	const VertexArray& GetInstancedPositionVertexArray() const { return *m_InstancedPositionVAO; }
+
+	// A VAO over the arena buffers with the standard layout but no other
+	// state, for a mesh that needs extra attributes (e.g. an InstanceBuffer)
+	// without affecting every other arena mesh.
+	std::unique_ptr<VertexArray> CreateVertexArray() const;
+	std::unique_ptr<VertexArray> CreatePositionVertexArray() const;
+
+	// See VERTEX PULLING. The buffers are bound whole, so bind again after
+	// an Allocate, which may have grown them.
+	void BindStorage() const;
+	// A VAO with no attributes and no element buffer, shared by every
+	// pulled draw; created on first use, destroyed by Shutdown
+	static const VertexArray& GetEmptyVertexArray();
+	// The PULL variant value that decodes this format: "STANDARD" or "PACKED"
+	static const char* GetPullVariant(VertexFormat format);
+
+private:
+	explicit MeshArena(VertexFormat format);
+
+	// First-fit free list over one buffer's element space
+	class FreeList
+	{
+	public:
+		void Reset(unsigned int used, unsigned int capacity);
+		bool Allocate(unsigned int size, unsigned int& offset);
+		void Free(unsigned int offset, unsigned int size);
+		void Grow(unsigned int oldCapacity, unsigned int newCapacity);
+		unsigned int GetTotalFree() const;
+		unsigned int GetBlockCount() const { return static_cast<unsigned int>(m_Blocks.size()); }
+
+	private:
+		struct Block { unsigned int offset; unsigned int size; };
+		std::vector<Block> m_Blocks;   // sorted by offset, never adjacent
+	};
+
+	void SetupLayout(VertexArray& vao) const;
+	bool Reserve(unsigned int vertexCount, unsigned int indexCount);
+	void GrowVertices(unsigned int minCapacity);
+	void GrowIndices(unsigned int minCapacity);
+
+	std::unique_ptr<VertexArray>  m_VAO;
+	std::unique_ptr<VertexArray>  m_InstancedVAO;
+	std::unique_ptr<VertexArray>  m_PositionVAO;
+	std::unique_ptr<VertexArray>  m_InstancedPositionVAO;
+	std::unique_ptr<VertexBuffer> m_VBO;
+	std::unique_ptr<IndexBuffer>  m_EBO;
+
+	VertexFormat m_Format;
+	unsigned int m_Stride;           // bytes per vertex in m_VBO
+
+	unsigned int m_VertexCapacity;
+	unsigned int m_IndexCapacity;
+	FreeList m_VertexSpace;
+	FreeList m_IndexSpace;
+
+	// Indexed by Handle; slot 0 is reserved for INVALID_HANDLE
+	std::vector<Range> m_Ranges;
+	std::vector<bool>  m_Live;
+	std::vector<Handle> m_FreeHandles;
+
+	unsigned int m_Generation;
+	unsigned int m_Defragmentations;
+};
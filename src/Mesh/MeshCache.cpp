@@ -0,0 +1,489 @@
+#include "MeshCache.h"
+#include "ModelMesh.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+const char* const MeshCache::FILE_EXTENSION = ".meshcache";
+
+// The blobs are used exactly as written, so these must stay plain data
+static_assert(std::is_trivially_copyable<Vertex>::value, "Vertex is stored as raw bytes");
+static_assert(std::is_trivially_copyable<Mesh::LodLevel>::value, "LodLevel is stored as raw bytes");
+static_assert(std::is_trivially_copyable<Meshlet>::value, "Meshlet is stored as raw bytes");
+
+namespace
+{
+	const uint32_t CACHE_MAGIC = 0x4853454D;   // "MESH"
+
+	struct CacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexSize;     // sizeof(Vertex) when written
+		uint32_t options;        // MeshCache::Options
+
+		uint64_t sourceSize;
+		int64_t  sourceTime;     // last_write_time, in the clock's own ticks
+		uint64_t sourceHash;
+
+		uint32_t meshCount;
+		uint32_t lodCount;
+		uint32_t meshletCount;
+		uint32_t textureCount;
+		uint32_t stringBytes;
+		uint32_t padding;
+		uint64_t fileSize;       // catches a file cut short by a crash or full disk
+
+		// MeshOptimizer::Report: before, after (triangles, vertices,
+		// transformed), then vertex buffer sizes before and after
+		uint64_t report[8];
+	};
+
+	struct MeshRecord
+	{
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint64_t lodIndexOffset;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t lodIndexCount;
+		uint32_t firstLod;
+		uint32_t lodCount;
+		uint32_t firstTexture;
+		uint32_t textureCount;
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+		uint32_t padding;
+	};
+
+	struct TextureRecord
+	{
+		uint32_t typeOffset;     // into the string table
+		uint32_t pathOffset;
+	};
+
+	struct CacheState
+	{
+		bool enabled = true;
+	};
+
+	CacheState s_Cache;
+
+	struct SourceStamp
+	{
+		uint64_t size = 0;
+		int64_t time = 0;
+	};
+
+	bool GetStamp(const std::string& path, SourceStamp& stamp)
+	{
+		std::error_code error;
+		const uint64_t size = std::filesystem::file_size(path, error);
+		if (error)
+			return false;
+		const auto time = std::filesystem::last_write_time(path, error);
+		if (error)
+			return false;
+
+		stamp.size = size;
+		stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+		return true;
+	}
+
+	// 64-bit FNV-1a of the whole file, read through a mapping
+	bool HashFile(const std::string& path, uint64_t& hash)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+			return false;
+
+		hash = 14695981039346656037ull;
+		const unsigned char* data = file.GetData();
+		for (std::size_t i = 0; i < file.GetSize(); i++)
+		{
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+		return true;
+	}
+
+	uint64_t Align(uint64_t offset)
+	{
+		return (offset + MeshCache::BLOB_ALIGNMENT - 1) & ~static_cast<uint64_t>(MeshCache::BLOB_ALIGNMENT - 1);
+	}
+
+	const CacheHeader& Header(const MappedFile& file)
+	{
+		return *reinterpret_cast<const CacheHeader*>(file.GetData());
+	}
+
+	const MeshRecord* Meshes(const MappedFile& file)
+	{
+		return reinterpret_cast<const MeshRecord*>(file.GetData() + sizeof(CacheHeader));
+	}
+
+	const Mesh::LodLevel* Lods(const MappedFile& file)
+	{
+		return reinterpret_cast<const Mesh::LodLevel*>(Meshes(file) + Header(file).meshCount);
+	}
+
+	const Meshlet* Meshlets(const MappedFile& file)
+	{
+		return reinterpret_cast<const Meshlet*>(Lods(file) + Header(file).lodCount);
+	}
+
+	const TextureRecord* Textures(const MappedFile& file)
+	{
+		return reinterpret_cast<const TextureRecord*>(Meshlets(file) + Header(file).meshletCount);
+	}
+
+	const char* Strings(const MappedFile& file)
+	{
+		return reinterpret_cast<const char*>(Textures(file) + Header(file).textureCount);
+	}
+
+	// [offset, offset + count * size) lies inside the file and is aligned
+	bool InFile(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize)
+	{
+		return offset % MeshCache::BLOB_ALIGNMENT == 0 && offset <= fileSize
+			&& count <= (fileSize - offset) / size;
+	}
+
+	// Every index of a blob names one of the mesh's vertices
+	bool IndicesInRange(const MappedFile& file, uint64_t offset, uint32_t count, uint32_t vertexCount)
+	{
+		const unsigned int* indices = reinterpret_cast<const unsigned int*>(file.GetData() + offset);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (indices[i] >= vertexCount)
+				return false;
+		}
+		return true;
+	}
+
+	// Every offset in the tables points inside the file, so nothing read
+	// later can run off the end of the mapping, and every index inside its
+	// mesh's vertices, so no draw fetches past them in the arena. Reading
+	// the indices once is far cheaper than the import the cache replaces.
+	bool Validate(const MappedFile& file)
+	{
+		const uint64_t fileSize = file.GetSize();
+		if (fileSize < sizeof(CacheHeader))
+			return false;
+
+		const CacheHeader& header = Header(file);
+		if (header.magic != CACHE_MAGIC || header.version != MeshCache::CACHE_VERSION
+			|| header.vertexSize != sizeof(Vertex) || header.fileSize != fileSize)
+			return false;
+
+		const uint64_t tables = sizeof(CacheHeader)
+			+ uint64_t(header.meshCount) * sizeof(MeshRecord)
+			+ uint64_t(header.lodCount) * sizeof(Mesh::LodLevel)
+			+ uint64_t(header.meshletCount) * sizeof(Meshlet)
+			+ uint64_t(header.textureCount) * sizeof(TextureRecord)
+			+ header.stringBytes;
+		if (tables > fileSize)
+			return false;
+
+		const char* strings = Strings(file);
+		if (header.stringBytes > 0 && strings[header.stringBytes - 1] != '\0')
+			return false;
+
+		const TextureRecord* textures = Textures(file);
+		for (uint32_t t = 0; t < header.textureCount; t++)
+		{
+			if (textures[t].typeOffset >= header.stringBytes || textures[t].pathOffset >= header.stringBytes)
+				return false;
+		}
+
+		const MeshRecord* meshes = Meshes(file);
+		for (uint32_t m = 0; m < header.meshCount; m++)
+		{
+			const MeshRecord& mesh = meshes[m];
+			if (!InFile(mesh.vertexOffset, mesh.vertexCount, sizeof(Vertex), fileSize)
+				|| !InFile(mesh.indexOffset, mesh.indexCount, sizeof(unsigned int), fileSize)
+				|| !InFile(mesh.lodIndexOffset, mesh.lodIndexCount, sizeof(unsigned int), fileSize)
+				|| uint64_t(mesh.firstLod) + mesh.lodCount > header.lodCount
+				|| uint64_t(mesh.firstMeshlet) + mesh.meshletCount > header.meshletCount
+				|| uint64_t(mesh.firstTexture) + mesh.textureCount > header.textureCount)
+				return false;
+
+			if (!IndicesInRange(file, mesh.indexOffset, mesh.indexCount, mesh.vertexCount)
+				|| !IndicesInRange(file, mesh.lodIndexOffset, mesh.lodIndexCount, mesh.vertexCount))
+				return false;
+
+			// Level 0 draws from the mesh's own indices, the rest from its
+			// LOD indices (see Mesh::LodLevel)
+			const Mesh::LodLevel* lods = Lods(file) + mesh.firstLod;
+			for (uint32_t l = 0; l < mesh.lodCount; l++)
+			{
+				const uint64_t available = l == 0 ? mesh.indexCount : mesh.lodIndexCount;
+				if (uint64_t(lods[l].firstIndex) + lods[l].indexCount > available)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+bool MeshCache::Open(const std::string& sourcePath, uint32_t options)
+{
+	Close();
+	if (!s_Cache.enabled)
+		return false;
+
+	SourceStamp stamp;
+	if (!GetStamp(sourcePath, stamp) || !m_File.Open(GetCachePath(sourcePath)))
+		return false;
+
+	if (!Validate(m_File) || Header(m_File).options != options || Header(m_File).sourceSize != stamp.size)
+	{
+		Close();
+		return false;
+	}
+
+	// Touched but maybe not changed: only then pay for reading the source
+	if (Header(m_File).sourceTime != stamp.time)
+	{
+		uint64_t hash = 0;
+		if (!HashFile(sourcePath, hash) || hash != Header(m_File).sourceHash)
+		{
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+std::size_t MeshCache::GetMeshCount() const
+{
+	return m_File.IsOpen() ? Header(m_File).meshCount : 0;
+}
+
+MeshCache::MeshView MeshCache::GetMesh(std::size_t mesh) const
+{
+	const MeshRecord& record = Meshes(m_File)[mesh];
+	const unsigned char* data = m_File.GetData();
+
+	MeshView view;
+	view.vertices = reinterpret_cast<const Vertex*>(data + record.vertexOffset);
+	view.vertexCount = record.vertexCount;
+	view.indices = reinterpret_cast<const unsigned int*>(data + record.indexOffset);
+	view.indexCount = record.indexCount;
+	view.lods = Lods(m_File) + record.firstLod;
+	view.lodCount = record.lodCount;
+	view.lodIndices = reinterpret_cast<const unsigned int*>(data + record.lodIndexOffset);
+	view.lodIndexCount = record.lodIndexCount;
+	view.meshlets = Meshlets(m_File) + record.firstMeshlet;
+	view.meshletCount = record.meshletCount;
+	view.firstTexture = record.firstTexture;
+	view.textureCount = record.textureCount;
+	return view;
+}
+
+const char* MeshCache::GetTextureType(std::size_t texture) const
+{
+	return Strings(m_File) + Textures(m_File)[texture].typeOffset;
+}
+
+const char* MeshCache::GetTexturePath(std::size_t texture) const
+{
+	return Strings(m_File) + Textures(m_File)[texture].pathOffset;
+}
+
+MeshOptimizer::Report MeshCache::GetReport() const
+{
+	const uint64_t* values = Header(m_File).report;
+
+	MeshOptimizer::Report report;
+	report.before.triangles = static_cast<std::size_t>(values[0]);
+	report.before.vertices = static_cast<std::size_t>(values[1]);
+	report.before.transformed = static_cast<std::size_t>(values[2]);
+	report.after.triangles = static_cast<std::size_t>(values[3]);
+	report.after.vertices = static_cast<std::size_t>(values[4]);
+	report.after.transformed = static_cast<std::size_t>(values[5]);
+	report.verticesBefore = static_cast<std::size_t>(values[6]);
+	report.verticesAfter = static_cast<std::size_t>(values[7]);
+	return report;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+static void WritePadding(std::ofstream& file, uint64_t& offset, uint64_t target)
+{
+	static const char zeros[MeshCache::BLOB_ALIGNMENT] = {};
+	file.write(zeros, static_cast<std::streamsize>(target - offset));
+	offset = target;
+}
+
+template<typename T>
+static void WriteBlob(std::ofstream& file, uint64_t& offset, const T* data, std::size_t count)
+{
+	WritePadding(file, offset, Align(offset));
+	if (count > 0)
+		file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+	offset += count * sizeof(T);
+}
+
+bool MeshCache::Write(const std::string& sourcePath, uint32_t options, const std::string& directory,
+	const std::vector<ModelMesh>& meshes, const MeshOptimizer::Report& report)
+{
+	if (!s_Cache.enabled)
+		return false;
+
+	CacheHeader header = {};
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.vertexSize = sizeof(Vertex);
+	header.options = options;
+
+	SourceStamp stamp;
+	if (!GetStamp(sourcePath, stamp) || !HashFile(sourcePath, header.sourceHash))
+		return false;
+	header.sourceSize = stamp.size;
+	header.sourceTime = stamp.time;
+
+	// Tables first, so the blob offsets are known before anything is written
+	std::vector<MeshRecord> records(meshes.size());
+	std::vector<Mesh::LodLevel> lods;
+	std::vector<Meshlet> meshlets;
+	std::vector<TextureRecord> textures;
+	std::string strings;
+
+	const std::string prefix = directory + "/";
+	for (std::size_t m = 0; m < meshes.size(); m++)
+	{
+		const ModelMesh& mesh = meshes[m];
+		MeshRecord& record = records[m];
+		record.vertexCount = static_cast<uint32_t>(mesh.getVertices().size());
+		record.indexCount = static_cast<uint32_t>(mesh.getIndices().size());
+		record.lodIndexCount = static_cast<uint32_t>(mesh.getLodIndices().size());
+
+		record.firstLod = static_cast<uint32_t>(lods.size());
+		record.lodCount = static_cast<uint32_t>(mesh.getLods().size());
+		lods.insert(lods.end(), mesh.getLods().begin(), mesh.getLods().end());
+
+		record.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+		record.meshletCount = static_cast<uint32_t>(mesh.getMeshlets().size());
+		meshlets.insert(meshlets.end(), mesh.getMeshlets().begin(), mesh.getMeshlets().end());
+
+		record.firstTexture = static_cast<uint32_t>(textures.size());
+		record.textureCount = static_cast<uint32_t>(mesh.getTextures().size());
+		for (const MeshTexture& texture : mesh.getTextures())
+		{
+			std::string path = texture.path;
+			if (path.compare(0, prefix.size(), prefix) == 0)
+				path.erase(0, prefix.size());
+
+			TextureRecord entry;
+			entry.typeOffset = static_cast<uint32_t>(strings.size());
+			strings.append(texture.type).push_back('\0');
+			entry.pathOffset = static_cast<uint32_t>(strings.size());
+			strings.append(path).push_back('\0');
+			textures.push_back(entry);
+		}
+	}
+
+	const uint64_t tableBytes = sizeof(CacheHeader) + records.size() * sizeof(MeshRecord)
+		+ lods.size() * sizeof(Mesh::LodLevel) + meshlets.size() * sizeof(Meshlet)
+		+ textures.size() * sizeof(TextureRecord) + strings.size();
+	uint64_t offset = tableBytes;
+	for (std::size_t m = 0; m < meshes.size(); m++)
+	{
+		MeshRecord& record = records[m];
+		record.vertexOffset = Align(offset);
+		record.indexOffset = Align(record.vertexOffset + uint64_t(record.vertexCount) * sizeof(Vertex));
+		record.lodIndexOffset = Align(record.indexOffset + uint64_t(record.indexCount) * sizeof(unsigned int));
+		offset = record.lodIndexOffset + uint64_t(record.lodIndexCount) * sizeof(unsigned int);
+	}
+
+	header.meshCount = static_cast<uint32_t>(records.size());
+	header.lodCount = static_cast<uint32_t>(lods.size());
+	header.meshletCount = static_cast<uint32_t>(meshlets.size());
+	header.textureCount = static_cast<uint32_t>(textures.size());
+	header.stringBytes = static_cast<uint32_t>(strings.size());
+	header.fileSize = offset;
+
+	header.report[0] = report.before.triangles;
+	header.report[1] = report.before.vertices;
+	header.report[2] = report.before.transformed;
+	header.report[3] = report.after.triangles;
+	header.report[4] = report.after.vertices;
+	header.report[5] = report.after.transformed;
+	header.report[6] = report.verticesBefore;
+	header.report[7] = report.verticesAfter;
+
+	// Written under a temporary name and renamed over the old file, so a
+	// load never sees a half-written cache.
+	const std::string path = GetCachePath(sourcePath);
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(MeshRecord));
+		file.write(reinterpret_cast<const char*>(lods.data()), lods.size() * sizeof(Mesh::LodLevel));
+		file.write(reinterpret_cast<const char*>(meshlets.data()), meshlets.size() * sizeof(Meshlet));
+		file.write(reinterpret_cast<const char*>(textures.data()), textures.size() * sizeof(TextureRecord));
+		file.write(strings.data(), strings.size());
+
+		offset = tableBytes;
+		for (const ModelMesh& mesh : meshes)
+		{
+			WriteBlob(file, offset, mesh.getVertices().data(), mesh.getVertices().size());
+			WriteBlob(file, offset, mesh.getIndices().data(), mesh.getIndices().size());
+			WriteBlob(file, offset, mesh.getLodIndices().data(), mesh.getLodIndices().size());
+		}
+
+		if (!file)
+		{
+			file.close();
+			std::error_code ignored;
+			std::filesystem::remove(temporary, ignored);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+	{
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	std::cout << "MeshCache::Write() - wrote \"" << path << "\" (" << offset / 1024 << " KB)\n";
+	return true;
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath)
+{
+	return sourcePath + FILE_EXTENSION;
+}
+
+void MeshCache::Remove(const std::string& sourcePath)
+{
+	std::error_code ignored;
+	std::filesystem::remove(GetCachePath(sourcePath), ignored);
+}
+
+bool MeshCache::IsEnabled()
+{
+	return s_Cache.enabled;
+}
+
+void MeshCache::SetEnabled(bool enabled)
+{
+	s_Cache.enabled = enabled;
+}
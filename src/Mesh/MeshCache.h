@@ -0,0 +1,121 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "../MappedFile.h"
+
+class ModelMesh;
+
+// ----------------------------------------------------------------------------
+// MeshCache
+// ----------------------------------------------------------------------------
+// A model's meshes after import, saved in a binary file next to the source
+// so later loads can skip Assimp entirely.
+//
+// Importing poly.obj costs seconds. Assimp parses the text, triangulates,
+// generates normals and tangents and welds vertices. Then MeshOptimizer
+// reorders every mesh and MeshSimplifier builds its LODs. The result is
+// the same every time, so the first load writes it out:
+//
+//     res/Models/poly.obj  ->  res/Models/poly.obj.meshcache
+//
+// Later loads map that file (MappedFile) and hand the vertex and index
+// blobs to the meshes as they are. Nothing is parsed or converted.
+//
+// LAYOUT (native byte order and struct layout)
+//   CacheHeader                  magic, version, source stamp, counts,
+//                                the MeshOptimizer report
+//   MeshRecord[meshCount]        where each mesh's blobs are, its LOD and
+//                                texture ranges
+//   Mesh::LodLevel[lodCount]     every mesh's levels, level 0 included
+//   Meshlet[meshletCount]        every mesh's clusters (MeshletBuilder.h)
+//   TextureRecord[textureCount]  type + path, as offsets into the strings
+//   strings                      NUL-terminated, paths relative to the model
+//   blobs                        per mesh: Vertex[], indices, LOD indices,
+//                                each starting on a BLOB_ALIGNMENT boundary
+//
+// INVALIDATION
+//   The header records the source file's size, modification time and a
+//   64-bit FNV-1a hash of its contents. Size and time both matching is
+//   enough. If only the time differs (a checkout or copy touched the file),
+//   the source is hashed and the cache is kept when the hash still matches.
+//   The version and sizeof(Vertex) are checked too, and so are the options
+//   that change the import (flipUVs, merging and its vertex limit). Bump
+//   CACHE_VERSION whenever processMesh, MeshOptimizer, GenerateLods or
+//   MeshletBuilder change what they produce.
+//
+// A file that fails any check, or is truncated, is ignored. The caller
+// then imports with Assimp and writes a new one.
+// ----------------------------------------------------------------------------
+
+class MeshCache
+{
+public:
+	static const char* const FILE_EXTENSION;
+	static const uint32_t CACHE_VERSION = 2;
+	static const uint32_t BLOB_ALIGNMENT = 16;
+
+	// Import options that are part of the cached result
+	enum Options : uint32_t
+	{
+		OPTION_FLIP_UVS = 1u << 0,
+		OPTION_MERGE_MESHES = 1u << 1,   // with the vertex limit in the bits above MERGE_LIMIT_SHIFT
+	};
+	static const uint32_t MERGE_LIMIT_SHIFT = 8;
+
+	// Model::MergeOptions::maxVertices, as option bits: a file merged with
+	// another limit holds other meshes
+	static uint32_t MergeLimitOption(uint32_t maxVertices)
+	{
+		return std::min<uint32_t>(maxVertices, ~0u >> MERGE_LIMIT_SHIFT) << MERGE_LIMIT_SHIFT;
+	}
+
+	// One mesh, pointing into the mapped file
+	struct MeshView
+	{
+		const Vertex* vertices = nullptr;
+		uint32_t vertexCount = 0;
+		const unsigned int* indices = nullptr;
+		uint32_t indexCount = 0;
+		const Mesh::LodLevel* lods = nullptr;   // level 0 included
+		uint32_t lodCount = 0;
+		const unsigned int* lodIndices = nullptr;
+		uint32_t lodIndexCount = 0;
+		const Meshlet* meshlets = nullptr;
+		uint32_t meshletCount = 0;
+		uint32_t firstTexture = 0;              // into GetTextureType/Path
+		uint32_t textureCount = 0;
+	};
+
+	// Map the cache for sourcePath if it exists and is still valid for the
+	// source file as it is now. The data stays mapped until Close().
+	bool Open(const std::string& sourcePath, uint32_t options);
+	void Close() { m_File.Close(); }
+
+	std::size_t GetMeshCount() const;
+	MeshView GetMesh(std::size_t mesh) const;
+	const char* GetTextureType(std::size_t texture) const;
+	const char* GetTexturePath(std::size_t texture) const;   // relative to the model's directory
+	MeshOptimizer::Report GetReport() const;
+
+	// Save `meshes` (as Model built them from sourcePath) to its cache file.
+	// Texture paths are stored relative to `directory`. False if the file
+	// could not be written; the model is still usable.
+	static bool Write(const std::string& sourcePath, uint32_t options, const std::string& directory,
+		const std::vector<ModelMesh>& meshes, const MeshOptimizer::Report& report);
+
+	static std::string GetCachePath(const std::string& sourcePath);
+
+	// Delete sourcePath's cache file, so the next load imports from scratch.
+	static void Remove(const std::string& sourcePath);
+
+	static bool IsEnabled();
+	static void SetEnabled(bool enabled);
+
+private:
+	MappedFile m_File;
+};
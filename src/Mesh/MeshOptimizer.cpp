@@ -0,0 +1,436 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+
+static const unsigned int NO_VERTEX = 0xFFFFFFFFu;
+
+// ----------------------------------------------------------------------------
+// FIFO cache simulation
+// ----------------------------------------------------------------------------
+// Each vertex remembers the "time" (miss count) it entered the cache; it is
+// still cached while fewer than cacheSize misses have happened since. Time
+// starts past cacheSize so that a stamp of 0 means "never cached", and
+// Reset() empties the cache by jumping time forward.
+// ----------------------------------------------------------------------------
+
+namespace
+{
+	class FifoCache
+	{
+	public:
+		FifoCache(std::size_t vertexCount, unsigned int size)
+			: m_Stamps(vertexCount, 0), m_Size(size), m_Time(size + 1) {}
+
+		// True on a miss (the vertex is shaded and enters the cache)
+		bool Access(unsigned int vertex)
+		{
+			if (m_Time - m_Stamps[vertex] <= m_Size)
+				return false;
+			m_Stamps[vertex] = m_Time++;
+			return true;
+		}
+
+		// Misses since the vertex entered: > size means it has been evicted
+		unsigned int Age(unsigned int vertex) const { return m_Time - m_Stamps[vertex]; }
+
+		void Reset() { m_Time += m_Size + 1; }
+
+	private:
+		std::vector<unsigned int> m_Stamps;
+		unsigned int m_Size;
+		unsigned int m_Time;
+	};
+
+	// Bitwise hash/equality of whole vertices, looked up by index so the
+	// map stores no copies
+	struct VertexHash
+	{
+		const std::vector<Vertex>* vertices;
+		std::size_t operator()(unsigned int index) const
+		{
+			// FNV-1a
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&(*vertices)[index]);
+			uint32_t hash = 2166136261u;
+			for (std::size_t i = 0; i < sizeof(Vertex); i++)
+				hash = (hash ^ bytes[i]) * 16777619u;
+			return hash;
+		}
+	};
+
+	struct VertexEqual
+	{
+		const std::vector<Vertex>* vertices;
+		bool operator()(unsigned int a, unsigned int b) const
+		{
+			return std::memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(Vertex)) == 0;
+		}
+	};
+
+	glm::vec3 Position(const Vertex& v)
+	{
+		return glm::vec3(v.position[0], v.position[1], v.position[2]);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Statistics
+// ----------------------------------------------------------------------------
+
+void MeshOptimizer::CacheStats::Add(const CacheStats& other)
+{
+	triangles += other.triangles;
+	vertices += other.vertices;
+	transformed += other.transformed;
+}
+
+void MeshOptimizer::Report::Add(const Report& other)
+{
+	before.Add(other.before);
+	after.Add(other.after);
+	verticesBefore += other.verticesBefore;
+	verticesAfter += other.verticesAfter;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices,
+	std::size_t vertexCount, unsigned int cacheSize)
+{
+	CacheStats stats;
+	stats.triangles = indices.size() / 3;
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<char> used(vertexCount, 0);
+	for (unsigned int v : indices)
+	{
+		if (cache.Access(v))
+			stats.transformed++;
+		if (!used[v])
+		{
+			used[v] = 1;
+			stats.vertices++;
+		}
+	}
+	return stats;
+}
+
+// ----------------------------------------------------------------------------
+// Optimize
+// ----------------------------------------------------------------------------
+
+MeshOptimizer::Report MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	Report report;
+	report.verticesBefore = vertices.size();
+	report.before = AnalyzeVertexCache(indices, vertices.size());
+
+	// Only plain triangle lists; anything else is left as it is
+	if (!indices.empty() && indices.size() % 3 == 0)
+	{
+		std::vector<unsigned int> clusters;
+		DeduplicateVertices(vertices, indices);
+		OptimizeVertexCache(indices, vertices.size(), &clusters);
+		OptimizeOverdraw(vertices, indices, clusters);
+		OptimizeVertexFetch(vertices, indices);
+	}
+
+	report.verticesAfter = vertices.size();
+	report.after = AnalyzeVertexCache(indices, vertices.size());
+	return report;
+}
+
+// ----------------------------------------------------------------------------
+// 1. Deduplicate
+// ----------------------------------------------------------------------------
+
+void MeshOptimizer::DeduplicateVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned int> remap(vertices.size());
+	std::vector<Vertex> unique;
+	unique.reserve(vertices.size());
+	{
+		std::unordered_map<unsigned int, unsigned int, VertexHash, VertexEqual> first(
+			vertices.size(), VertexHash{ &vertices }, VertexEqual{ &vertices });
+		for (unsigned int i = 0; i < vertices.size(); i++)
+		{
+			auto inserted = first.emplace(i, static_cast<unsigned int>(unique.size()));
+			if (inserted.second)
+				unique.push_back(vertices[i]);
+			remap[i] = inserted.first->second;
+		}
+	}
+
+	if (unique.size() == vertices.size())
+		return;
+
+	for (unsigned int& index : indices)
+		index = remap[index];
+	vertices.swap(unique);
+}
+
+// ----------------------------------------------------------------------------
+// 2. Tipsify
+// ----------------------------------------------------------------------------
+// Emit every remaining triangle around the current "fanning" vertex, then
+// pick the next fanning vertex among the vertices of those triangles that
+// still have triangles left. The cache window decides which: a candidate
+// whose age (FIFO misses since it was cached) plus 2 per remaining
+// triangle, the most it can add, still fits in `cacheSize` would stay
+// cached while it fans, and scores its age, so the oldest such one wins,
+// being the next to be evicted. A candidate outside that window, evicted
+// already or about to be, scores 0 and is taken only if none is inside.
+//
+// A dead end is a fan that leaves no candidate at all. Every emitted
+// vertex was also pushed onto a dead-end stack; pop it, dropping
+// vertices with nothing left, until one has triangles left and fan from
+// that, the most recent such vertex. An empty stack means the rest is
+// disconnected from everything emitted, and the next vertex in index
+// order with triangles left starts a new piece. Each dead end starts a
+// cluster for OptimizeOverdraw. Linear time: every triangle is emitted
+// once and every stack entry popped at most once.
+// ----------------------------------------------------------------------------
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, std::size_t vertexCount,
+	std::vector<unsigned int>* clusters, unsigned int cacheSize)
+{
+	const std::size_t triangleCount = indices.size() / 3;
+	if (clusters)
+		clusters->clear();
+	if (triangleCount == 0)
+		return;
+
+	// Vertex -> triangles, as one flat array, and triangles left per vertex
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+	std::vector<unsigned int> live(vertexCount, 0);
+	for (std::size_t i = 0; i < triangleCount * 3; i++)
+		live[indices[i]]++;
+	for (std::size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+	std::vector<unsigned int> adjacency(adjacencyStart[vertexCount]);
+	{
+		std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (std::size_t i = 0; i < triangleCount * 3; i++)
+			adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<char> emitted(triangleCount, 0);
+	std::vector<unsigned int> deadEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> result;
+	deadEnd.reserve(triangleCount * 3);
+	result.reserve(triangleCount * 3);
+
+	unsigned int cursor = 0;
+	while (cursor < vertexCount && live[cursor] == 0)
+		cursor++;
+	unsigned int fan = cursor < vertexCount ? cursor : NO_VERTEX;
+	bool restarted = true;
+
+	while (fan != NO_VERTEX)
+	{
+		if (clusters && restarted)
+			clusters->push_back(static_cast<unsigned int>(result.size() / 3));
+
+		candidates.clear();
+		for (unsigned int k = adjacencyStart[fan]; k < adjacencyStart[fan + 1]; k++)
+		{
+			const unsigned int t = adjacency[k];
+			if (emitted[t])
+				continue;
+			emitted[t] = 1;
+
+			for (int c = 0; c < 3; c++)
+			{
+				const unsigned int v = indices[3 * t + c];
+				result.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				cache.Access(v);
+			}
+		}
+
+		unsigned int next = NO_VERTEX;
+		unsigned int bestPriority = 0;
+		for (unsigned int v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+			// Will it survive its own remaining triangles? Then prefer the
+			// oldest, it is the next to be evicted. Otherwise priority 0.
+			const unsigned int age = cache.Age(v);
+			const unsigned int priority = age + 2 * live[v] <= cacheSize ? age : 0;
+			if (next == NO_VERTEX || priority > bestPriority)
+			{
+				next = v;
+				bestPriority = priority;
+			}
+		}
+
+		restarted = next == NO_VERTEX;
+		if (restarted)
+		{
+			while (!deadEnd.empty() && next == NO_VERTEX)
+			{
+				const unsigned int v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0)
+					next = v;
+			}
+			// Nothing recent left: the rest of the mesh is disconnected
+			// from everything emitted so far
+			while (next == NO_VERTEX && cursor < vertexCount)
+			{
+				if (live[cursor] > 0)
+					next = cursor;
+				else
+					cursor++;
+			}
+		}
+		fan = next;
+	}
+
+	indices.swap(result);
+}
+
+// ----------------------------------------------------------------------------
+// 3. Overdraw
+// ----------------------------------------------------------------------------
+// Sander et al.'s linear-speed ordering. Clusters are cut further at "soft
+// boundaries": the running ACMR from the cluster's start has come down to
+// within `threshold` of the whole cluster's, so starting over there with a
+// cold cache (the cluster may move anywhere) costs little. Each cluster is
+// then keyed by how far out it sits along its own facing direction,
+//
+//     dot(centroid - meshCentroid, normal)
+//
+// and drawn outermost first: for a roughly convex object those are the
+// surfaces nearest the camera on whatever side it looks from.
+// ----------------------------------------------------------------------------
+
+void MeshOptimizer::OptimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+	const std::vector<unsigned int>& clusters, float threshold, unsigned int cacheSize)
+{
+	const std::size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || clusters.size() == 0)
+		return;
+
+	// Soft boundaries
+	std::vector<unsigned int> starts;
+	{
+		FifoCache cache(vertices.size(), cacheSize);
+		for (std::size_t c = 0; c < clusters.size(); c++)
+		{
+			const std::size_t begin = clusters[c];
+			const std::size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+			if (begin >= end)
+				continue;
+
+			cache.Reset();
+			std::size_t misses = 0;
+			for (std::size_t i = begin * 3; i < end * 3; i++)
+				misses += cache.Access(indices[i]) ? 1 : 0;
+			const float clusterAcmr = static_cast<float>(misses) / (end - begin);
+
+			cache.Reset();
+			starts.push_back(static_cast<unsigned int>(begin));
+			std::size_t runMisses = 0, runTriangles = 0;
+			for (std::size_t t = begin; t < end; t++)
+			{
+				for (int k = 0; k < 3; k++)
+					runMisses += cache.Access(indices[3 * t + k]) ? 1 : 0;
+				runTriangles++;
+
+				if (t + 1 < end && runMisses <= clusterAcmr * threshold * runTriangles)
+				{
+					starts.push_back(static_cast<unsigned int>(t + 1));
+					runMisses = runTriangles = 0;
+					cache.Reset();
+				}
+			}
+		}
+	}
+
+	// Area-weighted centroid and normal of each cluster and of the mesh
+	struct Cluster
+	{
+		unsigned int begin, end;
+		glm::vec3 centroid;
+		glm::vec3 normal;   // sum of cross products: area-weighted, unnormalised
+		float area;
+		float key;
+	};
+	std::vector<Cluster> list(starts.size());
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	for (std::size_t c = 0; c < starts.size(); c++)
+	{
+		Cluster& cluster = list[c];
+		cluster.begin = starts[c];
+		cluster.end = c + 1 < starts.size() ? starts[c + 1] : static_cast<unsigned int>(triangleCount);
+		cluster.centroid = glm::vec3(0.0f);
+		cluster.normal = glm::vec3(0.0f);
+		cluster.area = 0.0f;
+
+		for (unsigned int t = cluster.begin; t < cluster.end; t++)
+		{
+			const glm::vec3 p0 = Position(vertices[indices[3 * t + 0]]);
+			const glm::vec3 p1 = Position(vertices[indices[3 * t + 1]]);
+			const glm::vec3 p2 = Position(vertices[indices[3 * t + 2]]);
+			const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(n);
+			cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+			cluster.normal += n;
+			cluster.area += area;
+		}
+
+		meshCentroid += cluster.centroid;
+		meshArea += cluster.area;
+		if (cluster.area > 0.0f)
+			cluster.centroid /= cluster.area;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	for (Cluster& cluster : list)
+	{
+		const float length = glm::length(cluster.normal);
+		cluster.key = length > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / length) : 0.0f;
+	}
+
+	std::stable_sort(list.begin(), list.end(),
+		[](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (const Cluster& cluster : list)
+		result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+	indices.swap(result);
+}
+
+// ----------------------------------------------------------------------------
+// 4. Vertex fetch
+// ----------------------------------------------------------------------------
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned int> remap(vertices.size(), NO_VERTEX);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == NO_VERTEX)
+		{
+			remap[index] = static_cast<unsigned int>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(ordered);
+}
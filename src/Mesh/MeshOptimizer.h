@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+#include "Vertex.h"
+
+// ----------------------------------------------------------------------------
+// MeshOptimizer
+// ----------------------------------------------------------------------------
+// Reorders a mesh's vertices and indices so the GPU does less work drawing
+// exactly the same triangles. Applied to every ModelMesh at import.
+//
+// POST-TRANSFORM VERTEX CACHE
+//   The GPU keeps the vertex shader's outputs for the last few indices it
+//   saw; an index that hits this cache is not shaded again. Triangles in
+//   file order jump around the mesh and miss most of the time, so a vertex
+//   shared by six triangles can be shaded six times. Measured as:
+//     ACMR  average cache miss ratio   shaded vertices per triangle
+//                                      (~0.5 is ideal on a big grid, 3 worst)
+//     ATVR  average transformed vertex ratio   shaded / unique vertices
+//                                      (1.0 is ideal: each shaded once)
+//   Both are simulated with a FIFO cache of CACHE_SIZE entries. Real GPUs
+//   differ in the details, but a better FIFO score is better on all of them.
+//
+// THE STAGES (Optimize runs them in this order)
+//   1. DeduplicateVertices   bit-identical vertices become one, so shared
+//                            corners really are shared indices.
+//   2. OptimizeVertexCache   Tipsify (Sander, Nehab & Barczak 2007): fan out
+//                            around a vertex, then continue from the oldest
+//                            vertex just emitted that stays within the cache
+//                            window while it fans; at a dead end, from the
+//                            most recent vertex on a stack of every emitted
+//                            one that still has triangles left.
+//   3. OptimizeOverdraw      cut the Tipsify order into clusters at places
+//                            that barely cost cache hits, then draw clusters
+//                            facing away from the mesh centre first. They
+//                            tend to occlude the rest, so the depth test
+//                            rejects more fragments before shading.
+//   4. OptimizeVertexFetch   renumber vertices in first-use order, so the
+//                            vertex fetch reads memory front to back.
+// ----------------------------------------------------------------------------
+
+class MeshOptimizer
+{
+public:
+	static const unsigned int CACHE_SIZE = 16;
+
+	struct CacheStats
+	{
+		std::size_t triangles = 0;
+		std::size_t vertices = 0;      // unique vertices referenced
+		std::size_t transformed = 0;   // simulated cache misses
+
+		float GetACMR() const { return triangles ? static_cast<float>(transformed) / triangles : 0.0f; }
+		float GetATVR() const { return vertices ? static_cast<float>(transformed) / vertices : 0.0f; }
+		void Add(const CacheStats& other);
+	};
+
+	struct Report
+	{
+		CacheStats before;
+		CacheStats after;
+		std::size_t verticesBefore = 0;   // vertex buffer sizes
+		std::size_t verticesAfter = 0;
+
+		void Add(const Report& other);
+	};
+
+	// All four stages; returns the cache statistics on either side.
+	static Report Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+	static CacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, std::size_t vertexCount,
+		unsigned int cacheSize = CACHE_SIZE);
+
+	static void DeduplicateVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+	// `clusters`, if given, receives the first triangle of each cluster
+	// Tipsify started from a dead end, for OptimizeOverdraw.
+	static void OptimizeVertexCache(std::vector<unsigned int>& indices, std::size_t vertexCount,
+		std::vector<unsigned int>* clusters = nullptr, unsigned int cacheSize = CACHE_SIZE);
+
+	// Reorder whole clusters. Each cluster from OptimizeVertexCache is split
+	// further wherever the ACMR so far is within `threshold` of the
+	// cluster's own, so this loses at most a few percent of cache hits.
+	static void OptimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+		const std::vector<unsigned int>& clusters, float threshold = 1.05f, unsigned int cacheSize = CACHE_SIZE);
+
+	// Drops vertices no index uses.
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+};
@@ -0,0 +1,327 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+
+// ----------------------------------------------------------------------------
+// Quadric
+// ----------------------------------------------------------------------------
+// The symmetric 4x4 matrix p p^T of a plane p = (a, b, c, d), stored as its
+// 10 distinct entries. Doubles: the entries of summed planes span a large
+// range and x^T Q x subtracts nearly equal terms.
+// ----------------------------------------------------------------------------
+
+namespace
+{
+	struct Quadric
+	{
+		double aa = 0, ab = 0, ac = 0, ad = 0;
+		double bb = 0, bc = 0, bd = 0;
+		double cc = 0, cd = 0;
+		double dd = 0;
+
+		static Quadric FromPlane(double a, double b, double c, double d)
+		{
+			Quadric q;
+			q.aa = a * a; q.ab = a * b; q.ac = a * c; q.ad = a * d;
+			q.bb = b * b; q.bc = b * c; q.bd = b * d;
+			q.cc = c * c; q.cd = c * d;
+			q.dd = d * d;
+			return q;
+		}
+
+		void Add(const Quadric& q)
+		{
+			aa += q.aa; ab += q.ab; ac += q.ac; ad += q.ad;
+			bb += q.bb; bc += q.bc; bd += q.bd;
+			cc += q.cc; cd += q.cd;
+			dd += q.dd;
+		}
+
+		// Sum of squared distances from (x, y, z) to the planes
+		double Evaluate(double x, double y, double z) const
+		{
+			return aa * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ bb * y * y + 2 * bc * y * z + 2 * bd * y
+				+ cc * z * z + 2 * cd * z
+				+ dd;
+		}
+	};
+
+	struct Collapse
+	{
+		float cost;
+		unsigned int from;   // vertex that moves
+		unsigned int to;     // vertex it moves onto
+	};
+
+	struct PositionKey
+	{
+		uint32_t x, y, z;
+		bool operator==(const PositionKey& o) const { return x == o.x && y == o.y && z == o.z; }
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const PositionKey& k) const
+		{
+			return (k.x * 73856093u) ^ (k.y * 19349663u) ^ (k.z * 83492791u);
+		}
+	};
+
+	glm::vec3 Position(const Vertex& v)
+	{
+		return glm::vec3(v.position[0], v.position[1], v.position[2]);
+	}
+}
+
+std::vector<unsigned int> MeshSimplifier::Simplify(const std::vector<Vertex>& vertices,
+	const std::vector<unsigned int>& indices, std::size_t targetIndexCount,
+	float maxError, float* error)
+{
+	std::vector<unsigned int> result(indices.begin(), indices.begin() + (indices.size() / 3) * 3);
+	const size_t vertexCount = vertices.size();
+	size_t triangleCount = result.size() / 3;
+	const size_t targetTriangles = targetIndexCount / 3;
+	if (error)
+		*error = 0.0f;
+	if (triangleCount <= targetTriangles || vertexCount == 0)
+		return result;
+
+	// ------------------------------------------------------------------
+	// Positions: vertices that only differ in normal/UV/colour share one
+	// position id, which is what quadrics, seams and borders are about.
+	// ------------------------------------------------------------------
+	std::vector<unsigned int> positionOf(vertexCount);
+	unsigned int positionCount = 0;
+	{
+		std::unordered_map<PositionKey, unsigned int, PositionHash> ids;
+		ids.reserve(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			PositionKey key;
+			std::memcpy(&key.x, &vertices[i].position[0], 4);
+			std::memcpy(&key.y, &vertices[i].position[1], 4);
+			std::memcpy(&key.z, &vertices[i].position[2], 4);
+			auto inserted = ids.emplace(key, positionCount);
+			if (inserted.second)
+				positionCount++;
+			positionOf[i] = inserted.first->second;
+		}
+	}
+
+	// ------------------------------------------------------------------
+	// Locks: seams (one position, several used vertices) and borders
+	// (an edge with only one triangle, or more than two).
+	// ------------------------------------------------------------------
+	std::vector<char> locked(positionCount, 0);
+	{
+		const unsigned int unused = 0xFFFFFFFFu;
+		std::vector<unsigned int> firstVertex(positionCount, unused);
+		for (unsigned int v : result)
+		{
+			unsigned int& first = firstVertex[positionOf[v]];
+			if (first == unused)
+				first = v;
+			else if (first != v)
+				locked[positionOf[v]] = 1;
+		}
+
+		std::vector<uint64_t> edges;
+		edges.reserve(result.size());
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				uint64_t a = positionOf[result[3 * t + e]];
+				uint64_t b = positionOf[result[3 * t + (e + 1) % 3]];
+				if (a == b)
+					continue;
+				edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t j = i + 1;
+			while (j < edges.size() && edges[j] == edges[i])
+				j++;
+			if (j - i != 2)
+			{
+				locked[edges[i] >> 32] = 1;
+				locked[edges[i] & 0xFFFFFFFFu] = 1;
+			}
+			i = j;
+		}
+	}
+
+	// ------------------------------------------------------------------
+	// Quadrics: every triangle's plane at each of its corner positions
+	// ------------------------------------------------------------------
+	std::vector<Quadric> quadrics(positionCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const glm::vec3 p0 = Position(vertices[result[3 * t + 0]]);
+		const glm::vec3 p1 = Position(vertices[result[3 * t + 1]]);
+		const glm::vec3 p2 = Position(vertices[result[3 * t + 2]]);
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		const float length = glm::length(n);
+		if (length <= 0.0f)
+			continue;
+		n /= length;
+
+		const Quadric q = Quadric::FromPlane(n.x, n.y, n.z, -glm::dot(n, p0));
+		for (int c = 0; c < 3; c++)
+			quadrics[positionOf[result[3 * t + c]]].Add(q);
+	}
+
+	std::vector<char> alive(triangleCount, 1);
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<char> touched(vertexCount);
+	std::vector<Collapse> collapses;
+
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	double worstCost = 0.0;
+
+	for (int pass = 0; pass < 64 && triangleCount > targetTriangles; pass++)
+	{
+		// Vertex -> live triangles, as one flat array (CSR)
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0u);
+		for (size_t t = 0; t < alive.size(); t++)
+		{
+			if (alive[t])
+				for (int c = 0; c < 3; c++)
+					adjacencyStart[result[3 * t + c] + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyStart[v + 1] += adjacencyStart[v];
+		adjacency.resize(adjacencyStart[vertexCount]);
+		{
+			std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+			for (size_t t = 0; t < alive.size(); t++)
+			{
+				if (alive[t])
+					for (int c = 0; c < 3; c++)
+						adjacency[fill[result[3 * t + c]]++] = static_cast<unsigned int>(t);
+			}
+		}
+
+		// Cost both directions of every edge whose moving end is free
+		collapses.clear();
+		for (size_t t = 0; t < alive.size(); t++)
+		{
+			if (!alive[t])
+				continue;
+			for (int e = 0; e < 3; e++)
+			{
+				const unsigned int a = result[3 * t + e];
+				const unsigned int b = result[3 * t + (e + 1) % 3];
+				for (int direction = 0; direction < 2; direction++)
+				{
+					const unsigned int from = direction == 0 ? a : b;
+					const unsigned int to = direction == 0 ? b : a;
+					if (locked[positionOf[from]] || positionOf[from] == positionOf[to])
+						continue;
+
+					Quadric q = quadrics[positionOf[from]];
+					q.Add(quadrics[positionOf[to]]);
+					const glm::vec3 p = Position(vertices[to]);
+					const double cost = std::max(0.0, q.Evaluate(p.x, p.y, p.z));
+					if (cost <= maxCost)
+						collapses.push_back({ static_cast<float>(cost), from, to });
+				}
+			}
+		}
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t collapsed = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (triangleCount <= targetTriangles)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			const unsigned int from = collapse.from, to = collapse.to;
+			const glm::vec3 target = Position(vertices[to]);
+
+			// Reject if any surviving triangle around `from` would turn over
+			bool flips = false;
+			for (unsigned int k = adjacencyStart[from]; k < adjacencyStart[from + 1] && !flips; k++)
+			{
+				const unsigned int t = adjacency[k];
+				const unsigned int* tri = &result[3 * t];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+					continue;   // collapses away
+
+				glm::vec3 before[3], after[3];
+				for (int c = 0; c < 3; c++)
+				{
+					before[c] = Position(vertices[tri[c]]);
+					after[c] = tri[c] == from ? target : before[c];
+				}
+				const glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+				// Also refuses to make the triangle degenerate (n1 ~ 0)
+				if (glm::dot(n0, n1) <= 0.25f * glm::length(n0) * glm::length(n1) || glm::dot(n1, n1) <= 0.0f)
+					flips = true;
+			}
+			if (flips)
+				continue;
+
+			// Apply: re-point `from`'s triangles, drop the ones that fold flat
+			for (unsigned int k = adjacencyStart[from]; k < adjacencyStart[from + 1]; k++)
+			{
+				const unsigned int t = adjacency[k];
+				unsigned int* tri = &result[3 * t];
+				for (int c = 0; c < 3; c++)
+				{
+					touched[tri[c]] = 1;
+					if (tri[c] == from)
+						tri[c] = to;
+				}
+				if (positionOf[tri[0]] == positionOf[tri[1]] || positionOf[tri[1]] == positionOf[tri[2]]
+					|| positionOf[tri[2]] == positionOf[tri[0]])
+				{
+					alive[t] = 0;
+					triangleCount--;
+				}
+			}
+			touched[from] = touched[to] = 1;
+
+			quadrics[positionOf[to]].Add(quadrics[positionOf[from]]);
+			worstCost = std::max(worstCost, static_cast<double>(collapse.cost));
+			collapsed++;
+		}
+
+		if (collapsed == 0)
+			break;
+	}
+
+	// Compact the survivors
+	size_t out = 0;
+	for (size_t t = 0; t < alive.size(); t++)
+	{
+		if (!alive[t])
+			continue;
+		for (int c = 0; c < 3; c++)
+			result[out++] = result[3 * t + c];
+	}
+	result.resize(out);
+
+	if (error)
+		*error = static_cast<float>(std::sqrt(worstCost));
+	return result;
+}
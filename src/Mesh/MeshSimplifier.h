@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+
+#include "Vertex.h"
+
+// ----------------------------------------------------------------------------
+// MeshSimplifier
+// ----------------------------------------------------------------------------
+// Reduces a triangle list by repeatedly collapsing edges, for generating
+// levels of detail (see Mesh::GenerateLods).
+//
+// QUADRIC ERROR (Garland & Heckbert)
+//   Every triangle's plane is stored as a quadric Q = p p^T (p = the plane's
+//   a, b, c, d), summed at each of its corners. For a point x, x^T Q x is
+//   the sum of squared distances from x to all those planes: how far the
+//   point has drifted from the surface that was originally there. When an
+//   edge collapses, the survivor inherits both quadrics, so the error keeps
+//   measuring distance to the ORIGINAL surface, not the last approximation.
+//
+// HALF-EDGE COLLAPSE
+//   An edge (a, b) collapses by moving a onto b: every triangle using a
+//   uses b instead, the two triangles along the edge become degenerate and
+//   are dropped. No new vertices are created, so all LODs index the same
+//   vertex buffer and only need their own index range.
+//
+// WHAT IS KEPT
+//   * UV seams: where the same position has several vertices (different
+//     UVs or normals), moving one copy would tear the texture, so seam
+//     positions are locked. A vertex next to a seam may still collapse onto
+//     it, using the seam copy on its own side.
+//   * Open borders are locked so holes and outlines keep their shape.
+//   * A collapse that would flip a triangle over is rejected.
+//
+// PASSES
+//   Each pass costs every edge, sorts them and takes the cheapest collapses
+//   whose neighbourhoods are untouched so far in the pass, until the target
+//   is reached or no collapse stays under maxError.
+// ----------------------------------------------------------------------------
+
+class MeshSimplifier
+{
+public:
+	// Simplify to at most targetIndexCount indices (3 per triangle), never
+	// exceeding maxError (object-space distance). Returns the new index list;
+	// `error`, if given, receives the largest error a collapse introduced.
+	// May stop above the target when every remaining collapse is locked or
+	// too costly.
+	static std::vector<unsigned int> Simplify(const std::vector<Vertex>& vertices,
+		const std::vector<unsigned int>& indices, std::size_t targetIndexCount,
+		float maxError = 1e30f, float* error = nullptr);
+};
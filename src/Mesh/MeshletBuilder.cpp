@@ -0,0 +1,128 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+static glm::vec3 Position(const std::vector<Vertex>& vertices, unsigned int index)
+{
+	const float* p = vertices[index].position;
+	return glm::vec3(p[0], p[1], p[2]);
+}
+
+std::vector<Meshlet> MeshletBuilder::Build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	unsigned int maxVertices, unsigned int maxTriangles)
+{
+	std::vector<Meshlet> meshlets;
+	if (indices.size() < 3 || maxVertices < 3 || maxTriangles == 0)
+		return meshlets;
+
+	// owner[v] is 1 + the meshlet that last used v, so membership of the
+	// current meshlet is a compare and nothing has to be cleared between them
+	std::vector<unsigned int> owner(vertices.size(), 0);
+
+	Meshlet current = {};
+	const std::size_t triangles = indices.size() / 3;
+	for (std::size_t t = 0; t < triangles; t++)
+	{
+		const unsigned int* corners = &indices[t * 3];
+		const unsigned int stamp = static_cast<unsigned int>(meshlets.size()) + 1;
+
+		unsigned int added = 0;
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			// A degenerate triangle repeats a corner; count it once
+			bool repeated = false;
+			for (unsigned int k = 0; k < c; k++)
+				repeated |= corners[k] == corners[c];
+			if (!repeated && owner[corners[c]] != stamp)
+				added++;
+		}
+
+		if (current.triangleCount > 0
+			&& (current.vertexCount + added > maxVertices || current.triangleCount + 1 > maxTriangles))
+		{
+			ComputeBounds(vertices, indices, current);
+			meshlets.push_back(current);
+
+			current = {};
+			current.firstIndex = static_cast<unsigned int>(t * 3);
+			t--;   // again, against the new meshlet
+			continue;
+		}
+
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			if (owner[corners[c]] != stamp)
+			{
+				owner[corners[c]] = stamp;
+				current.vertexCount++;
+			}
+		}
+		current.triangleCount++;
+	}
+
+	ComputeBounds(vertices, indices, current);
+	meshlets.push_back(current);
+	return meshlets;
+}
+
+void MeshletBuilder::ComputeBounds(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	Meshlet& meshlet)
+{
+	const unsigned int first = meshlet.firstIndex;
+	const unsigned int end = first + meshlet.triangleCount * 3;
+
+	glm::vec3 boxMin(1e30f), boxMax(-1e30f);
+	for (unsigned int i = first; i < end; i++)
+	{
+		const glm::vec3 p = Position(vertices, indices[i]);
+		boxMin = glm::min(boxMin, p);
+		boxMax = glm::max(boxMax, p);
+	}
+	meshlet.centre = 0.5f * (boxMin + boxMax);
+
+	float radius = 0.0f;
+	for (unsigned int i = first; i < end; i++)
+		radius = std::max(radius, glm::length(Position(vertices, indices[i]) - meshlet.centre));
+	meshlet.radius = radius;
+
+	// Unit normals from the winding (counter-clockwise is the front);
+	// degenerate triangles have none and take no part
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.triangleCount);
+	glm::vec3 sum(0.0f);
+	for (unsigned int i = first; i < end; i += 3)
+	{
+		const glm::vec3 a = Position(vertices, indices[i]);
+		const glm::vec3 n = glm::cross(Position(vertices, indices[i + 1]) - a, Position(vertices, indices[i + 2]) - a);
+		const float length = glm::length(n);
+		if (length > 0.0f)
+		{
+			normals.push_back(n / length);
+			sum += normals.back();
+		}
+	}
+
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+	const float sumLength = glm::length(sum);
+	if (normals.empty() || sumLength < 1e-6f)
+		return;
+
+	const glm::vec3 axis = sum / sumLength;
+	float minDot = 1.0f;
+	for (const glm::vec3& n : normals)
+		minDot = std::min(minDot, glm::dot(axis, n));
+
+	meshlet.coneAxis = axis;
+
+	// A cone wider than ~84 degrees either side has almost no viewpoints
+	// left from which all of it faces away; not worth the test
+	if (minDot <= 0.1f)
+		return;
+
+	// The cluster faces away from every view direction within 90 degrees
+	// minus the cone's half angle of the axis, i.e. whose cosine to it is
+	// at least sin(half angle)
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
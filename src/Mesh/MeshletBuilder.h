@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+#include "Vertex.h"
+#include "glm/glm.hpp"
+
+// ----------------------------------------------------------------------------
+// Meshlet
+// ----------------------------------------------------------------------------
+// A cluster of a mesh's triangles: a contiguous run of its level-0 index
+// list, with bounds for culling the whole cluster at once. Plain data, so
+// a MeshCache stores it as raw bytes.
+// ----------------------------------------------------------------------------
+struct Meshlet
+{
+	unsigned int firstIndex;      // into the mesh's indices (not the arena)
+	unsigned int triangleCount;
+	unsigned int vertexCount;     // distinct vertices the triangles use
+	unsigned int padding;
+
+	glm::vec3 centre;             // bounding sphere, object space
+	float     radius;
+
+	// Normal cone: every triangle's normal is within the cone around the
+	// axis. coneCutoff is 1 when the normals spread too far to ever cull.
+	glm::vec3 coneAxis;
+	float     coneCutoff;
+};
+
+// ----------------------------------------------------------------------------
+// MeshletBuilder
+// ----------------------------------------------------------------------------
+// Cuts a mesh into meshlets for per-cluster culling (see ClusterCulling.h).
+// A dense model drawn as one glDrawElements sends every triangle to the
+// vertex shader, even the half facing away and the parts off screen; with
+// clusters of ~100 triangles the GPU can drop most of those before any
+// vertex is fetched.
+//
+// SCAN
+//   The triangles are taken in index order and a new meshlet starts when the
+//   next one would take the current past MAX_VERTICES distinct vertices or
+//   MAX_TRIANGLES triangles (the sizes mesh shader hardware prefers). Run
+//   after MeshOptimizer, that order already walks the surface in small
+//   Tipsify fans, so consecutive triangles are neighbours and the clusters
+//   come out compact. The index list itself is not touched: drawing every
+//   meshlet draws exactly the mesh, in the optimised order.
+//
+// BOUNDS
+//   Sphere: centred on the cluster's box, radius to its farthest vertex.
+//   Cone: axis the mean of the triangles' unit normals, cutoff from the
+//   widest angle between the axis and a normal. Looking from the camera,
+//   the cluster is entirely back-facing when
+//
+//       dot(centre - camera, axis) >= coneCutoff * |centre - camera| + radius
+//
+//   (an empty cone, cutoff 1, never satisfies that). Normals are the
+//   triangles' own, from the winding, not the vertex normals.
+// ----------------------------------------------------------------------------
+
+class MeshletBuilder
+{
+public:
+	static const unsigned int MAX_VERTICES = 64;
+	static const unsigned int MAX_TRIANGLES = 124;
+
+	// Meshlets covering `indices` in order. No GL, so it runs on the import
+	// workers with the rest of the cook.
+	static std::vector<Meshlet> Build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+		unsigned int maxVertices = MAX_VERTICES, unsigned int maxTriangles = MAX_TRIANGLES);
+
+	// The bounds above for triangles [firstIndex, firstIndex + 3 * triangleCount)
+	static void ComputeBounds(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+		Meshlet& meshlet);
+};
@@ -1,5 +1,14 @@
 #include "Model.h"
+#include "MeshCache.h"
 
+#include "../Renderer.h"
+#include "../ThreadPool.h"
+#include "../TextureCache.h"
+#include "../TextureStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 
@@ -8,7 +17,6 @@
 #include <assimp/postprocess.h>
 
 #include <glm/glm.hpp>
-#include <glm/ext/matrix_transform.hpp>
 
 // Note: stb_image is NOT included or defined here.  Texture.cpp already
 // defines STB_IMAGE_IMPLEMENTATION (or equivalent) and handles all image
@@ -19,9 +27,11 @@
 // Constructor
 // ============================================================================
 
-Model::Model(const std::string& path, bool flipUVs)
+Model::Model(const std::string& path, bool flipUVs, VertexFormat format, Mesh::CpuData cpuData,
+    const MergeOptions& merge)
+    : m_Format(format)
 {
-    loadModel(path, flipUVs);
+    loadModel(path, flipUVs, cpuData, merge);
 }
 
 // ============================================================================
@@ -30,56 +40,199 @@ Model::Model(const std::string& path, bool flipUVs)
 
 void Model::Draw(Shader& shader)
 {
-    for (ModelMesh& mesh : m_Meshes)
-        mesh.Draw(shader);
+    if (!m_Indirect)
+    {
+        for (ModelMesh& mesh : m_Meshes)
+            mesh.Draw(shader);
+        return;
+    }
+
+    refreshIndirect();
+
+    Renderer renderer;
+    m_IndirectVAO->Bind();
+    MeshArena::Get(m_Format).GetIndexBuffer().Bind();
+
+    // Every material in one table: one call for the whole model
+    if (getMaterialMode() != MaterialTable::Mode::Bound)
+    {
+        m_MaterialTable->GetMaterial().Bind(shader);
+        renderer.DrawIndirect(*m_Indirect, 0, m_Indirect->GetDrawCount(),
+            MeshArena::Get(m_Format).GetIndexBuffer().GetType());
+        return;
+    }
+
+    for (const MaterialGroup& group : m_MaterialGroups)
+    {
+        // Sampler names were resolved once by ModelMesh::BuildMaterial
+        if (group.material)
+            group.material->Bind(shader);
+
+        renderer.DrawIndirect(*m_Indirect, group.firstDraw, group.drawCount,
+            MeshArena::Get(m_Format).GetIndexBuffer().GetType());
+    }
+}
+
+void Model::Submit(RenderQueue& queue, Shader& shader, const glm::mat4& model,
+    uint8_t pass, float depth01) const
+{
+    if (!m_Indirect)
+    {
+        for (const ModelMesh& mesh : m_Meshes)
+            mesh.Submit(queue, shader, model, pass, depth01);
+        return;
+    }
+
+    refreshIndirect();
+
+    if (getMaterialMode() != MaterialTable::Mode::Bound)
+    {
+        RenderCommand cmd;
+        cmd.shader = &shader;
+        cmd.vao = m_IndirectVAO.get();
+        cmd.ibo = &MeshArena::Get(m_Format).GetIndexBuffer();
+        cmd.material = &m_MaterialTable->GetMaterial();
+        cmd.model = model;
+        cmd.indirect = m_Indirect.get();
+        cmd.indirectFirst = 0;
+        cmd.indirectCount = m_Indirect->GetDrawCount();
+
+        queue.Submit(pass, cmd, depth01);
+        return;
+    }
+
+    for (const MaterialGroup& group : m_MaterialGroups)
+    {
+        RenderCommand cmd;
+        cmd.shader = &shader;
+        cmd.vao = m_IndirectVAO.get();
+        cmd.ibo = &MeshArena::Get(m_Format).GetIndexBuffer();
+        cmd.material = group.material;
+        cmd.model = model;
+        cmd.indirect = m_Indirect.get();
+        cmd.indirectFirst = group.firstDraw;
+        cmd.indirectCount = group.drawCount;
+
+        queue.Submit(pass, cmd, depth01);
+    }
 }
 
 // ============================================================================
-// Transform helpers
+// loadModel
 // ============================================================================
 
-void Model::setPosition(const glm::vec3& position)
+static float MillisecondsSince(std::chrono::steady_clock::time_point start)
 {
-    m_Position = position;
-    for (ModelMesh& mesh : m_Meshes)
-        mesh.setPosition(position);
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
-void Model::setRotation(const glm::vec3& rotation)
+void Model::loadModel(const std::string& path, bool flipUVs, Mesh::CpuData cpuData, const MergeOptions& merge)
 {
-    m_Rotation = rotation;
+    const auto start = std::chrono::steady_clock::now();
+
+    m_Directory = path.substr(0, path.find_last_of("/\\"));
+    m_Timings = LoadTimings();
+    m_Timings.threads = ThreadPool::Get().GetThreadCount();
+
+    uint32_t options = flipUVs ? MeshCache::OPTION_FLIP_UVS : 0u;
+    if (merge.enabled)
+        options |= MeshCache::OPTION_MERGE_MESHES | MeshCache::MergeLimitOption(merge.maxVertices);
+    m_LoadedFromCache = loadCached(path, options);
+    if (!m_LoadedFromCache)
+    {
+        importModel(path, flipUVs, merge);
+        MeshCache::Write(path, options, m_Directory, m_Meshes, m_OptimizationReport);
+    }
+
+    // The meshes inherit the model's transform (see TransformHierarchy.h)
+    std::size_t lodLevels = 0;
+    std::size_t meshlets = 0;
     for (ModelMesh& mesh : m_Meshes)
-        mesh.setRotation(rotation);
+    {
+        mesh.setParent(m_Transform.GetNode());
+        lodLevels += mesh.getLodCount();
+        meshlets += mesh.getMeshlets().size();
+    }
+    m_MeshLods.assign(m_Meshes.size(), 0);
+
+    buildIndirect();
+
+    // Each ModelMesh computed its bounds in SetupMesh; merge them
+    for (std::size_t i = 0; i < m_Meshes.size(); ++i)
+        m_Bounds = i == 0 ? m_Meshes[i].getLocalBounds() : Bounds::Merge(m_Bounds, m_Meshes[i].getLocalBounds());
+
+    // Everything above (and the cache write) read the CPU copies; nothing
+    // after needs more than the policy keeps
+    releaseCpuData(cpuData);
+
+    m_Timings.total = MillisecondsSince(start);
+
+    std::cout << "Model::loadModel() - loaded \"" << path
+        << "\": " << m_Meshes.size() << " mesh(es), " << lodLevels << " LOD level(s), " << meshlets << " meshlet(s) in "
+        << m_Timings.total << " ms (" << (m_LoadedFromCache ? "mesh cache" : "Assimp") << ").\n";
+    if (merge.enabled && !m_LoadedFromCache)
+        std::cout << "Model::loadModel() - merged " << m_SourceMeshCount << " node mesh(es) into "
+            << m_Meshes.size() << " by material\n";
+
+    std::cout << "Model::loadModel() - parse " << m_Timings.parse << " ms, convert "
+        << m_Timings.convert << " ms, decode " << m_Timings.decode << " ms (" << m_Timings.parallel
+        << " ms wall on " << m_Timings.threads << " thread(s)), upload " << m_Timings.upload << " ms\n";
+
+    const MeshOptimizer::Report& report = m_OptimizationReport;
+    std::cout << "Model::loadModel() - vertex cache: ACMR " << report.before.GetACMR()
+        << " -> " << report.after.GetACMR() << ", ATVR " << report.before.GetATVR()
+        << " -> " << report.after.GetATVR() << ", vertices " << report.verticesBefore
+        << " -> " << report.verticesAfter << "\n";
+
+    std::cout << "Model::loadModel() - CPU copies: " << getCpuBytes() / (1024.0f * 1024.0f) << " MB kept, "
+        << m_CpuBytesReleased / (1024.0f * 1024.0f) << " MB released\n";
 }
 
-void Model::setScale(const glm::vec3& scale)
+// ============================================================================
+// CPU copies
+// ============================================================================
+
+std::size_t Model::releaseCpuData(Mesh::CpuData keep)
 {
-    m_Scale = scale;
+    std::size_t released = 0;
     for (ModelMesh& mesh : m_Meshes)
-        mesh.setScale(scale);
+        released += mesh.ReleaseCpuData(keep);
+    m_CpuBytesReleased += released;
+    return released;
 }
 
-glm::mat4 Model::getTransformMatrix() const
+std::size_t Model::getCpuBytes() const
 {
-    glm::mat4 transform = glm::mat4(1.0f);
-
-    transform = glm::translate(transform, m_Position);
-
-    transform = glm::rotate(transform, glm::radians(m_Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-    transform = glm::rotate(transform, glm::radians(m_Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-    transform = glm::rotate(transform, glm::radians(m_Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-
-    transform = glm::scale(transform, m_Scale);
-
-    return transform;
+    std::size_t bytes = 0;
+    for (const ModelMesh& mesh : m_Meshes)
+        bytes += mesh.getCpuBytes();
+    return bytes;
 }
 
 // ============================================================================
-// loadModel
+// importModel
+// ============================================================================
+//
+// The cold path, in four stages:
+//
+//   parse    Assimp reads the file (main thread; one importer call), and the
+//            node tree is walked for the meshes to import; with merging,
+//            mergeMeshes groups them by material first.
+//   convert  one ThreadPool task per imported mesh: processMesh, which fills
+//            plain vectors and runs MeshOptimizer and the LOD builder.
+//   decode   one task per image not loaded yet: Texture::Decode.
+//   upload   back on the main thread, which owns the GL context: the images
+//            become Textures and the meshes are copied into the MeshArena.
+//
+// Convert and decode tasks go into the same queue and run side by side, so
+// a model with many meshes or images keeps every worker busy. The aiScene
+// stays alive (it belongs to the importer) until every task has finished.
 // ============================================================================
 
-void Model::loadModel(const std::string& path, bool flipUVs)
+void Model::importModel(const std::string& path, bool flipUVs, const MergeOptions& merge)
 {
+    auto stageStart = std::chrono::steady_clock::now();
+
     Assimp::Importer importer;
 
     // Post-processing flags:
@@ -88,14 +241,20 @@ void Model::loadModel(const std::string& path, bool flipUVs)
     //                                that do not already have them.
     //   aiProcess_CalcTangentSpace - Populate tangent/bitangent vectors,
     //                                useful if normal mapping is added later.
+    //   aiProcess_JoinIdenticalVertices - Share vertices between faces.
+    //                                Some importers (OBJ) emit one vertex per
+    //                                face corner, which leaves LOD generation
+    //                                nothing to collapse: every position would
+    //                                look like a UV seam.
     //
     // aiProcess_FlipUVs is intentionally omitted by default because
-    // Texture::Texture() calls stbi_set_flip_vertically_on_load(1), which
+    // Texture::Decode() turns on stb_image's vertical flip, which
     // already corrects the V coordinate at image-decode time.  See the
     // Model.h header comment for a full explanation.
     unsigned int flags = aiProcess_Triangulate
         | aiProcess_GenSmoothNormals
-        | aiProcess_CalcTangentSpace;
+        | aiProcess_CalcTangentSpace
+        | aiProcess_JoinIdenticalVertices;
 
     if (flipUVs)
         flags |= aiProcess_FlipUVs;
@@ -109,12 +268,172 @@ void Model::loadModel(const std::string& path, bool flipUVs)
         throw std::runtime_error("Failed to load model: " + path);
     }
 
-    m_Directory = path.substr(0, path.find_last_of("/\\"));
+    m_Timings.parse = MillisecondsSince(stageStart);
 
-    processNode(scene->mRootNode, scene);
+    // Which aiMeshes are drawn, in node order
+    std::vector<NodeMesh> nodeMeshes;
+    processNode(scene->mRootNode, aiMatrix4x4(), nodeMeshes);
+    m_SourceMeshCount = nodeMeshes.size();
 
-    std::cout << "Model::loadModel() - loaded \"" << path
-        << "\": " << m_Meshes.size() << " mesh(es).\n";
+    // What each imported mesh is made of, and the imported mesh of each
+    // ModelMesh. Unmerged, an aiMesh used by several nodes is converted
+    // once (in its own space) and becomes several ModelMeshes.
+    std::vector<std::vector<NodeMesh>> parts;
+    std::vector<unsigned int> order;
+    if (merge.enabled)
+    {
+        mergeMeshes(scene, nodeMeshes, merge.maxVertices, parts);
+        for (unsigned int i = 0; i < parts.size(); ++i)
+            order.push_back(i);
+    }
+    else
+    {
+        parts.resize(scene->mNumMeshes);
+        for (const NodeMesh& nodeMesh : nodeMeshes)
+        {
+            if (parts[nodeMesh.mesh].empty())
+                parts[nodeMesh.mesh].push_back(NodeMesh{ nodeMesh.mesh, aiMatrix4x4() });
+            order.push_back(nodeMesh.mesh);
+        }
+    }
+
+    std::vector<ImportedMesh> imported(parts.size());
+    std::vector<char> used(parts.size(), 0);
+    std::vector<std::string> imagePaths;
+    for (unsigned int index : order)
+    {
+        if (used[index])
+            continue;
+        used[index] = 1;
+
+        // A merged mesh's parts share their textures
+        loadImportedTextures(scene, scene->mMeshes[parts[index][0].mesh]->mMaterialIndex, imported[index].textures);
+        for (const ImportedTexture& texture : imported[index].textures)
+            imagePaths.push_back(texture.path);
+    }
+
+    // ------------------------------------------------------------------
+    // Convert + decode on the workers
+    // ------------------------------------------------------------------
+    stageStart = std::chrono::steady_clock::now();
+    ThreadPool& pool = ThreadPool::Get();
+
+    std::vector<std::future<DecodedImage>> decodes = decodeTextures(imagePaths);
+
+    TaskGroup converts(pool);
+    for (unsigned int index = 0; index < parts.size(); ++index)
+    {
+        if (used[index])
+            converts.Run([scene, &source = parts[index], &result = imported[index]]()
+                {
+                    processMesh(scene, source, result);
+                });
+    }
+
+    // Wait only rethrows once every convert has finished, so one that
+    // threw leaves none running on `imported` as this function unwinds.
+    // The decodes own their inputs and can be abandoned.
+    converts.Wait();
+    for (std::future<DecodedImage>& decode : decodes)
+        decode.wait();
+    m_Timings.parallel = MillisecondsSince(stageStart);
+
+    // ------------------------------------------------------------------
+    // Upload on the GL thread
+    // ------------------------------------------------------------------
+    stageStart = std::chrono::steady_clock::now();
+    uploadTextures(decodes);
+
+    // A mesh drawn by several nodes is copied for each but its last use,
+    // which takes the arrays over
+    std::vector<unsigned int> uses(parts.size(), 0);
+    for (unsigned int index : order)
+        uses[index]++;
+
+    m_Meshes.reserve(order.size());
+    for (unsigned int index : order)
+    {
+        ImportedMesh& mesh = imported[index];
+        m_OptimizationReport.Add(mesh.report);
+
+        std::vector<MeshTexture> textures;
+        textures.reserve(mesh.textures.size());
+        for (const ImportedTexture& texture : mesh.textures)
+            textures.push_back(loadTexture(texture.path, texture.type));
+
+        if (--uses[index] == 0)
+            m_Meshes.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), textures, m_Format);
+        else
+            m_Meshes.emplace_back(mesh.vertices, mesh.indices, textures, m_Format);
+        m_Meshes.back().SetLods(mesh.lods, mesh.lodIndices);
+        m_Meshes.back().SetMeshlets(mesh.meshlets);
+    }
+
+    for (const ImportedMesh& mesh : imported)
+        m_Timings.convert += mesh.milliseconds;
+    m_Timings.upload += MillisecondsSince(stageStart);
+}
+
+// ============================================================================
+// loadCached
+// ============================================================================
+//
+// The warm path: the meshes exactly as importModel left them, read from the
+// mapped MeshCache file. The blobs are copied once into each Mesh's CPU
+// copy and uploaded from there. The images are still decoded from their
+// files, on the workers, as in importModel.
+// ============================================================================
+
+bool Model::loadCached(const std::string& path, uint32_t options)
+{
+    auto stageStart = std::chrono::steady_clock::now();
+
+    MeshCache cache;
+    if (!cache.Open(path, options))
+        return false;
+
+    std::vector<std::string> imagePaths;
+    for (std::size_t m = 0; m < cache.GetMeshCount(); ++m)
+    {
+        const MeshCache::MeshView view = cache.GetMesh(m);
+        for (uint32_t t = view.firstTexture; t < view.firstTexture + view.textureCount; ++t)
+            imagePaths.push_back(m_Directory + "/" + cache.GetTexturePath(t));
+    }
+    m_Timings.parse = MillisecondsSince(stageStart);
+
+    stageStart = std::chrono::steady_clock::now();
+    std::vector<std::future<DecodedImage>> decodes = decodeTextures(imagePaths);
+    for (std::future<DecodedImage>& decode : decodes)
+        decode.wait();
+    m_Timings.parallel = MillisecondsSince(stageStart);
+
+    stageStart = std::chrono::steady_clock::now();
+    uploadTextures(decodes);
+
+    m_Meshes.reserve(cache.GetMeshCount());
+    for (std::size_t m = 0; m < cache.GetMeshCount(); ++m)
+    {
+        const MeshCache::MeshView view = cache.GetMesh(m);
+
+        std::vector<MeshTexture> textures;
+        textures.reserve(view.textureCount);
+        for (uint32_t t = view.firstTexture; t < view.firstTexture + view.textureCount; ++t)
+            textures.push_back(loadTexture(m_Directory + "/" + cache.GetTexturePath(t), cache.GetTextureType(t)));
+
+        m_Meshes.emplace_back(
+            std::vector<Vertex>(view.vertices, view.vertices + view.vertexCount),
+            std::vector<unsigned int>(view.indices, view.indices + view.indexCount),
+            textures, m_Format);
+
+        m_Meshes.back().SetLods(
+            std::vector<Mesh::LodLevel>(view.lods, view.lods + view.lodCount),
+            std::vector<unsigned int>(view.lodIndices, view.lodIndices + view.lodIndexCount));
+        m_Meshes.back().SetMeshlets(std::vector<Meshlet>(view.meshlets, view.meshlets + view.meshletCount));
+    }
+
+    m_OptimizationReport = cache.GetReport();
+    m_Timings.upload = MillisecondsSince(stageStart);
+    return true;
 }
 
 // ============================================================================
@@ -124,54 +443,369 @@ void Model::loadModel(const std::string& path, bool flipUVs)
 // Assimp stores geometry in a tree of aiNode objects.  Each node holds indices
 // into aiScene::mMeshes rather than the mesh data directly.  The full tree is
 // traversed recursively so that geometry nested in child nodes (common in FBX
-// files) is not missed.
+// files) is not missed. Each mesh is recorded with its node's transform to
+// model space (the parents' times the node's own), for merging to bake in.
+// A node whose transform is singular is left out with its children.
 // ============================================================================
 
-void Model::processNode(const aiNode* node, const aiScene* scene)
+void Model::processNode(const aiNode* node, const aiMatrix4x4& parentTransform, std::vector<NodeMesh>& nodeMeshes)
 {
-    for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+    const aiMatrix4x4 transform = parentTransform * node->mTransformation;
+
+    // A zero scale (here or above) flattens the node's geometry to a plane
+    // or a point: nothing to see, and no inverse for the normal matrix,
+    // which would come out NaN. Its subtree inherits the scale, so it goes
+    // too. The negated comparison also catches a NaN determinant.
+    if (!(std::fabs(transform.Determinant()) > 0.0f))
     {
-        const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        m_Meshes.push_back(processMesh(mesh, scene));
+        std::cout << "WARNING:: Model node \"" << node->mName.C_Str() << "\" has a zero scale; skipped\n";
+        return;
     }
 
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+        nodeMeshes.push_back(NodeMesh{ node->mMeshes[i], transform });
+
     for (unsigned int i = 0; i < node->mNumChildren; ++i)
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], transform, nodeMeshes);
+}
+
+// ============================================================================
+// mergeMeshes
+// ============================================================================
+//
+// Groups the node meshes by material, in node order: each goes into the
+// open group of its material unless that would take the group past
+// maxVertices, in which case it starts a new one. Materials are compared
+// by the textures they name (type and path), the only part of an
+// aiMaterial a ModelMesh uses, so two materials that differ only in
+// properties nothing reads still merge. Primitive types are part of the
+// key too: a line mesh never joins a triangle mesh.
+// ============================================================================
+
+void Model::mergeMeshes(const aiScene* scene, const std::vector<NodeMesh>& nodeMeshes, unsigned int maxVertices,
+    std::vector<std::vector<NodeMesh>>& merged) const
+{
+    std::unordered_map<std::string, std::size_t> open;   // material key -> group still taking meshes
+    std::vector<unsigned int> groupVertices;
+
+    std::vector<ImportedTexture> textures;
+    for (const NodeMesh& nodeMesh : nodeMeshes)
+    {
+        const aiMesh* mesh = scene->mMeshes[nodeMesh.mesh];
+
+        textures.clear();
+        loadImportedTextures(scene, mesh->mMaterialIndex, textures);
+        std::string key = std::to_string(mesh->mPrimitiveTypes);
+        for (const ImportedTexture& texture : textures)
+            key += "|" + texture.type + "=" + texture.path;
+
+        auto it = open.find(key);
+        if (it == open.end() || groupVertices[it->second] + mesh->mNumVertices > maxVertices)
+        {
+            merged.emplace_back();
+            groupVertices.push_back(0);
+            it = open.insert_or_assign(key, merged.size() - 1).first;
+        }
+
+        merged[it->second].push_back(nodeMesh);
+        groupVertices[it->second] += mesh->mNumVertices;
+    }
+}
+
+// ============================================================================
+// buildIndirect
+// ============================================================================
+//
+// Records a DrawElementsIndirectCommand for each sub-mesh over the range
+// its geometry occupies in the MeshArena. Indices stay relative to their
+// own mesh; baseVertex shifts them to where that mesh's vertices landed in
+// the shared buffer.
+//
+// Meshes are visited in material order so meshes that bind the same
+// textures form one contiguous command range (a MaterialGroup).
+// ============================================================================
+
+static bool SameTextures(const RenderMaterial& a, const RenderMaterial& b)
+{
+    if (a.textureCount != b.textureCount)
+        return false;
+    for (unsigned int t = 0; t < a.textureCount; ++t)
+    {
+        if (a.textures[t] != b.textures[t] || a.samplerNames[t] != b.samplerNames[t])
+            return false;
+    }
+    return true;
+}
+
+void Model::buildIndirect()
+{
+    if (m_Meshes.empty())
+        return;
+
+    std::vector<std::size_t> order(m_Meshes.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    // Order by the full texture set so every mesh sharing a material ends up
+    // adjacent, not just meshes sharing a diffuse map.
+    std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b)
+        {
+            const RenderMaterial& ma = m_Meshes[a].getMaterial();
+            const RenderMaterial& mb = m_Meshes[b].getMaterial();
+            return std::lexicographical_compare(ma.textures, ma.textures + ma.textureCount,
+                mb.textures, mb.textures + mb.textureCount);
+        });
+
+    m_Indirect = std::make_unique<DrawIndirectBuffer>();
+
+    for (std::size_t i : order)
+    {
+        const RenderMaterial& material = m_Meshes[i].getMaterial();
+
+        const RenderMaterial* groupMaterial = material.textureCount > 0 ? &material : nullptr;
+        bool startGroup = true;
+        if (!m_MaterialGroups.empty())
+        {
+            const RenderMaterial* current = m_MaterialGroups.back().material;
+            if (!current && !groupMaterial)
+                startGroup = false;
+            else if (current && groupMaterial && SameTextures(*current, *groupMaterial))
+                startGroup = false;
+        }
+
+        if (startGroup)
+        {
+            MaterialGroup group;
+            group.material = groupMaterial;
+            group.firstDraw = static_cast<unsigned int>(m_DrawMeshes.size());
+            group.drawCount = 0;
+            m_MaterialGroups.push_back(group);
+        }
+
+        m_DrawMeshes.push_back(i);
+        m_DrawGroups.push_back(static_cast<unsigned int>(m_MaterialGroups.size() - 1));
+        m_MaterialGroups.back().drawCount++;
+    }
+
+    recordIndirect();
+
+    // The draws' material index is their group, so the table follows the groups
+    m_MaterialTable = std::make_unique<MaterialTable>();
+    for (const MaterialGroup& group : m_MaterialGroups)
+        m_MaterialTable->AddMaterial(m_Meshes[m_DrawMeshes[group.firstDraw]].getTextures());
+
+    m_IndirectVAO = MeshArena::Get(m_Format).CreateVertexArray();
+    m_IndirectVAO->AddDrawIndirectBuffer(*m_Indirect);
+    m_IndirectVAO->unBind();
+
+    std::cout << "Model::buildIndirect() - " << m_Meshes.size() << " mesh(es) in "
+        << m_MaterialGroups.size() << " material group(s).\n";
+}
+
+MaterialTable::Mode Model::prepareMaterials()
+{
+    return m_MaterialTable ? m_MaterialTable->Update() : MaterialTable::Mode::Bound;
+}
+
+// (Re)write the indirect commands from the meshes' current arena ranges.
+void Model::recordIndirect() const
+{
+    const MeshArena& arena = MeshArena::Get(m_Format);
+
+    m_Indirect->Clear();
+    for (std::size_t draw = 0; draw < m_DrawMeshes.size(); ++draw)
+    {
+        const std::size_t mesh = m_DrawMeshes[draw];
+        const MeshArena::Range range = m_Meshes[mesh].getLodRange(m_MeshLods[mesh]);
+
+        // The material index selects the draw's MaterialTable entry; on
+        // the per-group path the textures are bound once per group instead.
+        m_Indirect->Add(range.indexCount, range.firstIndex, static_cast<int>(range.baseVertex),
+            glm::mat4(1.0f), m_DrawGroups[draw]);
+    }
+    m_Indirect->Upload();
+
+    m_IndirectGeneration = arena.GetGeneration();
+}
+
+// MeshArena::Defragment moves ranges; re-record if it ran since last time.
+void Model::refreshIndirect() const
+{
+    if (m_IndirectGeneration != MeshArena::Get(m_Format).GetGeneration())
+        recordIndirect();
+}
+
+// ============================================================================
+// Level of detail
+// ============================================================================
+
+// How far under the threshold the next coarser level must be before a mesh
+// switches to it, as a fraction of the threshold.
+static const float LOD_HYSTERESIS = 0.25f;
+
+float Model::ProjectionScale(float viewportHeight, float fovYRadians)
+{
+    return viewportHeight / (2.0f * std::tan(fovYRadians * 0.5f));
+}
+
+std::size_t Model::selectLods(const glm::mat4& model, const glm::vec3& cameraPosition,
+    float projectionScale, float thresholdPixels)
+{
+    // The errors are distances, so they scale with the largest axis scale
+    const float scale = std::max(glm::length(glm::vec3(model[0])),
+        std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+    std::size_t changed = 0;
+    for (std::size_t m = 0; m < m_Meshes.size(); ++m)
+    {
+        const ModelMesh& mesh = m_Meshes[m];
+        const std::size_t levels = mesh.getLodCount();
+        if (levels < 2)
+            continue;
+
+        // Inside the bounding sphere counts as right up against the camera
+        const Bounds bounds = mesh.getWorldBounds(model);
+        const float distance = std::max(glm::length(bounds.centre - cameraPosition) - bounds.radius, 1e-4f);
+        const float pixelsPerUnit = scale / distance * projectionScale;
+
+        std::size_t lod = std::min(m_MeshLods[m], levels - 1);
+        while (lod > 0 && mesh.getLodError(lod) * pixelsPerUnit > thresholdPixels)
+            --lod;
+        while (lod + 1 < levels && mesh.getLodError(lod + 1) * pixelsPerUnit <= thresholdPixels * (1.0f - LOD_HYSTERESIS))
+            ++lod;
+
+        if (lod != m_MeshLods[m])
+        {
+            m_MeshLods[m] = lod;
+            ++changed;
+        }
+    }
+
+    if (changed > 0 && m_Indirect)
+        recordIndirect();
+    return changed;
+}
+
+void Model::forceLod(std::size_t level)
+{
+    bool changed = false;
+    for (std::size_t m = 0; m < m_Meshes.size(); ++m)
+    {
+        const std::size_t count = m_Meshes[m].getLodCount();
+        const std::size_t lod = count > 0 ? std::min(level, count - 1) : 0;
+        changed |= lod != m_MeshLods[m];
+        m_MeshLods[m] = lod;
+    }
+
+    if (changed && m_Indirect)
+        recordIndirect();
 }
 
 // ============================================================================
 // processMesh
 // ============================================================================
 //
-// Converts a single aiMesh into a ModelMesh by:
-//   1. Copying vertex attributes into our Vertex layout.
-//   2. Flattening face index lists into a flat unsigned int vector.
-//   3. Loading textures from the referenced aiMaterial via loadMaterialTextures.
+// Converts one aiMesh, or the parts mergeMeshes grouped, into plain
+// vectors by:
+//   1. Copying vertex attributes into our Vertex layout, each part's after
+//      the last; a part with a transform has its positions and normals
+//      taken to model space.
+//   2. Flattening face index lists into a flat unsigned int vector, offset
+//      by the part's first vertex (and rewound where the transform mirrors).
+//   3. Reordering both for the GPU's vertex cache, overdraw and vertex
+//      fetch (MeshOptimizer).
+//   4. Building the coarser LODs (Mesh::BuildLods).
+//   5. Cutting level 0 into meshlets for ClusterCulling (MeshletBuilder).
+//
+// Runs on a ThreadPool worker: it only reads the aiMeshes and writes
+// `result`, and makes no GL calls.
 // ============================================================================
 
-ModelMesh Model::processMesh(const aiMesh* mesh, const aiScene* scene)
+void Model::processMesh(const aiScene* scene, const std::vector<NodeMesh>& parts, ImportedMesh& result)
 {
-    std::vector<Vertex>       vertices;
-    std::vector<unsigned int> indices;
-    std::vector<MeshTexture>  textures;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<Vertex>&       vertices = result.vertices;
+    std::vector<unsigned int>& indices = result.indices;
+
+    std::size_t vertexTotal = 0, indexTotal = 0;
+    for (const NodeMesh& part : parts)
+    {
+        vertexTotal += scene->mMeshes[part.mesh]->mNumVertices;
+        indexTotal += scene->mMeshes[part.mesh]->mNumFaces * 3;
+    }
+    vertices.reserve(vertexTotal);
+    indices.reserve(indexTotal);
 
-    vertices.reserve(mesh->mNumVertices);
-    indices.reserve(mesh->mNumFaces * 3);
+    for (const NodeMesh& part : parts)
+    {
+        const aiMesh* mesh = scene->mMeshes[part.mesh];
+        const unsigned int firstVertex = static_cast<unsigned int>(vertices.size());
+
+        // Normals go through the inverse transpose, so a non-uniform scale
+        // keeps them perpendicular to the surface
+        const bool transformed = !part.transform.IsIdentity();
+        aiMatrix3x3 normalMatrix = aiMatrix3x3(part.transform);
+        normalMatrix.Inverse().Transpose();
+        const bool mirrored = transformed && part.transform.Determinant() < 0.0f;
+
+        appendVertices(mesh, transformed ? &part.transform : nullptr, normalMatrix, vertices);
+
+        // --------------------------------------------------------------
+        // Indices
+        // --------------------------------------------------------------
+        // After aiProcess_Triangulate every face has exactly 3 indices.
+        for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
+        {
+            const aiFace& face = mesh->mFaces[i];
+            const std::size_t first = indices.size();
+            for (unsigned int j = 0; j < face.mNumIndices; ++j)
+                indices.push_back(firstVertex + face.mIndices[j]);
+
+            // A mirroring transform turns the winding around
+            if (mirrored && face.mNumIndices == 3)
+                std::swap(indices[first + 1], indices[first + 2]);
+        }
+    }
 
     // ------------------------------------------------------------------
-    // Vertices
+    // Optimisation
     // ------------------------------------------------------------------
+    // File order is whatever the exporter wrote. The same triangles in a
+    // cache-friendly order shade far fewer vertices; see MeshOptimizer.h.
+    result.report = MeshOptimizer::Optimize(vertices, indices);
+
+    // ------------------------------------------------------------------
+    // Levels of detail
+    // ------------------------------------------------------------------
+    Mesh::BuildLods(vertices, indices, result.lods, result.lodIndices);
+
+    // ------------------------------------------------------------------
+    // Meshlets
+    // ------------------------------------------------------------------
+    // After the optimisation: they follow the final triangle order.
+    result.meshlets = MeshletBuilder::Build(vertices, indices);
+
+    result.milliseconds = MillisecondsSince(start);
+}
+
+// One aiMesh's vertices in our layout, after those already in `vertices`
+void Model::appendVertices(const aiMesh* mesh, const aiMatrix4x4* transform, const aiMatrix3x3& normalMatrix,
+    std::vector<Vertex>& vertices)
+{
     for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
     {
         // Use the full constructor so every field is explicitly set.
         // Assimp aiVector3D members map directly to our float array positions.
 
-        float nx = 0.0f, ny = 0.0f, nz = 1.0f;
+        aiVector3D position = mesh->mVertices[i];
+        aiVector3D normal(0.0f, 0.0f, 1.0f);
         if (mesh->HasNormals())
+            normal = mesh->mNormals[i];
+        if (transform)
         {
-            nx = mesh->mNormals[i].x;
-            ny = mesh->mNormals[i].y;
-            nz = mesh->mNormals[i].z;
+            position = *transform * position;
+            normal = (normalMatrix * normal).Normalize();
         }
 
         float r = 1.0f, g = 1.0f, b = 1.0f;
@@ -190,64 +824,41 @@ ModelMesh Model::processMesh(const aiMesh* mesh, const aiScene* scene)
         }
 
         vertices.emplace_back(
-            mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z,
-            nx, ny, nz,
+            position.x, position.y, position.z,
+            normal.x, normal.y, normal.z,
             r, g, b,
             u, v
         );
     }
-
-    // ------------------------------------------------------------------
-    // Indices
-    // ------------------------------------------------------------------
-    // After aiProcess_Triangulate every face has exactly 3 indices.
-    for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
-    {
-        const aiFace& face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; ++j)
-            indices.push_back(face.mIndices[j]);
-    }
-
-    // ------------------------------------------------------------------
-    // Textures
-    // ------------------------------------------------------------------
-    if (mesh->mMaterialIndex >= 0)
-    {
-        const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-
-        std::vector<MeshTexture> diffuseMaps =
-            loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-
-        std::vector<MeshTexture> specularMaps =
-            loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-
-        std::vector<MeshTexture> normalMaps =
-            loadMaterialTextures(material, aiTextureType_NORMALS, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-    }
-
-    return ModelMesh(vertices, indices, textures);
 }
 
 // ============================================================================
 // loadMaterialTextures
 // ============================================================================
 //
-// Queries an aiMaterial for all textures of a given aiTextureType.  For each
-// one it checks the cache first; if the image has not been seen before it
-// constructs a Texture object (which uploads to the GPU) and stores it in the
-// cache.  Returns a vector of MeshTexture descriptors for the caller to attach
-// to a ModelMesh.
+// Queries an aiMaterial for all textures of a given aiTextureType and appends
+// their resolved paths to `textures`. Nothing is loaded yet: importModel
+// decodes every distinct image on the workers (decodeTextures) and creates
+// the Textures afterwards (uploadTextures, loadTexture).
 // ============================================================================
 
-std::vector<MeshTexture> Model::loadMaterialTextures(const aiMaterial* material,
-    aiTextureType     type,
-    const std::string& typeName)
+void Model::loadImportedTextures(const aiScene* scene, unsigned int materialIndex,
+    std::vector<ImportedTexture>& textures) const
 {
-    std::vector<MeshTexture> textures;
+    if (materialIndex >= scene->mNumMaterials)
+        return;
+
+    const aiMaterial* material = scene->mMaterials[materialIndex];
+    loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
+    loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
+    loadMaterialTextures(material, aiTextureType_NORMALS, "texture_normal", textures);
+}
 
+void Model::loadMaterialTextures(const aiMaterial* material,
+    aiTextureType      type,
+    const std::string& typeName,
+    std::vector<ImportedTexture>& textures) const
+{
     unsigned int textureCount = material->GetTextureCount(type);
 
     for (unsigned int i = 0; i < textureCount; ++i)
@@ -255,30 +866,72 @@ std::vector<MeshTexture> Model::loadMaterialTextures(const aiMaterial* material,
         aiString relativePath;
         material->GetTexture(type, i, &relativePath);
 
-        std::string fullPath = m_Directory + "/" + relativePath.C_Str();
+        ImportedTexture texture;
+        texture.type = typeName;
+        texture.path = m_Directory + "/" + relativePath.C_Str();
+        textures.push_back(texture);
+    }
+}
 
-        // Return cached entry if this image has already been uploaded.
-        auto it = m_TexturesLoaded.find(fullPath);
-        if (it != m_TexturesLoaded.end())
-        {
-            MeshTexture meshTexture;
-            meshTexture.texture = it->second;
-            meshTexture.type = typeName;
-            meshTexture.path = fullPath;
-            textures.push_back(meshTexture);
+// ============================================================================
+// Texture loading
+// ============================================================================
+//
+// Textures come from the process-wide TextureCache, so an image another
+// Model (or a test) already loaded is shared rather than uploaded again.
+//
+// With TextureStreamer enabled (the default), the cache hands every new
+// image to the streamer: the model is drawn with placeholders at first and
+// the constructor never waits for a decode.
+//
+// Otherwise decodeTextures starts one Texture::Decode task per image that is
+// neither cached nor earlier in `paths`. uploadTextures then creates the
+// Textures from the results on the GL thread and adds them to the cache, so
+// every loadTexture afterwards is a lookup.
+// ============================================================================
+
+std::vector<std::future<Model::DecodedImage>> Model::decodeTextures(const std::vector<std::string>& paths) const
+{
+    std::vector<std::future<DecodedImage>> decodes;
+    if (TextureStreamer::IsEnabled())
+        return decodes;
+
+    std::unordered_map<std::string, bool> queued;
+
+    for (const std::string& path : paths)
+    {
+        if (!queued.emplace(path, true).second || TextureCache::Get().Find(path))
             continue;
-        }
 
-        // Not cached: construct a Texture, which loads the image via stb_image
-        // and uploads it to the GPU.
-        MeshTexture meshTexture;
-        meshTexture.texture = std::make_shared<Texture>(fullPath);
-        meshTexture.type = typeName;
-        meshTexture.path = fullPath;
+        decodes.push_back(ThreadPool::Get().Submit([path]()
+            {
+                const auto start = std::chrono::steady_clock::now();
+                DecodedImage decoded;
+                decoded.image = Texture::Decode(path);
+                decoded.milliseconds = MillisecondsSince(start);
+                return decoded;
+            }));
+    }
+    return decodes;
+}
 
-        textures.push_back(meshTexture);
-        m_TexturesLoaded[fullPath] = meshTexture.texture;
+void Model::uploadTextures(std::vector<std::future<DecodedImage>>& decodes)
+{
+    for (std::future<DecodedImage>& decode : decodes)
+    {
+        DecodedImage decoded = decode.get();
+        m_Timings.decode += decoded.milliseconds;
+        TextureCache::Get().Insert(decoded.image.filepath, std::make_shared<Texture>(decoded.image));
     }
+}
 
-    return textures;
-}
\ No newline at end of file
+MeshTexture Model::loadTexture(const std::string& fullPath, const std::string& typeName)
+{
+    MeshTexture meshTexture;
+    meshTexture.type = typeName;
+    meshTexture.path = fullPath;
+
+    // Shared with every other user of the image; streamed or loaded on a miss
+    meshTexture.texture = TextureCache::Get().Load(fullPath);
+    return meshTexture;
+}
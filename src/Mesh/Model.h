@@ -3,9 +3,13 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <future>
 
 #include "ModelMesh.h"
+#include "MeshOptimizer.h"
+#include "MaterialTable.h"
 #include "../Shader.h"
+#include "../DrawIndirectBuffer.h"
 
 #include <assimp/scene.h>
 #include <glm/glm.hpp>
@@ -21,13 +25,27 @@
 // converts each aiMesh into a ModelMesh, and creates Texture objects for any
 // referenced image files using the existing Texture class.
 //
+// Mesh cache:
+//   The first import writes everything processMesh built (the optimised
+//   meshes, their LODs and meshlets) to <path>.meshcache (see MeshCache.h).
+//   Later loads read the meshes straight from that file and never start
+//   Assimp, as long as the source file has not changed.
+//
+// Parallel import:
+//   Converting the meshes (including MeshOptimizer and the LODs) and
+//   decoding the images run as ThreadPool tasks; only the GL uploads stay
+//   on the main thread. getLoadTimings() breaks the load down by stage.
+//   With TextureStreamer enabled the images are not waited for at all:
+//   they stream in over the next frames (decode then reads 0).
+//
 // Texture deduplication:
-//   m_TexturesLoaded is a cache keyed on the absolute image path.  When
-//   multiple meshes reference the same image, the same shared_ptr<Texture>
-//   is reused and the image is uploaded to the GPU only once.
+//   Textures come from TextureCache, keyed on the canonical image path.
+//   When multiple meshes, or multiple Models, reference the same image, the
+//   same shared_ptr<Texture> is reused and the image is uploaded to the GPU
+//   only once.
 //
 // UV flip note:
-//   Texture::Texture() always calls stbi_set_flip_vertically_on_load(1), so
+//   Texture::Decode() always sets stb_image's vertical flip, so
 //   the V coordinate is already corrected at image-decode time.  The Assimp
 //   aiProcess_FlipUVs flag must NOT also be used or the flip will cancel out.
 //   The flipUVs constructor parameter therefore defaults to false.
@@ -44,6 +62,32 @@
 class Model
 {
 public:
+    // -------------------------------------------------------------------------
+    // Mesh merging (an import option)
+    // -------------------------------------------------------------------------
+    // Scene files often hold hundreds of small aiMeshes, each of which would
+    // become its own ModelMesh and draw, many with the same textures. With
+    // merging on, importModel bakes each node's transform into its meshes'
+    // vertices (nothing here animates nodes, so every node is static) and
+    // joins the meshes whose materials name the same textures, in node
+    // order, into meshes of at most maxVertices vertices: one vertex/index
+    // range, one optimisation, one set of LODs and meshlets and one draw
+    // each. A single aiMesh over the limit stays whole.
+    //
+    // Off, each aiMesh is drawn once per node that uses it, in its own space
+    // (node transforms are not applied), as files have always been loaded.
+    // -------------------------------------------------------------------------
+    struct MergeOptions
+    {
+        static const unsigned int DEFAULT_MAX_VERTICES = 1u << 16;
+
+        bool         enabled;
+        unsigned int maxVertices;
+
+        MergeOptions(bool enable = false, unsigned int vertexLimit = DEFAULT_MAX_VERTICES)
+            : enabled(enable), maxVertices(vertexLimit) {}
+    };
+
     // -------------------------------------------------------------------------
     // Constructor
     // -------------------------------------------------------------------------
@@ -52,61 +96,277 @@ public:
     //           (the default) because Texture already flips via stb_image.
     //           Only set to true if you are loading textures through a path
     //           that does NOT flip, and you are certain there is no double-flip.
+    // format  - how the sub-meshes are stored on the GPU. VertexFormat::Packed
+    //           (PackedVertex.h) roughly halves vertex memory and bandwidth
+    //           for dense models, at half-float UV precision.
+    // cpuData - what each sub-mesh keeps on the CPU once loaded (see
+    //           Mesh::ReleaseCpuData). Positions is enough for a TriangleBVH;
+    //           None leaves only bounds and counts. The mesh cache is written
+    //           before anything is dropped.
+    // merge   - see MergeOptions above; part of what the mesh cache keys on.
     // -------------------------------------------------------------------------
-    explicit Model(const std::string& path, bool flipUVs = false);
+    explicit Model(const std::string& path, bool flipUVs = false,
+        VertexFormat format = VertexFormat::Standard, Mesh::CpuData cpuData = Mesh::CpuData::Full,
+        const MergeOptions& merge = MergeOptions());
 
     // -------------------------------------------------------------------------
     // Draw
     // -------------------------------------------------------------------------
-    // Calls ModelMesh::Draw(shader) for every mesh in the model.
+    // Draws every mesh in the model. All sub-meshes already live in the
+    // shared MeshArena buffers, so this binds each distinct material once and
+    // issues one glMultiDrawElementsIndirect per material group instead of
+    // a ModelMesh::Draw per sub-mesh.
     // Set any per-model shader uniforms (e.g. the model matrix) before calling.
     // -------------------------------------------------------------------------
     void Draw(Shader& shader);
 
+    // Records one multi-draw indirect command per material group in the queue
+    // with the given model matrix instead of drawing immediately.
+    // See RenderQueue.h / DrawIndirectBuffer.h.
+    void Submit(RenderQueue& queue, Shader& shader, const glm::mat4& model,
+        uint8_t pass = RenderPass::Opaque, float depth01 = 0.0f) const;
+
+    // Number of glMultiDrawElementsIndirect calls Draw issues (one in the
+    // bindless and array material modes).
+    std::size_t getMaterialGroupCount() const { return m_MaterialGroups.size(); }
+
+    // -------------------------------------------------------------------------
+    // Material table
+    // -------------------------------------------------------------------------
+    // With a MaterialTable (MaterialTable.h) the whole model is one
+    // multi-draw call: the shader looks each draw's textures up by material
+    // index instead of Draw binding them per group. Call prepareMaterials
+    // before Draw/Submit and use the shader variant it names
+    // (MATERIAL=MaterialTable::GetModeName(mode)); callers that never call
+    // it keep the per-group path.
+    // -------------------------------------------------------------------------
+    MaterialTable::Mode prepareMaterials();
+    MaterialTable::Mode getMaterialMode() const
+    {
+        return m_MaterialTable ? m_MaterialTable->GetMode() : MaterialTable::Mode::Bound;
+    }
+    const MaterialTable* getMaterialTable() const { return m_MaterialTable.get(); }
+
+    // Draws are the sub-meshes in material order; group g covers draws
+    // [firstDraw, firstDraw + drawCount). For callers that build their own
+    // per-mesh draws in the same order, e.g. with GPUCulling.
+    struct MaterialGroup
+    {
+        const RenderMaterial* material;   // nullptr when the meshes have no textures
+        unsigned int firstDraw;
+        unsigned int drawCount;
+    };
+
+    const std::vector<MaterialGroup>& getMaterialGroups() const { return m_MaterialGroups; }
+    std::size_t getDrawCount() const { return m_DrawMeshes.size(); }
+    const ModelMesh& getDrawMesh(std::size_t draw) const { return m_Meshes[m_DrawMeshes[draw]]; }
+
+    // -------------------------------------------------------------------------
+    // Level of detail
+    // -------------------------------------------------------------------------
+    // Every sub-mesh gets coarser LODs at load time (Mesh::GenerateLods), and
+    // Draw/Submit draw each mesh at its currently selected level.
+    //
+    // selectLods chooses the levels from how big each level's error would
+    // look on screen:
+    //
+    //     pixels = error * scale / distance * projectionScale
+    //
+    // where distance is from the camera to the mesh's bounding sphere and
+    // projectionScale = viewportHeight / (2 tan(fovY / 2)) (ProjectionScale).
+    // The coarsest level under thresholdPixels is used, with hysteresis: a
+    // mesh goes finer as soon as its level exceeds the threshold, but only
+    // coarser once the next level is well under it, so a mesh sitting at
+    // the switching distance does not flicker between two levels.
+    // Returns how many meshes changed level.
+    // -------------------------------------------------------------------------
+    std::size_t selectLods(const glm::mat4& model, const glm::vec3& cameraPosition,
+        float projectionScale, float thresholdPixels);
+
+    // Put every mesh at `level`, clamped to its coarsest; 0 is full detail.
+    void forceLod(std::size_t level);
+
+    std::size_t getMeshLod(std::size_t mesh) const { return m_MeshLods[mesh]; }
+
+    static float ProjectionScale(float viewportHeight, float fovYRadians);
+
     // -------------------------------------------------------------------------
     // Transform helpers
     // -------------------------------------------------------------------------
-    // Propagates the transform to every child mesh so the whole model moves
-    // as a single unit.  For independent per-mesh transforms, use getMeshes().
+    // The model is one TransformHierarchy node and every mesh is a child of
+    // it, so the whole model moves as a single unit without the meshes
+    // holding copies of its transform. A mesh's own transform (identity by
+    // default) is relative to the model.
     // -------------------------------------------------------------------------
-    void setPosition(const glm::vec3& position);
-    void setRotation(const glm::vec3& rotation);
-    void setScale(const glm::vec3& scale);
+    void setPosition(const glm::vec3& position) { m_Transform.SetPosition(position); }
+    void setRotation(const glm::vec3& rotation) { m_Transform.SetRotation(rotation); }
+    void setScale(const glm::vec3& scale)       { m_Transform.SetScale(scale); }
+
+    glm::vec3 getPosition() const { return m_Transform.GetPosition(); }
+    glm::vec3 getRotation() const { return m_Transform.GetRotation(); }
+    glm::vec3 getScale()    const { return m_Transform.GetScale(); }
 
-    glm::vec3 getPosition() const { return m_Position; }
-    glm::vec3 getRotation() const { return m_Rotation; }
-    glm::vec3 getScale()    const { return m_Scale; }
+    TransformHierarchy::Node getTransformNode() const { return m_Transform.GetNode(); }
 
-    glm::mat4 getTransformMatrix() const;
+    glm::mat4 getTransformMatrix() const { return m_Transform.GetWorldMatrix(); }
+
+    // Bounds of every sub-mesh together, in model space and after
+    // getTransformMatrix() / a given transform. Each ModelMesh also has its own.
+    const Bounds& getLocalBounds() const { return m_Bounds; }
+    Bounds getWorldBounds() const { return m_Bounds.Transformed(getTransformMatrix()); }
+    Bounds getWorldBounds(const glm::mat4& transform) const { return m_Bounds.Transformed(transform); }
 
     // -------------------------------------------------------------------------
     // Accessors
     // -------------------------------------------------------------------------
     const std::vector<ModelMesh>& getMeshes() const { return m_Meshes; }
     std::size_t getMeshCount()                const { return m_Meshes.size(); }
+    VertexFormat getVertexFormat()            const { return m_Format; }
+
+    // Vertex cache statistics of all sub-meshes together, before and after
+    // processMesh ran them through MeshOptimizer.
+    const MeshOptimizer::Report& getOptimizationReport() const { return m_OptimizationReport; }
+
+    // How long each stage of the load took, in milliseconds (see
+    // importModel in Model.cpp). Convert and decode run on ThreadPool
+    // workers at the same time, so they are summed worker time; `parallel`
+    // is the wall time of that phase, and (convert + decode) / parallel is
+    // how many workers it kept busy on average.
+    struct LoadTimings
+    {
+        float parse = 0.0f;       // Assimp ReadFile, or opening the MeshCache
+        float convert = 0.0f;     // processMesh: vertices, optimisation, LODs
+        float decode = 0.0f;      // stb_image
+        float parallel = 0.0f;
+        float upload = 0.0f;      // Textures and MeshArena copies, GL thread
+        float total = 0.0f;       // the whole constructor
+        unsigned int threads = 0; // workers in the pool
+    };
+
+    const LoadTimings& getLoadTimings() const { return m_Timings; }
+    float getLoadMilliseconds() const { return m_Timings.total; }
+
+    // Whether the meshes came from the MeshCache file instead of Assimp.
+    bool  wasLoadedFromCache()  const { return m_LoadedFromCache; }
+
+    // Meshes the import's node walk found (one per node per aiMesh), before
+    // merging; getMeshCount() is what they became. 0 after a load from the
+    // mesh cache, which only has the result.
+    std::size_t getSourceMeshCount() const { return m_SourceMeshCount; }
+
+    // -------------------------------------------------------------------------
+    // CPU copies
+    // -------------------------------------------------------------------------
+    // Drop every sub-mesh's CPU copies down to `keep` (Mesh::ReleaseCpuData);
+    // returns the bytes freed. The constructor does this for its cpuData.
+    // -------------------------------------------------------------------------
+    std::size_t releaseCpuData(Mesh::CpuData keep);
+    // Heap bytes the sub-meshes still hold, and what releasing has freed
+    std::size_t getCpuBytes() const;
+    std::size_t getCpuBytesReleased() const { return m_CpuBytesReleased; }
 
 private:
     std::vector<ModelMesh> m_Meshes;
     std::string            m_Directory;
+    Bounds                 m_Bounds;
+    VertexFormat           m_Format;
 
-    glm::vec3 m_Position{ 0.0f };
-    glm::vec3 m_Rotation{ 0.0f };
-    glm::vec3 m_Scale{ 1.0f };
+    TransformNode          m_Transform;
 
-    // Cache maps absolute image path -> shared Texture object.
-    // shared_ptr allows the cache and each ModelMesh to share ownership;
-    // the GPU resource is released when the last reference is dropped.
-    std::unordered_map<std::string, std::shared_ptr<Texture>> m_TexturesLoaded;
+    // -------------------------------------------------------------------------
+    // Multi-draw indirect data
+    // -------------------------------------------------------------------------
+    // Each sub-mesh is a DrawElementsIndirectCommand over its MeshArena
+    // range (firstIndex/baseVertex into the shared buffers); commands are
+    // ordered by material so each material is one contiguous range, drawn
+    // with a single call.
+    //
+    // The VAO is a private one over the arena buffers, because the draw ID
+    // attribute it carries belongs to this model's DrawIndirectBuffer. The
+    // commands are rebuilt if the arena has moved ranges since they were
+    // recorded (MeshArena::GetGeneration).
+    // -------------------------------------------------------------------------
+    std::unique_ptr<VertexArray>        m_IndirectVAO;
+    std::unique_ptr<DrawIndirectBuffer> m_Indirect;
+    std::vector<MaterialGroup>          m_MaterialGroups;
+    std::vector<std::size_t>            m_DrawMeshes;     // mesh index of each draw
+    std::vector<unsigned int>           m_DrawGroups;     // material group of each draw
+    mutable unsigned int                m_IndirectGeneration = 0;
+
+    // One entry per material group, indexed like m_MaterialGroups
+    std::unique_ptr<MaterialTable>      m_MaterialTable;
+
+    MeshOptimizer::Report m_OptimizationReport;
+    LoadTimings           m_Timings;
+    bool                  m_LoadedFromCache = false;
+    std::size_t           m_SourceMeshCount = 0;
+    std::size_t           m_CpuBytesReleased = 0;
+
+    // Selected level of detail of each mesh (indexed like m_Meshes)
+    std::vector<std::size_t>            m_MeshLods;
 
     // -------------------------------------------------------------------------
     // Private loading helpers
     // -------------------------------------------------------------------------
-    void loadModel(const std::string& path, bool flipUVs);
-    void processNode(const aiNode* node, const aiScene* scene);
+    void loadModel(const std::string& path, bool flipUVs, Mesh::CpuData cpuData, const MergeOptions& merge);
+    void importModel(const std::string& path, bool flipUVs, const MergeOptions& merge);
+    bool loadCached(const std::string& path, uint32_t options);
+    // -------------------------------------------------------------------------
+    // Import pipeline (importModel)
+    // -------------------------------------------------------------------------
+    // A converted aiMesh, produced on a worker and turned into a ModelMesh
+    // on the GL thread. Textures are only paths at that point.
+    struct ImportedTexture
+    {
+        std::string type;
+        std::string path;
+    };
 
-    ModelMesh processMesh(const aiMesh* mesh, const aiScene* scene);
+    // One aiMesh as a node places it; imported meshes are made of these
+    struct NodeMesh
+    {
+        unsigned int mesh;
+        aiMatrix4x4  transform;   // to model space; identity when not applied
+    };
 
-    std::vector<MeshTexture> loadMaterialTextures(const aiMaterial* material,
+    struct ImportedMesh
+    {
+        std::vector<Vertex>          vertices;
+        std::vector<unsigned int>    indices;
+        std::vector<Mesh::LodLevel>  lods;
+        std::vector<unsigned int>    lodIndices;
+        std::vector<Meshlet>         meshlets;
+        std::vector<ImportedTexture> textures;
+        MeshOptimizer::Report        report;
+        float                        milliseconds = 0.0f;
+    };
+
+    struct DecodedImage
+    {
+        Texture::Image image;
+        float          milliseconds = 0.0f;
+    };
+
+    void processNode(const aiNode* node, const aiMatrix4x4& parentTransform, std::vector<NodeMesh>& nodeMeshes);
+    void mergeMeshes(const aiScene* scene, const std::vector<NodeMesh>& nodeMeshes, unsigned int maxVertices,
+        std::vector<std::vector<NodeMesh>>& merged) const;
+    void buildIndirect();
+    void recordIndirect() const;
+    void refreshIndirect() const;
+
+    static void processMesh(const aiScene* scene, const std::vector<NodeMesh>& parts, ImportedMesh& result);
+    static void appendVertices(const aiMesh* mesh, const aiMatrix4x4* transform, const aiMatrix3x3& normalMatrix,
+        std::vector<Vertex>& vertices);
+
+    // The diffuse, specular and normal textures, as loadMaterialTextures finds them
+    void loadImportedTextures(const aiScene* scene, unsigned int materialIndex,
+        std::vector<ImportedTexture>& textures) const;
+    void loadMaterialTextures(const aiMaterial* material,
         aiTextureType      type,
-        const std::string& typeName);
+        const std::string& typeName,
+        std::vector<ImportedTexture>& textures) const;
+
+    std::vector<std::future<DecodedImage>> decodeTextures(const std::vector<std::string>& paths) const;
+    void uploadTextures(std::vector<std::future<DecodedImage>>& decodes);
+    MeshTexture loadTexture(const std::string& fullPath, const std::string& typeName);
 };
\ No newline at end of file
@@ -2,57 +2,63 @@
 #include "../Renderer.h"
 
 #include <GL/glew.h>
+#include <algorithm>
 #include <iostream>
 
 // ----------------------------------------------------------------------------
 // Constructor
 // ----------------------------------------------------------------------------
 // Delegates vertex/index data to the base-class constructor so that SetupMesh
-// is called and the VAO/VBO/EBO are created.  Textures are stored separately
+// is called and the geometry is copied into the MeshArena.  Textures are stored separately
 // because the base class has no knowledge of them.
 // ----------------------------------------------------------------------------
 
 ModelMesh::ModelMesh(const std::vector<Vertex>& vertices,
     const std::vector<unsigned int>& indices,
-    const std::vector<MeshTexture>& textures)
-    : Mesh(vertices, indices),
+    const std::vector<MeshTexture>& textures,
+    VertexFormat format)
+    : Mesh(vertices, indices, format),
     m_Textures(textures)
 {
+    BuildMaterial();
+}
+
+ModelMesh::ModelMesh(std::vector<Vertex>&& vertices,
+    std::vector<unsigned int>&& indices,
+    const std::vector<MeshTexture>& textures,
+    VertexFormat format)
+    : Mesh(std::move(vertices), std::move(indices), format),
+    m_Textures(textures)
+{
+    BuildMaterial();
 }
 
 // ----------------------------------------------------------------------------
-// Draw(Shader&)
+// BuildMaterial
 // ----------------------------------------------------------------------------
-//
-// Texture unit assignment:
-//   Texture::Bind(slot) calls glActiveTexture(GL_TEXTURE0 + slot) and then
-//   glBindTexture internally, so we do not need to manage the active texture
-//   unit manually here.  We simply pass the loop index as the slot.
-//
-//   Counters per type produce uniform names starting at 1:
-//     texture_diffuse1  -> slot 0
-//     texture_diffuse2  -> slot 1
-//     texture_specular1 -> slot 2
-//     texture_normal1   -> slot 3
+// Counters per type produce uniform names starting at 1:
+//   texture_diffuse1  -> slot 0
+//   texture_diffuse2  -> slot 1
+//   texture_specular1 -> slot 2
+//   texture_normal1   -> slot 3
 //   etc.
 //
-// After the draw call, each texture unit is unbound to avoid leaking state
-// into subsequent rendering passes.
+// The material ID is the GL name of the first texture, so meshes sharing a
+// diffuse map sort next to each other in the RenderQueue.
 // ----------------------------------------------------------------------------
 
-void ModelMesh::Draw(Shader& shader)
+void ModelMesh::BuildMaterial()
 {
-    if (!m_VAO || !m_EBO)
-    {
-        std::cerr << "ModelMesh::Draw(Shader&) called before SetupMesh()!\n";
-        return;
-    }
-
     unsigned int diffuseIndex = 1;
     unsigned int specularIndex = 1;
     unsigned int normalIndex = 1;
 
-    const auto count = static_cast<unsigned int>(m_Textures.size());
+    const auto count = static_cast<unsigned int>(
+        std::min<std::size_t>(m_Textures.size(), RenderMaterial::MAX_TEXTURES));
+
+    if (count < m_Textures.size())
+        std::cerr << "ModelMesh: more than " << RenderMaterial::MAX_TEXTURES
+                  << " textures, extra textures ignored\n";
 
     for (unsigned int i = 0; i < count; ++i)
     {
@@ -63,16 +69,70 @@ void ModelMesh::Draw(Shader& shader)
         else if (type == "texture_specular") number = std::to_string(specularIndex++);
         else if (type == "texture_normal")   number = std::to_string(normalIndex++);
 
-        // Set the sampler uniform to this texture unit index, then bind.
-        // Texture::Bind activates the correct unit before binding.
-        shader.setUniform1i(type + number, static_cast<int>(i));
-        m_Textures[i].texture->Bind(i);
+        m_Material.textures[i] = m_Textures[i].texture->GetID();
+        m_Material.samplerNames[i] = type + number;
+    }
+
+    m_Material.textureCount = count;
+    m_Material.id = count > 0 ? m_Material.textures[0] : 0;
+}
+
+// ----------------------------------------------------------------------------
+// Draw(Shader&)
+// ----------------------------------------------------------------------------
+//
+// Texture unit assignment:
+//   RenderMaterial::Bind binds texture i to unit i through GLState, so a
+//   texture already on its unit costs nothing, and points sampler i at it.
+//   Sampler names were resolved by BuildMaterial().
+//
+// Textures are left bound: the next draw rebinds the units it samples, and
+// unbinding every unit after every mesh only added state changes.
+// ----------------------------------------------------------------------------
+
+void ModelMesh::Draw(Shader& shader)
+{
+    if (!hasGeometry())
+    {
+        std::cerr << "ModelMesh::Draw(Shader&) called before SetupMesh()!\n";
+        return;
     }
 
+    // Each texture to the unit of its index, each sampler uniform to that unit
+    m_Material.Bind(shader);
+
+    getVertexArray()->Bind();
+    getIndexBuffer()->Bind();
+
+    const MeshArena::Range& range = getArenaRange();
     Renderer renderer;
-    renderer.Draw(*m_VAO, *m_EBO);
+    renderer.DrawIndexed(range.indexCount, range.firstIndex, range.baseVertex, getIndexBuffer()->GetType());
+}
 
-    // Unbind each texture to avoid state pollution for subsequent draw calls.
-    for (unsigned int i = 0; i < count; ++i)
-        m_Textures[i].texture->Unbind();
-}
\ No newline at end of file
+// ----------------------------------------------------------------------------
+// Submit
+// ----------------------------------------------------------------------------
+// Records the draw in the queue. Textures are bound by the queue when the
+// material changes, so consecutive meshes sharing a material bind once.
+// ----------------------------------------------------------------------------
+
+void ModelMesh::Submit(RenderQueue& queue, Shader& shader, const glm::mat4& model,
+    uint8_t pass, float depth01) const
+{
+    if (!hasGeometry())
+        return;
+
+    const MeshArena::Range& range = getArenaRange();
+
+    RenderCommand cmd;
+    cmd.shader = &shader;
+    cmd.vao = getVertexArray();
+    cmd.ibo = getIndexBuffer();
+    cmd.indexCount = range.indexCount;
+    cmd.firstIndex = range.firstIndex;
+    cmd.baseVertex = range.baseVertex;
+    cmd.material = m_Material.textureCount > 0 ? &m_Material : nullptr;
+    cmd.model = model;
+
+    queue.Submit(pass, cmd, depth01);
+}
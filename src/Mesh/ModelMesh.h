@@ -2,6 +2,7 @@
 #include "Mesh.h"
 #include "../Shader.h"
 #include "../Texture.h"
+#include "../RenderQueue.h"
 #include <vector>
 #include <string>
 #include <memory>
@@ -38,16 +39,22 @@ struct MeshTexture
 // Mesh itself is not modified; all GPU buffer setup is delegated to it via
 // the base-class constructor.
 //
-// Draw(Shader&) calls texture->Bind(slot) for each texture (which activates
-// the correct texture unit internally), sets the matching sampler uniform on
-// the shader, then issues the draw call via the base Renderer.
+// Draw(Shader&) binds the material (each texture to the unit of its index,
+// see RenderMaterial::Bind), sets the matching sampler uniforms on the
+// shader, then issues the draw call via the base Renderer.
 // ----------------------------------------------------------------------------
 class ModelMesh : public Mesh
 {
 public:
     ModelMesh(const std::vector<Vertex>& vertices,
         const std::vector<unsigned int>& indices,
-        const std::vector<MeshTexture>& textures);
+        const std::vector<MeshTexture>& textures,
+        VertexFormat format = VertexFormat::Standard);
+    // Takes the vertex and index arrays over instead of copying them
+    ModelMesh(std::vector<Vertex>&& vertices,
+        std::vector<unsigned int>&& indices,
+        const std::vector<MeshTexture>& textures,
+        VertexFormat format = VertexFormat::Standard);
 
     // Rule of Five.
     // Move operations are explicitly defaulted because the base class virtual
@@ -66,6 +73,24 @@ public:
     //   uniform sampler2D texture_normal1;
     void Draw(Shader& shader);
 
+    // Queue-based alternative to Draw: records a RenderCommand instead of
+    // drawing immediately, so the queue can group meshes by shader/material.
+    void Submit(RenderQueue& queue, Shader& shader, const glm::mat4& model,
+        uint8_t pass = RenderPass::Opaque, float depth01 = 0.0f) const;
+
+    // Textures + sampler names, for callers that bind the material themselves
+    // (Model's multi-draw indirect path).
+    const RenderMaterial& getMaterial() const { return m_Material; }
+
+    // The textures as loaded, e.g. for saving them in a MeshCache.
+    const std::vector<MeshTexture>& getTextures() const { return m_Textures; }
+
 private:
     std::vector<MeshTexture> m_Textures;
+
+    // Texture names + sampler uniform names, resolved once at construction
+    // so neither Draw nor Submit builds strings per frame.
+    RenderMaterial m_Material;
+
+    void BuildMaterial();
 };
\ No newline at end of file
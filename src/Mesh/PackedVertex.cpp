@@ -0,0 +1,109 @@
+#include "PackedVertex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+PackedVertex::PackedVertex(const Vertex& vertex)
+{
+	position[0] = vertex.position[0];
+	position[1] = vertex.position[1];
+	position[2] = vertex.position[2];
+
+	normal = PackSnorm1010102(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+
+	for (int c = 0; c < 3; c++)
+	{
+		const float value = std::min(std::max(vertex.colour[c], 0.0f), 1.0f);
+		colour[c] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+	}
+	colour[3] = 255;
+
+	texCoords[0] = FloatToHalf(vertex.texCoords[0]);
+	texCoords[1] = FloatToHalf(vertex.texCoords[1]);
+}
+
+// GL's signed normalised conversion is value / 511 (GL 4.2+), so encode
+// with the same scale. The 2-bit w is left 0.
+uint32_t PackedVertex::PackSnorm1010102(float x, float y, float z)
+{
+	const float components[3] = { x, y, z };
+	uint32_t packed = 0;
+	for (int c = 0; c < 3; c++)
+	{
+		const float value = std::min(std::max(components[c], -1.0f), 1.0f);
+		const int quantised = static_cast<int>(std::lround(value * 511.0f));
+		packed |= (static_cast<uint32_t>(quantised) & 0x3FFu) << (10 * c);
+	}
+	return packed;
+}
+
+// Working on the bit patterns: binary32 is 1:8:23 (sign, exponent with bias
+// 127, mantissa), binary16 is 1:5:10 with bias 15.
+uint16_t PackedVertex::FloatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+	const uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+	if (magnitude >= 0x7F800000u)   // inf or NaN (keep NaN a NaN)
+		return static_cast<uint16_t>(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+	if (magnitude >= 0x477FF000u)   // rounds past 65504, the largest half
+		return static_cast<uint16_t>(sign | 0x7C00u);
+
+	if (magnitude < 0x38800000u)    // below 2^-14: denormal half, or zero
+	{
+		if (magnitude < 0x33000000u)  // under half the smallest denormal
+			return sign;
+		// Shift the full mantissa (with its implicit 1) into denormal position
+		const uint32_t exponent = magnitude >> 23;
+		const uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+		const uint32_t shift = 126 - exponent;   // 14..24
+		uint32_t half = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1u)))
+			half++;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// Normal: rebias the exponent, round the mantissa from 23 to 10 bits.
+	// A carry out of the mantissa correctly bumps the exponent.
+	uint32_t half = ((magnitude - 0x38000000u) >> 13);
+	const uint32_t remainder = magnitude & 0x1FFFu;
+	if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+		half++;
+	return static_cast<uint16_t>(sign | half);
+}
+
+float PackedVertex::HalfToFloat(uint16_t half)
+{
+	const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+	uint32_t exponent = (half >> 10) & 0x1Fu;
+	uint32_t mantissa = half & 0x3FFu;
+	uint32_t bits;
+
+	if (exponent == 0x1Fu)
+		bits = sign | 0x7F800000u | (mantissa << 13);
+	else if (exponent != 0)
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	else if (mantissa == 0)
+		bits = sign;
+	else
+	{
+		// Denormal: normalise it
+		exponent = 113;
+		while ((mantissa & 0x400u) == 0)
+		{
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+	}
+
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+#include "Vertex.h"
+
+// ----------------------------------------------------------------------------
+// PackedVertex
+// ----------------------------------------------------------------------------
+// The same attributes as Vertex in 24 bytes instead of 44, for dense meshes
+// where vertex fetch bandwidth and buffer memory matter more than precision:
+//
+//     attribute   Vertex              PackedVertex
+//     position    3 x float   12 B    3 x float                   12 B
+//     normal      3 x float   12 B    snorm 10:10:10:2             4 B
+//     colour      3 x float   12 B    4 x unorm8 (a unused)        4 B
+//     texCoords   2 x float    8 B    2 x half float               4 B
+//
+// Each packed attribute is one the GPU expands for free on fetch, so the
+// shaders are unchanged: a `vec3` normal input reads the normalised 10-bit
+// x, y, z (GL_INT_2_10_10_10_REV), a `vec3` colour the first three unorm8
+// channels, a `vec2` the two halves. Costs of the precision:
+//   * normals: ~0.1 degree of error, invisible in lighting;
+//   * colours: 8 bits per channel, what the textures have anyway;
+//   * UVs: halves have 11 significant bits, about 1/2048 near 1.0. Enough to
+//     address a 2048 texture to the texel; heavily tiled UVs (e.g. 0..100)
+//     lose precision and should keep the standard format.
+// Positions stay full floats: quantising them needs a per-mesh scale and
+// offset in the shader.
+//
+// Meshes choose the format when created (VertexFormat); each format has its
+// own MeshArena, since one vertex buffer holds one layout.
+// ----------------------------------------------------------------------------
+
+enum class VertexFormat
+{
+	Standard,   // Vertex, 44 bytes
+	Packed      // PackedVertex, 24 bytes
+};
+
+static const unsigned int VERTEX_FORMAT_COUNT = 2;
+
+struct PackedVertex
+{
+	float    position[3];
+	uint32_t normal;          // x, y, z in 10-bit two's complement, w = 0
+	uint8_t  colour[4];
+	uint16_t texCoords[2];    // IEEE 754 binary16
+
+	PackedVertex() = default;
+	explicit PackedVertex(const Vertex& vertex);
+
+	// Float <-> binary16, rounding to nearest even; out-of-range values
+	// become infinity, tiny ones denormals or zero.
+	static uint16_t FloatToHalf(float value);
+	static float HalfToFloat(uint16_t half);
+
+	// Components clamped to [-1, 1]
+	static uint32_t PackSnorm1010102(float x, float y, float z);
+};
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex must stay tightly packed");
+
+inline unsigned int GetVertexStride(VertexFormat format)
+{
+	return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+}
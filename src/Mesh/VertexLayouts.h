@@ -0,0 +1,45 @@
+#pragma once
+#include "../VertexLayout.h"
+#include "Vertex.h"
+#include "PackedVertex.h"
+
+// ----------------------------------------------------------------------------
+// Vertex layouts of the mesh vertex formats
+// ----------------------------------------------------------------------------
+// Same attribute locations in both formats, so every shader works with
+// either; the packed types are expanded to floats on fetch (PackedVertex.h).
+// Each MeshArena sets its VAOs up from these, so every mesh of a format
+// shares the one table.
+// ----------------------------------------------------------------------------
+
+template<>
+struct VertexLayoutOf<Vertex>
+{
+	static constexpr VertexAttribute attributes[] = {
+		VERTEX_ATTRIBUTE(Vertex, position,  GL_FLOAT, 3, false),   // location 0
+		VERTEX_ATTRIBUTE(Vertex, normal,    GL_FLOAT, 3, false),   // location 1
+		VERTEX_ATTRIBUTE(Vertex, colour,    GL_FLOAT, 3, false),   // location 2
+		VERTEX_ATTRIBUTE(Vertex, texCoords, GL_FLOAT, 2, false),   // location 3
+	};
+};
+
+template<>
+struct VertexLayoutOf<PackedVertex>
+{
+	static constexpr VertexAttribute attributes[] = {
+		VERTEX_ATTRIBUTE(PackedVertex, position,  GL_FLOAT,              3, false),
+		VERTEX_ATTRIBUTE(PackedVertex, normal,    GL_INT_2_10_10_10_REV, 4, true),    // + unused w
+		VERTEX_ATTRIBUTE(PackedVertex, colour,    GL_UNSIGNED_BYTE,      4, true),    // + unused a
+		VERTEX_ATTRIBUTE(PackedVertex, texCoords, GL_HALF_FLOAT,         2, false),
+	};
+};
+
+static_assert(VertexLayoutMatchesMembers<Vertex>(), "Vertex layout disagrees with a member of Vertex");
+static_assert(VertexLayoutIsTightlyPacked<Vertex>(), "Vertex layout leaves a gap, overlaps or misses the end of Vertex");
+static_assert(VertexLayoutMatchesMembers<PackedVertex>(), "PackedVertex layout disagrees with a member of PackedVertex");
+static_assert(VertexLayoutIsTightlyPacked<PackedVertex>(), "PackedVertex layout leaves a gap, overlaps or misses the end of PackedVertex");
+
+inline constexpr VertexLayout GetVertexLayout(VertexFormat format)
+{
+	return format == VertexFormat::Packed ? GetVertexLayout<PackedVertex>() : GetVertexLayout<Vertex>();
+}
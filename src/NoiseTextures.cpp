@@ -0,0 +1,95 @@
+#include "NoiseTextures.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuResources.h"
+
+namespace
+{
+	int LevelCount(int size)
+	{
+		int levels = 1;
+		for (; size > 1; size /= 2)
+			levels++;
+		return levels;
+	}
+
+	void SetSampling(GLenum target)
+	{
+		// Trilinear, repeating: the textures tile
+		GlCall(glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+		GlCall(glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+		GlCall(glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT));
+		GlCall(glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT));
+		GlCall(glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_REPEAT));
+	}
+}
+
+NoiseTextures::NoiseTextures()
+{
+	GlCall(glGenTextures(1, &m_Texture2D));
+	GLState::BindTexture(GL_TEXTURE_2D, m_Texture2D);
+	GlCall(glTexStorage2D(GL_TEXTURE_2D, LevelCount(SIZE_2D), GL_RG16F, SIZE_2D, SIZE_2D));
+	SetSampling(GL_TEXTURE_2D);
+	GpuResources::TextureDesc desc;
+	desc.width = desc.height = SIZE_2D;
+	desc.format = GL_RG16F;
+	desc.levels = LevelCount(SIZE_2D);
+	GpuMemory::TrackTexture(GpuMemory::Category::Texture, m_Texture2D, GpuResources::GetTextureBytes(desc));
+
+	GlCall(glGenTextures(1, &m_Texture3D));
+	GLState::BindTexture(GL_TEXTURE_3D, m_Texture3D);
+	GlCall(glTexStorage3D(GL_TEXTURE_3D, LevelCount(SIZE_3D), GL_RG16F, SIZE_3D, SIZE_3D, SIZE_3D));
+	SetSampling(GL_TEXTURE_3D);
+	// A 3D level is a 2D array whose layers halve with it
+	std::size_t bytes3D = 0;
+	for (int size = SIZE_3D; size >= 1; size /= 2)
+		bytes3D += static_cast<std::size_t>(size) * size * size * 4;
+	GpuMemory::TrackTexture(GpuMemory::Category::Texture, m_Texture3D, bytes3D);
+
+	ComputeShader bake("res/Shaders/Art/NoiseBake.glsl");
+	Bake(bake, 2);
+	Bake(bake, 3);
+
+	// The mip chains are box-filtered from the baked level 0
+	GlCall(glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT));
+	GLState::BindTexture(GL_TEXTURE_2D, m_Texture2D);
+	GlCall(glGenerateMipmap(GL_TEXTURE_2D));
+	GLState::BindTexture(GL_TEXTURE_3D, m_Texture3D);
+	GlCall(glGenerateMipmap(GL_TEXTURE_3D));
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
+	GLState::BindTexture(GL_TEXTURE_3D, 0);
+}
+
+NoiseTextures::~NoiseTextures()
+{
+	if (m_Texture2D) GpuResources::Delete(GL_TEXTURE, m_Texture2D);
+	if (m_Texture3D) GpuResources::Delete(GL_TEXTURE, m_Texture3D);
+}
+
+std::size_t NoiseTextures::GetBytes()
+{
+	// RG16F is 4 bytes a texel; a full mip chain adds a third in 2D and
+	// a seventh in 3D
+	const std::size_t texels2D = static_cast<std::size_t>(SIZE_2D) * SIZE_2D;
+	const std::size_t texels3D = static_cast<std::size_t>(SIZE_3D) * SIZE_3D * SIZE_3D;
+	return 4 * (texels2D * 4 / 3 + texels3D * 8 / 7);
+}
+
+void NoiseTextures::Bake(ComputeShader& shader, int dimensions)
+{
+	const int size = dimensions == 3 ? SIZE_3D : SIZE_2D;
+	shader.Bind();
+	shader.setUniform1i("u_Dimensions", dimensions);
+	shader.setUniform1i("u_Size", size);
+	shader.setUniform1i("u_Period", dimensions == 3 ? PERIOD_3D : PERIOD_2D);
+	if (dimensions == 3)
+	{
+		GlCall(glBindImageTexture(1, m_Texture3D, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RG16F));
+	}
+	else
+	{
+		GlCall(glBindImageTexture(0, m_Texture2D, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F));
+	}
+
+	shader.Dispatch((size + 7) / 8, (size + 7) / 8, dimensions == 3 ? size : 1);
+}
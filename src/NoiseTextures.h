@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+
+#include "ComputeShader.h"
+
+/**
+ * NoiseTextures — tileable noise baked once, sampled instead of hashed
+ *
+ * noise.shader and fbmnoise.shader build value noise from four sin()
+ * hashes and a smooth interpolation per lookup, and FBM does that for
+ * every octave of every pixel, every frame. The noise never changes, so
+ * it can be computed once per texel of a texture and fetched instead:
+ * with hardware bilinear filtering an n-octave FBM becomes n fetches.
+ *
+ *     NoiseTextures noise;   // bakes on construction
+ *     GLState::BindTextureToUnit(0, GL_TEXTURE_2D, noise.GetTexture2D());
+ *     // GLSL: texture(u_Noise2D, p / period).r == value noise at p
+ *
+ * The 2D texture is SIZE_2D^2 texels of GL_RG16F, the 3D one SIZE_3D^3:
+ * R is value noise, G gradient (Perlin) noise, both 0..1. Each spans
+ * PERIOD_2D / PERIOD_3D lattice cells and the lattice wraps at that
+ * period, so the textures repeat seamlessly with GL_REPEAT. Both are
+ * baked by NoiseBake.glsl and carry a full mip chain, which keeps the
+ * high octaves (many cells per pixel) from aliasing. The 3D texture lets
+ * a shader animate along the third axis, so the pattern evolves rather
+ * than slides.
+ *
+ * GL thread only.
+ */
+class NoiseTextures
+{
+public:
+	static const int SIZE_2D = 256;
+	static const int PERIOD_2D = 32;     // 8 texels per cell
+	static const int SIZE_3D = 64;
+	static const int PERIOD_3D = 16;     // 4 texels per cell
+
+	NoiseTextures();
+	~NoiseTextures();
+	NoiseTextures(const NoiseTextures&) = delete;
+	NoiseTextures& operator=(const NoiseTextures&) = delete;
+
+	unsigned int GetTexture2D() const { return m_Texture2D; }
+	unsigned int GetTexture3D() const { return m_Texture3D; }
+
+	// For the GPU memory readout
+	static std::size_t GetBytes();
+
+private:
+	void Bake(ComputeShader& shader, int dimensions);
+
+	unsigned int m_Texture2D = 0;
+	unsigned int m_Texture3D = 0;
+};
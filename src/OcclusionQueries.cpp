@@ -0,0 +1,181 @@
+#include "OcclusionQueries.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "Shader.h"
+#include "VertexArray.h"
+
+namespace
+{
+	// Grown onto each box before asking whether the eye is in it: more
+	// than any near plane this engine uses
+	const float NEAR_MARGIN = 0.5f;
+
+	bool Contains(const Bounds& bounds, const glm::vec3& point)
+	{
+		const glm::vec3 offset = glm::abs(point - bounds.centre);
+		const glm::vec3 reach = bounds.extents + glm::vec3(NEAR_MARGIN);
+		return offset.x <= reach.x && offset.y <= reach.y && offset.z <= reach.z;
+	}
+}
+
+OcclusionQueries::OcclusionQueries()
+	: m_Target(GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED),
+	  m_Frame(1)
+{
+	m_BoxShader = std::make_unique<Shader>("res/Shaders/Culling/OcclusionBox.shader");
+	m_BoxVAO = std::make_unique<VertexArray>();
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+	Clear();
+}
+
+OcclusionQueries::Object& OcclusionQueries::GetObject(unsigned int key)
+{
+	if (key >= m_Objects.size())
+		m_Objects.resize(key + 1);
+
+	Object& object = m_Objects[key];
+	if (object.queries[0] == 0)
+	{
+		GlCall(glGenQueries(2, object.queries));
+	}
+	return object;
+}
+
+void OcclusionQueries::BeginFrame()
+{
+	m_Frame++;
+	m_Stats = Stats();
+
+	// Last frame's queries; the ones before were read a frame ago, and
+	// this frame writes their slot again
+	const unsigned int slot = m_Frame & 1;
+	const unsigned int last = 1 - slot;
+	for (unsigned int key : m_Issued[last])
+	{
+		Object& object = m_Objects[key];
+		GLuint available = 0;
+		GlCall(glGetQueryObjectuiv(object.queries[last], GL_QUERY_RESULT_AVAILABLE, &available));
+		if (!available)
+		{
+			m_Stats.late++;
+			continue;
+		}
+
+		GLuint passed = 0;
+		GlCall(glGetQueryObjectuiv(object.queries[last], GL_QUERY_RESULT, &passed));
+		object.visible = passed != 0;
+		m_Stats.hidden += object.visible ? 0 : 1;
+	}
+	m_Issued[last].clear();
+	m_Issued[slot].clear();
+}
+
+bool OcclusionQueries::WasVisible(unsigned int key) const
+{
+	return key >= m_Objects.size() || m_Objects[key].visible;
+}
+
+void OcclusionQueries::TestBounds(const unsigned int* keys, const Bounds* bounds, unsigned int count,
+	const glm::mat4& viewProjection, const glm::vec3& eye)
+{
+	const unsigned int slot = m_Frame & 1;
+	Renderer renderer;
+	UniformHandle boxMin, boxMax;
+	bool bound = false;
+	bool culling = false;   // GL_CULL_FACE as the caller had it
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (WasVisible(keys[i]))
+			continue;
+
+		Object& object = GetObject(keys[i]);
+		if (Contains(bounds[i], eye))
+		{
+			object.visible = true;
+			continue;
+		}
+
+		// Set up for the first box only: most frames test none
+		if (!bound)
+		{
+			m_BoxShader->Bind();
+			m_BoxShader->setUniformMat4f("u_ViewProjection", viewProjection);
+			boxMin = m_BoxShader->Uniform("u_BoxMin");
+			boxMax = m_BoxShader->Uniform("u_BoxMax");
+			m_BoxVAO->Bind();
+			GlCall(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+			GLState::DepthMask(false);
+			culling = GLState::IsEnabled(GL_CULL_FACE);
+			GLState::Disable(GL_CULL_FACE);
+			bound = true;
+		}
+
+		const glm::vec3 min = bounds[i].GetMin();
+		const glm::vec3 max = bounds[i].GetMax();
+		m_BoxShader->setUniform3f(boxMin, min.x, min.y, min.z);
+		m_BoxShader->setUniform3f(boxMax, max.x, max.y, max.z);
+
+		GlCall(glBeginQuery(m_Target, object.queries[slot]));
+		renderer.DrawArrays(0, 36);
+		GlCall(glEndQuery(m_Target));
+
+		object.testedFrame = m_Frame;
+		m_Issued[slot].push_back(keys[i]);
+		m_Stats.boxTests++;
+	}
+
+	if (bound)
+	{
+		GlCall(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+		GLState::DepthMask(true);
+		if (culling)
+			GLState::Enable(GL_CULL_FACE);
+		m_BoxVAO->unBind();
+	}
+}
+
+void OcclusionQueries::BeginDraw(unsigned int key)
+{
+	const unsigned int slot = m_Frame & 1;
+	Object& object = GetObject(key);
+	m_Stats.objects++;
+
+	if (object.testedFrame == m_Frame)
+	{
+		GlCall(glBeginConditionalRender(object.queries[slot], GL_QUERY_NO_WAIT));
+		return;
+	}
+
+	GlCall(glBeginQuery(m_Target, object.queries[slot]));
+	m_Issued[slot].push_back(key);
+}
+
+void OcclusionQueries::EndDraw(unsigned int key)
+{
+	if (m_Objects[key].testedFrame == m_Frame)
+	{
+		GlCall(glEndConditionalRender());
+	}
+	else
+	{
+		GlCall(glEndQuery(m_Target));
+	}
+}
+
+void OcclusionQueries::Clear()
+{
+	for (Object& object : m_Objects)
+	{
+		if (object.queries[0])
+		{
+			GlCall(glDeleteQueries(2, object.queries));
+		}
+	}
+	m_Objects.clear();
+	m_Issued[0].clear();
+	m_Issued[1].clear();
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Culling.h"
+
+class Shader;
+class VertexArray;
+
+/**
+ * OcclusionQueries — skip objects hidden behind big ones, with no stall
+ *
+ * Frustum culling keeps everything in front of the camera, including all
+ * that stands behind a wall. HiZBuffer and GPUCulling find those on the
+ * GPU, but need the whole scene in SSBOs and an indirect draw; for a
+ * scene of a few large occluders and some thousands of objects drawn
+ * the ordinary way, a hardware query per object does: draw the
+ * occluders, then for each object ask whether any sample of its bounding
+ * box passes the depth test (GL_ANY_SAMPLES_PASSED_CONSERVATIVE), and draw
+ * the real mesh under glBeginConditionalRender(query, GL_QUERY_NO_WAIT).
+ * The GPU skips the draw if the box was hidden, and draws anyway if the
+ * answer is not in yet: the CPU never waits.
+ *
+ *     queries.BeginFrame();                                  // last frame's answers
+ *     ... draw the occluders ...
+ *     queries.TestBounds(keys, bounds, count, viewProjection, eye);
+ *     for (each object)
+ *     {
+ *         queries.BeginDraw(key);
+ *         ... draw it ...
+ *         queries.EndDraw(key);
+ *     }
+ *
+ * LAST FRAME'S ANSWERS
+ *   Testing a box costs a draw. An object seen last frame most likely
+ *   still is, so, as in coherent hierarchical culling, it skips the box:
+ *   BeginDraw wraps its real draw in the query instead, which measures
+ *   exactly what was drawn for free. Only objects that were hidden get a
+ *   box test and a conditional draw. Each object has two queries, one
+ *   written per frame; BeginFrame reads the other only if
+ *   GL_QUERY_RESULT_AVAILABLE says it is done, and an answer still late
+ *   keeps the one before. A hidden object that comes into view still
+ *   shows on time: its own box test decides this frame's draw.
+ *
+ * A box the eye is in (or the near plane cuts) would be clipped and read
+ * as hidden, so TestBounds skips it and the object counts as seen.
+ *
+ * Keys are the caller's (ids that stay with an object, e.g. Scene
+ * entities); Clear forgets them all. Without GL 4.3 or
+ * ARB_ES3_compatibility the queries are the exact GL_ANY_SAMPLES_PASSED.
+ * Depth test on and the occluders' depth in place are the caller's. GL
+ * thread only.
+ */
+class OcclusionQueries
+{
+public:
+	struct Stats
+	{
+		unsigned int objects = 0;     // BeginDraw calls this frame
+		unsigned int boxTests = 0;    // of them, the ones hidden last frame
+		unsigned int hidden = 0;      // answers read this frame that said hidden
+		unsigned int late = 0;        // answers not in by this frame
+	};
+
+	OcclusionQueries();
+	~OcclusionQueries();
+	OcclusionQueries(const OcclusionQueries&) = delete;
+	OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+	// Reads what the last frame's queries found, without waiting
+	void BeginFrame();
+
+	// Whether the object was visible when last measured; an object never
+	// measured was
+	bool WasVisible(unsigned int key) const;
+
+	// Box tests for those of the `count` objects hidden last frame, each
+	// into its query: depth tested, no colour or depth written, both faces
+	// drawn. Face culling is restored after; the bound program and VAO
+	// change.
+	void TestBounds(const unsigned int* keys, const Bounds* bounds, unsigned int count,
+		const glm::mat4& viewProjection, const glm::vec3& eye);
+
+	// Around the object's real draw: conditional on this frame's box test
+	// if it had one, otherwise inside its query
+	void BeginDraw(unsigned int key);
+	void EndDraw(unsigned int key);
+
+	// Every query; keys start over as never measured
+	void Clear();
+
+	unsigned int GetTarget() const { return m_Target; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	struct Object
+	{
+		unsigned int queries[2] = { 0, 0 };   // written on even, odd frames
+		bool visible = true;
+		unsigned int testedFrame = 0;       // frame of its last box test, 0 for none
+	};
+
+	Object& GetObject(unsigned int key);
+
+	unsigned int m_Target;
+	unsigned int m_Frame;
+	std::vector<Object> m_Objects;               // by key
+	std::vector<unsigned int> m_Issued[2];       // keys queried on even, odd frames
+
+	std::unique_ptr<Shader> m_BoxShader;
+	std::unique_ptr<VertexArray> m_BoxVAO;       // no attributes: corners from gl_VertexID
+	Stats m_Stats;
+};
@@ -0,0 +1,158 @@
+#include "ParticlePool.h"
+
+#if !defined(PARTICLEPOOL_SCALAR) && (defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PARTICLEPOOL_SIMD 1
+#include <immintrin.h>
+#endif
+
+void ParticlePool::Resize(unsigned int capacity)
+{
+	const std::size_t padded = (capacity + PADDING - 1) / PADDING * PADDING;
+	Array* arrays[] = { &posX, &posY, &velX, &velY, &life, &maxLife, &size, &r, &g, &b, &a };
+	for (Array* array : arrays)
+		array->assign(padded, 0.0f);
+	m_AliveCount = 0;
+}
+
+void ParticlePool::Clear()
+{
+	std::fill(life.begin(), life.begin() + m_AliveCount, 0.0f);
+	m_AliveCount = 0;
+}
+
+unsigned int ParticlePool::Emit(unsigned int limit)
+{
+	if (m_AliveCount >= limit || m_AliveCount >= GetCapacity())
+		return NONE;
+	return m_AliveCount++;
+}
+
+unsigned int ParticlePool::EmitRange(unsigned int count, unsigned int limit, unsigned int& first)
+{
+	first = m_AliveCount;
+	const unsigned int cap = limit < GetCapacity() ? limit : GetCapacity();
+	const unsigned int room = m_AliveCount < cap ? cap - m_AliveCount : 0;
+	const unsigned int granted = count < room ? count : room;
+	m_AliveCount += granted;
+	return granted;
+}
+
+void ParticlePool::Move(unsigned int from, unsigned int to)
+{
+	posX[to] = posX[from]; posY[to] = posY[from];
+	velX[to] = velX[from]; velY[to] = velY[from];
+	life[to] = life[from]; maxLife[to] = maxLife[from];
+	size[to] = size[from];
+	r[to] = r[from]; g[to] = g[from]; b[to] = b[from]; a[to] = a[from];
+}
+
+void ParticlePool::RemoveDead()
+{
+	// Swap-remove: the last alive particle fills the hole, so the range
+	// stays packed and nothing after the hole moves
+	unsigned int i = 0;
+	while (i < m_AliveCount)
+	{
+		if (life[i] > 0.0f)
+		{
+			i++;
+			continue;
+		}
+		const unsigned int last = --m_AliveCount;
+		if (i != last)
+			Move(last, i);
+		life[last] = 0.0f;
+	}
+}
+
+unsigned int ParticlePool::GetStepCount() const
+{
+	// Whole registers; the slots past the alive range are dead
+	return (m_AliveCount + PADDING - 1) / PADDING * PADDING;
+}
+
+unsigned int ParticlePool::Integrate(float dt, float gravity)
+{
+	IntegrateRange(0, GetStepCount(), dt, gravity);
+	RemoveDead();
+	return m_AliveCount;
+}
+
+unsigned int ParticlePool::IntegrateScalar(float dt, float gravity)
+{
+	const float dv = gravity * dt;
+	const unsigned int count = GetStepCount();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const float l = life[i] - dt;
+		life[i] = l > 0.0f ? l : 0.0f;
+		velY[i] += dv;
+		posX[i] += velX[i] * dt;
+		posY[i] += velY[i] * dt;
+	}
+	RemoveDead();
+	return m_AliveCount;
+}
+
+#ifdef PARTICLEPOOL_SIMD
+void ParticlePool::IntegrateRange(unsigned int begin, unsigned int end, float dt, float gravity)
+{
+	float* px = posX.data();
+	float* py = posY.data();
+	const float* vx = velX.data();
+	float* vy = velY.data();
+	float* l = life.data();
+
+#ifdef __AVX2__
+	const __m256 step = _mm256_set1_ps(dt);
+	const __m256 dv = _mm256_set1_ps(gravity * dt);
+	const __m256 zero = _mm256_setzero_ps();
+	for (unsigned int i = begin; i < end; i += 8)
+	{
+		_mm256_store_ps(l + i, _mm256_max_ps(_mm256_sub_ps(_mm256_load_ps(l + i), step), zero));
+
+		const __m256 velocityY = _mm256_add_ps(_mm256_load_ps(vy + i), dv);
+		_mm256_store_ps(vy + i, velocityY);
+		_mm256_store_ps(px + i, _mm256_add_ps(_mm256_load_ps(px + i), _mm256_mul_ps(_mm256_load_ps(vx + i), step)));
+		_mm256_store_ps(py + i, _mm256_add_ps(_mm256_load_ps(py + i), _mm256_mul_ps(velocityY, step)));
+	}
+#else
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 dv = _mm_set1_ps(gravity * dt);
+	const __m128 zero = _mm_setzero_ps();
+	for (unsigned int i = begin; i < end; i += 4)
+	{
+		_mm_store_ps(l + i, _mm_max_ps(_mm_sub_ps(_mm_load_ps(l + i), step), zero));
+
+		const __m128 velocityY = _mm_add_ps(_mm_load_ps(vy + i), dv);
+		_mm_store_ps(vy + i, velocityY);
+		_mm_store_ps(px + i, _mm_add_ps(_mm_load_ps(px + i), _mm_mul_ps(_mm_load_ps(vx + i), step)));
+		_mm_store_ps(py + i, _mm_add_ps(_mm_load_ps(py + i), _mm_mul_ps(velocityY, step)));
+	}
+#endif
+}
+#else
+void ParticlePool::IntegrateRange(unsigned int begin, unsigned int end, float dt, float gravity)
+{
+	const float dv = gravity * dt;
+	for (unsigned int i = begin; i < end; i++)
+	{
+		const float l = life[i] - dt;
+		life[i] = l > 0.0f ? l : 0.0f;
+		velY[i] += dv;
+		posX[i] += velX[i] * dt;
+		posY[i] += velY[i] * dt;
+	}
+}
+#endif
+
+const char* ParticlePool::GetInstructionSet()
+{
+#if !defined(PARTICLEPOOL_SIMD)
+	return "Scalar";
+#elif defined(__AVX2__)
+	return "AVX2";
+#else
+	return "SSE";
+#endif
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+/**
+ * ParticlePool — CPU particles as a structure of arrays
+ *
+ * TestParticleSystem kept a std::vector of Particle structs: position,
+ * velocity, colour, life and size side by side. The physics step only
+ * touches position, velocity and life, but every cache line it pulls in
+ * is mostly colour and size, and glm::vec2 math handles one particle at
+ * a time. Here every component is its own array, so the step streams
+ * through exactly the five arrays it needs, and a SIMD register holds
+ * the same component of 4 (SSE) or 8 (AVX2) consecutive particles:
+ *
+ *     pool.Resize(100000);
+ *     unsigned int i = pool.Emit(limit);          // NONE when full
+ *     pool.life[i] = 2.0f; pool.posX[i] = ...;
+ *     unsigned int alive = pool.Integrate(dt, gravity);
+ *
+ * ALIVE RANGE
+ *   The live particles are always slots [0, GetAliveCount()), and every
+ *   slot after them is dead (life 0). Emit hands out the slot just past
+ *   the range, and a particle that dies is swap-removed: the last live
+ *   one moves into its slot. Emitting is O(1) and a step costs the live
+ *   particles, not the capacity; there is never a search for a free slot.
+ *   Swap-removal reorders particles, which unsorted alpha blending
+ *   doesn't notice.
+ *
+ * Integrate decays life (clamping at 0) and moves every slot of the
+ * alive range rounded up to whole registers, then removes the dead. The
+ * arrays are 32-byte aligned and padded to a multiple of 8 slots, so the
+ * kernels use aligned loads and need no scalar tail.
+ *
+ * INSTRUCTION SET
+ *   Picked at compile time as in RayKernels: AVX2 when __AVX2__ is
+ *   defined (MSVC /arch:AVX2), SSE on x64 or x86 with SSE2, otherwise
+ *   (or with PARTICLEPOOL_SCALAR) the scalar loop. IntegrateScalar is
+ *   always the scalar loop, for comparison.
+ */
+class ParticlePool
+{
+public:
+	static const std::size_t ALIGNMENT = 32;
+	static const unsigned int PADDING = 8;      // slots, the widest register
+
+	// std::vector's allocator only promises alignof(std::max_align_t)
+	template <typename T>
+	struct AlignedAllocator
+	{
+		typedef T value_type;
+
+		AlignedAllocator() = default;
+		template <typename U> AlignedAllocator(const AlignedAllocator<U>&) {}
+
+		T* allocate(std::size_t count)
+		{
+			if (count == 0)
+				return nullptr;
+			// Size rounded up to the alignment, as aligned_alloc requires
+			const std::size_t bytes = (count * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+#ifdef _MSC_VER
+			void* p = _aligned_malloc(bytes, ALIGNMENT);
+#else
+			void* p = std::aligned_alloc(ALIGNMENT, bytes);
+#endif
+			if (!p)
+				throw std::bad_alloc();
+			return static_cast<T*>(p);
+		}
+
+		void deallocate(T* p, std::size_t)
+		{
+#ifdef _MSC_VER
+			_aligned_free(p);
+#else
+			std::free(p);
+#endif
+		}
+
+		template <typename U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+		template <typename U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+	};
+
+	typedef std::vector<float, AlignedAllocator<float>> Array;
+
+	Array posX, posY;
+	Array velX, velY;
+	Array life, maxLife;
+	Array size;
+	Array r, g, b, a;
+
+	static const unsigned int NONE = ~0u;
+
+	// Capacity rounded up to PADDING; every slot starts dead
+	void Resize(unsigned int capacity);
+	unsigned int GetCapacity() const { return static_cast<unsigned int>(life.size()); }
+	unsigned int GetAliveCount() const { return m_AliveCount; }
+
+	// A slot for a new particle, or NONE once `limit` (or the capacity) are
+	// alive. The caller fills every component; life must be > 0.
+	unsigned int Emit(unsigned int limit);
+	// Up to `count` slots at once, [first, first + returned), for filling
+	// in parallel
+	unsigned int EmitRange(unsigned int count, unsigned int limit, unsigned int& first);
+	// Kills every particle
+	void Clear();
+
+	// One step: life -= dt (not below 0), velY += gravity * dt, pos += vel * dt,
+	// then the particles that died are removed. Returns the alive count.
+	unsigned int Integrate(float dt, float gravity);
+	unsigned int IntegrateScalar(float dt, float gravity);
+
+	// Integrate split in two, so the step can be spread over threads: the
+	// step alone over [begin, end), multiples of PADDING up to
+	// GetStepCount(), then RemoveDead once every range is done. Ranges
+	// touch disjoint slots, so they can run concurrently.
+	unsigned int GetStepCount() const;
+	void IntegrateRange(unsigned int begin, unsigned int end, float dt, float gravity);
+	void RemoveDead();
+
+	// "AVX2", "SSE" or "Scalar", for the GUI
+	static const char* GetInstructionSet();
+
+private:
+	void Move(unsigned int from, unsigned int to);
+
+	unsigned int m_AliveCount = 0;
+};
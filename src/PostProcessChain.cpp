@@ -0,0 +1,178 @@
+#include "PostProcessChain.h"
+#include "Renderer.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <string>
+
+PostProcessChain::PostProcessChain()
+{
+	m_PointShader = std::make_unique<ComputeShader>("res/Shaders/Effects/PointEffect.glsl");
+	m_ConvolveShader = std::make_unique<ComputeShader>("res/Shaders/Effects/Convolve3x3.glsl");
+	m_BlurShader = std::make_unique<ComputeShader>("res/Shaders/Effects/GaussianBlur.glsl");
+	m_BloomShader = std::make_unique<ComputeShader>("res/Shaders/Effects/Bloom.glsl");
+
+	// The graph's transients filter GL_LINEAR, which never leaves level 0;
+	// a sampler object leaves their state alone
+	GlCall(glGenSamplers(1, &m_MipSampler));
+	GlCall(glSamplerParameteri(m_MipSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST));
+	GlCall(glSamplerParameteri(m_MipSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GlCall(glSamplerParameteri(m_MipSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GlCall(glSamplerParameteri(m_MipSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+}
+
+PostProcessChain::~PostProcessChain()
+{
+	GlCall(glDeleteSamplers(1, &m_MipSampler));
+}
+
+const char* PostProcessChain::GetEffectName(Effect effect)
+{
+	static const char* names[static_cast<int>(Effect::Count)] =
+	{
+		"None", "Edge detection", "Colour inversion", "Blur", "Sharpen", "Bloom", "Greyscale", "Venezuela", "Romania", "Middle box"
+	};
+	return names[static_cast<int>(effect)];
+}
+
+std::vector<RenderGraph::Resource> PostProcessChain::AddToGraph(RenderGraph& graph, RenderGraph::Resource input,
+	const RenderGraph::TextureDesc& desc)
+{
+	std::vector<RenderGraph::Resource> outputs;
+	for (std::size_t i = 0; i < m_Stages.size(); i++)
+	{
+		const Stage stage = m_Stages[i];
+		const std::string name = "Stage " + std::to_string(i + 1) + ": " + GetEffectName(stage.effect);
+		const RenderGraph::Resource output = graph.CreateTexture(name, desc);
+
+		if (stage.effect == Effect::Bloom)
+		{
+			// Half resolution, as many levels as fit down to 1x1
+			RenderGraph::TextureDesc pyramidDesc;
+			pyramidDesc.width = std::max(1, desc.width / 2);
+			pyramidDesc.height = std::max(1, desc.height / 2);
+			pyramidDesc.format = GL_RGBA16F;
+			int fit = 1;
+			while ((std::min(pyramidDesc.width, pyramidDesc.height) >> fit) > 0)
+				fit++;
+			pyramidDesc.levels = std::min(std::min(std::max(stage.levels, 1), MAX_BLOOM_LEVELS), fit);
+
+			const RenderGraph::Resource pyramid = graph.CreateTexture(name + " (pyramid)", pyramidDesc);
+			const RenderGraph::Pass pass = graph.AddPass(name, [this, stage, input, pyramid, pyramidDesc, output, desc](const RenderGraph::PassContext& context)
+				{
+					RunBloom(stage, context.GetTexture(input), context.GetTexture(pyramid), pyramidDesc.levels, context.GetTexture(output), desc);
+				});
+			graph.Read(pass, input);
+			graph.WriteStorage(pass, pyramid);
+			graph.WriteStorage(pass, output);
+		}
+		else if (stage.effect == Effect::Blur)
+		{
+			// Rows into an intermediate, then columns; the second pass also
+			// reads the stage's input back for the opacity mix
+			const RenderGraph::Resource rows = graph.CreateTexture(name + " (rows)", desc);
+			const RenderGraph::Pass horizontal = graph.AddPass(name + " x", [this, stage, input, rows, desc](const RenderGraph::PassContext& context)
+				{
+					RunBlur(stage, true, context.GetTexture(input), 0, context.GetTexture(rows), desc);
+				});
+			graph.Read(horizontal, input);
+			graph.WriteStorage(horizontal, rows);
+
+			const RenderGraph::Pass vertical = graph.AddPass(name + " y", [this, stage, input, rows, output, desc](const RenderGraph::PassContext& context)
+				{
+					RunBlur(stage, false, context.GetTexture(rows), context.GetTexture(input), context.GetTexture(output), desc);
+				});
+			graph.Read(vertical, rows);
+			graph.Read(vertical, input);
+			graph.WriteStorage(vertical, output);
+		}
+		else
+		{
+			const bool neighbourhood = stage.effect == Effect::Edge || stage.effect == Effect::Sharpen || stage.effect == Effect::MiddleBox;
+			ComputeShader* shader = neighbourhood ? m_ConvolveShader.get() : m_PointShader.get();
+			const RenderGraph::Pass pass = graph.AddPass(name, [this, shader, stage, input, output, desc](const RenderGraph::PassContext& context)
+				{
+					RunPerPixel(*shader, stage, context.GetTexture(input), context.GetTexture(output), desc);
+				});
+			graph.Read(pass, input);
+			graph.WriteStorage(pass, output);
+		}
+
+		outputs.push_back(output);
+		input = output;
+	}
+	return outputs;
+}
+
+void PostProcessChain::RunPerPixel(ComputeShader& shader, const Stage& stage, unsigned int input, unsigned int output,
+	const RenderGraph::TextureDesc& desc)
+{
+	shader.Bind();
+	shader.setUniform1i("u_Effect", static_cast<int>(stage.effect));
+	shader.setUniform1f("u_Opacity", stage.opacity);
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D, input);
+	shader.setUniform1i("u_Input", 0);
+	GlCall(glBindImageTexture(0, output, 0, GL_FALSE, 0, GL_WRITE_ONLY, desc.format));
+
+	shader.Dispatch((desc.width + TILE - 1) / TILE, (desc.height + TILE - 1) / TILE, 1);
+}
+
+void PostProcessChain::RunBloom(const Stage& stage, unsigned int input, unsigned int pyramid, int levels, unsigned int output,
+	const RenderGraph::TextureDesc& desc)
+{
+	m_BloomShader->Bind();
+	m_BloomShader->setUniform1f("u_Threshold", stage.threshold);
+	m_BloomShader->setUniform1f("u_Knee", std::max(stage.knee, 0.0f));
+	m_BloomShader->setUniform1f("u_Intensity", stage.intensity);
+	m_BloomShader->setUniform1f("u_Opacity", stage.opacity);
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D, input);
+	GLState::BindTextureToUnit(1, GL_TEXTURE_2D, pyramid);
+	GlCall(glBindSampler(0, m_MipSampler));
+	GlCall(glBindSampler(1, m_MipSampler));
+	m_BloomShader->setUniform1i("u_Input", 0);
+	m_BloomShader->setUniform1i("u_Pyramid", 1);
+	GlCall(glBindImageTexture(1, output, 0, GL_FALSE, 0, GL_WRITE_ONLY, desc.format));
+
+	// Each step reads what the one before wrote, within this one pass
+	const GLbitfield barrier = GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+	auto run = [&](int mode, int level)
+	{
+		const int width = mode == 3 ? desc.width : std::max(1, (desc.width / 2) >> level);
+		const int height = mode == 3 ? desc.height : std::max(1, (desc.height / 2) >> level);
+		m_BloomShader->setUniform1i("u_Mode", mode);
+		m_BloomShader->setUniform1i("u_Level", level);
+		GlCall(glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F));
+		m_BloomShader->Dispatch((width + 7) / 8, (height + 7) / 8, 1);
+		GlCall(glMemoryBarrier(barrier));
+	};
+
+	run(0, 0);
+	for (int level = 1; level < levels; level++)
+		run(1, level);
+	for (int level = levels - 2; level >= 0; level--)
+		run(2, level);
+	run(3, 0);
+
+	GlCall(glBindSampler(0, 0));
+	GlCall(glBindSampler(1, 0));
+}
+
+void PostProcessChain::RunBlur(const Stage& stage, bool horizontal, unsigned int input, unsigned int original, unsigned int output,
+	const RenderGraph::TextureDesc& desc)
+{
+	m_BlurShader->Bind();
+	m_BlurShader->setUniform1i("u_Horizontal", horizontal ? 1 : 0);
+	m_BlurShader->setUniform1i("u_Radius", std::min(std::max(stage.radius, 0), MAX_BLUR_RADIUS));
+	m_BlurShader->setUniform1i("u_Final", horizontal ? 0 : 1);
+	m_BlurShader->setUniform1f("u_Opacity", stage.opacity);
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D, input);
+	m_BlurShader->setUniform1i("u_Input", 0);
+	GLState::BindTextureToUnit(1, GL_TEXTURE_2D, original ? original : input);
+	m_BlurShader->setUniform1i("u_Original", 1);
+	GlCall(glBindImageTexture(0, output, 0, GL_FALSE, 0, GL_WRITE_ONLY, desc.format));
+
+	// One group per LINE texels of each row (or column)
+	const int extent = horizontal ? desc.width : desc.height;
+	const int lines = horizontal ? desc.height : desc.width;
+	m_BlurShader->Dispatch((extent + LINE - 1) / LINE, lines, 1);
+}
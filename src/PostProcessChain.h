@@ -0,0 +1,99 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "ComputeShader.h"
+#include "RenderGraph.h"
+
+/**
+ * PostProcessChain — screen effects as a list of compute stages
+ *
+ * testEffects used to draw one full-screen quad through an uber-shader
+ * whose blur, sharpen and Sobel each fetched their 3x3 neighbourhood
+ * straight from the source texture: nine fetches a pixel, a fixed 3x3
+ * kernel, and one effect at a time. Here an effect is a stage, and the
+ * stages run in order, each reading the one before:
+ *
+ *     chain.GetStages() = { { Effect::Blur, 1.0f, 8 }, { Effect::Edge } };
+ *     outputs = chain.AddToGraph(graph, sceneColour, desc);
+ *
+ * Every stage is a compute pass (or two) into a RenderGraph transient of
+ * `desc`, so the graph aliases the targets into a ping-pong pair and
+ * culls the stages after the one whose output is used.
+ *
+ * KINDS OF STAGE
+ *   Per-pixel effects (PointEffect.glsl) read one texel. The 3x3 ones
+ *   (Convolve3x3.glsl) load their group's tile plus a one-texel apron into
+ *   shared memory first, so each texel is fetched about once. Blur is a
+ *   separable Gaussian (GaussianBlur.glsl), one pass per direction, each
+ *   group loading a 128-texel line and its apron: a radius-32 blur costs
+ *   the same fetches per pixel as a radius-1 one.
+ *
+ * BLOOM
+ *   Bloom.glsl thresholds the input into level 0 of a half-resolution
+ *   RGBA16F mip pyramid (a transient of `levels` levels), downsamples
+ *   level by level with the 13-tap filter from Call of Duty: Advanced
+ *   Warfare, then walks back up adding a tent-filtered upsample of each
+ *   level into the one above, and finally adds level 0 to the input. The
+ *   widest glow comes from the smallest level, so it costs almost
+ *   nothing; feed it an HDR input (RGBA16F targets) for highlights above
+ *   1 to bloom as they should.
+ *
+ * Opacity mixes each stage's result with its input. GL thread only.
+ */
+class PostProcessChain
+{
+public:
+	// The values are shared with the shaders' EFFECT_ constants
+	enum class Effect { None, Edge, Invert, Blur, Sharpen, Bloom, Greyscale, Venezuela, Romania, MiddleBox, Count };
+
+	static const int MAX_BLUR_RADIUS = 32;
+
+	struct Stage
+	{
+		Effect effect = Effect::None;
+		float opacity = 1.0f;      // 0 passes the input through, 1 the full effect
+		int radius = 4;            // Blur only: taps either side, up to MAX_BLUR_RADIUS
+
+		// Bloom only
+		float threshold = 0.8f;    // brightness where the glow starts
+		float knee = 0.4f;         // soft ramp below the threshold
+		float intensity = 0.6f;
+		int levels = 6;            // of the pyramid, up to MAX_BLOOM_LEVELS
+	};
+
+	static const int MAX_BLOOM_LEVELS = 8;
+
+	PostProcessChain();
+	~PostProcessChain();
+	PostProcessChain(const PostProcessChain&) = delete;
+	PostProcessChain& operator=(const PostProcessChain&) = delete;
+
+	std::vector<Stage>& GetStages() { return m_Stages; }
+	const std::vector<Stage>& GetStages() const { return m_Stages; }
+
+	// Declares every stage as passes of `graph`, the first reading `input`;
+	// their targets are transients of `desc`. Returns each stage's output,
+	// in order. The chain must outlive the graph's Execute.
+	std::vector<RenderGraph::Resource> AddToGraph(RenderGraph& graph, RenderGraph::Resource input, const RenderGraph::TextureDesc& desc);
+
+	static const char* GetEffectName(Effect effect);
+
+private:
+	static const int TILE = 16;        // Point and Convolve3x3 work groups
+	static const int LINE = 128;       // GaussianBlur work groups
+
+	void RunPerPixel(ComputeShader& shader, const Stage& stage, unsigned int input, unsigned int output, const RenderGraph::TextureDesc& desc);
+	void RunBlur(const Stage& stage, bool horizontal, unsigned int input, unsigned int original, unsigned int output,
+		const RenderGraph::TextureDesc& desc);
+	void RunBloom(const Stage& stage, unsigned int input, unsigned int pyramid, int levels, unsigned int output,
+		const RenderGraph::TextureDesc& desc);
+
+	std::unique_ptr<ComputeShader> m_PointShader;
+	std::unique_ptr<ComputeShader> m_ConvolveShader;
+	std::unique_ptr<ComputeShader> m_BlurShader;
+	std::unique_ptr<ComputeShader> m_BloomShader;
+	unsigned int m_MipSampler = 0;     // bloom: linear within a level, textureLod picks the level
+
+	std::vector<Stage> m_Stages;
+};
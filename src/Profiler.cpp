@@ -0,0 +1,581 @@
+#include "Profiler.h"
+#include "Renderer.h"
+#include "FrameArena.h"
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+typedef std::chrono::steady_clock Clock;
+
+// Read back after FRAMES frames: more than the FramePacer lets be in flight,
+// so the queries are always finished by then and no frame is dropped
+static_assert(Profiler::FRAMES > FramePacer::MAX_FRAMES_IN_FLIGHT, "query ring shallower than the frames in flight");
+
+// A scope opened this frame, with its queries if it's timed on the GPU
+struct Record
+{
+	unsigned int scope;
+	unsigned int beginQuery;        // into FrameQueries::queries, or NONE
+	unsigned int endQuery;
+};
+
+// One slot of the ring: the queries a frame wrote, reused once read
+struct FrameQueries
+{
+	std::vector<unsigned int> queries;
+	unsigned int used = 0;
+	std::vector<Record> records;
+	bool pending = false;           // written, not yet read back
+
+	// Part of a trace capture: the GPU clock (ns) and the capture's CPU
+	// clock (us) read together as the frame began, to put its timestamps
+	// on the CPU timeline
+	bool traced = false;
+	GLint64 gpuBase = 0;
+	double cpuBase = 0.0;
+};
+
+// A complete ("X") trace event, in us since the capture started
+struct TraceEvent
+{
+	std::string name;
+	unsigned int thread;            // 0 the GL thread, GPU_TRACK the GPU
+	double start;
+	double duration;
+};
+
+static const unsigned int GPU_TRACK = ~0u;
+
+struct TraceCapture
+{
+	std::atomic<bool> active{ false };  // collecting CPU events
+	std::mutex mutex;                   // guards events, from any thread
+	std::vector<TraceEvent> events;
+	Clock::time_point origin;
+
+	unsigned int requested = 0;         // frames, from the next BeginFrame
+	std::string requestedPath;
+	unsigned int firstFrame = 0;
+	unsigned int frameCount = 0;        // of the capture in progress, 0 if none
+	std::string path;
+	std::string lastPath;               // of the last file written
+
+	std::atomic<unsigned int> nextThread{ 1 };
+};
+
+// Scopes on any other thread are only timed for a trace, on a stack of
+// that thread's own
+struct TraceScope
+{
+	const char* name;
+	Clock::time_point start;
+};
+
+static thread_local bool t_GLThread = false;
+static thread_local unsigned int t_TraceThread = 0;      // assigned when first traced
+static thread_local std::vector<TraceScope> t_TraceStack;
+
+struct OpenScope
+{
+	unsigned int scope;
+	Clock::time_point start;
+	unsigned int record;            // NONE if CPU only
+};
+
+struct ProfilerState
+{
+	bool enabled = true;
+	bool requestEnabled = true;
+	bool resetRequested = false;
+	bool inFrame = false;
+
+	std::vector<Profiler::Scope> scopes;
+	std::vector<float> cpuThisFrame;     // ms per scope, summed over the frame
+	std::vector<unsigned int> touched;   // scopes opened this frame
+	std::vector<OpenScope> stack;
+
+	FrameQueries frames[Profiler::FRAMES];
+	unsigned int frame = 0;
+	unsigned int dropped = 0;
+
+	TraceCapture trace;
+};
+
+static ProfilerState s;
+
+static double TraceMicroseconds(Clock::time_point time)
+{
+	return std::chrono::duration<double, std::micro>(time - s.trace.origin).count();
+}
+
+static void AddTraceEvent(const std::string& name, unsigned int thread, double start, double duration)
+{
+	TraceEvent event;
+	event.name = name;
+	event.thread = thread;
+	event.start = start;
+	event.duration = duration;
+	std::lock_guard<std::mutex> lock(s.trace.mutex);
+	s.trace.events.push_back(event);
+}
+
+static unsigned int FindOrAddScope(const char* name, unsigned int parent)
+{
+	for (unsigned int i = 0; i < s.scopes.size(); i++)
+	{
+		if (s.scopes[i].parent == parent && s.scopes[i].name == name)
+			return i;
+	}
+
+	Profiler::Scope scope;
+	scope.name = name;
+	scope.parent = parent;
+	scope.depth = parent == Profiler::NONE ? 0 : s.scopes[parent].depth + 1;
+	scope.cpu.assign(Profiler::HISTORY, 0.0f);
+	scope.gpu.assign(Profiler::HISTORY, 0.0f);
+	scope.cpuCount = 0;
+	scope.gpuCount = 0;
+	scope.lastFrame = s.frame;
+	s.scopes.push_back(scope);
+	s.cpuThisFrame.push_back(0.0f);
+	return static_cast<unsigned int>(s.scopes.size() - 1);
+}
+
+static unsigned int WriteTimestamp(FrameQueries& frame)
+{
+	if (frame.used == frame.queries.size())
+	{
+		unsigned int query = 0;
+		GlCall(glGenQueries(1, &query));
+		frame.queries.push_back(query);
+	}
+	const unsigned int index = frame.used++;
+	GlCall(glQueryCounter(frame.queries[index], GL_TIMESTAMP));
+	return index;
+}
+
+static void PushSample(std::vector<float>& ring, unsigned int& count, float ms)
+{
+	ring[count % Profiler::HISTORY] = ms;
+	count++;
+}
+
+// Reads a frame's timestamps into its scopes' GPU histories, unless any
+// of them are still outstanding
+static void Resolve(FrameQueries& frame)
+{
+	if (!frame.pending)
+		return;
+	frame.pending = false;
+
+	bool available = true;
+	for (unsigned int i = 0; i < frame.used && available; i++)
+	{
+		GLint ready = 0;
+		GlCall(glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &ready));
+		available = ready != 0;
+	}
+	if (!available)
+	{
+		s.dropped++;
+		return;
+	}
+
+	FrameArena::Vector<GLuint64> times(frame.used, FrameArena::GetResource());
+	for (unsigned int i = 0; i < frame.used; i++)
+	{
+		GlCall(glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &times[i]));
+	}
+
+	// A scope opened several times sums to one sample
+	FrameArena::Vector<float> gpuMs(s.scopes.size(), -1.0f, FrameArena::GetResource());
+	for (const Record& record : frame.records)
+	{
+		if (record.beginQuery == Profiler::NONE || record.endQuery == Profiler::NONE)
+			continue;
+		const GLuint64 begin = times[record.beginQuery];
+		const GLuint64 end = times[record.endQuery];
+		const float ms = end > begin ? static_cast<float>(end - begin) / 1000000.0f : 0.0f;
+		gpuMs[record.scope] = std::max(gpuMs[record.scope], 0.0f) + ms;
+	}
+	for (unsigned int i = 0; i < gpuMs.size(); i++)
+	{
+		if (gpuMs[i] >= 0.0f)
+			PushSample(s.scopes[i].gpu, s.scopes[i].gpuCount, gpuMs[i]);
+	}
+
+	if (frame.traced)
+	{
+		for (const Record& record : frame.records)
+		{
+			if (record.beginQuery == Profiler::NONE || record.endQuery == Profiler::NONE)
+				continue;
+			const double begin = frame.cpuBase + (static_cast<double>(times[record.beginQuery]) - frame.gpuBase) / 1000.0;
+			const double end = frame.cpuBase + (static_cast<double>(times[record.endQuery]) - frame.gpuBase) / 1000.0;
+			AddTraceEvent(s.scopes[record.scope].name, GPU_TRACK, begin, std::max(end - begin, 0.0));
+		}
+	}
+}
+
+static std::string JsonString(const std::string& text)
+{
+	std::string quoted = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+// Chrome's JSON trace event format: process 0 is the CPU with a track per
+// thread, process 1 the GPU
+static void WriteTrace()
+{
+	std::lock_guard<std::mutex> lock(s.trace.mutex);
+	std::ofstream file(s.trace.path);
+	if (!file)
+	{
+		std::cerr << "Profiler: can't write " << s.trace.path << std::endl;
+		s.trace.events.clear();
+		return;
+	}
+
+	unsigned int threads = 1;
+	for (const TraceEvent& event : s.trace.events)
+	{
+		if (event.thread != GPU_TRACK)
+			threads = std::max(threads, event.thread + 1);
+	}
+
+	file << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+		<< "  { \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": { \"name\": \"CPU\" } },\n"
+		<< "  { \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": { \"name\": \"GPU\" } },\n"
+		<< "  { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": { \"name\": \"GL timestamps\" } },\n";
+	for (unsigned int thread = 0; thread < threads; thread++)
+	{
+		const std::string name = thread == 0 ? "GL thread" : "Thread " + std::to_string(thread);
+		file << "  { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << thread
+			<< ", \"args\": { \"name\": " << JsonString(name) << " } },\n";
+	}
+
+	file.precision(3);
+	file << std::fixed;
+	for (std::size_t i = 0; i < s.trace.events.size(); i++)
+	{
+		const TraceEvent& event = s.trace.events[i];
+		const bool gpu = event.thread == GPU_TRACK;
+		file << "  { \"name\": " << JsonString(event.name) << ", \"ph\": \"X\", \"pid\": " << (gpu ? 1 : 0)
+			<< ", \"tid\": " << (gpu ? 0 : event.thread) << ", \"ts\": " << event.start << ", \"dur\": " << event.duration
+			<< (i + 1 < s.trace.events.size() ? " },\n" : " }\n");
+	}
+	file << "] }\n";
+
+	std::cout << "Profiler: " << s.trace.events.size() << " trace events over " << s.trace.frameCount
+		<< " frames written to " << s.trace.path << std::endl;
+	s.trace.lastPath = s.trace.path;
+	s.trace.events.clear();
+}
+
+static void ClearFrame(FrameQueries& frame)
+{
+	frame.used = 0;
+	frame.records.clear();
+	frame.pending = false;
+	frame.traced = false;
+}
+
+void Profiler::BeginFrame()
+{
+	if (s.resetRequested)
+	{
+		s.scopes.clear();
+		s.cpuThisFrame.clear();
+		for (FrameQueries& frame : s.frames)
+			ClearFrame(frame);
+		s.resetRequested = false;
+	}
+
+	TraceCapture& trace = s.trace;
+	s.enabled = s.requestEnabled;
+	if (!s.enabled)
+	{
+		// Abandons a capture in progress
+		trace.active = false;
+		trace.frameCount = 0;
+		return;
+	}
+
+	t_GLThread = true;
+	if (trace.requested > 0 && trace.frameCount == 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(trace.mutex);
+			trace.events.clear();
+		}
+		trace.origin = Clock::now();
+		trace.firstFrame = s.frame;
+		trace.frameCount = trace.requested;
+		trace.path = trace.requestedPath;
+		trace.requested = 0;
+		trace.active = true;
+	}
+	// CPU events stop with the last captured frame...
+	if (trace.frameCount > 0 && s.frame >= trace.firstFrame + trace.frameCount)
+		trace.active = false;
+
+	FrameQueries& frame = s.frames[s.frame % FRAMES];
+	Resolve(frame);
+	ClearFrame(frame);
+
+	// ...and its GPU events have just been resolved, or it was dropped
+	if (trace.frameCount > 0 && s.frame >= trace.firstFrame + trace.frameCount - 1 + FRAMES)
+	{
+		WriteTrace();
+		trace.frameCount = 0;
+	}
+
+	if (trace.active)
+	{
+		frame.traced = true;
+		GlCall(glGetInteger64v(GL_TIMESTAMP, &frame.gpuBase));
+		frame.cpuBase = TraceMicroseconds(Clock::now());
+	}
+
+	s.inFrame = true;
+	BeginScope("Frame");
+}
+
+void Profiler::EndFrame()
+{
+	if (!s.inFrame)
+		return;
+
+	while (!s.stack.empty())
+		EndScope();
+
+	for (unsigned int scope : s.touched)
+	{
+		PushSample(s.scopes[scope].cpu, s.scopes[scope].cpuCount, s.cpuThisFrame[scope]);
+		s.cpuThisFrame[scope] = 0.0f;
+	}
+	s.touched.clear();
+
+	FrameQueries& frame = s.frames[s.frame % FRAMES];
+	frame.pending = !frame.records.empty();
+	s.frame++;
+	s.inFrame = false;
+}
+
+void Profiler::BeginScope(const char* name, bool gpu)
+{
+	if (!t_GLThread)
+	{
+		if (s.trace.active)
+			t_TraceStack.push_back({ name, Clock::now() });
+		return;
+	}
+	if (!s.inFrame)
+		return;
+
+	const unsigned int parent = s.stack.empty() ? NONE : s.stack.back().scope;
+	const unsigned int scope = FindOrAddScope(name, parent);
+	if (std::find(s.touched.begin(), s.touched.end(), scope) == s.touched.end())
+		s.touched.push_back(scope);
+	s.scopes[scope].lastFrame = s.frame;
+
+	OpenScope open;
+	open.scope = scope;
+	open.record = NONE;
+	if (gpu)
+	{
+		FrameQueries& frame = s.frames[s.frame % FRAMES];
+		Record record;
+		record.scope = scope;
+		record.beginQuery = WriteTimestamp(frame);
+		record.endQuery = NONE;
+		open.record = static_cast<unsigned int>(frame.records.size());
+		frame.records.push_back(record);
+	}
+	open.start = Clock::now();
+	s.stack.push_back(open);
+}
+
+void Profiler::EndScope()
+{
+	if (!t_GLThread)
+	{
+		if (t_TraceStack.empty())
+			return;
+		const TraceScope open = t_TraceStack.back();
+		t_TraceStack.pop_back();
+		if (s.trace.active)
+		{
+			if (t_TraceThread == 0)
+				t_TraceThread = s.trace.nextThread.fetch_add(1);
+			const double start = TraceMicroseconds(open.start);
+			AddTraceEvent(open.name, t_TraceThread, start, TraceMicroseconds(Clock::now()) - start);
+		}
+		return;
+	}
+	if (!s.inFrame || s.stack.empty())
+		return;
+
+	const OpenScope open = s.stack.back();
+	s.stack.pop_back();
+	const Clock::time_point end = Clock::now();
+	s.cpuThisFrame[open.scope] += std::chrono::duration<float, std::milli>(end - open.start).count();
+	if (s.trace.active)
+	{
+		const double start = TraceMicroseconds(open.start);
+		AddTraceEvent(s.scopes[open.scope].name, 0, start, TraceMicroseconds(end) - start);
+	}
+
+	if (open.record != NONE)
+	{
+		FrameQueries& frame = s.frames[s.frame % FRAMES];
+		frame.records[open.record].endQuery = WriteTimestamp(frame);
+	}
+}
+
+const std::vector<Profiler::Scope>& Profiler::GetScopes()
+{
+	return s.scopes;
+}
+
+unsigned int Profiler::Find(const char* name)
+{
+	for (unsigned int i = 0; i < s.scopes.size(); i++)
+	{
+		if (s.scopes[i].name == name)
+			return i;
+	}
+	return NONE;
+}
+
+bool Profiler::IsActive(unsigned int scope)
+{
+	return scope < s.scopes.size() && s.frame - s.scopes[scope].lastFrame <= FRAMES;
+}
+
+static Profiler::Stats Summarise(const std::vector<float>& ring, unsigned int count)
+{
+	Profiler::Stats stats;
+	stats.samples = count < Profiler::HISTORY ? count : Profiler::HISTORY;
+	if (stats.samples == 0)
+		return stats;
+
+	FrameArena::Vector<float> sorted(ring.begin(), ring.begin() + stats.samples, FrameArena::GetResource());
+	std::sort(sorted.begin(), sorted.end());
+	float sum = 0.0f;
+	for (float ms : sorted)
+		sum += ms;
+
+	stats.last = ring[(count - 1) % Profiler::HISTORY];
+	stats.mean = sum / static_cast<float>(stats.samples);
+	stats.p95 = sorted[(stats.samples * 95 + 99) / 100 - 1];
+	stats.max = sorted.back();
+	return stats;
+}
+
+Profiler::Stats Profiler::GetCpuStats(unsigned int scope)
+{
+	if (scope >= s.scopes.size())
+		return Stats();
+	return Summarise(s.scopes[scope].cpu, s.scopes[scope].cpuCount);
+}
+
+Profiler::Stats Profiler::GetGpuStats(unsigned int scope)
+{
+	if (scope >= s.scopes.size())
+		return Stats();
+	return Summarise(s.scopes[scope].gpu, s.scopes[scope].gpuCount);
+}
+
+float Profiler::GetCpuMs(const char* name)
+{
+	const unsigned int scope = Find(name);
+	if (scope == NONE || s.scopes[scope].cpuCount == 0)
+		return 0.0f;
+	return s.scopes[scope].cpu[(s.scopes[scope].cpuCount - 1) % HISTORY];
+}
+
+float Profiler::GetGpuMs(const char* name)
+{
+	const unsigned int scope = Find(name);
+	if (scope == NONE || s.scopes[scope].gpuCount == 0)
+		return 0.0f;
+	return s.scopes[scope].gpu[(s.scopes[scope].gpuCount - 1) % HISTORY];
+}
+
+void Profiler::GetHistory(const std::vector<float>& ring, unsigned int count, std::vector<float>& out)
+{
+	out.clear();
+	if (count <= HISTORY)
+	{
+		out.assign(ring.begin(), ring.begin() + count);
+		return;
+	}
+	const unsigned int oldest = count % HISTORY;
+	out.assign(ring.begin() + oldest, ring.end());
+	out.insert(out.end(), ring.begin(), ring.begin() + oldest);
+}
+
+bool Profiler::IsEnabled()
+{
+	return s.requestEnabled;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	s.requestEnabled = enabled;
+}
+
+unsigned int Profiler::GetDroppedFrames()
+{
+	return s.dropped;
+}
+
+void Profiler::CaptureTrace(unsigned int frames, const std::string& path)
+{
+	if (frames == 0 || IsCapturingTrace())
+		return;
+	s.trace.requested = frames;
+	s.trace.requestedPath = path;
+}
+
+bool Profiler::IsCapturingTrace()
+{
+	return s.trace.requested > 0 || s.trace.frameCount > 0;
+}
+
+const std::string& Profiler::GetLastTracePath()
+{
+	return s.trace.lastPath;
+}
+
+void Profiler::Reset()
+{
+	s.resetRequested = true;
+}
+
+void Profiler::Shutdown()
+{
+	for (FrameQueries& frame : s.frames)
+	{
+		if (!frame.queries.empty())
+		{
+			GlCall(glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data()));
+		}
+		frame.queries.clear();
+		ClearFrame(frame);
+	}
+	s.stack.clear();
+	s.inFrame = false;
+}
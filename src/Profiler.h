@@ -0,0 +1,143 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/**
+ * Profiler — nested CPU and GPU timing scopes for every test
+ *
+ * TestGPUParticles used to time its passes with a hand-rolled pair of
+ * GL_TIME_ELAPSED queries per pass, and no other test had any timing.
+ * Here a scope is one line wherever it's wanted:
+ *
+ *     Profiler::BeginFrame();                 // top of the main loop
+ *     {
+ *         PROFILE_SCOPE("Shadow pass");
+ *         ... draws ...
+ *         {
+ *             PROFILE_SCOPE("Blur");          // nests under Shadow pass
+ *         }
+ *     }
+ *     Profiler::EndFrame();                   // before the swap
+ *
+ * Scopes are identified by name under their parent, so the same name in
+ * two places is two scopes, and one opened several times a frame adds up
+ * to one sample for that frame. Everything nests under the "Frame" scope
+ * that BeginFrame opens and EndFrame closes.
+ *
+ * GPU TIME
+ *   Each scope writes a GL_TIMESTAMP query where it opens and where it
+ *   closes; unlike GL_TIME_ELAPSED, timestamps nest. The queries of a
+ *   frame are read back FRAMES frames later, by which point the GPU has
+ *   normally finished them. A frame whose results still aren't available
+ *   then is dropped rather than waited for, so the profiler never stalls
+ *   the pipeline; GetDroppedFrames() counts those.
+ *
+ * STATISTICS
+ *   The last HISTORY samples of each scope are kept for both clocks, and
+ *   GetCpuStats / GetGpuStats summarise them as mean, 95th percentile and max. The CPU
+ *   sample is the wall time on the GL thread between open and close.
+ *
+ * TRACE CAPTURE
+ *   CaptureTrace(n, path) records the next n frames as a Chrome trace
+ *   (open it in chrome://tracing or ui.perfetto.dev): every CPU scope on
+ *   a track per thread, and every GPU scope on a GPU track. Each captured
+ *   frame reads glGetInteger64v(GL_TIMESTAMP) against the CPU clock as it
+ *   begins, which puts its timestamp queries on the CPU timeline. The
+ *   file is written once the last frame has been read back, FRAMES frames
+ *   after it.
+ *
+ * GL thread only: scopes opened on any other thread are ignored, except
+ * in a trace, where they show as CPU time on that thread's track. Scopes
+ * outside BeginFrame..EndFrame are ignored.
+ */
+class Profiler
+{
+public:
+	static const unsigned int FRAMES = 4;       // query ring depth, frames of latency
+	static const unsigned int HISTORY = 240;    // samples kept per scope
+
+	static const unsigned int NONE = ~0u;
+
+	struct Stats
+	{
+		float last = 0.0f;          // ms, the most recent sample
+		float mean = 0.0f;
+		float p95 = 0.0f;
+		float max = 0.0f;
+		unsigned int samples = 0;
+	};
+
+	struct Scope
+	{
+		std::string name;
+		unsigned int parent;        // NONE for Frame
+		unsigned int depth;
+		std::vector<float> cpu;     // ms, a ring of HISTORY samples
+		std::vector<float> gpu;
+		unsigned int cpuCount;      // samples ever taken
+		unsigned int gpuCount;
+		unsigned int lastFrame;     // the frame it was last opened in
+	};
+
+	// Resolves the queries of FRAMES frames ago and opens the Frame scope
+	static void BeginFrame();
+	// Closes the Frame scope and every scope the frame left open
+	static void EndFrame();
+
+	static void BeginScope(const char* name, bool gpu = true);
+	static void EndScope();
+
+	// Every scope seen since the last Reset, in the order they were first
+	// opened, so a parent always comes before its children
+	static const std::vector<Scope>& GetScopes();
+	// The first scope called `name`, or NONE
+	static unsigned int Find(const char* name);
+	// True if the scope was opened within the last FRAMES frames, so it's
+	// still being measured
+	static bool IsActive(unsigned int scope);
+
+	static Stats GetCpuStats(unsigned int scope);
+	static Stats GetGpuStats(unsigned int scope);
+	// Shorthand for a scope's most recent sample, 0 if there is none
+	static float GetCpuMs(const char* name);
+	static float GetGpuMs(const char* name);
+
+	// A ring's samples oldest first, for ImGui::PlotLines
+	static void GetHistory(const std::vector<float>& ring, unsigned int count, std::vector<float>& out);
+
+	// Off, no scope costs more than a branch; applies at the next BeginFrame
+	static bool IsEnabled();
+	static void SetEnabled(bool enabled);
+
+	static unsigned int GetDroppedFrames();
+
+	// Starts a trace of `frames` frames at the next BeginFrame, unless one
+	// is already under way
+	static void CaptureTrace(unsigned int frames, const std::string& path);
+	// From the request until the file is written
+	static bool IsCapturingTrace();
+	static const std::string& GetLastTracePath();
+
+	// Forgets every scope, e.g. when the test changes. Takes effect at the
+	// next BeginFrame, and the frames in flight are discarded.
+	static void Reset();
+	// Deletes the queries; before the context goes
+	static void Shutdown();
+
+	// RAII scope; use PROFILE_SCOPE
+	class ScopeGuard
+	{
+	public:
+		explicit ScopeGuard(const char* name, bool gpu = true) { BeginScope(name, gpu); }
+		~ScopeGuard() { EndScope(); }
+		ScopeGuard(const ScopeGuard&) = delete;
+		ScopeGuard& operator=(const ScopeGuard&) = delete;
+	};
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// A CPU and GPU scope to the end of the enclosing block
+#define PROFILE_SCOPE(name) Profiler::ScopeGuard PROFILE_CONCAT(profileScope, __LINE__)(name)
+// A CPU-only scope, for code that issues no GL work
+#define PROFILE_SCOPE_CPU(name) Profiler::ScopeGuard PROFILE_CONCAT(profileScope, __LINE__)(name, false)
@@ -0,0 +1,314 @@
+#include "QuadBatch.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "IndexBuffer.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "TextureArray.h"
+#include "VertexArray.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+template<>
+struct VertexLayoutOf<QuadBatch::Vertex>
+{
+	static constexpr VertexAttribute attributes[] = {
+		VERTEX_ATTRIBUTE(QuadBatch::Vertex, position, GL_FLOAT, 3, false),          // location 0
+		VERTEX_ATTRIBUTE(QuadBatch::Vertex, uv, GL_FLOAT, 2, false),                // location 1
+		VERTEX_ATTRIBUTE(QuadBatch::Vertex, colour, GL_UNSIGNED_BYTE, 4, true),     // location 2
+		VERTEX_ATTRIBUTE(QuadBatch::Vertex, texture, GL_UNSIGNED_SHORT, 2, false),  // location 3, as floats
+	};
+};
+static_assert(VertexLayoutMatchesMembers<QuadBatch::Vertex>(), "QuadBatch::Vertex layout disagrees with its members");
+static_assert(VertexLayoutIsTightlyPacked<QuadBatch::Vertex>(), "QuadBatch::Vertex layout does not cover the struct");
+
+namespace
+{
+	// Built for MAX_CAPACITY quads by the first batch, kept while any batch lives
+	std::weak_ptr<IndexBuffer> s_SharedIndices;
+
+	std::shared_ptr<IndexBuffer> GetSharedIndices()
+	{
+		std::shared_ptr<IndexBuffer> indices = s_SharedIndices.lock();
+		if (indices)
+			return indices;
+
+		std::vector<unsigned int> data;
+		data.reserve(QuadBatch::MAX_CAPACITY * 6);
+		for (unsigned int quad = 0; quad < QuadBatch::MAX_CAPACITY; quad++)
+		{
+			const unsigned int first = quad * 4;
+			data.insert(data.end(), { first + 0, first + 1, first + 2, first + 2, first + 3, first + 0 });
+		}
+		indices = std::make_shared<IndexBuffer>(data.data(), static_cast<unsigned int>(data.size()));   // picks 16-bit, see MAX_CAPACITY
+		s_SharedIndices = indices;
+		return indices;
+	}
+
+	unsigned char ToUnorm8(float v)
+	{
+		v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+		return static_cast<unsigned char>(v * 255.0f + 0.5f);
+	}
+}
+
+QuadBatch::Quad QuadBatch::Quad::Rect(const glm::vec2& centre, const glm::vec2& size, float z)
+{
+	const glm::vec2 lo = centre - size * 0.5f;
+	const glm::vec2 hi = centre + size * 0.5f;
+	Quad quad;
+	quad.corners[0] = glm::vec3(lo.x, lo.y, z);
+	quad.corners[1] = glm::vec3(hi.x, lo.y, z);
+	quad.corners[2] = glm::vec3(hi.x, hi.y, z);
+	quad.corners[3] = glm::vec3(lo.x, hi.y, z);
+	return quad;
+}
+
+QuadBatch::Quad QuadBatch::Quad::Transformed(const glm::mat4& transform)
+{
+	Quad quad;
+	quad.corners[0] = glm::vec3(transform * glm::vec4(-0.5f, -0.5f, 0.0f, 1.0f));
+	quad.corners[1] = glm::vec3(transform * glm::vec4(0.5f, -0.5f, 0.0f, 1.0f));
+	quad.corners[2] = glm::vec3(transform * glm::vec4(0.5f, 0.5f, 0.0f, 1.0f));
+	quad.corners[3] = glm::vec3(transform * glm::vec4(-0.5f, 0.5f, 0.0f, 1.0f));
+	return quad;
+}
+
+QuadBatch::QuadBatch(unsigned int capacity)
+	: m_Capacity(std::min(std::max(capacity, 1u), MAX_CAPACITY)), m_BatchSize(m_Capacity), m_Buffer(0),
+	  m_Persistent(false), m_Mapped(nullptr), m_Segment(0), m_Head(0), m_First(0), m_Write(nullptr),
+	  m_ArrayCount(0), m_TextureCount(0), m_ViewProjection(1.0f), m_InBatch(false)
+{
+	for (unsigned int i = 0; i < SEGMENT_COUNT; i++)
+		m_Fences[i] = nullptr;
+
+	const GLsizeiptr totalSize = static_cast<GLsizeiptr>(m_Capacity) * 4 * sizeof(Vertex) * SEGMENT_COUNT;
+
+	GlCall(glGenBuffers(1, &m_Buffer));
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer));
+
+	// As StreamingBuffer: immutable storage, mapped for good
+	m_Persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+	if (m_Persistent)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GlCall(glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags));
+		GlCall(m_Mapped = static_cast<Vertex*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags)));
+	}
+
+	if (!m_Mapped)
+	{
+		m_Persistent = false;
+		GlCall(glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW));
+		m_Staging.reset(new Vertex[m_Capacity * 4]);
+	}
+	GpuMemory::TrackBuffer(GpuMemory::Category::Vertex, m_Buffer, static_cast<std::size_t>(totalSize));
+
+	// The VAO's element binding is the shared index buffer's
+	m_VAO = std::make_unique<VertexArray>();
+	m_VAO->SetLayout(GetVertexLayout<Vertex>());
+	m_VAO->BindVertexBuffer(VertexArray::VERTEX_BINDING, m_Buffer, sizeof(Vertex));
+	m_VAO->Bind();
+	m_Indices = GetSharedIndices();
+	m_Indices->Bind();
+	m_VAO->unBind();
+
+	m_Shader = std::make_unique<Shader>("res/Shaders/QuadBatch.shader");
+	for (unsigned int i = 0; i < MAX_ARRAYS; i++)
+		m_Shader->setUniform1i("u_Arrays[" + std::to_string(i) + "]", static_cast<int>(TEXTURE_UNIT + i));
+	for (unsigned int i = 0; i < MAX_TEXTURES; i++)
+		m_Shader->setUniform1i("u_Textures[" + std::to_string(i) + "]", static_cast<int>(TEXTURE_UNIT + MAX_ARRAYS + i));
+
+	m_Write = m_Persistent ? m_Mapped : m_Staging.get();
+}
+
+QuadBatch::~QuadBatch()
+{
+	for (unsigned int i = 0; i < SEGMENT_COUNT; i++)
+	{
+		if (m_Fences[i])
+			glDeleteSync(m_Fences[i]);
+	}
+
+	if (m_Persistent)
+	{
+		GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer));
+		GlCall(glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+	}
+
+	GlCall(glDeleteBuffers(1, &m_Buffer));
+	GLState::OnBufferDeleted(m_Buffer);
+}
+
+void QuadBatch::SetBatchSize(unsigned int quads)
+{
+	m_BatchSize = std::min(std::max(quads, 1u), m_Capacity);
+}
+
+void QuadBatch::Begin(const glm::mat4& viewProjection)
+{
+	if (m_InBatch)
+		End();
+
+	m_ViewProjection = viewProjection;
+	m_Stats = Stats();
+	m_InBatch = true;
+}
+
+void QuadBatch::Submit(const Quad& quad, const glm::vec4& colour)
+{
+	MakeRoom();
+	Write(quad, colour, NO_TEXTURE, 0);
+}
+
+void QuadBatch::Submit(const Quad& quad, const glm::vec4& colour, const TextureArray& textures, int textureLayer)
+{
+	MakeRoom();
+	const unsigned short slot = FindSlot(textures.GetID(), true);
+	Write(quad, colour, slot, static_cast<unsigned short>(std::max(textureLayer, 0)));
+}
+
+void QuadBatch::Submit(const Quad& quad, const glm::vec4& colour, const Texture& texture)
+{
+	MakeRoom();
+	const unsigned short slot = FindSlot(texture.GetID(), false);
+	Write(quad, colour, slot, 0);
+}
+
+void QuadBatch::End()
+{
+	if (!m_InBatch)
+		return;
+
+	Flush();
+	m_InBatch = false;
+}
+
+void QuadBatch::MakeRoom()
+{
+	if (m_Head - m_First < m_BatchSize && m_Head < m_Capacity)
+		return;
+
+	m_Stats.fullFlushes++;
+	Flush();
+}
+
+unsigned short QuadBatch::FindSlot(unsigned int texture, bool array)
+{
+	unsigned int* slots = array ? m_Arrays : m_Textures;
+	unsigned int& count = array ? m_ArrayCount : m_TextureCount;
+	const unsigned int first = array ? 0 : MAX_ARRAYS;
+	const unsigned int limit = array ? MAX_ARRAYS : MAX_TEXTURES;
+
+	// A run of quads mostly repeats the last texture: search from the end
+	for (unsigned int i = count; i-- > 0;)
+	{
+		if (slots[i] == texture)
+			return static_cast<unsigned short>(first + i);
+	}
+
+	if (count == limit)
+	{
+		m_Stats.textureFlushes++;
+		Flush();
+	}
+	slots[count] = texture;
+	return static_cast<unsigned short>(first + count++);
+}
+
+void QuadBatch::Write(const Quad& quad, const glm::vec4& colour, unsigned short slot, unsigned short layer)
+{
+	const unsigned char rgba[4] = { ToUnorm8(colour.r), ToUnorm8(colour.g), ToUnorm8(colour.b), ToUnorm8(colour.a) };
+	const glm::vec2 uvs[4] = { quad.uvMin, glm::vec2(quad.uvMax.x, quad.uvMin.y), quad.uvMax,
+		glm::vec2(quad.uvMin.x, quad.uvMax.y) };
+
+	for (unsigned int corner = 0; corner < 4; corner++)
+	{
+		Vertex& vertex = m_Write[corner];
+		vertex.position = quad.corners[corner];
+		vertex.uv = uvs[corner];
+		vertex.colour[0] = rgba[0];
+		vertex.colour[1] = rgba[1];
+		vertex.colour[2] = rgba[2];
+		vertex.colour[3] = rgba[3];
+		vertex.texture[0] = slot;
+		vertex.texture[1] = layer;
+	}
+
+	m_Write += 4;
+	m_Head++;
+	m_Stats.quads++;
+}
+
+void QuadBatch::Flush()
+{
+	const unsigned int quads = m_Head - m_First;
+	const unsigned int firstVertex = (m_Segment * m_Capacity + m_First) * 4;
+	if (quads > 0)
+	{
+		// Coherent mapping: already visible. Otherwise the batch was staged.
+		if (!m_Persistent)
+		{
+			GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer));
+			GlCall(glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(firstVertex) * sizeof(Vertex),
+				static_cast<GLsizeiptr>(quads) * 4 * sizeof(Vertex), m_Staging.get()));
+		}
+
+		m_Shader->Bind();
+		m_Shader->setUniformMat4f("u_ViewProjection", m_ViewProjection);
+		for (unsigned int i = 0; i < m_ArrayCount; i++)
+			GLState::BindTextureToUnit(TEXTURE_UNIT + i, GL_TEXTURE_2D_ARRAY, m_Arrays[i]);
+		for (unsigned int i = 0; i < m_TextureCount; i++)
+			GLState::BindTextureToUnit(TEXTURE_UNIT + MAX_ARRAYS + i, GL_TEXTURE_2D, m_Textures[i]);
+
+		m_VAO->Bind();
+		m_Indices->Bind();
+		Renderer renderer;
+		renderer.DrawIndexed(quads * 6, 0, static_cast<int>(firstVertex), m_Indices->GetType());
+		m_VAO->unBind();
+
+		// The segment's last draw so far: once it is done, so is the rest
+		if (m_Fences[m_Segment])
+			glDeleteSync(m_Fences[m_Segment]);
+		m_Fences[m_Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_Stats.draws++;
+	}
+
+	m_ArrayCount = m_TextureCount = 0;
+	m_First = m_Head;
+	if (m_Head >= m_Capacity)
+	{
+		m_Segment = (m_Segment + 1) % SEGMENT_COUNT;
+		WaitForSegment(m_Segment);
+		m_Head = m_First = 0;
+	}
+	m_Write = m_Persistent ? m_Mapped + (m_Segment * m_Capacity + m_Head) * 4 : m_Staging.get();
+}
+
+// As StreamingBuffer::WaitForRegion: poll, then wait in 1 ms steps
+void QuadBatch::WaitForSegment(unsigned int segment)
+{
+	GLsync fence = m_Fences[segment];
+	if (!fence)
+		return;
+
+	const auto start = std::chrono::steady_clock::now();
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		m_Stats.fenceStalls++;
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+	m_Stats.fenceWaitMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	glDeleteSync(fence);
+	m_Fences[segment] = nullptr;
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <GL/glew.h>
+#include <memory>
+
+#include "glm/glm.hpp"
+
+class IndexBuffer;
+class Shader;
+class Texture;
+class TextureArray;
+class VertexArray;
+
+/**
+ * QuadBatch — any number of textured quads a frame, a few draw calls each
+ *
+ * TestBatching built its grid once with push_back into a std::vector,
+ * copied it into a static VBO and rebuilt both on "Regenerate": fine for a
+ * fixed picture, no use for sprites, UI or particles that move every
+ * frame. Here quads are submitted one at a time, every frame:
+ *
+ *     batch.Begin(projection * view);
+ *     for (const Sprite& sprite : sprites)
+ *         batch.Submit(QuadBatch::Quad::Rect(sprite.position, sprite.size), sprite.colour, atlasArray, sprite.layer);
+ *     batch.End();
+ *
+ * and each goes straight into mapped GPU memory as four vertices. There is
+ * no index data to write: every quad is the same two triangles, so one
+ * index buffer of 0,1,2 2,3,0, 4,5,6 ... for GetCapacity() quads is built
+ * once and shared by every QuadBatch, each draw picking its vertices with
+ * a baseVertex. At 16383 quads the highest index is 65531, so it still
+ * fits 16-bit indices: IndexBuffer keeps 16 bits only below 0xFFFF, the
+ * primitive restart index, and 16384 quads would reach 65535.
+ *
+ * FLUSHING
+ *   A batch is drawn when it is full (SetBatchSize quads, at most the
+ *   capacity), when a quad needs a texture and every slot is taken by
+ *   others, and at End. Up to MAX_ARRAYS TextureArrays and MAX_TEXTURES
+ *   plain textures (an atlas) share one batch, bound to units
+ *   TEXTURE_UNIT .. TEXTURE_UNIT + 7 and picked per vertex; Stats counts
+ *   the draws each reason cost. The quads of a batch are drawn in
+ *   submission order.
+ *
+ * MEMORY
+ *   With buffer storage (GL 4.4 or ARB_buffer_storage, as StreamingBuffer)
+ *   the vertex buffer is mapped once, persistently and coherently;
+ *   without, a CPU copy of each batch goes up with glBufferSubData. The
+ *   buffer is SEGMENT_COUNT segments of a full batch each. Batches fill a
+ *   segment in turn; a segment is only written again once the fence
+ *   after its last draw has signalled. A million quads a frame at 16383 a
+ *   batch go around the ring several times, so the CPU then waits on
+ *   draws of the same frame: the fence wait in Stats is the GPU not
+ *   keeping up, not the upload.
+ *
+ * A quad is 112 bytes of vertices, where an instanced draw could read a
+ * 16-byte record per quad (TestParticleSystem's instances): the batch
+ * pays for taking any four corners, 2D or 3D, and any texture. Blend,
+ * depth and cull state are the caller's. GL thread only.
+ */
+class QuadBatch
+{
+public:
+	static const unsigned int MAX_CAPACITY = 16383;   // 16-bit indices, below the restart index
+	static const unsigned int SEGMENT_COUNT = 8;
+	static const unsigned int MAX_ARRAYS = 4;
+	static const unsigned int MAX_TEXTURES = 4;
+	static const unsigned int TEXTURE_UNIT = 0;        // first of MAX_ARRAYS + MAX_TEXTURES
+
+	// Four corners, counter-clockwise from the one at uvMin
+	struct Quad
+	{
+		glm::vec3 corners[4];
+		glm::vec2 uvMin = glm::vec2(0.0f);
+		glm::vec2 uvMax = glm::vec2(1.0f);
+
+		// Axis-aligned in the z = `z` plane
+		static Quad Rect(const glm::vec2& centre, const glm::vec2& size, float z = 0.0f);
+		// The unit square (-0.5 .. 0.5 in x and y) under `transform`
+		static Quad Transformed(const glm::mat4& transform);
+	};
+
+	// The layout of QuadBatch.shader
+	struct Vertex
+	{
+		glm::vec3 position;
+		glm::vec2 uv;
+		unsigned char colour[4];      // rgba8
+		unsigned short texture[2];    // slot (NO_TEXTURE for none), layer
+	};
+	static const unsigned short NO_TEXTURE = 0xFFFF;
+
+	struct Stats
+	{
+		unsigned int quads = 0;           // since Begin
+		unsigned int draws = 0;
+		unsigned int fullFlushes = 0;     // draws for a full batch
+		unsigned int textureFlushes = 0;  // draws for a texture that didn't fit
+		float fenceWaitMs = 0.0f;         // waiting for a segment to come free
+		unsigned int fenceStalls = 0;
+	};
+
+	// `capacity` quads a batch, at most MAX_CAPACITY
+	explicit QuadBatch(unsigned int capacity = MAX_CAPACITY);
+	~QuadBatch();
+	QuadBatch(const QuadBatch&) = delete;
+	QuadBatch& operator=(const QuadBatch&) = delete;
+
+	void Begin(const glm::mat4& viewProjection);
+	void Submit(const Quad& quad, const glm::vec4& colour);
+	void Submit(const Quad& quad, const glm::vec4& colour, const TextureArray& textures, int textureLayer);
+	void Submit(const Quad& quad, const glm::vec4& colour, const Texture& texture);
+	// Draws what has been submitted; Begin again for the next frame
+	void End();
+
+	// Draw every `quads` (1 .. capacity) rather than when full, for
+	// measuring what a draw call costs
+	void SetBatchSize(unsigned int quads);
+	unsigned int GetBatchSize() const { return m_BatchSize; }
+	unsigned int GetCapacity() const { return m_Capacity; }
+
+	bool IsPersistent() const { return m_Persistent; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	// Flushes a full batch, before a quad picks its slot
+	void MakeRoom();
+	void Write(const Quad& quad, const glm::vec4& colour, unsigned short slot, unsigned short layer);
+	// The slot `texture` is bound to in this batch, flushing first if it
+	// has to; arrays take slots 0 .. MAX_ARRAYS - 1, textures the rest
+	unsigned short FindSlot(unsigned int texture, bool array);
+	void Flush();
+	void WaitForSegment(unsigned int segment);
+
+	unsigned int m_Capacity;
+	unsigned int m_BatchSize;
+	unsigned int m_Buffer;
+	bool m_Persistent;
+	Vertex* m_Mapped;               // the whole ring; null on the fallback path
+	std::unique_ptr<Vertex[]> m_Staging;
+	std::unique_ptr<VertexArray> m_VAO;
+	std::shared_ptr<IndexBuffer> m_Indices;
+	std::unique_ptr<Shader> m_Shader;
+
+	GLsync m_Fences[SEGMENT_COUNT];
+	unsigned int m_Segment;
+	unsigned int m_Head;            // quads used in the segment, drawn or not
+	unsigned int m_First;           // the batch's first quad in it
+	Vertex* m_Write;                // the next quad's vertices
+
+	unsigned int m_Arrays[MAX_ARRAYS];
+	unsigned int m_Textures[MAX_TEXTURES];
+	unsigned int m_ArrayCount;
+	unsigned int m_TextureCount;
+
+	glm::mat4 m_ViewProjection;
+	bool m_InBatch;
+	Stats m_Stats;
+};
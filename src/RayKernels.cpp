@@ -0,0 +1,363 @@
+#include "RayKernels.h"
+
+#include <cmath>
+
+#if !defined(RAYKERNELS_SCALAR) && (defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define RAYKERNELS_SIMD 1
+#include <immintrin.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Primitive tests
+// ---------------------------------------------------------------------------
+
+bool RayIntersectSphere(const Ray& ray, const glm::vec3& centre, float radius, float& t)
+{
+	// |origin + t*direction - centre|^2 = radius^2 is a quadratic in t; the
+	// half-b form saves a couple of multiplies.
+	const glm::vec3 oc = ray.origin - centre;
+	const float a = glm::dot(ray.direction, ray.direction);
+	const float halfB = glm::dot(oc, ray.direction);
+	const float c = glm::dot(oc, oc) - radius * radius;
+	const float discriminant = halfB * halfB - a * c;
+	if (discriminant < 0.0f)
+		return false;
+
+	// Nearer root first; the farther one when the origin is inside
+	const float root = std::sqrt(discriminant);
+	float hit = (-halfB - root) / a;
+	if (hit < 0.0f)
+		hit = (-halfB + root) / a;
+	if (hit < 0.0f || hit >= t)
+		return false;
+
+	t = hit;
+	return true;
+}
+
+bool RayIntersectTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+	float& t, float& u, float& v)
+{
+	// Moller-Trumbore: solve origin + t*direction = v0 + u*e1 + v*e2 with
+	// Cramer's rule, rejecting as soon as u or v leaves the triangle.
+	const glm::vec3 e1 = v1 - v0;
+	const glm::vec3 e2 = v2 - v0;
+	const glm::vec3 p = glm::cross(ray.direction, e2);
+	const float det = glm::dot(e1, p);
+	if (std::fabs(det) < 1e-12f)
+		return false;   // ray parallel to the triangle
+
+	const float invDet = 1.0f / det;
+	const glm::vec3 s = ray.origin - v0;
+	const float hitU = glm::dot(s, p) * invDet;
+	if (hitU < 0.0f || hitU > 1.0f)
+		return false;
+
+	const glm::vec3 q = glm::cross(s, e1);
+	const float hitV = glm::dot(ray.direction, q) * invDet;
+	if (hitV < 0.0f || hitU + hitV > 1.0f)
+		return false;
+
+	const float hit = glm::dot(e2, q) * invDet;
+	if (hit < 0.0f || hit >= t)
+		return false;
+
+	t = hit;
+	u = hitU;
+	v = hitV;
+	return true;
+}
+
+// ---------------------------------------------------------------------------
+// SoA containers
+// ---------------------------------------------------------------------------
+
+void TriangleSoA::Resize(size_t count)
+{
+	v0x.resize(count); v0y.resize(count); v0z.resize(count);
+	e1x.resize(count); e1y.resize(count); e1z.resize(count);
+	e2x.resize(count); e2y.resize(count); e2z.resize(count);
+}
+
+void TriangleSoA::Set(size_t i, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2)
+{
+	const glm::vec3 e1 = v1 - v0;
+	const glm::vec3 e2 = v2 - v0;
+	v0x[i] = v0.x; v0y[i] = v0.y; v0z[i] = v0.z;
+	e1x[i] = e1.x; e1y[i] = e1.y; e1z[i] = e1.z;
+	e2x[i] = e2.x; e2y[i] = e2.y; e2z[i] = e2.z;
+}
+
+// ---------------------------------------------------------------------------
+// Lane wrappers
+//
+// The kernels are written once against these few operations; only the
+// register type and intrinsics differ between SSE and AVX2.
+// ---------------------------------------------------------------------------
+
+#ifdef RAYKERNELS_SIMD
+namespace
+{
+#ifdef __AVX2__
+	typedef __m256 vfloat;
+
+	inline vfloat Set1(float f) { return _mm256_set1_ps(f); }
+	inline vfloat Load(const float* p) { return _mm256_loadu_ps(p); }
+	inline void Store(float* p, vfloat a) { _mm256_storeu_ps(p, a); }
+	inline vfloat Add(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+	inline vfloat Sub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+	inline vfloat Mul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+	inline vfloat Div(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+	inline vfloat Max(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+	inline vfloat Sqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+	inline vfloat And(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+	inline vfloat Abs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	inline vfloat Less(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline vfloat LessEqual(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	inline vfloat GreaterEqual(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	inline vfloat Greater(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	// mask ? a : b, per lane
+	inline vfloat Select(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }
+	inline int AnyLane(vfloat mask) { return _mm256_movemask_ps(mask); }
+#else
+	typedef __m128 vfloat;
+
+	inline vfloat Set1(float f) { return _mm_set1_ps(f); }
+	inline vfloat Load(const float* p) { return _mm_loadu_ps(p); }
+	inline void Store(float* p, vfloat a) { _mm_storeu_ps(p, a); }
+	inline vfloat Add(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+	inline vfloat Sub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+	inline vfloat Mul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+	inline vfloat Div(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+	inline vfloat Max(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+	inline vfloat Sqrt(vfloat a) { return _mm_sqrt_ps(a); }
+	inline vfloat And(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+	inline vfloat Abs(vfloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	inline vfloat Less(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+	inline vfloat LessEqual(vfloat a, vfloat b) { return _mm_cmple_ps(a, b); }
+	inline vfloat GreaterEqual(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+	inline vfloat Greater(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+	// SSE2 has no blend: (mask & a) | (~mask & b)
+	inline vfloat Select(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	inline int AnyLane(vfloat mask) { return _mm_movemask_ps(mask); }
+#endif
+
+	const unsigned int LANES = sizeof(vfloat) / sizeof(float);
+
+	// 0, 1, 2, ... added to a chunk's start to number its lanes. Indices
+	// are kept as floats so they can be selected with the same masks as t;
+	// exact up to 2^24, far more than a leaf or a batch ever holds.
+	inline vfloat LaneOffsets()
+	{
+		static const float offsets[8] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+		return Load(offsets);
+	}
+
+	// The lane with the smallest t below `t`, or -1. Lowers `t` to it.
+	inline int NearestLane(vfloat bestT, float& t)
+	{
+		float lanes[LANES];
+		Store(lanes, bestT);
+		int nearest = -1;
+		for (unsigned int lane = 0; lane < LANES; lane++)
+		{
+			if (lanes[lane] < t)
+			{
+				t = lanes[lane];
+				nearest = static_cast<int>(lane);
+			}
+		}
+		return nearest;
+	}
+
+	inline float Lane(vfloat a, int lane)
+	{
+		float lanes[LANES];
+		Store(lanes, a);
+		return lanes[lane];
+	}
+}
+#endif
+
+// Moller-Trumbore on a corner and two edges, for the tail of a run and the
+// scalar build; the same steps as the vector loop, one lane wide.
+static bool IntersectTriangleEdges(const Ray& ray, const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2,
+	float& t, float& u, float& v)
+{
+	const glm::vec3 p = glm::cross(ray.direction, e2);
+	const float det = glm::dot(e1, p);
+	if (std::fabs(det) < 1e-12f)
+		return false;
+
+	const float invDet = 1.0f / det;
+	const glm::vec3 s = ray.origin - v0;
+	const float hitU = glm::dot(s, p) * invDet;
+	if (hitU < 0.0f || hitU > 1.0f)
+		return false;
+
+	const glm::vec3 q = glm::cross(s, e1);
+	const float hitV = glm::dot(ray.direction, q) * invDet;
+	if (hitV < 0.0f || hitU + hitV > 1.0f)
+		return false;
+
+	const float hit = glm::dot(e2, q) * invDet;
+	if (hit < 0.0f || hit >= t)
+		return false;
+
+	t = hit;
+	u = hitU;
+	v = hitV;
+	return true;
+}
+
+const char* RayKernels::GetInstructionSet()
+{
+#if !defined(RAYKERNELS_SIMD)
+	return "Scalar";
+#elif defined(__AVX2__)
+	return "AVX2";
+#else
+	return "SSE";
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Kernels
+// ---------------------------------------------------------------------------
+
+unsigned int RayKernels::IntersectSpheres(const Ray& ray, const SphereSoA& spheres, unsigned int first, unsigned int count, float& t)
+{
+	unsigned int nearest = RayHit::NONE;
+	unsigned int i = 0;
+
+#ifdef RAYKERNELS_SIMD
+	if (count >= LANES)
+	{
+		const vfloat zero = Set1(0.0f);
+		const vfloat ox = Set1(ray.origin.x), oy = Set1(ray.origin.y), oz = Set1(ray.origin.z);
+		const vfloat dx = Set1(ray.direction.x), dy = Set1(ray.direction.y), dz = Set1(ray.direction.z);
+		const vfloat a = Set1(glm::dot(ray.direction, ray.direction));
+		const vfloat invA = Set1(1.0f / glm::dot(ray.direction, ray.direction));
+
+		vfloat bestT = Set1(t);
+		vfloat bestIndex = Set1(-1.0f);
+
+		for (; i + LANES <= count; i += LANES)
+		{
+			const unsigned int j = first + i;
+			const vfloat ocx = Sub(ox, Load(&spheres.x[j]));
+			const vfloat ocy = Sub(oy, Load(&spheres.y[j]));
+			const vfloat ocz = Sub(oz, Load(&spheres.z[j]));
+			const vfloat r = Load(&spheres.radius[j]);
+
+			// Same half-b quadratic as RayIntersectSphere
+			const vfloat halfB = Add(Add(Mul(ocx, dx), Mul(ocy, dy)), Mul(ocz, dz));
+			const vfloat c = Sub(Add(Add(Mul(ocx, ocx), Mul(ocy, ocy)), Mul(ocz, ocz)), Mul(r, r));
+			const vfloat discriminant = Sub(Mul(halfB, halfB), Mul(a, c));
+
+			const vfloat root = Sqrt(Max(discriminant, zero));
+			const vfloat tNear = Mul(Sub(Sub(zero, halfB), root), invA);
+			const vfloat tFar = Mul(Add(Sub(zero, halfB), root), invA);
+			const vfloat tHit = Select(GreaterEqual(tNear, zero), tNear, tFar);
+
+			const vfloat hit = And(GreaterEqual(discriminant, zero), And(GreaterEqual(tHit, zero), Less(tHit, bestT)));
+			if (!AnyLane(hit))
+				continue;
+			bestT = Select(hit, tHit, bestT);
+			bestIndex = Select(hit, Add(Set1(static_cast<float>(i)), LaneOffsets()), bestIndex);
+		}
+
+		const int lane = NearestLane(bestT, t);
+		if (lane >= 0)
+			nearest = first + static_cast<unsigned int>(Lane(bestIndex, lane));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const unsigned int j = first + i;
+		if (RayIntersectSphere(ray, glm::vec3(spheres.x[j], spheres.y[j], spheres.z[j]), spheres.radius[j], t))
+			nearest = j;
+	}
+	return nearest;
+}
+
+unsigned int RayKernels::IntersectTriangles(const Ray& ray, const TriangleSoA& triangles, unsigned int first, unsigned int count,
+	float& t, float& u, float& v)
+{
+	unsigned int nearest = RayHit::NONE;
+	unsigned int i = 0;
+
+#ifdef RAYKERNELS_SIMD
+	if (count >= LANES)
+	{
+		const vfloat zero = Set1(0.0f), one = Set1(1.0f), epsilon = Set1(1e-12f);
+		const vfloat ox = Set1(ray.origin.x), oy = Set1(ray.origin.y), oz = Set1(ray.origin.z);
+		const vfloat dx = Set1(ray.direction.x), dy = Set1(ray.direction.y), dz = Set1(ray.direction.z);
+
+		vfloat bestT = Set1(t);
+		vfloat bestIndex = Set1(-1.0f);
+		vfloat bestU = zero, bestV = zero;
+
+		for (; i + LANES <= count; i += LANES)
+		{
+			const unsigned int j = first + i;
+			const vfloat e1x = Load(&triangles.e1x[j]), e1y = Load(&triangles.e1y[j]), e1z = Load(&triangles.e1z[j]);
+			const vfloat e2x = Load(&triangles.e2x[j]), e2y = Load(&triangles.e2y[j]), e2z = Load(&triangles.e2z[j]);
+
+			// p = direction x e2, det = e1 . p
+			const vfloat px = Sub(Mul(dy, e2z), Mul(dz, e2y));
+			const vfloat py = Sub(Mul(dz, e2x), Mul(dx, e2z));
+			const vfloat pz = Sub(Mul(dx, e2y), Mul(dy, e2x));
+			const vfloat det = Add(Add(Mul(e1x, px), Mul(e1y, py)), Mul(e1z, pz));
+			const vfloat invDet = Div(one, det);
+
+			// s = origin - v0, u = (s . p) / det
+			const vfloat sx = Sub(ox, Load(&triangles.v0x[j]));
+			const vfloat sy = Sub(oy, Load(&triangles.v0y[j]));
+			const vfloat sz = Sub(oz, Load(&triangles.v0z[j]));
+			const vfloat hitU = Mul(Add(Add(Mul(sx, px), Mul(sy, py)), Mul(sz, pz)), invDet);
+
+			// q = s x e1, v = (direction . q) / det, t = (e2 . q) / det
+			const vfloat qx = Sub(Mul(sy, e1z), Mul(sz, e1y));
+			const vfloat qy = Sub(Mul(sz, e1x), Mul(sx, e1z));
+			const vfloat qz = Sub(Mul(sx, e1y), Mul(sy, e1x));
+			const vfloat hitV = Mul(Add(Add(Mul(dx, qx), Mul(dy, qy)), Mul(dz, qz)), invDet);
+			const vfloat tHit = Mul(Add(Add(Mul(e2x, qx), Mul(e2y, qy)), Mul(e2z, qz)), invDet);
+
+			// Every rejection of the scalar version, as one mask. A parallel
+			// lane divides by ~0, but its inf/NaN results are masked out here.
+			vfloat hit = Greater(Abs(det), epsilon);
+			hit = And(hit, And(GreaterEqual(hitU, zero), LessEqual(hitU, one)));
+			hit = And(hit, And(GreaterEqual(hitV, zero), LessEqual(Add(hitU, hitV), one)));
+			hit = And(hit, And(GreaterEqual(tHit, zero), Less(tHit, bestT)));
+			if (!AnyLane(hit))
+				continue;
+
+			bestT = Select(hit, tHit, bestT);
+			bestU = Select(hit, hitU, bestU);
+			bestV = Select(hit, hitV, bestV);
+			bestIndex = Select(hit, Add(Set1(static_cast<float>(i)), LaneOffsets()), bestIndex);
+		}
+
+		const int lane = NearestLane(bestT, t);
+		if (lane >= 0)
+		{
+			nearest = first + static_cast<unsigned int>(Lane(bestIndex, lane));
+			u = Lane(bestU, lane);
+			v = Lane(bestV, lane);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const unsigned int j = first + i;
+		if (IntersectTriangleEdges(ray,
+			glm::vec3(triangles.v0x[j], triangles.v0y[j], triangles.v0z[j]),
+			glm::vec3(triangles.e1x[j], triangles.e1y[j], triangles.e1z[j]),
+			glm::vec3(triangles.e2x[j], triangles.e2y[j], triangles.e2z[j]), t, u, v))
+			nearest = j;
+	}
+	return nearest;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <cfloat>
+#include <vector>
+#include "glm/glm.hpp"
+
+/**
+ * RayKernels — ray/primitive tests, one at a time or several at once
+ *
+ * The exact tests (RayIntersectSphere, ...) take one primitive at a time.
+ * A BVH leaf holds several, and the same arithmetic is repeated for each
+ * with only the primitive changing: exactly what SIMD registers do.
+ * These kernels broadcast the ray into every lane and test 4 (SSE) or 8
+ * (AVX2) primitives per instruction, then keep the nearest hit per lane and
+ * pick the overall nearest at the end.
+ *
+ * STRUCTURE OF ARRAYS
+ *   A register wants the x of four spheres side by side, so primitives are
+ *   stored as one array per component (x[], y[], z[], radius[]) rather than
+ *   an array of structs; a lane's worth is then a single load. The SoA
+ *   containers below are filled in BVH leaf order (GetPrimitiveOrder()), so
+ *   a leaf is one contiguous run [first, first + count) of every array.
+ *
+ * INSTRUCTION SET
+ *   Picked at compile time:
+ *     __AVX2__ defined (MSVC /arch:AVX2)      8 lanes
+ *     x64 or x86 with SSE2 (the default)      4 lanes
+ *     otherwise, or RAYKERNELS_SCALAR         the scalar tests in a loop
+ *   A leaf that is not a multiple of the width finishes with the scalar
+ *   tests, so the arrays need no padding.
+ *
+ * Each kernel returns the index of the nearest primitive hit closer than
+ * `t` and lowers `t` to it, or RayHit::NONE. That matches the leaf callback
+ * of BVH::IntersectNearestLeaves:
+ *
+ *     bvh.IntersectNearestLeaves(ray, hit, [&](const Ray& r, unsigned int first, unsigned int count, float& t)
+ *         { return RayKernels::IntersectSpheres(r, spheres, first, count, t); });
+ */
+
+struct AABB
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	void Grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+	void Grow(const AABB& box) { min = glm::min(min, box.min); max = glm::max(max, box.max); }
+	glm::vec3 GetCentre() const { return 0.5f * (min + max); }
+	bool IsEmpty() const { return min.x > max.x; }
+
+	// Half the surface area: only ratios matter to the SAH
+	float HalfArea() const
+	{
+		if (IsEmpty())
+			return 0.0f;
+		glm::vec3 e = max - min;
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	static AABB FromSphere(const glm::vec3& centre, float radius)
+	{
+		AABB box;
+		box.min = centre - glm::vec3(radius);
+		box.max = centre + glm::vec3(radius);
+		return box;
+	}
+};
+
+struct Ray
+{
+	glm::vec3 origin;
+	glm::vec3 direction;          // any length; hit distances are in units of it
+	glm::vec3 inverseDirection;   // 1 / direction, for the slab test
+
+	Ray() : origin(0.0f), direction(0.0f, 0.0f, -1.0f), inverseDirection(0.0f, 0.0f, -1.0f) {}
+	Ray(const glm::vec3& origin, const glm::vec3& direction)
+		: origin(origin), direction(direction), inverseDirection(1.0f / direction) {}
+};
+
+struct RayHit
+{
+	static const unsigned int NONE = 0xFFFFFFFFu;
+
+	float        t = FLT_MAX;         // origin + t * direction is the hit point
+	unsigned int primitive = NONE;    // the caller's primitive index
+	float        u = 0.0f, v = 0.0f;  // barycentrics, for triangle hits
+
+	bool IsHit() const { return primitive != NONE; }
+};
+
+// Exact primitive tests. Each returns true only for a hit in [0, t) and
+// then lowers t to it.
+bool RayIntersectSphere(const Ray& ray, const glm::vec3& centre, float radius, float& t);
+bool RayIntersectTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+	float& t, float& u, float& v);
+
+struct SphereSoA
+{
+	std::vector<float> x, y, z, radius;
+
+	void Resize(size_t count) { x.resize(count); y.resize(count); z.resize(count); radius.resize(count); }
+	size_t Size() const { return x.size(); }
+	void Set(size_t i, const glm::vec3& centre, float r) { x[i] = centre.x; y[i] = centre.y; z[i] = centre.z; radius[i] = r; }
+};
+
+// Triangles as a corner and two edges (v1 - v0, v2 - v0), which is what
+// Moller-Trumbore works with, so the kernel does no subtractions per edge.
+struct TriangleSoA
+{
+	std::vector<float> v0x, v0y, v0z, e1x, e1y, e1z, e2x, e2y, e2z;
+
+	void Resize(size_t count);
+	size_t Size() const { return v0x.size(); }
+	void Set(size_t i, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+};
+
+namespace RayKernels
+{
+#if defined(RAYKERNELS_SCALAR)
+	static const unsigned int WIDTH = 1;
+#elif defined(__AVX2__)
+	static const unsigned int WIDTH = 8;
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	static const unsigned int WIDTH = 4;
+#else
+	static const unsigned int WIDTH = 1;
+#endif
+
+	// "AVX2", "SSE" or "Scalar", for the GUI
+	const char* GetInstructionSet();
+
+	// Nearest hit among primitives [first, first + count); see above.
+	unsigned int IntersectSpheres(const Ray& ray, const SphereSoA& spheres, unsigned int first, unsigned int count, float& t);
+	unsigned int IntersectTriangles(const Ray& ray, const TriangleSoA& triangles, unsigned int first, unsigned int count,
+		float& t, float& u, float& v);
+}
@@ -0,0 +1,519 @@
+#include "RenderGraph.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <iostream>
+
+unsigned int RenderGraph::PassContext::GetTexture(Resource resource) const
+{
+	return m_Graph->GetTexture(resource);
+}
+
+RenderGraph::~RenderGraph()
+{
+	ReleaseTextures();
+}
+
+void RenderGraph::Reset()
+{
+	m_Passes.clear();
+	m_Resources.clear();
+}
+
+RenderGraph::Resource RenderGraph::CreateTexture(const std::string& name, const TextureDesc& desc)
+{
+	ResourceRecord record;
+	record.name = name;
+	record.desc = desc;
+	m_Resources.push_back(record);
+	return static_cast<Resource>(m_Resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::ImportTexture(const std::string& name, unsigned int texture, int width, int height)
+{
+	TextureDesc desc;
+	desc.width = width;
+	desc.height = height;
+	return ImportTexture(name, texture, desc);
+}
+
+RenderGraph::Resource RenderGraph::ImportTexture(const std::string& name, unsigned int texture, const TextureDesc& desc)
+{
+	ResourceRecord record;
+	record.name = name;
+	record.desc = desc;
+	record.texture = texture;
+	record.imported = true;
+	m_Resources.push_back(record);
+	return static_cast<Resource>(m_Resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::ImportBackbuffer(int width, int height)
+{
+	Resource resource = ImportTexture("Backbuffer", 0, width, height);
+	m_Resources[resource].backbuffer = true;
+	return resource;
+}
+
+void RenderGraph::SetClearColour(Resource resource, const glm::vec4& colour)
+{
+	m_Resources[resource].clearColour = colour;
+}
+
+RenderGraph::Pass RenderGraph::AddPass(const std::string& name, ExecuteFunction execute)
+{
+	PassRecord record;
+	record.name = name;
+	record.execute = std::move(execute);
+	m_Passes.push_back(std::move(record));
+	return static_cast<Pass>(m_Passes.size() - 1);
+}
+
+void RenderGraph::Read(Pass pass, Resource resource)
+{
+	m_Passes[pass].uses.push_back({ resource, Access::Sampled, LoadOp::Load });
+}
+
+void RenderGraph::Write(Pass pass, Resource resource, LoadOp load)
+{
+	m_Passes[pass].uses.push_back({ resource, Access::Attachment, load });
+}
+
+void RenderGraph::ReadStorage(Pass pass, Resource resource)
+{
+	m_Passes[pass].uses.push_back({ resource, Access::StorageRead, LoadOp::Load });
+}
+
+void RenderGraph::WriteStorage(Pass pass, Resource resource)
+{
+	m_Passes[pass].uses.push_back({ resource, Access::StorageWrite, LoadOp::Load });
+}
+
+void RenderGraph::SetSideEffect(Pass pass)
+{
+	m_Passes[pass].sideEffect = true;
+}
+
+void RenderGraph::Cull()
+{
+	// Walking backwards, `needed` is whether a pass still to run (later in
+	// the frame) reads what the resource holds at this point
+	FrameArena::Vector<bool> needed(m_Resources.size(), false, FrameArena::GetResource());
+	for (std::size_t i = m_Passes.size(); i-- > 0;)
+	{
+		PassRecord& pass = m_Passes[i];
+
+		bool alive = pass.sideEffect;
+		for (const Use& use : pass.uses)
+		{
+			const bool writes = use.access == Access::Attachment || use.access == Access::StorageWrite;
+			if (writes && (m_Resources[use.resource].imported || needed[use.resource]))
+				alive = true;
+		}
+		pass.culled = !alive;
+		if (!alive)
+			continue;
+
+		// A cleared or fully overwritten target makes earlier writers
+		// redundant; anything this pass reads, loads or partly stores to
+		// makes them necessary
+		for (const Use& use : pass.uses)
+		{
+			if (use.access == Access::Attachment && use.load != LoadOp::Load)
+				needed[use.resource] = false;
+		}
+		for (const Use& use : pass.uses)
+		{
+			if (use.access != Access::Attachment || use.load == LoadOp::Load)
+				needed[use.resource] = true;
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (ResourceRecord& resource : m_Resources)
+	{
+		resource.firstPass = resource.lastPass = -1;
+		resource.physical = -1;
+	}
+
+	for (std::size_t i = 0; i < m_Passes.size(); i++)
+	{
+		if (m_Passes[i].culled)
+			continue;
+		for (const Use& use : m_Passes[i].uses)
+		{
+			ResourceRecord& resource = m_Resources[use.resource];
+			if (resource.firstPass < 0)
+				resource.firstPass = static_cast<int>(i);
+			resource.lastPass = static_cast<int>(i);
+		}
+	}
+}
+
+void RenderGraph::Allocate()
+{
+	// Transients in order of first use, each into the first slot of its
+	// desc that the previous occupant has finished with
+	FrameArena::Vector<unsigned int> order(FrameArena::GetResource());
+	for (unsigned int i = 0; i < m_Resources.size(); i++)
+	{
+		if (!m_Resources[i].imported && m_Resources[i].firstPass >= 0)
+			order.push_back(i);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+		{
+			return m_Resources[a].firstPass < m_Resources[b].firstPass;
+		});
+
+	// Last frame's m_Physical, swapped out below; its capacity is reused
+	std::vector<PhysicalTexture>& slots = m_Slots;
+	slots.clear();
+	for (unsigned int index : order)
+	{
+		ResourceRecord& resource = m_Resources[index];
+		auto slot = std::find_if(slots.begin(), slots.end(), [&](const PhysicalTexture& p)
+			{
+				return p.desc == resource.desc && p.lastPass < resource.firstPass;
+			});
+		if (slot == slots.end())
+		{
+			PhysicalTexture physical;
+			physical.desc = resource.desc;
+			slots.push_back(physical);
+			slot = slots.end() - 1;
+		}
+		slot->lastPass = resource.lastPass;
+		resource.physical = static_cast<int>(slot - slots.begin());
+
+		m_Stats.transients++;
+		m_Stats.requestedBytes += GpuResources::GetTextureBytes(resource.desc);
+	}
+
+	// Keep last frame's textures where the desc matches; the rest go back
+	// to the pool and new ones come out of it
+	bool changed = slots.size() != m_Physical.size();
+	FrameArena::Vector<bool> kept(m_Physical.size(), false, FrameArena::GetResource());
+	for (PhysicalTexture& slot : slots)
+	{
+		for (std::size_t i = 0; i < m_Physical.size(); i++)
+		{
+			if (!kept[i] && m_Physical[i].desc == slot.desc)
+			{
+				kept[i] = true;
+				slot.handle = m_Physical[i].handle;
+				slot.texture = m_Physical[i].texture;
+				break;
+			}
+		}
+		if (slot.texture)
+			continue;
+
+		changed = true;
+		slot.handle = GpuResources::Get().CreateTexture(slot.desc, GpuMemory::Category::RenderTarget);
+		slot.texture = GpuResources::Get().GetTexture(slot.handle);
+
+		// A pooled texture keeps its last user's sampling state
+		const bool depth = IsDepthFormat(slot.desc.format);
+		const GLint filter = depth ? GL_NEAREST : GL_LINEAR;
+		const GLint wrap = depth ? GL_CLAMP_TO_BORDER : GL_CLAMP_TO_EDGE;
+		const float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		const GLenum target = slot.desc.target;
+		GLState::BindTexture(target, slot.texture);
+		GlCall(glTexParameteri(target, GL_TEXTURE_MIN_FILTER, slot.desc.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : filter));
+		GlCall(glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter));
+		GlCall(glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap));
+		GlCall(glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap));
+		GlCall(glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, border));
+		GlCall(glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_NONE));
+		GLState::BindTexture(target, 0);
+	}
+	for (std::size_t i = 0; i < m_Physical.size(); i++)
+	{
+		if (!kept[i])
+		{
+			GpuResources::Get().Release(m_Physical[i].handle);
+			m_PendingStores.erase(m_Physical[i].texture);
+		}
+	}
+	m_Physical.swap(slots);
+
+	// A cached framebuffer may name a texture that has just gone
+	if (changed)
+	{
+		for (const auto& framebuffer : m_Framebuffers)
+			GpuResources::Delete(GL_FRAMEBUFFER, framebuffer.second);
+		m_Framebuffers.clear();
+	}
+
+	m_Stats.textures = static_cast<unsigned int>(m_Physical.size());
+	for (const PhysicalTexture& physical : m_Physical)
+		m_Stats.allocatedBytes += GpuResources::GetTextureBytes(physical.desc);
+}
+
+unsigned int RenderGraph::GetTexture(Resource resource) const
+{
+	const ResourceRecord& record = m_Resources[resource];
+	if (record.imported)
+		return record.texture;
+	return record.physical >= 0 ? m_Physical[record.physical].texture : 0;
+}
+
+bool RenderGraph::IsDepthFormat(unsigned int format)
+{
+	switch (format)
+	{
+	case GL_DEPTH_COMPONENT16:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32:
+	case GL_DEPTH_COMPONENT32F:
+	case GL_DEPTH24_STENCIL8:
+	case GL_DEPTH32F_STENCIL8:
+		return true;
+	default:
+		return false;
+	}
+}
+
+unsigned int RenderGraph::GetFramebuffer(const PassRecord& pass, int& width, int& height)
+{
+	// Colour attachments in Write order, then 0 and the depth attachment
+	FrameArena::Vector<unsigned int> colour(FrameArena::GetResource());
+	unsigned int depth = 0;
+	unsigned int depthFormat = 0;
+	for (const Use& use : pass.uses)
+	{
+		if (use.access != Access::Attachment)
+			continue;
+
+		const ResourceRecord& resource = m_Resources[use.resource];
+		width = resource.desc.width;
+		height = resource.desc.height;
+		if (resource.backbuffer)
+			return 0;
+
+		if (IsDepthFormat(resource.desc.format))
+		{
+			depth = GetTexture(use.resource);
+			depthFormat = resource.desc.format;
+		}
+		else
+		{
+			colour.push_back(GetTexture(use.resource));
+		}
+	}
+
+	std::vector<unsigned int>& key = m_FramebufferKey;
+	key.assign(colour.begin(), colour.end());
+	key.push_back(0);
+	key.push_back(depth);
+	auto cached = m_Framebuffers.find(key);
+	if (cached != m_Framebuffers.end())
+		return cached->second;
+
+	unsigned int framebuffer = 0;
+	GlCall(glGenFramebuffers(1, &framebuffer));
+	GLState::BindFramebuffer(framebuffer);
+
+	std::vector<GLenum> drawBuffers;
+	// glFramebufferTexture attaches an array texture layered: a geometry
+	// shader picks the layer of each primitive with gl_Layer
+	for (std::size_t i = 0; i < colour.size(); i++)
+	{
+		GlCall(glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i), colour[i], 0));
+		drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i));
+	}
+	if (depth)
+	{
+		const bool stencil = depthFormat == GL_DEPTH24_STENCIL8 || depthFormat == GL_DEPTH32F_STENCIL8;
+		GlCall(glFramebufferTexture(GL_FRAMEBUFFER, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, depth, 0));
+	}
+
+	if (drawBuffers.empty())
+	{
+		GlCall(glDrawBuffer(GL_NONE));
+		GlCall(glReadBuffer(GL_NONE));
+	}
+	else
+	{
+		GlCall(glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data()));
+	}
+
+	GLenum status;
+	GlCall(status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "RenderGraph - framebuffer for pass \"" << pass.name << "\" is incomplete: 0x" << std::hex << status << std::dec << "\n";
+
+	m_Framebuffers[key] = framebuffer;
+	return framebuffer;
+}
+
+void RenderGraph::Execute()
+{
+	m_Stats = Stats();
+	m_Stats.passes = static_cast<unsigned int>(m_Passes.size());
+
+	Cull();
+	ComputeLifetimes();
+	Allocate();
+
+	const bool canInvalidate = GLEW_VERSION_4_3 || GLEW_ARB_invalidate_subdata;
+	int screenWidth = 0, screenHeight = 0;
+
+	PassContext context;
+	context.m_Graph = this;
+	for (std::size_t i = 0; i < m_Passes.size(); i++)
+	{
+		const PassRecord& pass = m_Passes[i];
+		if (pass.culled)
+		{
+			m_Stats.culledPasses++;
+			continue;
+		}
+
+		// Image stores are the only writes GL does not order by itself.
+		// One barrier covers every store before it, for the bits it names.
+		GLbitfield barrier = 0;
+		for (const Use& use : pass.uses)
+		{
+			auto pending = m_PendingStores.find(GetTexture(use.resource));
+			if (pending == m_PendingStores.end())
+				continue;
+
+			GLbitfield bit = GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+			if (use.access == Access::Sampled)
+				bit = GL_TEXTURE_FETCH_BARRIER_BIT;
+			else if (use.access == Access::Attachment)
+				bit = GL_FRAMEBUFFER_BARRIER_BIT;
+			barrier |= bit & ~pending->second;
+		}
+		if (barrier)
+		{
+			GlCall(glMemoryBarrier(barrier));
+			for (auto& pending : m_PendingStores)
+				pending.second |= barrier;
+			m_Stats.barriers++;
+		}
+
+		// Render targets: bind, size the viewport, clear what asks for it
+		context.m_Width = context.m_Height = 0;
+		int colourIndex = 0;
+		bool bound = false;
+		for (const Use& use : pass.uses)
+		{
+			if (use.access != Access::Attachment)
+				continue;
+
+			const ResourceRecord& resource = m_Resources[use.resource];
+			if (!bound)
+			{
+				const unsigned int framebuffer = GetFramebuffer(pass, context.m_Width, context.m_Height);
+				GLState::BindFramebuffer(framebuffer);
+				GLState::Viewport(0, 0, context.m_Width, context.m_Height);
+				bound = true;
+			}
+			if (resource.backbuffer)
+			{
+				screenWidth = resource.desc.width;
+				screenHeight = resource.desc.height;
+			}
+
+			const bool depth = IsDepthFormat(resource.desc.format);
+			if (use.load == LoadOp::Clear)
+			{
+				if (resource.backbuffer)
+				{
+					// Whatever glClearColor the application chose
+					GLState::DepthMask(true);
+					GlCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+				}
+				else if (depth)
+				{
+					const float one = 1.0f;
+					GLState::DepthMask(true);
+					GlCall(glClearBufferfv(GL_DEPTH, 0, &one));
+				}
+				else
+				{
+					GlCall(glClearBufferfv(GL_COLOR, colourIndex, &resource.clearColour[0]));
+				}
+				m_Stats.clears++;
+			}
+			else if (use.load == LoadOp::DontCare)
+			{
+				m_Stats.skippedClears++;
+			}
+			if (!depth && !resource.backbuffer)
+				colourIndex++;
+		}
+
+		if (pass.execute)
+			pass.execute(context);
+
+		for (const Use& use : pass.uses)
+		{
+			if (use.access == Access::StorageWrite)
+				m_PendingStores[GetTexture(use.resource)] = 0;
+		}
+
+		// Nothing after this pass reads these contents: let the driver
+		// drop them (tiled GPUs skip the write-back entirely)
+		for (std::size_t u = 0; u < pass.uses.size(); u++)
+		{
+			const ResourceRecord& resource = m_Resources[pass.uses[u].resource];
+			bool first = true;
+			for (std::size_t v = 0; v < u; v++)
+				first = first && pass.uses[v].resource != pass.uses[u].resource;
+			if (!first || resource.imported || resource.lastPass != static_cast<int>(i) || !canInvalidate)
+				continue;
+
+			for (int level = 0; level < resource.desc.levels; level++)
+			{
+				GlCall(glInvalidateTexImage(GetTexture(pass.uses[u].resource), level));
+			}
+			m_Stats.invalidations++;
+		}
+	}
+
+	GLState::BindFramebuffer(0);
+	if (screenWidth > 0 && screenHeight > 0)
+		GLState::Viewport(0, 0, screenWidth, screenHeight);
+
+	m_Stats.framebuffers = static_cast<unsigned int>(m_Framebuffers.size());
+
+	m_PassInfo.clear();
+	for (const PassRecord& pass : m_Passes)
+		m_PassInfo.push_back({ pass.name, pass.culled });
+
+	m_ResourceInfo.clear();
+	for (const ResourceRecord& resource : m_Resources)
+	{
+		ResourceInfo info;
+		info.name = resource.name;
+		info.imported = resource.imported;
+		info.firstPass = resource.firstPass;
+		info.lastPass = resource.lastPass;
+		info.physical = resource.physical;
+		m_ResourceInfo.push_back(info);
+	}
+}
+
+void RenderGraph::ReleaseTextures()
+{
+	for (const auto& framebuffer : m_Framebuffers)
+		GpuResources::Delete(GL_FRAMEBUFFER, framebuffer.second);
+	m_Framebuffers.clear();
+
+	for (const PhysicalTexture& physical : m_Physical)
+	{
+		if (GpuResources::IsAlive())
+			GpuResources::Get().Release(physical.handle);
+		else
+			GpuResources::Delete(GL_TEXTURE, physical.texture);
+	}
+	m_Physical.clear();
+	m_PendingStores.clear();
+}
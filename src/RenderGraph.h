@@ -0,0 +1,215 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "GpuResources.h"
+#include "glm/glm.hpp"
+
+/**
+ * RenderGraph — a frame's passes, declared up front and run in order
+ *
+ * Each Framebuffer used to be built by hand for one purpose: a test made
+ * its depth-only shadow map, bound it, cleared it, restored the viewport to
+ * 1920x1080 itself, and kept the texture alive for the whole test whether
+ * it was needed or not. Here a pass only says what it touches:
+ *
+ *     Resource shadowMap = graph.CreateTexture("Shadow map", { 2048, 2048, GL_DEPTH_COMPONENT24 });
+ *     Resource screen = graph.ImportBackbuffer(width, height);
+ *     Pass shadow = graph.AddPass("Shadow depth", drawCasters);
+ *     graph.Write(shadow, shadowMap, LoadOp::Clear);
+ *     Pass lit = graph.AddPass("Lit scene", drawLit);   // samples GetTexture(shadowMap)
+ *     graph.Read(lit, shadowMap);
+ *     graph.Write(lit, screen, LoadOp::Clear);
+ *     graph.Execute();
+ *
+ * and Execute works out the rest:
+ *
+ * CULLING
+ *   Walking back from the imported resources (the backbuffer, textures
+ *   owned elsewhere), a pass runs only if something later needs what it
+ *   writes. A pass whose output nobody reads costs nothing, so tests can
+ *   declare optional stages freely. SetSideEffect keeps a pass regardless.
+ *
+ * TRANSIENTS AND ALIASING
+ *   CreateTexture makes a transient: it exists from the first pass that
+ *   uses it to the last, and its contents do not survive the frame.
+ *   Transients whose lifetimes do not overlap share one physical texture
+ *   when their TextureDesc matches; GL textures cannot be placed in a
+ *   shared heap, so differently shaped transients never overlap. The
+ *   physical textures come from the GpuResources pool and are kept from
+ *   frame to frame while the graph's shape stays the same. GetStats
+ *   reports the bytes requested against the bytes allocated.
+ *
+ * CLEARS AND BARRIERS
+ *   Write's LoadOp says what an attachment starts as: Clear (to
+ *   SetClearColour, depth to 1, the backbuffer to the application's
+ *   glClearColor), Load (previous contents, which for a
+ *   transient's first write are undefined), or DontCare (the pass covers
+ *   every pixel, so no clear is spent on it). A transient's texture is
+ *   invalidated after its last use. GL already orders render-target writes
+ *   before later sampling; only image stores (WriteStorage) need a
+ *   glMemoryBarrier, and one is issued only in front of a pass that uses
+ *   such a texture, with only the bits that use requires.
+ *
+ * Each pass's writes become its framebuffer (colour attachments in Write
+ * order, a depth format as the depth attachment; array textures attached
+ * layered), bound with a viewport of its size before the pass runs.
+ * Framebuffer objects are cached. The backbuffer cannot share a pass with
+ * textures. After Execute the default framebuffer is bound with the
+ * backbuffer's viewport.
+ *
+ * Reset and redeclare every frame. GL thread only.
+ */
+class RenderGraph
+{
+public:
+	typedef GpuResources::TextureDesc TextureDesc;
+	typedef unsigned int Resource;
+	typedef unsigned int Pass;
+
+	enum class LoadOp { Clear, Load, DontCare };
+
+	class PassContext
+	{
+	public:
+		// The GL texture behind a resource of this frame
+		unsigned int GetTexture(Resource resource) const;
+		int GetWidth() const { return m_Width; }     // of the bound framebuffer
+		int GetHeight() const { return m_Height; }
+
+	private:
+		friend class RenderGraph;
+		const RenderGraph* m_Graph = nullptr;
+		int m_Width = 0, m_Height = 0;
+	};
+
+	typedef std::function<void(const PassContext&)> ExecuteFunction;
+
+	struct Stats
+	{
+		unsigned int passes = 0;
+		unsigned int culledPasses = 0;
+		unsigned int transients = 0;        // used by a pass that runs
+		unsigned int textures = 0;          // physical textures behind them
+		std::size_t requestedBytes = 0;     // if every transient had its own
+		std::size_t allocatedBytes = 0;
+		unsigned int clears = 0;
+		unsigned int skippedClears = 0;     // DontCare writes
+		unsigned int barriers = 0;
+		unsigned int invalidations = 0;
+		unsigned int framebuffers = 0;      // cached
+	};
+
+	// For debug views of the last Execute
+	struct PassInfo
+	{
+		std::string name;
+		bool culled = false;
+	};
+
+	struct ResourceInfo
+	{
+		std::string name;
+		bool imported = false;
+		int firstPass = -1, lastPass = -1;  // -1: unused by any pass that ran
+		int physical = -1;                  // index of the shared texture, transients only
+	};
+
+	RenderGraph() = default;
+	~RenderGraph();
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// Forgets this frame's passes and resources; physical textures stay
+	void Reset();
+
+	Resource CreateTexture(const std::string& name, const TextureDesc& desc);
+	Resource ImportTexture(const std::string& name, unsigned int texture, int width, int height);
+	// An imported texture that is rendered to: the format tells depth from
+	// colour, the target and layers how to attach it
+	Resource ImportTexture(const std::string& name, unsigned int texture, const TextureDesc& desc);
+	Resource ImportBackbuffer(int width, int height);
+	void SetClearColour(Resource resource, const glm::vec4& colour);
+
+	Pass AddPass(const std::string& name, ExecuteFunction execute);
+	void Read(Pass pass, Resource resource);                                // sampled
+	void Write(Pass pass, Resource resource, LoadOp load = LoadOp::Clear);  // render target
+	void ReadStorage(Pass pass, Resource resource);                         // image load
+	void WriteStorage(Pass pass, Resource resource);                        // image store
+	void SetSideEffect(Pass pass);
+
+	// Culls, allocates and runs the passes
+	void Execute();
+
+	// Drops the physical textures and framebuffers (back to the pool)
+	void ReleaseTextures();
+
+	const Stats& GetStats() const { return m_Stats; }
+	std::size_t GetSavedBytes() const { return m_Stats.requestedBytes - m_Stats.allocatedBytes; }
+	const std::vector<PassInfo>& GetPassInfo() const { return m_PassInfo; }
+	const std::vector<ResourceInfo>& GetResourceInfo() const { return m_ResourceInfo; }
+
+private:
+	enum class Access { Sampled, Attachment, StorageRead, StorageWrite };
+
+	struct Use
+	{
+		Resource resource;
+		Access access;
+		LoadOp load;
+	};
+
+	struct PassRecord
+	{
+		std::string name;
+		ExecuteFunction execute;
+		std::vector<Use> uses;
+		bool sideEffect = false;
+		bool culled = false;
+	};
+
+	struct ResourceRecord
+	{
+		std::string name;
+		TextureDesc desc;
+		unsigned int texture = 0;     // imported: the GL texture (0 for the backbuffer)
+		bool imported = false;
+		bool backbuffer = false;
+		glm::vec4 clearColour = glm::vec4(0.0f);
+		int firstPass = -1, lastPass = -1;
+		int physical = -1;
+	};
+
+	struct PhysicalTexture
+	{
+		TextureDesc desc;
+		TextureHandle handle;
+		unsigned int texture = 0;
+		int lastPass = -1;            // during allocation
+	};
+
+	void Cull();
+	void ComputeLifetimes();
+	void Allocate();
+	unsigned int GetFramebuffer(const PassRecord& pass, int& width, int& height);
+	unsigned int GetTexture(Resource resource) const;
+	static bool IsDepthFormat(unsigned int format);
+
+	std::vector<PassRecord> m_Passes;
+	std::vector<ResourceRecord> m_Resources;
+
+	std::vector<PhysicalTexture> m_Physical;        // kept between frames
+	std::vector<PhysicalTexture> m_Slots;           // Allocate's scratch, swapped with m_Physical
+	std::map<std::vector<unsigned int>, unsigned int> m_Framebuffers;
+	std::vector<unsigned int> m_FramebufferKey;     // GetFramebuffer's scratch, for the lookup
+
+	// Textures written by image stores, with the barrier bits issued since
+	std::map<unsigned int, unsigned int> m_PendingStores;
+
+	Stats m_Stats;
+	std::vector<PassInfo> m_PassInfo;
+	std::vector<ResourceInfo> m_ResourceInfo;
+};
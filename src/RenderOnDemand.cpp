@@ -0,0 +1,188 @@
+#include "RenderOnDemand.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+#include <GLFW/glfw3.h>
+
+namespace
+{
+	struct OnDemandState
+	{
+		bool enabled = false;
+		float settleSeconds = 0.5f;
+		float maxWaitSeconds = 0.25f;
+		double lastChange = 0.0;
+		bool render = true;          // this frame's BeginFrame answer
+
+		// The stored frame
+		unsigned int texture = 0;
+		unsigned int framebuffer = 0;
+		int storedWidth = 0;
+		int storedHeight = 0;
+		bool stored = false;
+
+		int width = 0;               // this frame's size
+		int height = 0;
+		RenderOnDemand::Stats stats;
+	};
+
+	OnDemandState s_OnDemand;
+
+	void DeleteStorage()
+	{
+		if (s_OnDemand.framebuffer)
+		{
+			GlCall(glDeleteFramebuffers(1, &s_OnDemand.framebuffer));
+			GLState::OnFramebufferDeleted(s_OnDemand.framebuffer);
+		}
+		if (s_OnDemand.texture)
+		{
+			GlCall(glDeleteTextures(1, &s_OnDemand.texture));
+			GLState::OnTextureDeleted(s_OnDemand.texture);
+		}
+		s_OnDemand.framebuffer = 0;
+		s_OnDemand.texture = 0;
+		s_OnDemand.storedWidth = 0;
+		s_OnDemand.storedHeight = 0;
+		s_OnDemand.stored = false;
+	}
+
+	// An RGBA8 texture of this frame's size behind a framebuffer of its own
+	void CreateStorage()
+	{
+		DeleteStorage();
+
+		GlCall(glGenTextures(1, &s_OnDemand.texture));
+		GLState::BindTexture(GL_TEXTURE_2D, s_OnDemand.texture);
+		GlCall(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, s_OnDemand.width, s_OnDemand.height));
+		GpuMemory::TrackTexture(GpuMemory::Category::RenderTarget, s_OnDemand.texture,
+			static_cast<std::size_t>(s_OnDemand.width) * s_OnDemand.height * 4);
+
+		GlCall(glGenFramebuffers(1, &s_OnDemand.framebuffer));
+		GLState::BindFramebuffer(s_OnDemand.framebuffer);
+		GlCall(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, s_OnDemand.texture, 0));
+		GLState::BindFramebuffer(0);
+
+		s_OnDemand.storedWidth = s_OnDemand.width;
+		s_OnDemand.storedHeight = s_OnDemand.height;
+	}
+
+	// GLState tracks GL_FRAMEBUFFER (both targets), as in
+	// Framebuffer::BlitToScreen: bind the other target directly and put it
+	// back, so the cached binding stays 0
+	void Blit(unsigned int readFramebuffer, unsigned int drawFramebuffer)
+	{
+		GLState::BindFramebuffer(0);
+		GLState::Disable(GL_SCISSOR_TEST);
+		GlCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer));
+		GlCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer));
+		GlCall(glBlitFramebuffer(0, 0, s_OnDemand.width, s_OnDemand.height, 0, 0, s_OnDemand.width, s_OnDemand.height,
+			GL_COLOR_BUFFER_BIT, GL_NEAREST));
+		GlCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	}
+}
+
+void RenderOnDemand::SetEnabled(bool enabled)
+{
+	if (s_OnDemand.enabled == enabled)
+		return;
+
+	s_OnDemand.enabled = enabled;
+	if (!enabled)
+		DeleteStorage();
+	s_OnDemand.lastChange = glfwGetTime();
+}
+
+bool RenderOnDemand::IsEnabled()
+{
+	return s_OnDemand.enabled;
+}
+
+bool RenderOnDemand::BeginFrame(int width, int height, bool changed)
+{
+	const double now = glfwGetTime();
+	if (changed || !s_OnDemand.enabled)
+		s_OnDemand.lastChange = now;
+
+	s_OnDemand.width = width;
+	s_OnDemand.height = height;
+
+	// A resize leaves the stored frame the wrong size
+	const bool stored = s_OnDemand.stored && width == s_OnDemand.storedWidth && height == s_OnDemand.storedHeight;
+	const double idle = now - s_OnDemand.lastChange;
+	s_OnDemand.render = !s_OnDemand.enabled || !stored || changed || idle < s_OnDemand.settleSeconds;
+
+	s_OnDemand.stats.idleSeconds = static_cast<float>(idle);
+	if (s_OnDemand.render)
+		s_OnDemand.stats.rendered++;
+	else
+		s_OnDemand.stats.reused++;
+	return s_OnDemand.render;
+}
+
+void RenderOnDemand::EndScene()
+{
+	if (!s_OnDemand.enabled || s_OnDemand.width <= 0 || s_OnDemand.height <= 0)
+		return;
+
+	if (s_OnDemand.render)
+	{
+		if (s_OnDemand.storedWidth != s_OnDemand.width || s_OnDemand.storedHeight != s_OnDemand.height)
+			CreateStorage();
+		Blit(0, s_OnDemand.framebuffer);
+		s_OnDemand.stored = true;
+	}
+	else
+		Blit(s_OnDemand.framebuffer, 0);
+}
+
+void RenderOnDemand::Invalidate()
+{
+	s_OnDemand.stored = false;
+	s_OnDemand.lastChange = glfwGetTime();
+}
+
+void RenderOnDemand::PollEvents()
+{
+	// Only once a frame has actually been skipped: until then something is
+	// still settling, and waiting would hold it up
+	if (s_OnDemand.enabled && !s_OnDemand.render)
+	{
+		glfwWaitEventsTimeout(s_OnDemand.maxWaitSeconds);
+		s_OnDemand.stats.waits++;
+	}
+	else
+		glfwPollEvents();
+}
+
+void RenderOnDemand::SetSettleTime(float seconds)
+{
+	s_OnDemand.settleSeconds = seconds > 0.0f ? seconds : 0.0f;
+}
+
+float RenderOnDemand::GetSettleTime()
+{
+	return s_OnDemand.settleSeconds;
+}
+
+void RenderOnDemand::SetMaxWait(float seconds)
+{
+	s_OnDemand.maxWaitSeconds = seconds > 0.0f ? seconds : 0.0f;
+}
+
+float RenderOnDemand::GetMaxWait()
+{
+	return s_OnDemand.maxWaitSeconds;
+}
+
+const RenderOnDemand::Stats& RenderOnDemand::GetStats()
+{
+	return s_OnDemand.stats;
+}
+
+void RenderOnDemand::Shutdown()
+{
+	DeleteStorage();
+	s_OnDemand = OnDemandState();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+/**
+ * RenderOnDemand — skip the scene while nothing on screen can change
+ *
+ * A test like Texture2D, Clear Colour or Shadow Mapping with the spheres
+ * at rest draws the same picture every frame: the full scene, at the
+ * display rate, for as long as the window is open. With this on, the main
+ * loop asks each frame whether anything could have changed it:
+ *
+ *     input      a key or button held or released, the cursor moved, the
+ *                mouse wheel (Input::IsActive, ImGui's IO)
+ *     GUI        an ImGui widget active: a slider being dragged changes a
+ *                uniform the next Render reads
+ *     the test   it animates on its own (Tests::IsAnimating) or asked for
+ *                a frame (Tests::RequestRender)
+ *     the engine a test opened, shaders compiling, textures streaming in,
+ *                a trace being captured
+ *
+ * and if not, does not call the test's Render at all. The back buffer is
+ * undefined after a swap, so the picture is kept: EndScene copies the
+ * scene (before the GUI draws over it) into a texture of its own on every
+ * frame that drew it, and on a skipped frame blits it back. ImGui still
+ * runs and draws every frame, so the panel stays live: a skipped frame
+ * costs one full-screen blit and the GUI, a drawn one a blit more. (The
+ * blit into the default framebuffer needs it single-sampled, as the
+ * window is created.)
+ *
+ * SETTLE TIME
+ *   Rendering carries on for GetSettleTime() seconds after the last
+ *   change. The camera eases toward its target for a while after the key
+ *   is released, and a slider's value arrives a frame after the drag; the
+ *   settle time covers both without every test having to say when it has
+ *   come to rest.
+ *
+ * SLEEPING
+ *   Once a frame has been skipped, PollEvents (in place of glfwPollEvents)
+ *   waits for the next event instead of returning at once, for up to
+ *   GetMaxWait() seconds, so the loop stops spinning altogether until the
+ *   mouse moves. The timeout keeps the engine's own clocks (streaming,
+ *   file reloads, FramePacer) ticking over.
+ *
+ * Off by default, and left off by the benchmark runner, which has to
+ * render every frame it measures. A test switch calls Invalidate: the
+ * stored frame is the old test's. GL thread only. Shutdown before the
+ * context goes.
+ */
+class RenderOnDemand
+{
+public:
+	struct Stats
+	{
+		unsigned int rendered = 0;    // frames that drew the scene, ever
+		unsigned int reused = 0;      // frames that showed the stored one
+		unsigned int waits = 0;       // PollEvents calls that waited
+		float idleSeconds = 0.0f;     // since the last change
+	};
+
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	// Whether this frame draws the scene. `changed` is everything above the
+	// caller knows of; without a stored frame of this size the answer is
+	// always yes, and so it is while disabled.
+	static bool BeginFrame(int width, int height, bool changed);
+
+	// After the scene, before the GUI: store the frame just drawn, or blit
+	// the stored one back if BeginFrame said to skip
+	static void EndScene();
+
+	// Drop the stored frame: the next frame renders
+	static void Invalidate();
+
+	// glfwPollEvents, or glfwWaitEventsTimeout while idle (see SLEEPING)
+	static void PollEvents();
+
+	static void SetSettleTime(float seconds);
+	static float GetSettleTime();
+	static void SetMaxWait(float seconds);
+	static float GetMaxWait();
+
+	static const Stats& GetStats();
+
+	// Deletes the stored frame
+	static void Shutdown();
+};
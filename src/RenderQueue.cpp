@@ -0,0 +1,583 @@
+#include "RenderQueue.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "Mesh/MeshArena.h"
+
+#include <algorithm>
+
+// Bit widths of each key field — see the layout diagram in RenderQueue.h.
+static const unsigned int PASS_BITS = 4;
+static const unsigned int SHADER_BITS = 12;
+static const unsigned int MATERIAL_BITS = 16;
+static const unsigned int VAO_BITS = 12;
+static const unsigned int DEPTH_BITS = 20;
+
+static const unsigned int DEPTH_SHIFT = 0;
+static const unsigned int VAO_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+static const unsigned int MATERIAL_SHIFT = VAO_SHIFT + VAO_BITS;
+static const unsigned int SHADER_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+static const unsigned int PASS_SHIFT = SHADER_SHIFT + SHADER_BITS;
+
+static uint64_t Field(uint64_t value, unsigned int bits, unsigned int shift)
+{
+	return (value & ((uint64_t(1) << bits) - 1)) << shift;
+}
+
+void RenderMaterial::Bind(Shader& shader) const
+{
+	const GLenum target = arrayTextures ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+	for (unsigned int t = 0; t < textureCount; t++)
+	{
+		GLState::BindTextureToUnit(t, target, textures[t]);
+		if (!samplerNames[t].empty())
+			shader.setUniform1i(samplerNames[t], static_cast<int>(t));
+	}
+
+	if (tableBuffer)
+	{
+		GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TABLE_BINDING, tableBuffer));
+	}
+}
+
+uint64_t RenderQueue::MakeKey(uint8_t pass, unsigned int shaderID, unsigned int materialID,
+	unsigned int vaoID, float depth01)
+{
+	depth01 = std::min(std::max(depth01, 0.0f), 1.0f);
+
+	// Transparent surfaces must blend back-to-front, so far objects get the
+	// smaller key. Everything else draws front-to-back to help early-z.
+	if (pass == RenderPass::Transparent)
+		depth01 = 1.0f - depth01;
+
+	const uint64_t maxDepth = (uint64_t(1) << DEPTH_BITS) - 1;
+	uint64_t depth = static_cast<uint64_t>(depth01 * static_cast<float>(maxDepth));
+
+	return Field(pass, PASS_BITS, PASS_SHIFT)
+		| Field(shaderID, SHADER_BITS, SHADER_SHIFT)
+		| Field(materialID, MATERIAL_BITS, MATERIAL_SHIFT)
+		| Field(vaoID, VAO_BITS, VAO_SHIFT)
+		| Field(depth, DEPTH_BITS, DEPTH_SHIFT);
+}
+
+static bool MakeCommandKey(uint8_t pass, RenderCommand& command, float depth01)
+{
+	// A pulled command reads its indices as storage, so it has no ibo
+	if (!command.shader || !command.vao || (!command.ibo && !command.pullFrom))
+		return false;
+	if (command.pullFrom && command.indirect)
+		return false;
+
+	command.key = RenderQueue::MakeKey(pass,
+		command.shader->GetID(),
+		command.material ? command.material->id : 0,
+		command.vao->GetID(),
+		depth01);
+	return true;
+}
+
+static bool CompareKeys(const RenderCommand& a, const RenderCommand& b)
+{
+	return a.key < b.key;
+}
+
+// The depth field alone: front to back whatever the shader or material
+static bool CompareDepths(const RenderCommand& a, const RenderCommand& b)
+{
+	const uint64_t mask = ((uint64_t(1) << DEPTH_BITS) - 1) << DEPTH_SHIFT;
+	return (a.key & mask) < (b.key & mask);
+}
+
+// The command's VAO with only the position attribute, when it is one of
+// MeshArena's; otherwise its own, whose other attributes go unread
+static const VertexArray* PositionVertexArray(const VertexArray* vao)
+{
+	for (unsigned int f = 0; f < VERTEX_FORMAT_COUNT; f++)
+	{
+		const VertexFormat format = static_cast<VertexFormat>(f);
+		if (!MeshArena::IsAlive(format))
+			continue;
+		const MeshArena& arena = MeshArena::Get(format);
+		if (vao == &arena.GetVertexArray())
+			return &arena.GetPositionVertexArray();
+		if (vao == &arena.GetInstancedVertexArray())
+			return &arena.GetInstancedPositionVertexArray();
+	}
+	return vao;
+}
+
+static void SetColour(Shader& shader, UniformHandle uniform, const glm::vec4& colour)
+{
+	if (uniform.type == GL_FLOAT_VEC3)
+		shader.setUniform3f(uniform, colour.r, colour.g, colour.b);
+	else
+		shader.setUniform4f(uniform, colour.r, colour.g, colour.b, colour.a);
+}
+
+RenderQueue::~RenderQueue()
+{
+	if (m_FragmentQueries[0][0] != 0)
+	{
+		GlCall(glDeleteQueries(2 * QUERY_COUNT, &m_FragmentQueries[0][0]));
+	}
+}
+
+void RenderQueue::Submit(uint8_t pass, RenderCommand command, float depth01)
+{
+	if (!MakeCommandKey(pass, command, depth01))
+		return;
+
+	m_Commands.push_back(command);
+	m_Sorted = false;
+	m_Stats.commands++;
+}
+
+void RenderQueue::Bucket::Submit(uint8_t pass, RenderCommand command, float depth01)
+{
+	if (MakeCommandKey(pass, command, depth01))
+		m_Commands.push_back(command);
+}
+
+void RenderQueue::ResizeBuckets(unsigned int count)
+{
+	if (m_Buckets.size() < count)
+		m_Buckets.resize(count);
+	for (Bucket& bucket : m_Buckets)
+		bucket.m_Commands.clear();
+	m_BucketCount = count;
+}
+
+void RenderQueue::MergeBuckets()
+{
+	// Each bucket's own sort is independent: one bucket per task
+	ThreadPool::Get().ParallelFor(m_BucketCount, 1, [this](unsigned int begin, unsigned int end, unsigned int)
+		{
+			for (unsigned int b = begin; b < end; b++)
+				std::stable_sort(m_Buckets[b].m_Commands.begin(), m_Buckets[b].m_Commands.end(), CompareKeys);
+		});
+
+	// Commands already submitted are one more run, ahead of the buckets
+	Sort();
+	m_RunEnds.clear();
+	if (!m_Commands.empty())
+		m_RunEnds.push_back(m_Commands.size());
+	for (unsigned int b = 0; b < m_BucketCount; b++)
+	{
+		std::vector<RenderCommand>& commands = m_Buckets[b].m_Commands;
+		if (commands.empty())
+			continue;
+		m_Commands.insert(m_Commands.end(), commands.begin(), commands.end());
+		m_Stats.commands += static_cast<unsigned int>(commands.size());
+		m_RunEnds.push_back(m_Commands.size());
+		commands.clear();
+	}
+
+	// Merge neighbouring runs pairwise until one is left: log2(runs)
+	// passes, each stable, so earlier runs win ties
+	while (m_RunEnds.size() > 1)
+	{
+		std::size_t kept = 0;
+		std::size_t begin = 0;
+		for (std::size_t r = 0; r < m_RunEnds.size(); r += 2)
+		{
+			if (r + 1 < m_RunEnds.size())
+			{
+				std::inplace_merge(m_Commands.begin() + begin, m_Commands.begin() + m_RunEnds[r],
+					m_Commands.begin() + m_RunEnds[r + 1], CompareKeys);
+				begin = m_RunEnds[r + 1];
+			}
+			else
+			{
+				begin = m_RunEnds[r];
+			}
+			m_RunEnds[kept++] = begin;
+		}
+		m_RunEnds.resize(kept);
+	}
+	m_Sorted = true;
+}
+
+void RenderQueue::Sort()
+{
+	if (m_Sorted)
+		return;
+
+	// stable_sort keeps submission order for identical keys, so two objects
+	// at the same depth never flicker between frames.
+	std::stable_sort(m_Commands.begin(), m_Commands.end(), CompareKeys);
+	m_Sorted = true;
+}
+
+void RenderQueue::FindPass(uint8_t pass, std::size_t& first, std::size_t& last) const
+{
+	// The pass is the top bits of the key, so a pass is one contiguous range
+	// of the sorted array — find it with two binary searches.
+	const uint64_t passBegin = Field(pass, PASS_BITS, PASS_SHIFT);
+	const uint64_t passEnd = passBegin + (uint64_t(1) << PASS_SHIFT);
+
+	auto begin = std::lower_bound(m_Commands.begin(), m_Commands.end(), passBegin,
+		[](const RenderCommand& c, uint64_t key) { return c.key < key; });
+	auto end = std::lower_bound(begin, m_Commands.end(), passEnd,
+		[](const RenderCommand& c, uint64_t key) { return c.key < key; });
+
+	first = begin - m_Commands.begin();
+	last = end - m_Commands.begin();
+}
+
+void RenderQueue::FlushPass(uint8_t pass)
+{
+	Sort();
+
+	std::size_t first = 0, last = 0;
+	FindPass(pass, first, last);
+	if (pass == RenderPass::Opaque)
+		FlushOpaque(first, last);
+	else
+		FlushRange(m_Commands, first, last);
+}
+
+void RenderQueue::Flush()
+{
+	Sort();
+
+	// The passes before and after opaque as they are
+	std::size_t first = 0, last = 0;
+	FindPass(RenderPass::Opaque, first, last);
+	FlushRange(m_Commands, 0, first);
+	FlushOpaque(first, last);
+	FlushRange(m_Commands, last, m_Commands.size());
+}
+
+void RenderQueue::FlushOpaque(std::size_t first, std::size_t last)
+{
+	if (!m_DepthPrepass && !m_CountFragments)
+	{
+		FlushRange(m_Commands, first, last);
+		return;
+	}
+
+	// A query still pending a ring later means the GPU is far behind;
+	// count nothing this frame rather than wait for it
+	int query = -1;
+	if (m_CountFragments)
+	{
+		if (m_FragmentQueries[0][0] == 0)
+		{
+			GlCall(glGenQueries(2 * QUERY_COUNT, &m_FragmentQueries[0][0]));
+		}
+		ReadFragmentQueries();
+		if (!m_QueryPending[m_NextQuery])
+		{
+			query = static_cast<int>(m_NextQuery);
+			m_NextQuery = (m_NextQuery + 1) % QUERY_COUNT;
+		}
+	}
+
+	// The pre-pass and the equal-depth shading change the depth state;
+	// the caller's is put back after them
+	const bool depthTest = GLState::IsEnabled(GL_DEPTH_TEST);
+	const GLenum depthFunc = GLState::GetDepthFunc();
+	const bool depthMask = GLState::GetDepthMask();
+
+	if (m_DepthPrepass)
+	{
+		PROFILE_SCOPE("Depth pre-pass");
+		if (query >= 0)
+		{
+			GlCall(glBeginQuery(GL_SAMPLES_PASSED, m_FragmentQueries[query][0]));
+		}
+		DrawDepthPrepass(first, last);
+		if (query >= 0)
+		{
+			GlCall(glEndQuery(GL_SAMPLES_PASSED));
+		}
+	}
+
+	{
+		PROFILE_SCOPE("Shading");
+		if (m_DepthPrepass)
+		{
+			// Only the fragment the pre-pass kept; its depth is already there
+			GLState::DepthFunc(GL_EQUAL);
+			GLState::DepthMask(false);
+		}
+		if (query >= 0)
+		{
+			GlCall(glBeginQuery(GL_SAMPLES_PASSED, m_FragmentQueries[query][1]));
+		}
+		FlushRange(m_Commands, first, last);
+		if (query >= 0)
+		{
+			GlCall(glEndQuery(GL_SAMPLES_PASSED));
+		}
+		if (m_DepthPrepass)
+		{
+			GLState::SetCapability(GL_DEPTH_TEST, depthTest);
+			GLState::DepthFunc(depthFunc);
+			GLState::DepthMask(depthMask);
+		}
+	}
+
+	if (query >= 0)
+	{
+		m_QueryPending[query] = true;
+		m_QueryPrepass[query] = m_DepthPrepass;
+		m_QueryFrame[query] = ++m_QueryFrames;
+	}
+}
+
+void RenderQueue::DrawDepthPrepass(std::size_t first, std::size_t last)
+{
+	if (!m_PrepassShader)
+	{
+		m_PrepassShader = std::make_unique<Shader>("res/Shaders/DepthPrepass.shader");
+		m_PrepassShader->CompileAllVariants();
+	}
+	Shader& single = m_PrepassShader->Variant("INSTANCED", "OFF");
+	Shader& instanced = m_PrepassShader->Variant("INSTANCED", "ON");
+	auto pulled = [this](const RenderCommand& command) -> Shader&
+		{
+			return m_PrepassShader->Variant({ { "INSTANCED", command.instances ? "ON" : "OFF" },
+				{ "PULL", MeshArena::GetPullVariant(command.pullFrom->GetVertexFormat()) } });
+		};
+
+	// The same draws with the depth-only shader and positions alone;
+	// m_Commands is sorted, so the stable sort keeps key order among
+	// commands at one depth
+	m_PrepassCommands.assign(m_Commands.begin() + first, m_Commands.begin() + last);
+	for (RenderCommand& command : m_PrepassCommands)
+	{
+		command.material = nullptr;
+		command.colourUniform = nullptr;
+		if (command.indirect)
+			continue;
+		if (command.pullFrom)
+		{
+			// Same arena, same fetch: the pulled variant reads only the position
+			command.shader = &pulled(command);
+		}
+		else
+		{
+			command.shader = command.instances ? &instanced : &single;
+			command.vao = PositionVertexArray(command.vao);
+		}
+		command.modelUniform = command.instances ? nullptr : "u_Model";
+	}
+	std::stable_sort(m_PrepassCommands.begin(), m_PrepassCommands.end(), CompareDepths);
+
+	GLState::Enable(GL_DEPTH_TEST);
+	GLState::DepthFunc(GL_LESS);
+	GLState::DepthMask(true);
+	GlCall(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+	const unsigned int drawCalls = m_Stats.drawCalls;
+	FlushRange(m_PrepassCommands, 0, m_PrepassCommands.size());
+	m_Stats.prepassDrawCalls += m_Stats.drawCalls - drawCalls;
+	GlCall(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+}
+
+void RenderQueue::ReadFragmentQueries()
+{
+	for (unsigned int i = 0; i < QUERY_COUNT; i++)
+	{
+		if (!m_QueryPending[i])
+			continue;
+		GLint available = 0;
+		GlCall(glGetQueryObjectiv(m_FragmentQueries[i][1], GL_QUERY_RESULT_AVAILABLE, &available));
+		if (!available)
+			continue;
+
+		GLuint64 shaded = 0, prepass = 0;
+		GlCall(glGetQueryObjectui64v(m_FragmentQueries[i][1], GL_QUERY_RESULT, &shaded));
+		if (m_QueryPrepass[i])
+		{
+			GlCall(glGetQueryObjectui64v(m_FragmentQueries[i][0], GL_QUERY_RESULT, &prepass));
+		}
+		m_QueryPending[i] = false;
+		if (m_QueryFrame[i] < m_LatestQueryFrame)
+			continue;
+
+		m_LatestQueryFrame = m_QueryFrame[i];
+		m_FragmentStats.shadedFragments = shaded;
+		m_FragmentStats.prepassFragments = prepass;
+		m_FragmentStats.prepass = m_QueryPrepass[i];
+	}
+}
+
+void RenderQueue::Clear()
+{
+	m_Commands.clear();
+	m_Sorted = true;
+	m_Stats = Stats();
+}
+
+void RenderQueue::FlushRange(const std::vector<RenderCommand>& commands, std::size_t first, std::size_t last)
+{
+	Renderer renderer;
+
+	Shader* currentShader = nullptr;
+	const RenderMaterial* currentMaterial = nullptr;
+	const VertexArray* currentVAO = nullptr;
+	const IndexBuffer* currentIBO = nullptr;
+	const InstanceBuffer* currentInstances = nullptr;
+	// Bound again by every flush: an Allocate since the last may have grown
+	// the arena, and the storage bindings hold the size they were bound at
+	const MeshArena* currentArena = nullptr;
+
+	// Uniforms resolved for the current shader, so per-command sets skip the
+	// name lookup. Commands almost always use the default names, so this is
+	// one lookup per shader switch rather than one per draw.
+	const char* modelName = nullptr;
+	const char* colourName = nullptr;
+	UniformHandle modelUniform;
+	UniformHandle colourUniform;
+	bool baseVertexResolved = false;
+	bool baseInstanceResolved = false;
+	UniformHandle baseVertexUniform;
+	UniformHandle baseInstanceUniform;
+
+	for (std::size_t i = first; i < last; i++)
+	{
+		const RenderCommand& cmd = commands[i];
+
+		if (cmd.shader != currentShader)
+		{
+			cmd.shader->Bind();
+			currentShader = cmd.shader;
+			// Sampler uniforms belong to the program, so a new program needs
+			// its material uniforms set again even if the textures match.
+			currentMaterial = nullptr;
+			modelName = colourName = nullptr;
+			baseVertexResolved = baseInstanceResolved = false;
+			m_Stats.shaderBinds++;
+		}
+
+		if (cmd.modelUniform && cmd.modelUniform != modelName)
+		{
+			modelUniform = cmd.shader->Uniform(cmd.modelUniform);
+			modelName = cmd.modelUniform;
+		}
+		if (cmd.colourUniform && cmd.colourUniform != colourName)
+		{
+			colourUniform = cmd.shader->Uniform(cmd.colourUniform);
+			colourName = cmd.colourUniform;
+		}
+
+		if (cmd.material && cmd.material != currentMaterial)
+		{
+			cmd.material->Bind(*cmd.shader);
+			currentMaterial = cmd.material;
+			m_Stats.materialBinds++;
+		}
+
+		if (cmd.vao != currentVAO)
+		{
+			cmd.vao->Bind();
+			currentVAO = cmd.vao;
+			// The element buffer binding is part of VAO state, and so is
+			// the buffer at each vertex binding point.
+			currentIBO = nullptr;
+			currentInstances = nullptr;
+			m_Stats.vaoBinds++;
+		}
+
+		if (cmd.pullFrom)
+		{
+			if (cmd.pullFrom != currentArena)
+			{
+				cmd.pullFrom->BindStorage();
+				currentArena = cmd.pullFrom;
+				m_Stats.storageBinds++;
+			}
+			if (!baseVertexResolved)
+			{
+				baseVertexUniform = cmd.shader->Uniform("u_BaseVertex");
+				baseVertexResolved = true;
+			}
+			cmd.shader->setUniform1i(baseVertexUniform, cmd.baseVertex);
+			if (cmd.colourUniform)
+				SetColour(*cmd.shader, colourUniform, cmd.colour);
+
+			if (cmd.instances)
+			{
+				if (!baseInstanceResolved)
+				{
+					baseInstanceUniform = cmd.shader->Uniform("u_BaseInstance");
+					baseInstanceResolved = true;
+				}
+				// The instances as storage, not attributes: the VAO has none
+				if (cmd.instances != currentInstances)
+				{
+					GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, InstanceBuffer::STORAGE_BINDING, cmd.instances->GetID()));
+					currentInstances = cmd.instances;
+					m_Stats.instanceBinds++;
+				}
+				cmd.shader->setUniform1i(baseInstanceUniform, static_cast<int>(cmd.firstInstance));
+
+				const unsigned int instanceCount = cmd.instanceCount ? cmd.instanceCount : cmd.instances->GetCount();
+				renderer.DrawArraysInstanced(cmd.firstIndex, cmd.indexCount, instanceCount);
+				m_Stats.instances += instanceCount;
+			}
+			else
+			{
+				if (cmd.modelUniform)
+					cmd.shader->setUniformMat4f(modelUniform, cmd.model);
+				renderer.DrawArrays(cmd.firstIndex, cmd.indexCount);
+				m_Stats.instances++;
+			}
+			m_Stats.drawCalls++;
+			m_Stats.pulledDrawCalls++;
+			continue;
+		}
+
+		if (cmd.ibo != currentIBO)
+		{
+			cmd.ibo->Bind();
+			currentIBO = cmd.ibo;
+			m_Stats.iboBinds++;
+		}
+
+		if (cmd.indirect)
+		{
+			if (cmd.modelUniform)
+				cmd.shader->setUniformMat4f(modelUniform, cmd.model);
+
+			renderer.DrawIndirect(*cmd.indirect, cmd.indirectFirst, cmd.indirectCount, cmd.ibo->GetType());
+			m_Stats.drawCalls++;
+			m_Stats.instances += cmd.indirectCount;
+			continue;
+		}
+
+		const unsigned int indexCount = cmd.indexCount ? cmd.indexCount : cmd.ibo->GetCount();
+
+		if (cmd.instances)
+		{
+			// Instanced meshes share their arena's instanced VAO, so moving
+			// to another mesh's instances rebinds one binding point
+			if (cmd.instances != currentInstances)
+			{
+				cmd.vao->BindInstanceBuffer(*cmd.instances);
+				currentInstances = cmd.instances;
+				m_Stats.instanceBinds++;
+			}
+			if (cmd.colourUniform)
+				SetColour(*cmd.shader, colourUniform, cmd.colour);
+
+			const unsigned int instanceCount = cmd.instanceCount ? cmd.instanceCount : cmd.instances->GetCount();
+			renderer.DrawIndexedInstanced(indexCount, instanceCount, cmd.firstIndex, cmd.baseVertex, cmd.firstInstance,
+				cmd.ibo->GetType());
+			m_Stats.drawCalls++;
+			m_Stats.instances += instanceCount;
+			continue;
+		}
+
+		if (cmd.modelUniform)
+			cmd.shader->setUniformMat4f(modelUniform, cmd.model);
+		if (cmd.colourUniform)
+			SetColour(*cmd.shader, colourUniform, cmd.colour);
+
+		renderer.DrawIndexed(indexCount, cmd.firstIndex, cmd.baseVertex, cmd.ibo->GetType());
+		m_Stats.drawCalls++;
+		m_Stats.instances++;
+	}
+}
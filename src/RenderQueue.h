@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "VertexArray.h"
+#include "IndexBuffer.h"
+#include "Shader.h"
+#include "InstanceBuffer.h"
+#include "DrawIndirectBuffer.h"
+
+class MeshArena;
+
+/**
+ * RenderQueue — sorted, deferred draw submission
+ *
+ * Renderer::Draw issues glDrawElements the moment it is called, so the GL
+ * state changes (program, VAO, IBO, textures) happen in whatever order the
+ * test happened to write its draw loop. With a handful of objects that is
+ * fine; with hundreds the driver spends more time validating redundant
+ * state changes than the GPU spends drawing.
+ *
+ * The queue splits drawing into three steps:
+ *
+ *   1. SUBMIT: each object pushes a RenderCommand with a 64-bit sort key.
+ *   2. SORT:   once per frame, std::stable_sort on the key groups together
+ *              all commands that share a pass, shader, material and VAO.
+ *              Being stable, it keeps submission order among equal keys.
+ *   3. FLUSH:  walk the sorted list and only touch GL state when the part of
+ *              the key that owns that state actually changes.
+ *
+ * SORT KEY LAYOUT (most significant bits first):
+ *
+ *   63    60 59        48 47            32 31        20 19         0
+ *   +-------+------------+----------------+------------+------------+
+ *   | pass  |   shader   |    material    |    VAO     |   depth    |
+ *   +-------+------------+----------------+------------+------------+
+ *     4 bit     12 bit        16 bit          12 bit       20 bit
+ *
+ * Because pass is most significant, every shadow command is flushed before
+ * every opaque command. Within a pass the most expensive state change
+ * (program switch) is the next most significant, so it happens the fewest
+ * times. Depth is least significant: front-to-back inside an opaque batch
+ * (early-z rejects hidden fragments), back-to-front for transparency.
+ *
+ * Per-pass uniforms (view, projection, light data) are still set by the
+ * caller on each shader before FlushPass — uniforms live in the program
+ * object, so they survive the queue binding the program later.
+ *
+ * RECORDING IN PARALLEL
+ *   Submit is for one thread. To build the commands on the ThreadPool,
+ *   give each ParallelFor chunk a Bucket of its own: workers cull their
+ *   range, compute keys (Bucket::Submit) and write instance data through
+ *   a mapped InstanceBuffer, with no locking, and MergeBuckets then sorts
+ *   every bucket on the workers and merges the sorted runs here. Only the
+ *   merge and the flush's GL calls are left on the main thread.
+ *
+ *       queue.ResizeBuckets(chunks);
+ *       pool.ParallelFor(count, CHUNK, [&](unsigned int begin, unsigned int end, unsigned int)
+ *           { Record(begin, end, queue.GetBucket(begin / CHUNK)); });
+ *       queue.MergeBuckets();
+ *       queue.Flush();
+ *
+ *   A bucket per chunk rather than per thread keeps the merged order of
+ *   equal keys the same whichever thread ran which chunk.
+ *
+ * DEPTH PRE-PASS
+ *   Front-to-back sorting only helps between commands: a fragment still
+ *   runs the full shader whenever it is nearer than what was drawn before
+ *   it, so overlapping objects shade the same pixel several times. With
+ *   SetDepthPrepass(true), the opaque pass is drawn twice:
+ *
+ *     1. depth only, front to back by the key's depth, colour writes off,
+ *        through MeshArena's position-only VAOs and DepthPrepass.shader;
+ *     2. the commands as usual, with GL_EQUAL and depth writes off, so
+ *        only the visible fragment of each pixel runs the real shader.
+ *
+ *   It pays off when fragments are expensive (many lights, PCF, PBR) and
+ *   overlap; the price is drawing the geometry twice. Shaders drawn in
+ *   step 2 must declare `invariant gl_Position` and transform as
+ *   DepthPrepass.shader does, or they fail GL_EQUAL in places. Indirect
+ *   commands keep their own shader in step 1 (their transforms are in the
+ *   shader's storage buffer), so they save nothing there.
+ *
+ *   SetCountFragments(true) wraps both steps in GL_SAMPLES_PASSED queries:
+ *   GetFragmentStats() says how many fragments were shaded, for comparing
+ *   overdraw with the pre-pass on and off. The counts are read back a few
+ *   frames late rather than stalling. The GPU time of each step is in the
+ *   Profiler's "Depth pre-pass" and "Shading" scopes.
+ *
+ * VERTEX PULLING
+ *   A command with pullFrom set draws an arena mesh with no vertex
+ *   attributes (see MeshArena.h): its vao is MeshArena::GetEmptyVertexArray()
+ *   and its ibo is unused. The queue binds the arena's buffers as storage
+ *   whenever the arena changes, sets the shader's u_BaseVertex per command
+ *   (and u_BaseInstance for instances, whose InstanceBuffer it binds at
+ *   InstanceBuffer::STORAGE_BINDING) and draws arrays over the index range.
+ *   The shader must be a PULL variant for the arena's format
+ *   (MeshArena::GetPullVariant); the pre-pass picks DepthPrepass's own.
+ *   Indirect commands cannot be pulled. Mesh::FillCommand sets all of it.
+ */
+
+namespace RenderPass
+{
+	enum : uint8_t
+	{
+		Shadow = 0,
+		Opaque = 1,
+		Transparent = 2,
+		Overlay = 3
+	};
+}
+
+// A set of textures bound together. Owned by whoever owns the textures
+// (e.g. ModelMesh); the queue only keeps a pointer for the current frame.
+struct RenderMaterial
+{
+	static const unsigned int MAX_TEXTURES = 8;
+	static const unsigned int TABLE_BINDING = 6;  // MaterialBuffer SSBO
+
+	unsigned int id = 0;                          // feeds the material bits of the sort key
+	unsigned int textureCount = 0;
+	unsigned int textures[MAX_TEXTURES] = {};     // GL texture names, bound to unit = index
+	std::string  samplerNames[MAX_TEXTURES];      // sampler uniform set to that unit
+
+	// Set for a whole model's material table (MaterialTable.h) rather than
+	// one set of textures: the buffer is bound at TABLE_BINDING, and the
+	// textures are GL_TEXTURE_2D_ARRAYs when arrayTextures is set.
+	unsigned int tableBuffer = 0;
+	bool         arrayTextures = false;
+
+	// Binds the textures (and table) and points the samplers at their units
+	void Bind(Shader& shader) const;
+};
+
+struct RenderCommand
+{
+	uint64_t key = 0;
+
+	Shader*               shader = nullptr;
+	const VertexArray*    vao = nullptr;
+	const IndexBuffer*    ibo = nullptr;
+	const RenderMaterial* material = nullptr;
+
+	// Set to pull vertices from this arena's buffers; see VERTEX PULLING
+	const MeshArena*      pullFrom = nullptr;
+
+	// Index range to draw out of the ibo. indexCount 0 means the whole
+	// buffer; meshes in the shared MeshArena set all three from their range.
+	unsigned int indexCount = 0;
+	unsigned int firstIndex = 0;
+	int          baseVertex = 0;
+
+	// When set, the command draws every instance in one call and the model
+	// matrix/colour come from the instance attributes, not the uniforms below
+	// (a named colourUniform is still set: a per-draw vec4 for the shader).
+	const InstanceBuffer* instances = nullptr;
+	// Draw instances [firstInstance, firstInstance + instanceCount) of the
+	// buffer; instanceCount 0 means all of them.
+	unsigned int firstInstance = 0;
+	unsigned int instanceCount = 0;
+
+	// When set, the command is a multi-draw indirect batch: draws
+	// [indirectFirst, indirectFirst + indirectCount) of the buffer in one call.
+	// Per-draw transforms come from the buffer's SSBO; the model uniform below
+	// is still set and applies to the whole batch.
+	const DrawIndirectBuffer* indirect = nullptr;
+	unsigned int indirectFirst = 0;
+	unsigned int indirectCount = 0;
+
+	// Per-draw uniforms. A null name means "don't set it". A vec3 colour
+	// uniform (e.g. an albedo) is given the rgb.
+	glm::mat4   model = glm::mat4(1.0f);
+	const char* modelUniform = "u_Model";
+	glm::vec4   colour = glm::vec4(1.0f);
+	const char* colourUniform = nullptr;
+};
+
+class RenderQueue
+{
+public:
+	struct Stats
+	{
+		unsigned int commands = 0;
+		unsigned int drawCalls = 0;
+		unsigned int instances = 0;      // objects drawn, counting each instance
+		unsigned int shaderBinds = 0;
+		unsigned int materialBinds = 0;
+		unsigned int vaoBinds = 0;
+		unsigned int iboBinds = 0;
+		unsigned int instanceBinds = 0;   // InstanceBuffers attached to INSTANCE_BINDING
+		unsigned int prepassDrawCalls = 0; // of drawCalls, in the depth pre-pass
+		unsigned int pulledDrawCalls = 0;  // of drawCalls, with vertex pulling
+		unsigned int storageBinds = 0;     // arena buffers bound for pulling
+	};
+
+	// From SetCountFragments' queries, for the opaque pass
+	struct FragmentStats
+	{
+		uint64_t prepassFragments = 0;   // passed the depth test in the pre-pass
+		uint64_t shadedFragments = 0;    // ran the commands' own fragment shaders
+		bool     prepass = false;        // whether those frames had the pre-pass
+	};
+
+	static const unsigned int QUERY_COUNT = 4;   // frames of query latency
+
+	RenderQueue() = default;
+	~RenderQueue();
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	// Pack the key fields. depth01 is a normalised [0, 1] depth; it is
+	// inverted automatically for the transparent pass (back-to-front).
+	static uint64_t MakeKey(uint8_t pass, unsigned int shaderID, unsigned int materialID,
+		unsigned int vaoID, float depth01);
+
+	// Commands recorded by one thread at a time, merged by MergeBuckets
+	class Bucket
+	{
+	public:
+		// As RenderQueue::Submit
+		void Submit(uint8_t pass, RenderCommand command, float depth01 = 0.0f);
+		std::size_t GetCount() const { return m_Commands.size(); }
+
+	private:
+		friend class RenderQueue;
+		std::vector<RenderCommand> m_Commands;
+	};
+
+	// Convenience: builds the key from the command's own objects.
+	void Submit(uint8_t pass, RenderCommand command, float depth01 = 0.0f);
+
+	// `count` empty buckets. They keep their storage from frame to frame.
+	void ResizeBuckets(unsigned int count);
+	Bucket& GetBucket(unsigned int index) { return m_Buckets[index]; }
+	// Sorts the buckets on the ThreadPool and merges them, in bucket order
+	// for equal keys, after anything already submitted; then empties them
+	void MergeBuckets();
+
+	// Sort by key. Called automatically by FlushPass if anything was
+	// submitted since the last sort.
+	void Sort();
+
+	// Issue every command of the given pass with minimal state changes.
+	void FlushPass(uint8_t pass);
+
+	// Flush every pass in order.
+	void Flush();
+
+	// Drop all commands and reset the stats. Call at the start of each
+	// frame, before submitting, so the stats stay readable in RenderGUI.
+	void Clear();
+
+	const Stats& GetStats() const { return m_Stats; }
+	std::size_t GetCommandCount() const { return m_Commands.size(); }
+
+	// See DEPTH PRE-PASS above. Both apply to RenderPass::Opaque.
+	void SetDepthPrepass(bool enabled) { m_DepthPrepass = enabled; }
+	bool IsDepthPrepassEnabled() const { return m_DepthPrepass; }
+	void SetCountFragments(bool enabled) { m_CountFragments = enabled; }
+	const FragmentStats& GetFragmentStats() const { return m_FragmentStats; }
+
+private:
+	void FlushRange(const std::vector<RenderCommand>& commands, std::size_t first, std::size_t last);
+	// The opaque pass, with the pre-pass and fragment queries as set
+	void FlushOpaque(std::size_t first, std::size_t last);
+	void DrawDepthPrepass(std::size_t first, std::size_t last);
+	// The [first, last) range of m_Commands in `pass`
+	void FindPass(uint8_t pass, std::size_t& first, std::size_t& last) const;
+	void ReadFragmentQueries();
+
+	std::vector<RenderCommand> m_Commands;
+	std::vector<Bucket> m_Buckets;
+	unsigned int m_BucketCount = 0;         // in use this frame; the rest keep their storage
+	std::vector<std::size_t> m_RunEnds;     // MergeBuckets' scratch
+	bool m_Sorted = true;
+	Stats m_Stats;
+
+	bool m_DepthPrepass = false;
+	std::unique_ptr<Shader> m_PrepassShader;         // created on first use
+	std::vector<RenderCommand> m_PrepassCommands;    // this flush's step 1
+
+	bool m_CountFragments = false;
+	unsigned int m_FragmentQueries[QUERY_COUNT][2] = {};   // pre-pass, shading
+	bool m_QueryPending[QUERY_COUNT] = {};
+	bool m_QueryPrepass[QUERY_COUNT] = {};
+	uint64_t m_QueryFrame[QUERY_COUNT] = {};   // so an older result never replaces a newer one
+	uint64_t m_QueryFrames = 0;
+	uint64_t m_LatestQueryFrame = 0;
+	unsigned int m_NextQuery = 0;
+	FragmentStats m_FragmentStats;
+};
@@ -1,7 +1,10 @@
 #include "Renderer.h"
+#include "GLState.h"
 
 #include <iostream>
 
+// glGetError polling — only used by GlCall when GLDebug::Init could not
+// install a debug callback (see GLDebug.h).
 void glClearError()
 {
     while (glGetError() != GL_NO_ERROR);
@@ -22,7 +25,7 @@ void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib, const Shader&
     va.Bind();
     ib.Bind();
 
-    GlCall(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr));
+    GlCall(glDrawElements(GLState::GetPrimitive(), ib.GetCount(), ib.GetType(), nullptr));
 }
 
 void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib) const
@@ -31,7 +34,72 @@ void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib) const
     va.Bind();
     ib.Bind();
 
-    GlCall(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr));
+    GlCall(glDrawElements(GLState::GetPrimitive(), ib.GetCount(), ib.GetType(), nullptr));
+}
+
+void Renderer::DrawIndexed(unsigned int indexCount, unsigned int firstIndex, int baseVertex,
+    unsigned int indexType) const
+{
+    // The "indices" pointer is a byte offset into the bound element buffer;
+    // baseVertex is added to every index fetched.
+    const void* offset = (const void*)(std::size_t)(firstIndex * IndexBuffer::GetTypeSize(indexType));
+    GlCall(glDrawElementsBaseVertex(GLState::GetPrimitive(), indexCount, indexType, offset, baseVertex));
+}
+
+void Renderer::DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const InstanceBuffer& instances, const Shader& shader) const
+{
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+
+    DrawIndexedInstanced(ib.GetCount(), instances.GetCount(), 0, 0, 0, ib.GetType());
+}
+
+void Renderer::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount,
+    unsigned int firstIndex, int baseVertex, unsigned int baseInstance, unsigned int indexType) const
+{
+    if (instanceCount == 0)
+        return;
+
+    const void* offset = (const void*)(std::size_t)(firstIndex * IndexBuffer::GetTypeSize(indexType));
+    GlCall(glDrawElementsInstancedBaseVertexBaseInstance(GLState::GetPrimitive(), indexCount, indexType, offset,
+        instanceCount, baseVertex, baseInstance));
+}
+
+void Renderer::DrawArrays(unsigned int first, unsigned int count) const
+{
+    GlCall(glDrawArrays(GLState::GetPrimitive(), first, count));
+}
+
+void Renderer::DrawArraysInstanced(unsigned int first, unsigned int count, unsigned int instanceCount) const
+{
+    if (instanceCount == 0)
+        return;
+
+    GlCall(glDrawArraysInstanced(GLState::GetPrimitive(), first, count, instanceCount));
+}
+
+void Renderer::DrawIndirect(const VertexArray& va, const IndexBuffer& ib, const DrawIndirectBuffer& indirect,
+    unsigned int first, unsigned int count) const
+{
+    va.Bind();
+    ib.Bind();
+
+    DrawIndirect(indirect, first, count, ib.GetType());
+}
+
+void Renderer::DrawIndirect(const DrawIndirectBuffer& indirect, unsigned int first, unsigned int count,
+    unsigned int indexType) const
+{
+    if (count == 0)
+        return;
+
+    indirect.Bind();
+
+    // The "indices" pointer is a byte offset into GL_DRAW_INDIRECT_BUFFER
+    const void* offset = (const void*)(first * sizeof(DrawElementsIndirectCommand));
+    // Each command's firstIndex is counted in indices of this type
+    GlCall(glMultiDrawElementsIndirect(GLState::GetPrimitive(), indexType, offset, count, 0));
 }
 
 void Renderer::Clear() const
@@ -43,12 +111,12 @@ void Renderer::Clear() const
 
 void Renderer::ClearColour_Black() const
 {
-    GlCall(glClearColor(0, 0, 0, 1));
+    GLState::ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 }
 
 void Renderer::ClearColour_White() const
 {
-    GlCall(glClearColor(1, 1, 1, 1));
+    GLState::ClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 }
 
 
@@ -3,23 +3,50 @@
 #include "VertexArray.h"
 #include "IndexBuffer.h"
 #include "Shader.h"
+#include "InstanceBuffer.h"
+#include "DrawIndirectBuffer.h"
 
-#define ASSERT(x) if (!(x)) __debugbreak(); //validate a condition that checks if bool false add a breakpoint 
-
-#define GlCall(x) glClearError();\
-    x;\
-    ASSERT(glLogCall(#x, __FILE__, __LINE__)) 
-//a multi line macro that clears the error and executes the passed function and then if false will break at point and then 
-// log call command to print out the errors in the function, the file and the line
-
-void glClearError();
-bool glLogCall(const char* function, const char* file, int line);
+// ASSERT and GlCall live in GLDebug.h. In debug builds GlCall records the
+// call's function, file and line so errors reported through the KHR_debug
+// callback can be attributed; in release builds GlCall(x) is just x.
+#include "GLDebug.h"
 
 class Renderer {
 public:
     void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const;
     void Draw(const VertexArray& va, const IndexBuffer& ib) const;
 
+    // Issues the draw with whatever VAO/IBO is already bound. Used by
+    // RenderQueue, which binds state itself only when it changes.
+    // firstIndex/baseVertex select a sub-range of shared buffers (see
+    // MeshArena.h); the defaults draw the start of the bound buffers.
+    // indexType is the bound buffer's IndexBuffer::GetType().
+    void DrawIndexed(unsigned int indexCount, unsigned int firstIndex = 0, int baseVertex = 0,
+        unsigned int indexType = GL_UNSIGNED_INT) const;
+
+    // One draw call for every instance in `instances`. The VAO must have had
+    // the instance buffer attached with VertexArray::AddInstanceBuffer.
+    void DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const InstanceBuffer& instances, const Shader& shader) const;
+    // baseInstance offsets the per-instance attributes, so one instance
+    // buffer can hold several lists (e.g. one per pass) drawn separately.
+    void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount,
+        unsigned int firstIndex = 0, int baseVertex = 0, unsigned int baseInstance = 0,
+        unsigned int indexType = GL_UNSIGNED_INT) const;
+
+    // Non-indexed draws with whatever VAO is bound, for vertex pulling (see
+    // MeshArena.h): gl_VertexID runs from `first`, and the shader fetches
+    // its own vertices. gl_InstanceID always starts at 0.
+    void DrawArrays(unsigned int first, unsigned int count) const;
+    void DrawArraysInstanced(unsigned int first, unsigned int count, unsigned int instanceCount) const;
+
+    // glMultiDrawElementsIndirect over draws [first, first + count) of the
+    // buffer. The VAO/IBO must hold the geometry every command refers to,
+    // and all of it in one index type.
+    void DrawIndirect(const VertexArray& va, const IndexBuffer& ib, const DrawIndirectBuffer& indirect,
+        unsigned int first, unsigned int count) const;
+    void DrawIndirect(const DrawIndirectBuffer& indirect, unsigned int first, unsigned int count,
+        unsigned int indexType = GL_UNSIGNED_INT) const;
+
 
     void Clear() const;
 
@@ -0,0 +1,193 @@
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "Mesh/Mesh.h"
+
+#include <algorithm>
+
+unsigned int Scene::AddMesh(const Mesh& mesh)
+{
+	for (unsigned int id = 0; id < m_MeshList.size(); id++)
+	{
+		if (m_MeshList[id] == &mesh)
+			return id;
+	}
+	m_MeshList.push_back(&mesh);
+	return static_cast<unsigned int>(m_MeshList.size() - 1);
+}
+
+Scene::Entity Scene::Create(unsigned int mesh, const glm::mat4& transform, const Material& material, uint8_t flags)
+{
+	Entity entity;
+	if (!m_FreeIds.empty())
+	{
+		entity = m_FreeIds.back();
+		m_FreeIds.pop_back();
+	}
+	else
+	{
+		entity = static_cast<Entity>(m_Index.size());
+		m_Index.push_back(0);
+	}
+
+	m_Index[entity] = GetCount();
+	m_Entities.push_back(entity);
+	m_Transforms.push_back(transform);
+	m_MeshIds.push_back(mesh);
+	m_Materials.push_back(material);
+	m_Flags.push_back(flags);
+	m_BoundsDirty.push_back(1);
+	m_Bounds.Add(Bounds());
+	m_AnyBoundsDirty = true;
+	return entity;
+}
+
+void Scene::Destroy(Entity entity)
+{
+	// Destroying it again would free its id twice and move another
+	// entity's data over whatever now holds its old index
+	if (!IsAlive(entity))
+		return;
+
+	const unsigned int index = m_Index[entity];
+	const unsigned int last = GetCount() - 1;
+
+	// The last entity takes the freed index, in every array alike
+	const Entity moved = m_Entities[last];
+	m_Entities[index] = moved;
+	m_Transforms[index] = m_Transforms[last];
+	m_MeshIds[index] = m_MeshIds[last];
+	m_Materials[index] = m_Materials[last];
+	m_Flags[index] = m_Flags[last];
+	m_BoundsDirty[index] = m_BoundsDirty[last];
+	m_Bounds.Remove(index);
+	m_Index[moved] = index;
+
+	m_Entities.pop_back();
+	m_Transforms.pop_back();
+	m_MeshIds.pop_back();
+	m_Materials.pop_back();
+	m_Flags.pop_back();
+	m_BoundsDirty.pop_back();
+
+	m_Index[entity] = INVALID_ENTITY;
+	m_FreeIds.push_back(entity);
+}
+
+void Scene::Clear()
+{
+	m_Entities.clear();
+	m_Transforms.clear();
+	m_MeshIds.clear();
+	m_Materials.clear();
+	m_Flags.clear();
+	m_BoundsDirty.clear();
+	m_Bounds.Clear();
+	m_Index.clear();
+	m_FreeIds.clear();
+	m_AnyBoundsDirty = false;
+}
+
+void Scene::Reserve(unsigned int count)
+{
+	m_Entities.reserve(count);
+	m_Transforms.reserve(count);
+	m_MeshIds.reserve(count);
+	m_Materials.reserve(count);
+	m_Flags.reserve(count);
+	m_BoundsDirty.reserve(count);
+	m_Bounds.Reserve(count);
+	m_Index.reserve(count);
+}
+
+void Scene::SetTransform(Entity entity, const glm::mat4& transform)
+{
+	const unsigned int index = m_Index[entity];
+	m_Transforms[index] = transform;
+	m_BoundsDirty[index] = 1;
+	m_AnyBoundsDirty = true;
+}
+
+unsigned int Scene::UpdateBounds()
+{
+	if (!m_AnyBoundsDirty)
+		return 0;
+
+	const unsigned int count = GetCount();
+	auto update = [this](unsigned int begin, unsigned int end)
+	{
+		unsigned int updated = 0;
+		for (unsigned int i = begin; i < end; i++)
+		{
+			if (!m_BoundsDirty[i])
+				continue;
+			m_Bounds.Set(i, m_MeshList[m_MeshIds[i]]->getWorldBounds(m_Transforms[i]));
+			m_BoundsDirty[i] = 0;
+			updated++;
+		}
+		return updated;
+	};
+
+	// A whole scene spawned at once is worth spreading over the workers;
+	// the ranges write disjoint indices
+	unsigned int updated = 0;
+	if (count >= CullBatch::PARALLEL_CULL_SIZE)
+	{
+		const unsigned int chunk = CullBatch::PARALLEL_CULL_SIZE / 4;
+		std::vector<unsigned int> counts((count + chunk - 1) / chunk, 0);
+		ThreadPool::Get().ParallelFor(count, chunk, [&](unsigned int begin, unsigned int end, unsigned int)
+			{
+				counts[begin / chunk] = update(begin, end);
+			});
+		for (unsigned int n : counts)
+			updated += n;
+	}
+	else
+	{
+		updated = update(0, count);
+	}
+
+	m_AnyBoundsDirty = false;
+	return updated;
+}
+
+unsigned int Scene::Cull(const Frustum& frustum, std::vector<unsigned int>& visible)
+{
+	UpdateBounds();
+	return m_Bounds.Cull(frustum, visible);
+}
+
+void Scene::GatherInstances(const std::vector<unsigned int>& visible, std::vector<InstanceData>* lists,
+	uint8_t flagMask, uint8_t flagValue) const
+{
+	InstanceData instance;
+	for (unsigned int i : visible)
+	{
+		if ((m_Flags[i] & flagMask) != flagValue)
+			continue;
+		instance.model = m_Transforms[i];
+		instance.colour = m_Materials[i].colour;
+		lists[m_MeshIds[i]].push_back(instance);
+	}
+}
+
+void Scene::Submit(RenderQueue& queue, uint8_t pass, Shader& shader, const std::vector<unsigned int>& visible,
+	const char* colourUniform) const
+{
+	RenderCommand command;
+	command.shader = &shader;
+	command.colourUniform = colourUniform;
+	for (unsigned int i : visible)
+	{
+		const Mesh& mesh = *m_MeshList[m_MeshIds[i]];
+		const MeshArena::Range& range = mesh.getArenaRange();
+		command.vao = mesh.getVertexArray();
+		command.ibo = mesh.getIndexBuffer();
+		command.indexCount = range.indexCount;
+		command.firstIndex = range.firstIndex;
+		command.baseVertex = range.baseVertex;
+		command.material = m_Materials[i].textures;
+		command.model = m_Transforms[i];
+		command.colour = m_Materials[i].colour;
+		queue.Submit(pass, command);
+	}
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Culling.h"
+#include "InstanceBuffer.h"
+#include "RenderQueue.h"
+
+class Mesh;
+class Shader;
+
+/**
+ * Scene — entities as dense component arrays, and the systems over them
+ *
+ * Tests used to keep their objects as hand-made members (m_Cubes[3],
+ * m_Spheres[2], a vector of structs) and draw them with a loop of their
+ * own, so culling, instancing and sorting had to be rewritten for each
+ * one. A Scene holds any number of entities, each of them
+ *
+ *     transform   glm::mat4, the world matrix
+ *     mesh        an id from AddMesh (the Scene never owns the Mesh)
+ *     material    a colour and optionally a RenderMaterial
+ *     bounds      world bounds, kept in a CullBatch
+ *     flags       FLAG_DYNAMIC and the like
+ *
+ * with every component in its own array, entity i of the scene at index i
+ * of each. The systems are plain loops over those arrays:
+ *
+ *     UpdateBounds      world bounds of the entities whose transform or
+ *                       mesh changed (Cull runs it first)
+ *     Cull              CullBatch's tests over every entity at once
+ *     GatherInstances   the visible entities' InstanceData, one list per
+ *                       mesh, ready for an InstanceBuffer and one
+ *                       instanced draw per mesh
+ *     Submit            one RenderCommand per visible entity, for scenes
+ *                       small enough not to bother with instancing
+ *
+ *     Scene scene;
+ *     unsigned int cube = scene.AddMesh(*cubeMesh);
+ *     Scene::Entity e = scene.Create(cube, transform);
+ *     scene.Cull(Frustum::FromMatrix(viewProjection), visible);
+ *     scene.Submit(queue, RenderPass::Opaque, shader, visible);
+ *
+ * ENTITIES
+ *   An Entity is a stable id; the arrays stay dense because Destroy moves
+ *   the last entity into the freed index (as ParticlePool does), which
+ *   reorders indices but never ids. GetIndex maps one to the other. Ids
+ *   are reused after Destroy, so a stale id may name a new entity; one
+ *   that names none is caught by IsAlive, and Destroy ignores it.
+ *
+ * Transforms are flat world matrices; an entity that needs a parent can
+ * take its matrix from a TransformHierarchy node each frame. The Scene
+ * makes no GL calls.
+ */
+class Scene
+{
+public:
+	typedef uint32_t Entity;
+	static const Entity INVALID_ENTITY = ~0u;
+
+	enum Flags : uint8_t
+	{
+		FLAG_DYNAMIC = 1 << 0,   // moves: kept out of anything cached, e.g. static shadows
+		FLAG_OCCLUDER = 1 << 1,  // large: drawn first and hides others, never occlusion-tested itself
+	};
+
+	struct Material
+	{
+		glm::vec4 colour;                  // InstanceData::colour when instanced
+		const RenderMaterial* textures;    // RenderCommand::material in Submit
+
+		Material(const glm::vec4& colour = glm::vec4(1.0f), const RenderMaterial* textures = nullptr)
+			: colour(colour), textures(textures) {}
+	};
+
+	// The mesh's id, the same one again for a mesh already added
+	unsigned int AddMesh(const Mesh& mesh);
+	const Mesh& GetMesh(unsigned int id) const { return *m_MeshList[id]; }
+	unsigned int GetMeshCount() const { return static_cast<unsigned int>(m_MeshList.size()); }
+
+	Entity Create(unsigned int mesh, const glm::mat4& transform, const Material& material = Material(), uint8_t flags = 0);
+	// Does nothing for an id that is not in use (destroyed already, or
+	// from before a Clear)
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity) const { return entity < m_Index.size() && m_Index[entity] != INVALID_ENTITY; }
+	// Every entity; the meshes stay added
+	void Clear();
+	void Reserve(unsigned int count);
+
+	void SetTransform(Entity entity, const glm::mat4& transform);
+	void SetMaterial(Entity entity, const Material& material) { m_Materials[m_Index[entity]] = material; }
+	void SetFlags(Entity entity, uint8_t flags) { m_Flags[m_Index[entity]] = flags; }
+
+	const glm::mat4& GetTransform(Entity entity) const { return m_Transforms[m_Index[entity]]; }
+	const Material& GetMaterial(Entity entity) const { return m_Materials[m_Index[entity]]; }
+	uint8_t GetFlags(Entity entity) const { return m_Flags[m_Index[entity]]; }
+
+	unsigned int GetCount() const { return static_cast<unsigned int>(m_Entities.size()); }
+	unsigned int GetIndex(Entity entity) const { return m_Index[entity]; }
+	Entity GetEntity(unsigned int index) const { return m_Entities[index]; }
+	// World bounds as of the last UpdateBounds (or Cull)
+	Bounds GetBounds(unsigned int index) const { return m_Bounds.Get(index); }
+
+	// The component arrays, by index
+	const std::vector<glm::mat4>& GetTransforms() const { return m_Transforms; }
+	const std::vector<unsigned int>& GetMeshIds() const { return m_MeshIds; }
+	const std::vector<Material>& GetMaterials() const { return m_Materials; }
+	const std::vector<uint8_t>& GetFlagArray() const { return m_Flags; }
+
+	// -- Systems --------------------------------------------------------------
+
+	// Returns how many entities it updated
+	unsigned int UpdateBounds();
+
+	// Indices (not ids) of the entities that intersect the frustum,
+	// replacing `visible`'s contents
+	unsigned int Cull(const Frustum& frustum, std::vector<unsigned int>& visible);
+
+	// Appends each visible entity's transform and colour to lists[its mesh
+	// id], where `lists` has GetMeshCount() entries. Only the entities whose
+	// flags & flagMask equal flagValue are gathered.
+	void GatherInstances(const std::vector<unsigned int>& visible, std::vector<InstanceData>* lists,
+		uint8_t flagMask = 0, uint8_t flagValue = 0) const;
+
+	// One command per visible entity: its mesh, material and transform
+	// (into "u_Model"), and its colour into colourUniform when that is set
+	void Submit(RenderQueue& queue, uint8_t pass, Shader& shader, const std::vector<unsigned int>& visible,
+		const char* colourUniform = nullptr) const;
+
+private:
+	std::vector<const Mesh*> m_MeshList;
+
+	// Dense, by index
+	std::vector<Entity>       m_Entities;
+	std::vector<glm::mat4>    m_Transforms;
+	std::vector<unsigned int> m_MeshIds;
+	std::vector<Material>     m_Materials;
+	std::vector<uint8_t>      m_Flags;
+	std::vector<uint8_t>      m_BoundsDirty;
+	CullBatch                 m_Bounds;
+	bool                      m_AnyBoundsDirty = false;
+
+	// Sparse, by id: the entity's index, or INVALID_ENTITY when it is free
+	std::vector<unsigned int> m_Index;
+	std::vector<Entity>       m_FreeIds;
+};
@@ -1,75 +1,321 @@
 #include "Shader.h"
 
 #include "Renderer.h"
+#include "GLState.h"
+#include "GpuResources.h"
+#include "FrameUniforms.h"
+#include "ShaderCache.h"
+#include "ShaderLibrary.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace
+{
+    Shader::Stats s_FrameStats;
+    Shader::Stats s_LastFrameStats;
+
+    bool s_ParallelCompile = false;
+    std::vector<Shader*> s_PendingShaders;
+
+#ifdef _DEBUG
+    // Warn once per uniform when a handle is set with the wrong kind of
+    // value, e.g. setUniform1f on a vec3. Integer setters may also set
+    // bools and samplers, so only the float-vs-int split is checked there.
+    void checkUniformType(const UniformHandle& uniform, unsigned int expected)
+    {
+        if (!uniform.IsValid() || uniform.type == expected)
+            return;
+        if (expected == GL_INT && uniform.type != GL_FLOAT && uniform.type != GL_FLOAT_VEC2 &&
+            uniform.type != GL_FLOAT_VEC3 && uniform.type != GL_FLOAT_VEC4 && uniform.type != GL_FLOAT_MAT4)
+            return;
+
+        static std::vector<int> warned;
+        for (int location : warned)
+            if (location == uniform.location)
+                return;
+        warned.push_back(uniform.location);
+        std::cout << "WARNING:: Uniform at location " << uniform.location << " has GL type 0x" << std::hex
+                  << uniform.type << ", set as 0x" << expected << std::dec << "\n";
+    }
+#else
+    inline void checkUniformType(const UniformHandle&, unsigned int) {}
+#endif
+}
+
 Shader::Shader(const std::string& filepath) : m_Filepath(filepath), m_RendererID(0)
 {
     //std::string fp = R"(C:\Users\natha\Desktop\code\CPP\CMakeHelloWorld\res\shaders\Basic.shader)";
-    ShaderProgramSource source = parseShaders(filepath);
-    // Create and compile the shader program from the vertex and fragment shaders
-    m_RendererID = CreateShader(source.VertexSource, source.FragmentSource);
+    build(parseShaders(filepath));
+}
+void Shader::build(ShaderProgramSource source)
+{
+    if (!m_VariantAxes.empty())
+    {
+        // This object is the all-defaults variant; keep the raw source so
+        // Variant() can build the others
+        m_VariantSource = source;
+        const std::vector<std::size_t> defaults(m_VariantAxes.size(), 0);
+        m_DefaultVariantKey = variantKey(defaults);
+        source = applyVariant(source, defaults);
+    }
+    // Create and compile the shader program from the vertex, fragment (and
+    // geometry / tessellation) shaders
+    m_RendererID = CreateShader(source);
+    if (!m_Pending)
+        Reflect();
+}
+Shader::Shader(const std::string& name, const ShaderProgramSource& source)
+    : m_Filepath(name), m_RendererID(0)
+{
+    m_RendererID = CreateShader(source);
+    if (!m_Pending)
+        Reflect();
 }
 Shader::Shader(const char* fragmentShaderSource, const char* vertexShaderSource)
 {
-    m_RendererID = CreateShader(vertexShaderSource, fragmentShaderSource);
+    ShaderProgramSource source;
+    source.VertexSource = vertexShaderSource;
+    source.FragmentSource = fragmentShaderSource;
+    m_RendererID = CreateShader(source);
+    if (!m_Pending)
+        Reflect();
 }
 Shader::~Shader()
 {
-    GlCall(glDeleteProgram(m_RendererID));// Delete the shader program after we're done using it
+    if (m_Pending)
+    {
+        s_PendingShaders.erase(std::find(s_PendingShaders.begin(), s_PendingShaders.end(), this));
+        glDeleteShader(m_Pending->vertexShader);
+        glDeleteShader(m_Pending->fragmentShader);
+        for (unsigned int optional : { m_Pending->geometryShader, m_Pending->tessControlShader, m_Pending->tessEvaluationShader })
+        {
+            if (optional)
+                glDeleteShader(optional);
+        }
+    }
+    // Prebuild's parse-only Shader never had a program
+    if (m_RendererID)
+        GpuResources::Delete(GL_PROGRAM, m_RendererID);// Delete the shader program once the GPU is done using it
 }
 void Shader::Bind() const
 {
-    GlCall(glUseProgram(m_RendererID));
+    // Finishing the link doesn't change which program this is, only fills
+    // in what the constructor would have if the compile had been blocking.
+    if (m_Pending)
+        const_cast<Shader*>(this)->WaitUntilReady();
+    GLState::UseProgram(m_RendererID, GetPrimitive());
+}
+unsigned int Shader::GetPrimitive() const
+{
+    return m_Tessellated ? GL_PATCHES : GL_TRIANGLES;
 }
 void Shader::Unbind() const
 {
-    GlCall(glUseProgram(0));
+    GLState::UseProgram(0);
+}
+
+
+/**
+ * Program interface reflection
+ *
+ * glGetProgramInterfaceiv / glGetProgramResourceiv (GL 4.3) list everything
+ * the linker kept: each active uniform with its location, type and array
+ * size, and each uniform / storage block with its binding. Doing this once
+ * after linking means lookups never go back to the driver.
+ *
+ * Uniforms inside a block have no location (they are set through the
+ * block's buffer, e.g. FrameData), so only default-block uniforms are kept.
+ */
+void Shader::Reflect()
+{
+    m_Uniforms.clear();
+    m_Blocks.clear();
+    if (m_RendererID == 0)
+        return;
+
+    GLint count = 0;
+    GlCall(glGetProgramInterfaceiv(m_RendererID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count));
+
+    const GLenum props[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+    std::vector<char> name;
+    for (GLint i = 0; i < count; i++)
+    {
+        GLint values[5];
+        GlCall(glGetProgramResourceiv(m_RendererID, GL_UNIFORM, i, 5, props, 5, nullptr, values));
+        if (values[4] != -1)
+            continue;
+
+        name.resize(values[0]);
+        GlCall(glGetProgramResourceName(m_RendererID, GL_UNIFORM, i, values[0], nullptr, name.data()));
+        std::string uniformName(name.data());
+
+        UniformHandle uniform;
+        uniform.location = values[2];
+        uniform.type = static_cast<unsigned int>(values[1]);
+        uniform.arraySize = values[3];
+        m_Uniforms[uniformName] = uniform;
+
+        // Arrays are listed as "name[0]"; accept "name" too, as glGetUniformLocation does
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+            m_Uniforms[uniformName.substr(0, uniformName.size() - 3)] = uniform;
+    }
+
+    reflectBlocks(GL_UNIFORM_BLOCK);
+    reflectBlocks(GL_SHADER_STORAGE_BLOCK);
+}
+
+void Shader::reflectBlocks(unsigned int blockInterface)
+{
+    GLint count = 0;
+    GlCall(glGetProgramInterfaceiv(m_RendererID, blockInterface, GL_ACTIVE_RESOURCES, &count));
+
+    const GLenum props[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+    std::vector<char> name;
+    for (GLint i = 0; i < count; i++)
+    {
+        GLint values[3];
+        GlCall(glGetProgramResourceiv(m_RendererID, blockInterface, i, 3, props, 3, nullptr, values));
+        name.resize(values[0]);
+        GlCall(glGetProgramResourceName(m_RendererID, blockInterface, i, values[0], nullptr, name.data()));
+
+        ShaderBlockInfo block;
+        block.index = static_cast<unsigned int>(i);
+        block.binding = values[1];
+        block.dataSize = values[2];
+        block.storage = blockInterface == GL_SHADER_STORAGE_BLOCK;
+        m_Blocks[std::string(name.data())] = block;
+    }
+}
+
+const ShaderBlockInfo* Shader::GetBlock(const std::string& name) const
+{
+    auto it = m_Blocks.find(name);
+    return it != m_Blocks.end() ? &it->second : nullptr;
+}
+
+const UniformHandle& Shader::lookupUniform(const std::string& name)
+{
+    WaitUntilReady();
+
+    auto it = m_Uniforms.find(name);
+    if (it != m_Uniforms.end())
+        return it->second;
+
+    // Not in the reflected list: an element name like "u_Array[3]", or a
+    // uniform that doesn't exist. Ask GL once and cache the answer either way.
+    UniformHandle uniform;
+    GlCall(uniform.location = glGetUniformLocation(m_RendererID, name.c_str()));
+    if (uniform.location == -1)
+        std::cout << "WARNING:: Uniform " << name << " is not defined \n";
+    else if (name.find('[') != std::string::npos)
+    {
+        // Same type as the array it indexes
+        uniform.type = lookupUniform(name.substr(0, name.find('['))).type;
+        uniform.arraySize = 1;
+    }
+
+    return m_Uniforms[name] = uniform;
+}
+
+UniformHandle Shader::Uniform(const std::string& name)
+{
+    return lookupUniform(name);
+}
+
+void Shader::setUniform1i(UniformHandle uniform, int i)
+{
+    checkUniformType(uniform, GL_INT);
+    s_FrameStats.handleSets++;
+    GlCall(glProgramUniform1i(m_RendererID, uniform.location, i));
+}
+
+void Shader::setUniformMat4f(UniformHandle uniform, const glm::mat4& matrix)
+{
+    checkUniformType(uniform, GL_FLOAT_MAT4);
+    s_FrameStats.handleSets++;
+    GlCall(glProgramUniformMatrix4fv(m_RendererID, uniform.location, 1, GL_FALSE, &matrix[0][0]));
+}
+
+void Shader::setUniform4f(UniformHandle uniform, float v0, float v1, float v2, float v3)
+{
+    checkUniformType(uniform, GL_FLOAT_VEC4);
+    s_FrameStats.handleSets++;
+    GlCall(glProgramUniform4f(m_RendererID, uniform.location, v0, v1, v2, v3));
 }
 
+void Shader::setUniform3f(UniformHandle uniform, float v0, float v1, float v2)
+{
+    checkUniformType(uniform, GL_FLOAT_VEC3);
+    s_FrameStats.handleSets++;
+    GlCall(glProgramUniform3f(m_RendererID, uniform.location, v0, v1, v2));
+}
 
+void Shader::setUniform2f(UniformHandle uniform, float v0, float v1)
+{
+    checkUniformType(uniform, GL_FLOAT_VEC2);
+    s_FrameStats.handleSets++;
+    GlCall(glProgramUniform2f(m_RendererID, uniform.location, v0, v1));
+}
+
+void Shader::setUniform1f(UniformHandle uniform, float v0)
+{
+    checkUniformType(uniform, GL_FLOAT);
+    s_FrameStats.handleSets++;
+    GlCall(glProgramUniform1f(m_RendererID, uniform.location, v0));
+}
+
+
+// String overloads: one hash lookup, then the handle path, so handleSets
+// counts every set and stringSets the ones that paid for a lookup.
 void Shader::setUniform4f(const std::string& name, float v0, float v1, float v2, float v3)
 {
-    GlCall(glUniform4f(getUniformLocation(name), v0, v1, v2, v3));
+    s_FrameStats.stringSets++;
+    setUniform4f(lookupUniform(name), v0, v1, v2, v3);
 }
 
 void Shader::setUniform3f(const std::string& name, float v0, float v1, float v2)
 {
-    GlCall(glUniform3f(getUniformLocation(name), v0, v1, v2));
+    s_FrameStats.stringSets++;
+    setUniform3f(lookupUniform(name), v0, v1, v2);
 }
 
 void Shader::setUniform2f(const std::string& name, float v0, float v1)
 {
-    GlCall(glUniform2f(getUniformLocation(name), v0, v1));
+    s_FrameStats.stringSets++;
+    setUniform2f(lookupUniform(name), v0, v1);
 }
 
 void Shader::setUniform1f(const std::string& name, float v0)
 {
-    GlCall(glUniform1f(getUniformLocation(name), v0));
+    s_FrameStats.stringSets++;
+    setUniform1f(lookupUniform(name), v0);
 }
 
 
 
 void Shader::setUniform1i(const std::string& name, int i)
 {
-    GlCall(glUniform1i(getUniformLocation(name), i));
+    s_FrameStats.stringSets++;
+    setUniform1i(lookupUniform(name), i);
 }
 
 void Shader::setUniformMat4f(const std::string& name, const glm::mat4& matrix)
 {
-    GlCall(glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &matrix[0][0]));
+    s_FrameStats.stringSets++;
+    setUniformMat4f(lookupUniform(name), matrix);
 }
-unsigned int Shader::getUniformLocation(const std::string& name)
+
+void Shader::BeginFrame()
 {
-    if (m_uniformLocationCache.find(name) != m_uniformLocationCache.end())
-    {
-        return m_uniformLocationCache[name];
-    }
-    GlCall(int location = glGetUniformLocation(m_RendererID, name.c_str()));
-    if (location == -1)
-        std::cout << "WARNING:: Uniform " << name << " is not defined \n";
-    
-    m_uniformLocationCache[name] = location;
+    s_LastFrameStats = s_FrameStats;
+    s_FrameStats = Stats();
+}
 
-    return location;
+const Shader::Stats& Shader::GetLastFrameStats()
+{
+    return s_LastFrameStats;
 }
 ShaderProgramSource Shader::parseShaders(const std::string& filepath)
 {
@@ -79,20 +325,65 @@ ShaderProgramSource Shader::parseShaders(const std::string& filepath)
 
     std::ifstream stream(filepath);
     std::string line;
-    std::stringstream ss[2];//stack allocated array 
+    std::stringstream ss[5];//stack allocated array 
 
     enum class ShaderType
     {
-        NONE = -1, VERTEX = 0, FRAGMENT = 1
+        NONE = -1, VERTEX = 0, FRAGMENT = 1, GEOMETRY = 2, TESS_CONTROL = 3, TESS_EVALUATION = 4
     };
 
     ShaderType type = ShaderType::NONE;
 
     while (getline(stream, line))
     {
+        if (line.compare(0, 8, "#variant") == 0)
+        {
+            // #variant NAME=A,B,C  (applies to every stage, see Shader.h)
+            std::string declaration = line.substr(8, line.find("//") == std::string::npos ? std::string::npos : line.find("//") - 8);
+            std::size_t equals = declaration.find('=');
+            if (equals == std::string::npos)
+            {
+                std::cout << "WARNING:: Malformed #variant line in " << filepath << ": " << line << "\n";
+                continue;
+            }
+
+            auto trim = [](const std::string& text)
+            {
+                std::size_t first = text.find_first_not_of(" \t\r");
+                std::size_t last = text.find_last_not_of(" \t\r");
+                return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+            };
+
+            ShaderVariantAxis axis;
+            axis.name = trim(declaration.substr(0, equals));
+            std::stringstream values(declaration.substr(equals + 1));
+            std::string value;
+            axis.numeric = true;
+            while (getline(values, value, ','))
+            {
+                value = trim(value);
+                if (value.empty())
+                    continue;
+                axis.numeric = axis.numeric && value.find_first_not_of("0123456789") == std::string::npos;
+                axis.values.push_back(value);
+            }
+            if (!axis.name.empty() && !axis.values.empty())
+                m_VariantAxes.push_back(axis);
+            continue;
+        }
+
         if (line.find("#shader") != std::string::npos)
         {
-            if (line.find("vertex") != std::string::npos)
+            // Before "vertex": a comment on a tessellation line may mention it
+            if (line.find("tess_control") != std::string::npos)
+            {
+                type = ShaderType::TESS_CONTROL;
+            }
+            else if (line.find("tess_evaluation") != std::string::npos)
+            {
+                type = ShaderType::TESS_EVALUATION;
+            }
+            else if (line.find("vertex") != std::string::npos)
             {
                 type = ShaderType::VERTEX;
             }
@@ -100,15 +391,167 @@ ShaderProgramSource Shader::parseShaders(const std::string& filepath)
             {
                 type = ShaderType::FRAGMENT;
             }
+            else if (line.find("geometry") != std::string::npos)
+            {
+                type = ShaderType::GEOMETRY;
+            }
         }
-        else
+        else if (type != ShaderType::NONE)
         {
             ss[(int)type] << line << "\n";
         }
     }
-    std::cout << ss[0].str() << ss[1].str() << std::endl;
-    return { ss[0].str(), ss[1].str() };
+    // #include lines are resolved per stage, relative to this file (see ShaderLibrary.h)
+    return { ShaderLibrary::ResolveIncludes(ss[0].str(), filepath), ShaderLibrary::ResolveIncludes(ss[1].str(), filepath),
+        ShaderLibrary::ResolveIncludes(ss[2].str(), filepath), ShaderLibrary::ResolveIncludes(ss[3].str(), filepath),
+        ShaderLibrary::ResolveIncludes(ss[4].str(), filepath) };
+}
+std::string Shader::variantKey(const std::vector<std::size_t>& valueIndices) const
+{
+    std::string key;
+    for (std::size_t a = 0; a < m_VariantAxes.size(); a++)
+    {
+        if (!key.empty())
+            key += " ";
+        key += m_VariantAxes[a].name + "=" + m_VariantAxes[a].values[valueIndices[a]];
+    }
+    return key;
+}
+
+// Insert the variant's #defines straight after the #version line (which
+// must stay first in a GLSL source)
+std::string Shader::applyVariant(const std::string& source, const std::vector<std::size_t>& valueIndices) const
+{
+    std::string defines;
+    for (std::size_t a = 0; a < m_VariantAxes.size(); a++)
+    {
+        const ShaderVariantAxis& axis = m_VariantAxes[a];
+        if (axis.numeric)
+        {
+            defines += "#define " + axis.name + " " + axis.values[valueIndices[a]] + "\n";
+            continue;
+        }
+        for (std::size_t v = 0; v < axis.values.size(); v++)
+            defines += "#define " + axis.name + "_" + axis.values[v] + " " + std::to_string(v) + "\n";
+        defines += "#define " + axis.name + " " + std::to_string(valueIndices[a]) + "\n";
+    }
+
+    std::size_t insertAt = 0;
+    std::size_t version = source.find("#version");
+    if (version != std::string::npos)
+    {
+        insertAt = source.find('\n', version);
+        insertAt = insertAt == std::string::npos ? source.size() : insertAt + 1;
+    }
+    return source.substr(0, insertAt) + defines + source.substr(insertAt);
+}
+
+// Every stage the file has; the optional ones stay empty if it has none
+ShaderProgramSource Shader::applyVariant(const ShaderProgramSource& source, const std::vector<std::size_t>& valueIndices) const
+{
+    auto apply = [&](const std::string& stage) { return stage.empty() ? stage : applyVariant(stage, valueIndices); };
+    return { apply(source.VertexSource), apply(source.FragmentSource), apply(source.GeometrySource),
+        apply(source.TessControlSource), apply(source.TessEvaluationSource) };
+}
+
+Shader& Shader::variantFor(const std::vector<std::size_t>& valueIndices)
+{
+    const std::string key = variantKey(valueIndices);
+    if (key == m_DefaultVariantKey)
+        return *this;
+
+    std::unique_ptr<Shader>& variant = m_Variants[key];
+    if (!variant)
+    {
+        variant.reset(new Shader(m_Filepath + " [" + key + "]", applyVariant(m_VariantSource, valueIndices)));
+    }
+    return *variant;
+}
+
+Shader& Shader::Variant(const VariantSelection& selection)
+{
+    std::vector<std::size_t> indices(m_VariantAxes.size(), 0);
+    for (const auto& choice : selection)
+    {
+        bool found = false;
+        for (std::size_t a = 0; a < m_VariantAxes.size() && !found; a++)
+        {
+            if (m_VariantAxes[a].name != choice.first)
+                continue;
+            const std::vector<std::string>& values = m_VariantAxes[a].values;
+            auto value = std::find(values.begin(), values.end(), choice.second);
+            if (value != values.end())
+            {
+                indices[a] = static_cast<std::size_t>(value - values.begin());
+                found = true;
+            }
+        }
+        if (!found)
+            std::cout << "WARNING:: " << m_Filepath << " has no variant " << choice.first << "=" << choice.second << "\n";
+    }
+    return variantFor(indices);
 }
+
+Shader& Shader::Variant(const std::string& axis, const std::string& value)
+{
+    return Variant(VariantSelection{ { axis, value } });
+}
+
+void Shader::CompileAllVariants()
+{
+    if (m_VariantAxes.empty())
+        return;
+
+    // Count through every combination like an odometer
+    std::vector<std::size_t> indices(m_VariantAxes.size(), 0);
+    while (true)
+    {
+        variantFor(indices);
+
+        std::size_t a = 0;
+        while (a < indices.size() && ++indices[a] == m_VariantAxes[a].values.size())
+            indices[a++] = 0;
+        if (a == indices.size())
+            break;
+    }
+}
+
+unsigned int Shader::Prebuild(const std::string& filepath)
+{
+    // Only for the parse: no program, no GL state, no registration
+    Shader parsed;
+    const ShaderProgramSource source = parsed.parseShaders(filepath);
+
+    // The same expansion and key order as the constructor and CreateShader
+    unsigned int built = 0;
+    std::vector<std::size_t> indices(parsed.m_VariantAxes.size(), 0);
+    while (true)
+    {
+        const ShaderProgramSource variant = parsed.m_VariantAxes.empty() ? source : parsed.applyVariant(source, indices);
+        std::vector<const std::string*> stages = { &variant.VertexSource, &variant.FragmentSource };
+        std::vector<unsigned int> types = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+        const std::pair<const std::string*, unsigned int> optional[] = { { &variant.GeometrySource, GL_GEOMETRY_SHADER },
+            { &variant.TessControlSource, GL_TESS_CONTROL_SHADER }, { &variant.TessEvaluationSource, GL_TESS_EVALUATION_SHADER } };
+        for (const auto& stage : optional)
+        {
+            if (!stage.first->empty())
+            {
+                stages.push_back(stage.first);
+                types.push_back(stage.second);
+            }
+        }
+        if (ShaderCache::Prebuild(stages, types))
+            built++;
+
+        std::size_t a = 0;
+        while (a < indices.size() && ++indices[a] == parsed.m_VariantAxes[a].values.size())
+            indices[a++] = 0;
+        if (a == indices.size())
+            break;
+    }
+    return built;
+}
+
 // Function to compile a shader of a given type (vertex or fragment)
 unsigned int Shader::compileShader(unsigned int type, const std::string& source)
 {
@@ -125,7 +568,23 @@ unsigned int Shader::compileShader(unsigned int type, const std::string& source)
     // Compile the shader
     glCompileShader(id);
 
-    // Check if the compilation was successful
+    // With parallel compile, asking for the status now would wait for the
+    // compiler thread; finishLink checks it once the program is complete.
+    if (s_ParallelCompile)
+        return id;
+
+    if (!checkCompile(id, type))
+    {
+        // Delete the shader object as it failed to compile
+        glDeleteShader(id);
+        return 0;
+    }
+
+    return id;
+}
+// Check if the compilation was successful, printing the log if not
+bool Shader::checkCompile(unsigned int id, unsigned int type)
+{
     int result;
     glGetShaderiv(id, GL_COMPILE_STATUS, &result);
     if (result == GL_FALSE)
@@ -139,33 +598,172 @@ unsigned int Shader::compileShader(unsigned int type, const std::string& source)
 
         // Get the error message
         glGetShaderInfoLog(id, length, &length, message);
-        std::cout << "Failed to compile shader: " <<
-            (type == GL_VERTEX_SHADER ? "Vertex" : "Fragment") << " shader" << std::endl;
+        const char* stage = type == GL_VERTEX_SHADER ? "Vertex" : type == GL_GEOMETRY_SHADER ? "Geometry"
+            : type == GL_TESS_CONTROL_SHADER ? "Tessellation control"
+            : type == GL_TESS_EVALUATION_SHADER ? "Tessellation evaluation" : "Fragment";
+        std::cout << "Failed to compile shader: " << stage << " shader" << std::endl;
         std::cout << message << std::endl;
-
-        // Delete the shader object as it failed to compile
-        glDeleteShader(id);
-        return 0;
+        return false;
     }
 
-    return id;
+    return true;
 }
 // Function to create a shader program by linking a vertex and fragment shader
-unsigned int Shader::CreateShader(const std::string& vertexShader, const std::string& fragmentShader)
+unsigned int Shader::CreateShader(const ShaderProgramSource& source)
 {
+    auto start = std::chrono::steady_clock::now();
+    const std::string name = m_Filepath.empty() ? "(inline source)" : m_Filepath;
+
+    const bool hasTessellation = !source.TessControlSource.empty() || !source.TessEvaluationSource.empty();
+    if (hasTessellation && (source.TessControlSource.empty() || source.TessEvaluationSource.empty()))
+        std::cout << "WARNING:: " << name << " needs both tess_control and tess_evaluation sections\n";
+    m_Tessellated = hasTessellation;
+
+    // A binary from an earlier run skips compiling and linking (see ShaderCache.h)
+    // (vertex + fragment programs keep the keys they had before the optional
+    // stages: each one present is appended in turn)
+    std::vector<const std::string*> stages = { &source.VertexSource, &source.FragmentSource };
+    for (const std::string* optional : { &source.GeometrySource, &source.TessControlSource, &source.TessEvaluationSource })
+    {
+        if (!optional->empty())
+            stages.push_back(optional);
+    }
+    const uint64_t cacheKey = ShaderCache::MakeKey(stages);
+    unsigned int program = ShaderCache::Load(cacheKey);
+    if (program)
+    {
+        // Block bindings are not part of the binary, so link FrameData again
+        FrameUniforms::BindProgram(program);
+        ShaderCache::Report(name, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(), true);
+        return program;
+    }
+
     // Create a shader program and get its ID
-    unsigned int program = glCreateProgram();
+    program = glCreateProgram();
+    // Ask the driver to keep the linked binary around for ShaderCache::Store
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     // Compile the vertex shader
-    unsigned int vs = compileShader(GL_VERTEX_SHADER, vertexShader);
+    unsigned int vs = compileShader(GL_VERTEX_SHADER, source.VertexSource);
     // Compile the fragment shader
-    unsigned int fs = compileShader(GL_FRAGMENT_SHADER, fragmentShader);
+    unsigned int fs = compileShader(GL_FRAGMENT_SHADER, source.FragmentSource);
+    // And the geometry and tessellation shaders, when the file has them
+    unsigned int gs = source.GeometrySource.empty() ? 0 : compileShader(GL_GEOMETRY_SHADER, source.GeometrySource);
+    unsigned int tcs = source.TessControlSource.empty() ? 0 : compileShader(GL_TESS_CONTROL_SHADER, source.TessControlSource);
+    unsigned int tes = source.TessEvaluationSource.empty() ? 0 : compileShader(GL_TESS_EVALUATION_SHADER, source.TessEvaluationSource);
     // Attach the compiled shaders to the program
     glAttachShader(program, vs);
     glAttachShader(program, fs);
+    for (unsigned int optional : { gs, tcs, tes })
+    {
+        if (optional)
+            glAttachShader(program, optional);
+    }
     // Link the shaders together into a complete program
     glLinkProgram(program);
+
+    if (s_ParallelCompile)
+    {
+        // Return straight away; IsReady() finishes the job (see Shader.h)
+        m_Pending = std::make_unique<PendingLink>();
+        m_Pending->vertexShader = vs;
+        m_Pending->fragmentShader = fs;
+        m_Pending->geometryShader = gs;
+        m_Pending->tessControlShader = tcs;
+        m_Pending->tessEvaluationShader = tes;
+        m_Pending->cacheKey = cacheKey;
+        m_Pending->start = start;
+        s_PendingShaders.push_back(this);
+        return program;
+    }
+
+    // Link the shared FrameData block (camera matrices) to its binding point
+    FrameUniforms::BindProgram(program);
     // Validate the linked program to ensure it's usable
     glValidateProgram(program);
+
+    // Only cache programs that actually linked
+    int linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == GL_TRUE)
+        ShaderCache::Store(cacheKey, program);
+
+    ShaderCache::Report(name, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(), false);
     return program;
 }
 
+// The rest of CreateShader, for a program compiled in parallel. Runs once
+// GL_COMPLETION_STATUS_KHR says it's done, or earlier (and then waits) when
+// something needs the program.
+void Shader::finishLink()
+{
+    std::unique_ptr<PendingLink> pending = std::move(m_Pending);
+    s_PendingShaders.erase(std::find(s_PendingShaders.begin(), s_PendingShaders.end(), this));
+
+    checkCompile(pending->vertexShader, GL_VERTEX_SHADER);
+    checkCompile(pending->fragmentShader, GL_FRAGMENT_SHADER);
+    if (pending->geometryShader)
+        checkCompile(pending->geometryShader, GL_GEOMETRY_SHADER);
+    if (pending->tessControlShader)
+        checkCompile(pending->tessControlShader, GL_TESS_CONTROL_SHADER);
+    if (pending->tessEvaluationShader)
+        checkCompile(pending->tessEvaluationShader, GL_TESS_EVALUATION_SHADER);
+
+    FrameUniforms::BindProgram(m_RendererID);
+    glValidateProgram(m_RendererID);
+
+    int linked;
+    glGetProgramiv(m_RendererID, GL_LINK_STATUS, &linked);
+    if (linked == GL_TRUE)
+        ShaderCache::Store(pending->cacheKey, m_RendererID);
+
+    Reflect();
+
+    const std::string name = m_Filepath.empty() ? "(inline source)" : m_Filepath;
+    ShaderCache::Report(name, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - pending->start).count(), false);
+}
+
+bool Shader::IsReady()
+{
+    if (!m_Pending)
+        return true;
+
+    int complete = GL_FALSE;
+    GlCall(glGetProgramiv(m_RendererID, GL_COMPLETION_STATUS_KHR, &complete));
+    if (complete == GL_TRUE)
+        finishLink();
+    return !m_Pending;
+}
+
+void Shader::WaitUntilReady()
+{
+    // finishLink's status queries block until the driver is done
+    if (m_Pending)
+        finishLink();
+}
+
+bool Shader::EnableParallelCompile()
+{
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);    // let the driver pick how many
+    else if (GLEW_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    else
+        return false;
+
+    s_ParallelCompile = true;
+    return true;
+}
+
+bool Shader::IsParallelCompileEnabled()
+{
+    return s_ParallelCompile;
+}
+
+unsigned int Shader::PollPending()
+{
+    // IsReady removes finished shaders from the list, so poll a copy
+    const std::vector<Shader*> pending = s_PendingShaders;
+    for (Shader* shader : pending)
+        shader->IsReady();
+    return static_cast<unsigned int>(s_PendingShaders.size());
+}
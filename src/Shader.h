@@ -5,8 +5,12 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <chrono>
+#include <memory>
+#include <cstdint>
 
 #include <unordered_map>
+#include <vector>
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -14,8 +18,54 @@ struct ShaderProgramSource
 {
 	std::string VertexSource;
 	std::string FragmentSource;
+	std::string GeometrySource;   // optional "#shader geometry" section
+	// Optional "#shader tess_control" / "#shader tess_evaluation" sections,
+	// both or neither (see Shader::HasTessellation)
+	std::string TessControlSource;
+	std::string TessEvaluationSource;
 };
 
+/**
+ * UniformHandle — a uniform looked up once, then set by location
+ *
+ * setUniform*("u_Model", ...) has to find "u_Model" in a hash map on every
+ * call (and a string literal argument builds a temporary std::string first).
+ * That is fine for a handful of uniforms per frame, but in a per-draw loop
+ * the hashing adds up. Resolve the name once and keep the handle instead:
+ *
+ *     UniformHandle model = shader.Uniform("u_Model");   // at setup
+ *     shader.setUniformMat4f(model, matrix);              // per draw
+ *
+ * Handles come from the program's reflected uniform list (see Shader::Reflect)
+ * and carry the GL type the shader declared, so debug builds can warn when a
+ * value of the wrong type is set. A handle for a uniform the program does not
+ * have is invalid (location -1) and setting it does nothing, like glUniform.
+ */
+struct UniformHandle
+{
+	int          location = -1;
+	unsigned int type = 0;        // GL type enum, e.g. GL_FLOAT_MAT4
+	int          arraySize = 0;   // 1 for non-arrays
+
+	bool IsValid() const { return location >= 0; }
+};
+
+// One "#variant NAME=A,B,C" line of a .shader file (see Shader::Variant)
+struct ShaderVariantAxis
+{
+	std::string name;
+	std::vector<std::string> values;   // values[0] is the default
+	bool numeric = false;              // every value is an integer literal
+};
+
+// An active uniform block or shader storage block, from reflection
+struct ShaderBlockInfo
+{
+	unsigned int index = 0;     // block index, for glUniformBlockBinding / glShaderStorageBlockBinding
+	int          binding = 0;   // binding point it reads from
+	int          dataSize = 0;  // minimum buffer size in bytes
+	bool         storage = false;
+};
 
 class Shader
 {
@@ -25,25 +75,168 @@ protected:
 	// requires the derived class to set m_RendererID during its own compilation.
 	std::string m_Filepath;
 	unsigned int m_RendererID;
-	std::unordered_map< std::string, int> m_uniformLocationCache;
+	// Every active uniform, filled by Reflect() after linking. Names the
+	// reflection does not list (e.g. "u_Array[3]") are added on first lookup.
+	std::unordered_map<std::string, UniformHandle> m_Uniforms;
+	std::unordered_map<std::string, ShaderBlockInfo> m_Blocks;
 
 	// Protected default constructor — lets subclasses handle their own compilation
 	// without triggering the vertex+fragment parsing path.
 	// The public constructors below are for the normal vertex+fragment workflow.
 	Shader() : m_RendererID(0) {}
 
+	// Query the linked program's active uniforms and blocks. Called by every
+	// constructor once m_RendererID is linked.
+	void Reflect();
+
+	// Compile state kept between CreateShader and finishLink while the
+	// driver's compiler threads work (parallel compile only)
+	struct PendingLink
+	{
+		unsigned int vertexShader = 0;
+		unsigned int fragmentShader = 0;
+		unsigned int geometryShader = 0;
+		unsigned int tessControlShader = 0;
+		unsigned int tessEvaluationShader = 0;
+		uint64_t cacheKey = 0;
+		std::chrono::steady_clock::time_point start;
+	};
+	std::unique_ptr<PendingLink> m_Pending;
+
+	// Compile-time permutations (see Variant). Only the Shader loaded from
+	// the file has axes; each variant is a separate Shader with its own
+	// program, compiled the first time it's asked for.
+	std::vector<ShaderVariantAxis> m_VariantAxes;
+	ShaderProgramSource m_VariantSource;        // file source without defines
+	std::string m_DefaultVariantKey;
+	std::unordered_map<std::string, std::unique_ptr<Shader>> m_Variants;
+
+	// The program has tessellation stages, so draws with GL_PATCHES
+	bool m_Tessellated = false;
+
+	// A variant: already-expanded sources, named for ShaderCache's report
+	Shader(const std::string& name, const ShaderProgramSource& source);
+
+	// ShaderLibrary parses a file to key it, then builds the program from
+	// that parse rather than reading the file again
+	friend class ShaderLibrary;
+
 public:
+	// Uniform-setting counters, so the control panel can show how many sets
+	// still go through the string-name path
+	struct Stats
+	{
+		unsigned int stringSets = 0;   // setUniform*(const std::string&, ...)
+		unsigned int handleSets = 0;   // every set, including the string ones
+	};
+
 	Shader(const std::string& filepath);
 	Shader(const char* fragmentShaderSource, const char* vertexShaderSource);
 	virtual ~Shader();
 
+	// Waits for a pending compile to finish first (see IsReady).
 	void Bind() const;
 	void Unbind() const;
 
+	/**
+	 * Parallel compilation (GL_KHR_parallel_shader_compile)
+	 *
+	 * Normally glCompileShader/glLinkProgram look asynchronous but the first
+	 * status query waits for the driver to finish, so constructing a test
+	 * with several shaders stalls the frame. With the extension enabled the
+	 * driver compiles on its own threads and GL_COMPLETION_STATUS_KHR can be
+	 * polled without waiting.
+	 *
+	 * Once EnableParallelCompile() has been called, a newly constructed
+	 * Shader that missed the ShaderCache is PENDING: its program exists but
+	 * is not linked yet. IsReady() polls it and finishes the link (error
+	 * logs, reflection, caching) once the driver is done. Anything that
+	 * needs the linked program (Bind, Uniform, setUniform by name) waits
+	 * for it instead, so using a pending shader is always correct, just not
+	 * free. The main loop calls PollPending() each frame and holds off a
+	 * freshly opened test until every shader it created is ready.
+	 */
+	static bool EnableParallelCompile();   // after glewInit; false if unsupported
+	static bool IsParallelCompileEnabled();
+	// Number of shaders still pending after polling each of them once.
+	static unsigned int PollPending();
+
+	/**
+	 * Shader variants — compile-time permutations instead of runtime branches
+	 *
+	 * A shader that picks its behaviour with a uniform (if (u_Effect == 3))
+	 * pays for the choice on every pixel, and the compiler can't simplify a
+	 * loop whose bounds come from a uniform. Instead a .shader file can
+	 * declare axes of #defines at the top:
+	 *
+	 *     #variant EFFECT=NONE,EDGE,BLUR    // named values
+	 *     #variant PCF_KERNEL=1,3,5         // integer values
+	 *
+	 * Each combination is compiled as its own program with, for the first
+	 * axis above set to BLUR:
+	 *
+	 *     #define EFFECT_NONE 0
+	 *     #define EFFECT_EDGE 1
+	 *     #define EFFECT_BLUR 2
+	 *     #define EFFECT 2
+	 *
+	 * and for integer axes just "#define PCF_KERNEL 3". The GLSL then uses
+	 * #if EFFECT == EFFECT_BLUR, and loops over PCF_KERNEL unroll.
+	 *
+	 * Variant() returns the program for a selection (axes not mentioned keep
+	 * their first value), compiling it on first use. The Shader constructed
+	 * from the file IS the all-defaults variant. Every variant has its own
+	 * uniform state, so set uniforms on the Shader that Variant returns.
+	 */
+	typedef std::vector<std::pair<std::string, std::string>> VariantSelection;
+	Shader& Variant(const VariantSelection& selection);
+	Shader& Variant(const std::string& axis, const std::string& value);
+	const std::vector<ShaderVariantAxis>& GetVariantAxes() const { return m_VariantAxes; }
+	// Start compiling every combination now (e.g. while a test is loading)
+	// so switching between them later never waits for the compiler.
+	void CompileAllVariants();
+
+	// Compile every variant of a .shader file into ShaderCache without
+	// creating a Shader, so constructing it later is all cache hits. Meant
+	// for the BackgroundLoader's context (see BackgroundLoader.h); returns
+	// the number of programs built, 0 if the cache had them all.
+	static unsigned int Prebuild(const std::string& filepath);
 
-	//less primitive shaders would be able to handle a lot more types of uniforms programatically determined
+	/**
+	 * Tessellation — "#shader tess_control" and "#shader tess_evaluation"
+	 *
+	 * A .shader file may add both tessellation stages (and/or a geometry
+	 * stage) after the vertex one. The program then consumes patches rather
+	 * than triangles, and drawing it with GL_TRIANGLES is an error, so the
+	 * draw primitive follows the program: Bind() tells GLState which one it
+	 * is (GLState::GetPrimitive) and Renderer / RenderQueue draw with that.
+	 * Patches are always triangles of the mesh's index buffer, so the
+	 * control stage must declare layout(vertices = 3) out.
+	 */
+	static const int PATCH_VERTICES = 3;
+	bool HasTessellation() const { return m_Tessellated; }
+	unsigned int GetPrimitive() const;   // GL_PATCHES or GL_TRIANGLES
 
+	bool IsPending() const { return m_Pending != nullptr; }
+	bool IsReady();
+	void WaitUntilReady();
 
+
+	// Resolve a uniform once; see UniformHandle. Warns (once per name) if the
+	// program has no such uniform.
+	UniformHandle Uniform(const std::string& name);
+
+	// Fast path. These use glProgramUniform*, so the program does not have to
+	// be bound to set its uniforms.
+	void setUniform1i(UniformHandle uniform, int i);
+	void setUniformMat4f(UniformHandle uniform, const glm::mat4& matrix);
+	void setUniform4f(UniformHandle uniform, float v0, float v1, float v2, float v3);
+	void setUniform3f(UniformHandle uniform, float v0, float v1, float v2);
+	void setUniform2f(UniformHandle uniform, float v0, float v1);
+	void setUniform1f(UniformHandle uniform, float v0);
+
+	// Slow path: a name lookup per call, counted in Stats::stringSets. Fine
+	// for setup and per-frame values; use handles in per-draw loops.
 	void setUniform1i(const std::string& name, int i);
 	void setUniformMat4f(const std::string& name, const glm::mat4& matrix);
 
@@ -53,12 +246,30 @@ public:
 	void setUniform2f(const std::string& name, float v0, float v1);
 	void setUniform1f(const std::string& name, float v0);
 
+	// Reflected program interface
+	const std::unordered_map<std::string, UniformHandle>& GetUniforms() const { return m_Uniforms; }
+	const ShaderBlockInfo* GetBlock(const std::string& name) const;
+
 	unsigned int GetID() const { return m_RendererID; }
 
+	// Per-frame counters across every shader; BeginFrame rolls them over.
+	static void BeginFrame();
+	static const Stats& GetLastFrameStats();
+
 private:
 	unsigned int compileShader(unsigned int type, const std::string& source);
+	bool checkCompile(unsigned int id, unsigned int type);
+	void finishLink();
 	ShaderProgramSource parseShaders(const std::string& filepath);
-	unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader);
-	unsigned int getUniformLocation(const std::string& name);
+	// The rest of the file constructor, once parseShaders has filled the axes
+	void build(ShaderProgramSource source);
+	std::string variantKey(const std::vector<std::size_t>& valueIndices) const;
+	std::string applyVariant(const std::string& source, const std::vector<std::size_t>& valueIndices) const;
+	ShaderProgramSource applyVariant(const ShaderProgramSource& source, const std::vector<std::size_t>& valueIndices) const;
+	Shader& variantFor(const std::vector<std::size_t>& valueIndices);
+	// The geometry and tessellation sources may be empty: vertex + fragment only
+	unsigned int CreateShader(const ShaderProgramSource& source);
+	const UniformHandle& lookupUniform(const std::string& name);
+	void reflectBlocks(unsigned int blockInterface);
 };
 
@@ -0,0 +1,265 @@
+#include "ShaderCache.h"
+#include "Renderer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+const char* const ShaderCache::CACHE_DIRECTORY = "res/ShaderCache";
+
+namespace
+{
+	// File header, followed by `length` bytes of program binary
+	struct CacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;        // guards against a renamed or mixed-up file
+		uint32_t format;     // binaryFormat from glGetProgramBinary
+		uint32_t length;
+	};
+
+	const uint32_t CACHE_MAGIC = 0x43425053;   // "SPBC"
+	const uint32_t CACHE_VERSION = 1;
+
+	struct CacheState
+	{
+		bool enabled = true;
+		bool supportChecked = false;
+		bool supported = false;
+		std::string driver;          // vendor + renderer + version, hashed into every key
+		ShaderCache::Stats stats;
+		std::vector<ShaderCache::Record> records;
+		std::mutex supportMutex;     // the first IsSupported may be on the loader thread
+	};
+
+	CacheState s_Cache;
+
+	void FnvAppend(uint64_t& hash, const char* data, std::size_t size)
+	{
+		for (std::size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ull;
+		}
+	}
+
+	std::string GLString(GLenum name)
+	{
+		const GLubyte* value = glGetString(name);
+		return value ? reinterpret_cast<const char*>(value) : "";
+	}
+
+	// Program binaries need at least one driver-supported format. No
+	// GlCall here or below: Prebuild runs this off the main thread.
+	bool IsSupported()
+	{
+		std::lock_guard<std::mutex> lock(s_Cache.supportMutex);
+		if (!s_Cache.supportChecked)
+		{
+			GLint formats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			s_Cache.supported = formats > 0;
+			s_Cache.driver = GLString(GL_VENDOR) + "\n" + GLString(GL_RENDERER) + "\n" + GLString(GL_VERSION);
+			s_Cache.supportChecked = true;
+		}
+		return s_Cache.supported;
+	}
+
+	std::filesystem::path CachePath(uint64_t key)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+		return std::filesystem::path(ShaderCache::CACHE_DIRECTORY) / name;
+	}
+}
+
+uint64_t ShaderCache::MakeKey(const std::vector<const std::string*>& sources)
+{
+	IsSupported();
+
+	uint64_t hash = 14695981039346656037ull;
+	FnvAppend(hash, s_Cache.driver.data(), s_Cache.driver.size());
+	for (const std::string* source : sources)
+	{
+		// A separator per stage, so moving text between stages changes the key
+		const char separator = 0;
+		FnvAppend(hash, &separator, 1);
+		FnvAppend(hash, source->data(), source->size());
+	}
+	return hash;
+}
+
+unsigned int ShaderCache::Load(uint64_t key)
+{
+	if (!s_Cache.enabled || !IsSupported())
+		return 0;
+
+	const std::filesystem::path path = CachePath(key);
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return 0;
+
+	CacheHeader header = {};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key)
+		return 0;
+
+	std::vector<char> binary(header.length);
+	file.read(binary.data(), header.length);
+	if (!file)
+		return 0;
+	file.close();
+
+	unsigned int program = glCreateProgram();
+	GlCall(glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size())));
+
+	GLint linked = GL_FALSE;
+	GlCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+	if (linked != GL_TRUE)
+	{
+		// Same key but the driver won't take it (e.g. an update that kept
+		// the version string). Drop the file; the caller compiles instead.
+		GlCall(glDeleteProgram(program));
+		std::error_code ignored;
+		std::filesystem::remove(path, ignored);
+		s_Cache.stats.rejected++;
+		return 0;
+	}
+
+	return program;
+}
+
+void ShaderCache::Store(uint64_t key, unsigned int program)
+{
+	if (!s_Cache.enabled || !IsSupported())
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(CACHE_DIRECTORY, error);
+	if (error)
+		return;
+
+	// Written aside (one file per thread) and renamed into place, so a
+	// reader sees all of it or none
+	const std::filesystem::path path = CachePath(key);
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%zx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::filesystem::path temporary = path;
+	temporary += suffix;
+	{
+		CacheHeader header = { CACHE_MAGIC, CACHE_VERSION, key, format, static_cast<uint32_t>(length) };
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), length);
+		if (!file)
+			return;
+	}
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+		std::filesystem::remove(temporary, error);
+}
+
+bool ShaderCache::Prebuild(const std::vector<const std::string*>& sources, const std::vector<unsigned int>& types)
+{
+	if (!s_Cache.enabled || !IsSupported())
+		return false;
+
+	const uint64_t key = MakeKey(sources);
+	std::error_code error;
+	if (std::filesystem::exists(CachePath(key), error))
+		return false;
+
+	unsigned int program = glCreateProgram();
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	std::vector<unsigned int> shaders;
+	for (std::size_t i = 0; i < sources.size(); i++)
+	{
+		unsigned int shader = glCreateShader(types[i]);
+		const char* source = sources[i]->c_str();
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+		glAttachShader(program, shader);
+		shaders.push_back(shader);
+	}
+	glLinkProgram(program);
+
+	// Waits for the compiler, on this thread. A program that does not link
+	// is left for the Shader to compile (and report) itself.
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked == GL_TRUE)
+		Store(key, program);
+
+	for (unsigned int shader : shaders)
+		glDeleteShader(shader);
+	glDeleteProgram(program);
+	return linked == GL_TRUE;
+}
+
+void ShaderCache::Report(const std::string& name, float milliseconds, bool cached)
+{
+	if (cached)
+	{
+		s_Cache.stats.hits++;
+		s_Cache.stats.warmMs += milliseconds;
+	}
+	else
+	{
+		s_Cache.stats.misses++;
+		s_Cache.stats.coldMs += milliseconds;
+	}
+
+	// One record per shader: a test reopened replaces its shaders' times
+	auto existing = std::find_if(s_Cache.records.begin(), s_Cache.records.end(),
+		[&name](const Record& record) { return record.name == name; });
+	if (existing == s_Cache.records.end())
+		existing = s_Cache.records.insert(existing, Record());
+	Record& record = *existing;
+	record.name = name;
+	record.milliseconds = milliseconds;
+	record.cached = cached;
+
+	std::cout << "Shader " << name << ": " << milliseconds << " ms ("
+	          << (cached ? "cached binary" : "compiled") << ")" << std::endl;
+}
+
+void ShaderCache::Clear()
+{
+	std::error_code ignored;
+	std::filesystem::remove_all(CACHE_DIRECTORY, ignored);
+}
+
+bool ShaderCache::IsEnabled()
+{
+	return s_Cache.enabled;
+}
+
+void ShaderCache::SetEnabled(bool enabled)
+{
+	s_Cache.enabled = enabled;
+}
+
+const ShaderCache::Stats& ShaderCache::GetStats()
+{
+	return s_Cache.stats;
+}
+
+const std::vector<ShaderCache::Record>& ShaderCache::GetRecords()
+{
+	return s_Cache.records;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * ShaderCache — program binaries saved to disk between runs
+ *
+ * Compiling and linking GLSL is slow: the driver parses, optimises and
+ * generates GPU code for every stage, and tests like TestPBR do it for
+ * several shaders each time they are opened from the TestMenu.
+ *
+ * After a successful link, glGetProgramBinary hands back the driver's
+ * compiled program as an opaque blob. Giving that blob to glProgramBinary
+ * on a fresh program object skips compiling entirely. The cache stores one
+ * blob per program in CACHE_DIRECTORY:
+ *
+ *     res/ShaderCache/<16 hex digit key>.bin
+ *
+ * THE KEY
+ *   A 64-bit FNV-1a hash of every stage's source (as given to the
+ *   compiler) plus GL_VENDOR, GL_RENDERER and GL_VERSION. A blob is only
+ *   valid for the exact driver that produced it, so a driver update or a
+ *   different GPU produces different keys and old files are simply unused.
+ *
+ * MISMATCHES
+ *   The driver may still refuse a blob (glProgramBinary leaves
+ *   GL_LINK_STATUS false). Load then deletes the file and returns 0, and
+ *   the caller compiles from source as if the cache were empty.
+ *
+ * Programs must be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set for
+ * Store to work; Shader and ComputeShader do that on the compile path.
+ *
+ * PREBUILDING
+ *   Prebuild compiles a program only to store it, so that creating the
+ *   Shader later is a hit. It is thread-safe with the cache's other entry
+ *   points and meant for the BackgroundLoader's context (see
+ *   BackgroundLoader.h); Store writes to a temporary file and renames it,
+ *   so a Load racing a Prebuild never reads half a binary.
+ */
+class ShaderCache
+{
+public:
+	static const char* const CACHE_DIRECTORY;
+
+	// How long one program took to create, the last time it was, and
+	// whether it came from the cache
+	struct Record
+	{
+		std::string name;
+		float milliseconds = 0.0f;
+		bool cached = false;
+	};
+
+	struct Stats
+	{
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		unsigned int rejected = 0;    // blobs the driver refused
+		float warmMs = 0.0f;          // total time spent on cache hits
+		float coldMs = 0.0f;          // total time spent compiling
+	};
+
+	// Key for a program built from these stage sources on this driver.
+	static uint64_t MakeKey(const std::vector<const std::string*>& sources);
+
+	// A linked program from the cache, or 0 if there is none (or it was rejected).
+	static unsigned int Load(uint64_t key);
+
+	// Save a linked program's binary under key.
+	static void Store(uint64_t key, unsigned int program);
+
+	// Compile, link and Store the program of these stages (sources in
+	// MakeKey's order, with their GL_*_SHADER types) unless the cache
+	// already has it. True if a binary was written. Any thread with a
+	// current context; touches no other engine state.
+	static bool Prebuild(const std::vector<const std::string*>& sources, const std::vector<unsigned int>& types);
+
+	// Note how long a shader took; also printed to the console. Replaces
+	// the record of an earlier load of the same name.
+	static void Report(const std::string& name, float milliseconds, bool cached);
+
+	// Delete every cached file, so the next loads measure cold compiles.
+	static void Clear();
+
+	static bool IsEnabled();
+	static void SetEnabled(bool enabled);
+
+	static const Stats& GetStats();
+	static const std::vector<Record>& GetRecords();
+};
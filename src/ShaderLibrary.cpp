@@ -0,0 +1,155 @@
+#include "ShaderLibrary.h"
+#include "Shader.h"
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	struct LibraryState
+	{
+		std::unordered_map<uint64_t, std::shared_ptr<Shader>> programs;
+		ShaderLibrary::Stats stats;
+	};
+
+	LibraryState s_Library;
+
+	// Stats::includes, counted apart: Shader::Prebuild resolves includes on
+	// the BackgroundLoader's thread too
+	std::atomic<unsigned int> s_Includes{ 0 };
+
+	// One spelling per file, so include-once sees "a/../b.glsl" and "b.glsl" as one
+	std::string CanonicalPath(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+		return (error ? path.lexically_normal() : canonical).generic_string();
+	}
+
+	// Whether `line` is an #include; `target` is the quoted file, empty if
+	// the line is malformed
+	bool ParseInclude(const std::string& line, std::string& target)
+	{
+		const std::size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+			return false;
+
+		target.clear();
+		const std::size_t open = line.find('"', start + 8);
+		const std::size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close != std::string::npos)
+			target = line.substr(open + 1, close - open - 1);
+		return true;
+	}
+
+	// Appends `source` to `out` with its includes pasted in, recursively;
+	// `included` is every file this stage has had so far
+	void Expand(const std::string& source, const std::filesystem::path& filepath,
+		std::vector<std::string>& included, std::string& out)
+	{
+		std::istringstream stream(source);
+		std::string line;
+		std::string target;
+		while (getline(stream, line))
+		{
+			if (!ParseInclude(line, target))
+			{
+				out += line;
+				out += '\n';
+				continue;
+			}
+			if (target.empty())
+			{
+				std::cout << "WARNING:: Malformed #include in " << filepath.generic_string() << ": " << line << "\n";
+				continue;
+			}
+
+			const std::filesystem::path path = filepath.parent_path() / target;
+			const std::string key = CanonicalPath(path);
+			if (std::find(included.begin(), included.end(), key) != included.end())
+				continue;
+			included.push_back(key);
+
+			std::ifstream file(path);
+			if (!file)
+			{
+				std::cout << "WARNING:: " << filepath.generic_string() << " includes " << target << ", which can't be read\n";
+				continue;
+			}
+			std::stringstream contents;
+			contents << file.rdbuf();
+			s_Includes.fetch_add(1, std::memory_order_relaxed);
+			Expand(contents.str(), path, included, out);
+		}
+	}
+}
+
+std::string ShaderLibrary::ResolveIncludes(const std::string& source, const std::string& filepath)
+{
+	// Most stages have none; leave those byte for byte as they were, so
+	// their ShaderCache keys don't change
+	if (source.find("#include") == std::string::npos)
+		return source;
+
+	// The file itself counts as included, so a chunk including it back stops there
+	std::vector<std::string> included = { CanonicalPath(filepath) };
+	std::string resolved;
+	resolved.reserve(source.size());
+	Expand(source, filepath, included, resolved);
+	return resolved;
+}
+
+std::shared_ptr<Shader> ShaderLibrary::Get(const std::string& filepath)
+{
+	// Parse only, as Shader::Prebuild does: no program yet
+	Shader parsed;
+	const ShaderProgramSource source = parsed.parseShaders(filepath);
+
+	// The axes go into the key as text of their own: the same stages with
+	// different #variant lines are different programs
+	std::string axes;
+	for (const ShaderVariantAxis& axis : parsed.m_VariantAxes)
+	{
+		axes += axis.name + "=";
+		for (const std::string& value : axis.values)
+			axes += value + ",";
+		axes += "\n";
+	}
+	const uint64_t key = ShaderCache::MakeKey({ &source.VertexSource, &source.FragmentSource, &source.GeometrySource,
+		&source.TessControlSource, &source.TessEvaluationSource, &axes });
+
+	std::shared_ptr<Shader>& shader = s_Library.programs[key];
+	if (shader)
+	{
+		s_Library.stats.hits++;
+		return shader;
+	}
+
+	s_Library.stats.misses++;
+	shader.reset(new Shader());
+	shader->m_Filepath = filepath;
+	shader->m_VariantAxes = parsed.m_VariantAxes;
+	shader->build(source);
+	s_Library.stats.programs = static_cast<unsigned int>(s_Library.programs.size());
+	return shader;
+}
+
+const ShaderLibrary::Stats& ShaderLibrary::GetStats()
+{
+	s_Library.stats.includes = s_Includes.load(std::memory_order_relaxed);
+	return s_Library.stats;
+}
+
+void ShaderLibrary::Shutdown()
+{
+	s_Library = LibraryState();
+	s_Includes = 0;
+}
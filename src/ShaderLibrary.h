@@ -0,0 +1,75 @@
+#pragma once
+#include <memory>
+#include <string>
+
+class Shader;
+
+/**
+ * ShaderLibrary — one program per distinct shader source, shared by every test
+ *
+ * Each test used to construct its own Shader from a path, so
+ * DefaultScene.shader was compiled again by every test that called
+ * InitDefaultScene(), and Blinn-Phong.shader once for Lighting and once
+ * for Multiple Light Sources. ShaderCache makes the second compile a
+ * binary load, but each is still a program object of its own, linked,
+ * reflected and deleted again with its test. Get hands out one Shader per
+ * source instead:
+ *
+ *     m_Shader = ShaderLibrary::Get("res/Shaders/DefaultScene.shader");   // std::shared_ptr<Shader>
+ *
+ * INCLUDES
+ *   A line #include "file" in any stage of a .shader, or in a compute
+ *   shader's file, is replaced by that file, found relative to the file
+ *   it appears in, so chunks may include chunks. Each file is pasted in
+ *   at most once per stage: Clusters.glsl includes FrameData.glsl for
+ *   u_View, and a stage including both gets one FrameData block. The
+ *   shared chunks live in res/Shaders/Include; they are plain GLSL with
+ *   no #shader or #variant lines, included after #version. Pasting comes
+ *   before GLSL's own preprocessor, so "once" ignores #if: a chunk first
+ *   included inside an #if is missing outside it, and a stage that also
+ *   needs it unconditionally includes it ahead of the #if. A file that
+ *   cannot be read is left out with a warning, and the compiler reports
+ *   what it was missing. Every Shader resolves includes, not just the
+ *   library's.
+ *
+ * THE KEY
+ *   A hash of the stages with their includes resolved, plus the #variant
+ *   axes: "res/shaders/X" and "res/Shaders/X" are one program, and so are
+ *   two files that expand to the same sources. Variants are children of
+ *   the Shader (see Shader::Variant), so they are shared with it.
+ *
+ * SHARED UNIFORMS
+ *   Uniforms belong to the program, so a shared Shader's are whatever its
+ *   last user set. Its users set every uniform they read before drawing,
+ *   as the lighting tests do in Render; one that needs state of its own
+ *   constructs a Shader of its own, as before.
+ *
+ * Programs stay in the library for the rest of the process once built,
+ * whether or not a test still holds them: reopening a test costs nothing.
+ * GL thread only, but for ResolveIncludes, which Shader::Prebuild also
+ * runs on the BackgroundLoader's thread. Shutdown releases them and must
+ * run before the GL context is destroyed.
+ */
+class ShaderLibrary
+{
+public:
+	struct Stats
+	{
+		unsigned int programs = 0;    // in the library
+		unsigned int hits = 0;        // Gets answered with one of them
+		unsigned int misses = 0;      // Gets that built a Shader
+		unsigned int includes = 0;    // files pasted into a stage, by anything
+	};
+
+	// The Shader for a .shader file, built on the first Get of its source
+	static std::shared_ptr<Shader> Get(const std::string& filepath);
+
+	// `source`, read from `filepath`, with every #include line replaced
+	// (see INCLUDES). Returned unchanged when it has none.
+	static std::string ResolveIncludes(const std::string& source, const std::string& filepath);
+
+	static const Stats& GetStats();
+
+	// Releases every program; ones a test still holds live until it lets go
+	static void Shutdown();
+};
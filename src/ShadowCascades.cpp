@@ -0,0 +1,69 @@
+#include "ShadowCascades.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+void ShadowCascades::Update(const Settings& settings, const glm::mat4& cameraView, float fovY, float aspect, float nearPlane,
+	const glm::vec3& lightDirection)
+{
+	m_Count = std::min(std::max(settings.count, 1), MAX_CASCADES);
+	const float farPlane = std::max(settings.shadowDistance, nearPlane * 2.0f);
+
+	// The light's rotation only: a fixed origin keeps the texel grid fixed
+	// in the world, so snapping below means the same thing every frame
+	const glm::vec3 direction = glm::normalize(lightDirection);
+	const glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+	const glm::mat4 cameraToWorld = glm::inverse(cameraView);
+
+	const float tanY = std::tan(fovY * 0.5f);
+	const float tanX = tanY * aspect;
+
+	m_Splits = glm::vec4(farPlane);
+	float sliceNear = nearPlane;
+	for (int i = 0; i < m_Count; i++)
+	{
+		const float t = static_cast<float>(i + 1) / m_Count;
+		const float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+		const float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+		const float sliceFar = settings.lambda * logSplit + (1.0f - settings.lambda) * uniformSplit;
+		m_Splits[i] = sliceFar;
+
+		// The slice's corners in world space, and a sphere around them:
+		// the centroid lies on the view axis, so the radius only depends
+		// on the slice, not on where the camera looks
+		glm::vec3 corners[8];
+		glm::vec3 centre(0.0f);
+		for (int c = 0; c < 8; c++)
+		{
+			const float depth = c < 4 ? sliceNear : sliceFar;
+			const float x = (c & 1 ? 1.0f : -1.0f) * depth * tanX;
+			const float y = (c & 2 ? 1.0f : -1.0f) * depth * tanY;
+			corners[c] = glm::vec3(cameraToWorld * glm::vec4(x, y, -depth, 1.0f));
+			centre = centre + corners[c];
+		}
+		centre = centre / 8.0f;
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners)
+			radius = std::max(radius, glm::length(corner - centre));
+		// Rounded up so float noise never changes the texel size
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		// Snap the centre to the texel grid in light space
+		const float texel = 2.0f * radius / settings.resolution;
+		glm::vec3 lightCentre = glm::vec3(lightView * glm::vec4(centre, 1.0f));
+		lightCentre.x = std::floor(lightCentre.x / texel) * texel;
+		lightCentre.y = std::floor(lightCentre.y / texel) * texel;
+
+		// View space looks down -z: the slice spans lightCentre.z +- radius,
+		// casters reach casterDistance closer to the light
+		const glm::mat4 projection = glm::ortho(lightCentre.x - radius, lightCentre.x + radius,
+			lightCentre.y - radius, lightCentre.y + radius,
+			-lightCentre.z - radius - settings.casterDistance, -lightCentre.z + radius);
+
+		m_ViewProjection[i] = projection * lightView;
+		m_TexelSize[i] = texel;
+		sliceNear = sliceFar;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "glm/glm.hpp"
+
+/**
+ * ShadowCascades — a directional light's shadow map split along the view
+ *
+ * One orthographic shadow map around the origin spreads its texels evenly
+ * over everything it covers: fit it to the whole ground plane and a texel
+ * is a hand's width everywhere, shrink it and distant objects lose their
+ * shadows. The camera needs detail near it and very little far away, so
+ * cascaded shadow maps cut the view frustum into slices by distance and
+ * give each its own map (a layer of one depth texture array), sized to
+ * just that slice.
+ *
+ * SPLITS
+ *   The "practical" scheme: each split distance blends the logarithmic
+ *   split (n * (f/n)^(i/N), the ideal for perspective aliasing but with
+ *   tiny near slices) and the uniform one (n + (f-n) * i/N) by `lambda`.
+ *
+ * STABILITY
+ *   Each slice is bounded by a sphere, whose radius does not change as the
+ *   camera turns, so the ortho size stays fixed; and the sphere's centre
+ *   in light space is snapped to whole texels, so as the camera moves the
+ *   map shifts by whole texels. Without both, shadow edges shimmer.
+ *
+ * CASTERS
+ *   The ortho box only reaches `casterDistance` beyond a slice towards the
+ *   light. Casters further out are kept by rendering with GL_DEPTH_CLAMP,
+ *   which flattens them onto the near plane instead of clipping them.
+ *
+ * Update once per frame after the camera; draw cascade i into layer i with
+ * GetViewProjection(i), which is also the frustum to cull its casters by.
+ */
+class ShadowCascades
+{
+public:
+	static const int MAX_CASCADES = 4;
+
+	struct Settings
+	{
+		int count = 4;
+		float lambda = 0.75f;             // 0 uniform splits .. 1 logarithmic
+		float shadowDistance = 100.0f;    // nothing beyond this is shadowed
+		float casterDistance = 20.0f;     // depth range in front of each slice
+		int resolution = 1024;            // of each layer
+	};
+
+	// cameraView: the camera's view matrix; fovY in radians; near as the
+	// camera's perspective projection
+	void Update(const Settings& settings, const glm::mat4& cameraView, float fovY, float aspect, float nearPlane,
+		const glm::vec3& lightDirection);
+
+	int GetCount() const { return m_Count; }
+	const glm::mat4& GetViewProjection(int cascade) const { return m_ViewProjection[cascade]; }
+	// View-space distance where each cascade ends, for the lit shader
+	const glm::vec4& GetSplits() const { return m_Splits; }
+	// World-space size of one shadow texel in each cascade
+	float GetTexelSize(int cascade) const { return m_TexelSize[cascade]; }
+
+private:
+	int m_Count = 0;
+	glm::mat4 m_ViewProjection[MAX_CASCADES];
+	glm::vec4 m_Splits = glm::vec4(0.0f);
+	float m_TexelSize[MAX_CASCADES] = {};
+};
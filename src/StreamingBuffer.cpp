@@ -0,0 +1,169 @@
+#include "StreamingBuffer.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "FramePacer.h"
+
+// A stream used once a frame reuses a region REGION_COUNT frames later; the
+// FramePacer has retired that frame by then, so WaitForRegion finds the
+// fence signalled and never stalls
+static_assert(StreamingBuffer::REGION_COUNT >= FramePacer::MAX_FRAMES_IN_FLIGHT,
+	"a region must outlive the frames in flight");
+
+
+StreamingBuffer::StreamingBuffer(unsigned int regionSize)
+	: m_RendererID(0), m_RegionSize(regionSize), m_Persistent(false), m_Mapped(nullptr),
+	  m_Region(REGION_COUNT - 1), m_Head(0), m_InFrame(false), m_WindowBytes(0),
+	  m_WindowStart(std::chrono::steady_clock::now())
+{
+	for (unsigned int i = 0; i < REGION_COUNT; i++)
+		m_Fences[i] = nullptr;
+
+	const GLsizeiptr totalSize = static_cast<GLsizeiptr>(m_RegionSize) * REGION_COUNT;
+
+	GlCall(glGenBuffers(1, &m_RendererID));
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+
+	m_Persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+	if (m_Persistent)
+	{
+		// Immutable storage: the size can never change, but in exchange the
+		// mapping may stay alive while the GPU uses the buffer.
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GlCall(glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags));
+		GlCall(m_Mapped = static_cast<char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags)));
+	}
+
+	if (!m_Mapped)
+	{
+		m_Persistent = false;
+		GlCall(glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW));
+		m_Staging.resize(static_cast<std::size_t>(totalSize));
+		m_Mapped = m_Staging.data();
+	}
+	GpuMemory::TrackBuffer(GpuMemory::Category::Vertex, m_RendererID, static_cast<std::size_t>(totalSize));
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+	for (unsigned int i = 0; i < REGION_COUNT; i++)
+	{
+		if (m_Fences[i])
+			glDeleteSync(m_Fences[i]);
+	}
+
+	if (m_Persistent)
+	{
+		GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+		GlCall(glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+	}
+
+	GlCall(glDeleteBuffers(1, &m_RendererID));
+	GLState::OnBufferDeleted(m_RendererID);
+}
+
+void StreamingBuffer::WaitForRegion(unsigned int region)
+{
+	GLsync fence = m_Fences[region];
+	if (!fence)
+	{
+		m_Stats.fenceWaitMs = 0.0f;
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Poll first without blocking; only if the GPU is genuinely behind do we
+	// flush and wait (in 1 ms steps so a lost context can't hang forever).
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		m_Stats.fenceStalls++;
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	m_Stats.fenceWaitMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+	glDeleteSync(fence);
+	m_Fences[region] = nullptr;
+}
+
+void StreamingBuffer::BeginFrame()
+{
+	if (m_InFrame)
+		EndFrame();
+
+	m_Stats.bytesLastFrame = m_Head;
+	m_WindowBytes += m_Head;
+
+	auto now = std::chrono::steady_clock::now();
+	float seconds = std::chrono::duration<float>(now - m_WindowStart).count();
+	if (seconds >= 0.5f)
+	{
+		m_Stats.uploadMBPerSecond = (m_WindowBytes / (1024.0f * 1024.0f)) / seconds;
+		m_WindowBytes = 0;
+		m_WindowStart = now;
+	}
+
+	m_Region = (m_Region + 1) % REGION_COUNT;
+	WaitForRegion(m_Region);
+
+	m_Head = 0;
+	m_InFrame = true;
+}
+
+StreamingBuffer::Allocation StreamingBuffer::Allocate(unsigned int bytes, unsigned int alignment)
+{
+	Allocation allocation;
+
+	if (!m_InFrame)
+		BeginFrame();
+
+	// Region starts are not necessarily a multiple of the alignment, so
+	// align the absolute offset rather than the offset within the region.
+	const unsigned int regionStart = m_Region * m_RegionSize;
+	unsigned int offset = regionStart + m_Head;
+	if (alignment > 1)
+		offset = (offset + alignment - 1) / alignment * alignment;
+
+	if (offset + bytes > regionStart + m_RegionSize)
+		return allocation;
+
+	allocation.ptr = m_Mapped + offset;
+	allocation.offset = offset;
+	allocation.size = bytes;
+	m_Head = offset + bytes - regionStart;
+	m_Stats.totalBytes += bytes;
+	return allocation;
+}
+
+void StreamingBuffer::Commit(const Allocation& allocation)
+{
+	// Coherent persistent mapping: the write is already visible.
+	if (m_Persistent || !allocation.ptr || allocation.size == 0)
+		return;
+
+	GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+	GlCall(glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, allocation.size, allocation.ptr));
+}
+
+void StreamingBuffer::EndFrame()
+{
+	if (!m_InFrame)
+		return;
+
+	// An empty frame leaves nothing for the GPU to read, so no fence needed.
+	if (m_Head > 0)
+		m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_InFrame = false;
+}
+
+void StreamingBuffer::Bind(GLenum target) const
+{
+	GlCall(glBindBuffer(target, m_RendererID));
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <GL/glew.h>
+#include <chrono>
+#include <vector>
+
+/**
+ * StreamingBuffer — per-frame dynamic data without upload stalls
+ *
+ * VertexBuffer::Update is glBufferSubData. If the GPU is still reading the
+ * buffer from the previous frame, the driver must either wait for it or
+ * take a hidden copy of the data. For geometry rewritten every frame (CPU
+ * particles) that can mean a stall every frame.
+ *
+ * A streaming buffer avoids that by never writing memory the GPU may still
+ * be reading:
+ *
+ *   +-----------+-----------+-----------+
+ *   | region 0  | region 1  | region 2  |     one buffer, REGION_COUNT regions
+ *   +-----------+-----------+-----------+
+ *     frame N     frame N+1   frame N+2
+ *
+ * Each frame writes into the next region. After the frame's draws, EndFrame
+ * inserts a fence (glFenceSync); before a region is reused REGION_COUNT
+ * frames later, BeginFrame waits on its fence. With three regions the GPU
+ * is normally done long before, so the wait costs nothing — the Stats show
+ * how long it actually took.
+ *
+ * PERSISTENT MAPPING (GL 4.4 / ARB_buffer_storage)
+ *
+ *   glBufferStorage with GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT lets
+ *   us map the buffer ONCE and keep the pointer forever. Allocate() just
+ *   hands out a pointer into the mapping: writes through it are visible to
+ *   the GPU with no glBufferSubData and no map/unmap per frame.
+ *
+ *   Our context is 4.3, so buffer storage is only there as an extension.
+ *   Without it the buffer falls back to a CPU staging copy that Commit()
+ *   uploads with glBufferSubData into the (fenced, idle) region.
+ *
+ * Usage:
+ *     stream.BeginFrame();
+ *     StreamingBuffer::Allocation a = stream.Allocate(bytes, stride);
+ *     memcpy(a.ptr, data, bytes);
+ *     stream.Commit(a);                        // no-op when persistent
+ *     ...draw using a.offset (e.g. baseVertex = a.offset / stride)...
+ *     stream.EndFrame();
+ */
+
+class StreamingBuffer
+{
+public:
+	static const unsigned int REGION_COUNT = 3;
+
+	struct Allocation
+	{
+		void*        ptr = nullptr;   // write the data here; nullptr if the region is full
+		unsigned int offset = 0;      // byte offset from the start of the buffer
+		unsigned int size = 0;
+	};
+
+	struct Stats
+	{
+		unsigned int bytesLastFrame = 0;
+		unsigned long long totalBytes = 0;     // everything ever allocated
+		float        uploadMBPerSecond = 0.0f;   // averaged over roughly half a second
+		float        fenceWaitMs = 0.0f;         // time BeginFrame spent waiting, last frame
+		unsigned int fenceStalls = 0;            // frames where the fence was not yet signalled
+	};
+
+	// regionSize is the most that can be allocated in one frame.
+	explicit StreamingBuffer(unsigned int regionSize);
+	~StreamingBuffer();
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+	// Move to the next region, waiting for the GPU to finish with it first.
+	void BeginFrame();
+
+	// Reserve `bytes` in the current region. The offset is rounded up to a
+	// multiple of `alignment` — pass the vertex stride so offset / stride is
+	// a whole baseVertex.
+	Allocation Allocate(unsigned int bytes, unsigned int alignment = 4);
+
+	// Make the written data visible to the GPU. Only does work on the
+	// fallback (non-persistent) path.
+	void Commit(const Allocation& allocation);
+
+	// Fence the current region. Call after the last draw that reads it.
+	void EndFrame();
+
+	void Bind(GLenum target) const;
+
+	bool IsPersistent() const { return m_Persistent; }
+	unsigned int GetID() const { return m_RendererID; }
+	unsigned int GetRegionSize() const { return m_RegionSize; }
+	const Stats& GetStats() const { return m_Stats; }
+
+private:
+	void WaitForRegion(unsigned int region);
+
+	unsigned int m_RendererID;
+	unsigned int m_RegionSize;
+	bool m_Persistent;
+
+	char* m_Mapped;                     // persistent mapping, or m_Staging on the fallback path
+	std::vector<char> m_Staging;
+
+	GLsync m_Fences[REGION_COUNT];
+	unsigned int m_Region;
+	unsigned int m_Head;                // bytes used in the current region
+	bool m_InFrame;
+
+	Stats m_Stats;
+	unsigned int m_WindowBytes;
+	std::chrono::steady_clock::time_point m_WindowStart;
+};
@@ -1,46 +1,252 @@
 #include "Texture.h"
+#include "TextureCooker.h"
+#include "TextureFile.h"
 #include "vendor/stb_image.h"
+#include "GLState.h"
+#include "GpuResources.h"
 
-Texture::Texture(const std::string& filepath):
-	m_RendererID(0), m_Filepath(filepath), m_Localbuffer(nullptr),width(0), height(0), bitsPerPixel(0)
-{
-	
-	stbi_set_flip_vertically_on_load(1);
+#include <algorithm>
+#include <atomic>
+#include <iostream>
 
-	m_Localbuffer = stbi_load(filepath.c_str(), &width, &height, &bitsPerPixel, 4);
+static float s_Anisotropy = 8.0f;
+static float s_MaxAnisotropy = -1.0f;        // queried on first use
+static std::atomic<bool> s_UseCompressed(true);   // read by Decode on workers
+static std::size_t s_TotalMemory = 0;
+static unsigned int s_TextureCount = 0;
 
-	GlCall(glGenTextures(1, &m_RendererID));
-	GlCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+// Levels in a full chain down to 1x1
+static int MipCount(int width, int height)
+{
+	int levels = 1;
+	for (int size = std::max(width, height); size > 1; size /= 2)
+		levels++;
+	return levels;
+}
 
-	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+// Sampling state for the bound texture with `levels` mip levels: trilinear
+// when there is a chain, plus the current anisotropy. MAX_LEVEL also drops
+// whatever an earlier definition of the same texture object set.
+static void SetSampling(int levels)
+{
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0));
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1));
+	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
 	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
 	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE ));
 	GlCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE));
 
-	GlCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_Localbuffer));
+	if (Texture::GetMaxAnisotropy() > 1.0f)
+	{
+		GlCall(glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, Texture::GetAnisotropy()));
+	}
+}
+
+void Texture::Image::Free::operator()(unsigned char* pixels) const
+{
+	stbi_image_free(pixels);
+}
 
-	GlCall(glBindTexture(GL_TEXTURE_2D, 0));
+std::size_t Texture::Image::GetDataSize() const
+{
+	if (compressedFormat)
+		return compressed.size();
+	return pixels ? static_cast<std::size_t>(width) * height * 4 : 0;
+}
 
+Texture::Image Texture::Decode(const std::string& filepath)
+{
+	Image image;
+	if (TextureFile::IsCompressedFile(filepath))
+	{
+		TextureFile::Load(filepath, image);
+		image.filepath = filepath;
+		return image;
+	}
 
-	if (m_Localbuffer)
+	// A cooked file replaces its source while it is not older than it
+	if (s_UseCompressed && TextureCooker::IsUpToDate(filepath)
+		&& TextureFile::Load(TextureCooker::GetCookedPath(filepath), image))
 	{
-		stbi_image_free(m_Localbuffer);
+		image.filepath = filepath;
+		return image;
 	}
+
+	// The per-thread flag, so decodes on several workers do not share it
+	stbi_set_flip_vertically_on_load_thread(1);
+
+	image.filepath = filepath;
+	image.pixels.reset(stbi_load(filepath.c_str(), &image.width, &image.height, &image.channels, 4));
+	return image;
+}
+
+Texture::Texture(const std::string& filepath)
+	: Texture(Decode(filepath))
+{
+}
+
+Texture::Texture(const Image& image):
+	m_RendererID(0), m_Filepath(image.filepath), width(0), height(0), bitsPerPixel(4), m_Streaming(false),
+	m_MemoryBytes(0), m_Format(GL_RGBA8), m_Levels(0), m_Handle(0)
+{
+	GlCall(glGenTextures(1, &m_RendererID));
+	s_TextureCount++;
+	Define(image, false);
+}
+
+Texture::Texture(const std::string& filepath, int width, int height, const unsigned char* rgba):
+	m_RendererID(0), m_Filepath(filepath), width(width), height(height), bitsPerPixel(4), m_Streaming(false),
+	m_MemoryBytes(0), m_Format(GL_RGBA8), m_Levels(0), m_Handle(0)
+{
+	GlCall(glGenTextures(1, &m_RendererID));
+	s_TextureCount++;
+	DefineRGBA(width, height, rgba);
 }
 
 Texture::~Texture()
 {
-	GlCall(glDeleteTextures(1, &m_RendererID));
+	s_TotalMemory -= m_MemoryBytes;
+	s_TextureCount--;
+	if (m_Handle)
+	{
+		GlCall(glMakeTextureHandleNonResidentARB(m_Handle));
+	}
+	GpuResources::Delete(GL_TEXTURE, m_RendererID);
 }
 
-void Texture::Bind(unsigned int slot) const
+void Texture::Define(const Image& image, bool fromUnpackBuffer)
 {
-	GlCall(glActiveTexture(GL_TEXTURE0+slot));
-	GlCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+	if (m_Handle)
+	{
+		std::cout << "Texture::Define() - \"" << m_Filepath << "\" has a bindless handle and cannot change\n";
+		return;
+	}
+
+	bitsPerPixel = image.channels;
+	if (!image.compressedFormat)
+	{
+		DefineRGBA(image.width, image.height, fromUnpackBuffer ? nullptr : image.pixels.get());
+		return;
+	}
+
+	width = image.width;
+	height = image.height;
 
+	GLState::BindTexture(GL_TEXTURE_2D, m_RendererID);
+	for (std::size_t level = 0; level < image.levels.size(); level++)
+	{
+		// With an unpack buffer bound the data argument is an offset into it
+		const Image::Level& mip = image.levels[level];
+		const void* data = fromUnpackBuffer
+			? reinterpret_cast<const void*>(mip.offset)
+			: static_cast<const void*>(image.compressed.data() + mip.offset);
+		GlCall(glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), image.compressedFormat,
+			mip.width, mip.height, 0, static_cast<GLsizei>(mip.size), data));
+	}
+
+	// A file may stop short of 1x1; sampling must not read the missing levels
+	SetSampling(static_cast<int>(image.levels.size()));
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
+
+	s_TotalMemory -= m_MemoryBytes;
+	m_MemoryBytes = image.compressed.size();
+	s_TotalMemory += m_MemoryBytes;
+	GpuMemory::TrackTexture(GpuMemory::Category::Texture, m_RendererID, m_MemoryBytes);
+	m_Format = image.compressedFormat;
+	m_Levels = static_cast<int>(image.levels.size());
+}
+
+void Texture::DefineRGBA(int width, int height, const void* data)
+{
+	this->width = width;
+	this->height = height;
+
+	GLState::BindTexture(GL_TEXTURE_2D, m_RendererID);
+
+	// Every level glGenerateMipmap fills
+	const int levels = width > 0 && height > 0 ? MipCount(width, height) : 1;
+	SetSampling(levels);
+
+	GlCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data));
+	if (levels > 1)
+	{
+		GlCall(glGenerateMipmap(GL_TEXTURE_2D));
+	}
+
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
+
+	// The chain adds a third to the base level
+	std::size_t bytes = 0;
+	for (int level = 0, w = width, h = height; level < levels; level++, w = std::max(1, w / 2), h = std::max(1, h / 2))
+		bytes += static_cast<std::size_t>(w) * h * 4;
+
+	s_TotalMemory -= m_MemoryBytes;
+	m_MemoryBytes = bytes;
+	s_TotalMemory += m_MemoryBytes;
+	GpuMemory::TrackTexture(GpuMemory::Category::Texture, m_RendererID, m_MemoryBytes);
+	m_Format = GL_RGBA8;
+	m_Levels = levels;
+}
+
+uint64_t Texture::GetBindlessHandle()
+{
+	if (!m_Handle && GLEW_ARB_bindless_texture)
+	{
+		GlCall(m_Handle = glGetTextureHandleARB(m_RendererID));
+		GlCall(glMakeTextureHandleResidentARB(m_Handle));
+	}
+	return m_Handle;
+}
+
+void Texture::SetAnisotropy(float anisotropy)
+{
+	s_Anisotropy = std::max(1.0f, anisotropy);
+}
+
+float Texture::GetAnisotropy()
+{
+	return std::min(s_Anisotropy, GetMaxAnisotropy());
+}
+
+float Texture::GetMaxAnisotropy()
+{
+	if (s_MaxAnisotropy < 0.0f)
+	{
+		s_MaxAnisotropy = 1.0f;
+		if (GLEW_VERSION_4_6 || GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic)
+		{
+			GlCall(glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &s_MaxAnisotropy));
+		}
+	}
+	return s_MaxAnisotropy;
+}
+
+void Texture::SetUseCompressed(bool enabled)
+{
+	s_UseCompressed = enabled;
+}
+
+bool Texture::GetUseCompressed()
+{
+	return s_UseCompressed;
+}
+
+std::size_t Texture::GetTotalMemory()
+{
+	return s_TotalMemory;
+}
+
+unsigned int Texture::GetTextureCount()
+{
+	return s_TextureCount;
+}
+
+void Texture::Bind(unsigned int slot) const
+{
+	GLState::BindTextureToUnit(slot, GL_TEXTURE_2D, m_RendererID);
 }
 
 void Texture::Unbind() const
 {
-	GlCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
 }
@@ -2,23 +2,115 @@
 
 
 #include "Renderer.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
 
+// Textures are uploaded with a full mip chain and trilinear + anisotropic
+// filtering. Without mips, a surface seen far away or at a grazing angle
+// (a big ground plane, a model across the room) reads texels scattered
+// across the whole image for neighbouring pixels: it shimmers, and the
+// texture cache misses on nearly every fetch.
+//
+// A PNG becomes GL_RGBA8 with glGenerateMipmap. A DDS or KTX2 file of
+// block-compressed data (BC1/BC3/BC5/BC7, see TextureFile.h) is uploaded
+// as stored, mips included: 4-8x less memory and bandwidth than RGBA8.
+// Decode prefers the cooked .dds next to a PNG (TextureCooker.h) when it
+// is at least as new, so cooking res/Textures once is enough.
 class Texture
 {
+public:
+	// An image decoded on the CPU, not yet on the GPU. Decoding touches no
+	// GL state, so Decode may run on a worker thread (see ThreadPool.h);
+	// the Texture constructor then uploads it on the GL thread.
+	struct Image
+	{
+		struct Free { void operator()(unsigned char* pixels) const; };
+
+		// One mip level of `compressed`
+		struct Level
+		{
+			int width, height;
+			std::size_t offset, size;
+		};
+
+		std::string filepath;
+		int width = 0, height = 0, channels = 0;   // channels in the file; pixels are always 4
+
+		// stb_image's RGBA8 pixels, or...
+		std::unique_ptr<unsigned char, Free> pixels;
+
+		// ...precompressed data: every mip level back to back, in
+		// compressedFormat (a GL_COMPRESSED_* internal format)
+		unsigned int compressedFormat = 0;
+		std::vector<Level> levels;
+		std::vector<unsigned char> compressed;
+
+		bool IsValid() const { return pixels || !levels.empty(); }
+		const unsigned char* GetData() const { return compressedFormat ? compressed.data() : pixels.get(); }
+		std::size_t GetDataSize() const;   // bytes GetData() points at
+	};
+
+	static Image Decode(const std::string& filepath);
+
+	// Maximum anisotropy for textures created from now on; 1 turns it off.
+	// Clamped to what the driver supports (GetMaxAnisotropy, 1 without
+	// EXT/ARB_texture_filter_anisotropic).
+	static void SetAnisotropy(float anisotropy);
+	static float GetAnisotropy();
+	static float GetMaxAnisotropy();
+
+	// Whether Decode uses cooked .dds files in place of their sources.
+	static void SetUseCompressed(bool enabled);
+	static bool GetUseCompressed();
+
+	// GPU memory of every live Texture, mips included.
+	static std::size_t GetTotalMemory();
+	static unsigned int GetTextureCount();
+
 private:
+	friend class TextureStreamer;   // swaps in the real image, see TextureStreamer.h
+
 	unsigned int m_RendererID;
 	std::string m_Filepath;
-	unsigned char* m_Localbuffer;
 	int width, height, bitsPerPixel;
+	bool m_Streaming;
+	std::size_t m_MemoryBytes;
+	unsigned int m_Format;          // GL internal format
+	int m_Levels;                   // mip levels defined
+	uint64_t m_Handle;              // bindless handle, 0 until requested
+
+	// Define the texture's storage and sampling from an image. With
+	// fromUnpackBuffer, the data is read from the bound GL_PIXEL_UNPACK_BUFFER
+	// (laid out like image.GetData()) instead of from the image.
+	void Define(const Image& image, bool fromUnpackBuffer);
+	void DefineRGBA(int width, int height, const void* data);
 public:
 	Texture(const std::string& filepath);
+	explicit Texture(const Image& image);
+	// RGBA8 pixels from memory; filepath only names the texture
+	Texture(const std::string& filepath, int width, int height, const unsigned char* rgba);
 	~Texture();
 
+	// False while TextureStreamer still shows a placeholder in its place
+	bool IsLoaded() const { return !m_Streaming; }
+	bool IsCompressed() const { return m_Format != GL_RGBA8; }
+	std::size_t GetMemoryBytes() const { return m_MemoryBytes; }
+	unsigned int GetFormat() const { return m_Format; }
+	int GetLevelCount() const { return m_Levels; }
+
+	// ARB_bindless_texture handle, made resident on first call and until the
+	// Texture is destroyed. The texture's storage and sampling are frozen
+	// from then on, so only ask once it IsLoaded.
+	uint64_t GetBindlessHandle();
+
 	void Bind( unsigned int slot = 0) const;
 	void Unbind() const;
 
+	unsigned int GetID() const { return m_RendererID; }
+
 	int getWidth() const { return this->width; };
 	int getHeight() const { return this->height; };
 
 	glm::vec2 getTexelSize() const { return glm::vec2(1.0f / width, 1.0f / height); }
-};
\ No newline at end of file
+};
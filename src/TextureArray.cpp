@@ -0,0 +1,178 @@
+#include "TextureArray.h"
+#include "TextureFile.h"
+#include "GLState.h"
+#include "GpuResources.h"
+
+#include <algorithm>
+#include <iostream>
+
+static int MipCount(int width, int height)
+{
+	int levels = 1;
+	for (int size = std::max(width, height); size > 1; size /= 2)
+		levels++;
+	return levels;
+}
+
+static std::size_t LevelBytes(unsigned int format, int width, int height)
+{
+	if (format == GL_RGBA8)
+		return static_cast<std::size_t>(width) * height * 4;
+	return TextureFile::GetLevelSize(format, width, height);
+}
+
+TextureArray::~TextureArray()
+{
+	Release();
+}
+
+void TextureArray::Allocate(int width, int height, int layers, unsigned int format, int levels)
+{
+	Release();
+	m_Width = width;
+	m_Height = height;
+	m_Layers = layers;
+	m_Levels = levels;
+	m_Format = format;
+
+	GlCall(glGenTextures(1, &m_RendererID));
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, m_RendererID);
+	GlCall(glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, format, width, height, layers));
+	GpuResources::TextureDesc desc;
+	desc.width = width;
+	desc.height = height;
+	desc.format = format;
+	desc.levels = levels;
+	desc.target = GL_TEXTURE_2D_ARRAY;
+	desc.layers = layers;
+	GpuMemory::TrackTexture(GpuMemory::Category::Texture, m_RendererID, GpuResources::GetTextureBytes(desc));
+	GlCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+	GlCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GlCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GlCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	if (Texture::GetMaxAnisotropy() > 1.0f)
+	{
+		GlCall(glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, Texture::GetAnisotropy()));
+	}
+
+	m_MemoryBytes = 0;
+	for (int level = 0, w = width, h = height; level < levels; level++, w = std::max(1, w / 2), h = std::max(1, h / 2))
+		m_MemoryBytes += LevelBytes(format, w, h) * layers;
+}
+
+bool TextureArray::Build(const std::vector<const Texture::Image*>& images)
+{
+	if (images.empty() || !images[0]->IsValid())
+		return false;
+
+	const Texture::Image& first = *images[0];
+	for (const Texture::Image* image : images)
+	{
+		if (!image->IsValid() || image->width != first.width || image->height != first.height
+			|| image->compressedFormat != first.compressedFormat || image->levels.size() != first.levels.size())
+		{
+			std::cout << "TextureArray::Build() - \"" << image->filepath << "\" differs in size or format from \""
+				<< first.filepath << "\"\n";
+			return false;
+		}
+	}
+
+	if (!first.compressedFormat)
+	{
+		std::vector<const unsigned char*> layers;
+		for (const Texture::Image* image : images)
+			layers.push_back(image->pixels.get());
+		return Build(first.width, first.height, layers);
+	}
+
+	Allocate(first.width, first.height, static_cast<int>(images.size()), first.compressedFormat,
+		static_cast<int>(first.levels.size()));
+	for (std::size_t layer = 0; layer < images.size(); layer++)
+	{
+		const Texture::Image& image = *images[layer];
+		for (std::size_t level = 0; level < image.levels.size(); level++)
+		{
+			const Texture::Image::Level& mip = image.levels[level];
+			GlCall(glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), 0, 0, static_cast<GLint>(layer),
+				mip.width, mip.height, 1, m_Format, static_cast<GLsizei>(mip.size), image.compressed.data() + mip.offset));
+		}
+	}
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return true;
+}
+
+bool TextureArray::Build(int width, int height, const std::vector<const unsigned char*>& rgbaLayers)
+{
+	if (rgbaLayers.empty() || width <= 0 || height <= 0)
+		return false;
+
+	const int levels = MipCount(width, height);
+	Allocate(width, height, static_cast<int>(rgbaLayers.size()), GL_RGBA8, levels);
+	for (std::size_t layer = 0; layer < rgbaLayers.size(); layer++)
+	{
+		GlCall(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer),
+			width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgbaLayers[layer]));
+	}
+
+	// One pass fills the chain of every layer
+	if (levels > 1)
+	{
+		GlCall(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
+	}
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return true;
+}
+
+bool TextureArray::Build(const std::vector<const Texture*>& textures)
+{
+	if (textures.empty())
+		return false;
+
+	const Texture& first = *textures[0];
+	int levels = first.GetLevelCount();
+	for (const Texture* texture : textures)
+	{
+		if (texture->getWidth() != first.getWidth() || texture->getHeight() != first.getHeight()
+			|| texture->GetFormat() != first.GetFormat())
+		{
+			std::cout << "TextureArray::Build() - textures differ in size or format\n";
+			return false;
+		}
+		levels = std::min(levels, texture->GetLevelCount());
+	}
+
+	Allocate(first.getWidth(), first.getHeight(), static_cast<int>(textures.size()), first.GetFormat(), levels);
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// GPU-side copies of every level, compressed blocks included
+	for (std::size_t layer = 0; layer < textures.size(); layer++)
+	{
+		int width = m_Width, height = m_Height;
+		for (int level = 0; level < levels; level++)
+		{
+			GlCall(glCopyImageSubData(textures[layer]->GetID(), GL_TEXTURE_2D, level, 0, 0, 0,
+				m_RendererID, GL_TEXTURE_2D_ARRAY, level, 0, 0, static_cast<GLint>(layer), width, height, 1));
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+	}
+	return true;
+}
+
+void TextureArray::Release()
+{
+	if (m_RendererID)
+	{
+		GlCall(glDeleteTextures(1, &m_RendererID));
+		GLState::OnTextureDeleted(m_RendererID);
+		m_RendererID = 0;
+	}
+	m_Width = m_Height = m_Layers = m_Levels = 0;
+	m_Format = 0;
+	m_MemoryBytes = 0;
+}
+
+void TextureArray::Bind(unsigned int slot) const
+{
+	GLState::BindTextureToUnit(slot, GL_TEXTURE_2D_ARRAY, m_RendererID);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "Texture.h"
+
+/**
+ * TextureArray — same-sized images as the layers of one GL_TEXTURE_2D_ARRAY
+ *
+ * A batch is one draw call only while nothing changes between its
+ * primitives, and a different Texture is a change: each is its own
+ * GL_TEXTURE_2D, bound to a unit the whole draw samples. An array texture
+ * holds many images behind one binding, and the shader picks the image per
+ * vertex with a layer index (texture(u_Array, vec3(uv, layer))). Quads with
+ * fifty different images can then still be one glDrawElements.
+ *
+ * Layers keep their own mips and may repeat (GL_REPEAT works per layer),
+ * unlike atlas regions (TextureAtlas.h). The price is that every layer has
+ * the same size, format and number of mip levels; Build refuses anything
+ * else rather than rescaling. Use an atlas for images of varying sizes.
+ *
+ * Three ways in:
+ *   Build(images)   decoded images (Texture::Decode), layer i = images[i].
+ *                   RGBA8 layers get their mips from glGenerateMipmap;
+ *                   compressed ones (all in one format) are uploaded as
+ *                   stored, every level.
+ *   Build(w, h, px) RGBA8 pixels from memory, one pointer per layer.
+ *   Build(textures) textures already on the GPU, copied with
+ *                   glCopyImageSubData, compressed blocks and mips included.
+ *                   The textures themselves are left untouched.
+ *
+ * GL thread only.
+ */
+class TextureArray
+{
+public:
+	TextureArray() = default;
+	~TextureArray();
+	TextureArray(const TextureArray&) = delete;
+	TextureArray& operator=(const TextureArray&) = delete;
+
+	bool Build(const std::vector<const Texture::Image*>& images);
+	bool Build(int width, int height, const std::vector<const unsigned char*>& rgbaLayers);
+	bool Build(const std::vector<const Texture*>& textures);
+
+	// Deletes the array; Build again to reuse the object
+	void Release();
+
+	void Bind(unsigned int slot = 0) const;
+
+	bool IsValid() const { return m_RendererID != 0; }
+	unsigned int GetID() const { return m_RendererID; }
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+	int GetLayerCount() const { return m_Layers; }
+	int GetLevelCount() const { return m_Levels; }
+	unsigned int GetFormat() const { return m_Format; }
+	std::size_t GetMemoryBytes() const { return m_MemoryBytes; }
+
+private:
+	// Immutable storage and sampling for `layers` layers
+	void Allocate(int width, int height, int layers, unsigned int format, int levels);
+
+	unsigned int m_RendererID = 0;
+	int m_Width = 0, m_Height = 0;
+	int m_Layers = 0;
+	int m_Levels = 0;
+	unsigned int m_Format = 0;      // GL internal format
+	std::size_t m_MemoryBytes = 0;
+};
@@ -0,0 +1,184 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+TextureAtlas::TextureAtlas(int maxSize)
+	: m_MaxSize(maxSize)
+{
+}
+
+int TextureAtlas::Add(const std::string& name, int width, int height, const unsigned char* rgba)
+{
+	if (width <= 0 || height <= 0 || !rgba)
+		return -1;
+
+	Region region;
+	region.name = name;
+	region.width = width;
+	region.height = height;
+	m_Regions.push_back(region);
+	m_Pixels.emplace_back(rgba, rgba + static_cast<std::size_t>(width) * height * 4);
+	return static_cast<int>(m_Regions.size() - 1);
+}
+
+int TextureAtlas::Add(const Texture::Image& image)
+{
+	if (!image.pixels)
+	{
+		std::cout << "TextureAtlas::Add() - \"" << image.filepath << "\" is compressed or not loaded\n";
+		return -1;
+	}
+	return Add(image.filepath, image.width, image.height, image.pixels.get());
+}
+
+bool TextureAtlas::Pack(int width, int height)
+{
+	std::vector<std::size_t> order(m_Regions.size());
+	std::iota(order.begin(), order.end(), std::size_t(0));
+	std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b)
+		{
+			return m_Regions[a].height > m_Regions[b].height;
+		});
+
+	int x = 0, y = 0, shelfHeight = 0;
+	for (std::size_t index : order)
+	{
+		Region& region = m_Regions[index];
+		const int paddedWidth = region.width + 2 * PADDING;
+		const int paddedHeight = region.height + 2 * PADDING;
+		if (paddedWidth > width)
+			return false;
+
+		if (x + paddedWidth > width)
+		{
+			y += shelfHeight;
+			x = 0;
+			shelfHeight = 0;
+		}
+		if (y + paddedHeight > height)
+			return false;
+
+		region.x = x + PADDING;
+		region.y = y + PADDING;
+		x += paddedWidth;
+		shelfHeight = std::max(shelfHeight, paddedHeight);
+	}
+	return true;
+}
+
+bool TextureAtlas::Build()
+{
+	m_Texture.reset();
+	m_Width = m_Height = 0;
+	if (m_Regions.empty())
+		return false;
+
+	int maxSize = 0;
+	GlCall(glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize));
+	if (m_MaxSize > 0)
+		maxSize = std::min(maxSize, m_MaxSize);
+
+	std::size_t area = 0;
+	for (const Region& region : m_Regions)
+		area += static_cast<std::size_t>(region.width + 2 * PADDING) * (region.height + 2 * PADDING);
+
+	// A start past maxSize would pack without ever reaching the check
+	// below; at maxSize an area too large fails to pack and is reported
+	int width = 1;
+	while (static_cast<std::size_t>(width) * width < area)
+		width *= 2;
+	width = std::min(width, maxSize);
+	int height = width;
+
+	// Grow the short side first, so the atlas stays close to square
+	while (!Pack(width, height))
+	{
+		if (width <= height)
+			width *= 2;
+		else
+			height *= 2;
+		if (width > maxSize || height > maxSize)
+		{
+			std::cout << "TextureAtlas::Build() - " << m_Regions.size() << " image(s) do not fit "
+				<< maxSize << "x" << maxSize << "\n";
+			return false;
+		}
+	}
+
+	// Copy each image, then extend its border rows and columns into the padding
+	std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * 4, 0);
+	for (std::size_t r = 0; r < m_Regions.size(); r++)
+	{
+		const Region& region = m_Regions[r];
+		const unsigned char* source = m_Pixels[r].data();
+		for (int row = -PADDING; row < region.height + PADDING; row++)
+		{
+			const int sourceRow = std::min(std::max(row, 0), region.height - 1);
+			const unsigned char* sourceLine = source + static_cast<std::size_t>(sourceRow) * region.width * 4;
+			unsigned char* line = pixels.data() + (static_cast<std::size_t>(region.y + row) * width + region.x) * 4;
+
+			std::memcpy(line, sourceLine, static_cast<std::size_t>(region.width) * 4);
+			for (int column = 1; column <= PADDING; column++)
+			{
+				std::memcpy(line - column * 4, sourceLine, 4);
+				std::memcpy(line + (region.width - 1 + column) * 4, sourceLine + (region.width - 1) * 4, 4);
+			}
+		}
+	}
+
+	for (Region& region : m_Regions)
+	{
+		region.uvOffset = glm::vec2(static_cast<float>(region.x) / width, static_cast<float>(region.y) / height);
+		region.uvScale = glm::vec2(static_cast<float>(region.width) / width, static_cast<float>(region.height) / height);
+	}
+
+	m_Width = width;
+	m_Height = height;
+	m_Texture = std::make_shared<Texture>("atlas", width, height, pixels.data());
+	std::cout << "TextureAtlas::Build() - " << m_Regions.size() << " image(s) in " << width << "x" << height
+		<< " (" << static_cast<int>(GetOccupancy() * 100.0f) << "% used)\n";
+	return true;
+}
+
+void TextureAtlas::Clear()
+{
+	m_Regions.clear();
+	m_Pixels.clear();
+	m_Texture.reset();
+	m_Width = m_Height = 0;
+}
+
+int TextureAtlas::Find(const std::string& name) const
+{
+	for (std::size_t r = 0; r < m_Regions.size(); r++)
+	{
+		if (m_Regions[r].name == name)
+			return static_cast<int>(r);
+	}
+	return -1;
+}
+
+void TextureAtlas::RemapUVs(int index, float* vertices, std::size_t count, std::size_t stride, std::size_t uvOffset) const
+{
+	for (std::size_t v = 0; v < count; v++)
+	{
+		float* uv = vertices + v * stride + uvOffset;
+		const glm::vec2 remapped = Remap(index, glm::vec2(uv[0], uv[1]));
+		uv[0] = remapped.x;
+		uv[1] = remapped.y;
+	}
+}
+
+float TextureAtlas::GetOccupancy() const
+{
+	if (!m_Width || !m_Height)
+		return 0.0f;
+
+	std::size_t used = 0;
+	for (const Region& region : m_Regions)
+		used += static_cast<std::size_t>(region.width) * region.height;
+	return static_cast<float>(used) / (static_cast<float>(m_Width) * m_Height);
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Texture.h"
+
+/**
+ * TextureAtlas — images of any size packed into one Texture
+ *
+ * The counterpart of TextureArray (TextureArray.h) for images that do not
+ * share a size: sprites, UI icons, the small textures of a kit of props.
+ * Add collects RGBA8 images on the CPU, Build packs them into rectangles of
+ * one power-of-two texture and uploads it, and every image gets a Region:
+ * where it ended up, in texels and in UV space. Geometry that sampled the
+ * image with uv in [0,1] samples the atlas with Remap(region, uv) instead,
+ * so anything drawn from one atlas can share a batch, whatever its image.
+ * Remap at import time (RemapUVs over the vertex data), not per frame.
+ *
+ * PACKING
+ *   Shelves: images sorted by height, placed left to right in rows as high
+ *   as their first image. Build starts at the smallest power-of-two size
+ *   whose area could hold everything and grows, width then height, until
+ *   the shelves fit or GetMaxSize is reached.
+ *
+ * BLEEDING
+ *   Bilinear filtering and mips average neighbouring texels, which near a
+ *   region's edge belong to another image. Each image is surrounded by
+ *   PADDING texels copied from its own border, which keeps the first
+ *   log2(PADDING) mip levels clean; beyond that the smallest mips blend
+ *   neighbours. Regions cannot repeat (GL_REPEAT would wrap the whole
+ *   atlas): use a TextureArray for tiling textures.
+ *
+ * Build runs on the GL thread; Add does not touch GL.
+ */
+class TextureAtlas
+{
+public:
+	static const int PADDING = 4;
+
+	struct Region
+	{
+		std::string name;
+		int x = 0, y = 0, width = 0, height = 0;   // texels, padding excluded
+		glm::vec2 uvOffset = glm::vec2(0.0f);       // atlas uv = uvOffset + uv * uvScale
+		glm::vec2 uvScale = glm::vec2(1.0f);
+	};
+
+	// maxSize 0 means GL_MAX_TEXTURE_SIZE
+	explicit TextureAtlas(int maxSize = 4096);
+
+	// Copies the pixels (rows bottom-up, as Texture::Decode returns them)
+	// and returns the image's region index, valid after Build.
+	int Add(const std::string& name, int width, int height, const unsigned char* rgba);
+	// -1 for an image Decode returned compressed or failed to load: blocks
+	// cannot be repacked, so cook the atlas instead of its sources
+	int Add(const Texture::Image& image);
+
+	// Packs and uploads everything added so far. False, with no texture,
+	// when the images do not fit GetMaxSize.
+	bool Build();
+
+	// Forgets every image and the texture
+	void Clear();
+
+	std::size_t GetRegionCount() const { return m_Regions.size(); }
+	const Region& GetRegion(int index) const { return m_Regions[index]; }
+	int Find(const std::string& name) const;    // -1 when not added
+
+	glm::vec2 Remap(int index, const glm::vec2& uv) const
+	{
+		return m_Regions[index].uvOffset + uv * m_Regions[index].uvScale;
+	}
+
+	// Remaps `count` vertices in place: each `stride` floats long, its uv
+	// the two floats at `uvOffset`
+	void RemapUVs(int index, float* vertices, std::size_t count, std::size_t stride, std::size_t uvOffset) const;
+
+	const std::shared_ptr<Texture>& GetTexture() const { return m_Texture; }
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+	int GetMaxSize() const { return m_MaxSize; }
+
+	// Fraction of the atlas covered by images, padding excluded
+	float GetOccupancy() const;
+
+private:
+	// Shelf-packs every region (sorted tallest first) into width x height
+	bool Pack(int width, int height);
+
+	std::vector<Region> m_Regions;
+	std::vector<std::vector<unsigned char>> m_Pixels;   // per region, RGBA8
+	std::shared_ptr<Texture> m_Texture;
+	int m_Width = 0, m_Height = 0;
+	int m_MaxSize;
+};
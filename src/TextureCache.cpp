@@ -0,0 +1,145 @@
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+
+#include <cstdio>
+#include <filesystem>
+
+static std::unique_ptr<TextureCache> s_Cache;
+
+std::string TextureCache::MakeKey(const std::string& filepath)
+{
+	// weakly_canonical also resolves paths that do not exist (yet), so a
+	// missing file still gets one key and fails once, not once per caller
+	std::error_code error;
+	std::filesystem::path path = std::filesystem::weakly_canonical(filepath, error);
+	if (error)
+		path = std::filesystem::path(filepath).lexically_normal();
+
+	char settings[32];
+	std::snprintf(settings, sizeof(settings), "|af%.0f|%s", Texture::GetAnisotropy(),
+		Texture::GetUseCompressed() ? "bc" : "rgba");
+	return path.generic_string() + settings;
+}
+
+void TextureCache::Retain(const std::string& key, Entry& entry, const std::shared_ptr<Texture>& texture)
+{
+	if (entry.retained)
+		m_LRU.erase(entry.lru);
+	m_LRU.push_front(key);
+	entry.lru = m_LRU.begin();
+	entry.retained = texture;
+}
+
+std::shared_ptr<Texture> TextureCache::Find(const std::string& filepath)
+{
+	const std::string key = MakeKey(filepath);
+	auto it = m_Entries.find(key);
+	if (it == m_Entries.end())
+		return nullptr;
+
+	std::shared_ptr<Texture> texture = it->second.texture.lock();
+	if (!texture)
+		return nullptr;
+
+	Retain(key, it->second, texture);
+	m_Hits++;
+	return texture;
+}
+
+std::shared_ptr<Texture> TextureCache::Load(const std::string& filepath)
+{
+	if (std::shared_ptr<Texture> texture = Find(filepath))
+		return texture;
+
+	m_Misses++;
+	std::shared_ptr<Texture> texture = TextureStreamer::IsEnabled()
+		? TextureStreamer::Get().Load(filepath)
+		: std::make_shared<Texture>(filepath);
+	Insert(filepath, texture);
+	return texture;
+}
+
+void TextureCache::Insert(const std::string& filepath, const std::shared_ptr<Texture>& texture)
+{
+	const std::string key = MakeKey(filepath);
+	Entry& entry = m_Entries[key];
+	entry.texture = texture;
+	Retain(key, entry, texture);
+	Trim();
+}
+
+void TextureCache::SetBudget(std::size_t bytes)
+{
+	m_Budget = bytes;
+	Trim();
+}
+
+void TextureCache::Trim()
+{
+	std::size_t retainedBytes = 0;
+	for (const std::string& key : m_LRU)
+		retainedBytes += m_Entries[key].retained->GetMemoryBytes();
+
+	while (retainedBytes > m_Budget && !m_LRU.empty())
+	{
+		Entry& entry = m_Entries[m_LRU.back()];
+		retainedBytes -= entry.retained->GetMemoryBytes();
+		entry.retained.reset();
+		m_LRU.pop_back();
+	}
+
+	for (auto it = m_Entries.begin(); it != m_Entries.end();)
+	{
+		if (!it->second.retained && it->second.texture.expired())
+			it = m_Entries.erase(it);
+		else
+			++it;
+	}
+}
+
+void TextureCache::ReleaseUnused()
+{
+	for (const std::string& key : m_LRU)
+		m_Entries[key].retained.reset();
+	m_LRU.clear();
+	Trim();
+}
+
+TextureCache::Stats TextureCache::GetStats() const
+{
+	Stats stats;
+	stats.hits = m_Hits;
+	stats.misses = m_Misses;
+	for (const auto& [key, entry] : m_Entries)
+	{
+		const std::shared_ptr<Texture> texture = entry.texture.lock();
+		if (!texture)
+			continue;
+
+		stats.entries++;
+		stats.residentBytes += texture->GetMemoryBytes();
+		if (entry.retained)
+		{
+			stats.retained++;
+			stats.retainedBytes += texture->GetMemoryBytes();
+		}
+	}
+	return stats;
+}
+
+TextureCache& TextureCache::Get()
+{
+	if (!s_Cache)
+		s_Cache = std::make_unique<TextureCache>();
+	return *s_Cache;
+}
+
+bool TextureCache::IsAlive()
+{
+	return s_Cache != nullptr;
+}
+
+void TextureCache::Shutdown()
+{
+	s_Cache.reset();
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "Texture.h"
+
+/**
+ * TextureCache — one Texture per image file, shared by the whole process
+ *
+ * Every Model, and every test that draws an image file, gets its Textures
+ * from Load. Two models using the same image, the same model loaded twice,
+ * or testTexture2D and testEffects both showing res/Textures/1.png, all
+ * share one GPU texture instead of uploading copies.
+ *
+ * KEY
+ *   The canonical path (so "res/Textures/1.png" and "./res/Textures/../
+ *   Textures/1.png" match) plus what a Texture fixes when it is created:
+ *   the anisotropy and whether cooked .dds files are used (see Texture.h).
+ *   After changing either, loads create new Textures with the new settings;
+ *   ones already in use keep theirs.
+ *
+ * LIFETIME
+ *   Entries hold weak_ptrs, so the cache never decides when a texture in
+ *   use is freed: its users do. On top of that the most recently loaded
+ *   textures are retained (a strong reference, in LRU order) up to
+ *   GetBudget() bytes of GPU memory, so that switching away from a test
+ *   and back does not reload its images. Least recently used textures are
+ *   released first once retained memory exceeds the budget; a released
+ *   texture that someone still holds stays alive and stays findable.
+ *
+ * Load streams through TextureStreamer when it is enabled, like Model did
+ * before. GL thread only. Shutdown drops the retained textures and must
+ * run before the GL context is destroyed.
+ */
+class TextureCache
+{
+public:
+	static const std::size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+	struct Stats
+	{
+		unsigned int entries = 0;         // keys with a live Texture
+		unsigned int retained = 0;        // of those, kept alive by the LRU
+		std::size_t residentBytes = 0;    // GPU memory of every live entry
+		std::size_t retainedBytes = 0;
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+	};
+
+	TextureCache() = default;
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// The cached Texture for filepath, created (streamed or loaded) on a miss
+	std::shared_ptr<Texture> Load(const std::string& filepath);
+
+	// The cached Texture if one is alive, without creating it
+	std::shared_ptr<Texture> Find(const std::string& filepath);
+
+	// Adds a Texture made elsewhere (Model decodes on its own workers)
+	void Insert(const std::string& filepath, const std::shared_ptr<Texture>& texture);
+
+	std::size_t GetBudget() const { return m_Budget; }
+	void SetBudget(std::size_t bytes);
+
+	// Releases least recently used textures until the retained ones fit
+	// the budget, and forgets entries whose Texture is gone. Load and
+	// SetBudget call it; a streamed texture only reaches its full size
+	// later, so the budget may be exceeded until the next Load.
+	void Trim();
+
+	// Releases every retained texture; ones still in use stay cached
+	void ReleaseUnused();
+
+	Stats GetStats() const;
+
+	static TextureCache& Get();
+	static bool IsAlive();
+	static void Shutdown();
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<Texture> texture;
+		std::shared_ptr<Texture> retained;      // set while in m_LRU
+		std::list<std::string>::iterator lru;
+	};
+
+	static std::string MakeKey(const std::string& filepath);
+	void Retain(const std::string& key, Entry& entry, const std::shared_ptr<Texture>& texture);
+
+	std::unordered_map<std::string, Entry> m_Entries;
+	std::list<std::string> m_LRU;              // retained keys, most recent first
+
+	std::size_t m_Budget = DEFAULT_BUDGET;
+	unsigned int m_Hits = 0;
+	unsigned int m_Misses = 0;
+};
@@ -0,0 +1,338 @@
+#include "TextureCooker.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+#include "vendor/stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	struct Colour
+	{
+		int r, g, b;
+	};
+
+	uint16_t To565(const Colour& c)
+	{
+		return static_cast<uint16_t>(((c.r * 31 + 127) / 255) << 11 | ((c.g * 63 + 127) / 255) << 5 | ((c.b * 31 + 127) / 255));
+	}
+
+	Colour From565(uint16_t v)
+	{
+		const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+		return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+	}
+
+	int Distance(const Colour& a, const unsigned char* pixel)
+	{
+		const int dr = a.r - pixel[0], dg = a.g - pixel[1], db = a.b - pixel[2];
+		return dr * dr + dg * dg + db * db;
+	}
+
+	// The 16 RGBA pixels of the block at (bx, by), edges clamped for levels
+	// smaller than a block
+	void GatherBlock(const unsigned char* pixels, int width, int height, int bx, int by, unsigned char block[16][4])
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			const int sy = std::min(by * 4 + y, height - 1);
+			for (int x = 0; x < 4; x++)
+			{
+				const int sx = std::min(bx * 4 + x, width - 1);
+				std::memcpy(block[y * 4 + x], pixels + (static_cast<std::size_t>(sy) * width + sx) * 4, 4);
+			}
+		}
+	}
+
+	// 8 bytes: two 565 endpoints, then 2 bits per pixel. color0 > color1
+	// selects the four-colour mode, which BC3 always uses anyway.
+	void EncodeColour(const unsigned char block[16][4], unsigned char* out)
+	{
+		Colour lo = { 255, 255, 255 }, hi = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			lo = { std::min(lo.r, int(block[i][0])), std::min(lo.g, int(block[i][1])), std::min(lo.b, int(block[i][2])) };
+			hi = { std::max(hi.r, int(block[i][0])), std::max(hi.g, int(block[i][1])), std::max(hi.b, int(block[i][2])) };
+		}
+
+		// Pull the endpoints in by 1/16 of the range: the box corners are
+		// rarely the best endpoints, and the interpolated colours land
+		// closer to the pixels this way
+		const Colour inset = { (hi.r - lo.r) / 16, (hi.g - lo.g) / 16, (hi.b - lo.b) / 16 };
+		hi = { hi.r - inset.r, hi.g - inset.g, hi.b - inset.b };
+		lo = { lo.r + inset.r, lo.g + inset.g, lo.b + inset.b };
+
+		uint16_t c0 = To565(hi), c1 = To565(lo);
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		uint32_t indices = 0;
+		if (c0 != c1)
+		{
+			const Colour e0 = From565(c0), e1 = From565(c1);
+			const Colour palette[4] = {
+				e0, e1,
+				{ (2 * e0.r + e1.r) / 3, (2 * e0.g + e1.g) / 3, (2 * e0.b + e1.b) / 3 },
+				{ (e0.r + 2 * e1.r) / 3, (e0.g + 2 * e1.g) / 3, (e0.b + 2 * e1.b) / 3 },
+			};
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestDistance = Distance(palette[0], block[i]);
+				for (int p = 1; p < 4; p++)
+				{
+					const int distance = Distance(palette[p], block[i]);
+					if (distance < bestDistance)
+					{
+						best = p;
+						bestDistance = distance;
+					}
+				}
+				indices |= static_cast<uint32_t>(best) << (2 * i);
+			}
+		}
+
+		std::memcpy(out, &c0, 2);
+		std::memcpy(out + 2, &c1, 2);
+		std::memcpy(out + 4, &indices, 4);
+	}
+
+	// 8 bytes: two alpha endpoints, then 3 bits per pixel. alpha0 > alpha1
+	// selects eight interpolated values.
+	void EncodeAlpha(const unsigned char block[16][4], unsigned char* out)
+	{
+		int lo = 255, hi = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			lo = std::min(lo, int(block[i][3]));
+			hi = std::max(hi, int(block[i][3]));
+		}
+
+		uint64_t indices = 0;
+		if (hi != lo)
+		{
+			int palette[8] = { hi, lo };
+			for (int p = 1; p < 7; p++)
+				palette[p + 1] = ((7 - p) * hi + p * lo) / 7;
+
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0;
+				for (int p = 1; p < 8; p++)
+				{
+					if (std::abs(palette[p] - block[i][3]) < std::abs(palette[best] - block[i][3]))
+						best = p;
+				}
+				indices |= static_cast<uint64_t>(best) << (3 * i);
+			}
+		}
+
+		out[0] = static_cast<unsigned char>(hi);
+		out[1] = static_cast<unsigned char>(lo);
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+	}
+
+	// Half size, each texel the average of the (up to) four below it
+	std::vector<unsigned char> Downsample(const unsigned char* pixels, int width, int height)
+	{
+		const int w = std::max(1, width / 2), h = std::max(1, height / 2);
+		std::vector<unsigned char> result(static_cast<std::size_t>(w) * h * 4);
+		for (int y = 0; y < h; y++)
+		{
+			const int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			for (int x = 0; x < w; x++)
+			{
+				const int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				for (int c = 0; c < 4; c++)
+				{
+					const int sum = pixels[(static_cast<std::size_t>(y0) * width + x0) * 4 + c]
+						+ pixels[(static_cast<std::size_t>(y0) * width + x1) * 4 + c]
+						+ pixels[(static_cast<std::size_t>(y1) * width + x0) * 4 + c]
+						+ pixels[(static_cast<std::size_t>(y1) * width + x1) * 4 + c];
+					result[(static_cast<std::size_t>(y) * w + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+		return result;
+	}
+
+	std::size_t RGBAMipBytes(int width, int height)
+	{
+		std::size_t total = 0;
+		for (;;)
+		{
+			total += static_cast<std::size_t>(width) * height * 4;
+			if (width == 1 && height == 1)
+				return total;
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+	}
+
+	bool IsSourceImage(const std::filesystem::path& path)
+	{
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+	}
+}
+
+std::string TextureCooker::GetCookedPath(const std::string& sourcePath)
+{
+	return std::filesystem::path(sourcePath).replace_extension(".dds").string();
+}
+
+bool TextureCooker::IsUpToDate(const std::string& sourcePath)
+{
+	std::error_code error;
+	const auto cooked = std::filesystem::last_write_time(GetCookedPath(sourcePath), error);
+	if (error)
+		return false;
+	const auto source = std::filesystem::last_write_time(sourcePath, error);
+	return !error && cooked >= source;
+}
+
+Texture::Image TextureCooker::Compress(const Texture::Image& rgba)
+{
+	Texture::Image image;
+	image.filepath = rgba.filepath;
+	image.width = rgba.width;
+	image.height = rgba.height;
+	if (!rgba.pixels || rgba.width <= 0 || rgba.height <= 0)
+		return image;
+
+	const std::size_t texels = static_cast<std::size_t>(rgba.width) * rgba.height;
+	bool hasAlpha = false;
+	for (std::size_t i = 0; i < texels && !hasAlpha; i++)
+		hasAlpha = rgba.pixels.get()[i * 4 + 3] != 255;
+
+	image.channels = hasAlpha ? 4 : 3;
+	image.compressedFormat = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	const std::size_t blockBytes = TextureFile::GetBlockBytes(image.compressedFormat);
+
+	std::vector<unsigned char> level(rgba.pixels.get(), rgba.pixels.get() + texels * 4);
+	int width = rgba.width, height = rgba.height;
+	for (;;)
+	{
+		const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		const std::size_t offset = image.compressed.size();
+		image.compressed.resize(offset + static_cast<std::size_t>(blocksX) * blocksY * blockBytes);
+
+		unsigned char* out = image.compressed.data() + offset;
+		unsigned char block[16][4];
+		for (int by = 0; by < blocksY; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				GatherBlock(level.data(), width, height, bx, by, block);
+				if (hasAlpha)
+				{
+					EncodeAlpha(block, out);
+					out += 8;
+				}
+				EncodeColour(block, out);
+				out += 8;
+			}
+		}
+		image.levels.push_back({ width, height, offset, image.compressed.size() - offset });
+
+		if (width == 1 && height == 1)
+			break;
+		level = Downsample(level.data(), width, height);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return image;
+}
+
+bool TextureCooker::CookFile(const std::string& sourcePath, std::size_t& bytesBefore, std::size_t& bytesAfter)
+{
+	// Straight from stb_image rather than Texture::Decode, which would hand
+	// back the old cooked file. Flipped the same way, so the rows match.
+	stbi_set_flip_vertically_on_load_thread(1);
+
+	Texture::Image rgba;
+	rgba.filepath = sourcePath;
+	rgba.pixels.reset(stbi_load(sourcePath.c_str(), &rgba.width, &rgba.height, &rgba.channels, 4));
+	if (!rgba.pixels)
+		return false;
+
+	const Texture::Image compressed = Compress(rgba);
+	if (!TextureFile::WriteDDS(GetCookedPath(sourcePath), compressed))
+		return false;
+
+	bytesBefore = RGBAMipBytes(rgba.width, rgba.height);
+	bytesAfter = compressed.compressed.size();
+	return true;
+}
+
+TextureCooker::Result TextureCooker::CookDirectory(const std::string& directory, bool force)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	Result result;
+
+	struct Job
+	{
+		std::string path;
+		std::size_t bytesBefore = 0, bytesAfter = 0;
+		std::future<bool> cooked;
+	};
+	std::vector<Job> jobs;
+
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file() || !IsSourceImage(entry.path()))
+			continue;
+
+		result.files++;
+		const std::string path = entry.path().string();
+		if (!force && IsUpToDate(path))
+		{
+			result.skipped++;
+			continue;
+		}
+
+		Job job;
+		job.path = path;
+		jobs.push_back(std::move(job));
+	}
+
+	// Submitted once the vector has stopped growing, so the tasks' pointers
+	// into it stay valid
+	for (Job& job : jobs)
+	{
+		Job* target = &job;
+		job.cooked = ThreadPool::Get().Submit([target]() { return CookFile(target->path, target->bytesBefore, target->bytesAfter); });
+	}
+
+	for (Job& job : jobs)
+	{
+		if (job.cooked.get())
+		{
+			result.cooked++;
+			result.bytesBefore += job.bytesBefore;
+			result.bytesAfter += job.bytesAfter;
+		}
+		else
+		{
+			std::cout << "TextureCooker::CookDirectory() - failed to cook \"" << job.path << "\"\n";
+			result.failed++;
+		}
+	}
+
+	result.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "TextureCooker::CookDirectory() - \"" << directory << "\": " << result.cooked << " cooked, "
+		<< result.skipped << " up to date, " << result.failed << " failed, "
+		<< result.bytesBefore / 1024 << " KB -> " << result.bytesAfter / 1024 << " KB\n";
+	return result;
+}
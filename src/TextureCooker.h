@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+#include "Texture.h"
+
+/**
+ * TextureCooker — offline conversion of PNGs into BC1/BC3 DDS files
+ *
+ * CookDirectory("res/Textures") writes a .dds next to every image:
+ *
+ *   res/Textures/1.png  ->  res/Textures/1.dds
+ *
+ * with a full mip chain (box filtered) in BC1 when the image is opaque and
+ * BC3 when any pixel has alpha. Texture::Decode then loads the .dds in the
+ * PNG's place while it is at least as new as the PNG (see IsUpToDate), so a
+ * texture costs 0.5 (BC1) or 1 (BC3) byte per texel on the GPU instead of 4.
+ *
+ * The encoder is the simple, fast kind: each 4x4 block's endpoints are the
+ * corners of its colour bounding box, pulled in slightly, and each pixel
+ * takes the nearest of the four palette colours. Good enough for diffuse
+ * maps; sharp gradients and normal maps show block artifacts. BC5 and BC7
+ * are loaded (TextureFile) but not produced: use an external tool.
+ *
+ * Files are cooked on the ThreadPool, one task each.
+ */
+class TextureCooker
+{
+public:
+	struct Result
+	{
+		unsigned int files = 0;       // images found
+		unsigned int cooked = 0;
+		unsigned int skipped = 0;     // already up to date
+		unsigned int failed = 0;
+		std::size_t bytesBefore = 0;  // RGBA8 + mips, of the cooked files
+		std::size_t bytesAfter = 0;   // BCn + mips
+		float milliseconds = 0.0f;
+	};
+
+	// sourcePath with its extension replaced by .dds
+	static std::string GetCookedPath(const std::string& sourcePath);
+
+	// Whether the cooked file exists and is no older than sourcePath
+	static bool IsUpToDate(const std::string& sourcePath);
+
+	// Every .png/.jpg/.tga/.bmp in directory (not recursive). Up-to-date
+	// files are skipped unless force.
+	static Result CookDirectory(const std::string& directory, bool force = false);
+
+	// One file; sizes are GPU bytes with mips, before and after
+	static bool CookFile(const std::string& sourcePath, std::size_t& bytesBefore, std::size_t& bytesAfter);
+
+	// RGBA8 pixels with their mip chain, as BC1 (opaque) or BC3
+	static Texture::Image Compress(const Texture::Image& rgba);
+};
@@ -0,0 +1,367 @@
+#include "TextureFile.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	uint32_t ReadU32(const unsigned char* data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint64_t ReadU64(const unsigned char* data)
+	{
+		uint64_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	constexpr uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(static_cast<unsigned char>(a))
+			| (static_cast<uint32_t>(static_cast<unsigned char>(b)) << 8)
+			| (static_cast<uint32_t>(static_cast<unsigned char>(c)) << 16)
+			| (static_cast<uint32_t>(static_cast<unsigned char>(d)) << 24);
+	}
+
+	// DDS: "DDS " then a 124-byte DDS_HEADER, then a DDS_HEADER_DXT10 when
+	// the pixel format's FourCC is "DX10"
+	const uint32_t DDS_MAGIC            = FourCC('D', 'D', 'S', ' ');
+	const std::size_t DDS_HEADER_SIZE   = 124;
+	const std::size_t DDS_DX10_SIZE     = 20;
+	const uint32_t DDPF_FOURCC          = 0x4;
+
+	const uint32_t DDSD_CAPS            = 0x1;
+	const uint32_t DDSD_HEIGHT          = 0x2;
+	const uint32_t DDSD_WIDTH           = 0x4;
+	const uint32_t DDSD_PIXELFORMAT     = 0x1000;
+	const uint32_t DDSD_MIPMAPCOUNT     = 0x20000;
+	const uint32_t DDSD_LINEARSIZE      = 0x80000;
+	const uint32_t DDSCAPS_COMPLEX      = 0x8;
+	const uint32_t DDSCAPS_TEXTURE      = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP       = 0x400000;
+	const uint32_t DDS_DIMENSION_2D     = 3;
+
+	const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+	const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+	const uint32_t DXGI_FORMAT_BC5_UNORM = 83;
+	const uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+
+	// KTX2: a fixed 80-byte header, then one 24-byte entry per level
+	const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const std::size_t KTX2_HEADER_SIZE = 80;
+	const std::size_t KTX2_LEVEL_SIZE  = 24;
+
+	const uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK  = 131;
+	const uint32_t VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133;
+	const uint32_t VK_FORMAT_BC3_UNORM_BLOCK      = 137;
+	const uint32_t VK_FORMAT_BC5_UNORM_BLOCK      = 141;
+	const uint32_t VK_FORMAT_BC7_UNORM_BLOCK      = 145;
+
+	int ChannelsOf(unsigned int format)
+	{
+		return format == GL_COMPRESSED_RG_RGTC2 ? 2 : 4;
+	}
+
+	// Fills image.levels for a tightly packed chain starting at offset.
+	// False if the file is too short to hold it.
+	bool LayoutLevels(Texture::Image& image, unsigned int count, std::size_t offset, std::size_t fileSize)
+	{
+		int width = image.width, height = image.height;
+		for (unsigned int level = 0; level < count; level++)
+		{
+			const std::size_t size = TextureFile::GetLevelSize(image.compressedFormat, width, height);
+			if (offset + size > fileSize)
+				return false;
+
+			image.levels.push_back({ width, height, offset, size });
+			offset += size;
+
+			if (width == 1 && height == 1)
+				break;
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+		return true;
+	}
+
+	// Levels as offsets into the file become offsets into image.compressed
+	void CopyLevels(Texture::Image& image, const unsigned char* data)
+	{
+		std::size_t total = 0;
+		for (const Texture::Image::Level& level : image.levels)
+			total += level.size;
+
+		image.compressed.resize(total);
+		std::size_t offset = 0;
+		for (Texture::Image::Level& level : image.levels)
+		{
+			std::memcpy(image.compressed.data() + offset, data + level.offset, level.size);
+			level.offset = offset;
+			offset += level.size;
+		}
+	}
+}
+
+bool TextureFile::Load(const std::string& path, Texture::Image& image)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	Texture::Image loaded;
+	const std::string extension = std::filesystem::path(path).extension().string();
+	bool ok = false;
+	if (extension == ".dds" || extension == ".DDS")
+		ok = LoadDDS(file.GetData(), file.GetSize(), loaded);
+	else if (extension == ".ktx2" || extension == ".KTX2")
+		ok = LoadKTX2(file.GetData(), file.GetSize(), loaded);
+
+	if (!ok)
+	{
+		std::cout << "TextureFile::Load() - cannot read \"" << path << "\"\n";
+		return false;
+	}
+	if (!IsFormatSupported(loaded.compressedFormat))
+	{
+		std::cout << "TextureFile::Load() - \"" << path << "\" is in a format this GPU cannot sample\n";
+		return false;
+	}
+
+	loaded.filepath = path;
+	image = std::move(loaded);
+	return true;
+}
+
+bool TextureFile::LoadDDS(const unsigned char* data, std::size_t size, Texture::Image& image)
+{
+	if (size < 4 + DDS_HEADER_SIZE || ReadU32(data) != DDS_MAGIC)
+		return false;
+
+	const unsigned char* header = data + 4;
+	if (ReadU32(header) != DDS_HEADER_SIZE)
+		return false;
+
+	const int height = static_cast<int>(ReadU32(header + 8));
+	const int width = static_cast<int>(ReadU32(header + 12));
+	const uint32_t mipCount = ReadU32(header + 24);
+	const uint32_t pixelFlags = ReadU32(header + 76);
+	const uint32_t fourCC = ReadU32(header + 80);
+	if (width <= 0 || height <= 0 || !(pixelFlags & DDPF_FOURCC))
+		return false;
+
+	std::size_t offset = 4 + DDS_HEADER_SIZE;
+	unsigned int format = 0;
+	if (fourCC == FourCC('D', 'X', '1', '0'))
+	{
+		if (size < offset + DDS_DX10_SIZE)
+			return false;
+
+		const unsigned char* dx10 = data + offset;
+		const uint32_t dimension = ReadU32(dx10 + 4);
+		const uint32_t arraySize = ReadU32(dx10 + 12);
+		if (dimension != DDS_DIMENSION_2D || arraySize > 1)
+			return false;
+
+		switch (ReadU32(dx10))
+		{
+		case DXGI_FORMAT_BC1_UNORM: format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+		case DXGI_FORMAT_BC3_UNORM: format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+		case DXGI_FORMAT_BC5_UNORM: format = GL_COMPRESSED_RG_RGTC2; break;
+		case DXGI_FORMAT_BC7_UNORM: format = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+		default: return false;
+		}
+		offset += DDS_DX10_SIZE;
+	}
+	else if (fourCC == FourCC('D', 'X', 'T', '1'))
+		format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	else if (fourCC == FourCC('D', 'X', 'T', '5'))
+		format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	else if (fourCC == FourCC('A', 'T', 'I', '2') || fourCC == FourCC('B', 'C', '5', 'U'))
+		format = GL_COMPRESSED_RG_RGTC2;
+	else
+		return false;
+
+	image.width = width;
+	image.height = height;
+	image.channels = ChannelsOf(format);
+	image.compressedFormat = format;
+	if (!LayoutLevels(image, std::max(1u, mipCount), offset, size))
+		return false;
+
+	CopyLevels(image, data);
+	return true;
+}
+
+bool TextureFile::LoadKTX2(const unsigned char* data, std::size_t size, Texture::Image& image)
+{
+	if (size < KTX2_HEADER_SIZE || std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		return false;
+
+	const uint32_t vkFormat = ReadU32(data + 12);
+	const int width = static_cast<int>(ReadU32(data + 20));
+	const int height = static_cast<int>(ReadU32(data + 24));
+	const uint32_t depth = ReadU32(data + 28);
+	const uint32_t layers = ReadU32(data + 32);
+	const uint32_t faces = ReadU32(data + 36);
+	const uint32_t levelCount = std::max(1u, ReadU32(data + 40));
+	const uint32_t supercompression = ReadU32(data + 44);
+	if (width <= 0 || height <= 0 || depth > 1 || layers > 1 || faces != 1 || supercompression != 0)
+		return false;
+	if (size < KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_SIZE)
+		return false;
+
+	unsigned int format = 0;
+	switch (vkFormat)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+	case VK_FORMAT_BC3_UNORM_BLOCK:      format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+	case VK_FORMAT_BC5_UNORM_BLOCK:      format = GL_COMPRESSED_RG_RGTC2; break;
+	case VK_FORMAT_BC7_UNORM_BLOCK:      format = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+	default: return false;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.channels = ChannelsOf(format);
+	image.compressedFormat = format;
+
+	// Unlike DDS, every level has its own offset (level 0 is the largest,
+	// though it is stored last)
+	int levelWidth = width, levelHeight = height;
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		const unsigned char* entry = data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_SIZE;
+		const uint64_t offset = ReadU64(entry);
+		const uint64_t length = ReadU64(entry + 8);
+		const std::size_t expected = GetLevelSize(format, levelWidth, levelHeight);
+		if (length < expected || offset > size || length > size - offset)
+			return false;
+
+		image.levels.push_back({ levelWidth, levelHeight, static_cast<std::size_t>(offset), expected });
+		levelWidth = std::max(1, levelWidth / 2);
+		levelHeight = std::max(1, levelHeight / 2);
+	}
+
+	CopyLevels(image, data);
+	return true;
+}
+
+bool TextureFile::WriteDDS(const std::string& path, const Texture::Image& image)
+{
+	if (image.levels.empty() || GetBlockBytes(image.compressedFormat) == 0)
+		return false;
+
+	// BC1 and BC3 have legacy FourCCs every reader knows; BC5 and BC7 need DX10
+	uint32_t fourCC = FourCC('D', 'X', '1', '0');
+	uint32_t dxgiFormat = 0;
+	switch (image.compressedFormat)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: fourCC = FourCC('D', 'X', 'T', '1'); break;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: fourCC = FourCC('D', 'X', 'T', '5'); break;
+	case GL_COMPRESSED_RG_RGTC2:           dxgiFormat = DXGI_FORMAT_BC5_UNORM; break;
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:    dxgiFormat = DXGI_FORMAT_BC7_UNORM; break;
+	}
+
+	uint32_t header[1 + DDS_HEADER_SIZE / 4] = {};
+	header[0] = DDS_MAGIC;
+	header[1] = DDS_HEADER_SIZE;
+	header[2] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header[3] = static_cast<uint32_t>(image.height);
+	header[4] = static_cast<uint32_t>(image.width);
+	header[5] = static_cast<uint32_t>(image.levels[0].size);
+	header[7] = static_cast<uint32_t>(image.levels.size());
+	header[1 + 72 / 4] = 32;              // DDS_PIXELFORMAT.dwSize
+	header[1 + 76 / 4] = DDPF_FOURCC;
+	header[1 + 80 / 4] = fourCC;
+	header[1 + 104 / 4] = DDSCAPS_TEXTURE | (image.levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		if (dxgiFormat)
+		{
+			const uint32_t dx10[DDS_DX10_SIZE / 4] = { dxgiFormat, DDS_DIMENSION_2D, 0, 1, 0 };
+			file.write(reinterpret_cast<const char*>(dx10), sizeof(dx10));
+		}
+		for (const Texture::Image::Level& level : image.levels)
+			file.write(reinterpret_cast<const char*>(image.compressed.data() + level.offset), level.size);
+
+		if (!file)
+		{
+			file.close();
+			std::error_code ignored;
+			std::filesystem::remove(temporary, ignored);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+	{
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	return true;
+}
+
+bool TextureFile::IsCompressedFile(const std::string& path)
+{
+	const std::string extension = std::filesystem::path(path).extension().string();
+	return extension == ".dds" || extension == ".DDS" || extension == ".ktx2" || extension == ".KTX2";
+}
+
+std::size_t TextureFile::GetBlockBytes(unsigned int format)
+{
+	switch (format)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		return 8;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_RG_RGTC2:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+std::size_t TextureFile::GetLevelSize(unsigned int format, int width, int height)
+{
+	const std::size_t blocksX = static_cast<std::size_t>(std::max(1, (width + 3) / 4));
+	const std::size_t blocksY = static_cast<std::size_t>(std::max(1, (height + 3) / 4));
+	return blocksX * blocksY * GetBlockBytes(format);
+}
+
+bool TextureFile::IsFormatSupported(unsigned int format)
+{
+	switch (format)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return GLEW_EXT_texture_compression_s3tc;
+	case GL_COMPRESSED_RG_RGTC2:
+		return true;
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		return GLEW_VERSION_4_3 || GLEW_ARB_texture_compression_bptc;
+	default:
+		return false;
+	}
+}
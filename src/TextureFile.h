@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+#include "Texture.h"
+
+/**
+ * TextureFile — block-compressed images in DDS and KTX2 containers
+ *
+ * Loads a file's data into a Texture::Image exactly as stored, every mip
+ * level included, for glCompressedTexImage2D. Nothing is decoded: the GPU
+ * samples BCn blocks directly.
+ *
+ *   format  GL internal format                  bytes/4x4 block  use
+ *   BC1     GL_COMPRESSED_RGBA_S3TC_DXT1_EXT    8                opaque colour
+ *   BC3     GL_COMPRESSED_RGBA_S3TC_DXT5_EXT    16               colour + alpha
+ *   BC5     GL_COMPRESSED_RG_RGTC2              16               two channels (normal xy)
+ *   BC7     GL_COMPRESSED_RGBA_BPTC_UNORM       16               high quality colour
+ *
+ * RGBA8 is 64 bytes per 4x4 block, so BC1 is 8x smaller and the others 4x.
+ *
+ * DDS   legacy headers with FourCC DXT1, DXT5, ATI2 or BC5U, or a DX10
+ *       header with DXGI_FORMAT_BC1/BC3/BC5/BC7_UNORM.
+ * KTX2  vkFormat BC1/BC3/BC5/BC7 UNORM, one layer, one face, no
+ *       supercompression (Basis/zstd payloads need transcoding first).
+ *
+ * sRGB formats are rejected: the renderer treats every texture as linear
+ * data. Rows are uploaded in stored order, with the first row at t = 0,
+ * the same way Texture flips PNGs on load. TextureCooker writes its files
+ * that way round; files from other tools may need a vertical flip.
+ */
+class TextureFile
+{
+public:
+	// By extension: .dds or .ktx2. False, leaving image untouched, if the
+	// file is missing, malformed, in a format listed as unsupported above,
+	// or in one the driver cannot sample (IsFormatSupported).
+	static bool Load(const std::string& path, Texture::Image& image);
+
+	static bool LoadDDS(const unsigned char* data, std::size_t size, Texture::Image& image);
+	static bool LoadKTX2(const unsigned char* data, std::size_t size, Texture::Image& image);
+
+	// Writes a compressed image (one of the four formats) as DDS
+	static bool WriteDDS(const std::string& path, const Texture::Image& image);
+
+	// Whether path names a container Load reads (.dds or .ktx2)
+	static bool IsCompressedFile(const std::string& path);
+
+	// Bytes per 4x4 block, 0 for formats not listed above
+	static std::size_t GetBlockBytes(unsigned int format);
+
+	// Size of one mip level's data
+	static std::size_t GetLevelSize(unsigned int format, int width, int height);
+
+	// Whether the current GL context can sample format. BC5 and BC7 are
+	// core in GL 3.0 and 4.2; BC1 and BC3 need EXT_texture_compression_s3tc,
+	// which every desktop driver has.
+	static bool IsFormatSupported(unsigned int format);
+};
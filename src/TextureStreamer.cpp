@@ -0,0 +1,210 @@
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+#include <chrono>
+#include <cstring>
+
+static std::unique_ptr<TextureStreamer> s_Streamer;
+static bool s_Enabled = true;
+
+// Mid grey: reads as "untextured" under any lighting, without the flash a
+// white or magenta placeholder gives when the real image replaces it.
+static const unsigned char PLACEHOLDER_PIXEL[4] = { 128, 128, 128, 255 };
+
+TextureStreamer::TextureStreamer()
+	: m_FrameBudget(DEFAULT_FRAME_BUDGET)
+{
+	for (Slot& slot : m_Slots)
+	{
+		GlCall(glGenBuffers(1, &slot.buffer));
+	}
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	for (Slot& slot : m_Slots)
+	{
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		GlCall(glDeleteBuffers(1, &slot.buffer));
+		GLState::OnBufferDeleted(slot.buffer);
+	}
+}
+
+std::shared_ptr<Texture> TextureStreamer::Load(const std::string& filepath)
+{
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>(filepath, 1, 1, PLACEHOLDER_PIXEL);
+	texture->m_Streaming = true;
+
+	Decode decode;
+	decode.texture = texture;
+	decode.image = ThreadPool::Get().Submit([filepath]() { return Texture::Decode(filepath); });
+	m_Decoding.push_back(std::move(decode));
+
+	m_Stats.requested++;
+	return texture;
+}
+
+void TextureStreamer::Update()
+{
+	// Finished copies free their PBO; fences signal in order, but checking
+	// every slot is just as cheap
+	m_Stats.uploading = 0;
+	for (Slot& slot : m_Slots)
+	{
+		if (!slot.fence)
+			continue;
+
+		// Zero timeout: only asks. SwapBuffers has flushed the fence.
+		const GLenum state = glClientWaitSync(slot.fence, 0, 0);
+		if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+		{
+			m_Stats.uploading++;
+			continue;
+		}
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+		if (std::shared_ptr<Texture> texture = slot.texture.lock())
+			texture->m_Streaming = false;
+		slot.texture.reset();
+		m_Stats.completed++;
+	}
+
+	// Decodes that are done move to the upload queue, in the order they finish
+	for (std::size_t i = 0; i < m_Decoding.size();)
+	{
+		Decode& decode = m_Decoding[i];
+		if (decode.image.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			i++;
+			continue;
+		}
+
+		Upload upload;
+		upload.texture = decode.texture;
+		upload.image = decode.image.get();
+		if (!upload.image.IsValid())
+		{
+			if (std::shared_ptr<Texture> texture = upload.texture.lock())
+				texture->m_Streaming = false;
+			m_Stats.failed++;
+		}
+		else if (!upload.texture.expired())
+			m_Ready.push_back(std::move(upload));
+
+		m_Decoding[i] = std::move(m_Decoding.back());
+		m_Decoding.pop_back();
+	}
+
+	// Uploads, until the budget or the free PBOs run out
+	std::size_t bytes = 0;
+	while (!m_Ready.empty())
+	{
+		Upload& upload = m_Ready.front();
+		if (upload.texture.expired())
+		{
+			m_Ready.pop_front();
+			continue;
+		}
+
+		const std::size_t size = upload.image.GetDataSize();
+		if (bytes > 0 && bytes + size > m_FrameBudget)
+			break;
+
+		Slot* free = nullptr;
+		for (Slot& slot : m_Slots)
+		{
+			if (!slot.fence)
+			{
+				free = &slot;
+				break;
+			}
+		}
+		if (!free)
+			break;
+
+		if (StartUpload(*free, upload))
+		{
+			bytes += size;
+			m_Stats.uploading++;
+		}
+		m_Ready.pop_front();
+	}
+
+	m_Stats.bytesLastFrame = bytes;
+	m_Stats.bytesTotal += bytes;
+	m_Stats.decoding = static_cast<unsigned int>(m_Decoding.size());
+	m_Stats.queued = static_cast<unsigned int>(m_Ready.size());
+}
+
+bool TextureStreamer::StartUpload(Slot& slot, Upload& upload)
+{
+	std::shared_ptr<Texture> texture = upload.texture.lock();
+	if (!texture)
+		return false;
+
+	const Texture::Image& image = upload.image;
+	const std::size_t size = image.GetDataSize();
+
+	GlCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer));
+	if (slot.capacity < size)
+	{
+		GlCall(glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW));
+		GpuMemory::TrackBuffer(GpuMemory::Category::Staging, slot.buffer, size);
+		slot.capacity = size;
+	}
+
+	// The slot's fence has signalled, so the GPU is done with the old
+	// contents; INVALIDATE says they need not be kept either.
+	void* destination;
+	GlCall(destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	if (!destination)
+	{
+		GlCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+		return false;
+	}
+	std::memcpy(destination, image.GetData(), size);
+	GlCall(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+
+	// Redefining the placeholder's storage keeps the texture's GL name.
+	// Mips are generated (RGBA) or read from the buffer too (compressed).
+	texture->Define(image, true);
+
+	// Unbound again: other glTexImage2D calls expect client pointers
+	GlCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.texture = texture;
+	return true;
+}
+
+TextureStreamer& TextureStreamer::Get()
+{
+	if (!s_Streamer)
+		s_Streamer = std::make_unique<TextureStreamer>();
+	return *s_Streamer;
+}
+
+bool TextureStreamer::IsAlive()
+{
+	return s_Streamer != nullptr;
+}
+
+void TextureStreamer::Shutdown()
+{
+	s_Streamer.reset();
+}
+
+bool TextureStreamer::IsEnabled()
+{
+	return s_Enabled;
+}
+
+void TextureStreamer::SetEnabled(bool enabled)
+{
+	s_Enabled = enabled;
+}
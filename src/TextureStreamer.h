@@ -0,0 +1,119 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Texture.h"
+
+/**
+ * TextureStreamer — textures that load in the background
+ *
+ * new Texture(path) decodes the file and uploads it before returning, which
+ * stalls the frame for as long as stb_image takes: tens of milliseconds for
+ * a large PNG. Load returns straight away instead, with a Texture that
+ * shows a 1x1 placeholder, and the image follows a few frames later:
+ *
+ *   1. decode   Texture::Decode runs as a ThreadPool task.
+ *   2. upload   Update, on the GL thread, copies the pixels (or the BCn
+ *               blocks of a cooked file) into one of RING_SIZE pixel unpack
+ *               buffers (PBOs) and defines the texture with the PBO
+ *               bound. The driver then copies from the buffer to the
+ *               texture on its own time, instead of inside the call.
+ *   3. done     A fence after the upload says when the PBO may be reused.
+ *
+ * The GL name never changes: the placeholder is the same texture object,
+ * its storage just redefined by the real upload. Anything that kept the
+ * name (RenderMaterial, a bound sampler) shows the real image as soon as it
+ * is uploaded, without being told.
+ *
+ * BUDGET
+ *   Each Update starts uploads until GetFrameBudget() bytes have been
+ *   copied, so several large textures finishing at once are spread over a
+ *   few frames instead of making one frame long. One upload always fits,
+ *   however big, so nothing waits forever.
+ *
+ * A texture dropped before it finished loading is skipped. One whose file
+ * will not decode keeps the placeholder and counts as failed.
+ *
+ * Call Update once per frame (main does). Shutdown releases the buffers
+ * and must run before the GL context is destroyed.
+ */
+
+class TextureStreamer
+{
+public:
+	static const unsigned int RING_SIZE = 4;
+	static const std::size_t DEFAULT_FRAME_BUDGET = 8 * 1024 * 1024;
+
+	struct Stats
+	{
+		unsigned int requested = 0;
+		unsigned int completed = 0;
+		unsigned int failed = 0;          // files that could not be decoded
+		unsigned int decoding = 0;        // currently on the workers
+		unsigned int queued = 0;          // decoded, waiting for budget or a PBO
+		unsigned int uploading = 0;       // copies whose fence has not signalled
+		std::size_t bytesLastFrame = 0;
+		std::size_t bytesTotal = 0;
+	};
+
+	TextureStreamer();
+	~TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// A texture showing the placeholder until filepath has been decoded and
+	// uploaded by later Updates.
+	std::shared_ptr<Texture> Load(const std::string& filepath);
+
+	// Collect finished decodes and uploads, and start new uploads within
+	// the frame budget. GL thread only; never waits.
+	void Update();
+
+	std::size_t GetFrameBudget() const { return m_FrameBudget; }
+	void SetFrameBudget(std::size_t bytes) { m_FrameBudget = bytes; }
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	static TextureStreamer& Get();
+	static bool IsAlive();
+	static void Shutdown();
+
+	// Whether Model streams its textures (the default) or loads them before
+	// the constructor returns.
+	static bool IsEnabled();
+	static void SetEnabled(bool enabled);
+
+private:
+	struct Decode
+	{
+		std::weak_ptr<Texture> texture;
+		std::future<Texture::Image> image;
+	};
+
+	struct Upload
+	{
+		std::weak_ptr<Texture> texture;
+		Texture::Image image;
+	};
+
+	struct Slot
+	{
+		unsigned int buffer = 0;
+		std::size_t capacity = 0;
+		GLsync fence = nullptr;
+		std::weak_ptr<Texture> texture;
+	};
+
+	bool StartUpload(Slot& slot, Upload& upload);
+
+	std::vector<Decode> m_Decoding;
+	std::deque<Upload>  m_Ready;
+	Slot                m_Slots[RING_SIZE];
+	std::size_t         m_FrameBudget;
+	Stats               m_Stats;
+};
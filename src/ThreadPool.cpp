@@ -0,0 +1,284 @@
+#include "ThreadPool.h"
+
+// Which worker of which pool this thread is, if any
+static thread_local const ThreadPool* t_Pool = nullptr;
+static thread_local unsigned int t_Worker = ThreadPool::NOT_A_WORKER;
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		// hardware_concurrency may be 0 when unknown
+		const unsigned int hardware = std::thread::hardware_concurrency();
+		threadCount = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	// Every queue exists before any worker can steal from it
+	m_Queues.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_Queues.push_back(std::make_unique<WorkerQueue>());
+
+	m_Workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_Wake.notify_all();
+
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+unsigned int ThreadPool::GetWorkerIndex() const
+{
+	return t_Pool == this ? t_Worker : NOT_A_WORKER;
+}
+
+void ThreadPool::Push(Task task)
+{
+	const unsigned int worker = GetWorkerIndex();
+	if (worker != NOT_A_WORKER)
+	{
+		std::lock_guard<std::mutex> lock(m_Queues[worker]->mutex);
+		m_Queues[worker]->tasks.push_back(std::move(task));
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_SharedMutex);
+		m_Shared.push_back(std::move(task));
+	}
+
+	// A worker going to sleep counts itself in m_Sleeping before it checks
+	// m_Queued, and this counts the task before checking m_Sleeping, so
+	// one of the two always sees the other
+	m_Queued.fetch_add(1);
+	if (m_Sleeping.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Wake.notify_one();
+	}
+	// A worker in WaitUntil may take it too
+	if (m_Waiting.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Progress.notify_all();
+	}
+}
+
+bool ThreadPool::TryPop(unsigned int worker, Task& task)
+{
+	// Newest of our own first: the last thing split is the warmest
+	{
+		WorkerQueue& own = *m_Queues[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_SharedMutex);
+		if (!m_Shared.empty())
+		{
+			task = std::move(m_Shared.front());
+			m_Shared.pop_front();
+			return true;
+		}
+	}
+
+	// Oldest of someone else's, starting from the next worker along so
+	// thieves spread out instead of all trying worker 0
+	const unsigned int count = static_cast<unsigned int>(m_Queues.size());
+	for (unsigned int i = 1; i < count; i++)
+	{
+		WorkerQueue& victim = *m_Queues[(worker + i) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			m_Queues[worker]->stolen.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ThreadPool::TryRunOne()
+{
+	const unsigned int worker = GetWorkerIndex();
+	if (worker == NOT_A_WORKER)
+		return false;
+
+	Task task;
+	if (!TryPop(worker, task))
+		return false;
+	m_Queued.fetch_sub(1);
+	m_Queues[worker]->executed.fetch_add(1, std::memory_order_relaxed);
+	// A Submit task keeps its exception in the future, a TaskGroup one in
+	// the group, ParallelFor's in its state
+	task();
+
+	// Whatever the task made ready is published by this increment; a
+	// waiter counts itself before reading it, so if it read the old value
+	// this sees it waiting (see WaitUntil)
+	m_Completed.fetch_add(1);
+	if (m_Waiting.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Progress.notify_all();
+	}
+	return true;
+}
+
+void ThreadPool::WaitUntil(const std::function<bool()>& ready)
+{
+	const bool worker = GetWorkerIndex() != NOT_A_WORKER;
+	for (;;)
+	{
+		if (ready())
+			return;
+		if (worker && TryRunOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Waiting.fetch_add(1);
+		const uint64_t completed = m_Completed.load();
+		if (!ready())
+		{
+			m_Progress.wait(lock, [this, worker, completed]()
+				{
+					return m_Completed.load() != completed || (worker && m_Queued.load() > 0);
+				});
+		}
+		m_Waiting.fetch_sub(1);
+	}
+}
+
+void ThreadPool::WorkerLoop(unsigned int worker)
+{
+	t_Pool = this;
+	t_Worker = worker;
+
+	for (;;)
+	{
+		if (TryRunOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Sleeping.fetch_add(1);
+		m_Wake.wait(lock, [this]() { return m_Stopping || m_Queued.load() > 0; });
+		m_Sleeping.fetch_sub(1);
+
+		// Stopping still drains the queues, so no future is left unready
+		if (m_Stopping && m_Queued.load() == 0)
+			return;
+	}
+}
+
+void ThreadPool::RunMainThreadTasks()
+{
+	std::deque<Task> tasks;
+	{
+		std::lock_guard<std::mutex> lock(m_MainMutex);
+		tasks.swap(m_MainTasks);
+	}
+	for (Task& task : tasks)
+		task();
+}
+
+ThreadPool::Stats ThreadPool::GetStats() const
+{
+	Stats stats;
+	for (const std::unique_ptr<WorkerQueue>& queue : m_Queues)
+	{
+		stats.executed += queue->executed.load(std::memory_order_relaxed);
+		stats.stolen += queue->stolen.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+// ---------------------------------------------------------------------------
+// TaskGroup
+// ---------------------------------------------------------------------------
+
+TaskGroup::TaskGroup(ThreadPool& pool)
+	: m_Pool(pool)
+	, m_State(std::make_shared<State>())
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+	WaitForZero();
+}
+
+void TaskGroup::Finish(State& state, ThreadPool& pool)
+{
+	if (state.pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	// Run may have counted a new task since; its own Finish will start them
+	std::vector<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (state.pending.load(std::memory_order_acquire) == 0)
+			ready.swap(state.continuations);
+		state.done.notify_all();
+	}
+	for (std::function<void()>& continuation : ready)
+		pool.Push(std::move(continuation));
+}
+
+void TaskGroup::Then(std::function<void()> continuation)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_State->mutex);
+		if (m_State->pending.load(std::memory_order_acquire) != 0)
+		{
+			m_State->continuations.push_back(std::move(continuation));
+			return;
+		}
+	}
+	m_Pool.Push(std::move(continuation));
+}
+
+void TaskGroup::WaitForZero()
+{
+	if (m_Pool.GetWorkerIndex() != ThreadPool::NOT_A_WORKER)
+	{
+		m_Pool.WaitUntil([this]() { return IsDone(); });
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_State->mutex);
+	m_State->done.wait(lock, [this]() { return IsDone(); });
+}
+
+void TaskGroup::Wait()
+{
+	WaitForZero();
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(m_State->mutex);
+		error.swap(m_State->error);
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
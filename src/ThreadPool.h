@@ -0,0 +1,302 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class TaskGroup;
+
+/**
+ * ThreadPool — a fixed set of worker threads for CPU-only work
+ *
+ * Submit queues a task and returns a std::future for its result. The
+ * future's get() waits for the task and rethrows anything it threw.
+ * TaskGroup (below) runs tasks without a future each and waits for them
+ * all; a group can also start continuations when its last task finishes.
+ *
+ * WORK STEALING
+ *   Every worker has its own deque. A task submitted from a worker goes
+ *   on the back of that worker's deque, and the worker takes its next
+ *   task from the back as well, so work split recursively stays on the
+ *   thread (and in the cache) that split it. Tasks from any other thread
+ *   go into a shared queue, first in first out. A worker with nothing of
+ *   its own takes from the shared queue, then steals from the front of
+ *   another worker's deque: the oldest task there, usually the largest
+ *   piece left. Idle workers sleep and are woken by the next submission.
+ *
+ * NO GL ON WORKERS
+ *   The GL context is current on the main thread only. A task may decode,
+ *   convert or optimise data, but every gl* call (buffer uploads, texture
+ *   creation, the GlCall wrappers) must happen back on the main thread:
+ *   either once the task's future is ready, or by posting the GL part with
+ *   PostToMainThread, which the main loop runs at the top of each frame.
+ *   Model's import pipeline works the first way: workers produce plain
+ *   std::vectors and images, and the main thread uploads them.
+ *
+ * PARALLEL FOR
+ *   ParallelFor splits [0, count) into fixed-size chunks and runs them on
+ *   the calling thread and the workers at once, returning when all are
+ *   done. Chunks are claimed from an atomic counter, so a participant
+ *   that finishes early simply takes the next one, and the caller never
+ *   waits for a helper that is still queued behind other work. Each call
+ *   is told which participant runs it (0 is the caller), for per-thread
+ *   state such as a random generator or a timer.
+ *
+ * WAITING
+ *   A worker that waits (ParallelFor, TaskGroup::Wait) runs other tasks
+ *   meanwhile, so tasks may wait for tasks without deadlocking the pool.
+ *   A std::future's get() only blocks, so inside a task use a TaskGroup.
+ *   Any other thread only waits: the main thread never picks up, say, a
+ *   texture cook in the middle of its frame.
+ *
+ * Get() returns a shared pool with one worker per hardware thread minus
+ * one (the main thread is the other), created on first use.
+ */
+class ThreadPool
+{
+public:
+	struct Stats
+	{
+		uint64_t executed = 0;  // tasks run by the workers
+		uint64_t stolen = 0;    // of which taken from another worker's deque
+	};
+
+	// 0 threads means one per hardware thread minus one, at least one
+	explicit ThreadPool(unsigned int threadCount = 0);
+
+	// Finishes every queued task, then joins the workers
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template<typename F>
+	std::future<std::invoke_result_t<F>> Submit(F&& task)
+	{
+		using Result = std::invoke_result_t<F>;
+
+		// std::function must be copyable and packaged_task is not, so the
+		// queue holds a shared pointer to it
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> future = packaged->get_future();
+		Push([packaged]() { (*packaged)(); });
+		return future;
+	}
+
+	// body(begin, end, participant) for every chunk of [0, count), by up to
+	// maxParticipants threads including this one (0: every worker joins).
+	// Participants are numbered 0 .. GetThreadCount(). The first exception
+	// a chunk throws is rethrown here, once every chunk has finished.
+	template<typename F>
+	void ParallelFor(unsigned int count, unsigned int chunkSize, F&& body, unsigned int maxParticipants = 0)
+	{
+		const unsigned int chunks = (count + chunkSize - 1) / chunkSize;
+		if (chunks == 0)
+			return;
+
+		unsigned int helpers = maxParticipants ? std::min(maxParticipants - 1, GetThreadCount()) : GetThreadCount();
+		helpers = std::min(helpers, chunks - 1);
+		if (helpers == 0)
+		{
+			for (unsigned int begin = 0; begin < count; begin += chunkSize)
+				body(begin, std::min(begin + chunkSize, count), 0u);
+			return;
+		}
+
+		// A helper that starts after the last chunk has been claimed only
+		// reads the counter, so the counters outlive this call; the body
+		// is never touched once every chunk is done
+		auto shared = std::make_shared<ForState>();
+		auto* bodyPtr = &body;
+		auto run = [shared, bodyPtr, chunks, chunkSize, count](unsigned int participant)
+		{
+			for (unsigned int chunk = shared->next.fetch_add(1); chunk < chunks; chunk = shared->next.fetch_add(1))
+			{
+				const unsigned int begin = chunk * chunkSize;
+				try
+				{
+					(*bodyPtr)(begin, std::min(begin + chunkSize, count), participant);
+				}
+				catch (...)
+				{
+					shared->Fail(std::current_exception());
+				}
+				shared->done.fetch_add(1, std::memory_order_release);
+			}
+		};
+
+		for (unsigned int i = 0; i < helpers; i++)
+			Push([run, i]() { run(i + 1); });
+		run(0);
+		WaitUntil([&shared, chunks]() { return shared->done.load(std::memory_order_acquire) == chunks; });
+		if (shared->error)
+			std::rethrow_exception(shared->error);
+	}
+
+	// Runs `task` on the main thread at its next RunMainThreadTasks, for
+	// the GL half of work done on a worker
+	template<typename F>
+	std::future<std::invoke_result_t<F>> PostToMainThread(F&& task)
+	{
+		using Result = std::invoke_result_t<F>;
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> future = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_MainMutex);
+			m_MainTasks.emplace_back([packaged]() { (*packaged)(); });
+		}
+		return future;
+	}
+
+	// The main loop, once a frame: every task posted so far. One posted
+	// while these run waits for the next call.
+	void RunMainThreadTasks();
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_Workers.size()); }
+	// This thread's worker index, or NOT_A_WORKER
+	unsigned int GetWorkerIndex() const;
+	Stats GetStats() const;
+
+	static const unsigned int NOT_A_WORKER = ~0u;
+
+	static ThreadPool& Get();
+
+private:
+	friend class TaskGroup;
+
+	typedef std::function<void()> Task;
+
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::atomic<uint64_t> executed{ 0 };
+		std::atomic<uint64_t> stolen{ 0 };
+	};
+
+	struct ForState
+	{
+		std::atomic<unsigned int> next{ 0 };
+		std::atomic<unsigned int> done{ 0 };
+		std::mutex mutex;
+		std::exception_ptr error;
+
+		void Fail(std::exception_ptr exception)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error)
+				error = exception;
+		}
+	};
+
+	void Push(Task task);
+	// Pops and runs one task; false if there was none to take. Only a
+	// worker of this pool takes tasks.
+	bool TryRunOne();
+	// On a worker, runs other tasks until `ready`; elsewhere, or with
+	// nothing to run, sleeps until a task finishes (or, on a worker, is
+	// queued) and checks again. `ready` may only turn true as a task of
+	// this pool finishes.
+	void WaitUntil(const std::function<bool()>& ready);
+	bool TryPop(unsigned int worker, Task& task);
+	void WorkerLoop(unsigned int worker);
+
+	std::vector<std::unique_ptr<WorkerQueue>> m_Queues;     // one per worker
+	std::vector<std::thread>                  m_Workers;
+
+	std::deque<Task>                          m_Shared;     // from threads other than the workers
+	std::mutex                                m_SharedMutex;
+
+	std::atomic<unsigned int>                 m_Queued{ 0 };    // in any queue
+	std::atomic<unsigned int>                 m_Sleeping{ 0 };
+	std::atomic<unsigned int>                 m_Waiting{ 0 };   // asleep in WaitUntil
+	std::atomic<uint64_t>                     m_Completed{ 0 }; // tasks run, for WaitUntil
+	std::mutex                                m_Mutex;          // for sleeping
+	std::condition_variable                   m_Wake;
+	std::condition_variable                   m_Progress;       // a task finished, or one was queued
+	bool                                      m_Stopping = false;
+
+	std::deque<Task>                          m_MainTasks;
+	std::mutex                                m_MainMutex;
+};
+
+/**
+ * TaskGroup — a counter of unfinished tasks, and what to do when it's zero
+ *
+ *     TaskGroup group;
+ *     for (Chunk& chunk : chunks)
+ *         group.Run([&chunk]() { chunk.Process(); });
+ *     group.Then([&]() { Merge(chunks); });   // on a worker, once all are done
+ *     group.Wait();
+ *
+ * Run queues a task on the pool and counts it; each one finishing counts
+ * down. Then is a continuation: it is submitted to the pool when the
+ * count next reaches zero (at once if it already is), which is how a
+ * stage is started by the tasks it depends on instead of by a thread
+ * waiting for them. A continuation may Run more tasks on another group.
+ *
+ * Wait returns when the count is zero and rethrows the first exception a
+ * task threw. The destructor waits too, but drops the exception, so Wait
+ * explicitly where errors matter.
+ */
+class TaskGroup
+{
+public:
+	explicit TaskGroup(ThreadPool& pool = ThreadPool::Get());
+	~TaskGroup();
+
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+	template<typename F>
+	void Run(F&& task)
+	{
+		m_State->pending.fetch_add(1, std::memory_order_relaxed);
+		std::shared_ptr<State> state = m_State;
+		ThreadPool* pool = &m_Pool;
+		m_Pool.Push([state, pool, task = std::forward<F>(task)]() mutable
+			{
+				try
+				{
+					task();
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if (!state->error)
+						state->error = std::current_exception();
+				}
+				Finish(*state, *pool);
+			});
+	}
+
+	void Then(std::function<void()> continuation);
+	void Wait();
+	bool IsDone() const { return m_State->pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	// Shared with the queued tasks, which may outlive the group
+	struct State
+	{
+		std::atomic<unsigned int> pending{ 0 };
+		std::mutex mutex;
+		std::condition_variable done;
+		std::vector<std::function<void()>> continuations;
+		std::exception_ptr error;
+	};
+
+	static void Finish(State& state, ThreadPool& pool);
+	void WaitForZero();
+
+	ThreadPool& m_Pool;
+	std::shared_ptr<State> m_State;
+};
@@ -0,0 +1,464 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#if !defined(TRANSFORMHIERARCHY_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TRANSFORMHIERARCHY_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Get()'s hierarchy, once made and until destroyed
+	const TransformHierarchy* s_Shared = nullptr;
+
+	const float DEGREES_TO_RADIANS = 3.14159265358979f / 180.0f;
+
+	// out = a * b, neither aliasing out
+	void Multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+	{
+#ifdef TRANSFORMHIERARCHY_SIMD
+		const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+		const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+		const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+		const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+		for (int column = 0; column < 4; column++)
+		{
+			// Column j of the product is a's columns weighted by b's column j
+			const float* b_j = &b[column][0];
+			__m128 result = _mm_mul_ps(a0, _mm_set1_ps(b_j[0]));
+			result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b_j[1])));
+			result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b_j[2])));
+			result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b_j[3])));
+			_mm_storeu_ps(&out[column][0], result);
+		}
+#else
+		out = a * b;
+#endif
+	}
+}
+
+TransformHierarchy::~TransformHierarchy()
+{
+	if (this == s_Shared)
+		s_Shared = nullptr;
+}
+
+TransformHierarchy& TransformHierarchy::Get()
+{
+	static TransformHierarchy hierarchy;
+	s_Shared = &hierarchy;
+	return hierarchy;
+}
+
+bool TransformHierarchy::IsAlive()
+{
+	return s_Shared != nullptr;
+}
+
+TransformHierarchy::Node TransformHierarchy::Create(Node parent)
+{
+	Node node;
+	if (!m_Free.empty())
+	{
+		node = m_Free.back();
+		m_Free.pop_back();
+	}
+	else
+	{
+		node = static_cast<Node>(m_Parent.size());
+		std::vector<float>* components[] = { &m_PosX, &m_PosY, &m_PosZ, &m_RotX, &m_RotY, &m_RotZ,
+			&m_ScaleX, &m_ScaleY, &m_ScaleZ };
+		for (std::vector<float>* component : components)
+			component->push_back(0.0f);
+		m_Parent.push_back(static_cast<Node>(NONE));
+		m_ChildCount.push_back(0);
+		m_Alive.push_back(0);
+		m_Dirty.push_back(0);
+		m_Updated.push_back(0);
+		m_Local.emplace_back(1.0f);
+		m_World.emplace_back(1.0f);
+	}
+
+	m_PosX[node] = m_PosY[node] = m_PosZ[node] = 0.0f;
+	m_RotX[node] = m_RotY[node] = m_RotZ[node] = 0.0f;
+	m_ScaleX[node] = m_ScaleY[node] = m_ScaleZ[node] = 1.0f;
+	m_Parent[node] = NONE;
+	m_ChildCount[node] = 0;
+	m_Alive[node] = 1;
+	m_Updated[node] = 0;
+	m_Stats.nodes++;
+	m_OrderDirty = true;
+	MarkDirty(node);
+
+	if (parent != NONE)
+		SetParent(node, parent);
+	return node;
+}
+
+void TransformHierarchy::Release(Node node)
+{
+	if (node >= m_Parent.size() || !m_Alive[node])
+		return;
+
+	if (m_ChildCount[node] > 0)
+	{
+		for (Node child = 0; child < m_Parent.size(); child++)
+		{
+			if (m_Alive[child] && m_Parent[child] == node)
+			{
+				m_Parent[child] = NONE;
+				MarkDirty(child);
+			}
+		}
+	}
+	if (m_Parent[node] != NONE)
+		m_ChildCount[m_Parent[node]]--;
+
+	// Unflag it, or a Create reusing the slot would find it flagged
+	// already and never queue itself
+	if (m_Dirty[node])
+	{
+		m_Dirty[node] = 0;
+		m_DirtyNodes.erase(std::find(m_DirtyNodes.begin(), m_DirtyNodes.end(), node));
+	}
+
+	m_Parent[node] = NONE;
+	m_ChildCount[node] = 0;
+	m_Alive[node] = 0;
+	m_Updated[node] = 0;
+	m_Free.push_back(node);
+	m_Stats.nodes--;
+	m_OrderDirty = true;
+	m_Changed = true;
+}
+
+void TransformHierarchy::SetParent(Node node, Node parent)
+{
+	if (m_Parent[node] == parent)
+		return;
+
+	for (Node ancestor = parent; ancestor != NONE; ancestor = m_Parent[ancestor])
+	{
+		if (ancestor == node)
+		{
+			std::cerr << "TransformHierarchy::SetParent() - node " << parent
+				<< " is under node " << node << ", ignored" << std::endl;
+			return;
+		}
+	}
+
+	if (m_Parent[node] != NONE)
+		m_ChildCount[m_Parent[node]]--;
+	m_Parent[node] = parent;
+	if (parent != NONE)
+		m_ChildCount[parent]++;
+
+	m_OrderDirty = true;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetPosition(Node node, const glm::vec3& position)
+{
+	m_PosX[node] = position.x;
+	m_PosY[node] = position.y;
+	m_PosZ[node] = position.z;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetRotation(Node node, const glm::vec3& degrees)
+{
+	m_RotX[node] = degrees.x;
+	m_RotY[node] = degrees.y;
+	m_RotZ[node] = degrees.z;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::SetScale(Node node, const glm::vec3& scale)
+{
+	m_ScaleX[node] = scale.x;
+	m_ScaleY[node] = scale.y;
+	m_ScaleZ[node] = scale.z;
+	MarkDirty(node);
+}
+
+void TransformHierarchy::MarkDirty(Node node)
+{
+	if (!m_Dirty[node])
+	{
+		m_Dirty[node] = 1;
+		m_DirtyNodes.push_back(node);
+	}
+	m_Changed = true;
+}
+
+const glm::mat4& TransformHierarchy::GetLocalMatrix(Node node)
+{
+	if (m_Changed)
+		Update();
+	return m_Local[node];
+}
+
+const glm::mat4& TransformHierarchy::GetWorldMatrix(Node node)
+{
+	if (m_Changed)
+		Update();
+	return m_World[node];
+}
+
+void TransformHierarchy::RebuildOrder()
+{
+	// Depth by walking up to the first node whose depth is known, then
+	// filling in the walk on the way back down
+	const unsigned int UNKNOWN = ~0u;
+	const Node slots = static_cast<Node>(m_Parent.size());
+	m_Depth.assign(slots, UNKNOWN);
+	unsigned int maxDepth = 0;
+	for (Node node = 0; node < slots; node++)
+	{
+		if (!m_Alive[node] || m_Depth[node] != UNKNOWN)
+			continue;
+
+		unsigned int steps = 0;
+		Node top = node;
+		while (m_Parent[top] != NONE && m_Depth[m_Parent[top]] == UNKNOWN)
+		{
+			top = m_Parent[top];
+			steps++;
+		}
+		unsigned int depth = (m_Parent[top] == NONE ? 0 : m_Depth[m_Parent[top]] + 1) + steps;
+		maxDepth = std::max(maxDepth, depth);
+		for (Node walk = node; walk != m_Parent[top]; walk = m_Parent[walk])
+			m_Depth[walk] = depth--;
+	}
+
+	// Counting sort by depth. Within a depth, nodes stay in slot order.
+	std::vector<unsigned int> starts(maxDepth + 2, 0);
+	for (Node node = 0; node < slots; node++)
+	{
+		if (m_Alive[node])
+			starts[m_Depth[node] + 1]++;
+	}
+	for (unsigned int depth = 1; depth < starts.size(); depth++)
+		starts[depth] += starts[depth - 1];
+
+	m_Order.resize(starts.back());
+	for (Node node = 0; node < slots; node++)
+	{
+		if (m_Alive[node])
+			m_Order[starts[m_Depth[node]]++] = node;
+	}
+	m_OrderDirty = false;
+}
+
+#ifdef TRANSFORMHIERARCHY_SIMD
+void TransformHierarchy::ComputeLocal(const Node* nodes, unsigned int count)
+{
+	for (unsigned int first = 0; first < count; first += 4)
+	{
+		const unsigned int lanes = std::min(count - first, 4u);
+
+		// Gather four nodes' components (repeating the last to fill the
+		// register), with the trigonometry done per lane
+		alignas(16) float sa[4], ca[4], sb[4], cb[4], sc[4], cc[4], sx[4], sy[4], sz[4];
+		for (unsigned int lane = 0; lane < 4; lane++)
+		{
+			const Node node = nodes[first + std::min(lane, lanes - 1)];
+			sa[lane] = std::sin(m_RotX[node] * DEGREES_TO_RADIANS);
+			ca[lane] = std::cos(m_RotX[node] * DEGREES_TO_RADIANS);
+			sb[lane] = std::sin(m_RotY[node] * DEGREES_TO_RADIANS);
+			cb[lane] = std::cos(m_RotY[node] * DEGREES_TO_RADIANS);
+			sc[lane] = std::sin(m_RotZ[node] * DEGREES_TO_RADIANS);
+			cc[lane] = std::cos(m_RotZ[node] * DEGREES_TO_RADIANS);
+			sx[lane] = m_ScaleX[node];
+			sy[lane] = m_ScaleY[node];
+			sz[lane] = m_ScaleZ[node];
+		}
+
+		const __m128 SA = _mm_load_ps(sa), CA = _mm_load_ps(ca);
+		const __m128 SB = _mm_load_ps(sb), CB = _mm_load_ps(cb);
+		const __m128 SC = _mm_load_ps(sc), CC = _mm_load_ps(cc);
+		const __m128 SX = _mm_load_ps(sx), SY = _mm_load_ps(sy), SZ = _mm_load_ps(sz);
+		const __m128 SASB = _mm_mul_ps(SA, SB);
+		const __m128 CASB = _mm_mul_ps(CA, SB);
+
+		// Rx * Ry * Rz with each column scaled, element [column][row]
+		alignas(16) float m[9][4];
+		_mm_store_ps(m[0], _mm_mul_ps(_mm_mul_ps(CB, CC), SX));
+		_mm_store_ps(m[1], _mm_mul_ps(_mm_add_ps(_mm_mul_ps(SASB, CC), _mm_mul_ps(CA, SC)), SX));
+		_mm_store_ps(m[2], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(SA, SC), _mm_mul_ps(CASB, CC)), SX));
+		_mm_store_ps(m[3], _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(CB, SC)), SY));
+		_mm_store_ps(m[4], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(CA, CC), _mm_mul_ps(SASB, SC)), SY));
+		_mm_store_ps(m[5], _mm_mul_ps(_mm_add_ps(_mm_mul_ps(CASB, SC), _mm_mul_ps(SA, CC)), SY));
+		_mm_store_ps(m[6], _mm_mul_ps(SB, SZ));
+		_mm_store_ps(m[7], _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(SA, CB)), SZ));
+		_mm_store_ps(m[8], _mm_mul_ps(_mm_mul_ps(CA, CB), SZ));
+
+		for (unsigned int lane = 0; lane < lanes; lane++)
+		{
+			const Node node = nodes[first + lane];
+			glm::mat4& local = m_Local[node];
+			local[0] = glm::vec4(m[0][lane], m[1][lane], m[2][lane], 0.0f);
+			local[1] = glm::vec4(m[3][lane], m[4][lane], m[5][lane], 0.0f);
+			local[2] = glm::vec4(m[6][lane], m[7][lane], m[8][lane], 0.0f);
+			local[3] = glm::vec4(m_PosX[node], m_PosY[node], m_PosZ[node], 1.0f);
+		}
+	}
+}
+#else
+void TransformHierarchy::ComputeLocal(const Node* nodes, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const Node node = nodes[i];
+		const float sa = std::sin(m_RotX[node] * DEGREES_TO_RADIANS), ca = std::cos(m_RotX[node] * DEGREES_TO_RADIANS);
+		const float sb = std::sin(m_RotY[node] * DEGREES_TO_RADIANS), cb = std::cos(m_RotY[node] * DEGREES_TO_RADIANS);
+		const float sc = std::sin(m_RotZ[node] * DEGREES_TO_RADIANS), cc = std::cos(m_RotZ[node] * DEGREES_TO_RADIANS);
+		const float sx = m_ScaleX[node], sy = m_ScaleY[node], sz = m_ScaleZ[node];
+
+		glm::mat4& local = m_Local[node];
+		local[0] = glm::vec4(cb * cc, sa * sb * cc + ca * sc, sa * sc - ca * sb * cc, 0.0f) * sx;
+		local[1] = glm::vec4(-cb * sc, ca * cc - sa * sb * sc, ca * sb * sc + sa * cc, 0.0f) * sy;
+		local[2] = glm::vec4(sb, -sa * cb, ca * cb, 0.0f) * sz;
+		local[3] = glm::vec4(m_PosX[node], m_PosY[node], m_PosZ[node], 1.0f);
+	}
+}
+#endif
+
+void TransformHierarchy::Update()
+{
+	if (!m_Changed)
+	{
+		// Nothing new since the last Update, so nothing is updated now
+		if (m_Stats.worldUpdates > 0)
+		{
+			std::fill(m_Updated.begin(), m_Updated.end(), static_cast<uint8_t>(0));
+			m_Stats.localUpdates = 0;
+			m_Stats.worldUpdates = 0;
+		}
+		return;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	if (m_OrderDirty)
+		RebuildOrder();
+	std::fill(m_Updated.begin(), m_Updated.end(), static_cast<uint8_t>(0));
+
+	ComputeLocal(m_DirtyNodes.data(), static_cast<unsigned int>(m_DirtyNodes.size()));
+	m_Stats.localUpdates = static_cast<unsigned int>(m_DirtyNodes.size());
+
+	// Parents first, so a parent's world matrix is final before its children read it
+	unsigned int worldUpdates = 0;
+	for (Node node : m_Order)
+	{
+		const Node parent = m_Parent[node];
+		const bool parentMoved = parent != NONE && m_Updated[parent];
+		if (!m_Dirty[node] && !parentMoved)
+			continue;
+
+		if (parent == NONE)
+			m_World[node] = m_Local[node];
+		else
+			Multiply(m_World[parent], m_Local[node], m_World[node]);
+		m_Updated[node] = 1;
+		worldUpdates++;
+	}
+
+	for (Node node : m_DirtyNodes)
+		m_Dirty[node] = 0;
+	m_DirtyNodes.clear();
+	m_Changed = false;
+
+	m_Stats.worldUpdates = worldUpdates;
+	m_Stats.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char* TransformHierarchy::GetInstructionSet()
+{
+#ifdef TRANSFORMHIERARCHY_SIMD
+	return "SSE";
+#else
+	return "Scalar";
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// TransformNode
+// ---------------------------------------------------------------------------
+
+TransformNode::TransformNode(TransformHierarchy::Node parent)
+	: m_Node(TransformHierarchy::Get().Create(parent))
+{
+}
+
+TransformNode::~TransformNode()
+{
+	if (m_Node != TransformHierarchy::NONE && TransformHierarchy::IsAlive())
+		TransformHierarchy::Get().Release(m_Node);
+}
+
+TransformNode::TransformNode(TransformNode&& other) noexcept
+	: m_Node(other.m_Node)
+{
+	other.m_Node = TransformHierarchy::NONE;
+}
+
+TransformNode& TransformNode::operator=(TransformNode&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (m_Node != TransformHierarchy::NONE && TransformHierarchy::IsAlive())
+			TransformHierarchy::Get().Release(m_Node);
+		m_Node = other.m_Node;
+		other.m_Node = TransformHierarchy::NONE;
+	}
+	return *this;
+}
+
+void TransformNode::SetParent(TransformHierarchy::Node parent)
+{
+	if (m_Node != TransformHierarchy::NONE)
+		TransformHierarchy::Get().SetParent(m_Node, parent);
+}
+
+void TransformNode::SetPosition(const glm::vec3& position)
+{
+	if (m_Node != TransformHierarchy::NONE)
+		TransformHierarchy::Get().SetPosition(m_Node, position);
+}
+
+void TransformNode::SetRotation(const glm::vec3& degrees)
+{
+	if (m_Node != TransformHierarchy::NONE)
+		TransformHierarchy::Get().SetRotation(m_Node, degrees);
+}
+
+void TransformNode::SetScale(const glm::vec3& scale)
+{
+	if (m_Node != TransformHierarchy::NONE)
+		TransformHierarchy::Get().SetScale(m_Node, scale);
+}
+
+glm::vec3 TransformNode::GetPosition() const
+{
+	return m_Node != TransformHierarchy::NONE ? TransformHierarchy::Get().GetPosition(m_Node) : glm::vec3(0.0f);
+}
+
+glm::vec3 TransformNode::GetRotation() const
+{
+	return m_Node != TransformHierarchy::NONE ? TransformHierarchy::Get().GetRotation(m_Node) : glm::vec3(0.0f);
+}
+
+glm::vec3 TransformNode::GetScale() const
+{
+	return m_Node != TransformHierarchy::NONE ? TransformHierarchy::Get().GetScale(m_Node) : glm::vec3(1.0f);
+}
+
+glm::mat4 TransformNode::GetWorldMatrix() const
+{
+	return m_Node != TransformHierarchy::NONE ? TransformHierarchy::Get().GetWorldMatrix(m_Node) : glm::mat4(1.0f);
+}
@@ -0,0 +1,184 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+/**
+ * TransformHierarchy — parent/child transforms with cached world matrices
+ *
+ * Mesh and Model used to rebuild their matrix from position, rotation and
+ * scale (a translate, three glm::rotate calls and a scale) every time it
+ * was asked for, and Model::setPosition copied its transform into every
+ * sub-mesh so they would all move together. Here every transform is a
+ * node: a local position/rotation/scale, an optional parent, and a cached
+ * world matrix (parent's world * local), recomputed only when something
+ * it depends on has changed.
+ *
+ *     TransformHierarchy& transforms = TransformHierarchy::Get();
+ *     TransformHierarchy::Node arm = transforms.Create();
+ *     TransformHierarchy::Node hand = transforms.Create(arm);
+ *     transforms.SetRotation(arm, glm::vec3(0, 45, 0));   // hand follows
+ *     glm::mat4 world = transforms.GetWorldMatrix(hand);
+ *
+ * TransformNode (below) owns a node for the lifetime of an object, which
+ * is how Mesh and Model hold theirs; a Model's meshes are children of the
+ * model's node and inherit its transform rather than copying it.
+ *
+ * DIRTY FLAGS
+ *   The setters only store the value and flag the node. Update, called once
+ *   a frame by the main loop (and by GetWorldMatrix whenever a flag is
+ *   set, so a matrix is never stale), walks the nodes parents first and
+ *   recomputes the local matrix of each flagged node and the world matrix
+ *   of each node that is flagged or whose parent's world changed this
+ *   update. A node nothing touched costs a flag test. WasUpdated tells a
+ *   caller which world matrices are new, e.g. to re-upload only those.
+ *
+ * STORAGE
+ *   Position, rotation and scale are separate float arrays (structure of
+ *   arrays, as in CullBatch and ParticlePool), indexed by node. Local and
+ *   world matrices are contiguous arrays of glm::mat4, so GetWorldMatrices
+ *   can go straight into an instance or storage buffer. Released nodes go
+ *   on a free list and their slots are reused.
+ *
+ * SIMD
+ *   Local matrices are built four nodes at a time: the flagged nodes'
+ *   components are gathered into SSE registers and each register computes
+ *   one element of the four rotation-scale matrices (the trigonometry is
+ *   scalar). World matrices multiply with one SSE column per register.
+ *   Selected at compile time as in ParticlePool: SSE on x64 or x86 with
+ *   SSE2, otherwise (or with TRANSFORMHIERARCHY_SCALAR) the same formulas
+ *   one node at a time.
+ *
+ * Rotation is Euler angles in degrees applied X, then Y, then Z, exactly
+ * as Mesh::getTransformMatrix always did: translate * Rx * Ry * Rz * scale.
+ *
+ * Main thread only: nothing here locks.
+ */
+class TransformHierarchy
+{
+public:
+	typedef unsigned int Node;
+	static const Node NONE = ~0u;
+
+	struct Stats
+	{
+		unsigned int nodes = 0;          // alive
+		unsigned int localUpdates = 0;   // in the last Update
+		unsigned int worldUpdates = 0;
+		float        milliseconds = 0.0f;
+	};
+
+	// A node with an identity local transform
+	Node Create(Node parent = NONE);
+	// Its children become roots and keep their local transforms (so they
+	// jump to where those put them in world space)
+	void Release(Node node);
+
+	// NONE makes the node a root. A parent under the node itself is refused.
+	void SetParent(Node node, Node parent);
+	Node GetParent(Node node) const { return m_Parent[node]; }
+
+	void SetPosition(Node node, const glm::vec3& position);
+	void SetRotation(Node node, const glm::vec3& degrees);
+	void SetScale(Node node, const glm::vec3& scale);
+
+	glm::vec3 GetPosition(Node node) const { return glm::vec3(m_PosX[node], m_PosY[node], m_PosZ[node]); }
+	glm::vec3 GetRotation(Node node) const { return glm::vec3(m_RotX[node], m_RotY[node], m_RotZ[node]); }
+	glm::vec3 GetScale(Node node) const { return glm::vec3(m_ScaleX[node], m_ScaleY[node], m_ScaleZ[node]); }
+
+	// Current after an Update, which these run first if anything changed.
+	// The reference lasts until the next Create.
+	const glm::mat4& GetLocalMatrix(Node node);
+	const glm::mat4& GetWorldMatrix(Node node);
+
+	// Recomputes what changed since the last call
+	void Update();
+	bool HasChanges() const { return m_Changed; }
+
+	// Whether the last Update gave the node a new world matrix
+	bool WasUpdated(Node node) const { return m_Updated[node] != 0; }
+
+	// Every slot's world matrix, by node, valid after Update. Released
+	// slots hold whatever they last had.
+	const glm::mat4* GetWorldMatrices() const { return m_World.data(); }
+	unsigned int GetSlotCount() const { return static_cast<unsigned int>(m_Parent.size()); }
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	// "SSE" or "Scalar", for the GUI
+	static const char* GetInstructionSet();
+
+	// The hierarchy Mesh and Model use. IsAlive is false once it has been
+	// destroyed at exit, for objects that outlive it.
+	static TransformHierarchy& Get();
+	static bool IsAlive();
+
+	TransformHierarchy() = default;
+	~TransformHierarchy();
+	TransformHierarchy(const TransformHierarchy&) = delete;
+	TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+private:
+	void MarkDirty(Node node);
+	void RebuildOrder();
+	// Local matrices of `nodes` from their components
+	void ComputeLocal(const Node* nodes, unsigned int count);
+
+	std::vector<float> m_PosX, m_PosY, m_PosZ;
+	std::vector<float> m_RotX, m_RotY, m_RotZ;
+	std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+
+	std::vector<Node>         m_Parent;
+	std::vector<unsigned int> m_ChildCount;
+	std::vector<uint8_t>      m_Alive;
+	std::vector<uint8_t>      m_Dirty;      // local transform set since the last Update
+	std::vector<uint8_t>      m_Updated;    // world matrix recomputed by the last Update
+
+	std::vector<glm::mat4>    m_Local;
+	std::vector<glm::mat4>    m_World;
+
+	std::vector<Node>         m_Free;
+	std::vector<Node>         m_DirtyNodes;
+
+	// Alive nodes sorted by depth, so every parent comes before its children
+	std::vector<Node>         m_Order;
+	std::vector<unsigned int> m_Depth;      // RebuildOrder's scratch
+	bool                      m_OrderDirty = false;
+	bool                      m_Changed = false;
+
+	Stats m_Stats;
+};
+
+/**
+ * TransformNode — one node of TransformHierarchy::Get(), owned
+ *
+ * Creates its node on construction and releases it on destruction; moving
+ * hands the node over. The accessors forward to the hierarchy.
+ */
+class TransformNode
+{
+public:
+	explicit TransformNode(TransformHierarchy::Node parent = TransformHierarchy::NONE);
+	~TransformNode();
+
+	TransformNode(TransformNode&& other) noexcept;
+	TransformNode& operator=(TransformNode&& other) noexcept;
+	TransformNode(const TransformNode&) = delete;
+	TransformNode& operator=(const TransformNode&) = delete;
+
+	TransformHierarchy::Node GetNode() const { return m_Node; }
+
+	void SetParent(TransformHierarchy::Node parent);
+	void SetPosition(const glm::vec3& position);
+	void SetRotation(const glm::vec3& degrees);
+	void SetScale(const glm::vec3& scale);
+
+	glm::vec3 GetPosition() const;
+	glm::vec3 GetRotation() const;
+	glm::vec3 GetScale() const;
+
+	glm::mat4 GetWorldMatrix() const;
+
+private:
+	TransformHierarchy::Node m_Node;
+};
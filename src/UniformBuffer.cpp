@@ -0,0 +1,31 @@
+#include "UniformBuffer.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+UniformBuffer::UniformBuffer(unsigned int size, unsigned int binding)
+	: m_RendererID(0), m_Size(size), m_Binding(binding)
+{
+	GlCall(glGenBuffers(1, &m_RendererID));
+	GlCall(glBindBuffer(GL_UNIFORM_BUFFER, m_RendererID));
+	GlCall(glBufferData(GL_UNIFORM_BUFFER, m_Size, nullptr, GL_DYNAMIC_DRAW));
+	GpuMemory::TrackBuffer(GpuMemory::Category::Uniform, m_RendererID, m_Size);
+	BindBase();
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	GlCall(glDeleteBuffers(1, &m_RendererID));
+	GLState::OnBufferDeleted(m_RendererID);
+}
+
+void UniformBuffer::SetData(const void* data, unsigned int size, unsigned int offset)
+{
+	GlCall(glBindBuffer(GL_UNIFORM_BUFFER, m_RendererID));
+	GlCall(glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data));
+}
+
+void UniformBuffer::BindBase() const
+{
+	GlCall(glBindBufferBase(GL_UNIFORM_BUFFER, m_Binding, m_RendererID));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+/**
+ * UniformBuffer — a block of uniforms shared between shader programs
+ *
+ * glUniform* writes into ONE program's uniform storage, so a value every
+ * shader needs (the camera matrices) has to be re-sent to each program,
+ * every frame. A uniform buffer object (UBO) holds the values in a GPU
+ * buffer instead. The buffer is attached to a numbered binding point:
+ *
+ *     glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+ *
+ * and every program whose uniform block is linked to the same binding
+ * point (glUniformBlockBinding) reads from it. Writing the buffer once
+ * updates the values for all of them at the same time.
+ *
+ * The C++ struct written into the buffer must match the GLSL block's
+ * std140 layout exactly: vec3 is padded to 16 bytes, arrays and structs
+ * round up to 16, and mat4 is four vec4 columns. Use vec4/mat4 members to
+ * keep the two sides identical without hand-placed padding.
+ */
+
+class UniformBuffer
+{
+public:
+	UniformBuffer(unsigned int size, unsigned int binding);
+	~UniformBuffer();
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	// Update `size` bytes starting at `offset`.
+	void SetData(const void* data, unsigned int size, unsigned int offset = 0);
+
+	// Re-attach to the binding point, e.g. after something else used it.
+	void BindBase() const;
+
+	unsigned int GetID() const { return m_RendererID; }
+	unsigned int GetBinding() const { return m_Binding; }
+	unsigned int GetSize() const { return m_Size; }
+
+private:
+	unsigned int m_RendererID;
+	unsigned int m_Size;
+	unsigned int m_Binding;
+};
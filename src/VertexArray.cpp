@@ -1,46 +1,191 @@
 #include "VertexArray.h"
 #include "VertexBufferLayout.h"
+#include "VertexLayout.h"
+#include "GLState.h"
+#include "GpuResources.h"
+#include "InstanceBuffer.h"
+#include "DrawIndirectBuffer.h"
+#include "StreamingBuffer.h"
+
+#include <cstddef>
 VertexArray::VertexArray()
 {
-    GlCall(glGenVertexArrays(1, &m_RendererID));
-    GlCall(glBindVertexArray(m_RendererID));
+    if (GLState::HasDirectStateAccess())
+    {
+        GlCall(glCreateVertexArrays(1, &m_RendererID));
+    }
+    else
+    {
+        GlCall(glGenVertexArrays(1, &m_RendererID));
+    }
+    GLState::BindVertexArray(m_RendererID);
 }
 
 VertexArray::~VertexArray()
 {
-    GlCall(glDeleteVertexArrays(1, &m_RendererID));
+    GpuResources::Delete(GL_VERTEX_ARRAY, m_RendererID);
 }
 
+// The Add* calls leave the VAO bound, as they always have: an IndexBuffer
+// created or bound next is recorded in it.
 void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout)
 {
+    Bind();
+    SetLayout(layout);
+    BindVertexBuffer(VERTEX_BINDING, vb.GetID(), layout.GetStride());
+}
+
+void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexLayout& layout)
+{
+    Bind();
+    SetLayout(layout);
+    BindVertexBuffer(VERTEX_BINDING, vb.GetID(), layout.stride);
+}
+
+void VertexArray::SetLayout(const VertexBufferLayout& layout, unsigned int divisor)
+{
+    SetAttributeFormats(layout, VERTEX_BINDING);
+    SetBindingDivisor(VERTEX_BINDING, divisor);
+}
+
+void VertexArray::SetLayout(const VertexLayout& layout, unsigned int divisor)
+{
+    SetAttributeFormats(layout, VERTEX_BINDING);
+    SetBindingDivisor(VERTEX_BINDING, divisor);
+}
+
+void VertexArray::AddStreamingBuffer(const StreamingBuffer& stream, const VertexBufferLayout& layout, unsigned int divisor)
+{
+    Bind();
+    SetLayout(layout, divisor);
+    BindVertexBuffer(VERTEX_BINDING, stream.GetID(), layout.GetStride());
+}
 
+void VertexArray::AddStreamingBuffer(const StreamingBuffer& stream, const VertexLayout& layout, unsigned int divisor)
+{
     Bind();
-	vb.Bind();
+    SetLayout(layout, divisor);
+    BindVertexBuffer(VERTEX_BINDING, stream.GetID(), layout.stride);
+}
+
+void VertexArray::SetAttributeFormats(const VertexBufferLayout& layout, unsigned int binding)
+{
     const auto& Elements = layout.GetElements();
     unsigned int offset = 0;
     for (unsigned int i = 0; i < Elements.size(); i++)
     {
         const auto& element = Elements[i];
-        // Enable the first attribute (position) in the shader
-        GlCall(glEnableVertexAttribArray(i));
-        // Specify how OpenGL should interpret the vertex data
-        GlCall(glVertexAttribPointer(i, element.count, element.type, 
-            element.normalised, 
-            layout.GetStride(), 
-            (const void*)offset));
+        // Where attribute i sits within one vertex, and the binding it reads from
+        SetAttributeFormat(i, element.count, element.type, element.normalised != GL_FALSE, offset, binding);
+        offset += element.getSize();
+    }
+}
 
-        offset += element.count * VertexBufferElement::getSizeOfType(element.type);
+void VertexArray::SetAttributeFormats(const VertexLayout& layout, unsigned int binding)
+{
+    // The offsets were worked out at compile time
+    for (unsigned int i = 0; i < layout.count; i++)
+    {
+        const VertexAttribute& attribute = layout.attributes[i];
+        SetAttributeFormat(i, attribute.count, attribute.type, attribute.normalised, attribute.offset, binding);
+    }
+}
 
+void VertexArray::SetAttributeFormat(unsigned int location, int count, unsigned int type, bool normalised,
+    unsigned int offset, unsigned int binding, bool integer)
+{
+    if (GLState::HasDirectStateAccess())
+    {
+        GlCall(glEnableVertexArrayAttrib(m_RendererID, location));
+        if (integer)
+        {
+            GlCall(glVertexArrayAttribIFormat(m_RendererID, location, count, type, offset));
+        }
+        else
+        {
+            GlCall(glVertexArrayAttribFormat(m_RendererID, location, count, type, normalised, offset));
+        }
+        GlCall(glVertexArrayAttribBinding(m_RendererID, location, binding));
+        return;
     }
 
+    Bind();
+    GlCall(glEnableVertexAttribArray(location));
+    if (integer)
+    {
+        GlCall(glVertexAttribIFormat(location, count, type, offset));
+    }
+    else
+    {
+        GlCall(glVertexAttribFormat(location, count, type, normalised, offset));
+    }
+    GlCall(glVertexAttribBinding(location, binding));
+}
+
+void VertexArray::SetBindingDivisor(unsigned int binding, unsigned int divisor)
+{
+    if (GLState::HasDirectStateAccess())
+    {
+        GlCall(glVertexArrayBindingDivisor(m_RendererID, binding, divisor));
+        return;
+    }
+    Bind();
+    GlCall(glVertexBindingDivisor(binding, divisor));
+}
+
+void VertexArray::BindVertexBuffer(unsigned int binding, unsigned int buffer, unsigned int stride, unsigned int offset) const
+{
+    if (GLState::HasDirectStateAccess())
+    {
+        GlCall(glVertexArrayVertexBuffer(m_RendererID, binding, buffer, offset, stride));
+        return;
+    }
+    Bind();
+    GlCall(glBindVertexBuffer(binding, buffer, offset, stride));
+}
+
+void VertexArray::AddInstanceBuffer(const InstanceBuffer& instances)
+{
+    Bind();
+    SetInstanceLayout();
+    BindInstanceBuffer(instances);
+}
+
+void VertexArray::SetInstanceLayout()
+{
+    // A mat4 attribute is four vec4 attributes, one per column.
+    for (unsigned int column = 0; column < 4; column++)
+    {
+        SetAttributeFormat(InstanceBuffer::MODEL_LOCATION + column, 4, GL_FLOAT, false,
+            static_cast<unsigned int>(offsetof(InstanceData, model) + column * sizeof(glm::vec4)), INSTANCE_BINDING);
+    }
+    SetAttributeFormat(InstanceBuffer::COLOUR_LOCATION, 4, GL_FLOAT, false,
+        static_cast<unsigned int>(offsetof(InstanceData, colour)), INSTANCE_BINDING);
+
+    // Advance once per instance instead of once per vertex
+    SetBindingDivisor(INSTANCE_BINDING, 1);
+}
+
+void VertexArray::BindInstanceBuffer(const InstanceBuffer& instances) const
+{
+    BindVertexBuffer(INSTANCE_BINDING, instances.GetID(), sizeof(InstanceData));
+}
+
+void VertexArray::AddDrawIndirectBuffer(const DrawIndirectBuffer& indirect)
+{
+    Bind();
+    // Integer attribute: the I format keeps it a uint in the shader
+    SetAttributeFormat(DrawIndirectBuffer::DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, false, 0, DRAW_ID_BINDING, true);
+    SetBindingDivisor(DRAW_ID_BINDING, 1);
+    BindVertexBuffer(DRAW_ID_BINDING, indirect.GetDrawIDBuffer(), sizeof(unsigned int));
 }
 
 void VertexArray::Bind() const
 {
-    GlCall(glBindVertexArray(m_RendererID));
+    GLState::BindVertexArray(m_RendererID);
 }
 
 void VertexArray::unBind() const
 {
-    GlCall(glBindVertexArray(0));
+    GLState::BindVertexArray(0);
 }
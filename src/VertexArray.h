@@ -2,20 +2,96 @@
 #include "VertexBuffer.h"
 
 #include <iostream>
-class VertexBufferLayout; //forward declare it rather than importing to save the circler dependency issue with renderer 
+class VertexBufferLayout; //forward declare it rather than importing to save the circler dependency issue with renderer
+struct VertexLayout;
+class InstanceBuffer;
+class DrawIndirectBuffer;
+class StreamingBuffer;
 
+/**
+ * VertexArray — attribute formats, and which buffers feed them
+ *
+ * The attributes are set up with separate vertex formats (GL 4.3): each
+ * attribute's format (type, count, offset within the vertex) points at a
+ * binding point, and the buffer and stride are attached to the binding
+ * point on their own. So a VAO describes a layout once, and feeding it
+ * another buffer of the same layout is one BindVertexBuffer rather than a
+ * VAO per buffer or re-pointing every attribute:
+ *
+ *     VERTEX_BINDING     the mesh vertices (or a StreamingBuffer)
+ *     INSTANCE_BINDING   an InstanceBuffer, divisor 1
+ *     DRAW_ID_BINDING    a DrawIndirectBuffer's draw IDs, divisor 1
+ *
+ * That is what lets every arena mesh share MeshArena's VAOs: one per
+ * VertexFormat, and one more per format with the instance attributes, the
+ * RenderQueue rebinding only INSTANCE_BINDING as commands change buffer.
+ *
+ * With direct state access (GL 4.5 or ARB_direct_state_access, see
+ * GLState::HasDirectStateAccess) the VAO is set up through
+ * glVertexArray* without binding it; otherwise through the bound-VAO
+ * equivalents. The constructor binds the new VAO either way, since an
+ * IndexBuffer created next still attaches itself to the bound VAO.
+ */
 class VertexArray
 {
+public:
+	enum Binding : unsigned int
+	{
+		VERTEX_BINDING = 0,
+		INSTANCE_BINDING = 1,
+		DRAW_ID_BINDING = 2,
+	};
+
 private:
 	unsigned int m_RendererID;
 
+	// Enable attributes 0..n-1 with the layout's formats, reading from `binding`
+	void SetAttributeFormats(const VertexBufferLayout& layout, unsigned int binding);
+	void SetAttributeFormats(const VertexLayout& layout, unsigned int binding);
+	// One attribute's format; integer keeps it an int in the shader
+	void SetAttributeFormat(unsigned int location, int count, unsigned int type, bool normalised,
+		unsigned int offset, unsigned int binding, bool integer = false);
+	void SetBindingDivisor(unsigned int binding, unsigned int divisor);
+
 public:
 	VertexArray();
 	~VertexArray();
 
 	void AddBuffer(const VertexBuffer &vb, const VertexBufferLayout &layout);
+	// From a vertex struct's compile-time layout (VertexLayout.h), e.g.
+	// AddBuffer(vb, GetVertexLayout<Vertex>())
+	void AddBuffer(const VertexBuffer& vb, const VertexLayout& layout);
+
+	// The layout's formats at VERTEX_BINDING with no buffer attached, for a
+	// VAO shared by every buffer of that layout (see BindVertexBuffer).
+	void SetLayout(const VertexBufferLayout& layout, unsigned int divisor = 0);
+	void SetLayout(const VertexLayout& layout, unsigned int divisor = 0);
+
+	// Same as AddBuffer, with the attributes reading from the start of a
+	// StreamingBuffer. Pick the region per frame with a baseVertex, or with
+	// a baseInstance for per-instance attributes (divisor 1).
+	void AddStreamingBuffer(const StreamingBuffer& stream, const VertexBufferLayout& layout, unsigned int divisor = 0);
+	void AddStreamingBuffer(const StreamingBuffer& stream, const VertexLayout& layout, unsigned int divisor = 0);
+
+	// Attach per-instance model matrix + colour attributes (divisor 1) at
+	// InstanceBuffer::MODEL_LOCATION / COLOUR_LOCATION. See InstanceBuffer.h.
+	void AddInstanceBuffer(const InstanceBuffer& instances);
+	// The instance attributes alone, no buffer attached: BindInstanceBuffer
+	// picks it per draw.
+	void SetInstanceLayout();
+
+	// Attach the a_DrawID attribute (divisor 1) used by multi-draw indirect
+	// shaders at DrawIndirectBuffer::DRAW_ID_LOCATION. See DrawIndirectBuffer.h.
+	void AddDrawIndirectBuffer(const DrawIndirectBuffer& indirect);
+
+	// Point a binding at another buffer; the formats stay as they are.
+	// Binds this VAO first when there is no direct state access.
+	void BindVertexBuffer(unsigned int binding, unsigned int buffer, unsigned int stride, unsigned int offset = 0) const;
+	void BindInstanceBuffer(const InstanceBuffer& instances) const;
 
 	void Bind() const;
 
 	void unBind() const;
-};
\ No newline at end of file
+
+	unsigned int GetID() const { return m_RendererID; }
+};
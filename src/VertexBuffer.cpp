@@ -1,29 +1,58 @@
 #include "VertexBuffer.h"
 #include "Renderer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
 
 VertexBuffer::VertexBuffer(const void* data, unsigned int size)
 {
-    GlCall(glGenBuffers(1, &m_RendererID));
-    GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));// Bind the buffer as an array buffer to upload vertex data
-    GlCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));// Upload the vertex data to the GPU buffer
+    if (!data)
+    {
+        // Mutable storage even with DSA: the owner re-specifies it to grow
+        if (GLState::HasDirectStateAccess())
+        {
+            GlCall(glCreateBuffers(1, &m_RendererID));
+            GlCall(glNamedBufferData(m_RendererID, size, nullptr, GL_STATIC_DRAW));
+        }
+        else
+        {
+            GlCall(glGenBuffers(1, &m_RendererID));
+            GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+            GlCall(glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STATIC_DRAW));
+        }
+        GpuMemory::TrackBuffer(GpuMemory::Category::Vertex, m_RendererID, size);
+        return;
+    }
+
+    // A recycled buffer the GPU has finished with, filled with glBufferSubData.
+    // Nothing needs it bound: VertexArray attaches buffers by name.
+    m_Handle = GpuResources::Get().CreateBuffer(size, data, GL_STATIC_DRAW);
+    m_RendererID = GpuResources::Get().GetBuffer(m_Handle);
 }
 
 VertexBuffer::VertexBuffer(unsigned int size)
 {
-    GlCall(glGenBuffers(1, &m_RendererID));
-    GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
-    GlCall(glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW));
+    m_Handle = GpuResources::Get().CreateBuffer(size, nullptr, GL_DYNAMIC_DRAW);
+    m_RendererID = GpuResources::Get().GetBuffer(m_Handle);
 }
 
 void VertexBuffer::Update(const void* data, unsigned int size, unsigned int offset) const
 {
+    if (GLState::HasDirectStateAccess())
+    {
+        GlCall(glNamedBufferSubData(m_RendererID, offset, size, data));
+        return;
+    }
     GlCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
     GlCall(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
 }
 
 VertexBuffer::~VertexBuffer()
 {
-    GlCall(glDeleteBuffers(1, &m_RendererID));
+    // Either way the GL buffer outlives the draws still queued on it
+    if (m_Handle.IsValid() && GpuResources::IsAlive())
+        GpuResources::Get().Release(m_Handle);
+    else
+        GpuResources::Delete(GL_BUFFER, m_RendererID);
 }
 
 void VertexBuffer::Bind() const
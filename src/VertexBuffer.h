@@ -1,11 +1,19 @@
 #pragma once
 //a vertex buffer (VBO) is used to store vertex data, such as position, color, normals, or texture coordinates, on the GPU for rendering. When you create and bind a VBO, you upload your vertex data from the CPU to the GPU's memory. This data is then used by the GPU to efficiently render objects in the scene. The VBO is part of the graphics pipeline, and it works in conjunction with vertex shaders to process each vertex. By storing vertex data in the GPU's memory, OpenGL minimizes the overhead of repeatedly sending data from the CPU, improving rendering performance, especially in complex scenes or real-time applications like games.
 
+#include "GpuResources.h"
+
 class VertexBuffer
 {
 private:
 	unsigned int m_RendererID;
+	BufferHandle m_Handle;   // invalid for a buffer outside the pool
 public:
+	// Both come from the GpuResources pool (the storage may be larger than
+	// size) and go back to it when the GPU is done with them, except for
+	// data == nullptr: that buffer is the caller's to re-specify with
+	// glBufferData (the MeshArena grows its buffers in place), so it is
+	// allocated exactly and only its deletion is deferred.
 	VertexBuffer(const void* data, unsigned int size);
 	VertexBuffer(unsigned int size); // Allocates empty buffer with GL_DYNAMIC_DRAW
 	~VertexBuffer();
@@ -13,4 +21,5 @@ public:
 	void Bind() const;
 	void Unbind() const;
 	void Update(const void* data, unsigned int size, unsigned int offset = 0) const;
+	inline unsigned int GetID() const { return m_RendererID; }
 };
\ No newline at end of file
@@ -1,7 +1,13 @@
 #pragma once
 #include <vector>
+#include <cstdint>
 #include "Renderer.h"
 
+// Tag types for Push, for attribute types C++ has no built-in type for.
+// They are the size of the data they stand for.
+struct HalfFloat { uint16_t bits; };             // IEEE 754 binary16, GL_HALF_FLOAT
+struct PackedSnorm2101010 { uint32_t bits; };    // x, y, z 10 bits + w 2 bits, GL_INT_2_10_10_10_REV
+
 struct VertexBufferElement
 {
 	unsigned int type;
@@ -15,12 +21,24 @@ struct VertexBufferElement
 			case GL_FLOAT: return 4;
 			case GL_UNSIGNED_INT: return 4;
 			case GL_UNSIGNED_BYTE: return 1;
+			case GL_SHORT: return 2;
+			case GL_HALF_FLOAT: return 2;
 			default: throw std::runtime_error("Unknown type!");
 		}
 		ASSERT(false);
 		return 0;
 
 	}
+
+	// Bytes this element occupies in a vertex. Packed types hold all their
+	// components in one 32-bit word.
+	unsigned int getSize() const
+	{
+		if (type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV)
+			return 4;
+		return count * getSizeOfType(type);
+	}
+
 	VertexBufferElement(unsigned int type, unsigned int count, unsigned char normalised)
 		: type(type), count(count), normalised(normalised)
 	{
@@ -62,6 +80,31 @@ public:
 		m_Stride += count * VertexBufferElement::getSizeOfType(GL_UNSIGNED_BYTE);
 	}
 
-	inline const std::vector<VertexBufferElement> GetElements() const { return m_Elements; }
+	// Signed shorts, normalised to [-1, 1] like unsigned char is to [0, 1]
+	template<>
+	void Push<short>(unsigned int count)
+	{
+		m_Elements.push_back({ GL_SHORT, count, GL_TRUE });
+		m_Stride += count * VertexBufferElement::getSizeOfType(GL_SHORT);
+	}
+
+	template<>
+	void Push<HalfFloat>(unsigned int count)
+	{
+		m_Elements.push_back({ GL_HALF_FLOAT, count, GL_FALSE });
+		m_Stride += count * VertexBufferElement::getSizeOfType(GL_HALF_FLOAT);
+	}
+
+	// Always 4 components in one word (GL requires size 4 for packed
+	// types); `count` is ignored. Normalised to [-1, 1], so a vec3 input
+	// gets x, y, z directly.
+	template<>
+	void Push<PackedSnorm2101010>(unsigned int count)
+	{
+		m_Elements.push_back({ GL_INT_2_10_10_10_REV, 4, GL_TRUE });
+		m_Stride += m_Elements.back().getSize();
+	}
+
+	inline const std::vector<VertexBufferElement>& GetElements() const { return m_Elements; }
 	inline unsigned int GetStride() const { return m_Stride; }
 };
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <GL/glew.h>
+
+/**
+ * VertexLayout — a vertex struct's attribute formats, worked out at compile time
+ *
+ * VertexBufferLayout is built at runtime, one Push per attribute, into a
+ * vector that has to agree with the struct it describes with nothing
+ * checking that it does: reorder a member or pad the struct and the
+ * attributes quietly read the wrong bytes. For a vertex type shared by many
+ * meshes (Vertex, PackedVertex) the layout can instead be a constexpr table
+ * next to the struct, with every offset taken from offsetof:
+ *
+ *     template<> struct VertexLayoutOf<Vertex>
+ *     {
+ *         static constexpr VertexAttribute attributes[] = {
+ *             VERTEX_ATTRIBUTE(Vertex, position, GL_FLOAT, 3, false),
+ *             ...
+ *         };
+ *     };
+ *     static_assert(VertexLayoutMatchesMembers<Vertex>(), "...");
+ *     static_assert(VertexLayoutIsTightlyPacked<Vertex>(), "...");
+ *
+ * The first checks that each attribute's GL type and count cover its
+ * member exactly (sizeof the member), the second that the attributes
+ * follow one another from offset 0 to sizeof(V) with no gap or overlap. So
+ * changing the struct without its table fails to compile.
+ *
+ * GetVertexLayout<V>() hands VertexArray a VertexLayout: a pointer to the
+ * static table, its length and the stride, so setting up a VAO from it
+ * allocates nothing.
+ * Attribute i is at location i, as with VertexBufferLayout.
+ */
+
+struct VertexAttribute
+{
+	unsigned int type;       // GL_FLOAT, GL_HALF_FLOAT, GL_INT_2_10_10_10_REV ...
+	unsigned int count;      // components (4 for the packed types)
+	bool         normalised;
+	unsigned int offset;     // within the vertex
+	unsigned int memberSize; // sizeof the struct member it reads
+
+	// Bytes the GL format reads. Packed types hold all their components in
+	// one 32-bit word.
+	constexpr unsigned int GetSize() const
+	{
+		return type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV ? 4
+			: count * GetTypeSize(type);
+	}
+
+	static constexpr unsigned int GetTypeSize(unsigned int type)
+	{
+		return type == GL_FLOAT || type == GL_INT || type == GL_UNSIGNED_INT ? 4
+			: type == GL_HALF_FLOAT || type == GL_SHORT || type == GL_UNSIGNED_SHORT ? 2
+			: type == GL_BYTE || type == GL_UNSIGNED_BYTE ? 1
+			: 0;
+	}
+};
+
+struct VertexLayout
+{
+	const VertexAttribute* attributes;
+	unsigned int count;
+	unsigned int stride;
+};
+
+// Specialise for each vertex struct, as above
+template<typename V>
+struct VertexLayoutOf;
+
+#define VERTEX_ATTRIBUTE(V, member, type, count, normalised) \
+	VertexAttribute{ type, count, normalised, static_cast<unsigned int>(offsetof(V, member)), \
+		static_cast<unsigned int>(sizeof(V::member)) }
+
+template<typename V>
+constexpr unsigned int GetVertexAttributeCount()
+{
+	return sizeof(VertexLayoutOf<V>::attributes) / sizeof(VertexAttribute);
+}
+
+template<typename V>
+constexpr VertexLayout GetVertexLayout()
+{
+	return VertexLayout{ VertexLayoutOf<V>::attributes, GetVertexAttributeCount<V>(), sizeof(V) };
+}
+
+// Each attribute's GL format reads exactly its member
+template<typename V>
+constexpr bool VertexLayoutMatchesMembers()
+{
+	for (unsigned int i = 0; i < GetVertexAttributeCount<V>(); i++)
+	{
+		const VertexAttribute& attribute = VertexLayoutOf<V>::attributes[i];
+		if (attribute.GetSize() == 0 || attribute.GetSize() != attribute.memberSize)
+			return false;
+	}
+	return true;
+}
+
+// The attributes cover the struct from offset 0 to sizeof(V), in order
+template<typename V>
+constexpr bool VertexLayoutIsTightlyPacked()
+{
+	unsigned int next = 0;
+	for (unsigned int i = 0; i < GetVertexAttributeCount<V>(); i++)
+	{
+		if (VertexLayoutOf<V>::attributes[i].offset != next)
+			return false;
+		next += VertexLayoutOf<V>::attributes[i].memberSize;
+	}
+	return next == sizeof(V);
+}
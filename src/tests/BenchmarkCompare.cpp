@@ -0,0 +1,263 @@
+#include "BenchmarkCompare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace test
+{
+    static void PrintUsage()
+    {
+        std::cout << "Usage: --compare BASELINE.samples.csv CANDIDATE.samples.csv [--threshold PERCENT]\n"
+                     "                 [--min-ms MS] [--alpha P] [--resamples N] [--scopes] [--filter NAME]..." << std::endl;
+    }
+
+    bool BenchmarkCompare::IsRequested(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            if (strcmp(argv[i], "--compare") == 0)
+                return true;
+        }
+        return false;
+    }
+
+    bool BenchmarkCompare::ParseArguments(int argc, char** argv, Settings& settings)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const char* arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (strcmp(arg, "--compare") == 0 && i + 2 < argc)
+            {
+                settings.baseline = argv[++i];
+                settings.candidate = argv[++i];
+            }
+            else if (strcmp(arg, "--scopes") == 0)
+                settings.scopes = true;
+            else if (strcmp(arg, "--threshold") == 0 && hasValue)
+                settings.threshold = static_cast<float>(atof(argv[++i]));
+            else if (strcmp(arg, "--min-ms") == 0 && hasValue)
+                settings.minMs = static_cast<float>(atof(argv[++i]));
+            else if (strcmp(arg, "--alpha") == 0 && hasValue)
+                settings.alpha = static_cast<float>(atof(argv[++i]));
+            else if (strcmp(arg, "--resamples") == 0 && hasValue)
+                settings.resamples = static_cast<unsigned int>(std::max(100, atoi(argv[++i])));
+            else if (strcmp(arg, "--filter") == 0 && hasValue)
+                settings.filters.push_back(argv[++i]);
+            else
+            {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                PrintUsage();
+                return false;
+            }
+        }
+        if (settings.baseline.empty() || settings.candidate.empty())
+        {
+            PrintUsage();
+            return false;
+        }
+        return true;
+    }
+
+    // One row as BenchmarkRunner::WriteSamples writes it: quoted test and
+    // series, the clock, then the samples. A doubled quote inside a quoted
+    // field is one quote.
+    static std::vector<std::string> SplitRow(const std::string& line)
+    {
+        std::vector<std::string> fields(1);
+        bool quoted = false;
+        for (std::size_t i = 0; i < line.size(); i++)
+        {
+            const char c = line[i];
+            if (c == '"' && quoted && i + 1 < line.size() && line[i + 1] == '"')
+                fields.back() += line[++i];
+            else if (c == '"')
+                quoted = !quoted;
+            else if (c == ',' && !quoted)
+                fields.emplace_back();
+            else if (c != '\r')
+                fields.back() += c;
+        }
+        return fields;
+    }
+
+    bool BenchmarkCompare::Load(const std::string& path, std::vector<Series>& series)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cerr << "Compare: can't read " << path << std::endl;
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            const std::vector<std::string> fields = SplitRow(line);
+            if (fields.size() < 4)
+                continue;
+            Series row;
+            row.test = fields[0];
+            row.name = fields[1];
+            row.clock = fields[2];
+            for (std::size_t i = 3; i < fields.size(); i++)
+                row.samples.push_back(static_cast<float>(atof(fields[i].c_str())));
+            series.push_back(row);
+        }
+        if (series.empty())
+            std::cerr << "Compare: no samples in " << path << std::endl;
+        return !series.empty();
+    }
+
+    static float Median(std::vector<float> samples)
+    {
+        const std::size_t middle = samples.size() / 2;
+        std::nth_element(samples.begin(), samples.begin() + middle, samples.end());
+        const float upper = samples[middle];
+        if (samples.size() % 2 != 0)
+            return upper;
+        const float lower = *std::max_element(samples.begin(), samples.begin() + middle);
+        return 0.5f * (lower + upper);
+    }
+
+    // Two-sided, with ties given their average rank and the variance
+    // corrected for them
+    static float MannWhitneyP(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        std::vector<std::pair<float, int>> all;
+        for (float x : a)
+            all.push_back({ x, 0 });
+        for (float x : b)
+            all.push_back({ x, 1 });
+        std::sort(all.begin(), all.end());
+
+        const double n1 = static_cast<double>(a.size());
+        const double n2 = static_cast<double>(b.size());
+        const double n = n1 + n2;
+        double rankSumA = 0.0;
+        double ties = 0.0;
+        for (std::size_t i = 0; i < all.size();)
+        {
+            std::size_t j = i;
+            while (j < all.size() && all[j].first == all[i].first)
+                j++;
+            const double rank = 0.5 * static_cast<double>(i + 1 + j);     // ranks i+1..j
+            const double t = static_cast<double>(j - i);
+            ties += t * t * t - t;
+            for (std::size_t k = i; k < j; k++)
+            {
+                if (all[k].second == 0)
+                    rankSumA += rank;
+            }
+            i = j;
+        }
+
+        const double u = rankSumA - n1 * (n1 + 1.0) / 2.0;
+        const double variance = n1 * n2 / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0)));
+        if (variance <= 0.0)
+            return 1.0f;
+        const double z = (u - n1 * n2 / 2.0) / std::sqrt(variance);
+        return static_cast<float>(std::erfc(std::fabs(z) / std::sqrt(2.0)));
+    }
+
+    BenchmarkCompare::Result BenchmarkCompare::Compare(const std::vector<float>& base, const std::vector<float>& candidate,
+        const Settings& settings)
+    {
+        Result result;
+        result.baseMedian = Median(base);
+        result.candidateMedian = Median(candidate);
+        if (result.baseMedian <= 0.0f)
+            return result;
+        result.change = result.candidateMedian / result.baseMedian - 1.0f;
+        result.p = MannWhitneyP(base, candidate);
+
+        std::mt19937 rng(0x5EED);
+        std::uniform_int_distribution<std::size_t> pickBase(0, base.size() - 1);
+        std::uniform_int_distribution<std::size_t> pickCandidate(0, candidate.size() - 1);
+        std::vector<float> changes(settings.resamples);
+        std::vector<float> a(base.size());
+        std::vector<float> b(candidate.size());
+        for (float& change : changes)
+        {
+            for (float& x : a)
+                x = base[pickBase(rng)];
+            for (float& x : b)
+                x = candidate[pickCandidate(rng)];
+            const float median = Median(a);
+            change = median > 0.0f ? Median(b) / median - 1.0f : 0.0f;
+        }
+        std::sort(changes.begin(), changes.end());
+        result.changeLow = changes[static_cast<std::size_t>(0.025f * (changes.size() - 1))];
+        result.changeHigh = changes[static_cast<std::size_t>(0.975f * (changes.size() - 1))];
+        return result;
+    }
+
+    int BenchmarkCompare::Run(int argc, char** argv)
+    {
+        Settings settings;
+        if (!ParseArguments(argc, argv, settings))
+            return 2;
+
+        std::vector<Series> base, candidate;
+        if (!Load(settings.baseline, base) || !Load(settings.candidate, candidate))
+            return 2;
+
+        unsigned int regressions = 0;
+        printf("%-24s %-36s %-5s %10s %10s %8s %18s %8s\n", "test", "series", "clock", "base ms", "new ms",
+            "change", "95% CI", "p");
+        for (const Series& before : base)
+        {
+            bool wanted = settings.filters.empty();
+            for (const std::string& filter : settings.filters)
+                wanted = wanted || before.test.find(filter) != std::string::npos;
+            const bool gated = before.name == "(frame)" || settings.scopes;
+            if (!wanted || !gated)
+                continue;
+
+            const Series* after = nullptr;
+            for (const Series& row : candidate)
+            {
+                if (row.test == before.test && row.name == before.name && row.clock == before.clock)
+                    after = &row;
+            }
+            if (!after)
+            {
+                // A scope can come and go with the code; a test can't
+                const bool missingTest = std::none_of(candidate.begin(), candidate.end(),
+                    [&before](const Series& row) { return row.test == before.test; });
+                printf("%-24s %-36s %-5s missing%s\n", before.test.c_str(), before.name.c_str(), before.clock.c_str(),
+                    missingTest ? "  REGRESSION" : "");
+                if (missingTest && before.name == "(frame)")
+                    regressions++;
+                continue;
+            }
+
+            const Result result = Compare(before.samples, after->samples, settings);
+            const bool regressed = result.p < settings.alpha
+                && result.changeLow * 100.0f > settings.threshold
+                && result.candidateMedian - result.baseMedian > settings.minMs;
+            const bool improved = result.p < settings.alpha
+                && result.changeHigh * 100.0f < -settings.threshold
+                && result.baseMedian - result.candidateMedian > settings.minMs;
+            if (regressed)
+                regressions++;
+
+            printf("%-24s %-36s %-5s %10.3f %10.3f %+7.1f%% [%+6.1f%%, %+6.1f%%] %8.4f%s\n", before.test.c_str(),
+                before.name.c_str(), before.clock.c_str(), result.baseMedian, result.candidateMedian,
+                result.change * 100.0f, result.changeLow * 100.0f, result.changeHigh * 100.0f, result.p,
+                regressed ? "  REGRESSION" : (improved ? "  improved" : ""));
+        }
+
+        if (regressions > 0)
+            printf("%u regression(s) over %.1f%%\n", regressions, settings.threshold);
+        else
+            printf("No regressions over %.1f%%\n", settings.threshold);
+        return regressions > 0 ? 1 : 0;
+    }
+}
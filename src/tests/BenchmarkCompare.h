@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace test
+{
+    /**
+     * BenchmarkCompare — one benchmark run against another, as a build gate
+     *
+     * `--compare` on the command line runs this instead of opening a
+     * window. It reads the `.samples.csv` of two BenchmarkRunner runs, a
+     * baseline and a candidate, and for each test and series (the frame
+     * time, and with `--scopes` every profiler scope on both clocks)
+     * compares the two sets of samples:
+     *
+     *     change    of the median, candidate against baseline
+     *     95% CI    of that change, by bootstrap: both sets resampled with
+     *               replacement `resamples` times, from a fixed seed so the
+     *               same files always give the same answer
+     *     p         two-sided Mann-Whitney U, from the normal approximation;
+     *               it makes no assumption about the shape of the
+     *               distribution, which frame times rarely follow
+     *
+     * A series regresses when p < `alpha`, the whole interval lies above
+     * `threshold` percent, and the medians are more than `minMs` apart, so
+     * a noisy run or a scope too small to matter doesn't fail the build.
+     * A test missing from the candidate counts as a regression.
+     *
+     *     Renderer.exe --compare base.samples.csv new.samples.csv --threshold 5
+     *         --filter "GPU Particles" --filter "Shadow Mapping" --filter "High Density Mesh"
+     *
+     * The exit code is 0 if nothing regressed, 1 if something did and 2 if
+     * the arguments or files were bad.
+     */
+    class BenchmarkCompare
+    {
+    public:
+        struct Settings
+        {
+            std::string baseline;
+            std::string candidate;
+            float threshold = 5.0f;             // percent
+            float minMs = 0.05f;
+            float alpha = 0.05f;
+            unsigned int resamples = 2000;
+            bool scopes = false;                // gate every scope, not just the frame time
+            std::vector<std::string> filters;   // tests whose name contains any; all if empty
+        };
+
+        // True if the command line asks for a comparison
+        static bool IsRequested(int argc, char** argv);
+        // Parses the arguments, compares, prints a table; the exit code
+        static int Run(int argc, char** argv);
+
+    private:
+        struct Series
+        {
+            std::string test;
+            std::string name;                   // "(frame)" or a scope path
+            std::string clock;                  // wall, cpu or gpu
+            std::vector<float> samples;
+        };
+
+        struct Result
+        {
+            float baseMedian = 0.0f;
+            float candidateMedian = 0.0f;
+            float change = 0.0f;                // fraction of the baseline median
+            float changeLow = 0.0f;             // 95% CI
+            float changeHigh = 0.0f;
+            float p = 1.0f;
+        };
+
+        static bool ParseArguments(int argc, char** argv, Settings& settings);
+        static bool Load(const std::string& path, std::vector<Series>& series);
+        static Result Compare(const std::vector<float>& base, const std::vector<float>& candidate,
+            const Settings& settings);
+    };
+}
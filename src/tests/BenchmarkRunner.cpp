@@ -0,0 +1,445 @@
+#include "BenchmarkRunner.h"
+#include "../Shader.h"
+#include "../Input.h"
+#include "../AllocationCounter.h"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace test
+{
+    static void PrintUsage()
+    {
+        std::cout << "Usage: --benchmark [--frames N] [--warmup N] [--size WxH] [--hidden]\n"
+                     "                   [--dt SECONDS] [--filter NAME] [--out PATH] [--replay PATH]\n"
+                     "                   [--capture] [--capture-every N]" << std::endl;
+    }
+
+    bool BenchmarkRunner::ParseArguments(int argc, char** argv, Settings& settings)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const char* arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (strcmp(arg, "--benchmark") == 0)
+                settings.enabled = true;
+            else if (strcmp(arg, "--hidden") == 0)
+                settings.hidden = true;
+            else if (strcmp(arg, "--capture") == 0)
+                settings.capture = true;
+            else if (strcmp(arg, "--capture-every") == 0 && hasValue)
+                settings.captureEvery = std::max(0, atoi(argv[++i]));
+            else if (strcmp(arg, "--frames") == 0 && hasValue)
+                settings.frames = std::max(1, atoi(argv[++i]));
+            else if (strcmp(arg, "--warmup") == 0 && hasValue)
+                settings.warmupFrames = std::max(0, atoi(argv[++i]));
+            else if (strcmp(arg, "--dt") == 0 && hasValue)
+                settings.deltaTime = static_cast<float>(atof(argv[++i]));
+            else if (strcmp(arg, "--filter") == 0 && hasValue)
+                settings.filter = argv[++i];
+            else if (strcmp(arg, "--out") == 0 && hasValue)
+                settings.output = argv[++i];
+            else if (strcmp(arg, "--replay") == 0 && hasValue)
+                settings.replay = argv[++i];
+            else if (strcmp(arg, "--size") == 0 && hasValue)
+            {
+                int width = 0, height = 0;
+                if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+                {
+                    PrintUsage();
+                    return false;
+                }
+                settings.width = width;
+                settings.height = height;
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                PrintUsage();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    BenchmarkRunner::BenchmarkRunner(TestMenu& menu, const Settings& settings)
+        : m_Menu(menu)
+        , m_Settings(settings)
+        , m_Index(0)
+        , m_Test(nullptr)
+        , m_Phase(Phase::Load)
+        , m_PhaseFrame(0)
+        , m_HeapAllocations(0)
+        , m_HeapAllocationsMax(0)
+        , m_HeapBytes(0)
+    {
+        const GLubyte* renderer = glGetString(GL_RENDERER);
+        m_Renderer = renderer ? reinterpret_cast<const char*>(renderer) : "";
+
+        // The first test that passes the filter
+        m_Index = 0;
+        while (m_Index < m_Menu.GetTestCount() && m_Menu.GetTestName(m_Index).find(m_Settings.filter) == std::string::npos)
+            m_Index++;
+
+        Profiler::SetEnabled(true);
+    }
+
+    BenchmarkRunner::~BenchmarkRunner()
+    {
+        delete m_Test;
+        m_Capture.Flush();
+        const FrameCapture::Stats capture = m_Capture.GetStats();
+        if (capture.requested > 0)
+        {
+            std::cout << "Benchmark: " << capture.written << " frames captured, " << capture.dropped << " dropped, "
+                      << capture.failed << " failed" << std::endl;
+        }
+    }
+
+    Tests* BenchmarkRunner::BeginFrame()
+    {
+        if (m_Index >= m_Menu.GetTestCount())
+            return nullptr;
+
+        if (!m_Test)
+        {
+            std::cout << "Benchmark: " << m_Menu.GetTestName(m_Index) << std::endl;
+            m_LoadStart = Clock::now();
+            // Peaks from here are this test's: the last one's objects are
+            // gone or pooled by the time it was deleted
+            GpuMemory::ResetPeaks();
+            m_Test = m_Menu.CreateTest(m_Index);
+            Input::OnTestStarted();
+            m_Phase = Phase::Load;
+            m_PhaseFrame = 0;
+            m_FrameMs.clear();
+            // So recording a frame doesn't count against the next one
+            m_FrameMs.reserve(m_Settings.frames);
+            m_HeapAllocations = 0;
+            m_HeapAllocationsMax = 0;
+            m_HeapBytes = 0;
+            m_Results.push_back(TestResult());
+            m_Results.back().name = m_Menu.GetTestName(m_Index);
+        }
+
+        m_FrameStart = Clock::now();
+        return m_Test;
+    }
+
+    void BenchmarkRunner::OnRendered()
+    {
+        if (!m_Test)
+            return;
+
+        // m_PhaseFrame counts the frames before this one. The golden image
+        // is the first drain frame, so it never lands in a measured one.
+        const bool golden = m_Settings.capture && m_Phase == Phase::Drain && m_PhaseFrame == 0;
+        const bool sequence = m_Settings.captureEvery > 0 && m_Phase == Phase::Measure
+            && m_PhaseFrame % m_Settings.captureEvery == 0;
+        // Nothing more on the frames that capture nothing: they are inside
+        // the AllocationCounter window
+        if (!golden && !sequence)
+            return;
+
+        // The backbuffer's own size: --size asks for a window, and the
+        // framebuffer under it differs on high-DPI displays or when the
+        // window manager won't fit it
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+        if (width <= 0 || height <= 0)
+            return;
+
+        const std::string name = m_Settings.output + "." + FrameCapture::SanitizeName(m_Menu.GetTestName(m_Index));
+        if (golden)
+            m_Capture.CaptureBackbuffer(width, height, name + ".png");
+
+        if (sequence)
+        {
+            char frame[16];
+            snprintf(frame, sizeof(frame), ".%05d.rgba", m_PhaseFrame);
+            m_Capture.CaptureBackbuffer(width, height, name + frame, FrameCapture::Format::Raw);
+        }
+    }
+
+    void BenchmarkRunner::EndFrame()
+    {
+        m_Capture.Poll();
+        if (!m_Test)
+            return;
+
+        const float frameMs = std::chrono::duration<float, std::milli>(Clock::now() - m_FrameStart).count();
+        m_PhaseFrame++;
+
+        switch (m_Phase)
+        {
+        case Phase::Load:
+            // The main loop doesn't run a test while its shaders compile
+            if (Shader::PollPending() == 0)
+            {
+                m_Results.back().loadMs = std::chrono::duration<float, std::milli>(Clock::now() - m_LoadStart).count();
+                m_Phase = Phase::Warmup;
+                m_PhaseFrame = 0;
+            }
+            break;
+
+        case Phase::Warmup:
+            break;
+
+        case Phase::Measure:
+        {
+            m_FrameMs.push_back(frameMs);
+            const AllocationCounter::Stats& heap = AllocationCounter::GetLastFrame();
+            m_HeapAllocations += heap.allocations;
+            m_HeapAllocationsMax = std::max(m_HeapAllocationsMax, heap.allocations);
+            m_HeapBytes += heap.bytes;
+            break;
+        }
+
+        case Phase::Drain:
+            break;
+        }
+
+        if (m_Phase == Phase::Warmup && m_PhaseFrame >= m_Settings.warmupFrames)
+        {
+            // Applies at the next Profiler::BeginFrame, the first measured
+            // frame, and drops the warm-up's queries still in flight
+            Profiler::Reset();
+            m_Phase = Phase::Measure;
+            m_PhaseFrame = 0;
+        }
+        else if (m_Phase == Phase::Measure && m_PhaseFrame >= m_Settings.frames)
+        {
+            CollectCpu();
+            m_Phase = Phase::Drain;
+            m_PhaseFrame = 0;
+        }
+
+        // The last measured frame's timestamps are read back at the start
+        // of the FRAMES'th frame after it, so that one has to have run
+        if (m_Phase == Phase::Drain && m_PhaseFrame >= static_cast<int>(Profiler::FRAMES))
+        {
+            CollectGpu();
+            NextTest();
+        }
+    }
+
+    void BenchmarkRunner::NextTest()
+    {
+        Input::OnTestEnded();
+        delete m_Test;
+        m_Test = nullptr;
+        Profiler::Reset();
+
+        m_Index++;
+        while (m_Index < m_Menu.GetTestCount() && m_Menu.GetTestName(m_Index).find(m_Settings.filter) == std::string::npos)
+            m_Index++;
+    }
+
+    void BenchmarkRunner::CollectCpu()
+    {
+        TestResult& result = m_Results.back();
+        result.frames = static_cast<unsigned int>(m_FrameMs.size());
+        result.frameMs = m_FrameMs;
+        if (!m_FrameMs.empty())
+        {
+            std::vector<float> sorted = m_FrameMs;
+            std::sort(sorted.begin(), sorted.end());
+            float sum = 0.0f;
+            for (float ms : sorted)
+                sum += ms;
+            result.frameMean = sum / static_cast<float>(sorted.size());
+            result.frameP95 = sorted[(sorted.size() * 95 + 99) / 100 - 1];
+            result.frameMax = sorted.back();
+
+            const float frames = static_cast<float>(m_FrameMs.size());
+            result.heapAllocationsMean = static_cast<float>(m_HeapAllocations) / frames;
+            result.heapAllocationsMax = m_HeapAllocationsMax;
+            result.heapBytesMean = static_cast<float>(m_HeapBytes) / frames;
+            std::cout << "  heap allocations per frame " << result.heapAllocationsMean << " (max "
+                      << result.heapAllocationsMax << ")" << std::endl;
+        }
+
+        const std::vector<Profiler::Scope>& scopes = Profiler::GetScopes();
+        result.scopes.clear();
+        for (unsigned int i = 0; i < scopes.size(); i++)
+        {
+            ScopeResult scope;
+            scope.name = scopes[i].name;
+            scope.path = scopes[i].parent == Profiler::NONE ? scope.name : result.scopes[scopes[i].parent].path + "/" + scope.name;
+            scope.depth = scopes[i].depth;
+            scope.cpu = Profiler::GetCpuStats(i);
+            Profiler::GetHistory(scopes[i].cpu, scopes[i].cpuCount, scope.cpuSamples);
+            result.scopes.push_back(scope);
+        }
+    }
+
+    void BenchmarkRunner::CollectGpu()
+    {
+        // The drain frames added scopes only after the measured ones, so the
+        // indices still line up
+        TestResult& result = m_Results.back();
+        result.memoryPeak = GpuMemory::GetPeakBytes();
+        for (int i = 0; i < static_cast<int>(GpuMemory::Category::Count); i++)
+            result.memoryPeakByCategory[i] = GpuMemory::GetUsage(static_cast<GpuMemory::Category>(i)).peakBytes;
+        std::cout << "  GPU memory peak " << result.memoryPeak / (1024.0f * 1024.0f) << " MB" << std::endl;
+        const std::vector<Profiler::Scope>& scopes = Profiler::GetScopes();
+        for (unsigned int i = 0; i < result.scopes.size(); i++)
+        {
+            result.scopes[i].gpu = Profiler::GetGpuStats(i);
+            Profiler::GetHistory(scopes[i].gpu, scopes[i].gpuCount, result.scopes[i].gpuSamples);
+        }
+    }
+
+    std::string BenchmarkRunner::GetStatus() const
+    {
+        if (!m_Test)
+            return "Benchmark done";
+
+        const char* phases[] = { "loading", "warming up", "measuring", "draining" };
+        const int total[] = { 0, m_Settings.warmupFrames, m_Settings.frames, static_cast<int>(Profiler::FRAMES) };
+        const int phase = static_cast<int>(m_Phase);
+        char status[256];
+        snprintf(status, sizeof(status), "Benchmark %s: %s %d / %d", m_Menu.GetTestName(m_Index).c_str(),
+            phases[phase], m_PhaseFrame, total[phase]);
+        return status;
+    }
+
+    // Test and scope names are plain text, but may hold a quote
+    static std::string JsonString(const std::string& text)
+    {
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                quoted += '\\';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    // A quoted CSV field, its quotes doubled
+    static std::string CsvString(const std::string& text)
+    {
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"')
+                quoted += '"';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    static void WriteJsonStats(std::ofstream& json, const Profiler::Stats& stats)
+    {
+        json << "{ \"mean\": " << stats.mean << ", \"p95\": " << stats.p95 << ", \"max\": " << stats.max
+             << ", \"samples\": " << stats.samples << " }";
+    }
+
+    bool BenchmarkRunner::WriteResults() const
+    {
+        std::ofstream csv(m_Settings.output + ".csv");
+        std::ofstream json(m_Settings.output + ".json");
+        if (!csv || !json)
+        {
+            std::cerr << "Benchmark: can't write " << m_Settings.output << ".csv/.json" << std::endl;
+            return false;
+        }
+
+        // "(frame)" is the wall-clock frame, the rest are profiler scopes
+        csv << "test,scope,depth,cpu_mean_ms,cpu_p95_ms,cpu_max_ms,gpu_mean_ms,gpu_p95_ms,gpu_max_ms\n";
+        for (const TestResult& result : m_Results)
+        {
+            csv << CsvString(result.name) << ",(frame),0," << result.frameMean << ',' << result.frameP95 << ','
+                << result.frameMax << ",,,\n";
+            for (const ScopeResult& scope : result.scopes)
+            {
+                csv << CsvString(result.name) << ',' << CsvString(scope.name) << ',' << scope.depth << ','
+                    << scope.cpu.mean << ',' << scope.cpu.p95 << ',' << scope.cpu.max << ',';
+                if (scope.gpu.samples > 0)
+                    csv << scope.gpu.mean << ',' << scope.gpu.p95 << ',' << scope.gpu.max;
+                else
+                    csv << ",,";
+                csv << '\n';
+            }
+        }
+
+        json << "{\n  \"renderer\": " << JsonString(m_Renderer) << ",\n"
+             << "  \"settings\": { \"warmupFrames\": " << m_Settings.warmupFrames << ", \"frames\": " << m_Settings.frames
+             << ", \"width\": " << m_Settings.width << ", \"height\": " << m_Settings.height
+             << ", \"deltaTime\": " << m_Settings.deltaTime << " },\n  \"tests\": [\n";
+        for (std::size_t t = 0; t < m_Results.size(); t++)
+        {
+            const TestResult& result = m_Results[t];
+            json << "    {\n      \"name\": " << JsonString(result.name) << ",\n"
+                 << "      \"loadMs\": " << result.loadMs << ",\n"
+                 << "      \"frames\": " << result.frames << ",\n"
+                 << "      \"frameMs\": { \"mean\": " << result.frameMean << ", \"p95\": " << result.frameP95
+                 << ", \"max\": " << result.frameMax << " },\n"
+                 << "      \"gpuMemoryPeak\": { \"total\": " << result.memoryPeak;
+            for (int i = 0; i < static_cast<int>(GpuMemory::Category::Count); i++)
+            {
+                json << ", " << JsonString(GpuMemory::GetCategoryName(static_cast<GpuMemory::Category>(i))) << ": "
+                     << result.memoryPeakByCategory[i];
+            }
+            json << " },\n"
+                 << "      \"heapPerFrame\": { \"allocations\": " << result.heapAllocationsMean
+                 << ", \"maxAllocations\": " << result.heapAllocationsMax << ", \"bytes\": " << result.heapBytesMean << " },\n"
+                 << "      \"scopes\": [\n";
+            for (std::size_t s = 0; s < result.scopes.size(); s++)
+            {
+                const ScopeResult& scope = result.scopes[s];
+                json << "        { \"name\": " << JsonString(scope.name) << ", \"depth\": " << scope.depth << ", \"cpu\": ";
+                WriteJsonStats(json, scope.cpu);
+                json << ", \"gpu\": ";
+                WriteJsonStats(json, scope.gpu);
+                json << (s + 1 < result.scopes.size() ? " },\n" : " }\n");
+            }
+            json << "      ]\n    }" << (t + 1 < m_Results.size() ? ",\n" : "\n");
+        }
+        json << "  ]\n}\n";
+
+        std::cout << "Benchmark: " << m_Results.size() << " tests written to " << m_Settings.output << ".csv/.json" << std::endl;
+        return WriteSamples();
+    }
+
+    static void WriteSampleRow(std::ofstream& file, const std::string& test, const std::string& series,
+        const char* clock, const std::vector<float>& samples)
+    {
+        if (samples.empty())
+            return;
+        file << CsvString(test) << ',' << CsvString(series) << ',' << clock;
+        for (float ms : samples)
+            file << ',' << ms;
+        file << '\n';
+    }
+
+    bool BenchmarkRunner::WriteSamples() const
+    {
+        const std::string path = m_Settings.output + ".samples.csv";
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cerr << "Benchmark: can't write " << path << std::endl;
+            return false;
+        }
+
+        // test,series,clock,ms... where series is "(frame)" or a scope path
+        for (const TestResult& result : m_Results)
+        {
+            WriteSampleRow(file, result.name, "(frame)", "wall", result.frameMs);
+            for (const ScopeResult& scope : result.scopes)
+            {
+                WriteSampleRow(file, result.name, scope.path, "cpu", scope.cpuSamples);
+                WriteSampleRow(file, result.name, scope.path, "gpu", scope.gpuSamples);
+            }
+        }
+        return true;
+    }
+}
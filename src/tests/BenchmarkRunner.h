@@ -0,0 +1,158 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Tests.h"
+#include "../Profiler.h"
+#include "../GpuMemory.h"
+#include "../FrameCapture.h"
+
+namespace test
+{
+    /**
+     * BenchmarkRunner — every registered test, unattended, timed to a file
+     *
+     * `--benchmark` on the command line replaces the menu with this. Each
+     * test registered with TestMenu::RegisterTest is opened in turn and
+     * run with vsync off at a fixed window size:
+     *
+     *     load     until every shader it created has linked
+     *     warm-up  `warmupFrames`, so caches, pools and drivers settle
+     *     measure  `frames`, the ones reported
+     *     drain    Profiler::FRAMES more, until the GPU times of the
+     *              last measured frame have been read back
+     *
+     * Update is given a fixed `deltaTime` instead of the wall clock, so a
+     * simulation does the same work per frame however fast it runs: the
+     * frame time is cost, not pacing. The test's GUI still runs, as it
+     * does interactively.
+     *
+     * RESULTS
+     *   `<output>.csv` has a row per test and profiler scope; `<output>.json`
+     *   has the same nested per test, with the settings, the GL renderer
+     *   and the test's GPU memory high-water mark by category (GpuMemory)
+     *   and heap allocations per measured frame (AllocationCounter).
+     *   The frame time (start of a frame to the end of its swap) covers
+     *   every measured frame; the scope statistics cover the last
+     *   Profiler::HISTORY of them, which the default `frames` matches.
+     *   `<output>.samples.csv` has every one of those samples, a row per
+     *   series, for BenchmarkCompare to test one run against another.
+     *
+     *     Renderer.exe --benchmark --frames 600 --filter Particle --out particles
+     *
+     * INPUT
+     *   With `--replay PATH` every test is driven by an Input recording
+     *   (see Input.h) from the frame it opens, with the recording's frame
+     *   times in place of `deltaTime`, so a camera follows the same path
+     *   in every run and culling and LOD results compare across builds.
+     *   Without one, the input is live.
+     *
+     * CAPTURE
+     *   `--capture` writes each test's frame after the last measured one,
+     *   before ImGui draws, to `<output>.<test>.png`: golden images to diff
+     *   between builds (with a replay, the frames match). `--capture-every N`
+     *   also writes every Nth measured frame as `<output>.<test>.<frame>.rgba`
+     *   for video. Both go through FrameCapture, so a measured frame pays
+     *   for a queued copy, not for a readback or an encode.
+     */
+    class BenchmarkRunner
+    {
+    public:
+        struct Settings
+        {
+            bool enabled = false;
+            int warmupFrames = 60;
+            int frames = static_cast<int>(Profiler::HISTORY);
+            int width = 1920;
+            int height = 1080;
+            bool hidden = false;                // no visible window
+            float deltaTime = 1.0f / 60.0f;     // given to every Update
+            std::string filter;                 // only tests whose name contains it
+            std::string output = "benchmark";   // .csv and .json are appended
+            std::string replay;                 // an Input recording to drive every test
+            bool capture = false;               // golden PNG per test
+            int captureEvery = 0;               // raw video frames, every Nth measured frame (0: none)
+        };
+
+        // False, after printing the usage, on an argument it doesn't know
+        static bool ParseArguments(int argc, char** argv, Settings& settings);
+
+        BenchmarkRunner(TestMenu& menu, const Settings& settings);
+        ~BenchmarkRunner();
+        BenchmarkRunner(const BenchmarkRunner&) = delete;
+        BenchmarkRunner& operator=(const BenchmarkRunner&) = delete;
+
+        // At the top of the main loop: the test to run this frame, which
+        // the runner owns, or nullptr once every test is done
+        Tests* BeginFrame();
+        // After the test's Render, before ImGui draws: the frame captures
+        void OnRendered();
+        // After the swap
+        void EndFrame();
+
+        float GetDeltaTime() const { return m_Settings.deltaTime; }
+        // "Particle System: measuring 120 / 240", for the control panel
+        std::string GetStatus() const;
+
+        // Writes whatever has been measured so far; false if a file
+        // couldn't be opened
+        bool WriteResults() const;
+
+    private:
+        enum class Phase { Load, Warmup, Measure, Drain };
+
+        struct ScopeResult
+        {
+            std::string name;
+            std::string path;               // "Frame/Update/Compute", unique per test
+            unsigned int depth;
+            Profiler::Stats cpu;
+            Profiler::Stats gpu;
+            std::vector<float> cpuSamples;  // ms, oldest first
+            std::vector<float> gpuSamples;
+        };
+
+        struct TestResult
+        {
+            std::string name;
+            unsigned int frames = 0;
+            float frameMean = 0.0f;
+            float frameP95 = 0.0f;
+            float frameMax = 0.0f;
+            float loadMs = 0.0f;
+            std::vector<float> frameMs;     // every measured frame
+            std::size_t memoryPeak = 0;     // GpuMemory bytes, from the test opening
+            std::size_t memoryPeakByCategory[static_cast<int>(GpuMemory::Category::Count)] = {};
+            float heapAllocationsMean = 0.0f;   // per measured frame
+            std::size_t heapAllocationsMax = 0;
+            float heapBytesMean = 0.0f;
+            std::vector<ScopeResult> scopes;
+        };
+
+        typedef std::chrono::steady_clock Clock;
+
+        void NextTest();
+        void CollectCpu();
+        void CollectGpu();
+        bool WriteSamples() const;
+
+        TestMenu& m_Menu;
+        Settings m_Settings;
+        std::string m_Renderer;             // GL_RENDERER, for the JSON
+
+        std::size_t m_Index;                // of the test being run
+        Tests* m_Test;
+        Phase m_Phase;
+        int m_PhaseFrame;
+        Clock::time_point m_FrameStart;
+        Clock::time_point m_LoadStart;
+        std::vector<float> m_FrameMs;
+        std::size_t m_HeapAllocations;      // summed over the measured frames
+        std::size_t m_HeapAllocationsMax;
+        std::size_t m_HeapBytes;
+
+        std::vector<TestResult> m_Results;
+        FrameCapture m_Capture;
+    };
+}
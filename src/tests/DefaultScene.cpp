@@ -1,19 +1,23 @@
 #include "DefaultScene.h"
 #include "../Mesh/GeometryFactory.h"
 #include "GL/glew.h"
+#include "../FrameUniforms.h"
+#include "../GLState.h"
+#include "../ShaderLibrary.h"
 #include "glm/gtc/matrix_transform.hpp"
 
 namespace test
 {
     DefaultScene::DefaultScene()
     {
-        m_Shader = std::make_unique<Shader>("res/Shaders/DefaultScene.shader");
+        m_Shader = ShaderLibrary::Get("res/Shaders/DefaultScene.shader");
 
         // Flat cube slab — same technique as TestShadowMapping's ground plane.
         // Position (0, -0.05, 0) + Y scale 0.1 puts the top surface exactly at Y=0.
-        m_FloorMesh = GeometryFactory::CreateCube();
-        m_FloorMesh->setPosition(glm::vec3(0.0f, -1.0f, 0.0f));
-        m_FloorMesh->setScale(glm::vec3(200.0f, 0.1f, 200.0f));
+        m_FloorMesh = GeometryFactory::GetSharedCube();
+        glm::mat4 floor = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+        floor = glm::scale(floor, glm::vec3(200.0f, 0.1f, 200.0f));
+        m_Scene.Create(m_Scene.AddMesh(*m_FloorMesh), floor);
     }
 
     DefaultScene::~DefaultScene() = default;
@@ -22,18 +26,22 @@ namespace test
                               const glm::mat4& projection,
                               float tileSize)
     {
-        glClearColor(0.53f, 0.71f, 0.90f, 1.0f);  // soft sky blue
+        GLState::ClearColor(0.53f, 0.71f, 0.90f, 1.0f);  // soft sky blue
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        m_Shader->Bind();
-        m_Shader->setUniformMat4f("u_Model",      m_FloorMesh->getTransformMatrix());
-        m_Shader->setUniformMat4f("u_View",       view);
-        m_Shader->setUniformMat4f("u_Projection", projection);
+        // The camera position is the translation of the inverse view matrix
+        glm::vec3 cameraPos = glm::vec3(glm::inverse(view)[3]);
+        FrameUniforms::SetCamera(view, projection, cameraPos);
 
+        m_Shader->Bind();
         glm::vec3 lightDir = glm::normalize(glm::vec3(0.60f, 1.00f, 0.40f));
         m_Shader->setUniform3f("u_LightDir",  lightDir.x, lightDir.y, lightDir.z);
         m_Shader->setUniform1f("u_TileSize",  tileSize);
 
-        m_FloorMesh->Draw();
+        // u_Model is set per entity by the queue
+        m_Queue.Clear();
+        m_Scene.Cull(Frustum::FromMatrix(projection * view), m_Visible);
+        m_Scene.Submit(m_Queue, RenderPass::Opaque, *m_Shader, m_Visible);
+        m_Queue.Flush();
     }
 }
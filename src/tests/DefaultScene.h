@@ -3,9 +3,15 @@
 #include "glm/glm.hpp"
 #include "../Shader.h"
 #include "../Mesh/Mesh.h"
+#include "../Scene.h"
+#include "../RenderQueue.h"
 
 namespace test
 {
+    // Sky-blue clear and a tiled floor behind a test's own objects. The
+    // floor is an entity of a Scene, culled and drawn through a RenderQueue
+    // like anything else; a test can add entities with GetScene() and
+    // they are drawn with the same shader.
     class DefaultScene
     {
     public:
@@ -21,8 +27,14 @@ namespace test
                     const glm::mat4& projection,
                     float tileSize = 1.0f);
 
+        Scene& GetScene() { return m_Scene; }
+
     private:
-        std::unique_ptr<Shader> m_Shader;
-        std::unique_ptr<Mesh>   m_FloorMesh;
+        std::shared_ptr<Shader> m_Shader;          // from ShaderLibrary, shared with every other test's
+        std::shared_ptr<const Mesh> m_FloorMesh;   // shared with every other cube user
+
+        Scene                     m_Scene;
+        RenderQueue               m_Queue;
+        std::vector<unsigned int> m_Visible;
     };
 }
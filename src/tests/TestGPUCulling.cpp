@@ -0,0 +1,293 @@
+#include "TestGPUCulling.h"
+#include "../GLState.h"
+#include "../FrameUniforms.h"
+#include "../Renderer.h"
+#include "../ThreadPool.h"
+#include "../vendor/imgui/imgui.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+
+test::TestGPUCulling::TestGPUCulling(GLFWwindow* window)
+	: m_QueueReady(false),
+	  m_LightDirection(glm::normalize(glm::vec3(0.4f, -1.0f, 0.3f))),
+	  m_CullMode(CULL_GPU),
+	  m_FieldSize(300),
+	  m_CullMs(0.0f),
+	  m_CPUVisible(0)
+{
+	m_Camera = std::make_unique<Camera>(
+		window,
+		glm::vec3(0.0f, 15.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		-90.0f,
+		-10.0f,
+		45.0f
+	);
+
+	m_Shader = std::make_unique<Shader>("res/Shaders/Culling/CulledInstances.shader");
+
+	m_CubeMesh = GeometryFactory::GetSharedCube();
+	m_SphereMesh = GeometryFactory::GetSharedSphere(12, 12);
+
+	m_GPUCulling.AddMesh(*m_CubeMesh);     // mesh 0
+	m_GPUCulling.AddMesh(*m_SphereMesh);   // mesh 1
+
+	m_CubeInstances = std::make_unique<InstanceBuffer>(1024);
+	m_SphereInstances = std::make_unique<InstanceBuffer>(1024);
+
+	BuildInstances();
+
+	GLState::Enable(GL_DEPTH_TEST);
+}
+
+// Cheap integer hash for repeatable per-instance randomness
+static float Hash01(unsigned int x)
+{
+	x ^= x >> 16; x *= 0x45d9f3bu;
+	x ^= x >> 16; x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	return (x & 0xFFFFFF) / float(0xFFFFFF);
+}
+
+void test::TestGPUCulling::BuildInstances()
+{
+	const unsigned int count = static_cast<unsigned int>(m_FieldSize * m_FieldSize);
+
+	m_Instances.clear();
+	m_IsSphere.clear();
+	m_Instances.reserve(count);
+	m_IsSphere.reserve(count);
+	m_Bounds.Clear();
+	m_Bounds.Reserve(count);
+	m_GPUCulling.ClearInstances();
+
+	const float spacing = 2.5f;
+	const float start = -0.5f * spacing * (m_FieldSize - 1);
+	for (int z = 0; z < m_FieldSize; z++)
+	{
+		for (int x = 0; x < m_FieldSize; x++)
+		{
+			const unsigned int i = static_cast<unsigned int>(z * m_FieldSize + x);
+			const bool sphere = Hash01(i * 3 + 0) > 0.5f;
+
+			glm::vec3 position(start + x * spacing, 0.5f + 4.0f * Hash01(i * 3 + 1), start + z * spacing);
+			float scale = 0.4f + 0.6f * Hash01(i * 3 + 2);
+
+			InstanceData instance;
+			instance.model = glm::translate(glm::mat4(1.0f), position);
+			instance.model = glm::rotate(instance.model, 6.2831853f * Hash01(i * 7 + 5), glm::vec3(0, 1, 0));
+			instance.model = glm::scale(instance.model, glm::vec3(scale));
+			instance.colour = glm::vec4(0.4f + 0.6f * x / m_FieldSize, 0.5f, 0.4f + 0.6f * z / m_FieldSize, 1.0f);
+
+			const Mesh& mesh = sphere ? *m_SphereMesh : *m_CubeMesh;
+			m_Instances.push_back(instance);
+			m_IsSphere.push_back(sphere ? 1 : 0);
+			m_Bounds.Add(mesh.getWorldBounds(instance.model));
+			m_GPUCulling.AddInstance(sphere ? 1 : 0, instance);
+		}
+	}
+
+	m_GPUCulling.Upload();
+}
+
+void test::TestGPUCulling::Update(float deltaTime)
+{
+	m_Camera->processInput(deltaTime);
+	m_Camera->Update(deltaTime);
+
+	m_View = m_Camera->getViewMatrix();
+	m_Projection = glm::perspective(glm::radians(m_Camera->getFOV()), 1920.0f / 1080.0f, 0.1f, 500.0f);
+}
+
+void test::TestGPUCulling::RenderCPU(const glm::mat4& viewProjection)
+{
+	m_Bounds.Cull(Frustum::FromMatrix(viewProjection), m_Visible);
+
+	m_CubeUpload.clear();
+	m_SphereUpload.clear();
+	for (unsigned int i : m_Visible)
+		(m_IsSphere[i] ? m_SphereUpload : m_CubeUpload).push_back(m_Instances[i]);
+
+	m_CubeInstances->SetData(m_CubeUpload);
+	m_SphereInstances->SetData(m_SphereUpload);
+	m_CPUVisible = static_cast<unsigned int>(m_Visible.size());
+}
+
+void test::TestGPUCulling::RenderCPUThreaded(const glm::mat4& viewProjection)
+{
+	const unsigned int count = static_cast<unsigned int>(m_Instances.size());
+	const unsigned int chunks = (count + RECORD_CHUNK - 1) / RECORD_CHUNK;
+	const Frustum frustum = Frustum::FromMatrix(viewProjection);
+	const glm::vec3 eye = m_Camera->getPosition();
+
+	m_Queue.Clear();
+	m_Queue.ResizeBuckets(chunks);
+	if (m_ChunkVisible.size() < chunks)
+		m_ChunkVisible.resize(chunks);
+
+	// Room for every instance in both: chunk c writes from slot c * RECORD_CHUNK,
+	// so no two chunks ever touch the same memory
+	InstanceData* cubes = m_CubeInstances->Map(count);
+	InstanceData* spheres = m_SphereInstances->Map(count);
+	m_QueueReady = cubes && spheres;
+	if (!m_QueueReady)
+	{
+		m_CubeInstances->Unmap();
+		m_SphereInstances->Unmap();
+		m_CPUVisible = 0;
+		return;
+	}
+
+	ThreadPool::Get().ParallelFor(count, RECORD_CHUNK,
+		[&](unsigned int begin, unsigned int end, unsigned int)
+		{
+			std::vector<unsigned int>& visible = m_ChunkVisible[begin / RECORD_CHUNK];
+			visible.clear();
+			m_Bounds.CullRange(frustum, begin, end, visible);
+
+			unsigned int cubeCount = 0, sphereCount = 0;
+			float nearest[2] = { 1.0f, 1.0f };
+			for (unsigned int i : visible)
+			{
+				const InstanceData& instance = m_Instances[i];
+				const float depth01 = glm::distance(eye, glm::vec3(instance.model[3])) / 500.0f;
+				if (m_IsSphere[i])
+				{
+					spheres[begin + sphereCount++] = instance;
+					nearest[1] = std::min(nearest[1], depth01);
+				}
+				else
+				{
+					cubes[begin + cubeCount++] = instance;
+					nearest[0] = std::min(nearest[0], depth01);
+				}
+			}
+
+			RenderQueue::Bucket& bucket = m_Queue.GetBucket(begin / RECORD_CHUNK);
+			const Mesh* meshes[2] = { m_CubeMesh.get(), m_SphereMesh.get() };
+			const InstanceBuffer* buffers[2] = { m_CubeInstances.get(), m_SphereInstances.get() };
+			const unsigned int counts[2] = { cubeCount, sphereCount };
+			for (int m = 0; m < 2; m++)
+			{
+				if (counts[m] == 0)
+					continue;
+
+				const MeshArena::Range& range = meshes[m]->getArenaRange();
+				RenderCommand command;
+				command.shader = m_Shader.get();
+				command.vao = meshes[m]->getInstancedVertexArray();
+				command.ibo = meshes[m]->getIndexBuffer();
+				command.indexCount = range.indexCount;
+				command.firstIndex = range.firstIndex;
+				command.baseVertex = range.baseVertex;
+				command.instances = buffers[m];
+				command.firstInstance = begin;
+				command.instanceCount = counts[m];
+				command.modelUniform = nullptr;
+				bucket.Submit(RenderPass::Opaque, command, nearest[m]);
+			}
+		});
+
+	// Unmapping is a GL call, so it waits for every chunk to have written
+	m_QueueReady = m_CubeInstances->Unmap();
+	m_QueueReady = m_SphereInstances->Unmap() && m_QueueReady;
+	m_Queue.MergeBuckets();
+
+	m_CPUVisible = 0;
+	for (unsigned int c = 0; c < chunks; c++)
+		m_CPUVisible += static_cast<unsigned int>(m_ChunkVisible[c].size());
+}
+
+void test::TestGPUCulling::Render()
+{
+	Renderer renderer;
+	renderer.Clear();
+
+	FrameUniforms::SetCamera(m_View, m_Projection, m_Camera->getPosition());
+	const glm::mat4 viewProjection = m_Projection * m_View;
+
+	// Everything up to the draw is what the CPU pays per frame
+	auto start = std::chrono::steady_clock::now();
+	if (m_CullMode == CULL_CPU)
+	{
+		RenderCPU(viewProjection);
+	}
+	else if (m_CullMode == CULL_CPU_THREADED)
+	{
+		RenderCPUThreaded(viewProjection);
+	}
+	else
+	{
+		m_GPUCulling.SetEnabled(m_CullMode == CULL_GPU);
+		m_GPUCulling.Cull(viewProjection);
+	}
+	m_CullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	m_Shader->Bind();
+	m_Shader->setUniform3f("u_LightDirection", m_LightDirection.x, m_LightDirection.y, m_LightDirection.z);
+
+	if (m_CullMode == CULL_CPU)
+	{
+		const MeshArena::Range& cube = m_CubeMesh->getArenaRange();
+		const MeshArena::Range& sphere = m_SphereMesh->getArenaRange();
+
+		// Same VAO for both meshes (the bind is elided); only the instance
+		// buffer changes
+		m_CubeMesh->getInstancedVertexArray()->Bind();
+		m_CubeMesh->getInstancedVertexArray()->BindInstanceBuffer(*m_CubeInstances);
+		renderer.DrawIndexedInstanced(cube.indexCount, m_CubeInstances->GetCount(), cube.firstIndex, cube.baseVertex,
+			0, m_CubeMesh->getIndexBuffer()->GetType());
+		m_SphereMesh->getInstancedVertexArray()->Bind();
+		m_SphereMesh->getInstancedVertexArray()->BindInstanceBuffer(*m_SphereInstances);
+		renderer.DrawIndexedInstanced(sphere.indexCount, m_SphereInstances->GetCount(), sphere.firstIndex, sphere.baseVertex,
+			0, m_SphereMesh->getIndexBuffer()->GetType());
+	}
+	else if (m_CullMode == CULL_CPU_THREADED)
+	{
+		if (m_QueueReady)
+			m_Queue.Flush();
+	}
+	else
+	{
+		m_GPUCulling.Draw();
+	}
+}
+
+void test::TestGPUCulling::RenderGUI()
+{
+	ImGui::Text("GPU-Driven Culling");
+	ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+	ImGui::Separator();
+
+	if (ImGui::SliderInt("Field size", &m_FieldSize, 10, 700))
+	{
+		BuildInstances();
+	}
+	ImGui::Text("Instances: %u", static_cast<unsigned int>(m_Instances.size()));
+
+	ImGui::RadioButton("GPU culling", &m_CullMode, CULL_GPU); ImGui::SameLine();
+	ImGui::RadioButton("CPU culling", &m_CullMode, CULL_CPU); ImGui::SameLine();
+	ImGui::RadioButton("No culling", &m_CullMode, CULL_NONE);
+	ImGui::RadioButton("CPU culling, threaded", &m_CullMode, CULL_CPU_THREADED);
+
+	if (m_CullMode == CULL_CPU)
+	{
+		ImGui::Text("Visible: %u", m_CPUVisible);
+	}
+	else if (m_CullMode == CULL_CPU_THREADED)
+	{
+		const RenderQueue::Stats& stats = m_Queue.GetStats();
+		ImGui::Text("Visible: %u", m_CPUVisible);
+		ImGui::Text("Chunks: %u of %u instances  Threads: %u", static_cast<unsigned int>((m_Instances.size() + RECORD_CHUNK - 1) / RECORD_CHUNK),
+			RECORD_CHUNK, ThreadPool::Get().GetThreadCount() + 1);
+		ImGui::Text("Commands: %u  Draw calls: %u", stats.commands, stats.drawCalls);
+	}
+	else
+	{
+		const GPUCulling::Stats& stats = m_GPUCulling.GetStats();
+		ImGui::Text("Visible: %u (read back a frame late)", stats.visible);
+		ImGui::Text("Work groups: %u  Draw calls: 1", stats.dispatches);
+	}
+	ImGui::Text("CPU cull + upload: %.3f ms", m_CullMs);
+}
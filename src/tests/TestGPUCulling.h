@@ -0,0 +1,76 @@
+#pragma once
+#include "Tests.h"
+#include "../Shader.h"
+#include "../GPUCulling.h"
+#include "../InstanceBuffer.h"
+#include "../Culling.h"
+#include "../RenderQueue.h"
+#include "../Mesh/GeometryFactory.h"
+#include "../utils/Camera.h"
+#include <memory>
+#include "GL/glew.h"
+#include <GLFW/glfw3.h>
+#include "glm/glm.hpp"
+
+namespace test
+{
+	// A large field of instanced cubes and spheres, frustum culled either on
+	// the GPU (GPUCulling), on the CPU (CullBatch + InstanceBuffer upload), on
+	// the CPU across the ThreadPool (recorded into RenderQueue buckets) or not
+	// at all, to compare where the per-frame cost goes as N grows.
+	class TestGPUCulling : public Tests
+	{
+	public:
+		TestGPUCulling(GLFWwindow* window);
+
+		void Update(float deltaTime) override;
+		void Render() override;
+		void RenderGUI() override;
+
+	private:
+		enum CullMode { CULL_GPU = 0, CULL_CPU = 1, CULL_NONE = 2, CULL_CPU_THREADED = 3 };
+
+		// Instances per ParallelFor chunk, and so per RenderQueue bucket
+		static const unsigned int RECORD_CHUNK = 4096;
+
+		void BuildInstances();
+		void RenderCPU(const glm::mat4& viewProjection);
+		void RenderCPUThreaded(const glm::mat4& viewProjection);
+
+		std::unique_ptr<Camera> m_Camera;
+		std::unique_ptr<Shader> m_Shader;
+
+		std::shared_ptr<const Mesh> m_CubeMesh;     // GeometryFactory's shared geometry
+		std::shared_ptr<const Mesh> m_SphereMesh;
+
+		// GPU path: every instance uploaded once, culled by a compute shader
+		GPUCulling m_GPUCulling;
+
+		// CPU path: world bounds of every instance, culled each frame and
+		// the survivors uploaded per mesh
+		std::vector<InstanceData> m_Instances;
+		std::vector<unsigned char> m_IsSphere;
+		CullBatch m_Bounds;
+		std::vector<unsigned int> m_Visible;
+		std::vector<InstanceData> m_CubeUpload;
+		std::vector<InstanceData> m_SphereUpload;
+		std::unique_ptr<InstanceBuffer> m_CubeInstances;
+		std::unique_ptr<InstanceBuffer> m_SphereInstances;
+
+		// Threaded CPU path: each chunk culls its range, writes the survivors
+		// straight into the mapped instance buffers at its own offset and
+		// records up to two commands (cubes, spheres) into its bucket
+		RenderQueue m_Queue;
+		std::vector<std::vector<unsigned int>> m_ChunkVisible;
+		bool m_QueueReady;
+
+		glm::mat4 m_View;
+		glm::mat4 m_Projection;
+		glm::vec3 m_LightDirection;
+
+		int m_CullMode;
+		int m_FieldSize;            // instances = m_FieldSize^2
+		float m_CullMs;             // CPU time spent culling + uploading/dispatching
+		unsigned int m_CPUVisible;
+	};
+}
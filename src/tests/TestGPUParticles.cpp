@@ -1,9 +1,16 @@
 #include "TestGPUParticles.h"
+#include "../GLState.h"
+#include "../GpuMemory.h"
+#include "../Profiler.h"
+#include <GLFW/glfw3.h>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
 
 namespace test
 {
-    // Particle struct matching the GLSL layout (std430)
+    // The full particle layout of the GLSL (std430)
     struct GPUParticle
     {
         glm::vec2 pos;
@@ -12,74 +19,217 @@ namespace test
         float life;
         float maxLife;
         float size;
-        float _pad;
+        unsigned int seed;
     };
 
-    TestGPUParticles::TestGPUParticles(GLFWwindow* /*window*/)
-        : m_SSBO(0)
+    // The packed layout: see LoadParticle in the shaders
+    struct PackedGPUParticle
+    {
+        unsigned int pos;           // 16-bit fixed point x, y
+        unsigned int vel;           // half x, y
+        unsigned int life;          // 16-bit fraction of maxLife, half maxLife
+        unsigned int sizeSeed;      // half size, 16-bit seed
+    };
+
+    static std::size_t ParticleBytes(bool packed)
+    {
+        return packed ? sizeof(PackedGPUParticle) : sizeof(GPUParticle);
+    }
+
+    // The Counters block of GPUParticleCompute.glsl (std430, all uints)
+    struct GPUParticleCounters
+    {
+        unsigned int deadCount;
+        unsigned int aliveCount;
+        unsigned int nextAliveCount;
+        unsigned int emitCount;
+        unsigned int emitArgs[3];       // glDispatchComputeIndirect
+        unsigned int simulateArgs[3];
+        unsigned int drawArgs[4];       // glDrawArraysIndirect: count, instanceCount, first, baseInstance
+    };
+
+    // The Cells block of GPUParticleInteract.glsl: statistics, then a
+    // (count, start) pair per cell
+    struct GPUParticleGrid
+    {
+        unsigned int occupiedCells;
+        unsigned int maxPerCell;
+        unsigned int _pad[2];
+    };
+
+    // An entry of the EmitterTable block (std140, vec4s only)
+    struct GPUEmitter
+    {
+        glm::vec4 position;             // xy, z gravity
+        glm::vec4 colorStart;
+        glm::vec4 colorEnd;
+        glm::vec4 speedLife;            // speed min, max, life min, max
+        glm::vec4 size;                 // min, max
+        unsigned int emission[4];       // first, count
+    };
+
+    static float RandRange(float lo, float hi)
+    {
+        return lo + (hi - lo) * static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    }
+
+    // What ReadCounters copies back
+    struct GPUParticleReadback
+    {
+        unsigned int counters[4];       // GPUParticleCounters' first four
+        unsigned int occupiedCells;
+        unsigned int maxPerCell;
+    };
+
+    TestGPUParticles::TestGPUParticles(GLFWwindow* window)
+        : m_Window(window)
+        , m_SSBO(0)
+        , m_PackedLayout(false)
+        , m_DeadList(0)
+        , m_Current(0)
+        , m_CounterBuffer(0)
         , m_VAO(0)
-        , m_EmitterPos(480.0f, 300.0f)
-        , m_Gravity(-200.0f)
-        , m_EmissionRate(5000.0f)
-        , m_SpeedMin(50.0f)
-        , m_SpeedMax(200.0f)
-        , m_LifeMin(1.0f)
-        , m_LifeMax(3.0f)
-        , m_SizeMin(2.0f)
-        , m_SizeMax(8.0f)
+        , m_Blend(Blend::Additive)
+        , m_Sort(false)
+        , m_SortKeys(0)
+        , m_SortValues(0)
+        , m_SortSize(SORT_BLOCK)
+        , m_SortPasses(0)
+        , m_Interact(false)
+        , m_CellSize(8.0f)
+        , m_Repulsion(2000.0f)
+        , m_Restitution(0.3f)
+        , m_Floor(40.0f)
+        , m_ObstaclePos(480.0f, 160.0f)
+        , m_ObstacleRadius(60.0f)
+        , m_GridWidth(1)
+        , m_GridHeight(1)
+        , m_CellBuffer(0)
+        , m_ParticleCellBuffer(0)
+        , m_GridBuffer(0)
+        , m_OccupiedCells(0)
+        , m_MaxPerCell(0)
+        , m_Selected(0)
         , m_MaxParticles(100000)
-        , m_ColourStart(1.0f, 0.6f, 0.1f, 1.0f)
-        , m_ColourEnd(1.0f, 0.0f, 0.0f, 0.0f)
-        , m_Time(0.0f)
-        , m_QueryBack(0)
-        , m_ComputeTimeMs(0.0f)
-        , m_RenderTimeMs(0.0f)
-        , m_FrameHistoryIdx(0)
-    {
-        memset(m_FrameTimeHistory, 0, sizeof(m_FrameTimeHistory));
-        memset(m_ComputeTimeHistory, 0, sizeof(m_ComputeTimeHistory));
-        memset(m_RenderTimeHistory, 0, sizeof(m_RenderTimeHistory));
-
-        // Create GL timer queries (double-buffered: write to front, read from back)
-        GlCall(glGenQueries(2, m_QueryCompute));
-        GlCall(glGenQueries(2, m_QueryRender));
-        // Issue dummy queries so the first readback doesn't stall
-        for (int i = 0; i < 2; i++)
+        , m_Frame(0)
+        , m_AliveCount(0)
+        , m_DeadCount(0)
+        , m_EmitCount(0)
+        , m_EmitRequested(0)
+        , m_EnableBloom(true)
+    {
+        memset(m_RequestedEmit, 0, sizeof(m_RequestedEmit));
+        memset(m_ReadbackFence, 0, sizeof(m_ReadbackFence));
+        memset(m_ReadbackFrame, 0, sizeof(m_ReadbackFrame));
+        memset(m_Storage, 0, sizeof(m_Storage));
+        m_BarrierMark = MemoryBarriers::GetStats();
+        memset(m_LayoutTiming, 0, sizeof(m_LayoutTiming));
+
+        // Create SSBOs. Nothing reads a slot before it's emitted into, so
+        // the particles need no initial data; ResetParticles fills the lists.
+        GlCall(glGenBuffers(1, &m_SSBO));
+        AllocateParticles();
+
+        GlCall(glGenBuffers(1, &m_DeadList));
+        GlCall(glGenBuffers(2, m_AliveList));
+        const unsigned int lists[] = { m_DeadList, m_AliveList[0], m_AliveList[1] };
+        for (unsigned int list : lists)
         {
-            GlCall(glBeginQuery(GL_TIME_ELAPSED, m_QueryCompute[i]));
-            GlCall(glEndQuery(GL_TIME_ELAPSED));
-            GlCall(glBeginQuery(GL_TIME_ELAPSED, m_QueryRender[i]));
-            GlCall(glEndQuery(GL_TIME_ELAPSED));
+            GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, list));
+            GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_PARTICLES * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW));
+            GpuMemory::TrackBuffer(GpuMemory::Category::Storage, list, MAX_PARTICLES * sizeof(unsigned int));
         }
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
 
-        // Initialize all particles as dead
-        std::vector<GPUParticle> particles(MAX_PARTICLES);
-        for (auto& p : particles)
+        // Keys and values for the largest sort
+        unsigned int maxSortSize = SORT_BLOCK;
+        while (maxSortSize < MAX_PARTICLES)
+            maxSortSize *= 2;
+        GlCall(glGenBuffers(1, &m_SortKeys));
+        GlCall(glGenBuffers(1, &m_SortValues));
+        const unsigned int sortBuffers[] = { m_SortKeys, m_SortValues };
+        for (unsigned int buffer : sortBuffers)
         {
-            p.pos = glm::vec2(0.0f);
-            p.vel = glm::vec2(0.0f);
-            p.color = glm::vec4(0.0f);
-            p.life = 0.0f;
-            p.maxLife = 1.0f;
-            p.size = 0.0f;
-            p._pad = 0.0f;
+            GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer));
+            GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, maxSortSize * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW));
+            GpuMemory::TrackBuffer(GpuMemory::Category::Storage, buffer, maxSortSize * sizeof(unsigned int));
         }
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
 
-        // Create SSBO
-        GlCall(glGenBuffers(1, &m_SSBO));
-        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_SSBO));
-        GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER,
-            MAX_PARTICLES * sizeof(GPUParticle),
-            particles.data(), GL_DYNAMIC_DRAW));
-        GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_SSBO));
+        // The grid at its finest, and an entry per particle twice over
+        const unsigned int maxCells = static_cast<unsigned int>(std::ceil(WORLD_WIDTH / MIN_CELL_SIZE)) *
+            static_cast<unsigned int>(std::ceil(WORLD_HEIGHT / MIN_CELL_SIZE));
+        GlCall(glGenBuffers(1, &m_CellBuffer));
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CellBuffer));
+        GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPUParticleGrid) + maxCells * 2 * sizeof(unsigned int), nullptr,
+            GL_DYNAMIC_DRAW));
+        GlCall(glGenBuffers(1, &m_ParticleCellBuffer));
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ParticleCellBuffer));
+        GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_PARTICLES * 2 * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW));
+        GlCall(glGenBuffers(1, &m_GridBuffer));
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_GridBuffer));
+        GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_PARTICLES * 4 * sizeof(float), nullptr, GL_DYNAMIC_DRAW));
         GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+        GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_CellBuffer, sizeof(GPUParticleGrid) + maxCells * 2 * sizeof(unsigned int));
+        GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_ParticleCellBuffer, MAX_PARTICLES * 2 * sizeof(unsigned int));
+        GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_GridBuffer, MAX_PARTICLES * 4 * sizeof(float));
+
+        GlCall(glGenBuffers(1, &m_CounterBuffer));
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CounterBuffer));
+        GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPUParticleCounters), nullptr, GL_DYNAMIC_DRAW));
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+        GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_CounterBuffer, sizeof(GPUParticleCounters));
+
+        GlCall(glGenBuffers(2, m_Readback));
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Readback[i]));
+            GlCall(glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GPUParticleReadback), nullptr, GL_STREAM_READ));
+            GpuMemory::TrackBuffer(GpuMemory::Category::Staging, m_Readback[i], sizeof(GPUParticleReadback));
+        }
 
         // Create empty VAO for vertex-pulling render
         GlCall(glGenVertexArrays(1, &m_VAO));
 
         // Load shaders
         m_ComputeShader = std::make_unique<ComputeShader>(R"(res/Shaders/GPUParticleCompute.glsl)");
+        m_SortShader = std::make_unique<ComputeShader>(R"(res/Shaders/GPUParticleSort.glsl)");
+        m_InteractShader = std::make_unique<ComputeShader>(R"(res/Shaders/GPUParticleInteract.glsl)");
         m_RenderShader = std::make_unique<Shader>(R"(res/Shaders/GPUParticleRender.shader)");
+        m_PresentShader = std::make_unique<Shader>(R"(res/Shaders/Effects/Present.shader)");
+        m_Quad = GeometryFactory::CreateFullscreenQuad();
+
+        // Every emitter's parameters, read by the emit and simulate stages
+        // and the render; a free slot costs nothing but its 96 bytes
+        m_Emitters.resize(MAX_EMITTERS);
+        for (Emitter& emitter : m_Emitters)
+        {
+            emitter.active = false;
+            emitter.retire = 0.0f;
+        }
+        m_EmitterTable = std::make_unique<UniformBuffer>(MAX_EMITTERS * sizeof(GPUEmitter), EMITTER_BINDING);
+
+        Emitter fountain;
+        fountain.pos = glm::vec2(480.0f, 300.0f);
+        fountain.gravity = -200.0f;
+        fountain.rate = 5000.0f;
+        fountain.speedMin = 50.0f;
+        fountain.speedMax = 200.0f;
+        fountain.lifeMin = 1.0f;
+        fountain.lifeMax = 3.0f;
+        fountain.sizeMin = 2.0f;
+        fountain.sizeMax = 8.0f;
+        fountain.colourStart = glm::vec4(1.0f, 0.6f, 0.1f, 1.0f);
+        fountain.colourEnd = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        AddEmitter(fountain);
+
+        ResetParticles();
+
+        // Only what the blend pushes past white glows
+        m_Bloom.effect = PostProcessChain::Effect::Bloom;
+        m_Bloom.threshold = 1.0f;
+        m_Bloom.knee = 0.5f;
+        m_Bloom.intensity = 0.8f;
 
         // Orthographic projection matching the window
         m_Proj = glm::ortho(0.0f, 960.0f, 0.0f, 540.0f, -1.0f, 1.0f);
@@ -90,96 +240,531 @@ namespace test
 
     TestGPUParticles::~TestGPUParticles()
     {
-        GlCall(glDeleteQueries(2, m_QueryCompute));
-        GlCall(glDeleteQueries(2, m_QueryRender));
-        GlCall(glDeleteBuffers(1, &m_SSBO));
+        const unsigned int buffers[] = { m_SSBO, m_DeadList, m_AliveList[0], m_AliveList[1], m_SortKeys, m_SortValues,
+            m_CellBuffer, m_ParticleCellBuffer, m_GridBuffer, m_CounterBuffer, m_Readback[0], m_Readback[1] };
+        for (unsigned int buffer : buffers)
+        {
+            GlCall(glDeleteBuffers(1, &buffer));
+            GLState::OnBufferDeleted(buffer);
+        }
         GlCall(glDeleteVertexArrays(1, &m_VAO));
+        GLState::OnVertexArrayDeleted(m_VAO);
+        for (GLsync fence : m_ReadbackFence)
+        {
+            if (fence)
+                glDeleteSync(fence);
+        }
     }
 
     void TestGPUParticles::Update(float deltaTime)
     {
         if (deltaTime > 0.1f) deltaTime = 0.1f;
-        m_Time += deltaTime;
 
-        // Read back timer results from the PREVIOUS frame (no stall — it's 1 frame old)
-        int back = m_QueryBack;
-        GLuint64 computeNs = 0, renderNs = 0;
-        GlCall(glGetQueryObjectui64v(m_QueryCompute[back], GL_QUERY_RESULT, &computeNs));
-        GlCall(glGetQueryObjectui64v(m_QueryRender[back], GL_QUERY_RESULT, &renderNs));
-        m_ComputeTimeMs = static_cast<float>(computeNs) / 1000000.0f;
-        m_RenderTimeMs = static_cast<float>(renderNs) / 1000000.0f;
+        // Smoothed per layout, so switching shows both side by side. The
+        // Profiler's GPU times are a few frames old, which a layout switch
+        // blurs for a moment at most.
+        LayoutTiming& timing = m_LayoutTiming[m_PackedLayout ? 1 : 0];
+        timing.computeMs += (Profiler::GetGpuMs("Compute") - timing.computeMs) * 0.05f;
+        timing.renderMs += (Profiler::GetGpuMs("Draw") - timing.renderMs) * 0.05f;
+        timing.alive = m_AliveCount;
+
+        const MemoryBarriers::Stats& barriers = MemoryBarriers::GetStats();
+        m_BarrierFrame.uses = barriers.uses - m_BarrierMark.uses;
+        m_BarrierFrame.satisfied = barriers.satisfied - m_BarrierMark.satisfied;
+        m_BarrierFrame.barriers = barriers.barriers - m_BarrierMark.barriers;
+        m_BarrierFrame.bits = barriers.bits - m_BarrierMark.bits;
+        m_BarrierMark = barriers;
+
+        // Whole particles to emit this frame, of every emitter; the GPU
+        // clamps the total to the free slots
+        const unsigned int toEmit = UploadEmitters(deltaTime);
+
+        // Bind SSBOs
+        BindStorage(PARTICLE_BINDING, m_SSBO);
+        BindStorage(DEAD_BINDING, m_DeadList);
+        BindStorage(ALIVE_BINDING, m_AliveList[m_Current]);
+        BindStorage(NEXT_ALIVE_BINDING, m_AliveList[1 - m_Current]);
+        BindStorage(COUNTER_BINDING, m_CounterBuffer);
+
+        // Time the compute dispatches
+        {
+            PROFILE_SCOPE("Compute");
+            m_ComputeShader->Bind();
+            m_ComputeShader->setUniform1i("u_PackedLayout", m_PackedLayout ? 1 : 0);
+            m_ComputeShader->setUniform1f("u_DeltaTime", deltaTime);
+            m_EmitterTable->BindBase();
+            m_ComputeShader->setUniform1i("u_EmitCount", static_cast<int>(toEmit));
+            m_ComputeShader->setUniform1i("u_Frame", m_Frame);
+
+            // Only the emission and the live particles cost anything: the sizes
+            // of the middle two dispatches never come back to the CPU
+            RunStage(STAGE_PREPARE, 1);
+            RunStageIndirect(STAGE_EMIT, offsetof(GPUParticleCounters, emitArgs));
+            RunStageIndirect(STAGE_SIMULATE, offsetof(GPUParticleCounters, simulateArgs));
+            RunStage(STAGE_FINISH, 1);
+            GlCall(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0));
+        }
+
+        // No barrier here: the draw, the readback copy and any grid or sort
+        // pass each declare how they read what FINISH left
 
-        // Record history
-        m_FrameTimeHistory[m_FrameHistoryIdx] = deltaTime * 1000.0f;
-        m_ComputeTimeHistory[m_FrameHistoryIdx] = m_ComputeTimeMs;
-        m_RenderTimeHistory[m_FrameHistoryIdx] = m_RenderTimeMs;
-        m_FrameHistoryIdx = (m_FrameHistoryIdx + 1) % FRAME_HISTORY_SIZE;
+        m_ComputeShader->Unbind();
 
-        // Swap query buffers: now write to the one we just read
-        int front = 1 - back;
-        m_QueryBack = front;
+        // What was the next alive list is now the one to draw
+        m_Current = 1 - m_Current;
 
-        // Bind SSBO
-        GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_SSBO));
+        // Each its own scope, so they show apart from the simulation
+        if (m_Interact)
+        {
+            {
+                PROFILE_SCOPE("Grid");
+                BuildGrid();
+            }
+            PROFILE_SCOPE("Interact");
+            InteractParticles(deltaTime);
+        }
 
-        // Time the compute dispatch
-        GlCall(glBeginQuery(GL_TIME_ELAPSED, m_QueryCompute[front]));
+        if (m_Sort)
+        {
+            PROFILE_SCOPE("Sort");
+            SortParticles();
+        }
 
+        ReadCounters(toEmit);
+        m_Frame++;
+    }
+
+    unsigned int TestGPUParticles::AddEmitter(const Emitter& emitter)
+    {
+        for (unsigned int i = 0; i < MAX_EMITTERS; i++)
+        {
+            if (!m_Emitters[i].active && m_Emitters[i].retire <= 0.0f)
+            {
+                m_Emitters[i] = emitter;
+                m_Emitters[i].active = true;
+                m_Emitters[i].accum = 0.0f;
+                return i;
+            }
+        }
+        return MAX_EMITTERS;
+    }
+
+    void TestGPUParticles::RemoveEmitter(unsigned int index)
+    {
+        // Its particles live on under its parameters until they die
+        Emitter& emitter = m_Emitters[index];
+        emitter.active = false;
+        emitter.retire = emitter.lifeMax;
+    }
+
+    TestGPUParticles::Emitter TestGPUParticles::RandomEmitter()
+    {
+        Emitter emitter;
+        emitter.active = true;
+        emitter.retire = 0.0f;
+        emitter.pos = glm::vec2(RandRange(60.0f, WORLD_WIDTH - 60.0f), RandRange(100.0f, WORLD_HEIGHT - 60.0f));
+        emitter.gravity = RandRange(-300.0f, 50.0f);
+        emitter.rate = RandRange(500.0f, 4000.0f);
+        emitter.accum = 0.0f;
+        emitter.speedMin = RandRange(10.0f, 80.0f);
+        emitter.speedMax = emitter.speedMin + RandRange(20.0f, 200.0f);
+        emitter.lifeMin = RandRange(0.5f, 2.0f);
+        emitter.lifeMax = emitter.lifeMin + RandRange(0.5f, 2.0f);
+        emitter.sizeMin = RandRange(1.0f, 4.0f);
+        emitter.sizeMax = emitter.sizeMin + RandRange(1.0f, 8.0f);
+        emitter.colourStart = glm::vec4(RandRange(0.2f, 1.0f), RandRange(0.2f, 1.0f), RandRange(0.2f, 1.0f), 1.0f);
+        emitter.colourEnd = glm::vec4(RandRange(0.0f, 1.0f), RandRange(0.0f, 1.0f), RandRange(0.0f, 1.0f), 0.0f);
+        return emitter;
+    }
+
+    unsigned int TestGPUParticles::UploadEmitters(float dt)
+    {
+        // The whole table, so a removed emitter's particles still find
+        // their gravity and colour. The new particles' ranges are laid out
+        // in table order.
+        GPUEmitter table[MAX_EMITTERS];
+        unsigned int total = 0;
+        for (unsigned int i = 0; i < MAX_EMITTERS; i++)
+        {
+            Emitter& emitter = m_Emitters[i];
+            unsigned int count = 0;
+            if (emitter.active)
+            {
+                emitter.accum += emitter.rate * dt;
+                count = static_cast<unsigned int>(emitter.accum);
+                emitter.accum -= static_cast<float>(count);
+            }
+            else if (emitter.retire > 0.0f)
+            {
+                emitter.retire -= dt;
+            }
+
+            GPUEmitter& entry = table[i];
+            entry.position = glm::vec4(emitter.pos, emitter.gravity, 0.0f);
+            entry.colorStart = emitter.colourStart;
+            entry.colorEnd = emitter.colourEnd;
+            entry.speedLife = glm::vec4(emitter.speedMin, emitter.speedMax, emitter.lifeMin, emitter.lifeMax);
+            entry.size = glm::vec4(emitter.sizeMin, emitter.sizeMax, 0.0f, 0.0f);
+            entry.emission[0] = total;
+            entry.emission[1] = count;
+            entry.emission[2] = entry.emission[3] = 0;
+            total += count;
+        }
+        m_EmitterTable->SetData(table, sizeof(table));
+        return total;
+    }
+
+    void TestGPUParticles::AllocateParticles()
+    {
+        // Sized for the layout in use, so switching to the packed one
+        // really frees the difference
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_SSBO));
+        GlCall(glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_PARTICLES * ParticleBytes(m_PackedLayout), nullptr, GL_DYNAMIC_DRAW));
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+        GpuMemory::TrackBuffer(GpuMemory::Category::Storage, m_SSBO, MAX_PARTICLES * ParticleBytes(m_PackedLayout));
+    }
+
+    void TestGPUParticles::ResetParticles()
+    {
+        GPUParticleCounters counters;
+        memset(&counters, 0, sizeof(counters));
+        counters.deadCount = static_cast<unsigned int>(m_MaxParticles);
+        counters.emitArgs[1] = counters.emitArgs[2] = 1;
+        counters.simulateArgs[1] = counters.simulateArgs[2] = 1;
+        counters.drawArgs[1] = 1;
+        // Over whatever the last frame's stages stored there
+        MemoryBarriers::UseBuffer(m_CounterBuffer, MemoryBarriers::Access::BufferUpdate);
+        MemoryBarriers::Flush();
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CounterBuffer));
+        GlCall(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), &counters));
+        GlCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+
+        BindStorage(DEAD_BINDING, m_DeadList);
+        BindStorage(COUNTER_BINDING, m_CounterBuffer);
         m_ComputeShader->Bind();
-        m_ComputeShader->setUniform1f("u_DeltaTime", deltaTime);
-        m_ComputeShader->setUniform1f("u_Gravity", m_Gravity);
-        m_ComputeShader->setUniform2f("u_EmitterPos", m_EmitterPos.x, m_EmitterPos.y);
         m_ComputeShader->setUniform1i("u_MaxParticles", m_MaxParticles);
-        m_ComputeShader->setUniform1f("u_Time", m_Time);
-        m_ComputeShader->setUniform1f("u_EmissionRate", m_EmissionRate);
-        m_ComputeShader->setUniform4f("u_ColorStart", m_ColourStart.r, m_ColourStart.g, m_ColourStart.b, m_ColourStart.a);
-        m_ComputeShader->setUniform4f("u_ColorEnd", m_ColourEnd.r, m_ColourEnd.g, m_ColourEnd.b, m_ColourEnd.a);
-        m_ComputeShader->setUniform1f("u_SpeedMin", m_SpeedMin);
-        m_ComputeShader->setUniform1f("u_SpeedMax", m_SpeedMax);
-        m_ComputeShader->setUniform1f("u_LifeMin", m_LifeMin);
-        m_ComputeShader->setUniform1f("u_LifeMax", m_LifeMax);
-        m_ComputeShader->setUniform1f("u_SizeMin", m_SizeMin);
-        m_ComputeShader->setUniform1f("u_SizeMax", m_SizeMax);
+        m_ComputeShader->setUniform1i("u_Stage", STAGE_RESET);
+        TrackStorage();
+        m_ComputeShader->DispatchForElements(static_cast<unsigned int>(m_MaxParticles));
+        m_ComputeShader->Unbind();
 
-        unsigned int numGroups = (m_MaxParticles + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE;
-        m_ComputeShader->Dispatch(numGroups, 1, 1);
+        // The sort covers every slot the alive list can hold
+        m_SortSize = SORT_BLOCK;
+        while (m_SortSize < static_cast<unsigned int>(m_MaxParticles))
+            m_SortSize *= 2;
 
-        GlCall(glEndQuery(GL_TIME_ELAPSED));
+        for (Emitter& emitter : m_Emitters)
+            emitter.accum = 0.0f;
+        m_AliveCount = m_EmitCount = 0;
+        m_DeadCount = static_cast<unsigned int>(m_MaxParticles);
+    }
 
-        // Memory barrier to ensure compute writes are visible to vertex shader
-        GlCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT));
+    // Each stage reads the counters and lists the one before wrote: a
+    // SHADER_STORAGE barrier between every two, and a COMMAND one only in
+    // front of the indirect dispatches, which read their group counts
+    void TestGPUParticles::RunStage(int stage, unsigned int groups)
+    {
+        m_ComputeShader->setUniform1i("u_Stage", stage);
+        TrackStorage();
+        m_ComputeShader->Dispatch(groups, 1, 1);
+    }
 
-        m_ComputeShader->Unbind();
+    void TestGPUParticles::RunStageIndirect(int stage, unsigned int indirectOffset)
+    {
+        m_ComputeShader->setUniform1i("u_Stage", stage);
+        TrackStorage();
+        m_ComputeShader->DispatchIndirect(m_CounterBuffer, indirectOffset);
+    }
+
+    void TestGPUParticles::BindStorage(unsigned int binding, unsigned int buffer)
+    {
+        GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer));
+        m_Storage[binding] = buffer;
+    }
+
+    // Every buffer still bound, including ones this stage's shader leaves
+    // alone: they are all read the same way, so an extra one never adds a bit
+    void TestGPUParticles::TrackStorage()
+    {
+        for (unsigned int buffer : m_Storage)
+        {
+            if (!buffer)
+                continue;
+            MemoryBarriers::UseBuffer(buffer, MemoryBarriers::Access::Storage);
+            MemoryBarriers::WriteBuffer(buffer);
+        }
+    }
+
+    void TestGPUParticles::SortParticles()
+    {
+        BindStorage(PARTICLE_BINDING, m_SSBO);
+        BindStorage(ALIVE_BINDING, m_AliveList[m_Current]);
+        BindStorage(COUNTER_BINDING, m_CounterBuffer);
+        BindStorage(SORT_KEY_BINDING, m_SortKeys);
+        BindStorage(SORT_VALUE_BINDING, m_SortValues);
+
+        // Bitonic: for each sequence length k, compare-and-swap passes at
+        // distances j = k/2 .. 1. Everything up to a block is one dispatch
+        // in shared memory; past that, the wide passes go through memory
+        // and the last log2(SORT_BLOCK) passes of each k are one more:
+        // 45 dispatches for 100k particles (2^17 keys), 78 for 1M (2^20).
+        m_SortShader->Bind();
+        m_SortShader->setUniform1i("u_PackedLayout", m_PackedLayout ? 1 : 0);
+        m_SortPasses = 0;
+        RunSortStage(SORT_LOCAL, 0, 0);
+        for (unsigned int k = 2 * SORT_BLOCK; k <= m_SortSize; k *= 2)
+        {
+            for (unsigned int j = k / 2; j >= SORT_BLOCK; j /= 2)
+                RunSortStage(SORT_GLOBAL, k, j);
+            RunSortStage(SORT_MERGE, k, 0);
+        }
+        m_SortShader->Unbind();
+    }
+
+    void TestGPUParticles::RunSortStage(int stage, unsigned int k, unsigned int j)
+    {
+        m_SortShader->setUniform1i("u_Stage", stage);
+        m_SortShader->setUniform1i("u_K", static_cast<int>(k));
+        m_SortShader->setUniform1i("u_J", static_cast<int>(j));
+        // Two elements per invocation in every stage
+        TrackStorage();
+        m_SortShader->DispatchForElements(m_SortSize / 2);
+        m_SortPasses++;
+    }
+
+    void TestGPUParticles::BuildGrid()
+    {
+        m_GridWidth = static_cast<int>(std::ceil(WORLD_WIDTH / m_CellSize));
+        m_GridHeight = static_cast<int>(std::ceil(WORLD_HEIGHT / m_CellSize));
+        const unsigned int cells = static_cast<unsigned int>(m_GridWidth * m_GridHeight);
+
+        BindStorage(PARTICLE_BINDING, m_SSBO);
+        BindStorage(ALIVE_BINDING, m_AliveList[m_Current]);
+        BindStorage(COUNTER_BINDING, m_CounterBuffer);
+        BindStorage(CELL_BINDING, m_CellBuffer);
+        BindStorage(PARTICLE_CELL_BINDING, m_ParticleCellBuffer);
+        BindStorage(GRID_BINDING, m_GridBuffer);
+
+        m_InteractShader->Bind();
+        m_InteractShader->setUniform1i("u_PackedLayout", m_PackedLayout ? 1 : 0);
+        m_InteractShader->setUniform1f("u_CellSize", m_CellSize);
+        m_InteractShader->setUniform1i("u_GridWidth", m_GridWidth);
+        m_InteractShader->setUniform1i("u_GridHeight", m_GridHeight);
+
+        // A counting sort of the alive list by cell. The per-particle
+        // stages are sized like SIMULATE was, which covers the survivors.
+        const unsigned int simulateArgs = offsetof(GPUParticleCounters, simulateArgs);
+        m_InteractShader->setUniform1i("u_Stage", GRID_CLEAR);
+        TrackStorage();
+        m_InteractShader->DispatchForElements(cells);
+        RunGridStageIndirect(GRID_COUNT, simulateArgs);
+        RunGridStage(GRID_SCAN, 1);
+        RunGridStageIndirect(GRID_SCATTER, simulateArgs);
+    }
+
+    void TestGPUParticles::InteractParticles(float dt)
+    {
+        // Still bound from BuildGrid
+        m_InteractShader->setUniform1i("u_Stage", GRID_INTERACT);
+        m_InteractShader->setUniform1f("u_DeltaTime", dt);
+        m_InteractShader->setUniform1f("u_Radius", m_CellSize);
+        m_InteractShader->setUniform1f("u_Repulsion", m_Repulsion);
+        m_InteractShader->setUniform1f("u_Restitution", m_Restitution);
+        m_InteractShader->setUniform1f("u_Floor", m_Floor);
+        m_InteractShader->setUniform2f("u_ObstaclePos", m_ObstaclePos.x, m_ObstaclePos.y);
+        m_InteractShader->setUniform1f("u_ObstacleRadius", m_ObstacleRadius);
+
+        TrackStorage();
+        m_InteractShader->DispatchIndirect(m_CounterBuffer, offsetof(GPUParticleCounters, simulateArgs));
+        GlCall(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0));
+        m_InteractShader->Unbind();
+    }
+
+    void TestGPUParticles::RunGridStage(int stage, unsigned int groups)
+    {
+        m_InteractShader->setUniform1i("u_Stage", stage);
+        TrackStorage();
+        m_InteractShader->Dispatch(groups, 1, 1);
+    }
+
+    void TestGPUParticles::RunGridStageIndirect(int stage, unsigned int indirectOffset)
+    {
+        m_InteractShader->setUniform1i("u_Stage", stage);
+        TrackStorage();
+        m_InteractShader->DispatchIndirect(m_CounterBuffer, indirectOffset);
+        GlCall(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0));
+    }
+
+    // Read whichever earlier copies the GPU has finished, then copy this
+    // frame's counters into a free readback buffer and fence it. Nothing
+    // waits: a copy is read only once its fence has signalled, a frame or
+    // more later, and when the GPU is so far behind that both buffers are
+    // still pending this frame's counters are skipped instead.
+    void TestGPUParticles::ReadCounters(unsigned int requested)
+    {
+        // Copies finish in order, so the older of the two goes first
+        for (int pass = 0; pass < 2; pass++)
+        {
+            int read = -1;
+            for (int i = 0; i < 2; i++)
+            {
+                if (m_ReadbackFence[i] && (read < 0 || m_ReadbackFrame[i] < m_ReadbackFrame[read]))
+                    read = i;
+            }
+            if (read < 0)
+                break;
+
+            // Zero timeout: only asks. The fence was flushed by the
+            // SwapBuffers of the frame that made it.
+            GLenum state = glClientWaitSync(m_ReadbackFence[read], 0, 0);
+            if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+                break;
+            glDeleteSync(m_ReadbackFence[read]);
+            m_ReadbackFence[read] = nullptr;
+
+            GPUParticleReadback readback;
+            GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_Readback[read]));
+            GlCall(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(readback), &readback));
+            m_DeadCount = readback.counters[0];
+            m_AliveCount = readback.counters[1];
+            m_EmitCount = readback.counters[3];
+            m_EmitRequested = m_RequestedEmit[read];
+            m_OccupiedCells = readback.occupiedCells;
+            m_MaxPerCell = readback.maxPerCell;
+        }
+
+        int write = -1;
+        for (int i = 0; i < 2 && write < 0; i++)
+        {
+            if (!m_ReadbackFence[i])
+                write = i;
+        }
+        if (write < 0)
+            return;
+
+        MemoryBarriers::UseBuffer(m_CounterBuffer, MemoryBarriers::Access::BufferUpdate);
+        if (m_Interact)
+            MemoryBarriers::UseBuffer(m_CellBuffer, MemoryBarriers::Access::BufferUpdate);
+        MemoryBarriers::Flush();
+
+        GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_CounterBuffer));
+        GlCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Readback[write]));
+        GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(GPUParticleReadback::counters)));
+        if (m_Interact)
+        {
+            GlCall(glBindBuffer(GL_COPY_READ_BUFFER, m_CellBuffer));
+            GlCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                offsetof(GPUParticleReadback, occupiedCells), 2 * sizeof(unsigned int)));
+        }
+        m_ReadbackFence[write] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_ReadbackFrame[write] = m_Frame;
+        m_RequestedEmit[write] = requested;
     }
 
     void TestGPUParticles::Render()
     {
        // m_DefaultScene->Render(m_View, m_Proj);
 
-        int front = 1 - m_QueryBack;
-        GlCall(glBeginQuery(GL_TIME_ELAPSED, m_QueryRender[front]));
+        PROFILE_SCOPE("Draw");
 
-        GlCall(glEnable(GL_BLEND));
-        GlCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
-        GlCall(glEnable(GL_PROGRAM_POINT_SIZE));
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(m_Window, &width, &height);
+        if (m_EnableBloom && width > 0 && height > 0)
+        {
+            RenderGraph::TextureDesc hdrDesc;
+            hdrDesc.width = width;
+            hdrDesc.height = height;
+            hdrDesc.format = GL_RGBA16F;
+
+            m_Graph.Reset();
+            const RenderGraph::Resource hdr = m_Graph.CreateTexture("Particles (HDR)", hdrDesc);
+            const RenderGraph::Pass particles = m_Graph.AddPass("Particles", [this](const RenderGraph::PassContext&)
+                {
+                    DrawParticles();
+                });
+            m_Graph.Write(particles, hdr, RenderGraph::LoadOp::Clear);
+
+            m_BloomChain.GetStages().assign(1, m_Bloom);
+            const RenderGraph::Resource bloomed = m_BloomChain.AddToGraph(m_Graph, hdr, hdrDesc).back();
+
+            const RenderGraph::Resource screen = m_Graph.ImportBackbuffer(width, height);
+            const RenderGraph::Pass present = m_Graph.AddPass("Present", [this, bloomed](const RenderGraph::PassContext& context)
+                {
+                    DrawPresent(context.GetTexture(bloomed));
+                });
+            m_Graph.Read(present, bloomed);
+            m_Graph.Write(present, screen, RenderGraph::LoadOp::DontCare);
+            m_Graph.Execute();
+        }
+        else
+        {
+            DrawParticles();
+        }
+    }
 
-        // Bind SSBO for vertex pulling
-        GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_SSBO));
+    void TestGPUParticles::DrawParticles()
+    {
+        GLState::Enable(GL_BLEND);
+        if (m_Blend == Blend::PremultipliedAlpha)
+            GLState::BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        else
+            GLState::BlendFunc(GL_ONE, GL_ONE);
+        GLState::Enable(GL_PROGRAM_POINT_SIZE);
+
+        // Bind SSBOs for vertex pulling: vertex i is alive particle i
+        const unsigned int order = m_Sort ? m_SortValues : m_AliveList[m_Current];
+        GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_BINDING, m_SSBO));
+        GlCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ALIVE_BINDING, order));
 
         glm::mat4 mvp = m_Proj * m_View;
         m_RenderShader->Bind();
         m_RenderShader->setUniformMat4f("u_MVP", mvp);
-
-        GlCall(glBindVertexArray(m_VAO));
-        GlCall(glDrawArrays(GL_POINTS, 0, m_MaxParticles));
-        GlCall(glBindVertexArray(0));
+        m_RenderShader->setUniform1i("u_PackedLayout", m_PackedLayout ? 1 : 0);
+        m_EmitterTable->BindBase();
+
+        // As many points as FINISH counted, without the count coming back
+        // to the CPU
+        // The vertex shader pulls from the SSBOs; the count is a command
+        MemoryBarriers::UseBuffer(m_SSBO, MemoryBarriers::Access::Storage);
+        MemoryBarriers::UseBuffer(order, MemoryBarriers::Access::Storage);
+        MemoryBarriers::UseBuffer(m_CounterBuffer, MemoryBarriers::Access::Command);
+        MemoryBarriers::Flush();
+
+        GLState::BindVertexArray(m_VAO);
+        GlCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CounterBuffer));
+        GlCall(glDrawArraysIndirect(GL_POINTS, (const void*)offsetof(GPUParticleCounters, drawArgs)));
+        GlCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+        GLState::BindVertexArray(0);
 
         m_RenderShader->Unbind();
 
-        GlCall(glDisable(GL_PROGRAM_POINT_SIZE));
-        GlCall(glDisable(GL_BLEND));
+        GLState::Disable(GL_PROGRAM_POINT_SIZE);
+        GLState::Disable(GL_BLEND);
+    }
 
-        GlCall(glEndQuery(GL_TIME_ELAPSED));
+    void TestGPUParticles::DrawPresent(unsigned int texture)
+    {
+        GLState::Disable(GL_DEPTH_TEST);
+        m_PresentShader->Bind();
+        GLState::BindTextureToUnit(0, GL_TEXTURE_2D, texture);
+        m_PresentShader->setUniform1i("u_Texture", 0);
+        m_Quad->Draw();
+        GLState::BindTextureToUnit(0, GL_TEXTURE_2D, 0);
+    }
+
+    void TestGPUParticles::DrawScene()
+    {
+        // World units to ImGui's display coordinates, y flipped
+        const ImVec2 display = ImGui::GetIO().DisplaySize;
+        const float sx = display.x / WORLD_WIDTH;
+        const float sy = display.y / WORLD_HEIGHT;
+
+        ImDrawList* drawList = ImGui::GetBackgroundDrawList();
+        const ImU32 colour = IM_COL32(120, 200, 255, 160);
+        const float floorY = display.y - m_Floor * sy;
+        drawList->AddLine(ImVec2(0.0f, floorY), ImVec2(display.x, floorY), colour, 2.0f);
+        const ImVec2 centre(m_ObstaclePos.x * sx, display.y - m_ObstaclePos.y * sy);
+        drawList->AddEllipse(centre, ImVec2(m_ObstacleRadius * sx, m_ObstacleRadius * sy), colour, 0.0f, 64, 2.0f);
     }
 
     void TestGPUParticles::RenderGUI()
@@ -192,71 +777,204 @@ namespace test
 
         if (ImGui::CollapsingHeader("Performance", ImGuiTreeNodeFlags_DefaultOpen))
         {
-            // GPU timing breakdown
-            ImGui::Text("GPU Compute:  %.3f ms", m_ComputeTimeMs);
-            ImGui::Text("GPU Render:   %.3f ms", m_RenderTimeMs);
-            ImGui::Text("GPU Total:    %.3f ms", m_ComputeTimeMs + m_RenderTimeMs);
+            // GPU timing breakdown, the most recent frame the Profiler has
+            // read back; its window has the history and percentiles
+            const float computeMs = Profiler::GetGpuMs("Compute");
+            const float gridMs = m_Interact ? Profiler::GetGpuMs("Grid") : 0.0f;
+            const float interactMs = m_Interact ? Profiler::GetGpuMs("Interact") : 0.0f;
+            const float sortMs = m_Sort ? Profiler::GetGpuMs("Sort") : 0.0f;
+            const float drawMs = Profiler::GetGpuMs("Draw");
+            ImGui::Text("GPU Compute:  %.3f ms", computeMs);
+            ImGui::Text("GPU Grid:     %.3f ms", gridMs);
+            ImGui::Text("GPU Interact: %.3f ms", interactMs);
+            ImGui::Text("GPU Sort:     %.3f ms", sortMs);
+            ImGui::Text("GPU Render:   %.3f ms", drawMs);
+            ImGui::Text("GPU Total:    %.3f ms", computeMs + gridMs + interactMs + sortMs + drawMs);
 
             ImGui::Separator();
 
-            // Frame time graph
-            float maxFrameTime = 0.0f;
-            for (int i = 0; i < FRAME_HISTORY_SIZE; i++)
-                if (m_FrameTimeHistory[i] > maxFrameTime) maxFrameTime = m_FrameTimeHistory[i];
-            if (maxFrameTime < 1.0f) maxFrameTime = 1.0f;
+            // Memory usage: per slot, the particle in the current layout,
+            // the dead and two alive lists, the sort's keys and values
+            // (padded to a power of two) and the grid's two entries
+            const std::size_t particleBytes = ParticleBytes(m_PackedLayout);
+            const std::size_t slotBytes = particleBytes + 5 * sizeof(unsigned int) + 6 * sizeof(unsigned int);
+            float ssboMB = static_cast<float>(m_MaxParticles * slotBytes) / (1024.0f * 1024.0f);
+            float ssboMaxMB = static_cast<float>(MAX_PARTICLES * slotBytes) / (1024.0f * 1024.0f);
+            ImGui::Text("SSBO Memory:  %.1f MB / %.1f MB allocated", ssboMB, ssboMaxMB);
+            ImGui::ProgressBar(ssboMB / ssboMaxMB, ImVec2(-1, 0), "");
+            ImGui::Text("Particles:    %.1f MB (%u bytes each)", static_cast<float>(MAX_PARTICLES * particleBytes) / (1024.0f * 1024.0f),
+                static_cast<unsigned int>(particleBytes));
+
+            // Work group info, a frame behind: the GPU sized these itself
+            const unsigned int localSize = m_ComputeShader->GetWorkGroupSize().x;
+            unsigned int emitGroups = (m_EmitCount + localSize - 1) / localSize;
+            unsigned int simulateGroups = (m_AliveCount + localSize - 1) / localSize;
+            ImGui::Text("Work Groups:  %u emit + %u simulate  (local size: %u)", emitGroups, simulateGroups, localSize);
+            ImGui::Text("Barriers:     %u (%u bits), %u of %u uses already ordered", m_BarrierFrame.barriers,
+                m_BarrierFrame.bits, m_BarrierFrame.satisfied, m_BarrierFrame.uses);
+            ImGui::Text("Points drawn: %u of %d slots", m_AliveCount, m_MaxParticles);
+        }
 
-            char overlay[64];
-            snprintf(overlay, sizeof(overlay), "Frame: %.2f ms", m_FrameTimeHistory[(m_FrameHistoryIdx - 1 + FRAME_HISTORY_SIZE) % FRAME_HISTORY_SIZE]);
-            ImGui::PlotLines("Frame Time", m_FrameTimeHistory, FRAME_HISTORY_SIZE, m_FrameHistoryIdx, overlay, 0.0f, maxFrameTime * 1.2f, ImVec2(0, 60));
+        if (ImGui::CollapsingHeader("Particle Layout", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            // Either change starts the simulation over
+            int packed = m_PackedLayout ? 1 : 0;
+            ImGui::RadioButton("Full (48 bytes)", &packed, 0);
+            ImGui::SameLine();
+            ImGui::RadioButton("Packed (16 bytes)", &packed, 1);
+            if ((packed != 0) != m_PackedLayout)
+            {
+                m_PackedLayout = packed != 0;
+                AllocateParticles();
+                ResetParticles();
+            }
+
+            // Enough emission to keep every slot busy once it fills up,
+            // shared between the emitters
+            if (ImGui::Button("Fill to MAX_PARTICLES"))
+            {
+                unsigned int active = 0;
+                for (const Emitter& emitter : m_Emitters)
+                    active += emitter.active ? 1 : 0;
+                for (Emitter& emitter : m_Emitters)
+                {
+                    if (emitter.active)
+                        emitter.rate = static_cast<float>(MAX_PARTICLES) / (0.5f * (emitter.lifeMin + emitter.lifeMax) * active);
+                }
+                m_MaxParticles = static_cast<int>(MAX_PARTICLES);
+                ResetParticles();
+            }
+
+            ImGui::Text("%-8s %10s %10s %10s", "Layout", "Compute", "Render", "Particles");
+            for (int i = 0; i < 2; i++)
+            {
+                const LayoutTiming& timing = m_LayoutTiming[i];
+                ImGui::Text("%-8s %7.3f ms %7.3f ms %10u", i ? "Packed" : "Full", timing.computeMs, timing.renderMs, timing.alive);
+            }
+        }
 
-            // Compute vs Render stacked-ish view
-            snprintf(overlay, sizeof(overlay), "Compute: %.3f ms", m_ComputeTimeMs);
-            ImGui::PlotHistogram("Compute", m_ComputeTimeHistory, FRAME_HISTORY_SIZE, m_FrameHistoryIdx, overlay, 0.0f, maxFrameTime * 0.5f, ImVec2(0, 40));
+        ImGui::Separator();
 
-            snprintf(overlay, sizeof(overlay), "Render: %.3f ms", m_RenderTimeMs);
-            ImGui::PlotHistogram("Render", m_RenderTimeHistory, FRAME_HISTORY_SIZE, m_FrameHistoryIdx, overlay, 0.0f, maxFrameTime * 0.5f, ImVec2(0, 40));
+        // --- Emitter Settings ---
+        ImGui::Text("Particles: %u alive, %u free", m_AliveCount, m_DeadCount);
+        ImGui::Text("Emitted: %u of %u requested", m_EmitCount, m_EmitRequested);
 
-            ImGui::Separator();
+        // The dead list is rebuilt for the new capacity, which starts the
+        // simulation over
+        ImGui::SliderInt("Max Particles", &m_MaxParticles, 1000, static_cast<int>(MAX_PARTICLES));
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            ResetParticles();
 
-            // Memory usage
-            float ssboMB = static_cast<float>(m_MaxParticles * sizeof(GPUParticle)) / (1024.0f * 1024.0f);
-            float ssboMaxMB = static_cast<float>(MAX_PARTICLES * sizeof(GPUParticle)) / (1024.0f * 1024.0f);
-            ImGui::Text("SSBO Memory:  %.1f MB / %.1f MB allocated", ssboMB, ssboMaxMB);
-            ImGui::ProgressBar(ssboMB / ssboMaxMB, ImVec2(-1, 0), "");
+        if (ImGui::CollapsingHeader("Emitters", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            // All of them in the same dispatches and the same draw
+            unsigned int active = 0;
+            for (const Emitter& emitter : m_Emitters)
+                active += emitter.active ? 1 : 0;
+            ImGui::Text("%u of %u emitters, one emitter table", active, MAX_EMITTERS);
+
+            if (ImGui::Button("Add"))
+            {
+                const unsigned int index = AddEmitter(RandomEmitter());
+                if (index < MAX_EMITTERS)
+                    m_Selected = static_cast<int>(index);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Add 16"))
+            {
+                for (int i = 0; i < 16; i++)
+                    AddEmitter(RandomEmitter());
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Remove") && m_Emitters[m_Selected].active)
+                RemoveEmitter(static_cast<unsigned int>(m_Selected));
+
+            if (ImGui::BeginListBox("##Emitters", ImVec2(-1, 5 * ImGui::GetTextLineHeightWithSpacing())))
+            {
+                for (unsigned int i = 0; i < MAX_EMITTERS; i++)
+                {
+                    if (!m_Emitters[i].active)
+                        continue;
+                    char label[64];
+                    snprintf(label, sizeof(label), "Emitter %u: %.0f/s", i, m_Emitters[i].rate);
+                    if (ImGui::Selectable(label, m_Selected == static_cast<int>(i)))
+                        m_Selected = static_cast<int>(i);
+                }
+                ImGui::EndListBox();
+            }
+        }
 
-            // Work group info
-            unsigned int numGroups = (m_MaxParticles + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE;
-            ImGui::Text("Work Groups:  %u  (local size: %u)", numGroups, WORK_GROUP_SIZE);
-            ImGui::Text("GPU Threads:  %u", numGroups * WORK_GROUP_SIZE);
+        // The rest edits the selected emitter
+        Emitter* selected = m_Emitters[m_Selected].active ? &m_Emitters[m_Selected] : nullptr;
+        if (selected && ImGui::CollapsingHeader("Emitter Settings", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::SliderFloat2("Emitter Pos", &selected->pos.x, 0.0f, WORLD_WIDTH);
+            ImGui::SliderFloat("Emission Rate", &selected->rate, 100.0f, 100000.0f);
+            ImGui::SliderFloat("Gravity", &selected->gravity, -500.0f, 500.0f);
         }
 
-        ImGui::Separator();
+        if (selected && ImGui::CollapsingHeader("Particle Properties"))
+        {
+            ImGui::SliderFloat("Speed Min", &selected->speedMin, 0.0f, 500.0f);
+            ImGui::SliderFloat("Speed Max", &selected->speedMax, 0.0f, 500.0f);
+            ImGui::SliderFloat("Life Min", &selected->lifeMin, 0.1f, 10.0f);
+            ImGui::SliderFloat("Life Max", &selected->lifeMax, 0.1f, 10.0f);
+            ImGui::SliderFloat("Size Min", &selected->sizeMin, 1.0f, 30.0f);
+            ImGui::SliderFloat("Size Max", &selected->sizeMax, 1.0f, 30.0f);
+        }
 
-        // --- Emitter Settings ---
-        ImGui::Text("Particles: %d", m_MaxParticles);
+        if (ImGui::CollapsingHeader("Blending", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            // Additive light doesn't care about order; smoke composited
+            // over itself needs the oldest (furthest back) drawn first
+            int blend = static_cast<int>(m_Blend);
+            if (ImGui::RadioButton("Additive", &blend, static_cast<int>(Blend::Additive)))
+                m_Sort = false;
+            ImGui::SameLine();
+            if (ImGui::RadioButton("Premultiplied alpha", &blend, static_cast<int>(Blend::PremultipliedAlpha)))
+                m_Sort = true;
+            m_Blend = static_cast<Blend>(blend);
+            ImGui::Checkbox("Sort back to front", &m_Sort);
+            if (m_Sort)
+                ImGui::Text("Bitonic sort: %u keys, %u dispatches", m_SortSize, m_SortPasses);
+        }
 
-        if (ImGui::CollapsingHeader("Emitter Settings", ImGuiTreeNodeFlags_DefaultOpen))
+        if (ImGui::CollapsingHeader("Interaction"))
         {
-            ImGui::SliderFloat2("Emitter Pos", &m_EmitterPos.x, 0.0f, 960.0f);
-            ImGui::SliderInt("Max Particles", &m_MaxParticles, 1000, static_cast<int>(MAX_PARTICLES));
-            ImGui::SliderFloat("Emission Rate", &m_EmissionRate, 100.0f, 100000.0f);
-            ImGui::SliderFloat("Gravity", &m_Gravity, -500.0f, 500.0f);
+            ImGui::Checkbox("Collide and separate", &m_Interact);
+            ImGui::SliderFloat("Cell Size", &m_CellSize, MIN_CELL_SIZE, 64.0f);
+            ImGui::SliderFloat("Repulsion", &m_Repulsion, 0.0f, 10000.0f);
+            ImGui::SliderFloat("Restitution", &m_Restitution, 0.0f, 1.0f);
+            ImGui::SliderFloat("Floor", &m_Floor, 0.0f, 270.0f);
+            ImGui::SliderFloat2("Obstacle Pos", &m_ObstaclePos.x, 0.0f, WORLD_WIDTH);
+            ImGui::SliderFloat("Obstacle Radius", &m_ObstacleRadius, 0.0f, 200.0f);
+            if (m_Interact)
+            {
+                // A frame behind, like the counters
+                const unsigned int cells = static_cast<unsigned int>(m_GridWidth * m_GridHeight);
+                ImGui::Text("Grid: %d x %d cells, %u occupied (%.1f%%)", m_GridWidth, m_GridHeight, m_OccupiedCells,
+                    100.0f * m_OccupiedCells / cells);
+                ImGui::Text("Per occupied cell: %.1f average, %u most", m_OccupiedCells ? static_cast<float>(m_AliveCount) / m_OccupiedCells : 0.0f,
+                    m_MaxPerCell);
+            }
         }
+        if (m_Interact)
+            DrawScene();
 
-        if (ImGui::CollapsingHeader("Particle Properties"))
+        if (selected && ImGui::CollapsingHeader("Colours"))
         {
-            ImGui::SliderFloat("Speed Min", &m_SpeedMin, 0.0f, 500.0f);
-            ImGui::SliderFloat("Speed Max", &m_SpeedMax, 0.0f, 500.0f);
-            ImGui::SliderFloat("Life Min", &m_LifeMin, 0.1f, 10.0f);
-            ImGui::SliderFloat("Life Max", &m_LifeMax, 0.1f, 10.0f);
-            ImGui::SliderFloat("Size Min", &m_SizeMin, 1.0f, 30.0f);
-            ImGui::SliderFloat("Size Max", &m_SizeMax, 1.0f, 30.0f);
+            ImGui::ColorEdit4("Colour Start", &selected->colourStart.x);
+            ImGui::ColorEdit4("Colour End", &selected->colourEnd.x);
         }
 
-        if (ImGui::CollapsingHeader("Colours"))
+        if (ImGui::CollapsingHeader("Bloom"))
         {
-            ImGui::ColorEdit4("Colour Start", &m_ColourStart.x);
-            ImGui::ColorEdit4("Colour End", &m_ColourEnd.x);
+            // Counted in "GPU Render" above
+            ImGui::Checkbox("Enable Bloom", &m_EnableBloom);
+            ImGui::SliderFloat("Threshold", &m_Bloom.threshold, 0.0f, 4.0f);
+            ImGui::SliderFloat("Knee", &m_Bloom.knee, 0.0f, 1.0f);
+            ImGui::SliderFloat("Intensity", &m_Bloom.intensity, 0.0f, 2.0f);
+            ImGui::SliderInt("Pyramid Levels", &m_Bloom.levels, 1, PostProcessChain::MAX_BLOOM_LEVELS);
         }
     }
 }
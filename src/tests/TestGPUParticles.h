@@ -3,6 +3,10 @@
 #include "../Renderer.h"
 #include "../Shader.h"
 #include "../ComputeShader.h"
+#include "../MemoryBarriers.h"
+#include "../RenderGraph.h"
+#include "../PostProcessChain.h"
+#include "../Mesh/GeometryFactory.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -11,7 +15,10 @@
 #include "../vendor/imgui/imgui_impl_glfw.h"
 #include "../vendor/imgui/imgui_impl_opengl3.h"
 
+#include "../UniformBuffer.h"
+
 #include <memory>
+#include <vector>
 
 struct GLFWwindow;
 
@@ -28,47 +35,184 @@ namespace test
         void RenderGUI() override;
 
     private:
-        void RebuildSSBO();
+        // The particle buffer for MAX_PARTICLES in the current layout
+        void AllocateParticles();
+        // Every particle dead and every slot below m_MaxParticles free
+        void ResetParticles();
+        // One GPUParticleCompute.glsl stage over `groups` work groups, or
+        // with the group count read from m_CounterBuffer at `indirectOffset`
+        void RunStage(int stage, unsigned int groups);
+        void RunStageIndirect(int stage, unsigned int indirectOffset);
+        // glBindBufferBase, remembered per binding; TrackStorage declares
+        // every buffer bound that way as read and written by the next
+        // dispatch, which is what each stage of all three shaders does
+        void BindStorage(unsigned int binding, unsigned int buffer);
+        void TrackStorage();
+        void ReadCounters(unsigned int requested);
+        // GPUParticleSort.glsl over the alive list, into m_SortValues
+        void SortParticles();
+        void RunSortStage(int stage, unsigned int k, unsigned int j);
+        // GPUParticleInteract.glsl: the grid build, then the interaction
+        void BuildGrid();
+        void InteractParticles(float dt);
+        void RunGridStage(int stage, unsigned int groups);
+        void RunGridStageIndirect(int stage, unsigned int indirectOffset);
+        // The SDF scene's outline, over the particles, for the GUI
+        void DrawScene();
+        void DrawParticles();
+        void DrawPresent(unsigned int texture);
 
         static const unsigned int MAX_PARTICLES = 1000000;
-        static const unsigned int WORK_GROUP_SIZE = 256;
+
+        // GPUParticleCompute.glsl's u_Stage and buffer bindings
+        enum Stage { STAGE_RESET, STAGE_PREPARE, STAGE_EMIT, STAGE_SIMULATE, STAGE_FINISH };
+        static const unsigned int PARTICLE_BINDING = 0;
+        static const unsigned int DEAD_BINDING = 1;
+        static const unsigned int ALIVE_BINDING = 2;
+        static const unsigned int NEXT_ALIVE_BINDING = 3;
+        static const unsigned int COUNTER_BINDING = 4;
+
+        // GPUParticleSort.glsl's u_Stage, bindings and elements per work group
+        enum SortStage { SORT_LOCAL, SORT_GLOBAL, SORT_MERGE };
+        static const unsigned int SORT_KEY_BINDING = 5;
+        static const unsigned int SORT_VALUE_BINDING = 6;
+        static const unsigned int SORT_BLOCK = 512;
+
+        // GPUParticleInteract.glsl's u_Stage and the bindings it adds. GL
+        // only promises 8 storage bindings, so 5 and 6 are shared with the
+        // sort; each pass binds what it uses.
+        enum GridStage { GRID_CLEAR, GRID_COUNT, GRID_SCAN, GRID_SCATTER, GRID_INTERACT };
+        static const unsigned int CELL_BINDING = 5;
+        static const unsigned int PARTICLE_CELL_BINDING = 6;
+        static const unsigned int GRID_BINDING = 7;
+        static const unsigned int STORAGE_BINDINGS = 8;
+
+        // The grid covers the view
+        static constexpr float WORLD_WIDTH = 960.0f;
+        static constexpr float WORLD_HEIGHT = 540.0f;
+        static constexpr float MIN_CELL_SIZE = 4.0f;
+
+        GLFWwindow* m_Window;
 
         // OpenGL objects
         unsigned int m_SSBO;
+        bool m_PackedLayout;             // 16 bytes a particle instead of 48, see the shaders
+        unsigned int m_DeadList;
+        unsigned int m_AliveList[2];     // swapped every frame
+        int m_Current;                   // the one drawn, then emitted into
+        unsigned int m_CounterBuffer;    // GPUParticleCounters, also the indirect arguments
+        unsigned int m_Readback[2];      // its first four counters and the grid statistics, a frame or two behind
+        GLsync m_ReadbackFence[2];       // after the copy into each, null once read
+        int m_ReadbackFrame[2];          // m_Frame of that copy, to read the older first
         unsigned int m_VAO;
+        unsigned int m_Storage[STORAGE_BINDINGS];   // bound by BindStorage, 0 for none
         std::unique_ptr<ComputeShader> m_ComputeShader;
+
+        // Back-to-front sort, for alpha blending: the alive slots in draw
+        // order end up in m_SortValues, drawn instead of the alive list
+        enum class Blend { Additive, PremultipliedAlpha };
+        Blend m_Blend;
+        bool m_Sort;
+        unsigned int m_SortKeys;
+        unsigned int m_SortValues;
+        unsigned int m_SortSize;         // the capacity rounded up to a power of two
+        unsigned int m_SortPasses;       // dispatches per sort
+        std::unique_ptr<ComputeShader> m_SortShader;
+
+        // Interaction: separation and collision against an SDF of a floor
+        // and one circle, through a spatial hash rebuilt every frame
+        bool m_Interact;
+        float m_CellSize;                // also the separation radius
+        float m_Repulsion;
+        float m_Restitution;
+        float m_Floor;
+        glm::vec2 m_ObstaclePos;
+        float m_ObstacleRadius;
+        int m_GridWidth;
+        int m_GridHeight;
+        unsigned int m_CellBuffer;       // GPUParticleGrid
+        unsigned int m_ParticleCellBuffer;
+        unsigned int m_GridBuffer;
+        unsigned int m_OccupiedCells;    // read back a frame behind
+        unsigned int m_MaxPerCell;
+        std::unique_ptr<ComputeShader> m_InteractShader;
         std::unique_ptr<Shader> m_RenderShader;
 
         // Matrices
         glm::mat4 m_Proj;
         glm::mat4 m_View;
 
+        // Emitters: a fixed table of MAX_EMITTERS slots, uploaded whole to
+        // a uniform buffer every frame. Every emitter's particles share the
+        // one pool, taking slots from the dead list as they need them, so
+        // adding or removing an emitter never touches the particle buffer.
+        // A particle keeps its emitter's index for its gravity and colour,
+        // so a removed emitter's slot isn't reused until its particles
+        // have had time to die.
+        struct Emitter
+        {
+            bool active;
+            float retire;            // once removed: seconds until the slot is free
+            glm::vec2 pos;
+            float gravity;
+            float rate;              // particles per second
+            float accum;             // fractional particles carried over
+            float speedMin;
+            float speedMax;
+            float lifeMin;
+            float lifeMax;
+            float sizeMin;
+            float sizeMax;
+            glm::vec4 colourStart;
+            glm::vec4 colourEnd;
+        };
+        static const unsigned int MAX_EMITTERS = 64;     // the seed's 6 emitter bits
+        static const unsigned int EMITTER_BINDING = 2;   // uniform block, after FrameData and lights
+
+        // The first free slot, or MAX_EMITTERS when the table is full
+        unsigned int AddEmitter(const Emitter& emitter);
+        void RemoveEmitter(unsigned int index);
+        static Emitter RandomEmitter();
+        // This frame's counts per emitter, into the table; returns their sum
+        unsigned int UploadEmitters(float dt);
+
+        std::vector<Emitter> m_Emitters;
+        int m_Selected;                  // the one the GUI edits
+        std::unique_ptr<UniformBuffer> m_EmitterTable;
+
         // Settings
-        glm::vec2 m_EmitterPos;
-        float m_Gravity;
-        float m_EmissionRate;
-        float m_SpeedMin;
-        float m_SpeedMax;
-        float m_LifeMin;
-        float m_LifeMax;
-        float m_SizeMin;
-        float m_SizeMax;
         int m_MaxParticles;
-        glm::vec4 m_ColourStart;
-        glm::vec4 m_ColourEnd;
-        float m_Time;
-
-        // Performance tracking
-        unsigned int m_QueryCompute[2];  // double-buffered GL timer queries
-        unsigned int m_QueryRender[2];
-        int m_QueryBack;                 // index of the query we're reading results from
-        float m_ComputeTimeMs;
-        float m_RenderTimeMs;
-
-        static const int FRAME_HISTORY_SIZE = 120;
-        float m_FrameTimeHistory[FRAME_HISTORY_SIZE];
-        float m_ComputeTimeHistory[FRAME_HISTORY_SIZE];
-        float m_RenderTimeHistory[FRAME_HISTORY_SIZE];
-        int m_FrameHistoryIdx;
+        int m_Frame;
+
+        // The newest counters read back, a frame or two old, without a stall
+        unsigned int m_AliveCount;
+        unsigned int m_DeadCount;
+        unsigned int m_EmitCount;
+        unsigned int m_RequestedEmit[2];   // by the CPU, in the frame copied into each readback buffer
+        unsigned int m_EmitRequested;      // ... of the frame m_EmitCount is from
+
+        // MemoryBarriers' counts over the last whole frame
+        MemoryBarriers::Stats m_BarrierMark;
+        MemoryBarriers::Stats m_BarrierFrame;
+
+        // Bloom: particles are drawn into an RGBA16F target, where the
+        // additive blend can go past 1, then run through a one-stage
+        // PostProcessChain and copied to the screen
+        bool m_EnableBloom;
+        PostProcessChain::Stage m_Bloom;
+        PostProcessChain m_BloomChain;
+        RenderGraph m_Graph;
+        std::unique_ptr<Shader> m_PresentShader;
+        std::unique_ptr<Mesh> m_Quad;
+
+        // Performance tracking: each pass is a Profiler scope, read back
+        // here by name
+        struct LayoutTiming
+        {
+            float computeMs;
+            float renderMs;
+            unsigned int alive;          // when last measured
+        };
+        LayoutTiming m_LayoutTiming[2];  // full, packed
     };
 }
@@ -1,6 +1,14 @@
 #include "TestHighDensityMesh.h"
+#include "../GLState.h"
+#include "../FrameUniforms.h"
+#include "../ShaderLibrary.h"
 #include "../Renderer.h"
+#include "../Mesh/MeshCache.h"
+#include "../Mesh/GeometryFactory.h"
+#include "../ComputeShader.h"
 #include <imgui.h>
+#include <algorithm>
+#include <chrono>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
@@ -8,9 +16,24 @@ namespace test {
 
     TestHighDensityMesh::TestHighDensityMesh(GLFWwindow* window)
         : m_window(window),
-        m_ModelRotationSpeed(0.5f)
+        m_ModelRotationSpeed(0.5f),
+        m_PackedVertices(false),
+        m_CpuData(static_cast<int>(Mesh::CpuData::None)),
+        m_MergeMeshes(false),
+        m_AutoLod(true),
+        m_LodThresholdPixels(1.0f),
+        m_ForcedLod(0),
+        m_GridSize(1),
+        m_LastViewProjection(1.0f),
+        m_EnableCulling(true),
+        m_EnableOcclusion(true),
+        m_UseClusters(false),
+        m_EnableConeCulling(true),
+        m_Source(SOURCE_MODEL),
+        m_Divisions(1000),
+        m_GenerateMilliseconds(0.0f)
     {
-        glEnable(GL_DEPTH_TEST);
+        GLState::Enable(GL_DEPTH_TEST);
 
         m_Camera = std::make_unique<Camera>(
             window,
@@ -21,8 +44,97 @@ namespace test {
             45.0f                           // fov
         );
 
-        m_Model  = std::make_unique<Model>("res/Models/poly.obj");
-        m_Shader = std::make_unique<Shader>("res/Shaders/Mesh.shader");
+        m_Shader = std::make_unique<Shader>("res/Shaders/MeshIndirect.shader");
+        m_Shader->CompileAllVariants();
+        m_ProceduralShader = ShaderLibrary::Get("res/Shaders/Mesh.shader");
+
+        m_HiZ = std::make_unique<HiZBuffer>();
+        LoadModel(VertexFormat::Standard);
+    }
+
+    void TestHighDensityMesh::Preload()
+    {
+        Shader::Prebuild("res/Shaders/MeshIndirect.shader");
+        Shader::Prebuild("res/Shaders/Mesh.shader");
+        ComputeShader::Prebuild("res/Shaders/Culling/FrustumCull.glsl");
+        ComputeShader::Prebuild("res/Shaders/Culling/ClusterCull.glsl");
+        ComputeShader::Prebuild("res/Shaders/Culling/HiZBuild.glsl");
+        ComputeShader::Prebuild("res/Shaders/Mesh/ProceduralMesh.glsl");
+    }
+
+    void TestHighDensityMesh::OnResume()
+    {
+        GLState::Enable(GL_DEPTH_TEST);
+    }
+
+    // The cullers draw from one arena's buffers, so they are rebuilt with
+    // the model whenever the vertex format changes.
+    void TestHighDensityMesh::LoadModel(VertexFormat format)
+    {
+        m_Culling.reset();
+        m_Clusters.reset();
+        m_Model.reset();
+
+        m_Model = std::make_unique<Model>(MODEL_PATH, false, format, static_cast<Mesh::CpuData>(m_CpuData),
+            Model::MergeOptions(m_MergeMeshes));
+        m_Culling = std::make_unique<GPUCulling>(format);
+        m_Clusters = std::make_unique<ClusterCulling>(format);
+        for (std::size_t draw = 0; draw < m_Model->getDrawCount(); draw++)
+        {
+            m_Culling->AddMesh(m_Model->getDrawMesh(draw));
+            m_Clusters->AddMesh(m_Model->getDrawMesh(draw));
+        }
+        m_Clusters->Upload();
+
+        BuildInstances();
+        if (m_Source != SOURCE_MODEL)
+            GenerateProcedural();
+    }
+
+    // The default 1000 divisions is a million vertices. Nothing of it
+    // passes through the CPU, so the call only records the dispatch.
+    void TestHighDensityMesh::GenerateProcedural()
+    {
+        m_Procedural.reset();
+        const VertexFormat format = m_PackedVertices ? VertexFormat::Packed : VertexFormat::Standard;
+        const auto start = std::chrono::steady_clock::now();
+        switch (m_Source)
+        {
+        case SOURCE_TERRAIN: m_Procedural = GeometryFactory::CreateTerrainGPU(m_Divisions, 200.0f, 20.0f, 0.02f, 6, format); break;
+        case SOURCE_SPHERE:  m_Procedural = GeometryFactory::CreateSphereGPU(m_Divisions, m_Divisions / 2, 1.0f, format); break;
+        case SOURCE_TORUS:   m_Procedural = GeometryFactory::CreateTorusGPU(m_Divisions, m_Divisions / 2, 1.0f, 0.35f, format); break;
+        default: break;
+        }
+        m_GenerateMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Copies stand on a grid in front of the camera, each cell the size of
+    // the model's bounds plus a gap, so nearer rows hide the ones behind.
+    void TestHighDensityMesh::BuildInstances()
+    {
+        m_Culling->ClearInstances();
+        if (m_GridSize <= 1)
+            return;
+
+        const Bounds& bounds = m_Model->getLocalBounds();
+        const float spacing = 2.5f * std::max(bounds.radius, 0.01f);
+        const float start = -0.5f * spacing * (m_GridSize - 1);
+
+        InstanceData instance;
+        for (int z = 0; z < m_GridSize; z++)
+        {
+            for (int x = 0; x < m_GridSize; x++)
+            {
+                glm::vec3 cell(start + x * spacing, 0.0f, -spacing * (z + 1));
+                instance.model = glm::translate(glm::mat4(1.0f), cell - bounds.centre);
+
+                for (std::size_t draw = 0; draw < m_Model->getDrawCount(); draw++)
+                    m_Culling->AddInstance(static_cast<unsigned int>(draw), instance);
+            }
+        }
+
+        m_Culling->Upload();
+        m_HiZ->Invalidate();
     }
 
     void TestHighDensityMesh::Update(float deltaTime) {
@@ -35,35 +147,372 @@ namespace test {
 
         m_View       = m_Camera->getViewMatrix();
         m_Projection = glm::perspective(glm::radians(m_Camera->getFOV()), 800.0f / 600.0f, 0.1f, 1000.0f);
+
+        if (m_GridSize > 1 || m_Source != SOURCE_MODEL || m_UseClusters)
+            return;
+
+        if (m_AutoLod)
+        {
+            int width = 0, height = 0;
+            glfwGetFramebufferSize(m_window, &width, &height);
+            const float projectionScale = Model::ProjectionScale(static_cast<float>(std::max(height, 1)),
+                glm::radians(m_Camera->getFOV()));
+            m_Model->selectLods(m_ModelMatrix, m_Camera->getPosition(), projectionScale, m_LodThresholdPixels);
+        }
+        else
+        {
+            m_Model->forceLod(static_cast<std::size_t>(m_ForcedLod));
+        }
+    }
+
+    void TestHighDensityMesh::SetLighting(Shader& shader) const {
+        shader.Bind();
+        shader.setUniform3f("u_LightPos",     5.0f, 10.0f, 5.0f);
+        shader.setUniform3f("u_LightColor",   1.0f,  1.0f, 1.0f);
+        shader.setUniform1f("u_AmbientStrength",  0.15f);
+        shader.setUniform1f("u_SpecularStrength",  0.5f);
+        shader.setUniform1f("u_Shininess",        32.0f);
+        shader.setUniform1i("u_UseDiffuseTexture",  1);
+        shader.setUniform1i("u_UseSpecularTexture", 0);
     }
 
     void TestHighDensityMesh::Render() {
         Renderer renderer;
         renderer.Clear();
 
-        m_Shader->Bind();
+        // View/projection/camera position via the FrameData uniform block
+        // (u_Model is set per command by the render queue)
+        FrameUniforms::SetCamera(m_View, m_Projection, m_Camera->getPosition());
+
+        if (m_Source != SOURCE_MODEL)
+        {
+            RenderProcedural();
+            return;
+        }
+        if (m_GridSize > 1)
+        {
+            RenderField();
+            return;
+        }
+        if (m_UseClusters)
+        {
+            RenderClusters();
+            return;
+        }
+
+        // The model submits one multi-draw indirect command per material
+        // group, so N sub-meshes cost one API call per distinct material;
+        // with a bindless or array material table, one call in total.
+        const MaterialTable::Mode materials = m_Model->prepareMaterials();
+        Shader& shader = m_Shader->Variant("MATERIAL", MaterialTable::GetModeName(materials));
+        SetLighting(shader);
+
+        m_RenderQueue.Clear();
+        m_Model->Submit(m_RenderQueue, shader, m_ModelMatrix);
+        m_RenderQueue.FlushPass(RenderPass::Opaque);
+    }
+
+    // The culled paths draw into m_SceneFBO, whose depth becomes the Hi-Z
+    // pyramid for next frame's occlusion test
+    bool TestHighDensityMesh::BeginSceneTarget(int& width, int& height) {
+        glfwGetFramebufferSize(m_window, &width, &height);
+        if (width <= 0 || height <= 0)
+            return false;
+
+        if (!m_SceneFBO || m_SceneFBO->GetWidth() != width || m_SceneFBO->GetHeight() != height)
+        {
+            m_SceneFBO = std::make_unique<Framebuffer>(width, height);
+            m_HiZ->Invalidate();
+        }
+
+        m_SceneFBO->Bind();
+        Renderer renderer;
+        renderer.Clear();
+        return true;
+    }
+
+    void TestHighDensityMesh::EndSceneTarget(int width, int height, const glm::mat4& viewProjection) {
+        m_HiZ->Build(m_SceneFBO->GetDepthTexture(), width, height);
+        m_LastViewProjection = viewProjection;
+
+        m_SceneFBO->BlitToScreen(width, height);
+    }
+
+    // Cull against this frame's frustum and last frame's depth, draw the
+    // survivors, then build the pyramid for next frame from what was drawn.
+    void TestHighDensityMesh::RenderField() {
+        int width = 0, height = 0;
+        if (!BeginSceneTarget(width, height))
+            return;
+
+        const glm::mat4 viewProjection = m_Projection * m_View;
+        m_Culling->SetEnabled(m_EnableCulling);
+        if (m_EnableOcclusion)
+            m_Culling->Cull(viewProjection, *m_HiZ, m_LastViewProjection);
+        else
+            m_Culling->Cull(viewProjection);
 
-        // MVP
-        m_Shader->setUniformMat4f("u_Model",      m_ModelMatrix);
-        m_Shader->setUniformMat4f("u_View",       m_View);
-        m_Shader->setUniformMat4f("u_Projection", m_Projection);
+        Shader& shader = m_Shader->Variant("DRAW", "INSTANCED");
+        SetLighting(shader);
 
-        // Lighting
-        glm::vec3 camPos = m_Camera->getPosition();
-        m_Shader->setUniform3f("u_CameraPos",    camPos.x, camPos.y, camPos.z);
-        m_Shader->setUniform3f("u_LightPos",     5.0f, 10.0f, 5.0f);
-        m_Shader->setUniform3f("u_LightColor",   1.0f,  1.0f, 1.0f);
-        m_Shader->setUniform1f("u_AmbientStrength",  0.15f);
-        m_Shader->setUniform1f("u_SpecularStrength",  0.5f);
-        m_Shader->setUniform1f("u_Shininess",        32.0f);
-        m_Shader->setUniform1i("u_UseDiffuseTexture",  1);
-        m_Shader->setUniform1i("u_UseSpecularTexture", 0);
+        for (const Model::MaterialGroup& group : m_Model->getMaterialGroups())
+        {
+            if (group.material)
+                group.material->Bind(shader);
 
-        m_Model->Draw(*m_Shader);
+            m_Culling->Draw(group.firstDraw, group.drawCount);
+        }
+
+        EndSceneTarget(width, height, viewProjection);
+    }
+
+    // The model's meshlets, each culled on its own: the clusters off screen,
+    // facing away (about half of them on a closed model) or hidden behind
+    // last frame's depth never reach the vertex shader. Always level 0.
+    void TestHighDensityMesh::RenderClusters() {
+        int width = 0, height = 0;
+        if (!BeginSceneTarget(width, height))
+            return;
+
+        const glm::mat4 viewProjection = m_Projection * m_View;
+        m_Clusters->SetFrustumCulling(m_EnableCulling);
+        m_Clusters->SetBackfaceCulling(m_EnableConeCulling);
+        if (m_EnableOcclusion)
+            m_Clusters->Cull(viewProjection, m_ModelMatrix, m_Camera->getPosition(), *m_HiZ, m_LastViewProjection);
+        else
+            m_Clusters->Cull(viewProjection, m_ModelMatrix, m_Camera->getPosition());
+
+        // The model matrix is the clusters' one instance
+        Shader& shader = m_Shader->Variant("DRAW", "INSTANCED");
+        SetLighting(shader);
+
+        for (const Model::MaterialGroup& group : m_Model->getMaterialGroups())
+        {
+            if (group.material)
+                group.material->Bind(shader);
+
+            m_Clusters->Draw(group.firstDraw, group.drawCount);
+        }
+
+        EndSceneTarget(width, height, viewProjection);
+    }
+
+    void TestHighDensityMesh::RenderProcedural() {
+        if (!m_Procedural)
+            return;
+
+        // The terrain lies below the camera; the closed shapes turn like the model
+        glm::mat4 model = m_ModelMatrix;
+        if (m_Source == SOURCE_TERRAIN)
+            model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -25.0f, -60.0f));
+
+        SetLighting(*m_ProceduralShader);
+        m_ProceduralShader->setUniform1i("u_UseDiffuseTexture", 0);
+
+        const MeshArena::Range& range = m_Procedural->getArenaRange();
+        RenderCommand command;
+        command.shader = m_ProceduralShader.get();
+        command.vao = m_Procedural->getVertexArray();
+        command.ibo = m_Procedural->getIndexBuffer();
+        command.indexCount = range.indexCount;
+        command.firstIndex = range.firstIndex;
+        command.baseVertex = range.baseVertex;
+        command.model = model;
+
+        m_RenderQueue.Clear();
+        m_RenderQueue.Submit(RenderPass::Opaque, command);
+        m_RenderQueue.FlushPass(RenderPass::Opaque);
     }
 
     void TestHighDensityMesh::RenderGUI() {
         m_Camera->cameraGUI();
+
+        if (ImGui::Combo("Geometry", &m_Source, "Model\0GPU terrain\0GPU sphere\0GPU torus\0"))
+            GenerateProcedural();
+        if (m_Source != SOURCE_MODEL)
+        {
+            // Regenerate once the slider is let go, not on every step of the drag
+            ImGui::SliderInt("Divisions", &m_Divisions, 16, 2000);
+            if (ImGui::IsItemDeactivatedAfterEdit())
+                GenerateProcedural();
+            // Reloads the model too, which regenerates the mesh
+            if (ImGui::Checkbox("Packed vertices", &m_PackedVertices))
+                LoadModel(m_PackedVertices ? VertexFormat::Packed : VertexFormat::Standard);
+
+            if (m_Procedural)
+            {
+                const MeshArena::Range& range = m_Procedural->getArenaRange();
+                const unsigned int stride = GetVertexStride(m_Procedural->getVertexFormat());
+                ImGui::Text("%u vertices, %u triangles: %.1f MB written by one dispatch", range.vertexCount,
+                    range.indexCount / 3, (range.vertexCount * static_cast<float>(stride)
+                        + range.indexCount * static_cast<float>(sizeof(unsigned int))) / (1024.0f * 1024.0f));
+                ImGui::Text("CPU time to generate: %.2f ms (no upload, no CPU copy)", m_GenerateMilliseconds);
+            }
+            return;
+        }
+
+        if (ImGui::SliderInt("Model grid", &m_GridSize, 1, 200))
+        {
+            BuildInstances();
+        }
+
+        // Same shaders either way: the packed attributes expand on fetch
+        if (ImGui::Checkbox("Packed vertices", &m_PackedVertices))
+            LoadModel(m_PackedVertices ? VertexFormat::Packed : VertexFormat::Standard);
+
+        // What stays in memory once the arena has the geometry (Mesh::ReleaseCpuData)
+        if (ImGui::Combo("CPU copies", &m_CpuData, "Full\0Positions\0None\0"))
+            LoadModel(m_Model->getVertexFormat());
+        ImGui::Text("  %.2f MB kept on the CPU, %.2f MB released", m_Model->getCpuBytes() / (1024.0f * 1024.0f),
+            m_Model->getCpuBytesReleased() / (1024.0f * 1024.0f));
+
+        // Node transforms baked in, meshes sharing textures joined (Model::MergeOptions)
+        if (ImGui::Checkbox("Merge meshes by material", &m_MergeMeshes))
+            LoadModel(m_Model->getVertexFormat());
+        if (m_Model->getSourceMeshCount() > 0)
+            ImGui::Text("  %zu indirect draws from %zu node meshes, in %zu multi-draw calls", m_Model->getMeshCount(),
+                m_Model->getSourceMeshCount(), m_Model->getMaterialGroupCount());
+        else
+            ImGui::Text("  %zu indirect draws in %zu multi-draw calls", m_Model->getMeshCount(),
+                m_Model->getMaterialGroupCount());
+
+        // The cache holds Vertex data whichever format is on the GPU
+        bool useCache = MeshCache::IsEnabled();
+        if (ImGui::Checkbox("Mesh cache", &useCache))
+            MeshCache::SetEnabled(useCache);
+        ImGui::SameLine();
+        if (ImGui::Button("Reload"))
+            LoadModel(m_Model->getVertexFormat());
+        ImGui::SameLine();
+        if (ImGui::Button("Delete cache"))
+            MeshCache::Remove(MODEL_PATH);
+        const Model::LoadTimings& timings = m_Model->getLoadTimings();
+        ImGui::Text("Load time: %.1f ms (%s)", timings.total,
+            m_Model->wasLoadedFromCache() ? "mesh cache" : "Assimp import");
+        ImGui::Text("  parse %.1f  upload %.1f ms", timings.parse, timings.upload);
+        ImGui::Text("  convert %.1f + decode %.1f ms in %.1f ms on %u workers",
+            timings.convert, timings.decode, timings.parallel, timings.threads);
+
+        std::size_t vertexCount = 0;
+        for (const ModelMesh& mesh : m_Model->getMeshes())
+            vertexCount += mesh.getVertexCount();
+        const unsigned int stride = GetVertexStride(m_Model->getVertexFormat());
+        ImGui::Text("Vertex buffer: %zu vertices x %u B = %.2f MB", vertexCount, stride,
+            vertexCount * static_cast<float>(stride) / (1024.0f * 1024.0f));
+
+        if (m_GridSize <= 1)
+        {
+            // The pyramid of the other path's scene means nothing here
+            if (ImGui::Checkbox("Cluster culling (meshlets)", &m_UseClusters))
+                m_HiZ->Invalidate();
+            if (m_UseClusters)
+            {
+                ImGui::Checkbox("Frustum culling", &m_EnableCulling);
+                ImGui::SameLine();
+                ImGui::Checkbox("Backface cones", &m_EnableConeCulling);
+                ImGui::SameLine();
+                ImGui::Checkbox("Hi-Z occlusion", &m_EnableOcclusion);
+
+                // The counts are a frame old
+                const ClusterCulling::Stats& clusters = m_Clusters->GetStats();
+                ImGui::Text("Clusters: %u (%u triangles, %.1f per cluster)", clusters.clusters, clusters.triangles,
+                    clusters.clusters ? static_cast<float>(clusters.triangles) / clusters.clusters : 0.0f);
+                ImGui::Text("Drawn: %u  Culled: %u (frustum %u, backface %u, occluded %u)", clusters.visible,
+                    clusters.GetCulled(), clusters.frustumCulled, clusters.backfaceCulled, clusters.occluded);
+                ImGui::Text("Draw calls: %u, %u commands", static_cast<unsigned int>(m_Model->getMaterialGroupCount()),
+                    clusters.clusters);
+                return;
+            }
+
+            const RenderQueue::Stats& stats = m_RenderQueue.GetStats();
+            ImGui::Text("Sub-meshes: %u  Draw calls: %u  Material binds: %u",
+                stats.instances, stats.drawCalls, stats.materialBinds);
+
+            // Bindless falls back to Array without the extension, Array to
+            // Bound when the textures differ in size or format
+            int requested = static_cast<int>(MaterialTable::GetRequestedMode());
+            if (ImGui::Combo("Materials", &requested, "Bound per group\0Bindless\0Texture array\0"))
+                MaterialTable::SetRequestedMode(static_cast<MaterialTable::Mode>(requested));
+            const MaterialTable* table = m_Model->getMaterialTable();
+            ImGui::Text("  in use: %s (bindless %s), %zu material(s), array copy %.1f MB",
+                MaterialTable::GetModeName(m_Model->getMaterialMode()),
+                MaterialTable::IsBindlessSupported() ? "supported" : "unsupported",
+                table ? table->GetMaterialCount() : 0, table ? table->GetArrayBytes() / (1024.0f * 1024.0f) : 0.0f);
+
+            // Import-time reordering (MeshOptimizer): vertices shaded per
+            // triangle and per unique vertex, 16-entry FIFO cache
+            const MeshOptimizer::Report& report = m_Model->getOptimizationReport();
+            ImGui::Text("ACMR: %.3f -> %.3f  ATVR: %.3f -> %.3f",
+                report.before.GetACMR(), report.after.GetACMR(),
+                report.before.GetATVR(), report.after.GetATVR());
+            RenderLodGUI();
+            return;
+        }
+
+        ImGui::Checkbox("Frustum culling", &m_EnableCulling);
+        ImGui::Checkbox("Hi-Z occlusion culling", &m_EnableOcclusion);
+
+        const GPUCulling::Stats& stats = m_Culling->GetStats();
+        ImGui::Text("Sub-mesh instances: %u (%d models)", stats.instances, m_GridSize * m_GridSize);
+        // The counts are a frame old, so right after a grid change they may
+        // not add up to the new instance total yet
+        const unsigned int kept = stats.visible + stats.occluded;
+        ImGui::Text("Drawn: %u  Occluded: %u  Outside frustum: %u",
+            stats.visible, stats.occluded, stats.instances > kept ? stats.instances - kept : 0u);
+        ImGui::Text("Hi-Z: %d x %d, %u levels", m_HiZ->GetWidth(), m_HiZ->GetHeight(), m_HiZ->GetLevelCount());
+        ImGui::Text("Draw calls: %u", static_cast<unsigned int>(m_Model->getMaterialGroupCount()));
+    }
+
+    // Triangles each level would draw over the whole model, how many meshes
+    // currently use it, and the choice per mesh.
+    void TestHighDensityMesh::RenderLodGUI() {
+        const std::vector<ModelMesh>& meshes = m_Model->getMeshes();
+
+        std::size_t levels = 1;
+        for (const ModelMesh& mesh : meshes)
+            levels = std::max(levels, mesh.getLodCount());
+
+        ImGui::Separator();
+        ImGui::Checkbox("Automatic LOD", &m_AutoLod);
+        if (m_AutoLod)
+            ImGui::SliderFloat("Error threshold (pixels)", &m_LodThresholdPixels, 0.1f, 16.0f, "%.1f");
+        else
+            ImGui::SliderInt("Forced LOD", &m_ForcedLod, 0, static_cast<int>(levels) - 1);
+
+        std::size_t drawn = 0;
+        for (std::size_t level = 0; level < levels; level++)
+        {
+            std::size_t triangles = 0;
+            unsigned int users = 0;
+            for (std::size_t m = 0; m < meshes.size(); m++)
+            {
+                const std::size_t count = meshes[m].getLodCount();
+                if (count == 0)
+                    continue;
+                triangles += meshes[m].getLodIndexCount(std::min(level, count - 1)) / 3;
+                if (m_Model->getMeshLod(m) == level)
+                {
+                    users++;
+                    drawn += meshes[m].getLodIndexCount(level) / 3;
+                }
+            }
+            ImGui::Text("LOD %d: %zu triangles, used by %u mesh(es)", static_cast<int>(level), triangles, users);
+        }
+        ImGui::Text("Drawing %zu triangles", drawn);
+
+        if (ImGui::CollapsingHeader("LOD per mesh"))
+        {
+            for (std::size_t m = 0; m < meshes.size(); m++)
+            {
+                const std::size_t count = meshes[m].getLodCount();
+                if (count == 0)
+                    continue;
+                const std::size_t lod = m_Model->getMeshLod(m);
+                ImGui::Text("Mesh %d: LOD %d of %d, %u triangles, error %.4f", static_cast<int>(m),
+                    static_cast<int>(lod), static_cast<int>(count) - 1,
+                    meshes[m].getLodIndexCount(lod) / 3, meshes[m].getLodError(lod));
+            }
+        }
     }
 
 }
@@ -4,6 +4,11 @@
 #include "../utils/Camera.h"
 
 #include "../Mesh/Model.h"
+#include "../RenderQueue.h"
+#include "../GPUCulling.h"
+#include "../ClusterCulling.h"
+#include "../HiZBuffer.h"
+#include "../Framebuffer.h"
 
 #include "GL/glew.h"
 #include <GLFW/glfw3.h>
@@ -11,15 +16,38 @@
 #include "glm/glm.hpp"
 
 namespace test {
+    // One dense model, or an N x N field of copies of it drawn through
+    // GPUCulling with Hi-Z occlusion: rows behind the first few are hidden,
+    // so most of the field never reaches the vertex shader. The single
+    // model can instead be drawn meshlet by meshlet through ClusterCulling.
     class TestHighDensityMesh : public Tests {
     public:
         TestHighDensityMesh(GLFWwindow* window);
 
+        // The mesh, culling and Hi-Z programs into ShaderCache, on the
+        // BackgroundLoader (see TestMenu::PreloadAll). The model itself
+        // loads from its MeshCache file.
+        static void Preload();
+        void OnResume() override;
+
         void Update(float deltaTime) override;
         void Render() override;
         void RenderGUI() override;
 
     private:
+        static constexpr const char* MODEL_PATH = "res/Models/poly.obj";
+
+        void SetLighting(Shader& shader) const;
+        void BuildInstances();
+        void RenderField();
+        void RenderClusters();
+        bool BeginSceneTarget(int& width, int& height);
+        void EndSceneTarget(int width, int height, const glm::mat4& viewProjection);
+        void RenderLodGUI();
+        void LoadModel(VertexFormat format);
+        void GenerateProcedural();
+        void RenderProcedural();
+
         GLFWwindow* m_window;
 
         std::unique_ptr<Camera> m_Camera;
@@ -33,6 +61,42 @@ namespace test {
         std::unique_ptr<Model>  m_Model;
         std::unique_ptr<Shader> m_Shader;
 
+        RenderQueue m_RenderQueue;
+
         float m_ModelRotationSpeed;
+        bool  m_PackedVertices;                   // PackedVertex instead of Vertex on the GPU
+        int   m_CpuData;                          // Mesh::CpuData the model keeps; it draws from the arena only
+        bool  m_MergeMeshes;                      // Model::MergeOptions at import
+
+        // Level of detail of the single model (Model::selectLods). The
+        // field keeps level 0: GPUCulling draws its own per-mesh ranges.
+        bool  m_AutoLod;
+        float m_LodThresholdPixels;
+        int   m_ForcedLod;                        // used when m_AutoLod is off
+
+        // Instanced field. Culler mesh d is the model's draw d, so each
+        // material group is one contiguous range of culler meshes.
+        int m_GridSize;                          // 1 = the single rotating model
+        std::unique_ptr<GPUCulling> m_Culling;
+        std::unique_ptr<HiZBuffer> m_HiZ;
+        std::unique_ptr<Framebuffer> m_SceneFBO;  // its depth feeds the next frame's Hi-Z
+        glm::mat4 m_LastViewProjection;           // what m_HiZ was drawn with
+        bool m_EnableCulling;
+        bool m_EnableOcclusion;
+
+        // Single model through its meshlets, culled per cluster on the GPU;
+        // frustum and occlusion use the switches above, m_SceneFBO and m_HiZ
+        bool m_UseClusters;
+        bool m_EnableConeCulling;
+        std::unique_ptr<ClusterCulling> m_Clusters;
+
+        // Instead of the model: a mesh from GeometryFactory's GPU
+        // generators, m_Divisions^2 cells written straight into the arena
+        enum Source { SOURCE_MODEL = 0, SOURCE_TERRAIN, SOURCE_SPHERE, SOURCE_TORUS };
+        int m_Source;
+        int m_Divisions;
+        std::unique_ptr<Mesh> m_Procedural;
+        std::shared_ptr<Shader> m_ProceduralShader;
+        float m_GenerateMilliseconds;             // CPU time of the call, GPU work excluded
     };
 }
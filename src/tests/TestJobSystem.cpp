@@ -0,0 +1,177 @@
+#include "TestJobSystem.h"
+#include "../Renderer.h"
+#include "../GLState.h"
+#include "../vendor/imgui/imgui.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace test
+{
+    typedef std::chrono::steady_clock Clock;
+
+    static double NanosecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    TestJobSystem::TestJobSystem()
+        : m_Checksum(0.0)
+    {
+    }
+
+    double TestJobSystem::Work(unsigned int begin, unsigned int end)
+    {
+        double sum = 0.0;
+        for (unsigned int i = begin; i < end; i++)
+            sum += std::sqrt(static_cast<double>(i)) * std::sin(static_cast<double>(i) * 0.001);
+        return sum;
+    }
+
+    void TestJobSystem::RunOverhead()
+    {
+        ThreadPool& pool = ThreadPool::Get();
+        m_Overhead.clear();
+
+        auto measure = [&](const char* name, unsigned int tasks, auto&& run)
+        {
+            const ThreadPool::Stats before = pool.GetStats();
+            const Clock::time_point start = Clock::now();
+            run();
+            OverheadResult result;
+            result.name = name;
+            result.tasks = tasks;
+            result.nsPerTask = NanosecondsSince(start) / tasks;
+            result.stolen = pool.GetStats().stolen - before.stolen;
+            m_Overhead.push_back(result);
+        };
+
+        // A tenth as many: each future is a shared state of its own
+        const unsigned int futures = OVERHEAD_TASKS / 10;
+        measure("Submit + future", futures, [&]()
+            {
+                std::vector<std::future<void>> waiting;
+                waiting.reserve(futures);
+                for (unsigned int i = 0; i < futures; i++)
+                    waiting.push_back(pool.Submit([]() {}));
+                for (std::future<void>& future : waiting)
+                    future.get();
+            });
+
+        measure("TaskGroup, from main", OVERHEAD_TASKS, [&]()
+            {
+                TaskGroup group(pool);
+                for (unsigned int i = 0; i < OVERHEAD_TASKS; i++)
+                    group.Run([]() {});
+                group.Wait();
+            });
+
+        measure("TaskGroup, from a worker", OVERHEAD_TASKS, [&]()
+            {
+                TaskGroup outer(pool);
+                outer.Run([&pool]()
+                    {
+                        TaskGroup inner(pool);
+                        for (unsigned int i = 0; i < OVERHEAD_TASKS; i++)
+                            inner.Run([]() {});
+                        inner.Wait();
+                    });
+                outer.Wait();
+            });
+
+        measure("ParallelFor, 1-element chunks", OVERHEAD_TASKS, [&]()
+            {
+                pool.ParallelFor(OVERHEAD_TASKS, 1, [](unsigned int, unsigned int, unsigned int) {});
+            });
+    }
+
+    void TestJobSystem::RunScaling()
+    {
+        ThreadPool& pool = ThreadPool::Get();
+        m_Scaling.clear();
+
+        const unsigned int available = pool.GetThreadCount() + 1;
+        std::vector<unsigned int> counts;
+        for (unsigned int participants = 1; participants <= 32 && participants <= available; participants *= 2)
+            counts.push_back(participants);
+        if (counts.back() != available && available <= 32)
+            counts.push_back(available);
+
+        // Padded so the participants' running sums don't share cache lines
+        struct alignas(64) Partial { double sum; };
+        std::vector<Partial> partials(available);
+
+        for (unsigned int participants : counts)
+        {
+            double best = 0.0;
+            for (int run = 0; run < SCALING_RUNS; run++)
+            {
+                for (Partial& partial : partials)
+                    partial.sum = 0.0;
+                const Clock::time_point start = Clock::now();
+                pool.ParallelFor(SCALING_ELEMENTS, SCALING_CHUNK,
+                    [&partials](unsigned int begin, unsigned int end, unsigned int participant)
+                    {
+                        partials[participant].sum += Work(begin, end);
+                    }, participants);
+                const double ms = NanosecondsSince(start) / 1000000.0;
+                best = run == 0 || ms < best ? ms : best;
+            }
+
+            m_Checksum = 0.0;
+            for (const Partial& partial : partials)
+                m_Checksum += partial.sum;
+
+            ScalingResult result;
+            result.participants = participants;
+            result.ms = best;
+            result.speedup = m_Scaling.empty() ? 1.0 : m_Scaling.front().ms / best;
+            m_Scaling.push_back(result);
+        }
+    }
+
+    void TestJobSystem::Render()
+    {
+        GLState::ClearColor(0.1f, 0.1f, 0.12f, 1.0f);
+        GlCall(glClear(GL_COLOR_BUFFER_BIT));
+    }
+
+    void TestJobSystem::RenderGUI()
+    {
+        ThreadPool& pool = ThreadPool::Get();
+        const ThreadPool::Stats stats = pool.GetStats();
+        ImGui::Text("%u workers + the main thread, %u hardware threads", pool.GetThreadCount(),
+            std::thread::hardware_concurrency());
+        ImGui::Text("%llu tasks run by workers, %llu stolen", static_cast<unsigned long long>(stats.executed),
+            static_cast<unsigned long long>(stats.stolen));
+
+        if (ImGui::CollapsingHeader("Task overhead", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            if (ImGui::Button("Run overhead"))
+                RunOverhead();
+            for (const OverheadResult& result : m_Overhead)
+            {
+                ImGui::Text("%-30s %7u tasks %8.0f ns/task %7llu stolen", result.name, result.tasks, result.nsPerTask,
+                    result.stolen);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("ParallelFor scaling", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::TextWrapped("%u elements of sqrt * sin in %u-element chunks, best of %d runs.", SCALING_ELEMENTS,
+                SCALING_CHUNK, SCALING_RUNS);
+            if (ImGui::Button("Run scaling"))
+                RunScaling();
+            if (!m_Scaling.empty())
+            {
+                ImGui::Text("%8s %10s %8s %10s", "Threads", "ms", "Speedup", "Efficiency");
+                for (const ScalingResult& result : m_Scaling)
+                {
+                    ImGui::Text("%8u %10.3f %7.2fx %9.0f%%", result.participants, result.ms, result.speedup,
+                        100.0 * result.speedup / result.participants);
+                }
+                ImGui::Text("Checksum %.6g", m_Checksum);
+            }
+        }
+    }
+}
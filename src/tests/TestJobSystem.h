@@ -0,0 +1,66 @@
+#pragma once
+#include "Tests.h"
+#include "../ThreadPool.h"
+
+#include <vector>
+
+namespace test
+{
+    /**
+     * TestJobSystem — what a task costs, and how ParallelFor scales
+     *
+     * Two measurements of the ThreadPool, each run on a button press (the
+     * window stalls while they do):
+     *
+     *   overhead  empty tasks through each way of starting one: Submit
+     *             with a future, a TaskGroup filled from the main thread
+     *             (the shared queue), one filled from a worker (its own
+     *             deque, with the others stealing) and one-element
+     *             ParallelFor chunks. Nanoseconds per task, wall clock.
+     *   scaling   a fixed amount of arithmetic split by ParallelFor over
+     *             1, 2, 4 ... 32 participants, up to the pool's size: the
+     *             best of a few runs, its speedup over one thread and the
+     *             efficiency (speedup / threads).
+     *
+     * Counts above the pool's size are skipped rather than oversubscribed,
+     * so on a 4-core machine the table stops at 4.
+     */
+    class TestJobSystem : public Tests
+    {
+    public:
+        TestJobSystem();
+
+        void Render() override;
+        void RenderGUI() override;
+
+    private:
+        struct OverheadResult
+        {
+            const char* name;
+            unsigned int tasks;
+            double nsPerTask;
+            unsigned long long stolen;
+        };
+
+        struct ScalingResult
+        {
+            unsigned int participants;
+            double ms;
+            double speedup;
+        };
+
+        void RunOverhead();
+        void RunScaling();
+        // The workload: a sum over [begin, end)
+        static double Work(unsigned int begin, unsigned int end);
+
+        static const unsigned int OVERHEAD_TASKS = 100000;
+        static const unsigned int SCALING_ELEMENTS = 1u << 23;
+        static const unsigned int SCALING_CHUNK = 16384;
+        static const int SCALING_RUNS = 5;
+
+        std::vector<OverheadResult> m_Overhead;
+        std::vector<ScalingResult> m_Scaling;
+        double m_Checksum;       // of the last scaling run, so the work isn't optimised away
+    };
+}
@@ -1,4 +1,7 @@
 #include "TestLightingShader.h"
+#include "../GLState.h"
+#include "../FrameUniforms.h"
+#include "../ShaderLibrary.h"
 #include "../Renderer.h"
 #include "../vendor/imgui/imgui.h"
 #include <glm/gtc/type_ptr.hpp>
@@ -21,14 +24,26 @@ test::TestLightingShader::TestLightingShader(GLFWwindow* window)
 		45.0f                          // FOV
 	);
 
-	m_PhongShader = std::make_unique<Shader>("res/shaders/Lighting/Phong.shader");
-	m_FlatShader = std::make_unique<Shader>("res/shaders/Lighting/Flat.shader");
-	m_GouraudShader = std::make_unique<Shader>("res/shaders/Lighting/Gouraud.shader");
-	m_BlinnPhongShader = std::make_unique<Shader>("res/shaders/Lighting/Blinn-Phong.shader");
-
-	m_Sphere = GeometryFactory::CreateSphere(20, 20);
-
-	glEnable(GL_DEPTH_TEST);
+	m_PhongShader = ShaderLibrary::Get("res/shaders/Lighting/Phong.shader");
+	m_FlatShader = ShaderLibrary::Get("res/shaders/Lighting/Flat.shader");
+	m_GouraudShader = ShaderLibrary::Get("res/shaders/Lighting/Gouraud.shader");
+	m_BlinnPhongShader = ShaderLibrary::Get("res/shaders/Lighting/Blinn-Phong.shader");
+	m_TessellatedShader = ShaderLibrary::Get("res/shaders/Lighting/Tessellated.shader");
+	m_TessellatedShader->CompileAllVariants();
+
+	// As round as a 20 x 20 UV sphere, in fewer triangles
+	m_Sphere = GeometryFactory::CreateGeodesicSphere(
+		GeometryFactory::SelectGeodesicSphere(GeometryFactory::GetUVSphereError(20, 20)));
+	// The tessellated sphere starts from 80 triangles; the GPU adds the rest
+	m_CoarseSphere = GeometryFactory::CreateGeodesicSphere(GeometryFactory::SphereBase::Icosahedron, 1);
+	m_Ground = GeometryFactory::CreatePlaneGPU(8, 40.0f);
+	m_Ground->setPosition(glm::vec3(0.0f, -2.0f, 0.0f));
+
+	int maxLevel = 64;
+	GlCall(glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel));
+	m_MaxTessLevel = static_cast<float>(maxLevel);
+
+	GLState::Enable(GL_DEPTH_TEST);
 }
 
 void test::TestLightingShader::Update(float deltaTime)
@@ -49,6 +64,40 @@ void test::TestLightingShader::Render()
 	Renderer renderer;
 	renderer.Clear();
 
+	// View, projection and camera position go to every shader at once
+	// through the FrameData uniform block.
+	glm::vec3 camPos = m_Camera->getPosition();
+	FrameUniforms::SetCamera(m_View, m_Projection, camPos);
+
+	if (m_CurrentShader == 4)
+	{
+		int width = 0, height = 0;
+		glfwGetFramebufferSize(m_Window, &width, &height);
+
+		Shader& sphereShader = m_TessellatedShader->Variant("SURFACE", "SPHERE");
+		Shader& groundShader = m_TessellatedShader->Variant("SURFACE", "PLANE");
+		for (Shader* tessellated : { &sphereShader, &groundShader })
+		{
+			tessellated->Bind();
+			SetLightingUniforms(*tessellated);
+			tessellated->setUniform1f("u_ViewportHeight", static_cast<float>(height));
+			tessellated->setUniform1f("u_EdgePixels", m_EdgePixels);
+			tessellated->setUniform1f("u_MaxLevel", m_MaxTessLevel);
+			tessellated->setUniform1i("u_Cull", m_TessCull ? 1 : 0);
+		}
+
+		sphereShader.Bind();
+		sphereShader.setUniformMat4f("u_Model", m_Model);
+		m_CoarseSphere->Draw();
+
+		groundShader.Bind();
+		groundShader.setUniformMat4f("u_Model", m_Ground->getTransformMatrix());
+		groundShader.setUniform1f("u_Displacement", m_Displacement);
+		groundShader.setUniform1f("u_Frequency", 0.25f);
+		m_Ground->Draw();
+		return;
+	}
+
 	Shader* shader = nullptr;
 	switch (m_CurrentShader)
 	{
@@ -59,24 +108,31 @@ void test::TestLightingShader::Render()
 	default: shader = m_PhongShader.get();
 	}
 
+	// Phong can pull its vertices instead of fetching attributes
+	const bool pull = m_PullVertices && m_CurrentShader == 0;
+	if (pull)
+		shader = &m_PhongShader->Variant("PULL", MeshArena::GetPullVariant(m_Sphere->getVertexFormat()));
+
 	shader->Bind();
 	shader->setUniformMat4f("u_Model", m_Model);
-	shader->setUniformMat4f("u_View", m_View);
-	shader->setUniformMat4f("u_Projection", m_Projection);
-
-	shader->setUniform3f("u_Light.Position", m_LightPosition.x, m_LightPosition.y, m_LightPosition.z);
-	shader->setUniform3f("u_Light.Colour", m_LightColour.r, m_LightColour.g, m_LightColour.b);
+	SetLightingUniforms(*shader);
 
-	glm::vec3 camPos = m_Camera->getPosition();
-	shader->setUniform3f("u_CameraPosition", camPos.x, camPos.y, camPos.z);
+	m_Sphere->setPosition(glm::vec3(0, 0, 0));
+	if (pull)
+		m_Sphere->DrawPulled(*shader);
+	else
+		m_Sphere->Draw();
+}
 
-	shader->setUniform1f("u_AmbientIntensity", m_AmbientIntensity);
-	shader->setUniform1f("u_DiffuseIntensity", m_DiffuseIntensity);
-	shader->setUniform1f("u_SpecularIntensity", m_SpecularIntensity);
-	shader->setUniform1f("u_Shininess", m_Shininess);
+void test::TestLightingShader::SetLightingUniforms(Shader& shader)
+{
+	shader.setUniform3f("u_Light.Position", m_LightPosition.x, m_LightPosition.y, m_LightPosition.z);
+	shader.setUniform3f("u_Light.Colour", m_LightColour.r, m_LightColour.g, m_LightColour.b);
 
-	m_Sphere->setPosition(glm::vec3(0, 0, 0));
-	m_Sphere->Draw();
+	shader.setUniform1f("u_AmbientIntensity", m_AmbientIntensity);
+	shader.setUniform1f("u_DiffuseIntensity", m_DiffuseIntensity);
+	shader.setUniform1f("u_SpecularIntensity", m_SpecularIntensity);
+	shader.setUniform1f("u_Shininess", m_Shininess);
 }
 
 void test::TestLightingShader::RenderGUI()
@@ -107,9 +163,20 @@ void test::TestLightingShader::RenderGUI()
 
 	ImGui::Separator();
 	ImGui::Text("Shader Selection");
-	const char* shaders[] = { "Phong", "Flat", "Gouraud", "Blinn-Phong" };
+	const char* shaders[] = { "Phong", "Flat", "Gouraud", "Blinn-Phong", "Adaptive tessellation" };
 	ImGui::Combo("Active Shader", &m_CurrentShader, shaders, IM_ARRAYSIZE(shaders));
 
+	if (m_CurrentShader == 4)
+	{
+		// Smaller targets split edges further; wireframe shows the levels
+		// falling off with distance
+		ImGui::SliderFloat("Pixels per segment", &m_EdgePixels, 2.0f, 64.0f);
+		ImGui::SliderFloat("Ground displacement", &m_Displacement, 0.0f, 4.0f);
+		ImGui::Checkbox("Cull patches outside the view", &m_TessCull);
+	}
+	if (m_CurrentShader == 0)
+		ImGui::Checkbox("Vertex pulling (no attributes, see MeshArena.h)", &m_PullVertices);
+
 	if (ImGui::Checkbox("Wireframe Mode", &m_Wireframe)) {
 		glPolygonMode(GL_FRONT_AND_BACK, m_Wireframe ? GL_LINE : GL_FILL);
 	}
@@ -20,14 +20,26 @@ namespace test
 		void RenderGUI() override;
 
 	private:
+		void SetLightingUniforms(Shader& shader);
+
 		GLFWwindow* m_Window;
 
 		std::unique_ptr<Camera> m_Camera;
 		std::unique_ptr<Mesh> m_Sphere;
-		std::unique_ptr<Shader> m_PhongShader;
-		std::unique_ptr<Shader> m_FlatShader;
-		std::unique_ptr<Shader> m_GouraudShader;
-		std::unique_ptr<Shader> m_BlinnPhongShader;
+		std::shared_ptr<Shader> m_PhongShader;
+		std::shared_ptr<Shader> m_FlatShader;
+		std::shared_ptr<Shader> m_GouraudShader;
+		std::shared_ptr<Shader> m_BlinnPhongShader;
+
+		// Adaptive tessellation (mode 4): a coarse icosphere cage and a ground
+		// plane, refined by Tessellated.shader from projected edge length
+		std::shared_ptr<Shader> m_TessellatedShader;
+		std::unique_ptr<Mesh> m_CoarseSphere;
+		std::unique_ptr<Mesh> m_Ground;
+		float m_EdgePixels = 12.0f;
+		float m_MaxTessLevel = 64.0f;
+		float m_Displacement = 1.0f;
+		bool m_TessCull = true;
 
 		// Lighting parameters
 		float m_AmbientIntensity;
@@ -44,8 +56,9 @@ namespace test
 		glm::mat4 m_View;
 		glm::mat4 m_Projection;
 
-		int m_CurrentShader = 0; // 0: Phong, 1: Flat, 2: Gouraud, 3: Blinn-Phong, 4: PBR
+		int m_CurrentShader = 0; // 0: Phong, 1: Flat, 2: Gouraud, 3: Blinn-Phong, 4: Adaptive tessellation
 		bool m_Wireframe = false;
+		bool m_PullVertices = false;
 	};
 }
 
@@ -1,7 +1,12 @@
 #include "TestPBR.h"
+#include "../GLState.h"
+#include "../FrameUniforms.h"
+#include "../ShaderLibrary.h"
 #include "../Renderer.h"
+#include "../Profiler.h"
 #include "../vendor/imgui/imgui.h"
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
 
 test::TestPBR::TestPBR(GLFWwindow* window)
 	: m_Window(window),
@@ -22,11 +27,40 @@ test::TestPBR::TestPBR(GLFWwindow* window)
 		45.0f                          // FOV
 	);
 
-	m_PBRShader = std::make_unique<Shader>("res/shaders/Lighting/PBR.shader");
+	m_PBRShader = ShaderLibrary::Get("res/shaders/Lighting/PBR.shader");
 
-	m_Sphere = GeometryFactory::CreateSphere(32, 32);
+	// Baked on the first run, read from res/IBLCache after that. Put an
+	// equirectangular .hdr at this path to light with it instead of the
+	// procedural sky.
+	m_Environment = std::make_unique<EnvironmentLighting>("res/Textures/environment.hdr");
+	m_SkyboxShader = std::make_unique<Shader>("res/Shaders/Lighting/Skybox.shader");
+	m_Quad = GeometryFactory::CreateFullscreenQuad();
 
-	glEnable(GL_DEPTH_TEST);
+	// As round as a 32 x 32 UV sphere, in fewer triangles
+	m_Sphere = GeometryFactory::CreateGeodesicSphere(
+		GeometryFactory::SelectGeodesicSphere(GeometryFactory::GetUVSphereError(32, 32)));
+
+	GLState::Enable(GL_DEPTH_TEST);
+	m_Queue.SetCountFragments(true);
+}
+
+void test::TestPBR::Preload()
+{
+	Shader::Prebuild("res/shaders/Lighting/PBR.shader");
+	Shader::Prebuild("res/Shaders/Lighting/Skybox.shader");
+	Shader::Prebuild("res/Shaders/DepthPrepass.shader");
+}
+
+void test::TestPBR::OnSuspend()
+{
+	// Wireframe would carry on into whatever opens next
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
+void test::TestPBR::OnResume()
+{
+	GLState::Enable(GL_DEPTH_TEST);
+	glPolygonMode(GL_FRONT_AND_BACK, m_Wireframe ? GL_LINE : GL_FILL);
 }
 
 void test::TestPBR::Update(float deltaTime)
@@ -50,30 +84,51 @@ void test::TestPBR::Render()
 	Renderer renderer;
 	renderer.Clear();
 
-	m_PBRShader->Bind();
+	// View, projection and camera position (for specular) via FrameData
+	FrameUniforms::SetCamera(m_View, m_Projection, m_Camera->getPosition());
+
+	if (m_ShowSkybox)
+	{
+		// Behind everything: no depth test, no depth written
+		GLState::Disable(GL_DEPTH_TEST);
+		m_SkyboxShader->Bind();
+		GLState::BindTextureToUnit(0, GL_TEXTURE_CUBE_MAP, m_Environment->GetPrefilteredMap());
+		m_SkyboxShader->setUniform1i("u_Environment", 0);
+		m_SkyboxShader->setUniform1f("u_Level", m_BackgroundBlur);
+		m_SkyboxShader->setUniform1f("u_Intensity", m_IBLIntensity);
+		m_SkyboxShader->setUniformMat4f("u_InverseViewProjection", glm::inverse(m_Projection * m_View));
+		m_Quad->Draw();
+		GLState::BindTextureToUnit(0, GL_TEXTURE_CUBE_MAP, 0);
+		GLState::Enable(GL_DEPTH_TEST);
+	}
 
-	// Transform uniforms
-	m_PBRShader->setUniformMat4f("u_Model", m_Model);
-	m_PBRShader->setUniformMat4f("u_View", m_View);
-	m_PBRShader->setUniformMat4f("u_Projection", m_Projection);
+	const char* pull = m_PullVertices ? MeshArena::GetPullVariant(m_Sphere->getVertexFormat()) : "OFF";
+	Shader& shader = m_PBRShader->Variant({ { "IBL", m_UseIBL ? "ON" : "OFF" }, { "PULL", pull } });
+	shader.Bind();
+	if (m_UseIBL)
+		m_Environment->Apply(shader, m_IBLIntensity);
 
 	// Material uniforms
-	m_PBRShader->setUniform3f("u_Albedo", m_Albedo.r, m_Albedo.g, m_Albedo.b);
-	m_PBRShader->setUniform1f("u_Metallic", m_Metallic);
-	m_PBRShader->setUniform1f("u_Roughness", m_Roughness);
-	m_PBRShader->setUniform1f("u_AO", m_AO);
+	shader.setUniform3f("u_Albedo", m_Albedo.r, m_Albedo.g, m_Albedo.b);
+	shader.setUniform1f("u_Metallic", m_Metallic);
+	shader.setUniform1f("u_Roughness", m_Roughness);
+	shader.setUniform1f("u_AO", m_AO);
 
 	// Light uniforms
-	m_PBRShader->setUniform3f("u_LightPosition", m_LightPosition.x, m_LightPosition.y, m_LightPosition.z);
-	m_PBRShader->setUniform3f("u_LightColor", m_LightColor.r, m_LightColor.g, m_LightColor.b);
-	m_PBRShader->setUniform1f("u_LightIntensity", m_LightIntensity);
-
-	// Camera position for specular calculation
-	glm::vec3 camPos = m_Camera->getPosition();
-	m_PBRShader->setUniform3f("u_CameraPosition", camPos.x, camPos.y, camPos.z);
-
-	m_Sphere->setPosition(glm::vec3(0, 0, 0));
-	m_Sphere->Draw();
+	shader.setUniform3f("u_LightPosition", m_LightPosition.x, m_LightPosition.y, m_LightPosition.z);
+	shader.setUniform3f("u_LightColor", m_LightColor.r, m_LightColor.g, m_LightColor.b);
+	shader.setUniform1f("u_LightIntensity", m_LightIntensity);
+
+	// The model matrix is the command's, set by the queue
+	RenderCommand cmd;
+	cmd.shader = &shader;
+	m_Sphere->FillCommand(cmd, m_PullVertices);
+	cmd.model = m_Model;
+
+	m_Queue.Clear();
+	m_Queue.Submit(RenderPass::Opaque, cmd);
+	m_Queue.SetDepthPrepass(m_DepthPrepass);
+	m_Queue.FlushPass(RenderPass::Opaque);
 }
 
 void test::TestPBR::RenderGUI()
@@ -101,12 +156,45 @@ void test::TestPBR::RenderGUI()
 	ImGui::ColorEdit3("Light Color", glm::value_ptr(m_LightColor));
 	ImGui::SliderFloat("Light Intensity", &m_LightIntensity, 0.0f, 1000.0f);
 
+	ImGui::Separator();
+	ImGui::Text("Environment Lighting");
+	ImGui::Checkbox("Image-based lighting", &m_UseIBL);
+	ImGui::SliderFloat("Environment intensity", &m_IBLIntensity, 0.0f, 4.0f);
+	ImGui::Checkbox("Show environment", &m_ShowSkybox);
+	ImGui::SliderFloat("Background blur", &m_BackgroundBlur, 0.0f,
+		static_cast<float>(EnvironmentLighting::PREFILTER_LEVELS - 1));
+	ImGui::Text("%s, %s in %.1f ms", m_Environment->IsProcedural() ? "Procedural sky" : "environment.hdr",
+		m_Environment->WasLoadedFromCache() ? "loaded from cache" : "baked", m_Environment->GetLoadMs());
+	if (ImGui::Button("Clear cache and rebake"))
+	{
+		EnvironmentLighting::ClearCache();
+		m_Environment = std::make_unique<EnvironmentLighting>("res/Textures/environment.hdr");
+	}
+
 	ImGui::Separator();
 	ImGui::Text("Display Options");
 	if (ImGui::Checkbox("Wireframe Mode", &m_Wireframe)) {
 		glPolygonMode(GL_FRONT_AND_BACK, m_Wireframe ? GL_LINE : GL_FILL);
 	}
 	ImGui::Checkbox("Rotate Model", &m_RotateModel);
+
+	ImGui::Separator();
+	ImGui::Text("Depth Pre-pass");
+	ImGui::Checkbox("Depth pre-pass", &m_DepthPrepass);
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(m_Window, &width, &height);
+	const RenderQueue::FragmentStats& fragments = m_Queue.GetFragmentStats();
+	const double pixels = std::max(1.0, static_cast<double>(width) * height);
+	ImGui::Text("Fragments shaded: %.2f M (%.2f per pixel)", fragments.shadedFragments / 1e6, fragments.shadedFragments / pixels);
+	if (fragments.prepass)
+	{
+		ImGui::Text("Pre-pass: %.2f M depth fragments", fragments.prepassFragments / 1e6);
+		ImGui::Text("GPU: %.2f ms depth + %.2f ms shading", Profiler::GetGpuMs("Depth pre-pass"), Profiler::GetGpuMs("Shading"));
+	}
+
+	// The same sphere from the arena's storage buffers and the empty VAO
+	ImGui::Checkbox("Vertex pulling", &m_PullVertices);
+	ImGui::Text("%u of %u draws pulled", m_Queue.GetStats().pulledDrawCalls, m_Queue.GetStats().drawCalls);
 }
 
 void test::TestPBR::ApplyMaterialPreset(int preset)
@@ -3,6 +3,8 @@
 #include <GLFW/glfw3.h>
 #include "Tests.h"
 #include "../Shader.h"
+#include "../EnvironmentLighting.h"
+#include "../RenderQueue.h"
 #include "../Mesh/GeometryFactory.h"
 #include "../utils/Camera.h"
 #include <memory>
@@ -15,6 +17,12 @@ namespace test
 	public:
 		TestPBR(GLFWwindow* window);
 
+		// The PBR, skybox and pre-pass programs into ShaderCache, on the
+		// BackgroundLoader (see TestMenu::PreloadAll)
+		static void Preload();
+		void OnSuspend() override;
+		void OnResume() override;
+
 		void Update(float deltaTime) override;
 		void Render() override;
 		void RenderGUI() override;
@@ -26,7 +34,24 @@ namespace test
 
 		std::unique_ptr<Camera> m_Camera;
 		std::unique_ptr<Mesh> m_Sphere;
-		std::unique_ptr<Shader> m_PBRShader;
+		std::shared_ptr<Shader> m_PBRShader;
+
+		// Image-based lighting: the environment's maps, and the background
+		std::unique_ptr<EnvironmentLighting> m_Environment;
+		std::unique_ptr<Shader> m_SkyboxShader;
+		std::unique_ptr<Mesh> m_Quad;
+		bool m_UseIBL = true;
+		bool m_ShowSkybox = true;
+		float m_IBLIntensity = 1.0f;
+		float m_BackgroundBlur = 0.0f;
+
+		// The sphere goes through a queue for the optional depth pre-pass:
+		// the BRDF and IBL fetches then run once per pixel, not once per
+		// layer of the sphere rasterised there
+		RenderQueue m_Queue;
+		bool m_DepthPrepass = false;
+		// The PULL variant: no vertex attributes (see MeshArena.h)
+		bool m_PullVertices = false;
 
 		// PBR material properties
 		glm::vec3 m_Albedo;
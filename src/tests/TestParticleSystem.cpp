@@ -1,22 +1,48 @@
 #include "TestParticleSystem.h"
-#include <cstdlib>
+#include "../GLState.h"
+#include "../Profiler.h"
+#include "../VertexLayout.h"
+#include <algorithm>
 #include <cmath>
+#include <chrono>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+template<>
+struct VertexLayoutOf<test::ParticleInstance>
+{
+    static constexpr VertexAttribute attributes[] = {
+        VERTEX_ATTRIBUTE(test::ParticleInstance, instance, GL_FLOAT, 3, false),        // location 0
+        VERTEX_ATTRIBUTE(test::ParticleInstance, color, GL_UNSIGNED_BYTE, 4, true),    // location 1
+    };
+};
+static_assert(VertexLayoutMatchesMembers<test::ParticleInstance>(), "ParticleInstance layout disagrees with its members");
+static_assert(VertexLayoutIsTightlyPacked<test::ParticleInstance>(), "ParticleInstance layout does not cover the struct");
+
 namespace test
 {
-    // Helper: random float in [lo, hi]
-    static float RandRange(float lo, float hi)
+    // 0..1 to an 8-bit normalised channel
+    static unsigned char ToUnorm8(float v)
     {
-        float t = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
-        return lo + t * (hi - lo);
+        v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+        return static_cast<unsigned char>(v * 255.0f + 0.5f);
     }
 
+    const unsigned int TestParticleSystem::BENCHMARK_COUNTS[BENCHMARK_SIZES] = { 5000, 100000, 1000000 };
+
     TestParticleSystem::TestParticleSystem(GLFWwindow* /*window*/)
         : m_ActiveCount(0)
+        , m_UpdateMs(0.0f)
+        , m_EmitMs(0.0f)
+        , m_Emitted(0)
+        , m_EmitFirst(0)
+        , m_ThreadCount(1)
+        , m_BaseInstance(0)
+        , m_DrawCount(0)
+        , m_DrawPath(DrawPath::Instances)
+        , m_SubmitMs(0.0f)
         , m_EmitterPos(480.0f, 300.0f)
         , m_Gravity(-200.0f)
         , m_EmissionRate(500.0f)
@@ -31,41 +57,32 @@ namespace test
         , m_ColorStart(1.0f, 0.6f, 0.1f, 1.0f)
         , m_ColorEnd(1.0f, 0.0f, 0.0f, 0.0f)
     {
-        srand(42);
-
-        // Reserve space
-        m_Particles.resize(MAX_PARTICLES);
-        // All particles start dead (life <= 0)
-        for (auto& p : m_Particles)
-            p.life = 0.0f;
-
-        // 4 verts per particle, 6 floats per vert (2 pos + 4 color)
-        m_VertexData.resize(MAX_PARTICLES * 4 * 6, 0.0f);
-
-        // --- Build static index buffer for all quads ---
-        // Each particle is a quad: 4 verts, 6 indices (two triangles)
-        std::vector<unsigned int> indices(MAX_PARTICLES * 6);
-        for (unsigned int i = 0; i < MAX_PARTICLES; i++)
+        // One generator per thread, each with its own fixed seed
+        m_Participants.resize(ThreadPool::Get().GetThreadCount() + 1);
+        for (unsigned int i = 0; i < m_Participants.size(); i++)
         {
-            unsigned int base = i * 4;
-            unsigned int idx = i * 6;
-            indices[idx + 0] = base + 0;
-            indices[idx + 1] = base + 1;
-            indices[idx + 2] = base + 2;
-            indices[idx + 3] = base + 2;
-            indices[idx + 4] = base + 3;
-            indices[idx + 5] = base + 0;
+            m_Participants[i].random.state = 42u + 0x9E3779B9u * i;
+            m_Participants[i].busyMs = m_Participants[i].emitMs = 0.0f;
+            m_Participants[i].chunks = 0;
         }
+        m_ThreadCount = static_cast<int>(m_Participants.size());
+
+        // Reserve space; all particles start dead (life <= 0)
+        m_Pool.Resize(MAX_PARTICLES);
+
+        // --- One quad's indices, drawn once per particle ---
+        // The vertex shader finds its corner from the index (gl_VertexID),
+        // so there is no per-vertex buffer at all
+        const unsigned int indices[6] = { 0, 1, 2, 2, 3, 0 };
 
         // Create OpenGL objects
         m_VAO = std::make_unique<VertexArray>();
-        m_VBO = std::make_unique<VertexBuffer>(MAX_PARTICLES * 4 * 6 * sizeof(float)); // dynamic
-        m_IBO = std::make_unique<IndexBuffer>(indices.data(), MAX_PARTICLES * 6);
+        // One region holds a full frame of instances; see StreamingBuffer.h
+        m_Stream = std::make_unique<StreamingBuffer>(MAX_PARTICLES * INSTANCE_STRIDE);
+        m_IBO = std::make_unique<IndexBuffer>(indices, 6);   // picks 16-bit
 
-        VertexBufferLayout layout;
-        layout.Push<float>(2); // position
-        layout.Push<float>(4); // color (rgba)
-        m_VAO->AddBuffer(*m_VBO, layout);
+        // position, size; color (rgba8, alpha already faded)
+        m_VAO->AddStreamingBuffer(*m_Stream, GetVertexLayout<ParticleInstance>(), 1);
 
         m_Shader = std::make_unique<Shader>(R"(res/Shaders/ParticleShader.shader)");
 
@@ -75,7 +92,6 @@ namespace test
 
         // Unbind everything
         m_VAO->unBind();
-        m_VBO->Unbind();
         m_IBO->Unbind();
         m_Shader->Unbind();
     }
@@ -86,122 +102,214 @@ namespace test
         if (deltaTime > 0.1f) deltaTime = 0.1f;
 
         // Emit new particles
+        const auto emitStart = std::chrono::steady_clock::now();
         EmitParticles(deltaTime);
+        m_EmitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - emitStart).count();
 
-        // Update existing particles
-        m_ActiveCount = 0;
-        for (unsigned int i = 0; i < MAX_PARTICLES; i++)
-        {
-            Particle& p = m_Particles[i];
-            if (p.life <= 0.0f) continue;
+        // Update existing particles and write their instances
+        Simulate(deltaTime);
+        for (const Participant& participant : m_Participants)
+            m_EmitMs += participant.emitMs;
+    }
 
-            p.life -= deltaTime;
-            if (p.life <= 0.0f) continue;
+    void TestParticleSystem::EmitParticles(float dt)
+    {
+        m_EmissionAccum += m_EmissionRate * dt;
+        int toEmit = static_cast<int>(m_EmissionAccum);
+        m_EmissionAccum -= static_cast<float>(toEmit);
 
-            // Physics
-            p.vel.y += m_Gravity * deltaTime;
-            p.pos += p.vel * deltaTime;
+        // The slots just past the alive range, all at once: no search.
+        // Fewer when the pool is full.
+        m_Emitted = m_Pool.EmitRange(static_cast<unsigned int>(toEmit), static_cast<unsigned int>(m_MaxParticles), m_EmitFirst);
+    }
 
-            m_ActiveCount++;
+    void TestParticleSystem::InitParticle(unsigned int slot, Random& random)
+    {
+        m_Pool.posX[slot] = m_EmitterPos.x;
+        m_Pool.posY[slot] = m_EmitterPos.y;
+        m_Pool.life[slot] = random.Range(m_LifeMin, m_LifeMax);
+        m_Pool.maxLife[slot] = m_Pool.life[slot];
+        m_Pool.size[slot] = random.Range(m_SizeMin, m_SizeMax);
+
+        // Random direction, random speed
+        float angle = random.Range(0.0f, 2.0f * static_cast<float>(M_PI));
+        float speed = random.Range(m_SpeedMin, m_SpeedMax);
+        m_Pool.velX[slot] = cosf(angle) * speed;
+        m_Pool.velY[slot] = sinf(angle) * speed;
+
+        // Random color between start and end
+        float t = random.Next();
+        const glm::vec4 color = glm::mix(m_ColorStart, m_ColorEnd, t);
+        m_Pool.r[slot] = color.r;
+        m_Pool.g[slot] = color.g;
+        m_Pool.b[slot] = color.b;
+        m_Pool.a[slot] = color.a;
+    }
+
+    void TestParticleSystem::Simulate(float dt)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        // Waits (rarely) for the GPU to finish with the region we're about
+        // to overwrite, then hands out space in it for every live particle
+        // (the ones emitted this frame included). The chunks write their
+        // instances straight into it. The QuadBatch path builds its own.
+        m_Stream->BeginFrame();
+        m_DrawCount = 0;
+        const unsigned int alive = m_Pool.GetAliveCount();
+        StreamingBuffer::Allocation region;
+        if (alive > 0 && m_DrawPath == DrawPath::Instances)
+            region = m_Stream->Allocate(alive * INSTANCE_STRIDE, INSTANCE_STRIDE);
+        ParticleInstance* instances = static_cast<ParticleInstance*>(region.ptr);
+
+        for (Participant& participant : m_Participants)
+        {
+            participant.busyMs = participant.emitMs = 0.0f;
+            participant.chunks = 0;
+        }
+
+        // Chunks touch disjoint slots and disjoint instances, so they need
+        // no locking; each thread draws from its own generator
+        ThreadPool::Get().ParallelFor(m_Pool.GetStepCount(), CHUNK_SIZE,
+            [this, dt, alive, instances](unsigned int begin, unsigned int end, unsigned int participant)
+            {
+                PROFILE_SCOPE_CPU("Simulate chunk");
+                SimulateChunk(begin, end, dt, alive, instances, m_Participants[participant]);
+            }, static_cast<unsigned int>(m_ThreadCount));
+
+        // No upload call: the mapping is persistent and coherent. Commit
+        // only copies on drivers without buffer storage.
+        if (instances)
+        {
+            m_Stream->Commit(region);
+            m_BaseInstance = region.offset / INSTANCE_STRIDE;
+            m_DrawCount = alive;
         }
 
-        // Rebuild vertex data and upload to GPU
-        RebuildVertexData();
+        // Serial, but only a scan of life over the live range
+        m_Pool.RemoveDead();
+        m_ActiveCount = m_Pool.GetAliveCount();
+        m_UpdateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
     }
 
-    void TestParticleSystem::EmitParticles(float dt)
+    void TestParticleSystem::SimulateChunk(unsigned int begin, unsigned int end, float dt, unsigned int alive,
+        ParticleInstance* instances, Participant& participant)
     {
-        m_EmissionAccum += m_EmissionRate * dt;
-        int toEmit = static_cast<int>(m_EmissionAccum);
-        m_EmissionAccum -= static_cast<float>(toEmit);
+        typedef std::chrono::steady_clock Clock;
+        const Clock::time_point start = Clock::now();
+
+        // This frame's new particles that fall in the chunk
+        const unsigned int emitBegin = std::max(begin, m_EmitFirst);
+        const unsigned int emitEnd = std::min(end, m_EmitFirst + m_Emitted);
+        for (unsigned int i = emitBegin; i < emitEnd; i++)
+            InitParticle(i, participant.random);
+        const Clock::time_point emitted = Clock::now();
 
-        for (int e = 0; e < toEmit; e++)
+        // Life, gravity and position, a register's worth at a time
+        m_Pool.IntegrateRange(begin, end, dt, m_Gravity);
+
+        if (instances)
         {
-            // Find a dead particle slot
-            int slot = -1;
-            for (unsigned int i = 0; i < static_cast<unsigned int>(m_MaxParticles); i++)
+            const ParticlePool& pool = m_Pool;
+            const unsigned int last = std::min(end, alive);
+            for (unsigned int i = begin; i < last; i++)
             {
-                if (m_Particles[i].life <= 0.0f)
-                {
-                    slot = static_cast<int>(i);
-                    break;
-                }
+                // Fade alpha based on remaining life. A particle that died
+                // this step is drawn with size 0 (nothing) this frame and
+                // removed after.
+                const float lifeRatio = pool.life[i] / pool.maxLife[i];
+                const float alpha = pool.a[i] * lifeRatio;
+
+                ParticleInstance& instance = instances[i];
+                instance.instance[0] = pool.posX[i];
+                instance.instance[1] = pool.posY[i];
+                instance.instance[2] = pool.life[i] > 0.0f ? pool.size[i] : 0.0f;
+                instance.color[0] = ToUnorm8(pool.r[i]);
+                instance.color[1] = ToUnorm8(pool.g[i]);
+                instance.color[2] = ToUnorm8(pool.b[i]);
+                instance.color[3] = ToUnorm8(alpha);
             }
-            if (slot < 0) break; // All slots full
-
-            Particle& p = m_Particles[slot];
-            p.pos = m_EmitterPos;
-            p.life = RandRange(m_LifeMin, m_LifeMax);
-            p.maxLife = p.life;
-            p.size = RandRange(m_SizeMin, m_SizeMax);
-
-            // Random direction, random speed
-            float angle = RandRange(0.0f, 2.0f * static_cast<float>(M_PI));
-            float speed = RandRange(m_SpeedMin, m_SpeedMax);
-            p.vel = glm::vec2(cosf(angle), sinf(angle)) * speed;
-
-            // Random color between start and end
-            float t = RandRange(0.0f, 1.0f);
-            p.color = glm::mix(m_ColorStart, m_ColorEnd, t);
         }
+
+        participant.busyMs += std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+        participant.emitMs += std::chrono::duration<float, std::milli>(emitted - start).count();
+        participant.chunks++;
     }
 
-    void TestParticleSystem::RebuildVertexData()
+    void TestParticleSystem::RunBenchmark()
     {
-        // Write 4 verts per alive particle, 6 floats each (pos.x, pos.y, r, g, b, a)
-        for (unsigned int i = 0; i < MAX_PARTICLES; i++)
+        // Enough steps to time the small sizes, few enough that 1M is quick
+        const int steps = 20;
+        const float dt = 1.0f / 60.0f;
+        typedef std::chrono::steady_clock Clock;
+
+        m_Benchmark.clear();
+        for (unsigned int size = 0; size < BENCHMARK_SIZES; size++)
         {
-            const Particle& p = m_Particles[i];
-            if (p.life <= 0.0f)
+            const unsigned int count = BENCHMARK_COUNTS[size];
+
+            // The same particles in both layouts, alive for the whole run
+            Random& random = m_Participants[0].random;
+            std::vector<Particle> particles(count);
+            ParticlePool pool;
+            pool.Resize(count);
+            for (unsigned int i = 0; i < count; i++)
             {
-                // Write degenerate (zero-area) quad so indices still line up
-                for (int v = 0; v < 4; v++)
-                {
-                    unsigned int base = i * 4 * 6 + v * 6;
-                    m_VertexData[base + 0] = 0.0f;
-                    m_VertexData[base + 1] = 0.0f;
-                    m_VertexData[base + 2] = 0.0f;
-                    m_VertexData[base + 3] = 0.0f;
-                    m_VertexData[base + 4] = 0.0f;
-                    m_VertexData[base + 5] = 0.0f;
-                }
-                continue;
+                Particle& p = particles[i];
+                p.pos = glm::vec2(random.Range(0.0f, 960.0f), random.Range(0.0f, 540.0f));
+                p.vel = glm::vec2(random.Range(-200.0f, 200.0f), random.Range(-200.0f, 200.0f));
+                p.color = m_ColorStart;
+                p.life = p.maxLife = random.Range(1.0f, 3.0f);
+                p.size = 4.0f;
+
+                const unsigned int slot = pool.Emit(count);
+                pool.posX[slot] = p.pos.x; pool.posY[slot] = p.pos.y;
+                pool.velX[slot] = p.vel.x; pool.velY[slot] = p.vel.y;
+                pool.life[slot] = pool.maxLife[slot] = p.life;
             }
+            ParticlePool scalarPool = pool;
 
-            // Fade alpha based on remaining life
-            float lifeRatio = p.life / p.maxLife;
-            float alpha = p.color.a * lifeRatio;
-            float hs = p.size * 0.5f;
+            BenchmarkResult result;
+            result.count = count;
 
-            // 4 corners of quad: BL, BR, TR, TL
-            float verts[4][2] = {
-                { p.pos.x - hs, p.pos.y - hs },
-                { p.pos.x + hs, p.pos.y - hs },
-                { p.pos.x + hs, p.pos.y + hs },
-                { p.pos.x - hs, p.pos.y + hs },
-            };
-
-            for (int v = 0; v < 4; v++)
+            // The loop Update used to run
+            unsigned int alive = 0;
+            Clock::time_point start = Clock::now();
+            for (int step = 0; step < steps; step++)
             {
-                unsigned int base = i * 4 * 6 + v * 6;
-                m_VertexData[base + 0] = verts[v][0];
-                m_VertexData[base + 1] = verts[v][1];
-                m_VertexData[base + 2] = p.color.r;
-                m_VertexData[base + 3] = p.color.g;
-                m_VertexData[base + 4] = p.color.b;
-                m_VertexData[base + 5] = alpha;
+                for (Particle& p : particles)
+                {
+                    if (p.life <= 0.0f) continue;
+                    p.life -= dt;
+                    if (p.life <= 0.0f) continue;
+                    p.vel.y += m_Gravity * dt;
+                    p.pos += p.vel * dt;
+                    alive++;
+                }
             }
+            result.aosMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / steps;
+
+            start = Clock::now();
+            for (int step = 0; step < steps; step++)
+                alive += scalarPool.IntegrateScalar(dt, m_Gravity);
+            result.soaScalarMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / steps;
+
+            start = Clock::now();
+            for (int step = 0; step < steps; step++)
+                alive += pool.Integrate(dt, m_Gravity);
+            result.soaSimdMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / steps;
+
+            // Keep the counts observable so no loop is optimised away
+            if (alive == 0)
+                result.aosMs = -1.0;
+            m_Benchmark.push_back(result);
         }
-
-        // Upload to GPU
-        m_VBO->Update(m_VertexData.data(),
-            static_cast<unsigned int>(m_VertexData.size() * sizeof(float)));
     }
 
     void TestParticleSystem::Render()
     {
-        GlCall(glEnable(GL_BLEND));
-        GlCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+        GLState::Enable(GL_BLEND);
+        GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         Renderer renderer;
 
@@ -209,24 +317,118 @@ namespace test
         m_Shader->Bind();
         m_Shader->setUniformMat4f("u_MVP", mvp);
 
-        renderer.Draw(*m_VAO, *m_IBO, *m_Shader);
+        if (m_DrawPath == DrawPath::QuadBatch)
+        {
+            if (!m_Batch)
+                m_Batch = std::make_unique<QuadBatch>();
+
+            // After RemoveDead: every slot below the count is alive
+            const auto start = std::chrono::steady_clock::now();
+            const ParticlePool& pool = m_Pool;
+            m_Batch->Begin(mvp);
+            for (unsigned int i = 0; i < pool.GetAliveCount(); i++)
+            {
+                const float alpha = pool.a[i] * pool.life[i] / pool.maxLife[i];
+                m_Batch->Submit(QuadBatch::Quad::Rect(glm::vec2(pool.posX[i], pool.posY[i]), glm::vec2(pool.size[i])),
+                    glm::vec4(pool.r[i], pool.g[i], pool.b[i], alpha));
+            }
+            m_Batch->End();
+            m_SubmitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        else if (m_DrawCount > 0)
+        {
+            m_VAO->Bind();
+            m_IBO->Bind();
+            // One instance per live particle; baseInstance moves the
+            // per-instance attributes onto this frame's region
+            renderer.DrawIndexedInstanced(6, m_DrawCount, 0, 0, m_BaseInstance, m_IBO->GetType());
+        }
 
-        GlCall(glDisable(GL_BLEND));
+        // Fence the region so it isn't rewritten while this draw reads it
+        m_Stream->EndFrame();
+
+        GLState::Disable(GL_BLEND);
     }
 
     void TestParticleSystem::RenderGUI()
     {
         ImGui::Text("Active Particles: %u", m_ActiveCount);
+        int drawPath = static_cast<int>(m_DrawPath);
+        if (ImGui::Combo("Draw with", &drawPath, "Instances\0QuadBatch\0"))
+            m_DrawPath = static_cast<DrawPath>(drawPath);
+        if (m_DrawPath == DrawPath::QuadBatch && m_Batch)
+        {
+            const QuadBatch::Stats& batchStats = m_Batch->GetStats();
+            ImGui::Text("Quads drawn: %u in %u draws (%u bytes written)", batchStats.quads, batchStats.draws,
+                batchStats.quads * 4 * static_cast<unsigned int>(sizeof(QuadBatch::Vertex)));
+            ImGui::Text("Submit: %.3f ms, main thread (fence wait %.3f ms)", m_SubmitMs, batchStats.fenceWaitMs);
+        }
+        else
+            ImGui::Text("Instances drawn: %u (%u bytes uploaded)", m_DrawCount, m_DrawCount * INSTANCE_STRIDE);
 
         float rate = ImGui::GetIO().Framerate;
         ImGui::Text("%.1f FPS (%.3f ms/frame)", rate, 1000.0f / rate);
 
+        const StreamingBuffer::Stats& streamStats = m_Stream->GetStats();
+        ImGui::Text("Upload: %.1f MB/s (%s)", streamStats.uploadMBPerSecond,
+            m_Stream->IsPersistent() ? "persistent map" : "glBufferSubData fallback");
+        ImGui::Text("Fence wait: %.3f ms (%u stalls)", streamStats.fenceWaitMs, streamStats.fenceStalls);
+        ImGui::Text("Simulation: %.3f ms (SoA, %s)", m_UpdateMs, ParticlePool::GetInstructionSet());
+        ImGui::Text("Emission: %.3f ms for %u particles (%.0f ns each, all threads)", m_EmitMs, m_Emitted,
+            m_Emitted ? 1000000.0f * m_EmitMs / m_Emitted : 0.0f);
+
+        if (ImGui::CollapsingHeader("Threads", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::SliderInt("Worker threads", &m_ThreadCount, 1, static_cast<int>(m_Participants.size()));
+            ImGui::Text("%u-particle chunks, %u to share", CHUNK_SIZE,
+                (m_Pool.GetStepCount() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+            // Busy time summed over the threads that took a chunk, against
+            // the wall time of the whole update times that many threads:
+            // 100% is perfect scaling, the rest is waiting and the serial
+            // parts (mapping, RemoveDead)
+            float busyMs = 0.0f;
+            unsigned int used = 0;
+            for (unsigned int i = 0; i < m_Participants.size(); i++)
+            {
+                const Participant& participant = m_Participants[i];
+                if (participant.chunks == 0)
+                    continue;
+                busyMs += participant.busyMs;
+                used++;
+                ImGui::Text("%s %2u: %.3f ms, %u chunks", i == 0 ? "main  " : "worker", i, participant.busyMs,
+                    participant.chunks);
+            }
+            if (used > 0 && m_UpdateMs > 0.0f)
+            {
+                ImGui::Text("Speedup %.2fx on %u threads, %.0f%% efficient", busyMs / m_UpdateMs, used,
+                    100.0f * busyMs / (m_UpdateMs * used));
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Layout benchmark"))
+        {
+            ImGui::TextWrapped("One physics step of every particle, averaged over 20. Runs on the main "
+                "thread, so the window stalls for a moment.");
+            if (ImGui::Button("Run"))
+                RunBenchmark();
+            if (!m_Benchmark.empty())
+            {
+                ImGui::Text("%10s %12s %12s %12s", "Particles", "AoS scalar", "SoA scalar", "SoA SIMD");
+                for (const BenchmarkResult& result : m_Benchmark)
+                {
+                    ImGui::Text("%10u %9.3f ms %9.3f ms %9.3f ms  (%.1fx)", result.count, result.aosMs, result.soaScalarMs,
+                        result.soaSimdMs, result.soaSimdMs > 0.0 ? result.aosMs / result.soaSimdMs : 0.0);
+                }
+            }
+        }
+
         ImGui::Separator();
         ImGui::Text("Emitter Settings");
 
         ImGui::SliderFloat2("Emitter Pos", &m_EmitterPos.x, 0.0f, 960.0f);
         ImGui::SliderInt("Max Particles", &m_MaxParticles, 100, static_cast<int>(MAX_PARTICLES));
-        ImGui::SliderFloat("Emission Rate", &m_EmissionRate, 10.0f, 5000.0f);
+        ImGui::SliderFloat("Emission Rate", &m_EmissionRate, 10.0f, 200000.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
         ImGui::SliderFloat("Gravity", &m_Gravity, -500.0f, 500.0f);
 
         ImGui::Separator();
@@ -1,11 +1,14 @@
 #pragma once
 #include "Tests.h"
 #include "../Renderer.h"
-#include "../VertexBuffer.h"
+#include "../StreamingBuffer.h"
 #include "../VertexBufferLayout.h"
 #include "../IndexBuffer.h"
 #include "../VertexArray.h"
 #include "../Shader.h"
+#include "../ParticlePool.h"
+#include "../QuadBatch.h"
+#include "../ThreadPool.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -14,6 +17,7 @@
 #include "../vendor/imgui/imgui_impl_glfw.h"
 #include "../vendor/imgui/imgui_impl_opengl3.h"
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -21,6 +25,8 @@ struct GLFWwindow;
 
 namespace test
 {
+    // The array-of-structs layout this test used to simulate; kept as the
+    // benchmark's baseline (see ParticlePool for the one it uses now)
     struct Particle
     {
         glm::vec2 pos;
@@ -31,6 +37,16 @@ namespace test
         float size;
     };
 
+    // Instance data: one record per live particle, expanded to a quad's
+    // corners by the vertex shader, written straight into this frame's
+    // region of the streaming buffer. 16 bytes where the 4 CPU-built
+    // corners took 96. Its attribute layout is VertexLayoutOf<ParticleInstance>.
+    struct ParticleInstance
+    {
+        float instance[3];   // position.xy, size
+        unsigned char color[4];
+    };
+
     class TestParticleSystem : public Tests
     {
     public:
@@ -41,21 +57,82 @@ namespace test
         void RenderGUI() override;
 
     private:
+        // xorshift32: one per thread, so emission needs no shared rand() state
+        struct Random
+        {
+            uint32_t state;
+
+            float Next()    // [0, 1)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+            }
+            float Range(float lo, float hi) { return lo + Next() * (hi - lo); }
+        };
+
+        // What each ParallelFor participant did this frame
+        struct Participant
+        {
+            Random random;
+            float busyMs;         // in SimulateChunk
+            float emitMs;         // of which filling new particles
+            unsigned int chunks;
+        };
+
+        // Reserves this frame's new particles; SimulateChunk fills them in
         void EmitParticles(float dt);
-        void RebuildVertexData();
+        // Emission, physics and the instance build for every chunk, in parallel
+        void Simulate(float dt);
+        void SimulateChunk(unsigned int begin, unsigned int end, float dt, unsigned int alive, ParticleInstance* instances,
+            Participant& participant);
+        void InitParticle(unsigned int slot, Random& random);
+        // Times one physics step of each layout at each BENCHMARK_COUNTS size
+        void RunBenchmark();
 
-        static const unsigned int MAX_PARTICLES = 10000;
+        static const unsigned int MAX_PARTICLES = 100000;
+        // Particles per ParallelFor chunk; a multiple of ParticlePool::PADDING
+        static const unsigned int CHUNK_SIZE = 4096;
 
         // Particles
-        std::vector<Particle> m_Particles;
+        ParticlePool m_Pool;
         unsigned int m_ActiveCount;
+        float m_UpdateMs;        // Simulate, wall clock, last frame
+        float m_EmitMs;          // reserving and filling new particles, all threads
+        unsigned int m_Emitted;  // this frame, slots [m_EmitFirst, m_EmitFirst + m_Emitted)
+        unsigned int m_EmitFirst;
+
+        std::vector<Participant> m_Participants;   // ThreadPool threads + this one
+        int m_ThreadCount;       // participants to use, 1 = main thread only
+
+        struct BenchmarkResult
+        {
+            unsigned int count;
+            double aosMs;        // Particle structs, glm::vec2 math
+            double soaScalarMs;  // ParticlePool::IntegrateScalar
+            double soaSimdMs;    // ParticlePool::Integrate
+        };
+        static const unsigned int BENCHMARK_SIZES = 3;
+        static const unsigned int BENCHMARK_COUNTS[BENCHMARK_SIZES];
+        std::vector<BenchmarkResult> m_Benchmark;
+
+        static const unsigned int INSTANCE_STRIDE = sizeof(ParticleInstance);
+        std::unique_ptr<StreamingBuffer> m_Stream;
+        unsigned int m_BaseInstance;   // first instance of this frame's region
+        unsigned int m_DrawCount;      // instances written this frame
 
-        // Vertex data: 4 verts per particle, each vert = 2 pos + 4 color = 6 floats
-        std::vector<float> m_VertexData;
+        // Or every live particle submitted to a QuadBatch in Render, for
+        // comparison: 112 bytes of corners where the instance is 16, written
+        // by the main thread after the simulation instead of by its chunks.
+        // Made the first time it is picked.
+        enum class DrawPath { Instances, QuadBatch };
+        DrawPath m_DrawPath;
+        std::unique_ptr<QuadBatch> m_Batch;
+        float m_SubmitMs;              // QuadBatch, Begin to End
 
         // OpenGL objects
         std::unique_ptr<VertexArray> m_VAO;
-        std::unique_ptr<VertexBuffer> m_VBO;
         std::unique_ptr<IndexBuffer> m_IBO;
         std::unique_ptr<Shader> m_Shader;
 
@@ -1,16 +1,21 @@
 #include "TestShadowMapping.h"
+#include "../GLState.h"
+#include "../FrameUniforms.h"
+#include "../ShaderLibrary.h"
 #include "../Renderer.h"
 #include "../vendor/imgui/imgui.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
 
 test::TestShadowMapping::TestShadowMapping(GLFWwindow* window)
 	: m_Window(window),
+	  m_EnableCulling(true),
 	  m_LightDirection(glm::normalize(glm::vec3(0.5f, -1.0f, 0.3f))),
 	  m_LightColour(1.0f, 1.0f, 1.0f),
 	  m_ShadowBias(0.005f),
-	  m_ShadowResolution(2048),
-	  m_EnablePCF(true),
+	  m_ShadowFilter(FILTER_HARDWARE),
 	  m_PCFKernelSize(3),
 	  m_ShowDebugShadowMap(false),
 	  m_AmbientIntensity(0.15f),
@@ -18,9 +23,7 @@ test::TestShadowMapping::TestShadowMapping(GLFWwindow* window)
 	  m_SpecularIntensity(0.3f),
 	  m_Shininess(32.0f),
 	  m_ObjectColor(0.7f, 0.7f, 0.7f),
-	  m_OrthoSize(20.0f),
-	  m_NearPlane(0.1f),
-	  m_FarPlane(50.0f)
+	  m_CubeFieldSize(0)
 {
 	m_Camera = std::make_unique<Camera>(
 		window,
@@ -32,150 +35,762 @@ test::TestShadowMapping::TestShadowMapping(GLFWwindow* window)
 	);
 
 	m_DepthShader = std::make_unique<Shader>("res/Shaders/Shadows/ShadowDepth.shader");
-	m_PhongShader = std::make_unique<Shader>("res/Shaders/Shadows/ShadowPhong.shader");
+	m_PhongShader = ShaderLibrary::Get("res/Shaders/Shadows/ShadowPhong.shader");
+	// One program per FILTER x PCF_KERNEL x CASCADES value the GUI can
+	// pick, compiled up front; ESM and VSM map every kernel to 1, so their
+	// other 8 combinations are never built
+	static const int kernels[] = { 1, 3, 5 };
+	for (int filter = 0; filter < FILTER_COUNT; filter++)
+		for (int kernel : kernels)
+			for (int show = 0; show < 2; show++)
+				PhongVariant(filter, kernel, show != 0);
+	m_MomentsShader = std::make_unique<ComputeShader>("res/Shaders/Shadows/ShadowMoments.glsl");
+
+	// HARDWARE: the compare lives in a sampler object rather than in the
+	// texture's state, so the preview and the moment blur still read the
+	// same depth texture raw. Beyond the map is lit, as in the shader.
+	const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	GlCall(glGenSamplers(1, &m_CompareSampler));
+	GlCall(glSamplerParameteri(m_CompareSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GlCall(glSamplerParameteri(m_CompareSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GlCall(glSamplerParameteri(m_CompareSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER));
+	GlCall(glSamplerParameteri(m_CompareSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER));
+	GlCall(glSamplerParameterfv(m_CompareSampler, GL_TEXTURE_BORDER_COLOR, white));
+	GlCall(glSamplerParameteri(m_CompareSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE));
+	GlCall(glSamplerParameteri(m_CompareSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL));
+
+	GlCall(glGenQueries(2 * TIMER_COUNT, &m_TimerQueries[0][0]));
+	// Shaded fragments of the lit pass, for the overdraw readout
+	m_RenderQueue.SetCountFragments(true);
+
+	// Shadow map preview: a corner quad showing the depth it holds
+	m_PreviewShader = std::make_unique<Shader>("res/Shaders/Shadows/ShadowDebug.shader");
+	m_PreviewQuad = GeometryFactory::CreateFullscreenQuad();
+
+	// One mesh per shape. Every cube entity (including the ground slab) is
+	// an instance of m_CubeMesh and every sphere an instance of m_SphereMesh,
+	// so each pass costs two draw calls however many objects there are.
+	// Both come from the shared registry: any other test holding a cube or
+	// the same sphere draws the same arena range. The sphere is geodesic,
+	// as round as a 20x20 UV sphere.
+	m_CubeMesh = GeometryFactory::GetSharedCube();
+	m_SphereMesh = GeometryFactory::GetSharedGeodesicSphere(
+		GeometryFactory::SelectGeodesicSphere(GeometryFactory::GetUVSphereError(20, 20)));
+
+	m_Occlusion = std::make_unique<OcclusionQueries>();
+
+	m_CubeInstances = std::make_unique<InstanceBuffer>(64);
+	m_SphereInstances = std::make_unique<InstanceBuffer>(4);
+	// Both meshes draw through the arena's instanced VAO; each command's
+	// InstanceBuffer is bound to it as the queue reaches it.
+
+	BuildScene();
+
+
+	GLState::Enable(GL_DEPTH_TEST);
+}
+
+void test::TestShadowMapping::Preload()
+{
+	Shader::Prebuild("res/Shaders/Shadows/ShadowDepth.shader");
+	Shader::Prebuild("res/Shaders/Shadows/ShadowPhong.shader");
+	Shader::Prebuild("res/Shaders/Shadows/ShadowDebug.shader");
+	Shader::Prebuild("res/Shaders/DepthPrepass.shader");
+	Shader::Prebuild("res/Shaders/Culling/OcclusionBox.shader");
+	ComputeShader::Prebuild("res/Shaders/Shadows/ShadowMoments.glsl");
+}
+
+void test::TestShadowMapping::OnSuspend()
+{
+	// As the destructor does
+	GLState::Disable(GL_CULL_FACE);
+}
+
+void test::TestShadowMapping::OnResume()
+{
+	GLState::Enable(GL_DEPTH_TEST);
+}
+
+test::TestShadowMapping::~TestShadowMapping()
+{
+	GLState::Disable(GL_CULL_FACE);
+	GlCall(glDeleteQueries(2 * TIMER_COUNT, &m_TimerQueries[0][0]));
+	GlCall(glDeleteSamplers(1, &m_CompareSampler));
+	if (m_StaticCache.IsValid())
+		GpuResources::Get().Release(m_StaticCache);
+}
+
+void test::TestShadowMapping::Update(float deltaTime)
+{
+	m_Camera->processInput(deltaTime);
+	m_Camera->Update(deltaTime);
+
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(m_Window, &width, &height);
+	const float aspect = height > 0 ? static_cast<float>(width) / height : 1.0f;
+
+	const float nearPlane = 0.1f;
+	m_View = m_Camera->getViewMatrix();
+	m_Projection = glm::perspective(glm::radians(m_Camera->getFOV()), aspect, nearPlane, 1000.0f);
+
+	// Fit each cascade's ortho box to its slice of the view
+	m_Cascades.Update(m_CascadeSettings, m_View, glm::radians(m_Camera->getFOV()), aspect, nearPlane, m_LightDirection);
+
+	m_AnimationTime += deltaTime;
+	if (m_AnimateSpheres)
+		AnimateSpheres();
+}
 
-	// Shadow framebuffer
-	m_ShadowFBO = std::make_unique<Framebuffer>(m_ShadowResolution, m_ShadowResolution, true);
+void test::TestShadowMapping::AnimateSpheres()
+{
+	for (std::size_t i = 0; i < m_Spheres.size(); i++)
+	{
+		const float height = 1.5f * (0.5f + 0.5f * std::sin(m_AnimationTime * 2.0f + 1.7f * i));
+		m_Scene.SetTransform(m_Spheres[i], glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, height, 0.0f)) * m_SphereRest[i]);
+	}
+}
+
+// Back where they were built, and dynamic (out of the static shadow cache)
+// only while animated
+void test::TestShadowMapping::RestSpheres()
+{
+	for (std::size_t i = 0; i < m_Spheres.size(); i++)
+	{
+		m_Scene.SetTransform(m_Spheres[i], m_SphereRest[i]);
+		m_Scene.SetFlags(m_Spheres[i], m_AnimateSpheres ? Scene::FLAG_DYNAMIC : 0);
+	}
+}
+
+// Same translate -> rotate(X, Y, Z) -> scale order as Mesh::getTransformMatrix
+static glm::mat4 MakeTransform(const glm::vec3& position, const glm::vec3& rotationDegrees, const glm::vec3& scale)
+{
+	glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+	transform = glm::rotate(transform, glm::radians(rotationDegrees.x), glm::vec3(1, 0, 0));
+	transform = glm::rotate(transform, glm::radians(rotationDegrees.y), glm::vec3(0, 1, 0));
+	transform = glm::rotate(transform, glm::radians(rotationDegrees.z), glm::vec3(0, 0, 1));
+	return glm::scale(transform, scale);
+}
+
+// Cheap integer hash for repeatable per-entity randomness
+static float Hash01(unsigned int x)
+{
+	x ^= x >> 16; x *= 0x45d9f3bu;
+	x ^= x >> 16; x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	return (x & 0xFFFFFF) / float(0xFFFFFF);
+}
+
+void test::TestShadowMapping::BuildScene()
+{
+	m_Scene.Clear();
+	m_Spheres.clear();
+	m_SphereRest.clear();
+	// Entity ids start over
+	m_Occlusion->Clear();
+
+	const unsigned int cube = m_Scene.AddMesh(*m_CubeMesh);      // MESH_CUBE
+	const unsigned int sphere = m_Scene.AddMesh(*m_SphereMesh);  // MESH_SPHERE
+	const unsigned int fieldCubes = static_cast<unsigned int>(m_CubeFieldSize * m_CubeFieldSize);
+	const unsigned int occlusionField = m_OcclusionField ? 3 + OCCLUSION_FIELD_SIZE * OCCLUSION_FIELD_SIZE : 0;
+	m_Scene.Reserve(6 + fieldCubes + occlusionField + (m_StressMode ? STRESS_ENTITIES : 0));
 
 	// Ground plane: flat slab
-	m_GroundPlane = GeometryFactory::CreateCube();
-	m_GroundPlane->setPosition(glm::vec3(0.0f, -0.05f, 0.0f));
-	m_GroundPlane->setScale(glm::vec3(200.0f, 0.1f, 200.0f));
+	const Scene::Material plain;
+	m_Scene.Create(cube, MakeTransform(glm::vec3(0.0f, -0.05f, 0.0f), glm::vec3(0.0f), glm::vec3(200.0f, 0.1f, 200.0f)),
+		plain, Scene::FLAG_OCCLUDER);
 
 	// Cubes at varying positions
-	m_Cubes[0] = GeometryFactory::CreateCube();
-	m_Cubes[0]->setPosition(glm::vec3(-3.0f, 1.0f, 0.0f));
-	m_Cubes[0]->setScale(glm::vec3(1.5f, 2.0f, 1.5f));
+	m_Scene.Create(cube, MakeTransform(glm::vec3(-3.0f, 1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.5f, 2.0f, 1.5f)),
+		plain, Scene::FLAG_OCCLUDER);
+	m_Scene.Create(cube, MakeTransform(glm::vec3(2.0f, 0.75f, -2.0f), glm::vec3(0.0f), glm::vec3(1.0f, 1.5f, 1.0f)),
+		plain, Scene::FLAG_OCCLUDER);
+	m_Scene.Create(cube, MakeTransform(glm::vec3(0.0f, 2.5f, 3.0f), glm::vec3(0.0f, 45.0f, 0.0f), glm::vec3(1.0f)),
+		plain, Scene::FLAG_OCCLUDER);
+
+	// Occlusion field: a wall across the view from the start position, and
+	// a grid of small objects behind it that the camera sees only from
+	// above or round the ends
+	if (m_OcclusionField)
+	{
+		for (int i = -1; i <= 1; i++)
+		{
+			m_Scene.Create(cube, MakeTransform(glm::vec3(12.0f * i, 3.0f, -8.0f), glm::vec3(0.0f), glm::vec3(12.0f, 6.0f, 1.0f)),
+				plain, Scene::FLAG_OCCLUDER);
+		}
+
+		Scene::Material hidden;
+		for (int z = 0; z < OCCLUSION_FIELD_SIZE; z++)
+		{
+			for (int x = 0; x < OCCLUSION_FIELD_SIZE; x++)
+			{
+				const glm::vec3 position(-30.0f + 1.5f * x, 0.5f, -12.0f - 1.5f * z);
+				hidden.colour = glm::vec4(0.9f, 0.5f + 0.5f * x / OCCLUSION_FIELD_SIZE, 0.5f + 0.5f * z / OCCLUSION_FIELD_SIZE, 1.0f);
+				m_Scene.Create((x + z) % 3 == 0 ? sphere : cube,
+					MakeTransform(position, glm::vec3(0.0f, 20.0f * (x + z), 0.0f), glm::vec3(0.5f)), hidden);
+			}
+		}
+	}
 
-	m_Cubes[1] = GeometryFactory::CreateCube();
-	m_Cubes[1]->setPosition(glm::vec3(2.0f, 0.75f, -2.0f));
-	m_Cubes[1]->setScale(glm::vec3(1.0f, 1.5f, 1.0f));
+	// Optional field of small cubes around the centre piece to stress the
+	// instanced path: m_CubeFieldSize^2 extra cubes, still one draw call.
+	Scene::Material material;
+	const float spacing = 1.5f;
+	const float start = -0.5f * spacing * (m_CubeFieldSize - 1);
+	for (int z = 0; z < m_CubeFieldSize; z++)
+	{
+		for (int x = 0; x < m_CubeFieldSize; x++)
+		{
+			glm::vec3 position(start + x * spacing, 0.25f, start + z * spacing - 15.0f);
+			material.colour = glm::vec4(0.6f + 0.4f * x / m_CubeFieldSize, 0.8f, 0.6f + 0.4f * z / m_CubeFieldSize, 1.0f);
+			m_Scene.Create(cube, MakeTransform(position, glm::vec3(0.0f, 15.0f * (x + z), 0.0f), glm::vec3(0.5f)), material);
+		}
+	}
 
-	m_Cubes[2] = GeometryFactory::CreateCube();
-	m_Cubes[2]->setPosition(glm::vec3(0.0f, 2.5f, 3.0f));
-	m_Cubes[2]->setScale(glm::vec3(1.0f, 1.0f, 1.0f));
-	m_Cubes[2]->setRotation(glm::vec3(0.0f, 45.0f, 0.0f));
+	// Stress mode: cubes and spheres scattered over the whole slab, so
+	// culling, gathering and the instanced draws run over 100k entities
+	for (unsigned int i = 0; i < (m_StressMode ? STRESS_ENTITIES : 0); i++)
+	{
+		const glm::vec3 position(190.0f * (Hash01(i * 5 + 0) - 0.5f), 0.0f, 190.0f * (Hash01(i * 5 + 1) - 0.5f));
+		const float scale = 0.2f + 0.5f * Hash01(i * 5 + 2);
+		material.colour = glm::vec4(0.5f + 0.5f * Hash01(i * 5 + 3), 0.7f, 0.5f + 0.5f * Hash01(i * 5 + 4), 1.0f);
+		const glm::mat4 transform = MakeTransform(position + glm::vec3(0.0f, scale, 0.0f),
+			glm::vec3(0.0f, 360.0f * Hash01(i * 7 + 6), 0.0f), glm::vec3(scale));
+		m_Scene.Create(i % 4 == 0 ? sphere : cube, transform, material);
+	}
 
 	// Spheres
-	m_Spheres[0] = GeometryFactory::CreateSphere(20, 20);
-	m_Spheres[0]->setPosition(glm::vec3(4.0f, 1.0f, 2.0f));
-	m_Spheres[0]->setScale(glm::vec3(1.0f, 1.0f, 1.0f));
+	m_SphereRest.push_back(MakeTransform(glm::vec3(4.0f, 1.0f, 2.0f), glm::vec3(0.0f), glm::vec3(1.0f)));
+	m_SphereRest.push_back(MakeTransform(glm::vec3(-1.5f, 0.75f, -4.0f), glm::vec3(0.0f), glm::vec3(0.75f)));
+	for (const glm::mat4& rest : m_SphereRest)
+		m_Spheres.push_back(m_Scene.Create(sphere, rest));
+	RestSpheres();
+
+	// The cubes are static casters: their cached depth is out of date
+	m_StaticCastersDirty = true;
+}
 
-	m_Spheres[1] = GeometryFactory::CreateSphere(20, 20);
-	m_Spheres[1]->setPosition(glm::vec3(-1.5f, 0.75f, -4.0f));
-	m_Spheres[1]->setScale(glm::vec3(0.75f, 0.75f, 0.75f));
+void test::TestShadowMapping::GatherList(const std::vector<unsigned int>& visible, uint8_t flagMask, uint8_t flagValue, int list)
+{
+	std::size_t before[MESH_COUNT];
+	for (int m = 0; m < MESH_COUNT; m++)
+		before[m] = m_Uploads[m].size();
+	m_Scene.GatherInstances(visible, m_Uploads, flagMask, flagValue);
+	for (int m = 0; m < MESH_COUNT; m++)
+		m_ListCounts[m][list] = static_cast<unsigned int>(m_Uploads[m].size() - before[m]);
+}
+
+// World bounds only change with an entity's transform, so the scene
+// recomputes those and only the frustum tests run over everything.
+void test::TestShadowMapping::CullScene()
+{
+	const int cascades = m_Cascades.GetCount();
+	if (m_EnableCulling)
+	{
+		// Casters between the light and a cascade's box still cast into it:
+		// DrawShadowDepth's GL_DEPTH_CLAMP flattens them onto the near
+		// plane. So the cascade's near plane culls nothing.
+		for (int c = 0; c < cascades; c++)
+			m_Scene.Cull(Frustum::FromMatrix(m_Cascades.GetViewProjection(c)).WithoutNearPlane(), m_ShadowVisibleList[c]);
+		m_Scene.Cull(Frustum::FromMatrix(m_Projection * m_View), m_CameraVisibleList);
+	}
+	else
+	{
+		m_CameraVisibleList.resize(m_Scene.GetCount());
+		for (unsigned int i = 0; i < m_CameraVisibleList.size(); i++)
+			m_CameraVisibleList[i] = i;
+		for (int c = 0; c < cascades; c++)
+			m_ShadowVisibleList[c] = m_CameraVisibleList;
+	}
+
+	for (int m = 0; m < MESH_COUNT; m++)
+	{
+		m_Uploads[m].clear();
+		for (unsigned int& count : m_ListCounts[m])
+			count = 0;
+	}
+
+	// Cached (static) casters only go to the layers being redrawn this
+	// frame; without the cache every caster counts as dynamic
+	for (int c = 0; c < cascades; c++)
+	{
+		if (m_CacheStaticShadows && m_CascadeDirty[c])
+			GatherList(m_ShadowVisibleList[c], Scene::FLAG_DYNAMIC, 0, LIST_STATIC_SHADOW + c);
+	}
+	const uint8_t dynamicMask = m_CacheStaticShadows ? Scene::FLAG_DYNAMIC : 0;
+	for (int c = 0; c < cascades; c++)
+		GatherList(m_ShadowVisibleList[c], dynamicMask, dynamicMask, LIST_DYNAMIC_SHADOW + c);
+
+	// With occlusion queries the occluders go first, instanced; everything
+	// else the camera sees waits for DrawOccludees
+	m_OccludeeList.clear();
+	m_OccludeeKeys.clear();
+	m_OccludeeBounds.clear();
+	if (m_OcclusionCulling)
+	{
+		const std::vector<uint8_t>& flags = m_Scene.GetFlagArray();
+		for (unsigned int index : m_CameraVisibleList)
+		{
+			if (flags[index] & Scene::FLAG_OCCLUDER)
+				continue;
+			m_OccludeeList.push_back(index);
+			m_OccludeeKeys.push_back(m_Scene.GetEntity(index));
+			m_OccludeeBounds.push_back(m_Scene.GetBounds(index));
+		}
+		GatherList(m_CameraVisibleList, Scene::FLAG_OCCLUDER, Scene::FLAG_OCCLUDER, LIST_CAMERA);
+		GatherList(m_OccludeeList, 0, 0, LIST_OCCLUSION);
+	}
+	else
+		GatherList(m_CameraVisibleList, 0, 0, LIST_CAMERA);
 
+	m_CubeInstances->SetData(m_Uploads[MESH_CUBE]);
+	m_SphereInstances->SetData(m_Uploads[MESH_SPHERE]);
 
-	glEnable(GL_DEPTH_TEST);
+	m_InstancesTotal = m_Scene.GetCount();
+	m_CameraVisible = static_cast<unsigned int>(m_CameraVisibleList.size());
+	m_ShadowVisible = 0;
+	for (int m = 0; m < MESH_COUNT; m++)
+	{
+		for (int list = 0; list < LIST_CAMERA; list++)
+			m_ShadowVisible += m_ListCounts[m][list];
+	}
 }
 
-test::TestShadowMapping::~TestShadowMapping()
+// One draw for all of a shadow group's cascades. The depth shader works
+// out each instance's cascade from where the lists start within the
+// group (u_CascadeStarts; unused cascades never start). instanceCount 0
+// would mean "all", so an empty group isn't submitted.
+void test::TestShadowMapping::SubmitShadowGroup(RenderCommand cmd, SceneMesh mesh, int firstList, unsigned int& firstInstance, RenderQueue& queue)
 {
-	glDisable(GL_CULL_FACE);
+	unsigned int count = 0;
+	glm::vec4 starts(1e9f);
+	for (int c = 0; c < m_Cascades.GetCount(); c++)
+	{
+		if (c > 0)
+			starts[c - 1] = static_cast<float>(count);
+		count += m_ListCounts[mesh][firstList + c];
+	}
+	if (count == 0)
+		return;
+
+	cmd.shader = m_DepthShader.get();
+	cmd.firstInstance = firstInstance;
+	cmd.instanceCount = count;
+	cmd.colour = starts;
+	cmd.colourUniform = "u_CascadeStarts";
+	queue.Submit(RenderPass::Shadow, cmd);
+	firstInstance += count;
 }
 
-void test::TestShadowMapping::Update(float deltaTime)
+void test::TestShadowMapping::SubmitMesh(SceneMesh mesh, const InstanceBuffer& instances)
 {
-	m_Camera->processInput(deltaTime);
-	m_Camera->Update(deltaTime);
+	const Mesh& geometry = m_Scene.GetMesh(mesh);
+	RenderCommand cmd;
+	cmd.vao = geometry.getInstancedVertexArray();
+	cmd.ibo = geometry.getIndexBuffer();
+	cmd.indexCount = geometry.getArenaRange().indexCount;
+	cmd.firstIndex = geometry.getArenaRange().firstIndex;
+	cmd.baseVertex = geometry.getArenaRange().baseVertex;
+	cmd.instances = &instances;
+
+	// In buffer order: static casters, dynamic casters, the camera's list
+	unsigned int first = 0;
+	SubmitShadowGroup(cmd, mesh, LIST_STATIC_SHADOW, first, m_StaticShadowQueue);
+	SubmitShadowGroup(cmd, mesh, LIST_DYNAMIC_SHADOW, first, m_RenderQueue);
+
+	const unsigned int cameraCount = m_ListCounts[mesh][LIST_CAMERA];
+	if (cameraCount > 0)
+	{
+		cmd.shader = m_PhongVariant;
+		cmd.firstInstance = first;
+		cmd.instanceCount = cameraCount;
+		m_RenderQueue.Submit(RenderPass::Opaque, cmd);
+	}
+	m_OccludeeFirst[mesh] = first + cameraCount;
+}
 
-	m_View = m_Camera->getViewMatrix();
-	m_Projection = glm::perspective(glm::radians(m_Camera->getFOV()), 1920.0f / 1080.0f, 0.1f, 1000.0f);
+void test::TestShadowMapping::SubmitScene()
+{
+	m_RenderQueue.Clear();
+	m_StaticShadowQueue.Clear();
 
-	// Compute light space matrix (directional light -> orthographic)
-	glm::vec3 lightPos = -m_LightDirection * 20.0f;
-	glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	glm::mat4 lightProj = glm::ortho(-m_OrthoSize, m_OrthoSize, -m_OrthoSize, m_OrthoSize, m_NearPlane, m_FarPlane);
-	m_LightSpaceMatrix = lightProj * lightView;
+	CullScene();
+	SubmitMesh(MESH_CUBE, *m_CubeInstances);
+	SubmitMesh(MESH_SPHERE, *m_SphereInstances);
 }
 
-void test::TestShadowMapping::RenderScene(Shader& shader)
+void test::TestShadowMapping::Render()
 {
-	// Ground
-	shader.setUniformMat4f("u_Model", m_GroundPlane->getTransformMatrix());
-	m_GroundPlane->Draw();
+	ReadTimers();
+	m_Occlusion->BeginFrame();
+	m_PhongVariant = &PhongVariant(m_ShadowFilter, m_PCFKernelSize, m_ShowCascades);
+
+	// Which cached layers are stale decides what the shadow pass submits
+	UpdateShadowCache();
+
+	// Both passes draw the same objects, so submit once and let the queue
+	// replay each pass in key order.
+	SubmitScene();
+
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(m_Window, &width, &height);
+
+	// A new resolution or cascade count is just a new desc: the graph
+	// swaps the texture
+	RenderGraph::TextureDesc shadowDesc;
+	shadowDesc.width = shadowDesc.height = m_CascadeSettings.resolution;
+	shadowDesc.format = GL_DEPTH_COMPONENT24;
+	shadowDesc.target = GL_TEXTURE_2D_ARRAY;
+	shadowDesc.layers = m_Cascades.GetCount();
+
+	m_Graph.Reset();
+	const RenderGraph::Resource shadowMap = m_Graph.CreateTexture("Shadow map", shadowDesc);
+	const RenderGraph::Resource screen = m_Graph.ImportBackbuffer(width, height);
 
-	// Cubes
-	for (int i = 0; i < 3; i++)
+	if (m_CacheStaticShadows)
 	{
-		shader.setUniformMat4f("u_Model", m_Cubes[i]->getTransformMatrix());
-		m_Cubes[i]->Draw();
+		const RenderGraph::Resource cache = m_Graph.ImportTexture("Static shadow cache",
+			GpuResources::Get().GetTexture(m_StaticCache), m_StaticCacheDesc);
+		if (m_DirtyCascades > 0)
+		{
+			// Cleared here, layer by layer, rather than by the graph
+			const RenderGraph::Pass recache = m_Graph.AddPass("Static shadow cache", [this, cache](const RenderGraph::PassContext& context)
+				{
+					const float one = 1.0f;
+					const unsigned int texture = context.GetTexture(cache);
+					const bool clearLayers = GLEW_VERSION_4_4 || GLEW_ARB_clear_texture;
+					if (!clearLayers)
+					{
+						GLState::DepthMask(true);
+						GlCall(glClearBufferfv(GL_DEPTH, 0, &one));
+					}
+					for (int c = 0; c < m_Cascades.GetCount() && clearLayers; c++)
+					{
+						if (m_CascadeDirty[c])
+						{
+							GlCall(glClearTexSubImage(texture, 0, 0, 0, c, m_StaticCacheDesc.width, m_StaticCacheDesc.height, 1,
+								GL_DEPTH_COMPONENT, GL_FLOAT, &one));
+						}
+					}
+					DrawShadowDepth(m_StaticShadowQueue);
+				});
+			m_Graph.Write(recache, cache, RenderGraph::LoadOp::Load);
+		}
+
+		// The copy overwrites every texel, so the shadow map is not cleared
+		const RenderGraph::Pass shadow = m_Graph.AddPass("Shadow depth", [this, cache, shadowMap](const RenderGraph::PassContext& context)
+			{
+				GlCall(glCopyImageSubData(context.GetTexture(cache), GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+					context.GetTexture(shadowMap), GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+					m_StaticCacheDesc.width, m_StaticCacheDesc.height, m_StaticCacheDesc.layers));
+				DrawShadowDepth(m_RenderQueue);
+			});
+		m_Graph.Read(shadow, cache);
+		m_Graph.Write(shadow, shadowMap, RenderGraph::LoadOp::Load);
+	}
+	else
+	{
+		const RenderGraph::Pass shadow = m_Graph.AddPass("Shadow depth", [this](const RenderGraph::PassContext&)
+			{
+				DrawShadowDepth(m_RenderQueue);
+			});
+		m_Graph.Write(shadow, shadowMap, RenderGraph::LoadOp::Clear);
 	}
 
-	// Spheres
-	for (int i = 0; i < 2; i++)
+	// ESM/VSM: depth -> moments blurred along x -> along y, and the lit
+	// pass samples the moments instead of the depth
+	RenderGraph::Resource shadowInput = shadowMap;
+	if (m_ShadowFilter == FILTER_ESM || m_ShadowFilter == FILTER_VSM)
 	{
-		shader.setUniformMat4f("u_Model", m_Spheres[i]->getTransformMatrix());
-		m_Spheres[i]->Draw();
+		RenderGraph::TextureDesc momentsDesc = shadowDesc;
+		momentsDesc.format = m_ShadowFilter == FILTER_ESM ? GL_R32F : GL_RG32F;
+		const RenderGraph::Resource blurred = m_Graph.CreateTexture("Moments, blurred in x", momentsDesc);
+		const RenderGraph::Resource moments = m_Graph.CreateTexture("Shadow moments", momentsDesc);
+
+		const RenderGraph::Pass horizontal = m_Graph.AddPass("Moments blur x", [this, shadowMap, blurred, momentsDesc](const RenderGraph::PassContext& context)
+			{
+				BeginTimer(TIMER_BLUR);
+				BlurMoments(0, context.GetTexture(shadowMap), context.GetTexture(blurred), momentsDesc.format);
+			});
+		m_Graph.Read(horizontal, shadowMap);
+		m_Graph.WriteStorage(horizontal, blurred);
+
+		const RenderGraph::Pass vertical = m_Graph.AddPass("Moments blur y", [this, blurred, moments, momentsDesc](const RenderGraph::PassContext& context)
+			{
+				BlurMoments(1, context.GetTexture(blurred), context.GetTexture(moments), momentsDesc.format);
+				EndTimer(TIMER_BLUR);
+			});
+		m_Graph.Read(vertical, blurred);
+		m_Graph.WriteStorage(vertical, moments);
+		shadowInput = moments;
 	}
+
+	const RenderGraph::Pass lit = m_Graph.AddPass("Lit scene", [this, shadowInput](const RenderGraph::PassContext& context)
+		{
+			BeginTimer(TIMER_LIT);
+			DrawLitScene(context.GetTexture(shadowInput));
+			EndTimer(TIMER_LIT);
+		});
+	m_Graph.Read(lit, shadowInput);
+	m_Graph.Write(lit, screen, RenderGraph::LoadOp::Clear);
+
+	if (m_ShowDebugShadowMap)
+	{
+		const RenderGraph::Pass preview = m_Graph.AddPass("Shadow map preview", [this, shadowMap](const RenderGraph::PassContext& context)
+			{
+				GLState::Viewport(0, 0, context.GetWidth() / 4, context.GetHeight() / 4);
+				DrawShadowPreview(context.GetTexture(shadowMap));
+			});
+		m_Graph.Read(preview, shadowMap);
+		m_Graph.Write(preview, screen, RenderGraph::LoadOp::Load);
+	}
+
+	m_Graph.Execute();
 }
 
-void test::TestShadowMapping::Render()
+void test::TestShadowMapping::ReadTimers()
 {
-	// ========================================
-	// Pass 1: Shadow depth pass
-	// ========================================
-	m_ShadowFBO->Bind();
-	glClear(GL_DEPTH_BUFFER_BIT);
+	// Last frame's slot: a frame old, so the results are nearly always in.
+	// One that isn't stays pending, and the slot's timer is skipped until
+	// it is, rather than stall here. This frame writes the other slot.
+	const int slot = m_TimerFront;
+	for (int timer = 0; timer < TIMER_COUNT; timer++)
+	{
+		if (!m_TimerIssued[slot][timer])
+			continue;
+		GLint available = 0;
+		GlCall(glGetQueryObjectiv(m_TimerQueries[slot][timer], GL_QUERY_RESULT_AVAILABLE, &available));
+		if (!available)
+			continue;
+		GLuint64 ns = 0;
+		GlCall(glGetQueryObjectui64v(m_TimerQueries[slot][timer], GL_QUERY_RESULT, &ns));
+		float& ms = m_FilterTimeMs[m_TimerFilter[slot][timer]][timer];
+		ms = ms > 0.0f ? ms * 0.9f + 0.1f * (ns / 1000000.0f) : ns / 1000000.0f;
+		m_TimerIssued[slot][timer] = false;
+	}
+	m_TimerFront = 1 - slot;
+}
 
-	// Cull front faces during shadow pass to reduce shadow acne
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_FRONT);
+void test::TestShadowMapping::BeginTimer(int timer)
+{
+	if (m_TimerIssued[m_TimerFront][timer])
+		return;
+	GlCall(glBeginQuery(GL_TIME_ELAPSED, m_TimerQueries[m_TimerFront][timer]));
+	m_TimerOpen[timer] = true;
+	m_TimerFilter[m_TimerFront][timer] = m_ShadowFilter;
+}
 
-	m_DepthShader->Bind();
-	m_DepthShader->setUniformMat4f("u_LightSpaceMatrix", m_LightSpaceMatrix);
+void test::TestShadowMapping::EndTimer(int timer)
+{
+	if (!m_TimerOpen[timer])
+		return;
+	GlCall(glEndQuery(GL_TIME_ELAPSED));
+	m_TimerOpen[timer] = false;
+	m_TimerIssued[m_TimerFront][timer] = true;
+}
+
+Shader& test::TestShadowMapping::PhongVariant(int filter, int kernelSize, bool showCascades)
+{
+	// Filtering is chosen at compile time: PCF kernel 1 is the hard-shadow
+	// variant, and ESM and VSM have no kernel
+	static const char* filters[FILTER_COUNT] = { "PCF", "HARDWARE", "ESM", "VSM" };
+	const bool kernel = filter == FILTER_PCF || filter == FILTER_HARDWARE;
+	return m_PhongShader->Variant({ { "FILTER", filters[filter] },
+		{ "PCF_KERNEL", std::to_string(kernel ? kernelSize : 1) },
+		{ "CASCADES", showCascades ? "SHOW" : "SHADED" } });
+}
 
-	RenderScene(*m_DepthShader);
+void test::TestShadowMapping::BlurMoments(int pass, unsigned int source, unsigned int dest, unsigned int format)
+{
+	m_MomentsShader->Bind();
+	m_MomentsShader->setUniform1i("u_Pass", pass);
+	m_MomentsShader->setUniform1i("u_Moments", m_ShadowFilter == FILTER_ESM ? 0 : 1);
+	m_MomentsShader->setUniform1f("u_Exponent", m_ESMExponent);
+	m_MomentsShader->setUniform1i("u_Radius", m_BlurRadius);
+
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D_ARRAY, source);
+	m_MomentsShader->setUniform1i("u_Source", 0);
+	// Layered: every cascade in one dispatch, z = layer
+	GlCall(glBindImageTexture(0, dest, 0, GL_TRUE, 0, GL_WRITE_ONLY, format));
+
+	const unsigned int groups = (m_CascadeSettings.resolution + 7) / 8;
+	m_MomentsShader->Dispatch(groups, groups, m_Cascades.GetCount());
+}
 
-	glCullFace(GL_BACK);
-	glDisable(GL_CULL_FACE);
+void test::TestShadowMapping::UpdateShadowCache()
+{
+	m_DirtyCascades = 0;
+	for (bool& dirty : m_CascadeDirty)
+		dirty = false;
+	if (!m_CacheStaticShadows)
+	{
+		// Whatever changes meanwhile would go unseen
+		m_StaticCastersDirty = true;
+		return;
+	}
 
-	m_ShadowFBO->Unbind();
+	RenderGraph::TextureDesc desc;
+	desc.width = desc.height = m_CascadeSettings.resolution;
+	desc.format = GL_DEPTH_COMPONENT24;
+	desc.target = GL_TEXTURE_2D_ARRAY;
+	desc.layers = m_Cascades.GetCount();
+	const bool recreate = !m_StaticCache.IsValid() || !(desc == m_StaticCacheDesc);
+	if (recreate)
+	{
+		if (m_StaticCache.IsValid())
+			GpuResources::Get().Release(m_StaticCache);
+		m_StaticCache = GpuResources::Get().CreateTexture(desc, GpuMemory::Category::RenderTarget);
+		m_StaticCacheDesc = desc;
+
+		// Only ever copied from, never sampled, but a pooled texture
+		// keeps its last user's state
+		GLState::BindTexture(GL_TEXTURE_2D_ARRAY, GpuResources::Get().GetTexture(m_StaticCache));
+		GlCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+		GlCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+		GlCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_NONE));
+		GLState::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
 
-	// Restore viewport to window size
-	glViewport(0, 0, 1920, 1080);
+	// A cascade's matrix moves with the light, the split settings and (by
+	// whole texels) the camera
+	for (int c = 0; c < m_Cascades.GetCount(); c++)
+	{
+		m_CascadeDirty[c] = recreate || m_StaticCastersDirty || !(m_Cascades.GetViewProjection(c) == m_CachedViewProjection[c]);
+		m_CachedViewProjection[c] = m_Cascades.GetViewProjection(c);
+		m_DirtyCascades += m_CascadeDirty[c] ? 1 : 0;
+	}
+	m_StaticCastersDirty = false;
 
-	// ========================================
-	// Pass 2: Scene rendering with shadows
-	// ========================================
-	Renderer renderer;
-	renderer.Clear();
+	// Without glClearTexSubImage the whole array is cleared, so every
+	// layer is redrawn
+	if (m_DirtyCascades > 0 && !(GLEW_VERSION_4_4 || GLEW_ARB_clear_texture))
+	{
+		for (int c = 0; c < m_Cascades.GetCount(); c++)
+			m_CascadeDirty[c] = true;
+		m_DirtyCascades = m_Cascades.GetCount();
+	}
+	m_ShadowRegens += m_DirtyCascades;
+}
 
-	m_PhongShader->Bind();
+void test::TestShadowMapping::DrawShadowDepth(RenderQueue& casters)
+{
+	// Cull front faces during shadow pass to reduce shadow acne
+	GLState::Enable(GL_CULL_FACE);
+	GLState::CullFace(GL_FRONT);
+	// Casters between the light and a cascade's box are flattened onto
+	// its near plane rather than clipped (see ShadowCascades.h)
+	GLState::Enable(GL_DEPTH_CLAMP);
 
-	// Bind shadow map to texture unit 0
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_ShadowFBO->GetDepthTexture());
-	m_PhongShader->setUniform1i("u_ShadowMap", 0);
+	m_DepthShader->Bind();
+	SetCascadeMatrices(*m_DepthShader);
 
-	// Camera/transform uniforms
-	m_PhongShader->setUniformMat4f("u_View", m_View);
-	m_PhongShader->setUniformMat4f("u_Projection", m_Projection);
-	m_PhongShader->setUniformMat4f("u_LightSpaceMatrix", m_LightSpaceMatrix);
+	casters.FlushPass(RenderPass::Shadow);
 
-	// Light uniforms
-	m_PhongShader->setUniform3f("u_Light.Direction", m_LightDirection.x, m_LightDirection.y, m_LightDirection.z);
-	m_PhongShader->setUniform3f("u_Light.Colour", m_LightColour.r, m_LightColour.g, m_LightColour.b);
+	GLState::Disable(GL_DEPTH_CLAMP);
+	GLState::CullFace(GL_BACK);
+	GLState::Disable(GL_CULL_FACE);
+}
+
+void test::TestShadowMapping::SetCascadeMatrices(Shader& shader) const
+{
+	static const char* names[ShadowCascades::MAX_CASCADES] =
+	{
+		"u_CascadeViewProjection[0]", "u_CascadeViewProjection[1]", "u_CascadeViewProjection[2]", "u_CascadeViewProjection[3]"
+	};
+	for (int c = 0; c < m_Cascades.GetCount(); c++)
+		shader.setUniformMat4f(names[c], m_Cascades.GetViewProjection(c));
+}
 
-	glm::vec3 camPos = m_Camera->getPosition();
-	m_PhongShader->setUniform3f("u_CameraPosition", camPos.x, camPos.y, camPos.z);
+void test::TestShadowMapping::DrawLitScene(unsigned int shadowMap)
+{
+	m_PhongVariant->Bind();
+
+	// Bind shadow map to texture unit 0
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D_ARRAY, shadowMap);
+	if (m_ShadowFilter == FILTER_HARDWARE)
+	{
+		GlCall(glBindSampler(0, m_CompareSampler));
+	}
+	m_PhongVariant->setUniform1i("u_ShadowMap", 0);
+	SetCascadeMatrices(*m_PhongVariant);
+	const glm::vec4& splits = m_Cascades.GetSplits();
+	m_PhongVariant->setUniform4f("u_CascadeSplits", splits.x, splits.y, splits.z, splits.w);
+	m_PhongVariant->setUniform1i("u_CascadeCount", m_Cascades.GetCount());
+	// Camera uniforms live in the FrameData block; only the cascades are
+	// specific to this shader.
+	FrameUniforms::SetCamera(m_View, m_Projection, m_Camera->getPosition());
+
+	// Light uniforms
+	m_PhongVariant->setUniform3f("u_Light.Direction", m_LightDirection.x, m_LightDirection.y, m_LightDirection.z);
+	m_PhongVariant->setUniform3f("u_Light.Colour", m_LightColour.r, m_LightColour.g, m_LightColour.b);
 
 	// Phong params
-	m_PhongShader->setUniform1f("u_AmbientIntensity", m_AmbientIntensity);
-	m_PhongShader->setUniform1f("u_DiffuseIntensity", m_DiffuseIntensity);
-	m_PhongShader->setUniform1f("u_SpecularIntensity", m_SpecularIntensity);
-	m_PhongShader->setUniform1f("u_Shininess", m_Shininess);
+	m_PhongVariant->setUniform1f("u_AmbientIntensity", m_AmbientIntensity);
+	m_PhongVariant->setUniform1f("u_DiffuseIntensity", m_DiffuseIntensity);
+	m_PhongVariant->setUniform1f("u_SpecularIntensity", m_SpecularIntensity);
+	m_PhongVariant->setUniform1f("u_Shininess", m_Shininess);
 
 	// Object color
-	m_PhongShader->setUniform3f("u_ObjectColor", m_ObjectColor.r, m_ObjectColor.g, m_ObjectColor.b);
+	m_PhongVariant->setUniform3f("u_ObjectColor", m_ObjectColor.r, m_ObjectColor.g, m_ObjectColor.b);
 
 	// Shadow params
-	m_PhongShader->setUniform1f("u_ShadowBias", m_ShadowBias);
-	m_PhongShader->setUniform1i("u_EnablePCF", m_EnablePCF ? 1 : 0);
-	m_PhongShader->setUniform1i("u_PCFKernelSize", m_PCFKernelSize);
+	m_PhongVariant->setUniform1f("u_ShadowBias", m_ShadowBias);
+	m_PhongVariant->setUniform1f("u_ESMExponent", m_ESMExponent);
+	m_PhongVariant->setUniform1f("u_VSMMinVariance", m_VSMMinVariance);
+	m_PhongVariant->setUniform1f("u_LightBleedReduction", m_LightBleedReduction);
 
-	RenderScene(*m_PhongShader);
+	m_RenderQueue.SetDepthPrepass(m_DepthPrepass);
+	m_RenderQueue.FlushPass(RenderPass::Opaque);
+	if (m_OcclusionCulling)
+		DrawOccludees();
 
+	GlCall(glBindSampler(0, 0));
+}
+
+// After the occluders: a box test for each entity hidden last frame, then
+// every entity's own draw, one instance of LIST_OCCLUSION each, skipped by
+// the GPU where the test found the box hidden. The lit program's uniforms
+// are already set.
+void test::TestShadowMapping::DrawOccludees()
+{
+	const unsigned int count = static_cast<unsigned int>(m_OccludeeList.size());
+	m_Occlusion->TestBounds(m_OccludeeKeys.data(), m_OccludeeBounds.data(), count, m_Projection * m_View,
+		m_Camera->getPosition());
+
+	m_PhongVariant->Bind();
+	Renderer renderer;
+	const InstanceBuffer* instances[MESH_COUNT] = { m_CubeInstances.get(), m_SphereInstances.get() };
+	unsigned int next[MESH_COUNT] = { m_OccludeeFirst[MESH_CUBE], m_OccludeeFirst[MESH_SPHERE] };
+	unsigned int bound = MESH_COUNT;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const unsigned int mesh = m_Scene.GetMeshIds()[m_OccludeeList[i]];
+		const Mesh& geometry = m_Scene.GetMesh(mesh);
+		if (mesh != bound)
+		{
+			const VertexArray* vao = geometry.getInstancedVertexArray();
+			vao->Bind();
+			vao->BindInstanceBuffer(*instances[mesh]);
+			geometry.getIndexBuffer()->Bind();
+			bound = mesh;
+		}
+
+		const MeshArena::Range& range = geometry.getArenaRange();
+		m_Occlusion->BeginDraw(m_OccludeeKeys[i]);
+		renderer.DrawIndexedInstanced(range.indexCount, 1, range.firstIndex, range.baseVertex, next[mesh]++,
+			geometry.getIndexBuffer()->GetType());
+		m_Occlusion->EndDraw(m_OccludeeKeys[i]);
+	}
+}
+
+void test::TestShadowMapping::DrawShadowPreview(unsigned int shadowMap)
+{
+	GLState::Disable(GL_DEPTH_TEST);
+	m_PreviewShader->Bind();
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D_ARRAY, shadowMap);
+	m_PreviewShader->setUniform1i("u_ShadowMap", 0);
+	m_PreviewShader->setUniform1i("u_Layer", std::min(m_PreviewCascade, m_Cascades.GetCount() - 1));
+	m_PreviewQuad->Draw();
+	GLState::Enable(GL_DEPTH_TEST);
 }
 
 void test::TestShadowMapping::RenderGUI()
@@ -197,33 +812,73 @@ void test::TestShadowMapping::RenderGUI()
 	// Shadow bias
 	ImGui::SliderFloat("Shadow Bias", &m_ShadowBias, 0.0f, 0.05f, "%.4f");
 
-	// Shadow resolution
-	ImGui::Text("Shadow Map Resolution:");
-	int prevRes = m_ShadowResolution;
-	ImGui::RadioButton("1024", &m_ShadowResolution, 1024); ImGui::SameLine();
-	ImGui::RadioButton("2048", &m_ShadowResolution, 2048); ImGui::SameLine();
-	ImGui::RadioButton("4096", &m_ShadowResolution, 4096);
-	if (m_ShadowResolution != prevRes)
-	{
-		RecreateShadowMap();
-	}
-
-	// PCF
-	ImGui::Checkbox("Enable PCF", &m_EnablePCF);
-	if (m_EnablePCF)
+	// Shadow resolution, of each cascade
+	ImGui::Text("Cascade Resolution:");
+	ImGui::RadioButton("512", &m_CascadeSettings.resolution, 512); ImGui::SameLine();
+	ImGui::RadioButton("1024", &m_CascadeSettings.resolution, 1024); ImGui::SameLine();
+	ImGui::RadioButton("2048", &m_CascadeSettings.resolution, 2048);
+
+	// Filtering
+	ImGui::Text("Shadow Filter:");
+	ImGui::RadioButton("PCF", &m_ShadowFilter, FILTER_PCF); ImGui::SameLine();
+	ImGui::RadioButton("Hardware PCF", &m_ShadowFilter, FILTER_HARDWARE); ImGui::SameLine();
+	ImGui::RadioButton("ESM", &m_ShadowFilter, FILTER_ESM); ImGui::SameLine();
+	ImGui::RadioButton("VSM", &m_ShadowFilter, FILTER_VSM);
+	if (m_ShadowFilter == FILTER_PCF || m_ShadowFilter == FILTER_HARDWARE)
 	{
 		ImGui::Text("PCF Kernel Size:");
+		ImGui::RadioButton("1x1", &m_PCFKernelSize, 1); ImGui::SameLine();
 		ImGui::RadioButton("3x3", &m_PCFKernelSize, 3); ImGui::SameLine();
 		ImGui::RadioButton("5x5", &m_PCFKernelSize, 5);
 	}
+	else
+	{
+		ImGui::SliderInt("Blur radius", &m_BlurRadius, 0, 8);
+		if (m_ShadowFilter == FILTER_ESM)
+			ImGui::SliderFloat("ESM exponent", &m_ESMExponent, 10.0f, 80.0f);
+		else
+		{
+			ImGui::SliderFloat("Min variance", &m_VSMMinVariance, 0.0f, 0.001f, "%.6f");
+			ImGui::SliderFloat("Light bleed reduction", &m_LightBleedReduction, 0.0f, 0.9f);
+		}
+	}
+
+	// Each filter's last measured cost; switch between them to compare
+	static const char* filterNames[FILTER_COUNT] = { "PCF", "Hardware PCF", "ESM", "VSM" };
+	ImGui::Text("GPU time (moment blur + lit pass):");
+	for (int f = 0; f < FILTER_COUNT; f++)
+	{
+		const float* ms = m_FilterTimeMs[f];
+		if (ms[TIMER_LIT] == 0.0f)
+			ImGui::BulletText("%s: not measured yet", filterNames[f]);
+		else
+			ImGui::BulletText("%s: %.3f + %.3f ms%s", filterNames[f], ms[TIMER_BLUR], ms[TIMER_LIT], f == m_ShadowFilter ? "  <" : "");
+	}
 
 
 
 	ImGui::Separator();
-	ImGui::Text("Light Ortho Settings");
-	ImGui::SliderFloat("Ortho Size", &m_OrthoSize, 5.0f, 50.0f);
-	ImGui::SliderFloat("Near Plane", &m_NearPlane, 0.1f, 10.0f);
-	ImGui::SliderFloat("Far Plane", &m_FarPlane, 10.0f, 100.0f);
+	ImGui::Text("Cascades");
+	ImGui::SliderInt("Cascade count", &m_CascadeSettings.count, 1, ShadowCascades::MAX_CASCADES);
+	ImGui::SliderFloat("Split lambda", &m_CascadeSettings.lambda, 0.0f, 1.0f);
+	ImGui::SliderFloat("Shadow distance", &m_CascadeSettings.shadowDistance, 10.0f, 300.0f);
+	ImGui::SliderFloat("Caster distance", &m_CascadeSettings.casterDistance, 0.0f, 100.0f);
+	ImGui::Checkbox("Show cascades", &m_ShowCascades);
+	for (int c = 0; c < m_Cascades.GetCount(); c++)
+		ImGui::Text("  %d: to %.1f m, texel %.3f m", c, m_Cascades.GetSplits()[c], m_Cascades.GetTexelSize(c));
+
+	// Shadow caching
+	ImGui::Checkbox("Cache static shadows", &m_CacheStaticShadows);
+	if (ImGui::Checkbox("Animate spheres", &m_AnimateSpheres))
+	{
+		RestSpheres();
+		// The spheres join or leave the static casters
+		m_StaticCastersDirty = true;
+	}
+	ImGui::Text("Static cache regenerations: %u layers (%u this frame)", m_ShadowRegens, m_DirtyCascades);
+	// Fill cost against the single 2048 map this replaced
+	const float texels = m_Cascades.GetCount() * static_cast<float>(m_CascadeSettings.resolution) * m_CascadeSettings.resolution;
+	ImGui::Text("Shadow texels: %.1fM (one 2048 map: 4.2M)", texels / 1e6f);
 
 	ImGui::Separator();
 	ImGui::Text("Phong Lighting");
@@ -235,9 +890,58 @@ void test::TestShadowMapping::RenderGUI()
 	ImGui::Separator();
 	ImGui::ColorEdit3("Object Color", glm::value_ptr(m_ObjectColor));
 	ImGui::ColorEdit3("Light Colour", glm::value_ptr(m_LightColour));
-}
 
-void test::TestShadowMapping::RecreateShadowMap()
-{
-	m_ShadowFBO = std::make_unique<Framebuffer>(m_ShadowResolution, m_ShadowResolution, true);
+	ImGui::Separator();
+	const RenderQueue::Stats& stats = m_RenderQueue.GetStats();
+	ImGui::Text("Render Queue");
+	if (ImGui::SliderInt("Cube field size", &m_CubeFieldSize, 0, 64))
+	{
+		BuildScene();
+	}
+	if (ImGui::Checkbox("Stress: 100k entities", &m_StressMode))
+	{
+		BuildScene();
+	}
+	ImGui::Text("Objects drawn: %u in %u draw calls", stats.instances, stats.drawCalls);
+	ImGui::Checkbox("Frustum culling", &m_EnableCulling);
+	ImGui::Text("Scene: %u entities", m_InstancesTotal);
+	ImGui::Text("Camera: %u visible, %u culled", m_CameraVisible, m_InstancesTotal - m_CameraVisible);
+	const unsigned int shadowTests = m_InstancesTotal * m_Cascades.GetCount();
+	ImGui::Text("Shadow: %u drawn over %d cascades, %u culled", m_ShadowVisible, m_Cascades.GetCount(), shadowTests - m_ShadowVisible);
+	ImGui::Checkbox("Occlusion queries", &m_OcclusionCulling);
+	ImGui::SameLine();
+	if (ImGui::Checkbox("Occlusion field", &m_OcclusionField))
+	{
+		BuildScene();
+	}
+	if (m_OcclusionCulling)
+	{
+		const OcclusionQueries::Stats& occlusion = m_Occlusion->GetStats();
+		ImGui::Text("Occlusion: %u tested (%u by box), %u hidden last frame, %u late answers", occlusion.objects,
+			occlusion.boxTests, occlusion.hidden, occlusion.late);
+		ImGui::Text("Queries: %s", m_Occlusion->GetTarget() == GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+			? "any samples passed, conservative" : "any samples passed");
+	}
+	ImGui::Text("Commands: %u", stats.commands);
+	ImGui::Text("Shader binds: %u  VAO binds: %u  Instance binds: %u", stats.shaderBinds, stats.vaoBinds, stats.instanceBinds);
+	// The lit pass's GPU time is in the filter timings above
+	ImGui::Checkbox("Depth pre-pass", &m_DepthPrepass);
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(m_Window, &width, &height);
+	const RenderQueue::FragmentStats& fragments = m_RenderQueue.GetFragmentStats();
+	const double pixels = std::max(1.0, static_cast<double>(width) * height);
+	ImGui::Text("Fragments shaded: %.2f M (%.2f per pixel)", fragments.shadedFragments / 1e6, fragments.shadedFragments / pixels);
+	if (fragments.prepass)
+		ImGui::Text("Pre-pass: %.2f M depth fragments in %u draws", fragments.prepassFragments / 1e6, stats.prepassDrawCalls);
+
+	ImGui::Separator();
+	const RenderGraph::Stats& graph = m_Graph.GetStats();
+	ImGui::Text("Render Graph");
+	ImGui::Checkbox("Show shadow map", &m_ShowDebugShadowMap);
+	if (m_ShowDebugShadowMap)
+		ImGui::SliderInt("Preview cascade", &m_PreviewCascade, 0, m_Cascades.GetCount() - 1);
+	for (const RenderGraph::PassInfo& pass : m_Graph.GetPassInfo())
+		ImGui::BulletText("%s%s", pass.name.c_str(), pass.culled ? " (culled)" : "");
+	ImGui::Text("Transient textures: %u (%.1f MB)", graph.textures, graph.allocatedBytes / (1024.0f * 1024.0f));
+	ImGui::Text("Clears: %u  Barriers: %u  Framebuffers: %u", graph.clears, graph.barriers, graph.framebuffers);
 }
@@ -1,7 +1,14 @@
 #pragma once
 #include "Tests.h"
 #include "../Shader.h"
-#include "../Framebuffer.h"
+#include "../ComputeShader.h"
+#include "../RenderGraph.h"
+#include "../ShadowCascades.h"
+#include "../RenderQueue.h"
+#include "../InstanceBuffer.h"
+#include "../Culling.h"
+#include "../Scene.h"
+#include "../OcclusionQueries.h"
 #include "../Mesh/GeometryFactory.h"
 #include "../utils/Camera.h"
 #include <memory>
@@ -17,30 +24,159 @@ namespace test
 		TestShadowMapping(GLFWwindow* window);
 		~TestShadowMapping();
 
+		// Every program the constructor and the first frames create, into
+		// ShaderCache on the BackgroundLoader (see TestMenu::PreloadAll)
+		static void Preload();
+		void OnSuspend() override;
+		void OnResume() override;
+
 		void Update(float deltaTime) override;
 		void Render() override;
 		void RenderGUI() override;
+		// Only the bouncing spheres move without input (RenderOnDemand.h)
+		bool IsAnimating() const override { return m_AnimateSpheres; }
 
 	private:
-		void RenderScene(Shader& shader);
-		void RecreateShadowMap();
+		// How the lit pass filters the shadow map (the FILTER variant of
+		// ShadowPhong.shader). PCF compares NxN depths in the shader;
+		// HARDWARE fetches through a comparison sampler, each fetch a
+		// bilinear 2x2 compare; ESM and VSM render depth as usual, then
+		// turn it into moments and blur them once per frame with a
+		// separable compute pass, so the lit pass makes one fetch however
+		// soft the shadow is.
+		enum ShadowFilter { FILTER_PCF = 0, FILTER_HARDWARE, FILTER_ESM, FILTER_VSM, FILTER_COUNT };
+
+		// Scene mesh ids, in the order BuildScene adds them
+		enum SceneMesh { MESH_CUBE = 0, MESH_SPHERE, MESH_COUNT };
+
+		// The lists one mesh's instance buffer holds this frame, one after
+		// another: each cascade's static shadow casters, each cascade's
+		// dynamic ones, then what the camera sees. Each shadow group is one
+		// instanced draw covering all its cascades, the camera list another,
+		// each starting at its own baseInstance. With occlusion queries the
+		// camera list is only the occluders, and the rest follow it in
+		// LIST_OCCLUSION, drawn one instance at a time.
+		enum DrawList
+		{
+			LIST_STATIC_SHADOW = 0,
+			LIST_DYNAMIC_SHADOW = ShadowCascades::MAX_CASCADES,
+			LIST_CAMERA = 2 * ShadowCascades::MAX_CASCADES,
+			LIST_OCCLUSION,
+			LIST_COUNT
+		};
+
+		// Entities of the stress mode, spread over the whole ground slab
+		static const unsigned int STRESS_ENTITIES = 100000;
+		// The occlusion field: walls, and this many squared objects behind them
+		static const int OCCLUSION_FIELD_SIZE = 40;
+
+		void BuildScene();
+		// Culls the scene for every cascade and the camera and fills each
+		// mesh's upload and list counts
+		void CullScene();
+		void GatherList(const std::vector<unsigned int>& visible, uint8_t flagMask, uint8_t flagValue, int list);
+		void SubmitShadowGroup(RenderCommand cmd, SceneMesh mesh, int firstList, unsigned int& firstInstance, RenderQueue& queue);
+		void SubmitMesh(SceneMesh mesh, const InstanceBuffer& instances);
+		void SubmitScene();
+		void AnimateSpheres();
+		void RestSpheres();
+		void UpdateShadowCache();
+
+		// Graph passes
+		void DrawShadowDepth(RenderQueue& casters);
+		void DrawLitScene(unsigned int shadowMap);
+		void DrawOccludees();
+		void DrawShadowPreview(unsigned int shadowMap);
+		void BlurMoments(int pass, unsigned int source, unsigned int dest, unsigned int format);
+		void ReadTimers();
+		// Skip a timer whose last result hasn't come back yet
+		void BeginTimer(int timer);
+		void EndTimer(int timer);
+		void SetCascadeMatrices(Shader& shader) const;
+		Shader& PhongVariant(int filter, int kernelSize, bool showCascades);
 
 		GLFWwindow* m_Window;
 
 		std::unique_ptr<Camera> m_Camera;
 		std::unique_ptr<Shader> m_DepthShader;
-		std::unique_ptr<Shader> m_PhongShader;
-		std::unique_ptr<Framebuffer> m_ShadowFBO;
+		std::shared_ptr<Shader> m_PhongShader;
+		Shader* m_PhongVariant = nullptr;   // m_PhongShader's variant for the current filter settings
+		std::unique_ptr<ComputeShader> m_MomentsShader;
+		unsigned int m_CompareSampler = 0;  // HARDWARE: linear, GL_COMPARE_REF_TO_TEXTURE
+		std::unique_ptr<Shader> m_PreviewShader;
+		std::unique_ptr<Mesh> m_PreviewQuad;
+
+		// Shadow depth -> lit scene (-> shadow map preview), redeclared
+		// every frame; the shadow map is a transient it allocates
+		RenderGraph m_Graph;
+
+		RenderQueue m_RenderQueue;
+		RenderQueue m_StaticShadowQueue;   // static casters of the cascades being recached
+		bool m_DepthPrepass = false;       // lit pass: depth first, then shade with GL_EQUAL
 
-		// Scene objects
-		std::unique_ptr<Mesh> m_GroundPlane;
-		std::unique_ptr<Mesh> m_Cubes[3];
-		std::unique_ptr<Mesh> m_Spheres[2];
+		// Scene objects: entities of m_Scene, one mesh per shape, drawn
+		// instanced. The ground slab is the first cube entity.
+		Scene m_Scene;
+		std::shared_ptr<const Mesh> m_CubeMesh;     // GeometryFactory's shared geometry
+		std::shared_ptr<const Mesh> m_SphereMesh;
+		std::unique_ptr<InstanceBuffer> m_CubeInstances;
+		std::unique_ptr<InstanceBuffer> m_SphereInstances;
+
+		// This frame's visible entities (scene indices) and, per mesh, what
+		// was gathered from them
+		std::vector<unsigned int> m_ShadowVisibleList[ShadowCascades::MAX_CASCADES];
+		std::vector<unsigned int> m_CameraVisibleList;
+		std::vector<InstanceData> m_Uploads[MESH_COUNT];
+		unsigned int m_ListCounts[MESH_COUNT][LIST_COUNT] = {};
+		bool m_StressMode = false;
+
+		// Frustum culling: camera frustum for the lit pass, each cascade's
+		// ortho box for its part of the shadow pass
+		bool m_EnableCulling;
+		unsigned int m_InstancesTotal = 0;
+		unsigned int m_CameraVisible = 0;
+		unsigned int m_ShadowVisible = 0;   // summed over cascades
+
+		// Occlusion queries: the lit pass draws the FLAG_OCCLUDER entities
+		// (the ground and the cubes, the walls of the occlusion field)
+		// instanced, then the camera's other entities one by one under
+		// m_Occlusion, keyed by entity id
+		bool m_OcclusionCulling = false;
+		bool m_OcclusionField = false;
+		std::unique_ptr<OcclusionQueries> m_Occlusion;
+		std::vector<unsigned int> m_OccludeeList;   // scene indices, in LIST_OCCLUSION order
+		std::vector<unsigned int> m_OccludeeKeys;
+		std::vector<Bounds> m_OccludeeBounds;
+		unsigned int m_OccludeeFirst[MESH_COUNT] = {};   // LIST_OCCLUSION's first instance
 
 		// Transforms
 		glm::mat4 m_View;
 		glm::mat4 m_Projection;
-		glm::mat4 m_LightSpaceMatrix;
+
+		// Cascaded shadow maps, one layer of the shadow map array each
+		ShadowCascades m_Cascades;
+		ShadowCascades::Settings m_CascadeSettings;
+		bool m_ShowCascades = false;
+		int m_PreviewCascade = 0;
+
+		// Shadow caching: the static casters' depth lives in m_StaticCache
+		// and a layer is redrawn only when its cascade's matrix or the
+		// static casters change. Each frame copies the cache into the
+		// shadow map and draws just the dynamic casters on top.
+		bool m_CacheStaticShadows = true;
+		bool m_StaticCastersDirty = true;
+		TextureHandle m_StaticCache;
+		RenderGraph::TextureDesc m_StaticCacheDesc;
+		glm::mat4 m_CachedViewProjection[ShadowCascades::MAX_CASCADES];
+		bool m_CascadeDirty[ShadowCascades::MAX_CASCADES] = {};
+		unsigned int m_DirtyCascades = 0;     // this frame
+		unsigned int m_ShadowRegens = 0;      // cascade layers redrawn since the test opened
+
+		// Dynamic casters: the spheres bob up and down when animated
+		bool m_AnimateSpheres = false;
+		float m_AnimationTime = 0.0f;
+		std::vector<Scene::Entity> m_Spheres;
+		std::vector<glm::mat4> m_SphereRest;
 
 		// Light
 		glm::vec3 m_LightDirection;
@@ -48,11 +184,25 @@ namespace test
 
 		// Shadow params
 		float m_ShadowBias;
-		int m_ShadowResolution;
-		bool m_EnablePCF;
+		int m_ShadowFilter;
 		int m_PCFKernelSize;
+		int m_BlurRadius = 3;                 // ESM/VSM, texels either side
+		float m_ESMExponent = 60.0f;
+		float m_VSMMinVariance = 0.00002f;
+		float m_LightBleedReduction = 0.2f;
 		bool m_ShowDebugShadowMap;
 
+		// GPU time of the moment blur and the lit pass, double-buffered
+		// like TestGPUParticles' so reading never waits on this frame.
+		// Each result is kept under the filter it measured.
+		enum Timer { TIMER_BLUR = 0, TIMER_LIT, TIMER_COUNT };
+		unsigned int m_TimerQueries[2][TIMER_COUNT] = {};
+		bool m_TimerIssued[2][TIMER_COUNT] = {};     // ended, result not read yet
+		bool m_TimerOpen[TIMER_COUNT] = {};          // begun this frame
+		int m_TimerFilter[2][TIMER_COUNT] = {};
+		int m_TimerFront = 0;
+		float m_FilterTimeMs[FILTER_COUNT][TIMER_COUNT] = {};
+
 		// Phong params
 		float m_AmbientIntensity;
 		float m_DiffuseIntensity;
@@ -60,9 +210,7 @@ namespace test
 		float m_Shininess;
 		glm::vec3 m_ObjectColor;
 
-		// Light ortho params
-		float m_OrthoSize;
-		float m_NearPlane;
-		float m_FarPlane;
+		// Extra N x N field of instanced cubes
+		int m_CubeFieldSize;
 	};
 }
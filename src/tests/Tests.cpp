@@ -1,7 +1,11 @@
 #include "Tests.h"
 #include "DefaultScene.h"
+#include "../Profiler.h"
+#include "../BackgroundLoader.h"
 #include "../vendor/imgui/imgui.h"
 
+#include <cfloat>
+
 
 namespace test
 {
@@ -10,20 +14,195 @@ namespace test
         m_DefaultScene = std::make_unique<DefaultScene>();
     }
 
+    // Shared by every test, so the selection survives switching
+    static unsigned int s_ProfilerSelected = Profiler::NONE;
+
+    static void ProfilerRow(unsigned int index)
+    {
+        const std::vector<Profiler::Scope>& scopes = Profiler::GetScopes();
+        const Profiler::Stats cpu = Profiler::GetCpuStats(index);
+        const Profiler::Stats gpu = Profiler::GetGpuStats(index);
+
+        bool hasChildren = false;
+        for (unsigned int i = index + 1; i < scopes.size() && !hasChildren; i++)
+            hasChildren = scopes[i].parent == index && Profiler::IsActive(i);
+
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_SpanFullWidth;
+        if (!hasChildren)
+            flags |= ImGuiTreeNodeFlags_Leaf;
+        if (s_ProfilerSelected == index)
+            flags |= ImGuiTreeNodeFlags_Selected;
+        const bool open = ImGui::TreeNodeEx(reinterpret_cast<void*>(static_cast<std::size_t>(index)), flags, "%s", scopes[index].name.c_str());
+        if (ImGui::IsItemClicked())
+            s_ProfilerSelected = index;
+
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f / %.3f / %.3f", cpu.mean, cpu.p95, cpu.max);
+        ImGui::TableNextColumn();
+        if (gpu.samples > 0)
+            ImGui::Text("%.3f / %.3f / %.3f", gpu.mean, gpu.p95, gpu.max);
+        else
+            ImGui::TextDisabled("-");
+
+        if (open)
+        {
+            for (unsigned int i = index + 1; i < scopes.size(); i++)
+            {
+                if (scopes[i].parent == index && Profiler::IsActive(i))
+                    ProfilerRow(i);
+            }
+            ImGui::TreePop();
+        }
+    }
+
+    void Tests::RenderProfilerWindow(bool* open)
+    {
+        if (!ImGui::Begin("Profiler", open))
+        {
+            ImGui::End();
+            return;
+        }
+
+        bool enabled = Profiler::IsEnabled();
+        if (ImGui::Checkbox("Enabled", &enabled))
+            Profiler::SetEnabled(enabled);
+        ImGui::SameLine();
+        if (ImGui::Button("Reset"))
+            Profiler::Reset();
+        ImGui::SameLine();
+        ImGui::Text("GPU results %u frames late, %u frames dropped", Profiler::FRAMES, Profiler::GetDroppedFrames());
+
+        // ms over the last Profiler::HISTORY frames
+        const std::vector<Profiler::Scope>& scopes = Profiler::GetScopes();
+        const ImGuiTableFlags tableFlags = ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+        if (ImGui::BeginTable("Scopes", 3, tableFlags))
+        {
+            ImGui::TableSetupColumn("Scope");
+            ImGui::TableSetupColumn("CPU mean / p95 / max");
+            ImGui::TableSetupColumn("GPU mean / p95 / max");
+            ImGui::TableHeadersRow();
+            for (unsigned int i = 0; i < scopes.size(); i++)
+            {
+                if (scopes[i].parent == Profiler::NONE && Profiler::IsActive(i))
+                    ProfilerRow(i);
+            }
+            ImGui::EndTable();
+        }
+
+        if (s_ProfilerSelected < scopes.size())
+        {
+            const Profiler::Scope& scope = scopes[s_ProfilerSelected];
+            static std::vector<float> history;
+            Profiler::GetHistory(scope.cpu, scope.cpuCount, history);
+            if (!history.empty())
+                ImGui::PlotLines("CPU ms", history.data(), static_cast<int>(history.size()), 0, scope.name.c_str(), 0.0f, FLT_MAX, ImVec2(0, 50));
+            Profiler::GetHistory(scope.gpu, scope.gpuCount, history);
+            if (!history.empty())
+                ImGui::PlotLines("GPU ms", history.data(), static_cast<int>(history.size()), 0, scope.name.c_str(), 0.0f, FLT_MAX, ImVec2(0, 50));
+        }
+        ImGui::End();
+    }
+
 	TestMenu::TestMenu(Tests*& currentTestPointer) : m_CurrentTest(currentTestPointer)
 	{
 
 	}
 
+	TestMenu::~TestMenu()
+	{
+		for (auto& warm : m_Warm)
+			delete warm.second;
+	}
+
+	void TestMenu::PreloadAll()
+	{
+		if (!BackgroundLoader::IsAlive())
+			return;
+
+		m_PreloadStates.resize(m_Preloads.size(), PreloadState::None);
+		for (std::size_t i = 0; i < m_Preloads.size(); i++)
+		{
+			if (!m_Preloads[i] || m_PreloadStates[i] != PreloadState::None)
+				continue;
+			m_PreloadStates[i] = PreloadState::Queued;
+			// The menu outlives the loader's callbacks: main shuts the
+			// loader down before deleting it
+			BackgroundLoader::Get().Submit(m_Tests[i].first, m_Preloads[i],
+				[this, i]() { m_PreloadStates[i] = PreloadState::Done; });
+		}
+	}
+
+	void TestMenu::Close(Tests* test)
+	{
+		if (test == this)
+			return;
+		if (m_KeepWarm == 0)
+		{
+			delete test;
+			return;
+		}
+
+		test->OnSuspend();
+		m_Warm.push_back(std::make_pair(m_OpenIndex, test));
+		SetKeepWarm(m_KeepWarm);
+	}
+
+	void TestMenu::SetKeepWarm(unsigned int count)
+	{
+		m_KeepWarm = count;
+		while (m_Warm.size() > m_KeepWarm)
+		{
+			delete m_Warm.front().second;
+			m_Warm.erase(m_Warm.begin());
+		}
+	}
 
 	void TestMenu::RenderGUI()
 	{
-		for (auto& test : m_Tests)
+		for (std::size_t i = 0; i < m_Tests.size(); i++)
 		{
-			if (ImGui::Button(test.first.c_str()))
+			auto warm = m_Warm.begin();
+			while (warm != m_Warm.end() && warm->first != i)
+				++warm;
+
+			if (ImGui::Button(m_Tests[i].first.c_str()))
+			{
+				m_OpenIndex = i;
+				if (warm != m_Warm.end())
+				{
+					m_CurrentTest = warm->second;
+					m_Warm.erase(warm);
+					m_CurrentTest->OnResume();
+				}
+				else
+					m_CurrentTest = m_Tests[i].second();
+				continue;
+			}
+
+			if (warm != m_Warm.end())
 			{
-				m_CurrentTest = test.second();
+				ImGui::SameLine();
+				ImGui::TextDisabled("(warm)");
 			}
+			else if (i < m_PreloadStates.size() && m_PreloadStates[i] != PreloadState::None)
+			{
+				ImGui::SameLine();
+				ImGui::TextDisabled(m_PreloadStates[i] == PreloadState::Done ? "(preloaded)" : "(preloading...)");
+			}
+		}
+
+		ImGui::Separator();
+		int keepWarm = static_cast<int>(m_KeepWarm);
+		if (ImGui::SliderInt("Tests kept warm", &keepWarm, 0, 8))
+			SetKeepWarm(static_cast<unsigned int>(keepWarm));
+		if (BackgroundLoader::IsAlive())
+		{
+			const BackgroundLoader::Stats loader = BackgroundLoader::Get().GetStats();
+			ImGui::Text("Background loader: %u / %u jobs done, %u queued, %.0f ms of work%s%s", loader.completed,
+				loader.submitted, loader.queued, loader.busyMs, loader.current.empty() ? "" : ", running ",
+				loader.current.c_str());
 		}
 	}
 }
@@ -31,11 +31,18 @@
  *
  * The TestMenu holds a list of (name, factory) pairs. When user selects
  * a test, the factory lambda is called to instantiate the concrete test class.
+ *
+ * Two things make opening a test cheaper than running its constructor
+ * from scratch each time (see TestMenu below): a test's optional static
+ * Preload() warms its caches on the BackgroundLoader's thread before it is
+ * first opened, and closed tests can be kept alive to be resumed as they were.
  */
 
 #pragma once
 #include <functional>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <memory>
 
@@ -76,12 +83,49 @@ namespace test
         virtual void Render() {}                 // Called each frame for drawing
         virtual void RenderGUI() {}              // Called for ImGui interface
 
+        // The pair around a test the TestMenu keeps warm. OnSuspend runs
+        // when it is closed but not deleted: undo the GL state it leaves
+        // for the next test, as the destructor would have. OnResume runs
+        // when it is reopened instead of constructed: other tests ran in
+        // between, so restore the state the constructor set up (depth
+        // test, polygon mode, ...).
+        virtual void OnSuspend() {}
+        virtual void OnResume() {}
+
+        // RENDER ON DEMAND (see RenderOnDemand.h):
+        // Whether the picture moves with nobody touching anything. While it
+        // doesn't, the main loop may show the last frame again instead of
+        // calling Render. The default keeps every test rendering each frame;
+        // a test without time-driven animation (or with it switched off)
+        // returns false and is redrawn on input and GUI changes only.
+        virtual bool IsAnimating() const { return true; }
+
+        // Something the last frame doesn't show changed without input, e.g.
+        // a file reloaded or a result read back: draw the next frame
+        void RequestRender() { m_RenderRequested = true; }
+        // For the main loop: the request, cleared
+        bool TakeRenderRequest()
+        {
+            const bool requested = m_RenderRequested;
+            m_RenderRequested = false;
+            return requested;
+        }
+
+        // The Profiler's scopes (see Profiler.h) in a window of their own:
+        // a tree of CPU and GPU mean / p95 / max, and the history of the
+        // selected scope. Non-virtual, so every test gets the same overlay;
+        // a test only adds PROFILE_SCOPEs where it wants more detail.
+        void RenderProfilerWindow(bool* open);
+
     protected:
         // Null unless InitDefaultScene() was called in the child's constructor.
         std::unique_ptr<DefaultScene> m_DefaultScene;
 
         // Call once in a child test's constructor to activate the default scene.
         void InitDefaultScene();
+
+    private:
+        bool m_RenderRequested = false;
     };
 
 
@@ -131,8 +175,38 @@ namespace test
          * - Reference semantics match the intent better
          */
         TestMenu(Tests*& currentTestPointer);
+        ~TestMenu() override;   // deletes the tests kept warm
 
         void RenderGUI() override;
+        bool IsAnimating() const override { return false; }   // buttons only
+
+        // =====================================================================
+        // PRELOADING AND KEEPING TESTS WARM
+        // =====================================================================
+        /**
+         * PreloadAll() queues every registered test's Preload() on the
+         * BackgroundLoader (see BackgroundLoader.h), in registration order.
+         * A test opts in by declaring
+         *
+         *     static void Preload();   // e.g. Shader::Prebuild of its files
+         *
+         * which runs on the loader's shared context, so it may only fill
+         * caches (ShaderCache, files) that the constructor later hits.
+         *
+         * Close() replaces `delete` for leaving a test. With SetKeepWarm(n)
+         * the n most recently closed tests stay alive instead, GPU
+         * resources and all (OnSuspend), and their button resumes them
+         * (OnResume) with no loading at all. The least recently used is deleted first.
+         */
+        void PreloadAll();
+        void Close(Tests* test);
+        void SetKeepWarm(unsigned int count);
+        unsigned int GetKeepWarm() const { return m_KeepWarm; }
+
+        // The registered tests by index, for BenchmarkRunner
+        std::size_t GetTestCount() const { return m_Tests.size(); }
+        const std::string& GetTestName(std::size_t index) const { return m_Tests[index].first; }
+        Tests* CreateTest(std::size_t index) const { return m_Tests[index].second(); }
 
         // =====================================================================
         // SIMPLE REGISTRATION (No Constructor Arguments)
@@ -164,6 +238,7 @@ namespace test
         void RegisterTest(const std::string& name)
         {
             m_Tests.push_back(std::make_pair(name, []() -> Tests* { return new T(); }));
+            m_Preloads.push_back(PreloadOf<T>());
         }
 
         // ADVANCED REGISTRATION (With Constructor Arguments)
@@ -270,9 +345,46 @@ namespace test
                             return new T(std::forward<decltype(unpackedArgs)>(unpackedArgs)...);
                         }, args);
                 }));
+            m_Preloads.push_back(PreloadOf<T>());
         }
 
     private:
+        // =====================================================================
+        // DETECTING AN OPTIONAL MEMBER (std::void_t)
+        // =====================================================================
+        /**
+         * HasPreload<T> is std::true_type if T::Preload() compiles and
+         * std::false_type otherwise, without any test having to declare
+         * anything when it has no Preload:
+         *
+         * - The primary template's second parameter defaults to void.
+         * - The specialisation is only viable if decltype(T::Preload()) is
+         *   a valid type; std::void_t<...> then turns it into void, so it
+         *   matches HasPreload<T, void> and wins as the more specialised.
+         * - If T has no Preload, the substitution fails. That is not an
+         *   error (SFINAE: "substitution failure is not an error"), the
+         *   specialisation just drops out and the primary is used.
+         *
+         * `if constexpr` then only compiles the T::Preload() call for
+         * tests that have one.
+         */
+        template<typename T, typename = void>
+        struct HasPreload : std::false_type {};
+
+        template<typename T>
+        struct HasPreload<T, std::void_t<decltype(T::Preload())>> : std::true_type {};
+
+        template<typename T>
+        static std::function<void()> PreloadOf()
+        {
+            if constexpr (HasPreload<T>::value)
+                return []() { T::Preload(); };
+            else
+                return nullptr;
+        }
+
+        enum class PreloadState { None, Queued, Done };
+
         /**
          * m_CurrentTest - Reference to external pointer that tracks active test
          * This reference allows TestMenu to change which test is currently running
@@ -298,5 +410,16 @@ namespace test
          * the ability to store heterogeneous callables in a single container.
          */
         std::vector<std::pair<std::string, std::function<Tests* ()>>> m_Tests;
+
+        // Per registered test, by index: its Preload (empty if none) and
+        // how far PreloadAll has got with it
+        std::vector<std::function<void()>> m_Preloads;
+        std::vector<PreloadState> m_PreloadStates;
+
+        // Closed tests kept alive, least recently used first, with the
+        // index of the entry that made them
+        std::vector<std::pair<std::size_t, Tests*>> m_Warm;
+        unsigned int m_KeepWarm = 3;
+        std::size_t m_OpenIndex = 0;   // entry behind the test open now
     };
 }
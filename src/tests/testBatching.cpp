@@ -1,111 +1,163 @@
 #include "testBatching.h"
+#include "../GLState.h"
+#include "../Input.h"
 #include "../Renderer.h"
 #include "../vendor/imgui/imgui.h"
 #include "glm/gtc/matrix_transform.hpp"
 
+#include <chrono>
+#include <cmath>
+#include <string>
+
 namespace test {
+    // A checkerboard in a colour of its own, so neighbouring quads visibly
+    // show different images
+    static std::vector<unsigned char> MakePattern(int index, int count, int width, int height) {
+        const float hue = 6.2831853f * index / count;
+        const glm::vec3 colour(0.5f + 0.5f * std::cos(hue), 0.5f + 0.5f * std::cos(hue - 2.0944f),
+            0.5f + 0.5f * std::cos(hue + 2.0944f));
+        const int cells = 2 + index % 4;
+
+        std::vector<unsigned char> pixels((size_t)width * height * 4);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const bool dark = ((x * cells / width) + (y * cells / height)) % 2 != 0;
+                const glm::vec3 texel = dark ? colour * 0.35f : colour;
+                unsigned char* out = &pixels[((size_t)y * width + x) * 4];
+                out[0] = (unsigned char)(texel.r * 255.0f);
+                out[1] = (unsigned char)(texel.g * 255.0f);
+                out[2] = (unsigned char)(texel.b * 255.0f);
+                out[3] = 255;
+            }
+        }
+        return pixels;
+    }
+
     TestBatching::TestBatching(GLFWwindow* window)
         : m_window(window),
         m_CameraPos(0.0f, 0.0f, 5.0f),
         m_CameraFront(0.0f, 0.0f, -1.0f),
         m_CameraUp(0.0f, 1.0f, 0.0f),
         m_CameraSpeed(2.5f),
+        m_Texturing(Texturing::Colour),
         m_GridSize(10),
-        m_Spacing(1.5f)
+        m_Spacing(1.5f),
+        m_Animate(false),
+        m_Time(0.0f),
+        m_BatchSize(QuadBatch::MAX_CAPACITY),
+        m_BenchmarkPending(false)
     {
-        // Generate a batch of quads arranged in a grid
-        std::vector<float> vertices;
-        std::vector<unsigned int> indices;
-        GenerateBatchData(vertices, indices);
-
-        m_VAO = std::make_unique<VertexArray>();
-        m_VBO = std::make_unique<VertexBuffer>(vertices.data(), vertices.size() * sizeof(float));
+        m_Batch = std::make_unique<QuadBatch>();
+        BuildTextures();
 
-        VertexBufferLayout layout;
-        layout.Push<float>(3); // Positions (x,y,z)
-        layout.Push<float>(3); // Colors   (r,g,b)
-        m_VAO->AddBuffer(*m_VBO, layout);
-
-        m_IBO = std::make_unique<IndexBuffer>(indices.data(), (unsigned int)indices.size());
-
-        m_Shader = std::make_unique<Shader>("res/Shaders/BatchShader.shader");
-        m_Shader->Bind();
-
-        glEnable(GL_DEPTH_TEST);
-
-        // Unbind everything to clean state
-        m_VAO->unBind();
-        m_VBO->Unbind();
-        m_IBO->Unbind();
-        m_Shader->Unbind();
+        GLState::Enable(GL_DEPTH_TEST);
     }
 
-    void TestBatching::GenerateBatchData(std::vector<float>& vertices, std::vector<unsigned int>& indices) {
-        // We will create a grid of quads. Each quad is made of two triangles.
-        // Each quad: 4 vertices and 6 indices.
-        // Vertex layout: pos(x,y,z), color(r,g,b)
+    void TestBatching::BuildTextures() {
+        // Same-sized images become layers of one array...
+        std::vector<std::vector<unsigned char>> patterns;
+        std::vector<const unsigned char*> layers;
+        for (int i = 0; i < IMAGE_COUNT; i++)
+            patterns.push_back(MakePattern(i, IMAGE_COUNT, 64, 64));
+        for (const std::vector<unsigned char>& pattern : patterns)
+            layers.push_back(pattern.data());
+        m_Array.Build(64, 64, layers);
+
+        // ...while images of varying sizes are packed into one atlas
+        for (int i = 0; i < IMAGE_COUNT; i++) {
+            const int width = 16 + 16 * (i % 5);
+            const int height = 16 + 24 * (i % 3);
+            m_Atlas.Add("pattern " + std::to_string(i), width, height, MakePattern(i, IMAGE_COUNT, width, height).data());
+        }
+        m_Atlas.Build();
 
-        // Size of each quad
-        float quadSize = 0.4f;
+        // Remap is linear in uv, so the corners give the whole region
+        for (int i = 0; i < IMAGE_COUNT; i++) {
+            m_AtlasMin[i] = m_Atlas.GetTexture() ? m_Atlas.Remap(i, glm::vec2(0.0f)) : glm::vec2(0.0f);
+            m_AtlasMax[i] = m_Atlas.GetTexture() ? m_Atlas.Remap(i, glm::vec2(1.0f)) : glm::vec2(1.0f);
+        }
+    }
 
-        // Well position quads in a grid, each quad spaced by m_Spacing.
-        // Origin (0,0,0), with quads distributed around the origin.
+    TestBatching::Texturing TestBatching::GetTexturing() const {
+        if (m_Texturing == Texturing::Array && !m_Array.IsValid())
+            return Texturing::Colour;
+        if (m_Texturing == Texturing::Atlas && !m_Atlas.GetTexture())
+            return Texturing::Colour;
+        return m_Texturing;
+    }
 
-        int quadCount = m_GridSize * m_GridSize;
-        vertices.reserve(quadCount * 4 * 6); // each vertex: 6 floats (pos+color)
-        indices.reserve(quadCount * 6);
+    void TestBatching::SubmitGrid(const glm::mat4& viewProjection) {
+        // Quads 0.8 across, spaced by m_Spacing around the origin, each
+        // showing one of the images as a layer or as an atlas region
+        const float quadSize = 0.8f;
+        const Texturing texturing = GetTexturing();
+        const glm::vec4 white(1.0f);
 
-        // Simple colour gradient
-        auto vertexIndex = 0u;
+        m_Batch->Begin(viewProjection);
         for (int y = 0; y < m_GridSize; y++) {
             for (int x = 0; x < m_GridSize; x++) {
-                float offsetX = (x - m_GridSize / 2) * m_Spacing;
-                float offsetY = (y - m_GridSize / 2) * m_Spacing;
-
-                // Quad vertices: positions + colours
-                // bottom-left
-                vertices.push_back(offsetX - quadSize); vertices.push_back(offsetY - quadSize); vertices.push_back(0.0f);
-                vertices.push_back((float)x / m_GridSize); vertices.push_back((float)y / m_GridSize); vertices.push_back(0.5f);
-
-                // bottom-right
-                vertices.push_back(offsetX + quadSize); vertices.push_back(offsetY - quadSize); vertices.push_back(0.0f);
-                vertices.push_back((float)x / m_GridSize); vertices.push_back((float)y / m_GridSize); vertices.push_back(1.0f);
-
-                // top-right
-                vertices.push_back(offsetX + quadSize); vertices.push_back(offsetY + quadSize); vertices.push_back(0.0f);
-                vertices.push_back((float)x / m_GridSize); vertices.push_back((float)y / m_GridSize); vertices.push_back(0.0f);
-
-                // top-left
-                vertices.push_back(offsetX - quadSize); vertices.push_back(offsetY + quadSize); vertices.push_back(0.0f);
-                vertices.push_back((float)x / m_GridSize); vertices.push_back((float)y / m_GridSize); vertices.push_back(0.7f);
-
-                // Indices for two triangles
-                // Using the vertexIndex as the base for this quad
-                indices.push_back(vertexIndex + 0);
-                indices.push_back(vertexIndex + 1);
-                indices.push_back(vertexIndex + 2);
-                indices.push_back(vertexIndex + 2);
-                indices.push_back(vertexIndex + 3);
-                indices.push_back(vertexIndex + 0);
-
-                vertexIndex += 4;
+                const glm::vec2 centre((x - m_GridSize / 2) * m_Spacing, (y - m_GridSize / 2) * m_Spacing);
+                const float z = m_Animate ? 0.25f * std::sin(m_Time * 2.0f + (x + y) * 0.3f) : 0.0f;
+                QuadBatch::Quad quad = QuadBatch::Quad::Rect(centre, glm::vec2(quadSize), z);
+                const int image = (x * 7 + y * 3) % IMAGE_COUNT;
+
+                if (texturing == Texturing::Array) {
+                    m_Batch->Submit(quad, white, m_Array, image);
+                }
+                else if (texturing == Texturing::Atlas) {
+                    quad.uvMin = m_AtlasMin[image];
+                    quad.uvMax = m_AtlasMax[image];
+                    m_Batch->Submit(quad, white, *m_Atlas.GetTexture());
+                }
+                else {
+                    // Simple colour gradient
+                    m_Batch->Submit(quad, glm::vec4((float)x / m_GridSize, (float)y / m_GridSize, 0.6f, 1.0f));
+                }
             }
         }
+        m_Batch->End();
+    }
+
+    void TestBatching::RunBenchmark(const glm::mat4& viewProjection) {
+        // The whole grid at each size, best of three, so a draw's cost shows
+        // as the batches shrink. glFinish on both sides: the time is the CPU
+        // submitting and the GPU drawing, nothing left over from before.
+        static const unsigned int sizes[] = { 64, 256, 1024, 4096, QuadBatch::MAX_CAPACITY };
+        m_Benchmark.clear();
+        for (unsigned int size : sizes) {
+            m_Batch->SetBatchSize(size);
+            BenchmarkResult result = { m_Batch->GetBatchSize(), 0, 0, 0.0f };
+            for (int run = 0; run < 3; run++) {
+                GlCall(glFinish());
+                const auto start = std::chrono::steady_clock::now();
+                SubmitGrid(viewProjection);
+                GlCall(glFinish());
+                const float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (run == 0 || ms < result.ms)
+                    result.ms = ms;
+                result.quads = m_Batch->GetStats().quads;
+                result.draws = m_Batch->GetStats().draws;
+            }
+            m_Benchmark.push_back(result);
+        }
+        m_Batch->SetBatchSize((unsigned int)m_BatchSize);
     }
 
     void TestBatching::ProcessInput() {
-        if (glfwGetKey(m_window, GLFW_KEY_W) == GLFW_PRESS)
+        if (Input::GetKey(m_window, GLFW_KEY_W) == GLFW_PRESS)
             m_CameraPos += m_CameraSpeed * m_CameraFront;
-        if (glfwGetKey(m_window, GLFW_KEY_S) == GLFW_PRESS)
+        if (Input::GetKey(m_window, GLFW_KEY_S) == GLFW_PRESS)
             m_CameraPos -= m_CameraSpeed * m_CameraFront;
-        if (glfwGetKey(m_window, GLFW_KEY_A) == GLFW_PRESS)
+        if (Input::GetKey(m_window, GLFW_KEY_A) == GLFW_PRESS)
             m_CameraPos -= glm::normalize(glm::cross(m_CameraFront, m_CameraUp)) * m_CameraSpeed;
-        if (glfwGetKey(m_window, GLFW_KEY_D) == GLFW_PRESS)
+        if (Input::GetKey(m_window, GLFW_KEY_D) == GLFW_PRESS)
             m_CameraPos += glm::normalize(glm::cross(m_CameraFront, m_CameraUp)) * m_CameraSpeed;
     }
 
     void TestBatching::Update(float deltaTime) {
         ProcessInput();
+        if (m_Animate)
+            m_Time += deltaTime;
     }
 
     void TestBatching::Render() {
@@ -113,42 +165,53 @@ namespace test {
         renderer.ClearColour_White();
         renderer.Clear();
 
-        m_Shader->Bind();
-        m_VAO->Bind();
-        m_IBO->Bind();
-
-        // Model matrix (no rotation for simplicity)
-        glm::mat4 model = glm::mat4(1.0f);
-
         // View and projection (similar to TestCamera)
         glm::mat4 view = glm::lookAt(m_CameraPos, m_CameraPos + m_CameraFront, m_CameraUp);
-        glm::mat4 projection = glm::perspective(glm::radians(15.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(15.0f), 800.0f / 600.0f, 0.1f, 10000.0f);
 
-        m_Shader->setUniformMat4f("model", model);
-        m_Shader->setUniformMat4f("view", view);
-        m_Shader->setUniformMat4f("projection", projection);
+        if (m_BenchmarkPending) {
+            m_BenchmarkPending = false;
+            RunBenchmark(projection * view);
+        }
 
-        // Draw all quads in one call
-        renderer.Draw(*m_VAO, *m_IBO, *m_Shader);
+        m_Batch->SetBatchSize((unsigned int)m_BatchSize);
+        SubmitGrid(projection * view);
+        m_BatchStats = m_Batch->GetStats();
     }
 
     void TestBatching::RenderGUI() {
         ImGui::Text("Batching Demo");
-        ImGui::SliderInt("Grid Size", &m_GridSize, 1, 50);
+        ImGui::SliderInt("Grid Size", &m_GridSize, 1, MAX_GRID_SIZE);
         ImGui::SliderFloat("Spacing", &m_Spacing, 0.5f, 5.0f);
         ImGui::SliderFloat("Camera Speed", &m_CameraSpeed, 0.1f, 10.0f);
         ImGui::Text("Camera Position: (%.1f, %.1f, %.1f)", m_CameraPos.x, m_CameraPos.y, m_CameraPos.z);
-        if (ImGui::Button("Regenerate")) {
-            std::vector<float> vertices;
-            std::vector<unsigned int> indices;
-            GenerateBatchData(vertices, indices);
-            m_VBO = std::make_unique<VertexBuffer>(vertices.data(), vertices.size() * sizeof(float));
-            VertexBufferLayout layout;
-            layout.Push<float>(3); // Positions (x,y,z)
-            layout.Push<float>(3); // Colors   (r,g,b)
-            m_VAO->AddBuffer(*m_VBO, layout);
-            m_IBO = std::make_unique<IndexBuffer>(indices.data(), (unsigned int)indices.size());
-
+        ImGui::Checkbox("Animate", &m_Animate);
+
+        int texturing = (int)m_Texturing;
+        if (ImGui::Combo("Texturing", &texturing, "Vertex colour\0Texture array\0Texture atlas\0"))
+            m_Texturing = (Texturing)texturing;
+        if (m_Array.IsValid())
+            ImGui::Text("Array: %d layers of %dx%d, %.1f KB", m_Array.GetLayerCount(), m_Array.GetWidth(),
+                m_Array.GetHeight(), m_Array.GetMemoryBytes() / 1024.0f);
+        if (m_Atlas.GetTexture())
+            ImGui::Text("Atlas: %dx%d, %.0f%% used, %.1f KB", m_Atlas.GetWidth(), m_Atlas.GetHeight(),
+                m_Atlas.GetOccupancy() * 100.0f, m_Atlas.GetTexture()->GetMemoryBytes() / 1024.0f);
+
+        ImGui::Separator();
+        ImGui::Text("Quad batch");
+        ImGui::SliderInt("Quads per batch", &m_BatchSize, 1, (int)m_Batch->GetCapacity());
+        ImGui::Text("%u quads, %u draws (%u full, %u for textures)", m_BatchStats.quads, m_BatchStats.draws,
+            m_BatchStats.fullFlushes, m_BatchStats.textureFlushes);
+        ImGui::Text("%s", m_Batch->IsPersistent() ? "Persistent map" : "glBufferSubData fallback");
+        ImGui::Text("Fence wait: %.3f ms (%u stalls)", m_BatchStats.fenceWaitMs, m_BatchStats.fenceStalls);
+
+        if (ImGui::Button("Benchmark batch sizes"))
+            m_BenchmarkPending = true;
+        for (const BenchmarkResult& result : m_Benchmark) {
+            const float seconds = result.ms / 1000.0f;
+            ImGui::Text("%5u a batch: %5u draws, %7.2f ms, %.0f draws/s, %.1f M quads/s", result.batchSize,
+                result.draws, result.ms, seconds > 0.0f ? result.draws / seconds : 0.0f,
+                seconds > 0.0f ? result.quads / seconds / 1.0e6f : 0.0f);
         }
     }
 }
@@ -1,11 +1,10 @@
 #pragma once
 #include "Tests.h"
-#include "../VertexBuffer.h"
-#include "../VertexBufferLayout.h"
-#include "../IndexBuffer.h"
-#include "../VertexArray.h"
-#include "../Shader.h"
+#include "../QuadBatch.h"
+#include "../TextureArray.h"
+#include "../TextureAtlas.h"
 #include <memory>
+#include <vector>
 #include "GL/glew.h"
 #include <GLFW/glfw3.h>
 #include "glm/glm.hpp"
@@ -29,18 +28,47 @@ namespace test {
         glm::vec3 m_CameraUp;
         float m_CameraSpeed;
 
-        // Batching resources
-        std::unique_ptr<VertexArray> m_VAO;
-        std::unique_ptr<VertexBuffer> m_VBO;
-        std::unique_ptr<IndexBuffer> m_IBO;
-        std::unique_ptr<Shader> m_Shader;
+        // The grid is submitted to the QuadBatch every frame, so nothing is
+        // regenerated when a setting changes: up to a million quads, a few
+        // dozen draws.
+        static const int MAX_GRID_SIZE = 1000;
+        std::unique_ptr<QuadBatch> m_Batch;
+        QuadBatch::Stats m_BatchStats;   // the last frame's
+
+        // Textured batches: every quad shows one of IMAGE_COUNT images, yet
+        // each batch stays one draw, through either a TextureArray layer or a
+        // TextureAtlas region.
+        enum class Texturing { Colour, Array, Atlas };
+        static const int IMAGE_COUNT = 16;
+        TextureArray m_Array;
+        TextureAtlas m_Atlas;
+        glm::vec2 m_AtlasMin[IMAGE_COUNT];   // each image's region
+        glm::vec2 m_AtlasMax[IMAGE_COUNT];
+        Texturing m_Texturing;
 
         // Configuration
         int m_GridSize;
         float m_Spacing;
+        bool m_Animate;
+        float m_Time;
+        int m_BatchSize;
+
+        // Draws/sec against quads per batch: the same grid drawn once for
+        // each size, between glFinish calls, from the next Render
+        struct BenchmarkResult {
+            unsigned int batchSize;
+            unsigned int quads;
+            unsigned int draws;
+            float ms;
+        };
+        bool m_BenchmarkPending;
+        std::vector<BenchmarkResult> m_Benchmark;
 
         // Helper methods
-        void GenerateBatchData(std::vector<float>& vertices, std::vector<unsigned int>& indices);
+        void BuildTextures();
+        Texturing GetTexturing() const;   // m_Texturing, Colour if its texture failed to build
+        void SubmitGrid(const glm::mat4& viewProjection);
+        void RunBenchmark(const glm::mat4& viewProjection);
         void ProcessInput();
     };
 }
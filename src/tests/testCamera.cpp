@@ -1,4 +1,5 @@
 #include "testCamera.h"
+#include "../GLState.h"
 #include "../Renderer.h"
 #include "../vendor/imgui/imgui.h"
 #include <GL/glew.h>
@@ -26,7 +27,7 @@ namespace test {
         m_Shader = std::make_unique<Shader>(R"(res/Shaders/ProjectionsShader.shader)");
 
         // Enable depth testing
-        glEnable(GL_DEPTH_TEST);
+        GLState::Enable(GL_DEPTH_TEST);
 		InitDefaultScene();
     }
 
@@ -1,5 +1,6 @@
 #include "testClearColour.h"
 #include "../Renderer.h"
+#include "../GLState.h"
 #include "../vendor/imgui/imgui.h"     // Dear ImGui library for GUI elements
 
 namespace test
@@ -18,7 +19,7 @@ namespace test
 
 	void test::testClearColour::Render()
 	{
-		GlCall(glClearColor(m_ClearColour[0], m_ClearColour[1], m_ClearColour[2], m_ClearColour[3]));
+		GLState::ClearColor(m_ClearColour[0], m_ClearColour[1], m_ClearColour[2], m_ClearColour[3]);
 		GlCall(glClear(GL_COLOR_BUFFER_BIT));
 	}
 
@@ -12,6 +12,7 @@ namespace test
 		void Update(float deltaTime) override;
 		void Render() override;
 		void RenderGUI() override;
+		bool IsAnimating() const override { return false; }
 	private:
 		float m_ClearColour[4];
 	};
@@ -1,67 +1,172 @@
 ﻿#include "testEffects.h"
 #include "imgui.h"
+#include "../TextureCache.h"
+#include "../FrameUniforms.h"
+#include "../ShaderLibrary.h"
+#include "../GLState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include "glm/gtc/matrix_transform.hpp"
 
 test::testEffects::testEffects(GLFWwindow* window)
+	: m_Window(window)
 {
-	m_Shader = std::make_unique<Shader>("res/shaders/effects/effect.shader");
-
-	m_Quad = GeometryFactory::CreateFullscreenQuad();
+	m_Camera = std::make_unique<Camera>(
+		window,
+		glm::vec3(0.0f, 2.0f, 6.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		-90.0f,
+		-15.0f,
+		45.0f
+	);
 
-	m_Texture = std::make_unique<Texture>("res/Textures/1.png");
+	m_SceneShader = ShaderLibrary::Get("res/Shaders/Mesh.shader");
+	m_PresentShader = std::make_unique<Shader>("res/Shaders/Effects/Present.shader");
 
-	m_Shader->Bind();
-	m_Shader->setUniform1i("u_Texture", 0); //texture unit 0
-	m_Shader->setUniform2f("u_Texel", m_Texture->getTexelSize().x, m_Texture->getTexelSize().y);
-	m_Shader->setUniform1i("u_Effect", m_Effect);
-	m_Shader->setUniform1f("u_Opacity", m_Opacity);
+	m_Cube = GeometryFactory::CreateCube();
+	m_Quad = GeometryFactory::CreateFullscreenQuad();
 
-	m_Shader->Unbind();
+	m_Texture = TextureCache::Get().Load("res/Textures/1.png"); // shared with testTexture2D
 	m_Texture->Unbind();
 
+	InitDefaultScene();
+
+	// A blur first, so stacking a second stage shows straight away
+	m_Stages[0].effect = PostProcessChain::Effect::Blur;
 }
 
 void test::testEffects::Update(float deltaTime)
 {
+	m_Camera->processInput(deltaTime);
+	m_Camera->Update(deltaTime);
+	m_Time += deltaTime;
 }
 
 void test::testEffects::Render()
 {
-	
-	Renderer renderer;
-	renderer.Clear();
-
-	m_Shader->Bind();
-	m_Texture->Bind();
-	m_Shader->setUniform1i("u_Effect", m_Effect);
-	m_Shader->setUniform1f("u_Opacity", m_Opacity);
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(m_Window, &width, &height);
+	if (width <= 0 || height <= 0)
+		return;
+
+	if (!m_SceneFBO || m_SceneFBO->GetWidth() != width || m_SceneFBO->GetHeight() != height)
+		m_SceneFBO = std::make_unique<Framebuffer>(width, height);
+	DrawScene(width, height);
+
+	// Stage targets match the scene: the Framebuffer's colour format
+	RenderGraph::TextureDesc stageDesc;
+	stageDesc.width = width;
+	stageDesc.height = height;
+	stageDesc.format = GL_RGBA8;
+
+	m_Chain.GetStages().assign(m_Stages, m_Stages + m_StageCount);
+
+	m_Graph.Reset();
+	const RenderGraph::Resource scene = m_Graph.ImportTexture("Scene colour", m_SceneFBO->GetColorTexture(), width, height);
+	const std::vector<RenderGraph::Resource> outputs = m_Chain.AddToGraph(m_Graph, scene, stageDesc);
+	const RenderGraph::Resource shown = outputs.empty() ? scene : outputs[m_OutputStage - 1];
+
+	const RenderGraph::Resource screen = m_Graph.ImportBackbuffer(width, height);
+	const RenderGraph::Pass present = m_Graph.AddPass("Present", [this, shown](const RenderGraph::PassContext& context)
+		{
+			DrawPresent(context.GetTexture(shown));
+		});
+	m_Graph.Read(present, shown);
+	// The quad covers every pixel, so the screen is never cleared
+	m_Graph.Write(present, screen, RenderGraph::LoadOp::DontCare);
+
+	m_Graph.Execute();
+}
+
+void test::testEffects::DrawScene(int width, int height)
+{
+	const glm::mat4 view = m_Camera->getViewMatrix();
+	const glm::mat4 projection = glm::perspective(glm::radians(m_Camera->getFOV()), static_cast<float>(width) / height, 0.1f, 100.0f);
+
+	m_SceneFBO->Bind();
+	GLState::Enable(GL_DEPTH_TEST);
+	m_DefaultScene->Render(view, projection);
+	FrameUniforms::SetCamera(view, projection, m_Camera->getPosition());
+
+	// A ring of spinning textured cubes: edges and bright texels for the
+	// effects to work on
+	m_SceneShader->Bind();
+	m_Texture->Bind(0);
+	m_SceneShader->setUniform1i("texture_diffuse1", 0);
+	m_SceneShader->setUniform1i("u_UseDiffuseTexture", 1);
+	m_SceneShader->setUniform1i("u_UseSpecularTexture", 0);
+	m_SceneShader->setUniform3f("u_LightPos", 4.0f, 6.0f, 4.0f);
+	m_SceneShader->setUniform3f("u_LightColor", 1.0f, 1.0f, 1.0f);
+	m_SceneShader->setUniform1f("u_AmbientStrength", 0.25f);
+	m_SceneShader->setUniform1f("u_SpecularStrength", 0.5f);
+	m_SceneShader->setUniform1f("u_Shininess", 32.0f);
+	for (int i = 0; i < 6; i++)
+	{
+		const float angle = glm::radians(60.0f * i);
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(3.0f * std::cos(angle), 0.75f, 3.0f * std::sin(angle)));
+		model = glm::rotate(model, m_Time + i, glm::vec3(0.5f, 1.0f, 0.0f));
+		m_SceneShader->setUniformMat4f("u_Model", model);
+		m_Cube->Draw();
+	}
+	m_SceneFBO->Unbind();
+}
+
+void test::testEffects::DrawPresent(unsigned int texture)
+{
+	GLState::Disable(GL_DEPTH_TEST);
+	m_PresentShader->Bind();
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D, texture);
+	m_PresentShader->setUniform1i("u_Texture", 0); //texture unit 0
 	m_Quad->Draw();
-	m_Shader->Unbind();
-	m_Texture->Unbind();
+	m_PresentShader->Unbind();
+	GLState::BindTextureToUnit(0, GL_TEXTURE_2D, 0);
+	GLState::Enable(GL_DEPTH_TEST);
 }
 
 void test::testEffects::RenderGUI()
 {
-	ImGui::Text("Select post processing effect");
+	ImGui::Text("Post processing chain");
 
-	const char* effects[]
-		=
+	const char* effects[static_cast<int>(PostProcessChain::Effect::Count)];
+	for (int effect = 0; effect < IM_ARRAYSIZE(effects); effect++)
+		effects[effect] = PostProcessChain::GetEffectName(static_cast<PostProcessChain::Effect>(effect));
+
+	ImGui::SliderInt("Stages", &m_StageCount, 0, MAX_STAGES);
+	for (int stage = 0; stage < m_StageCount; stage++)
+	{
+		PostProcessChain::Stage& settings = m_Stages[stage];
+		ImGui::PushID(stage);
+		int effect = static_cast<int>(settings.effect);
+		if (ImGui::Combo(stage == 0 ? "Effect" : "Then", &effect, effects, IM_ARRAYSIZE(effects)))
+			settings.effect = static_cast<PostProcessChain::Effect>(effect);
+		//opacity slider (0 will be no effect applied and 1 will be full effect)
+		ImGui::SliderFloat("Opacity", &settings.opacity, 0.0f, 1.0f);
+		if (settings.effect == PostProcessChain::Effect::Blur)
+			ImGui::SliderInt("Blur radius", &settings.radius, 1, PostProcessChain::MAX_BLUR_RADIUS);
+		if (settings.effect == PostProcessChain::Effect::Bloom)
+		{
+			ImGui::SliderFloat("Threshold", &settings.threshold, 0.0f, 1.0f);
+			ImGui::SliderFloat("Knee", &settings.knee, 0.0f, 1.0f);
+			ImGui::SliderFloat("Intensity", &settings.intensity, 0.0f, 2.0f);
+			ImGui::SliderInt("Pyramid levels", &settings.levels, 1, PostProcessChain::MAX_BLOOM_LEVELS);
+		}
+		ImGui::PopID();
+	}
+	if (m_StageCount > 0)
 	{
-		"None",
-		"Edge detection",
-		"Colour inversion",
-		"Blur",
-		"Sharpen",
-		"Bloom",
-		"Greyscale",
-		"Venuezela",
-		"Romania",
-		"middle box"
-	};
-
-	ImGui::Combo("Effects", &m_Effect, effects, IM_ARRAYSIZE(effects));
-
-	//opacity slider (0 will be no effect applied and 1 will be full effect)
-	ImGui::SliderFloat("Opacity", &m_Opacity, 0.0, 1.0);
+		m_OutputStage = std::min(std::max(m_OutputStage, 1), m_StageCount);
+		ImGui::SliderInt("Output stage", &m_OutputStage, 1, m_StageCount);
+	}
+
+	ImGui::Separator();
+	const RenderGraph::Stats& stats = m_Graph.GetStats();
+	for (const RenderGraph::PassInfo& pass : m_Graph.GetPassInfo())
+		ImGui::BulletText("%s%s", pass.name.c_str(), pass.culled ? " (culled)" : "");
+	ImGui::Text("Stage targets: %u requested, %u textures", stats.transients, stats.textures);
+	ImGui::Text("VRAM saved by aliasing: %.2f MB of %.2f MB", m_Graph.GetSavedBytes() / (1024.0f * 1024.0f),
+		stats.requestedBytes / (1024.0f * 1024.0f));
 
 
 }
@@ -7,6 +7,10 @@
 #include "../Mesh/GeometryFactory.h"
 #include "../Texture.h"
 #include "../Shader.h"
+#include "../Framebuffer.h"
+#include "../RenderGraph.h"
+#include "../PostProcessChain.h"
+#include "../utils/Camera.h"
 
 
 namespace test
@@ -21,15 +25,34 @@ namespace test
 		void RenderGUI();
 
 	private:
-		GLFWwindow* m_Window;
+		static const int MAX_STAGES = 4;
 
-		std::unique_ptr<Mesh> m_Quad;
-		std::unique_ptr<Texture> m_Texture;
-		std::unique_ptr<Shader> m_Shader;
+		// The scene the effects run over, drawn into m_SceneFBO
+		void DrawScene(int width, int height);
+		void DrawPresent(unsigned int texture);
 
+		GLFWwindow* m_Window;
 
-		int m_Effect = 0; //selected effect
-		float m_Opacity = 1.0f; 
+		std::unique_ptr<Camera> m_Camera;
+		std::unique_ptr<Mesh> m_Cube;
+		std::unique_ptr<Mesh> m_Quad;
+		std::shared_ptr<Texture> m_Texture;
+		std::shared_ptr<Shader> m_SceneShader;
+		std::unique_ptr<Shader> m_PresentShader;
+		std::unique_ptr<Framebuffer> m_SceneFBO; // recreated when the window resizes
+		float m_Time = 0.0f;
+
+
+		// Effects applied in turn, each stage reading the one before (see
+		// PostProcessChain.h). Every stage is a render graph pass into a
+		// transient screen-sized target, so the chain needs only a
+		// ping-pong pair of textures however many stages there are.
+		PostProcessChain m_Chain;
+		PostProcessChain::Stage m_Stages[MAX_STAGES]; //settings per stage, the first m_StageCount in use
+		int m_StageCount = 1;
+		int m_OutputStage = 1; //stage shown on screen; later ones are culled
+
+		RenderGraph m_Graph;
 
 	};
 }
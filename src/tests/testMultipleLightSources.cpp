@@ -1,6 +1,11 @@
 #include "testMultipleLightSources.h"
+#include "../GLState.h"
+#include "../FrameUniforms.h"
+#include "../ShaderLibrary.h"
+#include "../Profiler.h"
 
 #include <glm/gtc/type_ptr.inl>
+#include <cstdlib>
 
 #include "../vendor/imgui/imgui.h"
 
@@ -21,11 +26,19 @@ test::testMultipleLightSources::testMultipleLightSources(GLFWwindow* window) :
         45.0f                          // FOV
     );
 
-    m_Shader = std::make_unique<Shader>("res/shaders/Lighting/PhongMultiple.shader");
+    m_Shader = ShaderLibrary::Get("res/shaders/Lighting/PhongMultiple.shader");
+    m_Shader->CompileAllVariants();
+    m_Deferred = std::make_unique<DeferredShading>();
+    m_Clusters = std::make_unique<ClusteredLights>();
+    m_BlinnPhongShader = ShaderLibrary::Get("res/shaders/Lighting/Blinn-Phong.shader");
+    m_PBRShader = ShaderLibrary::Get("res/shaders/Lighting/PBR.shader");
 
-    m_Sphere = GeometryFactory::CreateSphere(20, 20);
+    // As round as a 20 x 20 UV sphere, in fewer triangles
+    m_Sphere = GeometryFactory::CreateGeodesicSphere(
+        GeometryFactory::SelectGeodesicSphere(GeometryFactory::GetUVSphereError(20, 20)));
 
-    glEnable(GL_DEPTH_TEST);
+    GLState::Enable(GL_DEPTH_TEST);
+    m_Queue.SetCountFragments(true);
 }
 
 void test::testMultipleLightSources::Update(float deltaTime)
@@ -46,43 +59,233 @@ void test::testMultipleLightSources::Render()
     Renderer renderer;
     renderer.Clear();
 
+    // Camera matrices and position through the FrameData uniform block
+    FrameUniforms::SetCamera(m_View, m_Projection, m_Camera->getPosition());
+
+    // Only lights edited since last frame are sent; the shader reads the
+    // whole list from the storage buffer, so there are no per-light uniforms.
+    m_LightList.Upload();
+    GatherSpheres();
+
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(m_Window, &width, &height);
+
+    if (m_Path == DEFERRED)
+    {
+        // The light loop runs once per covered pixel, in the lighting pass
+        PROFILE_SCOPE("Deferred");
+        {
+            PROFILE_SCOPE("G-buffer");
+            m_Deferred->BeginGeometryPass(width, height);
+            DrawSpheres(m_Deferred->GetGeometryShader());
+            m_Deferred->EndGeometryPass();
+        }
+        {
+            PROFILE_SCOPE("Lighting");
+            m_Deferred->LightingPass(m_LightList, m_View, m_Projection, width, height,
+                static_cast<DeferredShading::Output>(m_DeferredOutput));
+        }
+        GLState::Enable(GL_DEPTH_TEST);
+        return;
+    }
+
+    if (m_Path == CLUSTERED)
+    {
+        // The light loop runs in every fragment, over its cluster's lights
+        PROFILE_SCOPE("Clustered");
+        {
+            PROFILE_SCOPE("Light binning");
+            m_Clusters->Build(m_LightList, m_View, m_Projection, 0.1f, 50.0f, width, height);
+        }
+        {
+            PROFILE_SCOPE("Clustered shading");
+            Shader& shader = GetClusteredShader();
+            m_LightList.Bind();
+            shader.Bind();
+            m_Clusters->Apply(shader);
+            DrawSpheres(shader, static_cast<ShadingModel>(m_ClusteredModel), m_DepthPrepass);
+        }
+        return;
+    }
+
+    // The light loop runs in every fragment rasterised
+    PROFILE_SCOPE("Forward");
+    m_LightList.Bind();
     m_Shader->Bind();
+    m_Shader->setUniform1i("uLightCount", static_cast<int>(m_LightList.GetCount()));
+    DrawSpheres(*m_Shader, ShadingModel::Phong, m_DepthPrepass);
+}
 
-    m_Shader->setUniformMat4f("u_Model", m_Model);
-    m_Shader->setUniformMat4f("u_View", m_View);
-    m_Shader->setUniformMat4f("u_Projection", m_Projection);
-
-    glm::vec3 camPos = m_Camera->getPosition();
-    m_Shader->setUniform3f("uCameraPosition", camPos.x, camPos.y, camPos.z);
-
-    m_Shader->setUniform1f("uAmbientIntensity", m_AmbientIntensity);
-    m_Shader->setUniform1f("uDiffuseIntensity", m_DiffuseIntensity);
-    m_Shader->setUniform1f("uSpecularIntensity", m_SpecularIntensity);
-    m_Shader->setUniform1f("uShininess", m_Shininess);
-
-    m_Shader->setUniform1i("uLightCount", static_cast<int>(m_Lights.size()));
-    for (size_t i = 0; i < m_Lights.size(); ++i) {
-        const auto& light = m_Lights[i];
-        std::string prefix = "uLights[" + std::to_string(i) + "]";
-        m_Shader->setUniform3f(prefix + ".position", light.position.x, light.position.y, light.position.z);
-        m_Shader->setUniform3f(prefix + ".direction", light.direction.x, light.direction.y, light.direction.z);
-        m_Shader->setUniform3f(prefix + ".colour", light.colour.r, light.colour.g, light.colour.b);
-        m_Shader->setUniform1f(prefix + ".intensity", light.intensity);
-        m_Shader->setUniform1i(prefix + ".type", static_cast<int>(light.type));
-        m_Shader->setUniform1f(prefix + ".cutoff", light.cutoff);
+void test::testMultipleLightSources::GatherSpheres()
+{
+    m_Spheres.clear();
+    if (!m_SphereField) {
+        m_Spheres.push_back({ m_Model, glm::vec3(1.0f) });
+        return;
     }
 
-    m_Sphere->setPosition(glm::vec3(0, 0, 0));
-    m_Sphere->Draw();
+    // 4 layers of 8 x 8, spaced closer than their size so each layer
+    // covers the gaps in the one behind
+    const int size = 8, layers = 4;
+    const float spacing = 0.8f;
+    for (int z = 0; z < layers; ++z) {
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                glm::vec3 position((x - (size - 1) * 0.5f) * spacing, (y - (size - 1) * 0.5f) * spacing,
+                    -1.5f * (layers - 1 - z));
+                glm::vec3 albedo(0.5f + 0.5f * x / (size - 1), 0.5f + 0.5f * y / (size - 1), 0.5f + 0.5f * z / (layers - 1));
+                m_Spheres.push_back({ glm::translate(glm::mat4(1.0f), position) * m_Model, albedo });
+            }
+        }
+    }
+}
+
+Shader& test::testMultipleLightSources::GetClusteredShader()
+{
+    const char* lights = m_ClusterHeatmap ? "CLUSTER_HEATMAP" : "CLUSTERED";
+    switch (static_cast<ShadingModel>(m_ClusteredModel)) {
+    case ShadingModel::BlinnPhong: return m_BlinnPhongShader->Variant("LIGHTS", lights);
+    case ShadingModel::PBR:        return m_PBRShader->Variant("LIGHTS", lights);
+    default:                       return m_Shader->Variant("LIGHTS", lights);
+    }
+}
+
+void test::testMultipleLightSources::DrawSpheres(Shader& shader, ShadingModel model, bool prepass)
+{
+    shader.Bind();
+    if (model == ShadingModel::Phong) {
+        shader.setUniform1f("uAmbientIntensity", m_AmbientIntensity);
+        shader.setUniform1f("uDiffuseIntensity", m_DiffuseIntensity);
+        shader.setUniform1f("uSpecularIntensity", m_SpecularIntensity);
+        shader.setUniform1f("uShininess", m_Shininess);
+    }
+    else if (model == ShadingModel::BlinnPhong) {
+        shader.setUniform1f("u_AmbientIntensity", m_AmbientIntensity);
+        shader.setUniform1f("u_DiffuseIntensity", m_DiffuseIntensity);
+        shader.setUniform1f("u_SpecularIntensity", m_SpecularIntensity);
+        shader.setUniform1f("u_Shininess", m_Shininess);
+    }
+    else {
+        shader.setUniform1f("u_Metallic", 0.0f);
+        shader.setUniform1f("u_Roughness", 0.4f);
+        shader.setUniform1f("u_AO", 1.0f);
+    }
+
+    // Blinn-Phong has no albedo of its own
+    const char* albedo = model == ShadingModel::Phong ? "uAlbedo" : model == ShadingModel::PBR ? "u_Albedo" : nullptr;
+    const MeshArena::Range& range = m_Sphere->getArenaRange();
+    m_Queue.Clear();
+    for (const SphereInstance& sphere : m_Spheres) {
+        RenderCommand cmd;
+        cmd.shader = &shader;
+        cmd.vao = m_Sphere->getVertexArray();
+        cmd.ibo = m_Sphere->getIndexBuffer();
+        cmd.indexCount = range.indexCount;
+        cmd.firstIndex = range.firstIndex;
+        cmd.baseVertex = range.baseVertex;
+        cmd.model = sphere.model;
+        cmd.colour = glm::vec4(sphere.albedo, 1.0f);
+        cmd.colourUniform = albedo;
+        // View depth over the clustered path's far plane, for the front-to-back sort
+        float viewZ = (m_View * sphere.model[3]).z;
+        m_Queue.Submit(RenderPass::Opaque, cmd, glm::clamp(-viewZ / 50.0f, 0.0f, 1.0f));
+    }
+    m_Queue.SetDepthPrepass(prepass);
+    m_Queue.FlushPass(RenderPass::Opaque);
+}
+
+GPULight test::testMultipleLightSources::ToGPU(const Light& light)
+{
+    GPULight gpu;
+    gpu.position = glm::vec4(light.position, static_cast<float>(light.type));
+    gpu.direction = glm::vec4(light.direction, light.cutoff);
+    gpu.colour = glm::vec4(light.colour, light.intensity);
+    gpu.range = glm::vec4(light.range, 0.0f, 0.0f, 0.0f);
+    return gpu;
+}
+
+void test::testMultipleLightSources::AddLight(const Light& light)
+{
+    m_Lights.push_back(light);
+    m_LightList.Add(ToGPU(light));
 }
 
 void test::testMultipleLightSources::RenderGUI()
 {
+    ImGui::Text("Shading Path");
+    const char* paths[] = { "Forward", "Deferred", "Clustered forward" };
+    ImGui::Combo("Path", &m_Path, paths, IM_ARRAYSIZE(paths));
+    ImGui::Checkbox("Sphere field (256, overlapping)", &m_SphereField);
+    if (m_Path == CLUSTERED) {
+        const char* models[] = { "Phong", "Blinn-Phong", "PBR" };
+        ImGui::Combo("Shading Model", &m_ClusteredModel, models, IM_ARRAYSIZE(models));
+        // Blue: few lights in the fragment's cluster, red: many, magenta: full
+        ImGui::Checkbox("Cluster occupancy heatmap", &m_ClusterHeatmap);
+        ImGui::Text("%u x %u x %u clusters, up to %u lights each (%.1f MB)", ClusteredLights::GRID_X, ClusteredLights::GRID_Y,
+            ClusteredLights::GRID_Z, ClusteredLights::CAPACITY, ClusteredLights::GetBufferSize() / (1024.0f * 1024.0f));
+    }
+    if (m_Path == DEFERRED) {
+        const char* outputs[] = { "Lit", "Albedo", "Normal", "Position" };
+        ImGui::Combo("G-buffer View", &m_DeferredOutput, outputs, IM_ARRAYSIZE(outputs));
+        ImGui::Text("G-buffer: %d x %d, %.1f MB", m_Deferred->GetWidth(), m_Deferred->GetHeight(),
+            m_Deferred->GetWidth() * m_Deferred->GetHeight() * DeferredShading::BYTES_PER_PIXEL / (1024.0f * 1024.0f));
+    }
+    else {
+        // Overdraw: fragments run through the light loop per covered pixel
+        ImGui::Checkbox("Depth pre-pass", &m_DepthPrepass);
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(m_Window, &width, &height);
+        const RenderQueue::FragmentStats& fragments = m_Queue.GetFragmentStats();
+        const double pixels = std::max(1.0, static_cast<double>(width) * height);
+        ImGui::Text("Fragments shaded: %.2f M (%.2f per pixel)", fragments.shadedFragments / 1e6,
+            fragments.shadedFragments / pixels);
+        if (fragments.prepass) {
+            ImGui::Text("Pre-pass: %.2f M fragments, %.2f ms depth + %.2f ms shading", fragments.prepassFragments / 1e6,
+                Profiler::GetGpuMs("Depth pre-pass"), Profiler::GetGpuMs("Shading"));
+        }
+    }
+
+    // Each path's GPU time, smoothed; switch with the same lights to compare
+    if (m_Path == DEFERRED)
+        m_DeferredMs += (Profiler::GetGpuMs("Deferred") - m_DeferredMs) * 0.05f;
+    else if (m_Path == CLUSTERED)
+        m_ClusteredMs += (Profiler::GetGpuMs("Clustered") - m_ClusteredMs) * 0.05f;
+    else
+        m_ForwardMs += (Profiler::GetGpuMs("Forward") - m_ForwardMs) * 0.05f;
+    ImGui::Text("GPU: forward %.2f ms, deferred %.2f ms (G-buffer %.2f + lighting %.2f)", m_ForwardMs, m_DeferredMs,
+        Profiler::GetGpuMs("G-buffer"), Profiler::GetGpuMs("Lighting"));
+    ImGui::Text("     clustered %.2f ms (binning %.2f + shading %.2f)", m_ClusteredMs,
+        Profiler::GetGpuMs("Light binning"), Profiler::GetGpuMs("Clustered shading"));
+
+    ImGui::Separator();
     ImGui::Text("Light Controls");
     if (ImGui::Button("Add Light")) {
-        m_Lights.push_back({ LightType::Point, glm::vec3(10.0f, 15.0f, 25.0f), glm::vec3(0.0f, -1.0f, 0.0f),
-                             glm::vec3(1.0f), 1.0f, glm::cos(glm::radians(12.5f)) });
+        AddLight({ LightType::Point, glm::vec3(10.0f, 15.0f, 25.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+                   glm::vec3(1.0f), 1.0f, glm::cos(glm::radians(12.5f)) });
     }
+    ImGui::SameLine();
+    // Far beyond the old fixed uniform array of 16
+    if (ImGui::Button("Scatter Lights")) {
+        for (int i = 0; i < m_ScatterCount; ++i) {
+            glm::vec3 dir(rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f);
+            glm::vec3 colour(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX);
+            if (m_ScatterRange > 0.0f) {
+                // Bounded lights through the sphere field's volume, each
+                // reaching only its neighbours
+                AddLight({ LightType::Point, dir * glm::vec3(8.0f, 8.0f, 8.0f) + glm::vec3(0.0f, 0.0f, -2.0f),
+                           glm::vec3(0.0f, -1.0f, 0.0f), colour, 0.5f, glm::cos(glm::radians(12.5f)), m_ScatterRange });
+            }
+            else {
+                AddLight({ LightType::Point, glm::normalize(dir + glm::vec3(0.001f)) * 10.0f, glm::vec3(0.0f, -1.0f, 0.0f),
+                           colour, 2.0f / m_ScatterCount, glm::cos(glm::radians(12.5f)) });
+            }
+        }
+    }
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::SliderInt("##ScatterCount", &m_ScatterCount, 10, 1000);
+    ImGui::SliderFloat("Scatter Range (0 = unbounded)", &m_ScatterRange, 0.0f, 5.0f);
+    ImGui::Text("Lights: %u (uploaded %u bytes last change)", m_LightList.GetCount(), m_LightList.GetStats().bytesLastUpload);
 
     if (!m_Lights.empty()) {
         ImGui::SliderInt("Selected Light", &m_SelectedLightIndex, 0, static_cast<int>(m_Lights.size()) - 1);
@@ -90,24 +293,41 @@ void test::testMultipleLightSources::RenderGUI()
 
         const char* types[] = { "Point", "Directional", "Spot" };
         int type = static_cast<int>(light.type);
+        bool changed = false;
         if (ImGui::Combo("Type", &type, types, IM_ARRAYSIZE(types))) {
             light.type = static_cast<LightType>(type);
+            changed = true;
         }
 
-        ImGui::ColorEdit3("Colour", glm::value_ptr(light.colour));
-        ImGui::SliderFloat3("Position", glm::value_ptr(light.position), -20.0f, 20.0f);
+        changed |= ImGui::ColorEdit3("Colour", glm::value_ptr(light.colour));
+        changed |= ImGui::SliderFloat3("Position", glm::value_ptr(light.position), -20.0f, 20.0f);
         if (light.type != LightType::Point) {
-            ImGui::SliderFloat3("Direction", glm::value_ptr(light.direction), -1.0f, 1.0f);
+            changed |= ImGui::SliderFloat3("Direction", glm::value_ptr(light.direction), -1.0f, 1.0f);
+        }
+        changed |= ImGui::SliderFloat("Intensity", &light.intensity, 0.0f, 5.0f);
+        if (light.type != LightType::Directional) {
+            changed |= ImGui::SliderFloat("Range (0 = unbounded)", &light.range, 0.0f, 20.0f);
         }
-        ImGui::SliderFloat("Intensity", &light.intensity, 0.0f, 5.0f);
         if (light.type == LightType::Spot) {
-            ImGui::SliderFloat("Cutoff Angle", &light.cutoff, 0.0f, 1.0f);
+            changed |= ImGui::SliderFloat("Cutoff Angle", &light.cutoff, 0.0f, 1.0f);
+        }
+
+        // Only this light's 64 bytes go to the GPU next frame
+        if (changed) {
+            m_LightList.Set(m_SelectedLightIndex, ToGPU(light));
         }
 
         if (ImGui::Button("Remove Light")) {
             m_Lights.erase(m_Lights.begin() + m_SelectedLightIndex);
+            m_LightList.Remove(m_SelectedLightIndex);
             m_SelectedLightIndex = std::max(0, m_SelectedLightIndex - 1);
         }
+        ImGui::SameLine();
+        if (ImGui::Button("Remove All")) {
+            m_Lights.clear();
+            m_LightList.Clear();
+            m_SelectedLightIndex = 0;
+        }
     }
 }
 
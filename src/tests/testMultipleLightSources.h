@@ -4,6 +4,10 @@
 #include "../Mesh/GeometryFactory.h"
 #include "../utils/Camera.h"
 #include "../Renderer.h"
+#include "../LightList.h"
+#include "../DeferredShading.h"
+#include "../ClusteredLights.h"
+#include "../RenderQueue.h"
 #include <memory>
 #include "GL/glew.h"
 #include <GLFW/glfw3.h>
@@ -26,6 +30,7 @@ namespace test {
         glm::vec3 colour;
         float intensity;
         float cutoff; // Used only for spotlights
+        float range = 0.0f; // Point and spot lights fade out here; 0 = unbounded
     };
 
     class testMultipleLightSources : public Tests {
@@ -38,11 +43,25 @@ namespace test {
         void RenderGUI() override;
 
     private:
+        // Pack an editable Light into the storage buffer layout
+        static GPULight ToGPU(const Light& light);
+        void AddLight(const Light& light);
+        // The spheres to draw this frame. m_Queue sorts them front to back,
+        // so nearer layers already hide most of the field; the pre-pass
+        // removes the rest, where the spheres overlap.
+        void GatherSpheres();
+        // Sets the material uniforms `model` names (GBuffer.shader takes
+        // PhongMultiple's), then draws every gathered sphere through m_Queue,
+        // behind a depth pre-pass if `prepass`
+        enum class ShadingModel { Phong, BlinnPhong, PBR };
+        void DrawSpheres(Shader& shader, ShadingModel model = ShadingModel::Phong, bool prepass = false);
+        Shader& GetClusteredShader();
+
         GLFWwindow* m_Window;
 
         std::unique_ptr<Camera> m_Camera;
         std::unique_ptr<Mesh> m_Sphere;
-        std::unique_ptr<Shader> m_Shader;
+        std::shared_ptr<Shader> m_Shader;
 
         // Material and scene lighting parameters
         float m_AmbientIntensity;
@@ -55,7 +74,41 @@ namespace test {
         glm::mat4 m_View;
         glm::mat4 m_Projection;
 
-        std::vector<Light> m_Lights; // All active lights
+        std::vector<Light> m_Lights; // All active lights, as edited in ImGui
+        LightList m_LightList;       // The same lights, packed for the shader
         int m_SelectedLightIndex = 0;  // Light being edited in ImGui
+        int m_ScatterCount = 100;
+
+        float m_ScatterRange = 1.5f;   // for scattered lights, 0 = unbounded
+
+        // Forward (PhongMultiple, every light per fragment), deferred
+        // (G-buffer + lighting pass) or clustered forward (per-cluster lists)
+        enum Path { FORWARD, DEFERRED, CLUSTERED };
+        int m_Path = FORWARD;
+        std::unique_ptr<DeferredShading> m_Deferred;
+        int m_DeferredOutput = 0;      // DeferredShading::Output
+        std::unique_ptr<ClusteredLights> m_Clusters;
+        std::shared_ptr<Shader> m_BlinnPhongShader;
+        std::shared_ptr<Shader> m_PBRShader;
+        int m_ClusteredModel = 0;      // ShadingModel
+        bool m_ClusterHeatmap = false;
+        bool m_SphereField = false;   // one sphere, or a grid of overlapping ones
+
+        struct SphereInstance
+        {
+            glm::mat4 model;
+            glm::vec3 albedo;
+        };
+        std::vector<SphereInstance> m_Spheres;
+        RenderQueue m_Queue;
+        // Forward and clustered paths: lay depth down first, then shade only
+        // the visible fragment of each pixel (GBuffer.shader is cheap enough
+        // without, and does not match the pre-pass's depth exactly)
+        bool m_DepthPrepass = false;
+
+        // Smoothed GPU ms per path, from the Profiler scopes
+        float m_ForwardMs = 0.0f;
+        float m_DeferredMs = 0.0f;
+        float m_ClusteredMs = 0.0f;
     };
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "testProceduralArt.h"
 #include "../Renderer.h"
+#include "../GLState.h"
 #include "../vendor/imgui/imgui.h"
 
 /*
@@ -31,20 +32,81 @@
 test::testProceduralArt::testProceduralArt(GLFWwindow* window)
     : m_Window(window)
 {
-    // Load both procedural shaders
+    // Load the procedural shaders
     // These shaders generate visuals purely from math - no textures needed!
-    m_PlasmaShader = std::make_unique<Shader>("res/Shaders/plasma.shader");
-    m_NoiseShader = std::make_unique<Shader>("res/Shaders/noise.shader");
+    AddShader("Plasma", "res/Shaders/Art/plasma.shader",
+        "Plasma: Overlapping sine waves create interference patterns. "
+        "Classic demoscene effect from the 1990s.", true);
+    AddShader("Noise", "res/Shaders/Art/noise.shader",
+        "Noise: Pseudo-random value noise using hash functions. "
+        "Foundation for procedural textures, terrain, clouds.", true, true);
+    AddShader("Circle Ripples", "res/Shaders/Art/circleripples.shader",
+        "Circle Ripples: Rings of a sine wave over the distance from the centre.", true);
+    AddShader("Checkerboard", "res/Shaders/Art/checkerboard.shader",
+        "Checkerboard: The parity of floor(uv * n), the simplest tiling pattern.", true);
+    AddShader("FBM Noise", "res/Shaders/Art/fbmnoise.shader",
+        "FBM Noise: Octaves of noise summed at doubling frequency and halving "
+        "amplitude. Several noise evaluations per pixel, so it is the expensive one.", false, true);
+    AddShader("Finished Art", "res/Shaders/Art/FinishedArtEffect.shader",
+        "Finished Art: A complete piece combining the techniques above.", false);
+
+    m_ReconstructShader = std::make_unique<Shader>("res/Shaders/Art/Reconstruct.shader");
 
     // Create a fullscreen quad using the GeometryFactory
     // This quad spans from (-1,-1) to (1,1) in NDC - covering the entire viewport
     m_Quad = GeometryFactory::CreateFullscreenQuad();
 
-    // Get window dimensions for UV coordinate calculation in shaders
-    // Resolution is needed to convert gl_FragCoord (pixel position) to UV (0-1 range)
-    int width, height;
-    glfwGetWindowSize(m_Window, &width, &height);
-    m_Resolution = glm::vec2(static_cast<float>(width), static_cast<float>(height));
+    // Resolution is needed to convert gl_FragCoord (pixel position) to UV
+    // (0-1 range); it is the render target's, set each frame in Render
+    m_Resolution = glm::vec2(0.0f);
+}
+
+void test::testProceduralArt::AddShader(const char* name, const char* path, const char* description, bool underscoreUniforms,
+    bool noiseVariants)
+{
+    ArtShader art;
+    art.name = name;
+    art.description = description;
+    art.shader = std::make_unique<Shader>(path);
+    art.timeUniform = underscoreUniforms ? "u_Time" : "uTime";
+    art.resolutionUniform = underscoreUniforms ? "u_Resolution" : "uResolution";
+    art.noiseVariants = noiseVariants;
+    art.amortize = AMORTIZE_OFF;
+    // Switching the noise source (or benchmarking) should never wait on the compiler
+    if (noiseVariants)
+        art.shader->CompileAllVariants();
+    m_Shaders.push_back(std::move(art));
+}
+
+void test::testProceduralArt::StartBenchmark()
+{
+    m_SavedSettings = m_DynamicResolution.GetSettings();
+    m_BenchmarkShader = m_CurrentShader;
+    m_BenchmarkVariant = 0;
+    m_BenchmarkFrame = 0;
+    m_BenchmarkSum = 0.0;
+}
+
+void test::testProceduralArt::UpdateBenchmark()
+{
+    // Full resolution, so every variant shades the same pixels
+    DynamicResolution::Settings& settings = m_DynamicResolution.GetSettings();
+    settings.enabled = false;
+    settings.fixedScale = 1.0f;
+
+    if (m_BenchmarkFrame >= BENCHMARK_WARMUP)
+        m_BenchmarkSum += m_DynamicResolution.GetGpuMs();
+    if (++m_BenchmarkFrame < BENCHMARK_WARMUP + BENCHMARK_FRAMES)
+        return;
+
+    m_BenchmarkMs[m_BenchmarkVariant] = static_cast<float>(m_BenchmarkSum / BENCHMARK_FRAMES);
+    m_BenchmarkFrame = 0;
+    m_BenchmarkSum = 0.0;
+    if (++m_BenchmarkVariant == NOISE_COUNT)
+    {
+        m_BenchmarkVariant = -1;
+        settings = m_SavedSettings;
+    }
 }
 
 void test::testProceduralArt::Update(float deltaTime)
@@ -55,14 +117,115 @@ void test::testProceduralArt::Update(float deltaTime)
 
 void test::testProceduralArt::Render()
 {
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(m_Window, &width, &height);
+    if (width <= 0 || height <= 0)
+        return;
+
+    if (m_BenchmarkVariant >= 0)
+    {
+        m_CurrentShader = m_BenchmarkShader;
+        UpdateBenchmark();
+    }
+
+    // Draw into the scaled target; gl_FragCoord then runs over its pixels,
+    // so the shaders need its size, not the window's
+    m_DynamicResolution.Begin(width, height);
+    m_Resolution = glm::vec2(static_cast<float>(m_DynamicResolution.GetWidth()), static_cast<float>(m_DynamicResolution.GetHeight()));
+
     Renderer renderer;
     renderer.Clear();
+    // Full-screen quads only, and several of them over one another
+    GLState::Disable(GL_DEPTH_TEST);
 
     // Select active shader based on user choice
-    Shader* shader = (m_CurrentShader == 0) ? m_PlasmaShader.get() : m_NoiseShader.get();
+    const ArtShader& art = m_Shaders[m_CurrentShader];
+    if (art.amortize == AMORTIZE_OFF)
+        DrawArt(art, AMORTIZE_OFF, 0);
+    else
+        RenderAmortized(art, m_DynamicResolution.GetWidth(), m_DynamicResolution.GetHeight());
+
+    m_DynamicResolution.End();
+    m_DynamicResolution.Upscale(width, height);
+}
+
+void test::testProceduralArt::RenderAmortized(const ArtShader& art, int width, int height)
+{
+    // The packed target holds only the pixels shaded this frame
+    const bool checkerboard = art.amortize == AMORTIZE_CHECKERBOARD;
+    const int packedWidth = (width + 1) / 2;
+    const int packedHeight = checkerboard ? height : (height + 1) / 2;
+    if (!m_Packed || m_Packed->GetWidth() != packedWidth || m_Packed->GetHeight() != packedHeight)
+        m_Packed = std::make_unique<Framebuffer>(packedWidth, packedHeight);
+
+    // A history of another size, shader or mode can't be reused
+    const int historyKey = m_CurrentShader * AMORTIZE_COUNT + art.amortize;
+    bool historyValid = historyKey == m_HistoryKey;
+    if (!m_History || m_History->GetWidth() != width || m_History->GetHeight() != height)
+    {
+        m_History = std::make_unique<Framebuffer>(width, height);
+        historyValid = false;
+    }
+    m_HistoryKey = historyKey;
+
+    // The quarter mode visits the diagonal first, so two frames in every
+    // 2x2 block already has one sample on each diagonal
+    static const int quarterOrder[4] = { 0, 3, 1, 2 };
+    const unsigned int frame = m_AmortizeFrame++;
+    const int phase = checkerboard ? static_cast<int>(frame & 1) : quarterOrder[frame & 3];
+
+    m_Packed->Bind();
+    DrawArt(art, art.amortize, phase);
+
+    m_DynamicResolution.BindTarget();
+    m_ReconstructShader->Bind();
+    GLState::BindTextureToUnit(0, GL_TEXTURE_2D, m_Packed->GetColorTexture());
+    GLState::BindTextureToUnit(1, GL_TEXTURE_2D, m_History->GetColorTexture());
+    m_ReconstructShader->setUniform1i("u_Current", 0);
+    m_ReconstructShader->setUniform1i("u_History", 1);
+    m_ReconstructShader->setUniform1i("u_Mode", art.amortize);
+    m_ReconstructShader->setUniform1i("u_Phase", phase);
+    m_ReconstructShader->setUniform1i("u_HistoryValid", historyValid ? 1 : 0);
+    m_Quad->Draw();
+    GLState::BindTextureToUnit(1, GL_TEXTURE_2D, 0);
+    GLState::BindTextureToUnit(0, GL_TEXTURE_2D, 0);
+
+    // What was just rebuilt is next frame's history
+    GlCall(glCopyImageSubData(m_DynamicResolution.GetColorTexture(), GL_TEXTURE_2D, 0, 0, 0, 0,
+        m_History->GetColorTexture(), GL_TEXTURE_2D, 0, 0, 0, 0, width, height, 1));
+
+    if (m_Compare)
+    {
+        GLState::Enable(GL_SCISSOR_TEST);
+        GLState::Scissor(0, 0, width / 2, height);
+        DrawArt(art, AMORTIZE_OFF, 0);
+        GLState::Disable(GL_SCISSOR_TEST);
+    }
+}
+
+void test::testProceduralArt::DrawArt(const ArtShader& art, int amortizeMode, int phase)
+{
+    Shader* shader = art.shader.get();
+    const int noiseSource = m_BenchmarkVariant >= 0 ? m_BenchmarkVariant : m_NoiseSource;
+    if (art.noiseVariants)
+    {
+        static const char* variants[NOISE_COUNT] = { "ALU", "TEXTURE_2D", "TEXTURE_3D" };
+        shader = &art.shader->Variant("NOISE", variants[noiseSource]);
+    }
 
     shader->Bind();
 
+    // The texture variants read the baked noise instead of hashing
+    if (art.noiseVariants && noiseSource != NOISE_ALU)
+    {
+        const bool volume = noiseSource == NOISE_TEXTURE_3D;
+        GLState::BindTextureToUnit(0, volume ? GL_TEXTURE_3D : GL_TEXTURE_2D,
+            volume ? m_NoiseTextures.GetTexture3D() : m_NoiseTextures.GetTexture2D());
+        shader->setUniform1i(volume ? "u_Noise3D" : "u_Noise2D", 0);
+        shader->setUniform1f("u_NoisePeriod", static_cast<float>(volume ? NoiseTextures::PERIOD_3D : NoiseTextures::PERIOD_2D));
+        shader->setUniform2f("u_NoiseBasis", m_NoiseBasis == 0 ? 1.0f : 0.0f, m_NoiseBasis == 0 ? 0.0f : 1.0f);
+    }
+
     /*
      * UNIFORM UPDATES:
      * These values are sent to the GPU and remain constant for all fragments
@@ -74,13 +237,21 @@ void test::testProceduralArt::Render()
      * u_Resolution: Allows the shader to calculate normalized UV coordinates:
      *               uv = gl_FragCoord.xy / u_Resolution
      *               This gives us coordinates from (0,0) to (1,1)
+     *               (the shaders use PixelCoord(), which is gl_FragCoord.xy
+     *               unless the shader is amortized)
      */
     float timeValue = static_cast<float>(glfwGetTime()) * m_TimeMultiplier;
-    shader->setUniform1f("u_Time", timeValue);
-    shader->setUniform2f("u_Resolution", m_Resolution.x, m_Resolution.y);
+    shader->setUniform1f(art.timeUniform, timeValue);
+    shader->setUniform2f(art.resolutionUniform, m_Resolution.x, m_Resolution.y);
+
+    // Which pixels this draw stands for (see Amortize)
+    shader->setUniform1i("u_AmortizeMode", amortizeMode);
+    shader->setUniform1i("u_AmortizePhase", phase);
 
     // Draw the fullscreen quad - this triggers the fragment shader for every pixel
     m_Quad->Draw();
+    if (art.noiseVariants && noiseSource != NOISE_ALU)
+        GLState::BindTextureToUnit(0, noiseSource == NOISE_TEXTURE_3D ? GL_TEXTURE_3D : GL_TEXTURE_2D, 0);
 }
 
 void test::testProceduralArt::RenderGUI()
@@ -89,19 +260,89 @@ void test::testProceduralArt::RenderGUI()
     ImGui::Separator();
 
     // Shader selection
-    const char* shaders[] = { "Plasma", "Noise" };
-    ImGui::Combo("Shader", &m_CurrentShader, shaders, IM_ARRAYSIZE(shaders));
+    std::vector<const char*> shaders;
+    for (const ArtShader& art : m_Shaders)
+        shaders.push_back(art.name);
+    ImGui::Combo("Shader", &m_CurrentShader, shaders.data(), static_cast<int>(shaders.size()));
 
     // Brief description of current shader
-    if (m_CurrentShader == 0) {
-        ImGui::TextWrapped("Plasma: Overlapping sine waves create interference patterns. "
-                          "Classic demoscene effect from the 1990s.");
-    } else {
-        ImGui::TextWrapped("Noise: Pseudo-random value noise using hash functions. "
-                          "Foundation for procedural textures, terrain, clouds.");
-    }
+    ImGui::TextWrapped("%s", m_Shaders[m_CurrentShader].description);
 
     ImGui::Separator();
     ImGui::SliderFloat("Time Multiplier", &m_TimeMultiplier, 0.1f, 5.0f);
     ImGui::Text("Resolution: %.0f x %.0f", m_Resolution.x, m_Resolution.y);
+
+    // Amortized shading, per shader
+    ImGui::Separator();
+    int& amortize = m_Shaders[m_CurrentShader].amortize;
+    ImGui::Text("Pixels shaded per frame");
+    ImGui::RadioButton("All", &amortize, AMORTIZE_OFF); ImGui::SameLine();
+    ImGui::RadioButton("Checkerboard (1/2)", &amortize, AMORTIZE_CHECKERBOARD); ImGui::SameLine();
+    ImGui::RadioButton("Interleaved (1/4)", &amortize, AMORTIZE_QUARTER);
+    if (amortize != AMORTIZE_OFF)
+    {
+        ImGui::Checkbox("Compare: left half fully shaded", &m_Compare);
+        if (m_Packed)
+            ImGui::Text("Shaded: %d x %d", m_Packed->GetWidth(), m_Packed->GetHeight());
+    }
+
+    // Noise source, for the shaders that have the NOISE variant
+    if (m_Shaders[m_CurrentShader].noiseVariants)
+    {
+        ImGui::Separator();
+        ImGui::Text("Noise source");
+        ImGui::RadioButton("ALU (hash)", &m_NoiseSource, NOISE_ALU); ImGui::SameLine();
+        ImGui::RadioButton("2D texture", &m_NoiseSource, NOISE_TEXTURE_2D); ImGui::SameLine();
+        ImGui::RadioButton("3D texture", &m_NoiseSource, NOISE_TEXTURE_3D);
+        if (m_NoiseSource != NOISE_ALU)
+        {
+            ImGui::RadioButton("Value", &m_NoiseBasis, 0); ImGui::SameLine();
+            ImGui::RadioButton("Gradient", &m_NoiseBasis, 1);
+        }
+        ImGui::Text("Noise textures: %.1f KB", NoiseTextures::GetBytes() / 1024.0f);
+
+        if (m_BenchmarkVariant >= 0)
+        {
+            ImGui::Text("Benchmarking variant %d of %d...", m_BenchmarkVariant + 1, static_cast<int>(NOISE_COUNT));
+        }
+        else if (ImGui::Button("Benchmark noise sources"))
+        {
+            StartBenchmark();
+        }
+        if (m_BenchmarkShader >= 0 && m_BenchmarkVariant < 0)
+        {
+            ImGui::Text("%s at full resolution:", m_Shaders[m_BenchmarkShader].name);
+            ImGui::Text("  ALU:        %.3f ms", m_BenchmarkMs[NOISE_ALU]);
+            ImGui::Text("  2D texture: %.3f ms", m_BenchmarkMs[NOISE_TEXTURE_2D]);
+            ImGui::Text("  3D texture: %.3f ms", m_BenchmarkMs[NOISE_TEXTURE_3D]);
+        }
+    }
+
+    // Dynamic resolution
+    ImGui::Separator();
+    DynamicResolution::Settings& settings = m_DynamicResolution.GetSettings();
+    ImGui::Checkbox("Dynamic resolution", &settings.enabled);
+    if (settings.enabled)
+    {
+        ImGui::SliderFloat("Target GPU ms", &settings.targetMs, 1.0f, 33.0f, "%.1f");
+        ImGui::SliderFloat("Min scale", &settings.minScale, 0.1f, 1.0f);
+    }
+    else
+    {
+        ImGui::SliderFloat("Scale", &settings.fixedScale, 0.1f, 1.0f);
+    }
+    int filter = static_cast<int>(settings.filter);
+    ImGui::RadioButton("Bilinear", &filter, static_cast<int>(DynamicResolution::Filter::Bilinear)); ImGui::SameLine();
+    ImGui::RadioButton("Sharpened", &filter, static_cast<int>(DynamicResolution::Filter::Sharpen));
+    settings.filter = static_cast<DynamicResolution::Filter>(filter);
+    if (settings.filter == DynamicResolution::Filter::Sharpen)
+        ImGui::SliderFloat("Sharpness", &settings.sharpness, 0.0f, 1.0f);
+
+    ImGui::Text("Scale: %.2f (%.0f%% of the pixels)", m_DynamicResolution.GetScale(),
+        100.0f * m_DynamicResolution.GetScale() * m_DynamicResolution.GetScale());
+    ImGui::Text("GPU time: %.2f ms", m_DynamicResolution.GetGpuMs());
+    ImGui::PlotLines("Scale history", m_DynamicResolution.GetScaleHistory(), DynamicResolution::HISTORY_SIZE,
+        m_DynamicResolution.GetHistoryOffset(), nullptr, 0.0f, 1.0f, ImVec2(0, 40));
+    ImGui::PlotLines("GPU ms", m_DynamicResolution.GetTimeHistory(), DynamicResolution::HISTORY_SIZE,
+        m_DynamicResolution.GetHistoryOffset(), nullptr, 0.0f, settings.targetMs * 2.0f, ImVec2(0, 40));
 }
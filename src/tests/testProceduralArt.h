@@ -36,6 +36,21 @@
  * parallel floating-point math. What would take seconds on a CPU happens
  * in milliseconds on a GPU.
  *
+ * Still, the cost is per pixel: the FBM and finished-art shaders loop for
+ * every one of them. DynamicResolution renders them into a smaller
+ * target when the GPU time goes over a budget and stretches the result
+ * over the window, trading sharpness for frame rate.
+ *
+ * The noise and FBM shaders can also skip the hashing altogether and
+ * fetch noise NoiseTextures baked at startup (the NOISE variant); the
+ * benchmark button times each variant at full resolution.
+ *
+ * Since the patterns move slowly, each shader can also be AMORTIZED:
+ * shade only a checkerboard (half) or one pixel of each 2x2 block (a
+ * quarter) per frame into a packed target, then rebuild the full frame
+ * from those and the previous one (Reconstruct.shader). The phase
+ * rotates every frame, so every pixel is refreshed every 2 or 4 frames.
+ *
  * FURTHER READING:
  * ----------------
  * - The Book of Shaders: https://thebookofshaders.com/
@@ -47,7 +62,11 @@
 #include "Tests.h"
 #include "../Shader.h"
 #include "../Mesh/GeometryFactory.h"
+#include "../DynamicResolution.h"
+#include "../NoiseTextures.h"
+#include "../Framebuffer.h"
 #include <memory>
+#include <vector>
 #include "GL/glew.h"
 #include <GLFW/glfw3.h>
 #include "glm/glm.hpp"
@@ -63,21 +82,69 @@ namespace test {
         void RenderGUI() override;
 
     private:
+        // One selectable shader. The early ones call their uniforms
+        // u_Time/u_Resolution, the later ones uTime/uResolution.
+        struct ArtShader
+        {
+            const char* name;
+            const char* description;
+            std::unique_ptr<Shader> shader;
+            const char* timeUniform;
+            const char* resolutionUniform;
+            bool noiseVariants;         // has the NOISE variant axis
+            int amortize;               // an Amortize
+        };
+
+        // Shaded pixels per frame; the values are the shaders' u_AmortizeMode
+        enum Amortize { AMORTIZE_OFF, AMORTIZE_CHECKERBOARD, AMORTIZE_QUARTER, AMORTIZE_COUNT };
+
+        // Values of the NOISE axis, in the shaders' order
+        enum NoiseSource { NOISE_ALU, NOISE_TEXTURE_2D, NOISE_TEXTURE_3D, NOISE_COUNT };
+
+        static const int BENCHMARK_WARMUP = 32;   // frames before sampling, for the query ring to drain
+        static const int BENCHMARK_FRAMES = 128;
+
+        void AddShader(const char* name, const char* path, const char* description, bool underscoreUniforms, bool noiseVariants = false);
+        void StartBenchmark();
+        void UpdateBenchmark();
+        // Binds the selected variant of art, sets its uniforms and draws
+        void DrawArt(const ArtShader& art, int amortizeMode, int phase);
+        // Shades this frame's subset and reconstructs into the bound target
+        void RenderAmortized(const ArtShader& art, int width, int height);
+
         GLFWwindow* m_Window;
 
         std::unique_ptr<Mesh> m_Quad;           // Fullscreen quad - our "canvas"
 
-        std::unique_ptr<Shader> m_PlasmaShader; // Sine/cosine wave interference pattern
-        std::unique_ptr<Shader> m_NoiseShader;  // Pseudo-random value noise		
-        std::unique_ptr<Shader> m_CircleRipples;
-        std::unique_ptr<Shader> m_Checkerboard;
-        std::unique_ptr<Shader> m_FBMNoise;
+        std::vector<ArtShader> m_Shaders;       // Plasma, Noise, Circle Ripples, Checkerboard, FBM Noise, Finished Art
+
+        // Renders the canvas below window size when it runs over budget
+        DynamicResolution m_DynamicResolution;
+
+        NoiseTextures m_NoiseTextures;
+        int m_NoiseSource = NOISE_TEXTURE_2D;
+        int m_NoiseBasis = 0;          // 0: value, 1: gradient (texture variants only)
+
+        // Noise variant benchmark: each variant for BENCHMARK_FRAMES at scale 1
+        int m_BenchmarkVariant = -1;   // running while >= 0
+        int m_BenchmarkFrame = 0;
+        double m_BenchmarkSum = 0.0;
+        float m_BenchmarkMs[NOISE_COUNT] = {};
+        int m_BenchmarkShader = -1;    // what the results were measured on
+        DynamicResolution::Settings m_SavedSettings;
 
+        // Amortized rendering
+        std::unique_ptr<Shader> m_ReconstructShader;
+        std::unique_ptr<Framebuffer> m_Packed;    // this frame's shaded subset
+        std::unique_ptr<Framebuffer> m_History;   // the last reconstructed frame
+        int m_HistoryKey = -1;         // shader and mode the history was made with
+        unsigned int m_AmortizeFrame = 0;
+        bool m_Compare = false;        // left half shaded in full, for comparison
 
         // Uniforms sent to GPU each frame
-        glm::vec2 m_Resolution;       // Screen dimensions for UV calculation
+        glm::vec2 m_Resolution;       // Render target dimensions for UV calculation
         float m_TimeMultiplier = 1.0f; // Speed control for animations
-		int m_CurrentShader = 0;       // 0: Plasma, 1: Noise, 2: Circle Ripples, 3: Checkerboard, 4: FBM Noise
+		int m_CurrentShader = 0;       // index into m_Shaders
     };
 
 } // namespace test
@@ -1,4 +1,5 @@
 #include "testProjections.h"
+#include "../GLState.h"
 #include "../Renderer.h"
 #include "../vendor/imgui/imgui.h"     // Dear ImGui library for GUI elements
 #include <GL/glew.h>     
@@ -19,7 +20,7 @@ namespace test
         m_Cube = GeometryFactory::CreateCube();
 
         // Enable depth testing
-        glEnable(GL_DEPTH_TEST);
+        GLState::Enable(GL_DEPTH_TEST);
 
         // Unbind objects to prevent accidental modifications or conflicts
         m_Shader->Unbind(); // Unbind Shader Program to ensure clean state
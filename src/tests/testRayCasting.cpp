@@ -1,13 +1,21 @@
 #include "TestRayCasting.h"
+#include "../GLState.h"
+#include "../Input.h"
 #include "../Renderer.h"
+#include "../Mesh/GeometryFactory.h"
 #include "../vendor/imgui/imgui.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
 
 
 namespace test {
     TestRayCasting::TestRayCasting(GLFWwindow* window)
-        : m_window(window), selectedObjectIndex(-1) {
+        : m_window(window), selectedObjectIndex(-1),
+          m_UseKernels(true), m_ExtraObjects(0), m_Animate(false), m_Time(0.0f), m_PickMicroseconds(0.0f),
+          m_PickMode(PICK_CPU), m_CursorPixelX(-1), m_CursorPixelY(-1) {
 
         // Initialise camera
         cameraPosition = glm::vec3(0.0f, 0.0f, 3.0f);
@@ -19,18 +27,20 @@ namespace test {
         objects.push_back({ glm::vec3(0.0f, 0.0f, 0.0f), 1.0f, "Obj 1" });
         objects.push_back({ glm::vec3(2.0f, 0.0f, -3.0f), 1.5f, "Obj 2" });
         objects.push_back({ glm::vec3(-2.0f, 1.0f, -2.0f), 1.0f, "Obj 3" });
+        GenerateObjects();
 
         // Setup the VAO, VBO, and IBO for the cube/sphere
         SetupBuffers();
 
         // Load shader
-        m_Shader = std::make_unique<Shader>("res/Shaders/ProjectionsShader2.shader");
+        m_Shader = std::make_unique<Shader>("res/Shaders/ProjectionsInstanced.shader");
     }
 
     void TestRayCasting::SetupBuffers() {
         std::vector<float> vertices;
         std::vector<unsigned int> indices;
-        GenerateSphereData(vertices, indices, 1.0f, 20, 20); // Radius = 1, 20 divisions each for longitude and latitude
+        // Radius 1, as round as the 20 x 20 UV sphere this used to be
+        GenerateSphereData(vertices, indices, 1.0f, GeometryFactory::GetUVSphereError(20, 20));
 
         m_VAO = std::make_unique<VertexArray>();
         m_VBO = std::make_unique<VertexBuffer>(vertices.data(), vertices.size() * sizeof(float));
@@ -42,50 +52,69 @@ namespace test {
 
         m_IBO = std::make_unique<IndexBuffer>(indices.data(), indices.size());
 
+        // Per-object transform and colour, uploaded each frame in Render
+        m_Instances = std::make_unique<InstanceBuffer>(static_cast<unsigned int>(objects.size()));
+        m_VAO->AddInstanceBuffer(*m_Instances);
+
         // Enable depth testing for 3D object rendering
-        glEnable(GL_DEPTH_TEST);
+        GLState::Enable(GL_DEPTH_TEST);
     }
-    void TestRayCasting::GenerateSphereData(std::vector<float>& vertices, std::vector<unsigned int>& indices, float radius, unsigned int longitudeDiv, unsigned int latitudeDiv) {
-        for (unsigned int lat = 0; lat <= latitudeDiv; ++lat) {
-            float theta = lat * glm::pi<float>() / latitudeDiv;
-            float sinTheta = sin(theta);
-            float cosTheta = cos(theta);
-
-            for (unsigned int lon = 0; lon <= longitudeDiv; ++lon) {
-                float phi = lon * 2.0f * glm::pi<float>() / longitudeDiv;
-                float sinPhi = sin(phi);
-                float cosPhi = cos(phi);
-
-                float x = cosPhi * sinTheta;
-                float y = cosTheta;
-                float z = sinPhi * sinTheta;
-
-                // Push vertex position
-                vertices.push_back(radius * x);
-                vertices.push_back(radius * y);
-                vertices.push_back(radius * z);
-
-                // Push vertex normal
-                vertices.push_back(x);
-                vertices.push_back(y);
-                vertices.push_back(z);
-            }
+    // Helper: random float in [lo, hi]
+    static float RandomRange(float lo, float hi) {
+        return lo + (hi - lo) * (static_cast<float>(rand()) / static_cast<float>(RAND_MAX));
+    }
+
+    // Random point inside [-extent, extent]^3
+    static glm::vec3 RandomPoint(float extent) {
+        return glm::vec3(RandomRange(-extent, extent), RandomRange(-extent, extent), RandomRange(-extent, extent));
+    }
+
+    void TestRayCasting::GenerateObjects() {
+        // Keep the three hand-placed objects, then scatter the extras in
+        // front of the camera. Same seed each time so the scene is repeatable.
+        objects.resize(3);
+        srand(1234);
+        for (int i = 0; i < m_ExtraObjects; ++i) {
+            glm::vec3 position(RandomRange(-60.0f, 60.0f), RandomRange(-40.0f, 40.0f), RandomRange(-120.0f, -6.0f));
+            objects.push_back({ position, RandomRange(0.2f, 0.6f), "Obj " + std::to_string(i + 4) });
         }
 
-        // Create index data for the sphere using triangles
-        for (unsigned int lat = 0; lat < latitudeDiv; ++lat) {
-            for (unsigned int lon = 0; lon < longitudeDiv; ++lon) {
-                unsigned int first = (lat * (longitudeDiv + 1)) + lon;
-                unsigned int second = first + longitudeDiv + 1;
+        m_BasePositions.resize(objects.size());
+        for (size_t i = 0; i < objects.size(); ++i)
+            m_BasePositions[i] = objects[i].position;
+
+        UpdateBounds();
+        m_BVH.Build(m_ObjectBounds, BVH::SIMD_LEAF_SIZE);
+        UpdateSpheres();
+        selectedObjectIndex = -1;
+    }
+
+    void TestRayCasting::UpdateBounds() {
+        m_ObjectBounds.resize(objects.size());
+        for (size_t i = 0; i < objects.size(); ++i)
+            m_ObjectBounds[i] = AABB::FromSphere(objects[i].position, objects[i].radius);
+    }
 
-                indices.push_back(first);
-                indices.push_back(second);
-                indices.push_back(first + 1);
+    void TestRayCasting::UpdateSpheres() {
+        const std::vector<unsigned int>& order = m_BVH.GetPrimitiveOrder();
+        m_Spheres.Resize(order.size());
+        for (size_t slot = 0; slot < order.size(); ++slot)
+            m_Spheres.Set(slot, objects[order[slot]].position, objects[order[slot]].radius);
+    }
 
-                indices.push_back(second);
-                indices.push_back(second + 1);
-                indices.push_back(first + 1);
-            }
+    void TestRayCasting::GenerateSphereData(std::vector<float>& vertices, std::vector<unsigned int>& indices, float radius, float maxError) {
+        std::vector<Vertex> sphere;
+        const GeometryFactory::GeodesicLevel level = GeometryFactory::SelectGeodesicSphere(maxError);
+        GeometryFactory::GenerateGeodesicSphere(level.base, level.subdivisions, sphere, indices);
+
+        // The factory's spheres are unit normals at radius 0.5
+        vertices.clear();
+        vertices.reserve(sphere.size() * 6);
+        for (const Vertex& vertex : sphere) {
+            for (int c = 0; c < 3; ++c)
+                vertices.push_back(radius * vertex.normal[c]);
+            for (int c = 0; c < 3; ++c)
+                vertices.push_back(vertex.normal[c]);
         }
     }
 
@@ -93,24 +122,83 @@ namespace test {
         ProcessInput();
 
         double mouseX, mouseY;
-        glfwGetCursorPos(m_window, &mouseX, &mouseY);
+        Input::GetCursorPos(m_window, &mouseX, &mouseY);
+
+        // Objects only move a little, so the tree keeps its shape and just
+        // has its boxes refitted rather than being rebuilt every frame.
+        if (m_Animate) {
+            m_Time += deltaTime;
+            for (size_t i = 0; i < objects.size(); ++i)
+                objects[i].position = m_BasePositions[i] + glm::vec3(0.0f, 0.5f * sin(2.0f * m_Time + 0.37f * i), 0.0f);
+            UpdateBounds();
+            m_BVH.Refit(m_ObjectBounds);
+            UpdateSpheres();
+        }
 
-        glm::vec3 rayDirection = CalculateRayDirection((float)mouseX, (float)mouseY);
-        glm::vec3 rayOrigin = cameraPosition;
+        // GPU mode: take whatever readbacks have finished; the pixel for
+        // this frame is requested in Render once the IDs are drawn.
+        if (m_PickMode == PICK_GPU) {
+            int windowWidth, windowHeight, width, height;
+            glfwGetWindowSize(m_window, &windowWidth, &windowHeight);
+            glfwGetFramebufferSize(m_window, &width, &height);
+            if (windowWidth > 0 && windowHeight > 0) {
+                m_CursorPixelX = static_cast<int>(mouseX * width / windowWidth);
+                m_CursorPixelY = height - 1 - static_cast<int>(mouseY * height / windowHeight);
+            }
 
-        // Find the first object the ray intersects
-        selectedObjectIndex = -1;
-        for (size_t i = 0; i < objects.size(); ++i) {
-            if (RayIntersectsSphere(rayOrigin, rayDirection, objects[i].position, objects[i].radius)) {
-                selectedObjectIndex = static_cast<int>(i);
-                break;
+            m_Picker.Poll();
+            const GPUPicker::Result& result = m_Picker.GetResult();
+            if (result.valid) {
+                selectedObjectIndex = (result.id != GPUPicker::NO_OBJECT && result.id <= objects.size())
+                    ? static_cast<int>(result.id - 1) : -1;
             }
+            return;
+        }
+
+        glm::vec3 rayDirection = CalculateRayDirection((float)mouseX, (float)mouseY);
+        Ray ray(cameraPosition, rayDirection);
+
+        // Nearest object under the cursor. The BVH only rules out objects
+        // whose boxes the ray misses; the sphere test decides the rest.
+        auto start = std::chrono::steady_clock::now();
+        RayHit hit;
+        if (m_UseKernels) {
+            m_BVH.IntersectNearestLeaves(ray, hit, [&](const Ray& r, unsigned int first, unsigned int count, float& t) {
+                return RayKernels::IntersectSpheres(r, m_Spheres, first, count, t);
+            });
+        }
+        else {
+            m_BVH.IntersectNearest(ray, hit, [&](const Ray& r, unsigned int i, float& t) {
+                return RayIntersectSphere(r, objects[i].position, objects[i].radius, t);
+            });
         }
+        m_PickMicroseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        selectedObjectIndex = hit.IsHit() ? static_cast<int>(hit.primitive) : -1;
     }
 
     void TestRayCasting::Render() {
         Renderer renderer;
-        renderer.Clear();
+
+        int width, height;
+        glfwGetFramebufferSize(m_window, &width, &height);
+        if (m_PickMode == PICK_GPU && width > 0 && height > 0) {
+            if (!m_PickFramebuffer || m_PickFramebuffer->GetWidth() != width || m_PickFramebuffer->GetHeight() != height) {
+                m_PickFramebuffer = std::make_unique<Framebuffer>(width, height);
+                m_PickFramebuffer->EnableObjectIds();
+            }
+            m_PickFramebuffer->Bind();
+
+            // glClear would also hit the R32UI ID attachment, which is
+            // undefined for an integer buffer: clear colour and depth by
+            // draw buffer, then the IDs
+            const GLfloat clearDepth = 1.0f;
+            glClearBufferfv(GL_COLOR, 0, GLState::GetClearColor());
+            glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+            m_PickFramebuffer->ClearObjectIds();
+        }
+        else
+            renderer.Clear();
 
         m_Shader->Bind();
 
@@ -120,16 +208,32 @@ namespace test {
         m_Shader->setUniformMat4f("view", viewMatrix);
         m_Shader->setUniformMat4f("projection", projectionMatrix);
 
+        // Every sphere shares one mesh, so they are drawn as instances in a
+        // single call; only the per-instance transform and colour differ.
+        m_InstanceData.resize(objects.size());
         for (size_t i = 0; i < objects.size(); ++i) {
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), objects[i].position);
-            m_Shader->setUniformMat4f("model", model);
+            m_InstanceData[i].model = glm::translate(glm::mat4(1.0f), objects[i].position);
+            m_InstanceData[i].model = glm::scale(m_InstanceData[i].model, glm::vec3(objects[i].radius));
 
             // Set the colour based on whether the object is selected
             glm::vec3 color = (selectedObjectIndex == static_cast<int>(i)) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
-            m_Shader->setUniform4f("u_Color", color.r, color.g, color.b, 1.0f);
+            m_InstanceData[i].colour = glm::vec4(color, 1.0f);
+        }
+        m_Instances->SetData(m_InstanceData);
+
+        m_RenderQueue.Clear();
+        RenderCommand cmd;
+        cmd.shader = m_Shader.get();
+        cmd.vao = m_VAO.get();
+        cmd.ibo = m_IBO.get();
+        cmd.instances = m_Instances.get();
+        m_RenderQueue.Submit(RenderPass::Opaque, cmd);
+
+        m_RenderQueue.FlushPass(RenderPass::Opaque);
 
-            // Draw the object using the renderer
-            renderer.Draw(*m_VAO, *m_IBO, *m_Shader);
+        if (m_PickMode == PICK_GPU && m_PickFramebuffer) {
+            m_Picker.Request(*m_PickFramebuffer, m_CursorPixelX, m_CursorPixelY);
+            m_PickFramebuffer->BlitToScreen(width, height);
         }
     }
 
@@ -146,15 +250,195 @@ namespace test {
         else {
             ImGui::Text("No object selected.");
         }
+
+        ImGui::Separator();
+        ImGui::RadioButton("CPU ray (BVH)", &m_PickMode, PICK_CPU); ImGui::SameLine();
+        ImGui::RadioButton("GPU ID buffer", &m_PickMode, PICK_GPU);
+        if (m_PickMode == PICK_CPU) {
+            ImGui::Text("Latency: same frame, %.1f us on the CPU", m_PickMicroseconds);
+        }
+        else {
+            const GPUPicker::Result& result = m_Picker.GetResult();
+            const GPUPicker::Stats& pickStats = m_Picker.GetStats();
+            ImGui::Text("Latency: %u frames, %.2f ms after the request", result.framesLate, result.latencyMs);
+            ImGui::Text("In flight: %u  Dropped: %u of %u", m_Picker.GetPendingCount(), pickStats.dropped, pickStats.requests);
+        }
+
+        ImGui::Separator();
+        if (ImGui::SliderInt("Extra objects", &m_ExtraObjects, 0, 100000)) {
+            GenerateObjects();
+        }
+        ImGui::Checkbox("Animate (refit BVH)", &m_Animate);
+        ImGui::Checkbox("SIMD leaf tests", &m_UseKernels);
+        ImGui::SameLine();
+        ImGui::Text("(%s, %u wide)", RayKernels::GetInstructionSet(), RayKernels::WIDTH);
+
+        const BVH::Stats& stats = m_BVH.GetStats();
+        ImGui::Text("BVH: %u nodes, %u leaves, depth %u", stats.nodes, stats.leaves, stats.maxDepth);
+        ImGui::Text("Build: %.2f ms  Refit: %.2f ms", stats.buildMs, stats.refitMs);
+
+        ImGui::Separator();
+        if (ImGui::Button("Run benchmark")) {
+            RunBenchmark();
+        }
+        if (m_Benchmark.valid) {
+            ImGui::Text("%u spheres: build %.1f ms, refit %.2f ms", m_Benchmark.objects, m_Benchmark.buildMs, m_Benchmark.refitMs);
+            ImGui::Text("  %u nodes, depth %u", m_Benchmark.stats.nodes, m_Benchmark.stats.maxDepth);
+            ImGui::Text("  Nearest: %.2f us/ray (%u of %u rays hit)", m_Benchmark.nearestMicroseconds, m_Benchmark.nearestHits, m_Benchmark.rays);
+            ImGui::Text("  Nearest, %s leaves: %.2f us/ray", RayKernels::GetInstructionSet(), m_Benchmark.kernelMicroseconds);
+            ImGui::Text("  Any:     %.2f us/ray (%u hit)", m_Benchmark.anyMicroseconds, m_Benchmark.anyHits);
+            ImGui::Text("  Packet:  %.2f us/ray (%u-ray packets)", m_Benchmark.packetMicroseconds, BVH::MAX_PACKET_SIZE);
+            ImGui::Text("  Linear:  %.2f us/ray (%u of %u rays hit)", m_Benchmark.linearMicroseconds,
+                m_Benchmark.linearHits, m_Benchmark.linearRays);
+            ImGui::Text("%u triangles: build %.1f ms, nearest %.2f us/ray", m_Benchmark.triangles,
+                m_Benchmark.triangleBuildMs, m_Benchmark.triangleMicroseconds);
+        }
+    }
+
+    void TestRayCasting::RunBenchmark() {
+        typedef std::chrono::steady_clock Clock;
+        auto microseconds = [](Clock::time_point start) {
+            return std::chrono::duration<float, std::micro>(Clock::now() - start).count();
+        };
+
+        // 100k random spheres filling a 200-unit cube
+        const unsigned int objectCount = 100000;
+        const unsigned int rayCount = 10000;
+        const unsigned int linearRayCount = 100;   // brute force is slow enough that a few are plenty
+
+        srand(42);
+        std::vector<glm::vec3> centres(objectCount);
+        std::vector<float> radii(objectCount);
+        std::vector<AABB> bounds(objectCount);
+        for (unsigned int i = 0; i < objectCount; ++i) {
+            centres[i] = RandomPoint(100.0f);
+            radii[i] = RandomRange(0.1f, 0.5f);
+            bounds[i] = AABB::FromSphere(centres[i], radii[i]);
+        }
+
+        BVH bvh;
+        bvh.Build(bounds, BVH::SIMD_LEAF_SIZE);
+        bvh.Refit(bounds);
+        m_Benchmark.objects = objectCount;
+        m_Benchmark.stats = bvh.GetStats();
+        m_Benchmark.buildMs = m_Benchmark.stats.buildMs;
+        m_Benchmark.refitMs = m_Benchmark.stats.refitMs;
+
+        auto sphereTest = [&](const Ray& r, unsigned int i, float& t) {
+            return RayIntersectSphere(r, centres[i], radii[i], t);
+        };
+
+        // Rays from outside the cube aimed at random points inside it
+        std::vector<Ray> rays(rayCount);
+        for (unsigned int i = 0; i < rayCount; ++i) {
+            glm::vec3 origin = glm::normalize(RandomPoint(1.0f) + glm::vec3(1e-3f)) * 150.0f;
+            rays[i] = Ray(origin, glm::normalize(RandomPoint(100.0f) - origin));
+        }
+
+        Clock::time_point start = Clock::now();
+        unsigned int hits = 0;
+        for (const Ray& ray : rays) {
+            RayHit hit;
+            if (bvh.IntersectNearest(ray, hit, sphereTest))
+                hits++;
+        }
+        m_Benchmark.nearestMicroseconds = microseconds(start) / rayCount;
+        m_Benchmark.nearestHits = hits;
+        m_Benchmark.rays = rayCount;
+
+        // The same queries with the leaves tested by the SIMD kernel
+        SphereSoA spheres;
+        spheres.Resize(objectCount);
+        for (unsigned int slot = 0; slot < objectCount; ++slot) {
+            const unsigned int i = bvh.GetPrimitiveOrder()[slot];
+            spheres.Set(slot, centres[i], radii[i]);
+        }
+
+        start = Clock::now();
+        for (const Ray& ray : rays) {
+            RayHit hit;
+            bvh.IntersectNearestLeaves(ray, hit, [&](const Ray& r, unsigned int first, unsigned int count, float& t) {
+                return RayKernels::IntersectSpheres(r, spheres, first, count, t);
+            });
+        }
+        m_Benchmark.kernelMicroseconds = microseconds(start) / rayCount;
+
+        start = Clock::now();
+        unsigned int anyHits = 0;
+        for (const Ray& ray : rays) {
+            if (bvh.IntersectAny(ray, FLT_MAX, sphereTest))
+                anyHits++;
+        }
+        m_Benchmark.anyMicroseconds = microseconds(start) / rayCount;
+        m_Benchmark.anyHits = anyHits;
+
+        start = Clock::now();
+        unsigned int linearHits = 0;
+        for (unsigned int r = 0; r < linearRayCount; ++r) {
+            float t = FLT_MAX;
+            bool hit = false;
+            for (unsigned int i = 0; i < objectCount; ++i)
+                hit |= RayIntersectSphere(rays[r], centres[i], radii[i], t);
+            if (hit)
+                linearHits++;
+        }
+        m_Benchmark.linearMicroseconds = microseconds(start) / linearRayCount;
+        m_Benchmark.linearHits = linearHits;
+        m_Benchmark.linearRays = linearRayCount;
+
+        // Packets: an 8x8 fan of rays from one origin, like neighbouring
+        // pixels, so the rays mostly visit the same nodes.
+        const unsigned int packetSize = BVH::MAX_PACKET_SIZE;
+        const unsigned int packetCount = rayCount / packetSize;
+        std::vector<Ray> packets(packetCount * packetSize);
+        for (unsigned int p = 0; p < packetCount; ++p) {
+            glm::vec3 origin = rays[p].origin;
+            glm::vec3 target = RandomPoint(100.0f);
+            for (unsigned int i = 0; i < packetSize; ++i) {
+                glm::vec3 offset(float(i % 8) - 3.5f, float(i / 8) - 3.5f, 0.0f);
+                packets[p * packetSize + i] = Ray(origin, glm::normalize(target + 0.5f * offset - origin));
+            }
+        }
+
+        std::vector<RayHit> packetHits(packetSize);
+        start = Clock::now();
+        for (unsigned int p = 0; p < packetCount; ++p) {
+            for (RayHit& hit : packetHits)
+                hit = RayHit();
+            bvh.IntersectPacket(&packets[p * packetSize], packetHits.data(), packetSize, sphereTest);
+        }
+        m_Benchmark.packetMicroseconds = microseconds(start) / (packetCount * packetSize);
+
+        // Triangles: a 2M-triangle sphere mesh, rays from around it at its
+        // centre. TriangleBVH always tests its leaves with the SIMD kernel.
+        std::unique_ptr<Mesh> mesh = GeometryFactory::CreateSphere(1000, 1000);
+        TriangleBVH triangles;
+        triangles.Build(*mesh);
+        m_Benchmark.triangles = triangles.GetTriangleCount();
+        m_Benchmark.triangleBuildMs = triangles.GetBVH().GetStats().buildMs;
+
+        for (unsigned int i = 0; i < rayCount; ++i) {
+            glm::vec3 origin = glm::normalize(RandomPoint(1.0f) + glm::vec3(1e-3f)) * 3.0f;
+            rays[i] = Ray(origin, glm::normalize(RandomPoint(0.5f) - origin));
+        }
+
+        start = Clock::now();
+        for (const Ray& ray : rays) {
+            RayHit hit;
+            triangles.IntersectNearest(ray, hit);
+        }
+        m_Benchmark.triangleMicroseconds = microseconds(start) / rayCount;
+
+        m_Benchmark.valid = true;
     }
     void TestRayCasting::ProcessInput() {
-        if (glfwGetKey(m_window, GLFW_KEY_W) == GLFW_PRESS)
+        if (Input::GetKey(m_window, GLFW_KEY_W) == GLFW_PRESS)
             cameraPosition += cameraSpeed * cameraFront;
-        if (glfwGetKey(m_window, GLFW_KEY_S) == GLFW_PRESS)
+        if (Input::GetKey(m_window, GLFW_KEY_S) == GLFW_PRESS)
             cameraPosition -= cameraSpeed * cameraFront;
-        if (glfwGetKey(m_window, GLFW_KEY_A) == GLFW_PRESS)
+        if (Input::GetKey(m_window, GLFW_KEY_A) == GLFW_PRESS)
             cameraPosition -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
-        if (glfwGetKey(m_window, GLFW_KEY_D) == GLFW_PRESS)
+        if (Input::GetKey(m_window, GLFW_KEY_D) == GLFW_PRESS)
             cameraPosition += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
     }
 
@@ -173,13 +457,4 @@ namespace test {
         glm::vec3 rayWorld = glm::vec3(glm::inverse(viewMatrix) * rayEye);
         return glm::normalize(rayWorld);
     }
-
-    bool TestRayCasting::RayIntersectsSphere(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, const glm::vec3& sphereCenter, float sphereRadius) {
-        glm::vec3 oc = rayOrigin - sphereCenter;
-        float a = glm::dot(rayDirection, rayDirection);
-        float b = 2.0f * glm::dot(oc, rayDirection);
-        float c = glm::dot(oc, oc) - sphereRadius * sphereRadius;
-        float discriminant = b * b - 4 * a * c;
-        return discriminant > 0; // Intersection if discriminant > 0
-    }
 }
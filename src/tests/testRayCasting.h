@@ -5,6 +5,11 @@
 #include "../IndexBuffer.h"
 #include "../VertexArray.h"
 #include "../Shader.h"
+#include "../RenderQueue.h"
+#include "../InstanceBuffer.h"
+#include "../BVH.h"
+#include "../Framebuffer.h"
+#include "../GPUPicker.h"
 #include "gl/glew.h"
 #include "GLFW/glfw3.h"
 #include "glm/glm.hpp"
@@ -43,19 +48,71 @@ namespace test {
         std::vector<Object> objects;
         int selectedObjectIndex; // Index of the currently selected object (-1 if none)
 
+        // Picking goes through a BVH over the objects' bounding boxes rather
+        // than testing every sphere; see BVH.h.
+        BVH m_BVH;
+        std::vector<AABB> m_ObjectBounds;
+        SphereSoA m_Spheres;                      // the objects in BVH leaf order, for the SIMD kernel
+        bool m_UseKernels;
+        std::vector<glm::vec3> m_BasePositions;   // where each object bobs around when animating
+        int m_ExtraObjects;
+        bool m_Animate;
+        float m_Time;
+        float m_PickMicroseconds;
+
+        // GPU picking: the scene is drawn into a framebuffer with an object
+        // ID attachment and the pixel under the cursor is read back a frame
+        // or two later (see GPUPicker.h).
+        enum PickMode { PICK_CPU, PICK_GPU };
+        int m_PickMode;
+        std::unique_ptr<Framebuffer> m_PickFramebuffer;
+        GPUPicker m_Picker;
+        int m_CursorPixelX, m_CursorPixelY;   // framebuffer pixel under the cursor, y up
+
+        // Results of the last "Run benchmark"
+        struct BenchmarkResults {
+            bool valid = false;
+            unsigned int objects = 0;
+            float buildMs = 0.0f;
+            float refitMs = 0.0f;
+            unsigned int rays = 0;
+            float nearestMicroseconds = 0.0f;
+            float kernelMicroseconds = 0.0f;     // nearest again, SIMD leaf tests
+            unsigned int nearestHits = 0;
+            float anyMicroseconds = 0.0f;
+            unsigned int anyHits = 0;            // should match nearestHits
+            float packetMicroseconds = 0.0f;     // per ray, in packets of BVH::MAX_PACKET_SIZE
+            float linearMicroseconds = 0.0f;     // brute force over a few of the rays, for comparison
+            unsigned int linearRays = 0;
+            unsigned int linearHits = 0;
+            unsigned int triangles = 0;
+            float triangleBuildMs = 0.0f;
+            float triangleMicroseconds = 0.0f;
+            BVH::Stats stats;
+        } m_Benchmark;
+
         std::unique_ptr<VertexArray> m_VAO;
         std::unique_ptr<VertexBuffer> m_VBO;
         std::unique_ptr<IndexBuffer> m_IBO;
         std::unique_ptr<Shader> m_Shader;
 
+        std::unique_ptr<InstanceBuffer> m_Instances;
+        std::vector<InstanceData> m_InstanceData;
+
+        RenderQueue m_RenderQueue;
+
 
-        void GenerateSphereData(std::vector<float>& vertices, std::vector<unsigned int>& indices, float radius, unsigned int longitudeDiv, unsigned int latitudeDiv);
+        // Positions and normals of a geodesic sphere within maxError (a
+        // fraction of the radius, see GeometryFactory::SelectGeodesicSphere)
+        void GenerateSphereData(std::vector<float>& vertices, std::vector<unsigned int>& indices, float radius, float maxError);
 
 
         void ProcessInput();
         void SetupBuffers();
+        void GenerateObjects();
+        void UpdateBounds();
+        void UpdateSpheres();
+        void RunBenchmark();
         glm::vec3 CalculateRayDirection(float mouseX, float mouseY);
-        bool RayIntersectsSphere(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, 
-            const glm::vec3& sphereCenter, float sphereRadius);
     };
 }
@@ -1,4 +1,6 @@
 ﻿#include "testTexture2D.h"
+#include "../TextureCache.h"
+#include "../GLState.h"
 
 
 #include "glm/glm.hpp"              // GLM for mathematical operations and matrix manipulation
@@ -11,8 +13,8 @@ namespace test
 {
 	testTexture2D::testTexture2D() :m_TranslationA(200,200,0), m_TranslationB(400,400,0)
 	{
-        GlCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)); // Set up blending for transparency
-        GlCall(glEnable(GL_BLEND));
+        GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Set up blending for transparency
+        GLState::Enable(GL_BLEND);
 
         float positions[] = {
 		   -50.0f, -50.0f, 0.0f, 0.0f, // Bottom-left
@@ -43,7 +45,7 @@ namespace test
 
 
         // Texture loading and binding
-        m_Texture = std::make_unique<Texture>(R"(res/Textures/1.png)");
+        m_Texture = TextureCache::Get().Load(R"(res/Textures/1.png)"); // returns at once when streaming, image follows
 
         m_Texture->Bind(); // Activate texture unit 0
         m_Shader->Bind(); // Make shader active so all shader-related operations refer to it
@@ -95,6 +97,10 @@ namespace test
         ImGui::SliderFloat3("Translation A", &m_TranslationA.x, 0.0f, 960.0f); // Adjust translation for A
         ImGui::SliderFloat3("Translation B", &m_TranslationB.x, 0.0f, 960.0f); // Adjust translation for B
 
+        ImGui::Text("Texture: %d x %d%s, %s, %.0f KB with mips", m_Texture->getWidth(), m_Texture->getHeight(),
+            m_Texture->IsLoaded() ? "" : " (placeholder, streaming)",
+            m_Texture->IsCompressed() ? "BCn" : "RGBA8", m_Texture->GetMemoryBytes() / 1024.0f);
+
         // Display framerate information
         float rate = ImGui::GetIO().Framerate;
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / rate, rate);
@@ -30,6 +30,7 @@ namespace test
 		void Update(float deltaTime) override;
 		void Render() override;
 		void RenderGUI() override;
+		bool IsAnimating() const override { return false; }   // moves only with the sliders
 	private:
 		// Define translation vectors for two objects
 		glm::mat4 m_Proj, m_View;
@@ -38,7 +39,7 @@ namespace test
 		std::unique_ptr<IndexBuffer> m_IndexBuffer;
 		std::unique_ptr<Shader> m_Shader;
 		std::unique_ptr<VertexBuffer> m_VBO;
-		std::unique_ptr<Texture> m_Texture;
+		std::shared_ptr<Texture> m_Texture;   // from TextureCache: a placeholder until streamed in
 
 
 	};
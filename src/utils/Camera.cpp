@@ -17,6 +17,7 @@
  */
 
 #include "Camera.h"
+#include "../Input.h"
 #include <iostream>
 
 #include <imgui.h>
@@ -142,21 +143,19 @@ void Camera::UpdateCameraVectors()
  * 3. Mouse look (yaw/pitch rotation)
  *
  * INPUT DEBOUNCING:
- * The static 'escapePressed' variable prevents key repeat.
+ * The 'escapePressed' member prevents key repeat.
  * We only register a press on the transition from released to pressed,
  * not while the key is held down.
  */
 void Camera::processInput(float deltaTime)
 {
     // Debounce escape key - only trigger on initial press
-    static bool escapePressed = false;
-
-    if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS && !escapePressed)
+    if (Input::GetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS && !escapePressed)
     {
         this->ToggleDetach();
         escapePressed = true;
     }
-    else if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_RELEASE)
+    else if (Input::GetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_RELEASE)
     {
         escapePressed = false;
     }
@@ -179,12 +178,11 @@ void Camera::processInput(float deltaTime)
      * Note: Y is inverted because screen coordinates have Y increasing downward,
      * but we want "mouse up" to pitch the camera up (positive pitch).
      *
-     * static variables persist between function calls, maintaining lastX/lastY
-     * across frames.
+     * The lastX/lastY members persist between calls, maintaining the
+     * previous position across frames.
      */
-    static double lastX = 400.0, lastY = 300.0;  // Initialize to screen center
     double xpos, ypos;
-    glfwGetCursorPos(m_window, &xpos, &ypos);
+    Input::GetCursorPos(m_window, &xpos, &ypos);
 
     float xOffset = xpos - lastX;   // Positive = mouse moved right
     float yOffset = lastY - ypos;   // Positive = mouse moved up (inverted!)
@@ -301,10 +299,10 @@ void Camera::ProcessKeyboard(float deltaTime)
     float velocity = movementSpeed * deltaTime;
 
     // Movement along camera axes (not world axes)
-    if (glfwGetKey(m_window, GLFW_KEY_W) == GLFW_PRESS) position += front * velocity;  // Forward
-    if (glfwGetKey(m_window, GLFW_KEY_S) == GLFW_PRESS) position -= front * velocity;  // Backward
-    if (glfwGetKey(m_window, GLFW_KEY_A) == GLFW_PRESS) position -= right * velocity;  // Strafe left
-    if (glfwGetKey(m_window, GLFW_KEY_D) == GLFW_PRESS) position += right * velocity;  // Strafe right
+    if (Input::GetKey(m_window, GLFW_KEY_W) == GLFW_PRESS) position += front * velocity;  // Forward
+    if (Input::GetKey(m_window, GLFW_KEY_S) == GLFW_PRESS) position -= front * velocity;  // Backward
+    if (Input::GetKey(m_window, GLFW_KEY_A) == GLFW_PRESS) position -= right * velocity;  // Strafe left
+    if (Input::GetKey(m_window, GLFW_KEY_D) == GLFW_PRESS) position += right * velocity;  // Strafe right
 }
 
 // =============================================================================
@@ -98,6 +98,12 @@ private:
     glm::vec3 targetFront;
     bool detached = false;
 
+    // Input state carried between frames. Per camera rather than static, so
+    // a camera always starts from the same state and a replayed recording
+    // (see Input.h) follows the same path.
+    bool escapePressed = false;
+    double lastX = 400.0, lastY = 300.0;  // Initialize to screen center
+
     // ==========================================================================
     // EULER ANGLES
     // ==========================================================================